@@ -1685,6 +1685,95 @@ void PollJoysticks()
 
 
 
+// The following allow MsgMonitor() to find a message's monitor without searching g_MsgMonitor, which matters
+// because MsgMonitor() is called for nearly every message the program receives (e.g. every WM_MOUSEMOVE) once
+// the script has any monitors.  They're rebuilt by MsgMonitorIndexRebuild() whenever g_MsgMonitor changes.
+#define MSG_MONITOR_DIRECT_COUNT WM_USER // Messages below this (which includes the most frequent ones) are looked up directly.
+#define MSG_MONITOR_HASH_SIZE 1024 // Must be a power of two at least twice MAX_MSG_MONITORS.
+static DWORD sMsgMonitorBitmap[0x10000 / 32]; // Bit N is set if any monitored message has N as its low-order word.
+static short sMsgMonitorDirect[MSG_MONITOR_DIRECT_COUNT]; // For each message below WM_USER: its index in g_MsgMonitor + 1, or 0 if none.
+static struct {UINT msg; int index;} sMsgMonitorHash[MSG_MONITOR_HASH_SIZE]; // For other messages.  An index of 0 means an empty slot; otherwise it's the index in g_MsgMonitor + 1.
+#ifdef REPORT_EXIT_STATS // See defines.h.
+static UINT sMsgMonitorChecked, sMsgMonitorRejected; // For ReportMsgMonitors().
+#endif
+
+static inline UINT MsgMonitorHash(UINT aMsg)
+{
+	UINT hash = aMsg * 2654435761U; // Knuth's multiplicative constant.
+	return (hash ^ (hash >> 16)) & (MSG_MONITOR_HASH_SIZE - 1);
+}
+
+
+
+int MsgMonitorFind(UINT aMsg)
+// Returns the index in g_MsgMonitor of aMsg's monitor, or -1 if the script isn't monitoring aMsg.
+{
+	// Since most messages aren't monitored, first check the bitmap, which rejects them with a single test
+	// (except for a message that happens to share its low-order word with a monitored message).
+	if (!(sMsgMonitorBitmap[LOWORD(aMsg) >> 5] & (1U << (aMsg & 31))))
+		return -1;
+	if (aMsg < MSG_MONITOR_DIRECT_COUNT)
+		return sMsgMonitorDirect[aMsg] - 1;
+	for (UINT i = MsgMonitorHash(aMsg); sMsgMonitorHash[i].index; i = (i + 1) & (MSG_MONITOR_HASH_SIZE - 1))
+		if (sMsgMonitorHash[i].msg == aMsg)
+			return sMsgMonitorHash[i].index - 1;
+	return -1;
+}
+
+
+
+void MsgMonitorIndexRebuild()
+// Caller must call this after adding or deleting any element of g_MsgMonitor (or changing its msg).
+{
+	ZeroMemory(sMsgMonitorBitmap, sizeof(sMsgMonitorBitmap));
+	ZeroMemory(sMsgMonitorDirect, sizeof(sMsgMonitorDirect));
+	ZeroMemory(sMsgMonitorHash, sizeof(sMsgMonitorHash));
+	for (int msg_index = 0; msg_index < g_MsgMonitorCount; ++msg_index)
+	{
+		UINT msg = g_MsgMonitor[msg_index].msg;
+		sMsgMonitorBitmap[LOWORD(msg) >> 5] |= 1U << (msg & 31);
+		if (msg < MSG_MONITOR_DIRECT_COUNT)
+			sMsgMonitorDirect[msg] = (short)(msg_index + 1);
+		else
+		{
+			UINT i;
+			for (i = MsgMonitorHash(msg); sMsgMonitorHash[i].index; i = (i + 1) & (MSG_MONITOR_HASH_SIZE - 1));
+			sMsgMonitorHash[i].msg = msg;
+			sMsgMonitorHash[i].index = msg_index + 1;
+		}
+	}
+}
+
+
+
+#ifdef REPORT_EXIT_STATS
+void ReportMsgMonitors()
+// Sends to the debugger (or a tool such as DebugView) how many messages were checked against the script's
+// message monitors, and how many times each monitor was called and for how long.
+{
+	if (!sMsgMonitorChecked)
+		return;
+	LARGE_INTEGER frequency;
+	if (!QueryPerformanceFrequency(&frequency))
+		frequency.QuadPart = 0;
+	char buf[512];
+	snprintf(buf, sizeof(buf), "OnMessage: %u messages checked, %u rejected by bitmap\n", sMsgMonitorChecked, sMsgMonitorRejected);
+	OutputDebugString(buf);
+	for (int msg_index = 0; msg_index < g_MsgMonitorCount; ++msg_index)
+	{
+		MsgMonitorStruct &monitor = g_MsgMonitor[msg_index];
+		if (!monitor.call_count)
+			continue;
+		double total_ms = frequency.QuadPart ? (double)monitor.call_ticks * 1000 / frequency.QuadPart : 0;
+		snprintf(buf, sizeof(buf), "OnMessage 0x%04X %s(): %u calls, %0.3f ms total, %0.3f ms avg\n"
+			, monitor.msg, monitor.func->mName, monitor.call_count, total_ms, total_ms / monitor.call_count);
+		OutputDebugString(buf);
+	}
+}
+#endif
+
+
+
 bool MsgMonitor(HWND aWnd, UINT aMsg, WPARAM awParam, LPARAM alParam, MSG *apMsg, LRESULT &aMsgReply)
 // Returns false if the message is not being monitored, or it is but the called function indicated
 // that the message should be given its normal processing.  Returns true when the caller should
@@ -1712,18 +1801,22 @@ bool MsgMonitor(HWND aWnd, UINT aMsg, WPARAM awParam, LPARAM alParam, MSG *apMsg
 	// ResumeUnderlyingThread() sets g->AllowThreadToBeInterrupted to false for us in case the
 	// timer "TIMER_ID_UNINTERRUPTIBLE" fired for the new thread rather than for the old one (this
 	// prevents the interrupted thread from becoming permanently uninterruptible).
-	if (!INTERRUPTIBLE_IN_EMERGENCY)
-		return false;
-
-	// Linear search vs. binary search should perform better on average because the vast majority
-	// of message monitoring scripts are expected to monitor only a few message numbers.
-	int msg_index, msg_count_orig;
-	for (msg_count_orig = g_MsgMonitorCount, msg_index = 0; msg_index < g_MsgMonitorCount; ++msg_index)
-		if (g_MsgMonitor[msg_index].msg == aMsg)
-			break;
-	if (msg_index == g_MsgMonitorCount) // No match found, so the script isn't monitoring this message.
+	// The lookup is done first because it's cheaper than the interruptibility check and rejects the vast
+	// majority of messages.
+#ifdef REPORT_EXIT_STATS
+	++sMsgMonitorChecked;
+#endif
+	int msg_index = MsgMonitorFind(aMsg), msg_count_orig = g_MsgMonitorCount;
+	if (msg_index < 0) // The script isn't monitoring this message.
+	{
+#ifdef REPORT_EXIT_STATS
+		++sMsgMonitorRejected; // Nearly all of these are rejected by the bitmap, so it's reported as such.
+#endif
 		return false; // Tell the caller to give this message any additional/default processing.
+	}
 	// Otherwise, the script is monitoring this message, so continue on.
+	if (!INTERRUPTIBLE_IN_EMERGENCY)
+		return false;
 
 	MsgMonitorStruct &monitor = g_MsgMonitor[msg_index]; // For performance and convenience.
 	Func &func = *monitor.func;                          // Above, but also in case monitor item gets deleted while the function is running (e.g. by the function itself).
@@ -1816,8 +1909,15 @@ bool MsgMonitor(HWND aWnd, UINT aMsg, WPARAM awParam, LPARAM alParam, MSG *apMsg
 	g_script.mLastScriptRest = g_script.mLastPeekTime = GetTickCount();
 	++monitor.instance_count;
 
+#ifdef REPORT_EXIT_STATS
+	LARGE_INTEGER start_time, end_time; // For ReportMsgMonitors().
+	QueryPerformanceCounter(&start_time);
+#endif
 	char *return_value;
 	func.Call(return_value); // Call the UDF.
+#ifdef REPORT_EXIT_STATS
+	QueryPerformanceCounter(&end_time);
+#endif
 
 	// Fix for v1.0.47: Must handle return_value BEFORE calling FreeAndRestoreFunctionVars() because return_value
 	// might be the contents of one of the function's local variables (which are about to be free'd).
@@ -1847,24 +1947,26 @@ bool MsgMonitor(HWND aWnd, UINT aMsg, WPARAM awParam, LPARAM alParam, MSG *apMsg
 	// thing that must be checked is the message number to avoid wrongly decrementing some other msg-monitor's
 	// instance_count.  Update: Check g_MsgMonitorCount in case it has shrunk (which could leave
 	// "monitor" pointing to an element in the array that is now unused/obsolete).
+	MsgMonitorStruct *pmonitor;
 	if (g_MsgMonitorCount >= msg_count_orig && monitor.msg == aMsg)
-	{
-		if (monitor.instance_count) // Avoid going negative, which might otherwise be possible in weird circumstances described in other comments.
-			--monitor.instance_count;
-	}
+		pmonitor = &monitor;
 	else // "monitor" is now some other msg-monitor (or an obsolete item in array), so do don't change it (see above comments).
 	{
 		// Fix for v1.0.44.10: If OnMessage is called from *inside* some other monitor function in a way that
 		// deletes a message monitor, monitor.instance_count wouldn't get decremented (but only if the
 		// message(s) that were deleted lay to the left of it in the array).  So check if the monitor is
 		// somewhere else in the array and if found (i.e. it didn't delete itself), update it.
-		for (msg_index = 0; msg_index < g_MsgMonitorCount; ++msg_index)
-			if (g_MsgMonitor[msg_index].msg == aMsg)
-			{
-				if (g_MsgMonitor[msg_index].instance_count) // Avoid going negative, which might otherwise be possible in weird circumstances described in other comments.
-					--g_MsgMonitor[msg_index].instance_count;
-				break;
-			}
+		msg_index = MsgMonitorFind(aMsg);
+		pmonitor = (msg_index < 0) ? NULL : g_MsgMonitor + msg_index;
+	}
+	if (pmonitor)
+	{
+		if (pmonitor->instance_count) // Avoid going negative, which might otherwise be possible in weird circumstances described in other comments.
+			--pmonitor->instance_count;
+#ifdef REPORT_EXIT_STATS
+		++pmonitor->call_count;
+		pmonitor->call_ticks += end_time.QuadPart - start_time.QuadPart;
+#endif
 	}
 
 	return block_further_processing; // If false, the caller will ignore aMsgReply and process this message normally. If true, aMsgReply contains the reply the caller should immediately send for this message.
@@ -1978,6 +2080,8 @@ void ResumeUnderlyingThread(char *aSavedErrorLevel)
 	// The following section handles the switch-over to the former/underlying "g" item:
 	--g_nThreads; // Other sections below might rely on this having been done early.
 	--g;
+	if (g_FileWriterCount) // Write out the text that the finished thread's FileAppends left in a buffer (see FileBuffer).
+		FileWriterFlushAll();
 	g_ErrorLevel->Assign(aSavedErrorLevel);
 	// The below relies on the above having restored "g" to be the global_struct of the underlying thread.
 
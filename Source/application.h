@@ -86,6 +86,11 @@ void PollJoysticks();
 #define POLL_JOYSTICK_IF_NEEDED if (Hotkey::sJoyHotkeyCount) PollJoysticks();
 
 bool MsgMonitor(HWND aWnd, UINT aMsg, WPARAM awParam, LPARAM alParam, MSG *apMsg, LRESULT &aMsgReply);
+int MsgMonitorFind(UINT aMsg);
+void MsgMonitorIndexRebuild();
+#ifdef REPORT_EXIT_STATS
+void ReportMsgMonitors();
+#endif
 
 void InitNewThread(int aPriority, bool aSkipUninterruptible, bool aIncrementThreadCountAndUpdateTrayIcon
 	, ActionTypeType aTypeOfFirstLine);
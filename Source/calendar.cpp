@@ -0,0 +1,266 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <string.h>
+#include "calendar.h"
+
+// The number of days from 0000-03-01 (the origin used by the algorithms below) until 1601-01-01.
+#define DAYS_BEFORE_1601 584694
+
+
+
+NumInt64Type DaysFromCivil(int aYear, int aMonth, int aDay)
+// This is the well known days-from-civil algorithm, which treats March as the first month of the year so
+// that the leap day falls at the end, and counts whole 400-year eras (each of which has exactly 146097 days).
+// aDay may be outside the range of aMonth (e.g. day 0 is the last day of the prior month), but aMonth must
+// be 1 through 12.
+{
+	NumInt64Type y = (NumInt64Type)aYear - (aMonth <= 2);
+	NumInt64Type era = (y >= 0 ? y : y - 399) / 400;
+	int year_of_era = (int)(y - era * 400);                                        // [0, 399]
+	int day_of_year = (153 * (aMonth + (aMonth > 2 ? -3 : 9)) + 2) / 5 + aDay - 1; // [0, 365] for valid days.
+	int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year; // [0, 146096]
+	return era * 146097 + day_of_era - DAYS_BEFORE_1601;
+}
+
+
+
+void CivilFromDays(NumInt64Type aDays, int &aYear, int &aMonth, int &aDay)
+// The inverse of DaysFromCivil().
+{
+	NumInt64Type z = aDays + DAYS_BEFORE_1601;
+	NumInt64Type era = (z >= 0 ? z : z - 146096) / 146097;
+	int day_of_era = (int)(z - era * 146097);                                                 // [0, 146096]
+	int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365; // [0, 399]
+	int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100); // [0, 365]
+	int mp = (5 * day_of_year + 2) / 153;                                                     // [0, 11]
+	aDay = day_of_year - (153 * mp + 2) / 5 + 1;
+	aMonth = mp < 10 ? mp + 3 : mp - 9;
+	aYear = (int)(year_of_era + era * 400) + (aMonth <= 2);
+}
+
+
+
+int DaysInMonth(int aYear, int aMonth)
+{
+	static const char sDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+	if (aMonth == 2)
+		return (aYear % 4 == 0 && (aYear % 100 != 0 || aYear % 400 == 0)) ? 29 : 28;
+	return sDays[aMonth - 1];
+}
+
+
+
+bool CalendarTimeIsValid(const CalendarTime &aTime)
+{
+	return aTime.year >= CALENDAR_MIN_YEAR && aTime.year <= CALENDAR_MAX_YEAR
+		&& aTime.month >= 1 && aTime.month <= 12
+		&& aTime.day >= 1 && aTime.day <= DaysInMonth(aTime.year, aTime.month)
+		&& aTime.hour >= 0 && aTime.hour < 24
+		&& aTime.minute >= 0 && aTime.minute < 60
+		&& aTime.second >= 0 && aTime.second < 60;
+}
+
+
+
+NumInt64Type CalendarTimeToSeconds(const CalendarTime &aTime)
+{
+	return DaysFromCivil(aTime.year, aTime.month, aTime.day) * 86400
+		+ aTime.hour * 3600 + aTime.minute * 60 + aTime.second;
+}
+
+
+
+void SecondsToCalendarTime(NumInt64Type aSeconds, CalendarTime &aTime)
+{
+	NumInt64Type days = aSeconds / 86400;
+	int second_of_day = (int)(aSeconds - days * 86400);
+	if (second_of_day < 0) // Round toward negative infinity for times before 1601.
+	{
+		second_of_day += 86400;
+		--days;
+	}
+	CivilFromDays(days, aTime.year, aTime.month, aTime.day);
+	aTime.hour = second_of_day / 3600;
+	aTime.minute = second_of_day / 60 % 60;
+	aTime.second = second_of_day % 60;
+}
+
+
+
+static inline char *PutTwoDigits(char *aBuf, int aValue)
+{
+	aBuf[0] = (char)('0' + aValue / 10);
+	aBuf[1] = (char)('0' + aValue % 10);
+	return aBuf + 2;
+}
+
+
+
+char *CalendarTimeToYYYYMMDD(const CalendarTime &aTime, char *aBuf)
+{
+	char *cp = aBuf;
+	int year = aTime.year;
+	if (year > 9999)
+		*cp++ = (char)('0' + year / 10000 % 10);
+	cp = PutTwoDigits(cp, year / 100 % 100);
+	cp = PutTwoDigits(cp, year % 100);
+	cp = PutTwoDigits(cp, aTime.month);
+	cp = PutTwoDigits(cp, aTime.day);
+	cp = PutTwoDigits(cp, aTime.hour);
+	cp = PutTwoDigits(cp, aTime.minute);
+	cp = PutTwoDigits(cp, aTime.second);
+	*cp = '\0';
+	return aBuf;
+}
+
+
+
+int FormatCalendarPicture(const char *aPicture, bool aIsTime, const CalendarTime &aTime
+	, const CalendarNames &aNames, char *aBuf, int aBufSize)
+{
+	// Check for the cases that are declined rather than risk differing from Windows.  Doing this in a
+	// separate pass keeps the formatting loop below simple.
+	const char *cp;
+	bool has_day_number = false, has_month_name = false, in_quotes = false;
+	int count;
+	for (cp = aPicture; *cp; cp += count)
+	{
+		count = 1;
+		if ((unsigned char)*cp > 127) // Could be part of a multibyte character, which isn't worth supporting here.
+			return -1;
+		if (*cp == '\'')
+		{
+			if (cp[1] == '\'') // Two adjacent quotes (whose meaning depends on context) are rare enough to decline.
+				return -1;
+			in_quotes = !in_quotes;
+			continue;
+		}
+		if (in_quotes)
+			continue;
+		for (; cp[count] == *cp; ++count);
+		switch (*cp)
+		{
+		case 'd': case 'M': case 'y':
+			if (aIsTime || count > 4 || (*cp == 'y' && count == 3))
+				return -1;
+			if (*cp == 'd' && count <= 2)
+				has_day_number = true;
+			else if (*cp == 'M' && count >= 3)
+				has_month_name = true;
+			break;
+		case 'h': case 'H': case 'm': case 's': case 't':
+			if (!aIsTime || count > 2)
+				return -1;
+			break;
+		default:
+			if ((*cp >= 'A' && *cp <= 'Z') || (*cp >= 'a' && *cp <= 'z') || (*cp >= '0' && *cp <= '9'))
+				return -1; // Something such as an era ('g'), which isn't supported.
+			//else it's punctuation or a space, which is copied to the output as-is.
+		}
+	}
+	if (in_quotes // An unterminated quote.
+		|| (has_day_number && has_month_name && aNames.month_genitive_differs))
+		return -1;
+
+	char *dp = aBuf, *buf_end = aBuf + aBufSize - 1; // -1 to leave room for the terminator.
+	char number_buf[8];
+	const char *text;
+	size_t length;
+	int wday = DayOfWeekFromDays(DaysFromCivil(aTime.year, aTime.month, aTime.day));
+	for (cp = aPicture; *cp; cp += count)
+	{
+		count = 1;
+		if (*cp == '\'')
+		{
+			in_quotes = !in_quotes;
+			continue;
+		}
+		if (in_quotes || !strchr("dMyhHmst", *cp)) // Literal text.
+		{
+			if (dp >= buf_end)
+				return -1;
+			*dp++ = *cp;
+			continue;
+		}
+		for (; cp[count] == *cp; ++count);
+		int value = -1; // Set default: a name rather than a number.
+		text = "";
+		switch (*cp)
+		{
+		case 'd':
+			if (count <= 2)
+				value = aTime.day;
+			else
+				text = count == 3 ? aNames.day_abbrev[wday] : aNames.day[wday];
+			break;
+		case 'M':
+			if (count <= 2)
+				value = aTime.month;
+			else
+				text = count == 3 ? aNames.month_abbrev[aTime.month - 1] : aNames.month[aTime.month - 1];
+			break;
+		case 'y':
+			value = count == 4 ? aTime.year : aTime.year % 100; // Years are always at least 1601, so "yyyy" always has four or five digits.
+			break;
+		case 'h':
+			value = aTime.hour % 12 ? aTime.hour % 12 : 12;
+			break;
+		case 'H':
+			value = aTime.hour;
+			break;
+		case 'm':
+			value = aTime.minute;
+			break;
+		case 's':
+			value = aTime.second;
+			break;
+		case 't':
+			text = aTime.hour < 12 ? aNames.am : aNames.pm;
+			if (count == 1 && *text) // Only the first character of the designator.
+			{
+				if ((unsigned char)*text > 127) // It might be the lead byte of a multibyte character.
+					return -1;
+				number_buf[0] = *text;
+				number_buf[1] = '\0';
+				text = number_buf;
+			}
+			break;
+		}
+		if (value >= 0)
+		{
+			// A count of 1 means no leading zero.  Otherwise, there are at least two digits.
+			char *np = number_buf + sizeof(number_buf) - 1;
+			*np = '\0';
+			int min_digits = count == 1 ? 1 : 2;
+			do
+			{
+				*--np = (char)('0' + value % 10);
+				value /= 10;
+				--min_digits;
+			} while (value || min_digits > 0);
+			text = np;
+		}
+		length = strlen(text);
+		if (dp + length > buf_end)
+			return -1;
+		memcpy(dp, text, length);
+		dp += length;
+	}
+	*dp = '\0';
+	return (int)(dp - aBuf);
+}
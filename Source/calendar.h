@@ -0,0 +1,75 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef calendar_h
+#define calendar_h
+
+#include "numconv.h" // For NumInt64Type.
+
+// These functions do Gregorian calendar arithmetic directly on the date and time fields, which is much
+// faster than converting back and forth via SYSTEMTIME and FILETIME.  Days and seconds are counted from
+// the start of 1601-01-01, which is also the origin of a FILETIME, so seconds * 10000000 is a FILETIME.
+//
+// Nothing here calls the OS (even the locale's names are supplied by the caller), so test/calendar_test.cpp
+// can check every day of the supported range against a plain day count and against the C runtime's gmtime().
+
+#define CALENDAR_MIN_YEAR 1601  // The same range that SystemTimeToFileTime() accepts.
+#define CALENDAR_MAX_YEAR 30827 //
+
+struct CalendarTime
+{
+	int year, month, day; // month and day are 1-based.
+	int hour, minute, second;
+};
+
+NumInt64Type DaysFromCivil(int aYear, int aMonth, int aDay);
+void CivilFromDays(NumInt64Type aDays, int &aYear, int &aMonth, int &aDay);
+int DaysInMonth(int aYear, int aMonth);
+inline int DayOfWeekFromDays(NumInt64Type aDays) // Returns 0 for Sunday through 6 for Saturday.
+{
+	int wday = (int)((aDays + 1) % 7); // 1601-01-01 was a Monday.
+	return wday < 0 ? wday + 7 : wday;
+}
+
+bool CalendarTimeIsValid(const CalendarTime &aTime);
+NumInt64Type CalendarTimeToSeconds(const CalendarTime &aTime);
+void SecondsToCalendarTime(NumInt64Type aSeconds, CalendarTime &aTime);
+
+// Stores aTime in YYYYMMDDHH24MISS format (a year beyond 9999 has five digits) and returns aBuf, which must
+// have room for at least 15 chars.  Each field is assumed to be within the range that fits its width.
+char *CalendarTimeToYYYYMMDD(const CalendarTime &aTime, char *aBuf);
+
+// The locale-specific names used by FormatCalendarPicture().  The caller retrieves them from the OS.
+#define CALENDAR_NAME_SIZE 80 // The maximum size of these names, including the terminator, as documented for GetLocaleInfo().
+struct CalendarNames
+{
+	char month[12][CALENDAR_NAME_SIZE];
+	char month_abbrev[12][CALENDAR_NAME_SIZE];
+	char day[7][CALENDAR_NAME_SIZE];        // Sunday first, like the rest of this file.
+	char day_abbrev[7][CALENDAR_NAME_SIZE]; //
+	char am[CALENDAR_NAME_SIZE], pm[CALENDAR_NAME_SIZE];
+	bool month_genitive_differs; // True if the locale uses other forms of the month names next to a day number.
+};
+
+// Formats aTime according to aPicture, which has the syntax of the format pictures of the Windows
+// GetDateFormat() (if aIsTime is false) or GetTimeFormat() (if aIsTime is true).  Returns the length of the
+// result, or -1 if aPicture contains anything whose handling by Windows isn't certain to be reproduced here
+// (such as an era or a letter that isn't part of a specifier), or if aBuf is too small.
+int FormatCalendarPicture(const char *aPicture, bool aIsTime, const CalendarTime &aTime
+	, const CalendarNames &aNames, char *aBuf, int aBufSize);
+
+#endif
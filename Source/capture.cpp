@@ -0,0 +1,126 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+
+
+CaptureCache::CaptureCache(CaptureProvider &aProvider)
+	: mProvider(aProvider), mPixel(NULL), mIsPinned(false), mCaptureCount(0), mReuseCount(0)
+{
+}
+
+
+
+bool CaptureCache::Covers(int aLeft, int aTop, int aWidth, int aHeight, unsigned aMaxAge)
+{
+	return mPixel
+		&& (mIsPinned || (aMaxAge && mProvider.TickCount() - mTick <= aMaxAge))
+		&& aLeft >= mLeft && aTop >= mTop
+		&& aLeft + aWidth <= mLeft + mWidth && aTop + aHeight <= mTop + mHeight;
+}
+
+
+
+void CaptureCache::Keep(ScanPixelType *aPixel, int aLeft, int aTop, int aWidth, int aHeight, bool aIs16Bit)
+// Makes aPixel (which the cache now owns) the cached frame, replacing any previous one.
+{
+	if (mPixel)
+		free(mPixel);
+	mPixel = aPixel;
+	mLeft = aLeft;
+	mTop = aTop;
+	mWidth = aWidth;
+	mHeight = aHeight;
+	mIs16Bit = aIs16Bit;
+	mTick = mProvider.TickCount();
+}
+
+
+
+ScanPixelType *CaptureCache::Get(int aLeft, int aTop, int aWidth, int aHeight, unsigned aMaxAge, bool &aIs16Bit)
+{
+	if (aWidth < 1 || aHeight < 1)
+		return NULL;
+	size_t size = (size_t)aWidth * aHeight * sizeof(ScanPixelType);
+	ScanPixelType *pixel;
+	if (Covers(aLeft, aTop, aWidth, aHeight, aMaxAge))
+	{
+		if (   !(pixel = (ScanPixelType *)malloc(size))   )
+			return NULL;
+		const ScanPixelType *source = mPixel + (aTop - mTop) * mWidth + (aLeft - mLeft);
+		for (int y = 0; y < aHeight; ++y, source += mWidth)
+			memcpy(pixel + y * aWidth, source, aWidth * sizeof(ScanPixelType));
+		aIs16Bit = mIs16Bit;
+		++mReuseCount;
+		return pixel;
+	}
+	++mCaptureCount;
+	if (   !(pixel = mProvider.Capture(aLeft, aTop, aWidth, aHeight, aIs16Bit))   )
+		return NULL;
+	if (aMaxAge && !mIsPinned) // Keep a copy for subsequent searches.
+	{
+		ScanPixelType *frame_pixel = (ScanPixelType *)malloc(size);
+		if (frame_pixel) // Otherwise, it's not an error; the frame just won't be cached.
+		{
+			memcpy(frame_pixel, pixel, size);
+			Keep(frame_pixel, aLeft, aTop, aWidth, aHeight, aIs16Bit);
+		}
+	}
+	return pixel;
+}
+
+
+
+bool CaptureCache::GetPixel(int aX, int aY, unsigned aMaxAge, ScanPixelType &aColor)
+{
+	if (!Covers(aX, aY, 1, 1, aMaxAge))
+		return false;
+	aColor = mPixel[(aY - mTop) * mWidth + (aX - mLeft)];
+	++mReuseCount;
+	return true;
+}
+
+
+
+bool CaptureCache::Pin(int aLeft, int aTop, int aWidth, int aHeight)
+{
+	if (aWidth < 1 || aHeight < 1)
+		return false;
+	bool is_16bit;
+	++mCaptureCount;
+	ScanPixelType *pixel = mProvider.Capture(aLeft, aTop, aWidth, aHeight, is_16bit);
+	if (!pixel)
+		return false; // Leave any existing frame as it was.
+	Keep(pixel, aLeft, aTop, aWidth, aHeight, is_16bit);
+	mIsPinned = true;
+	return true;
+}
+
+
+
+void CaptureCache::Unpin()
+{
+	if (mPixel)
+	{
+		free(mPixel);
+		mPixel = NULL;
+	}
+	mIsPinned = false;
+}
@@ -0,0 +1,70 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef capture_h
+#define capture_h
+
+#include "pixelscan.h" // For ScanPixelType.
+
+// CaptureCache keeps the most recent capture of a region of the screen so that PixelSearch, ImageSearch and
+// PixelGetColor can reuse it rather than capture the screen anew on every call.  A frame is reused only
+// when it covers the entire region requested, and only if it has been pinned or is no older than the
+// maximum age given by the caller (which is the current thread's PixelCapture MaxAge setting).
+//
+// The screen itself and the clock are reached only through a CaptureProvider.  The program uses one based
+// on GDI; a fake one that serves synthetic frames allows the cache policy to be tested on any platform.
+
+class CaptureProvider
+{
+public:
+	virtual ~CaptureProvider() {}
+	// Returns a malloc'd array of aWidth*aHeight pixels in the format produced by getbits(), or NULL on
+	// failure.  aIs16Bit is set to indicate whether the screen was in a 16-bit (or lower) color mode.
+	virtual ScanPixelType *Capture(int aLeft, int aTop, int aWidth, int aHeight, bool &aIs16Bit) = 0;
+	virtual unsigned TickCount() = 0; // Milliseconds, wrapping around like GetTickCount().
+};
+
+class CaptureCache
+{
+	CaptureProvider &mProvider;
+	ScanPixelType *mPixel; // NULL when there is no frame.
+	int mLeft, mTop, mWidth, mHeight; // The region of the screen the frame covers.
+	bool mIs16Bit;
+	bool mIsPinned;
+	unsigned mTick; // When the frame was captured.
+	unsigned mCaptureCount, mReuseCount;
+
+	bool Covers(int aLeft, int aTop, int aWidth, int aHeight, unsigned aMaxAge);
+	void Keep(ScanPixelType *aPixel, int aLeft, int aTop, int aWidth, int aHeight, bool aIs16Bit);
+
+public:
+	CaptureCache(CaptureProvider &aProvider);
+	~CaptureCache() { Unpin(); }
+	// Returns a malloc'd copy of the specified region, which the caller may alter and must free(), or NULL
+	// on failure.  The pixels come from the cached frame when it's usable; otherwise the screen is captured
+	// and, if aMaxAge is non-zero and no frame is pinned, the capture becomes the new cached frame.
+	ScanPixelType *Get(int aLeft, int aTop, int aWidth, int aHeight, unsigned aMaxAge, bool &aIs16Bit);
+	// Sets aColor and returns true if the cached frame is usable for the specified pixel.  It never captures.
+	bool GetPixel(int aX, int aY, unsigned aMaxAge, ScanPixelType &aColor);
+	bool Pin(int aLeft, int aTop, int aWidth, int aHeight); // Captures the region and keeps it until Unpin().
+	void Unpin(); // Discards the cached frame, pinned or not.
+	bool IsPinned() { return mIsPinned; }
+	unsigned CaptureCount() { return mCaptureCount; } // Calls to CaptureProvider::Capture() so far.
+	unsigned ReuseCount() { return mReuseCount; } // Requests served from the cached frame so far.
+};
+
+#endif
@@ -0,0 +1,284 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "copyengine.h"
+
+struct CopyJob
+{
+	CopyJob *next;
+	char *source, *dest; // Both are stored in the same block of memory as the job itself.
+	unsigned source_hash, dest_hash;
+	int flags;
+	CopyUInt64Type size;
+};
+
+
+
+static unsigned HashPath(const char *aPath)
+// FNV-1a of the path with ASCII letters folded to lowercase.
+{
+	unsigned hash = 2166136261U;
+	for (const unsigned char *cp = (const unsigned char *)aPath; *cp; ++cp)
+	{
+		hash ^= (*cp >= 'A' && *cp <= 'Z') ? *cp + ('a' - 'A') : *cp;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+
+
+static inline bool JobsConflict(const CopyJob &aJob1, const CopyJob &aJob2)
+{
+	return aJob1.source_hash == aJob2.source_hash || aJob1.source_hash == aJob2.dest_hash
+		|| aJob1.dest_hash == aJob2.source_hash || aJob1.dest_hash == aJob2.dest_hash;
+}
+
+
+
+CopyEngine::CopyEngine(CopyEngineHost *aHost)
+	: mHost(aHost), mQueueHead(NULL), mQueueTail(NULL), mActiveCount(0), mLargeActive(false)
+	, mUnfinished(0), mWorkerCount(0), mWorkersStarted(false), mStopping(false)
+	, mFileCount(0), mFailureCount(0), mByteCount(0), mFailureDetailCount(0)
+{
+	mStartTick = mHost->TickCount();
+}
+
+
+
+CopyEngine::~CopyEngine()
+// Callers should first call Step() until it returns false, otherwise any jobs that haven't been started
+// are discarded.  Waits for the workers to exit.
+{
+	mHost->Lock();
+	mStopping = true;
+	mHost->Signal(CopyEngineHost::SIGNAL_WORK);
+	while (mWorkerCount)
+		mHost->Wait(CopyEngineHost::SIGNAL_DONE, COPY_ENGINE_WAIT_FOREVER);
+	mHost->Unlock();
+	CopyJob *job, *next_job;
+	for (job = mQueueHead; job; job = next_job)
+	{
+		next_job = job->next;
+		free(job);
+	}
+	for (int i = 0; i < mFailureDetailCount; ++i)
+	{
+		free(mFailure[i].source);
+		free(mFailure[i].dest);
+	}
+	delete mHost;
+}
+
+
+
+bool CopyEngine::Add(const char *aSource, const char *aDest, int aFlags, CopyUInt64Type aSize)
+// Returns false if COPY_ENGINE_MAX_QUEUED jobs are already unfinished, in which case the caller should
+// call Step() and then try again.
+{
+	size_t source_size = strlen(aSource) + 1, dest_size = strlen(aDest) + 1;
+	mHost->Lock();
+	if (mUnfinished >= COPY_ENGINE_MAX_QUEUED)
+	{
+		mHost->Unlock();
+		return false;
+	}
+	CopyJob *job = (CopyJob *)malloc(sizeof(CopyJob) + source_size + dest_size);
+	if (!job)
+	{
+		// Out of memory, so do this one synchronously once everything before it is done.
+		mHost->Unlock();
+		while (Step(COPY_ENGINE_WAIT_FOREVER));
+		int error = mHost->CopyOneFile(aSource, aDest, aFlags, aSize);
+		mHost->Lock();
+		RecordResult(aSource, aDest, aSize, error);
+		mHost->Unlock();
+		return true;
+	}
+	job->next = NULL;
+	job->source = (char *)(job + 1);
+	job->dest = job->source + source_size;
+	memcpy(job->source, aSource, source_size);
+	memcpy(job->dest, aDest, dest_size);
+	job->source_hash = HashPath(aSource);
+	job->dest_hash = HashPath(aDest);
+	job->flags = aFlags;
+	job->size = aSize;
+	if (mQueueTail)
+		mQueueTail->next = job;
+	else
+		mQueueHead = job;
+	mQueueTail = job;
+	if (++mUnfinished > 1 && !mWorkersStarted)
+	{
+		mWorkersStarted = true;
+		for (int i = 0; i < COPY_ENGINE_WORKER_COUNT; ++i)
+		{
+			if (!mHost->StartThread(Worker, this))
+				break; // Carry on with however many were started (perhaps none, in which case Step() does the work).
+			++mWorkerCount;
+		}
+	}
+	mHost->Signal(CopyEngineHost::SIGNAL_WORK);
+	mHost->Unlock();
+	return true;
+}
+
+
+
+bool CopyEngine::Step(unsigned aTimeout)
+// Returns false once every job that was added has finished.  Otherwise, either performs one job (if there
+// are no workers) or waits up to aTimeout milliseconds for a job to finish, then returns true.  This allows
+// the caller to do other things (such as check its message queue) while the jobs are in progress.
+{
+	mHost->Lock();
+	if (!mUnfinished)
+	{
+		mHost->Unlock();
+		return false;
+	}
+	CopyJob *job;
+	if (!mWorkerCount && (job = TakeJob()))
+	{
+		mHost->Unlock();
+		RunJob(job);
+		return true;
+	}
+	mHost->Wait(CopyEngineHost::SIGNAL_DONE, aTimeout);
+	mHost->Unlock();
+	return true;
+}
+
+
+
+CopyJob *CopyEngine::TakeJob()
+// Caller holds the lock.  Returns the first queued job that can be started now (see comments in
+// copyengine.h), after moving it to mActive.  Returns NULL if there is none.
+{
+	CopyJob *prev_job = NULL, *job, *earlier_job;
+	int i;
+	for (job = mQueueHead; job; prev_job = job, job = job->next)
+	{
+		if (job->size >= COPY_ENGINE_LARGE_FILE && mLargeActive)
+			continue;
+		for (i = 0; i < mActiveCount; ++i)
+			if (JobsConflict(*job, *mActive[i]))
+				break;
+		if (i < mActiveCount)
+			continue;
+		for (earlier_job = mQueueHead; earlier_job != job; earlier_job = earlier_job->next)
+			if (JobsConflict(*job, *earlier_job))
+				break;
+		if (earlier_job != job)
+			continue;
+		// Since above didn't "continue", this job can be started.
+		if (prev_job)
+			prev_job->next = job->next;
+		else
+			mQueueHead = job->next;
+		if (mQueueTail == job)
+			mQueueTail = prev_job;
+		job->next = NULL;
+		if (job->size >= COPY_ENGINE_LARGE_FILE)
+			mLargeActive = true;
+		mActive[mActiveCount++] = job;
+		return job;
+	}
+	return NULL;
+}
+
+
+
+void CopyEngine::RecordResult(const char *aSource, const char *aDest, CopyUInt64Type aSize, int aError)
+// Caller holds the lock.
+{
+	++mFileCount;
+	if (!aError)
+	{
+		mByteCount += aSize;
+		return;
+	}
+	++mFailureCount;
+	if (mFailureDetailCount < COPY_ENGINE_MAX_FAILURE_DETAILS)
+	{
+		CopyFailure &failure = mFailure[mFailureDetailCount];
+		if (   !(failure.source = strdup(aSource))   )
+			return;
+		if (   !(failure.dest = strdup(aDest))   )
+		{
+			free(failure.source);
+			return;
+		}
+		failure.error = aError;
+		++mFailureDetailCount;
+	}
+}
+
+
+
+void CopyEngine::RunJob(CopyJob *aJob)
+// Caller does NOT hold the lock, and has taken aJob via TakeJob().
+{
+	int error = mHost->CopyOneFile(aJob->source, aJob->dest, aJob->flags, aJob->size);
+	mHost->Lock();
+	RecordResult(aJob->source, aJob->dest, aJob->size, error);
+	for (int i = 0; i < mActiveCount; ++i)
+		if (mActive[i] == aJob)
+		{
+			mActive[i] = mActive[--mActiveCount];
+			break;
+		}
+	if (aJob->size >= COPY_ENGINE_LARGE_FILE)
+		mLargeActive = false;
+	--mUnfinished;
+	mHost->Signal(CopyEngineHost::SIGNAL_DONE);
+	if (mQueueHead) // A queued job that was waiting for this one might now be able to start.
+		mHost->Signal(CopyEngineHost::SIGNAL_WORK);
+	mHost->Unlock();
+	free(aJob);
+}
+
+
+
+void CopyEngine::Worker(void *aParam)
+{
+	CopyEngine &engine = *(CopyEngine *)aParam;
+	CopyEngineHost &host = *engine.mHost;
+	CopyJob *job;
+	host.Lock();
+	for (;;)
+	{
+		if (   (job = engine.TakeJob()) != NULL   )
+		{
+			if (engine.mQueueHead)
+				host.Signal(CopyEngineHost::SIGNAL_WORK); // Pass the wake-up on to another idle worker, if any.
+			host.Unlock();
+			engine.RunJob(job);
+			host.Lock();
+			continue;
+		}
+		if (engine.mStopping)
+			break;
+		host.Wait(CopyEngineHost::SIGNAL_WORK, COPY_ENGINE_WAIT_FOREVER);
+	}
+	--engine.mWorkerCount;
+	host.Signal(CopyEngineHost::SIGNAL_WORK); // Pass the stop request on to the next worker.
+	host.Signal(CopyEngineHost::SIGNAL_DONE);
+	host.Unlock();
+}
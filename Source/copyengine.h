@@ -0,0 +1,120 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef copyengine_h
+#define copyengine_h
+
+#include <stddef.h> // For size_t.
+
+// CopyEngine copies or moves a series of files on a bounded pool of worker threads.  Copying many small
+// files is dominated by per-file latency (opening, creating and closing files, especially on network
+// shares), which the pool overlaps by keeping up to COPY_ENGINE_WORKER_COUNT files in progress at once.
+// Large files are handled differently: at most one of them (COPY_ENGINE_LARGE_FILE or bigger) is copied
+// at a time, since several concurrent large sequential transfers to or from the same disk tend to be slower
+// than one, and the host may use a different method for them (e.g. unbuffered I/O with large aligned buffers).
+//
+// Jobs are started in the order they were added, except that a job whose source or destination names the
+// same file as that of an earlier job, which is either still queued or still in progress, waits until that
+// job is finished.  Thus any two jobs that could affect each other's outcome are done in their original order.
+// Names are compared case-insensitively (ASCII only), which errs on the side of serializing.
+//
+// Workers are started only once a second job is added, so the common case of a single file involves no
+// threads: the caller's own thread copies it during Step().
+//
+// The engine itself never touches the file system or the thread API: it calls CopyEngineHost to copy or move
+// each file, start workers, and lock/wait.  The Windows host in script_autoit.cpp uses CopyFile/MoveFile,
+// whereas test/copyengine_test.cpp drives the same scheduling with copy_file_range() on POSIX.
+
+#ifdef _MSC_VER
+typedef unsigned __int64 CopyUInt64Type;
+#else
+typedef unsigned long long CopyUInt64Type;
+#endif
+
+#define COPY_ENGINE_WORKER_COUNT 4
+#define COPY_ENGINE_MAX_QUEUED 64 // The number of jobs added but not yet finished, beyond which Add() refuses more.
+#define COPY_ENGINE_LARGE_FILE (16 * 1024 * 1024)
+#define COPY_ENGINE_MAX_FAILURE_DETAILS 16
+#define COPY_ENGINE_WAIT_FOREVER 0xFFFFFFFF // For CopyEngineHost::Wait(); the same as INFINITE on Windows.
+
+enum CopyFlags {COPY_OVERWRITE = 1, COPY_MOVE = 2
+	, COPY_FORCE = 4}; // Along with COPY_OVERWRITE: overwrite even a destination that's read-only, hidden or system.
+
+struct CopyFailure
+{
+	char *source, *dest;
+	int error; // The host-defined code returned by CopyOneFile().
+};
+
+class CopyEngineHost
+// Everything CopyEngine needs from the platform.  Except for the constructor and destructor, all members may
+// be called from any thread, and CopyOneFile() may run on several threads at once.
+{
+public:
+	enum {SIGNAL_WORK, SIGNAL_DONE, SIGNAL_COUNT};
+	virtual ~CopyEngineHost() {}
+	// Returns 0 on success or a nonzero host-defined error code.  aSize is the size of the source file as
+	// known to the caller, which the host may use to choose a method of copying.
+	virtual int CopyOneFile(const char *aSource, const char *aDest, int aFlags, CopyUInt64Type aSize) = 0;
+	virtual unsigned TickCount() = 0; // Milliseconds since any fixed point.
+	virtual bool StartThread(void (*aProc)(void *), void *aParam) = 0;
+	virtual void Lock() = 0;
+	virtual void Unlock() = 0;
+	// The same as DirEnumHost::Wait() except that it returns after aTimeout milliseconds even if the
+	// signal hasn't been raised.
+	virtual void Wait(int aSignal, unsigned aTimeout) = 0;
+	virtual void Signal(int aSignal) = 0;
+};
+
+struct CopyJob;
+
+class CopyEngine
+{
+	CopyEngineHost *mHost;
+	CopyJob *mQueueHead, *mQueueTail;
+	CopyJob *mActive[COPY_ENGINE_WORKER_COUNT + 1]; // +1 for the caller's own thread.
+	int mActiveCount;
+	bool mLargeActive;
+	unsigned mUnfinished; // Jobs added but not yet finished, whether queued or in progress.
+	int mWorkerCount;     // Workers that haven't yet exited.
+	bool mWorkersStarted, mStopping;
+	unsigned mStartTick;
+	unsigned mFileCount, mFailureCount;
+	CopyUInt64Type mByteCount;
+	CopyFailure mFailure[COPY_ENGINE_MAX_FAILURE_DETAILS];
+	int mFailureDetailCount;
+
+	CopyJob *TakeJob();
+	void RecordResult(const char *aSource, const char *aDest, CopyUInt64Type aSize, int aError);
+	void RunJob(CopyJob *aJob);
+	static void Worker(void *aParam);
+
+public:
+	CopyEngine(CopyEngineHost *aHost); // aHost must have been allocated with new; the destructor deletes it.
+	~CopyEngine();
+	bool Add(const char *aSource, const char *aDest, int aFlags, CopyUInt64Type aSize);
+	bool Step(unsigned aTimeout);
+
+	// The following are meaningful once Step() has returned false.
+	unsigned FileCount() {return mFileCount;}
+	unsigned FailureCount() {return mFailureCount;}
+	CopyUInt64Type ByteCount() {return mByteCount;} // The total size of the files that were copied or moved successfully.
+	unsigned ElapsedTime() {return mHost->TickCount() - mStartTick;} // Milliseconds since the engine was created.
+	int FailureDetailCount() {return mFailureDetailCount;} // Details are kept for only the first few failures.
+	const CopyFailure &FailureDetail(int aIndex) {return mFailure[aIndex];}
+};
+
+#endif
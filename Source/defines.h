@@ -18,6 +18,7 @@ GNU General Public License for more details.
 #define defines_h
 
 #include "stdafx.h" // pre-compiled headers
+#include "xoshiro.h" // for RandomState
 
 // Disable silly performance warning about converting int to bool:
 // Unlike other typecasts from a larger type to a smaller, I'm 99% sure
@@ -36,6 +37,14 @@ GNU General Public License for more details.
 #define NAME_VERSION "1.0.48.05"
 #define NAME_PV NAME_P " v" NAME_VERSION
 
+// When REPORT_EXIT_STATS is defined, the counters kept by some of the caches and engines (such as how often
+// a cache was hit) are sent to the debugger via OutputDebugString() when the program exits.  Since keeping
+// the counters costs a little time and reporting them is of interest only while developing, it's defined
+// only for debug builds unless the compiler is told otherwise (e.g. /D REPORT_EXIT_STATS).
+#if defined(_DEBUG) && !defined(REPORT_EXIT_STATS)
+#define REPORT_EXIT_STATS
+#endif
+
 // Window class names: Changing these may result in new versions not being able to detect any old instances
 // that may be running (such as the use of FindWindow() in WinMain()).  It may also have other unwanted
 // effects, such as anything in the OS that relies on the class name that the user may have changed the
@@ -195,7 +204,7 @@ struct ExprTokenType  // Something in the compiler hates the name TokenType, so
 				Var *var;         // for SYM_VAR
 				char *marker;     // for SYM_STRING and SYM_OPERAND.
 			};
-			char *buf; // Due to the outermost union, this doesn't increase the total size of the struct. It's used by SYM_FUNC (helps built-in functions), SYM_DYNAMIC, SYM_OPERAND, and perhaps other misc. purposes.
+			char *buf; // Due to the outermost union, this doesn't increase the total size of the struct. It's used by SYM_FUNC (helps built-in functions), SYM_DYNAMIC, SYM_OPERAND (see OperandNumberType), and perhaps other misc. purposes.
 		};  
 	};
 	// Note that marker's str-length should not be stored in this struct, even though it might be readily
@@ -208,6 +217,22 @@ struct ExprTokenType  // Something in the compiler hates the name TokenType, so
 	// which is the default alignment (for performance reasons) in any struct that contains 8-byte members
 	// such as double and __int64.
 };
+// The "buf" of a SYM_OPERAND that came from a literal in the script points to one of these, which holds
+// the result of classifying and converting the literal at load-time so that it isn't redone every time
+// the expression is evaluated.  SYM_OPERANDs produced at runtime have a NULL buf, meaning that their
+// numeric status is unknown.
+struct OperandNumberType
+{
+	union
+	{
+		__int64 value_int64; // for PURE_INTEGER
+		double value_double; // for PURE_FLOAT
+	};
+	SymbolType symbol; // PURE_INTEGER, PURE_FLOAT or PURE_NOT_NUMERIC.
+};
+#define OPERAND_NUMBER(token) ((OperandNumberType *)(token).buf)
+#define OPERAND_IS_INTEGER(token) ((token).buf && OPERAND_NUMBER(token)->symbol == PURE_INTEGER)
+
 #define MAX_TOKENS 512 // Max number of operators/operands.  Seems enough to handle anything realistic, while conserving call-stack space.
 #define STACK_PUSH(token_ptr) stack[stack_count++] = token_ptr
 #define STACK_POP stack[--stack_count]  // To be used as the r-value for an assignment.
@@ -270,11 +295,11 @@ enum enum_act {
 , ACT_WINSET, ACT_WINSETTITLE, ACT_WINGETTITLE, ACT_WINGETCLASS, ACT_WINGET, ACT_WINGETPOS, ACT_WINGETTEXT
 , ACT_SYSGET, ACT_POSTMESSAGE, ACT_SENDMESSAGE
 // Keep rarely used actions near the bottom for parsing/performance reasons:
-, ACT_PIXELGETCOLOR, ACT_PIXELSEARCH, ACT_IMAGESEARCH
+, ACT_PIXELGETCOLOR, ACT_PIXELSEARCH, ACT_IMAGESEARCH, ACT_PIXELCAPTURE
 , ACT_GROUPADD, ACT_GROUPACTIVATE, ACT_GROUPDEACTIVATE, ACT_GROUPCLOSE
 , ACT_DRIVESPACEFREE, ACT_DRIVE, ACT_DRIVEGET
 , ACT_SOUNDGET, ACT_SOUNDSET, ACT_SOUNDGETWAVEVOLUME, ACT_SOUNDSETWAVEVOLUME, ACT_SOUNDBEEP, ACT_SOUNDPLAY
-, ACT_FILEAPPEND, ACT_FILEREAD, ACT_FILEREADLINE, ACT_FILEDELETE, ACT_FILERECYCLE, ACT_FILERECYCLEEMPTY
+, ACT_FILEBUFFER, ACT_FILEAPPEND, ACT_FILEREAD, ACT_FILEREADLINE, ACT_FILEDELETE, ACT_FILERECYCLE, ACT_FILERECYCLEEMPTY
 , ACT_FILEINSTALL, ACT_FILECOPY, ACT_FILEMOVE, ACT_FILECOPYDIR, ACT_FILEMOVEDIR
 , ACT_FILECREATEDIR, ACT_FILEREMOVEDIR
 , ACT_FILEGETATTRIB, ACT_FILESETATTRIB, ACT_FILEGETTIME, ACT_FILESETTIME
@@ -554,6 +579,8 @@ struct global_struct
 	int MouseDelay;     // negative values may be used as special flags.
 	int MouseDelayPlay; //
 	char FormatFloat[32];
+	int FormatFloatPrecision; // The number of decimal places if FormatFloat is a simple "%0.Nf" that FTOA() can produce without snprintf(), otherwise -1.
+	RandomState RandomStream; // This thread's random number generator.  Valid only when RandomStreamIsReady is true; see ThreadRandomState().
 	Func *CurrentFunc; // v1.0.46.16: The function whose body is currently being processed at load-time, or being run at runtime (if any).
 	Func *CurrentFuncGosub; // v1.0.48.02: Allows A_ThisFunc to work even when a function Gosubs an external subroutine.
 	Label *CurrentLabel; // The label that is currently awaiting its matching "return" (if any).
@@ -565,6 +592,7 @@ struct global_struct
 	// All these one-byte members are kept adjacent to make the struct smaller, which helps conserve stack space:
 	SendModes SendMode;
 	DWORD PeekFrequency; // DWORD vs. UCHAR might improve performance a little since it's checked so often.
+	DWORD PixelCaptureMaxAge; // How old (in ms) a cached screen capture may be for PixelSearch/ImageSearch to reuse it. 0 means never.
 	DWORD ThreadStartTime;
 	int UninterruptibleDuration; // Must be int to preserve negative values found in g_script.mUninterruptibleTime.
 	DWORD CalledByIsDialogMessageOrDispatchMsg; // Detects that fact that some messages (like WM_KEYDOWN->WM_NOTIFY for UpDown controls) are translated to different message numbers by IsDialogMessage (and maybe Dispatch too).
@@ -580,6 +608,7 @@ struct global_struct
 	UCHAR StringCaseSense; // On/Off/Locale
 	bool StoreCapslockMode;
 	bool AutoTrim;
+	bool RandomStreamIsReady;
 	bool FormatIntAsHex;
 	bool MsgBoxTimedOut; // Doesn't require initialization.
 	bool IsPaused; // The latter supports better toggling via "Pause" or "Pause Toggle".
@@ -621,6 +650,7 @@ inline void global_clear_state(global_struct &g)
 	g.mLoopRegItem = NULL;
 	g.mLoopReadFile = NULL;
 	g.mLoopField = NULL;
+	g.RandomStreamIsReady = false; // Each thread gets its own stream upon first use, so it must not inherit one from the auto-execute section.
 }
 
 inline void global_init(global_struct &g)
@@ -642,6 +672,7 @@ inline void global_init(global_struct &g)
 	g.IntervalBeforeRest = 10;  // sleep for 10ms every 10ms
 	#define DEFAULT_PEEK_FREQUENCY 5
 	g.PeekFrequency = DEFAULT_PEEK_FREQUENCY; // v1.0.46. See comments in ACT_CRITICAL.
+	g.PixelCaptureMaxAge = 0; // Always capture the screen anew unless the script says otherwise.
 	g.AllowThreadToBeInterrupted = true; // Separate from g_AllowInterruption so that they can have independent values.
 	g.UninterruptibleDuration = 0; // 0 means uninterruptibility times out instantly.  Some callers may want this so that this "g" can be used to launch other threads (e.g. threadless callbacks) using 0 as their default.
 	g.AllowTimers = true;
@@ -674,6 +705,7 @@ inline void global_init(global_struct &g)
 	g.StoreCapslockMode = true;  // AutoIt2 (and probably 3's) default, and it makes a lot of sense.
 	g.AutoTrim = true;  // AutoIt2's default, and overall the best default in most cases.
 	strcpy(g.FormatFloat, "%0.6f");
+	g.FormatFloatPrecision = 6;
 	g.FormatIntAsHex = false;
 	g.ListLinesIsEnabled = true;
 	// For FormatFloat:
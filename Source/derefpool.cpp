@@ -0,0 +1,83 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include "derefpool.h"
+
+
+
+DerefBufPool::~DerefBufPool()
+{
+	while (mCount)
+		free(mBuf[--mCount]);
+}
+
+
+
+char *DerefBufPool::Alloc(size_t &aSize)
+{
+	size_t new_buf_size;
+	if (aSize <= mMaxBufSize)
+	{
+		for (new_buf_size = mIncrement; new_buf_size < aSize; new_buf_size <<= 1);
+		// Search from the top of the stack downward.  Any idle buffer of this size class or larger will
+		// do, since handing out a larger one costs nothing and avoids a malloc().
+		for (int i = mCount - 1; i >= 0; --i)
+		{
+			if (mBufSize[i] < new_buf_size)
+				continue;
+			char *buf = mBuf[i];
+			aSize = mBufSize[i];
+			mTotalSize -= aSize;
+			for (--mCount; i < mCount; ++i) // Close the gap (at most a few items).
+			{
+				mBuf[i] = mBuf[i + 1];
+				mBufSize[i] = mBufSize[i + 1];
+			}
+			++mHits;
+			return buf;
+		}
+	}
+	else // Too large to be pooled, so just round it up to the next increment as was done before the pool existed.
+	{
+		size_t increments_needed = aSize / mIncrement;
+		if (aSize % mIncrement)  // Need one more if above division truncated it.
+			++increments_needed;
+		new_buf_size = increments_needed * mIncrement;
+	}
+	++mMisses;
+	char *new_buf = (char *)malloc(new_buf_size);
+	if (new_buf)
+		aSize = new_buf_size;
+	return new_buf;
+}
+
+
+
+void DerefBufPool::Release(char *aBuf, size_t aSize)
+{
+	if (aSize <= mMaxBufSize && mCount < DEREF_BUF_POOL_CAPACITY && mTotalSize + aSize <= mMaxTotalSize)
+	{
+		mBuf[mCount] = aBuf;
+		mBufSize[mCount++] = aSize;
+		mTotalSize += aSize;
+		return;
+	}
+	if (aSize <= mMaxBufSize) // Only count those that were eligible for the pool.
+		++mDiscards;
+	free(aBuf);
+}
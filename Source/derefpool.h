@@ -0,0 +1,76 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef derefpool_h
+#define derefpool_h
+
+// Deref buffers that are no longer in use by any layer of ExpandArgs() are kept in a DerefBufPool for reuse
+// rather than being freed.  Without this, each line that calls a UDF whose body needs a deref buffer of its
+// own would malloc() and free() a buffer of at least DEREF_BUF_EXPAND_INCREMENT for every call, and so would
+// each thread that interrupts a line whose buffer has been privatized (see PRIVATIZE_S_DEREF_BUF).
+//
+// The pool is a stack so that the buffer most recently released (which is the most likely to still be in the
+// CPU cache) is the first to be reused.  There is one stack for the whole program rather than one per
+// quasi-thread: all quasi-threads run on the main thread and an interrupting thread always finishes before the
+// one it interrupted resumes, so the buffers released by each thread are on top of the stack while it runs,
+// just as they would be on a stack of its own.  Separate stacks would also keep idle buffers attached to each
+// suspended thread, where they would be of no use to the thread that's running.
+//
+// Buffers are rounded up to size classes that are powers of two so that a buffer released by one layer can
+// satisfy a slightly larger request made by the next.  Both the size of each pooled buffer and the total size
+// of the pool are capped so that the memory kept idle by the pool stays small.
+//
+// Line::DerefBufAlloc() and DerefBufRelease() use the program's pool.  test/derefpool_test.cpp checks the
+// class and test/derefpool_bench.cpp times nested UDF calls that pass large strings.  Keep this file free of
+// anything those programs can't compile outside Windows.
+
+#define DEREF_BUF_POOL_CAPACITY 8
+
+class DerefBufPool
+{
+	char *mBuf[DEREF_BUF_POOL_CAPACITY];
+	size_t mBufSize[DEREF_BUF_POOL_CAPACITY];
+	int mCount;
+	size_t mTotalSize;
+	size_t mIncrement, mMaxBufSize, mMaxTotalSize;
+	unsigned mHits, mMisses, mDiscards;
+
+public:
+	// aIncrement is the smallest buffer handed out and the granularity of those too large to pool.
+	// Only buffers no larger than aMaxBufSize are pooled, up to aMaxTotalSize in all.
+	DerefBufPool(size_t aIncrement, size_t aMaxBufSize, size_t aMaxTotalSize)
+		: mCount(0), mTotalSize(0), mIncrement(aIncrement), mMaxBufSize(aMaxBufSize), mMaxTotalSize(aMaxTotalSize)
+		, mHits(0), mMisses(0), mDiscards(0)
+	{}
+	~DerefBufPool();
+
+	// Returns a buffer whose size is at least aSize, or NULL if there is insufficient memory.  Upon success,
+	// aSize is updated to be the actual size of the buffer, which the caller should remember so that it can
+	// pass it to Release() when it's done with the buffer.
+	char *Alloc(size_t &aSize);
+
+	// aBuf must be a non-NULL buffer that was returned by Alloc() (or otherwise malloc'd), and aSize must be
+	// its size.  The buffer is either kept for reuse or freed.
+	void Release(char *aBuf, size_t aSize);
+
+	unsigned Hits() {return mHits;} // Requests satisfied from the pool.
+	unsigned Misses() {return mMisses;} // Requests that had to allocate a new buffer.
+	unsigned Discards() {return mDiscards;} // Buffers small enough to pool that were freed because the pool was full.
+	int IdleCount() {return mCount;}
+	size_t IdleSize() {return mTotalSize;}
+};
+
+#endif
@@ -0,0 +1,649 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "direnum.h"
+
+#define DIR_ENUM_MIN_ENTRIES 32
+
+enum DirJobState {DIR_JOB_QUEUED, DIR_JOB_LISTING, DIR_JOB_DONE}; // QUEUED includes a job whose listing is only partly done.
+
+struct DirChunk
+// The entries listed by one call to DirEnumHost::ListDirectory().
+{
+	char *entry;
+	size_t entry_count;
+	DirChunk *next;
+};
+
+struct DirJob
+{
+	DirListing listing;
+	DirChunk *chunk_head, *chunk_tail; // Ordered mode only: chunks not yet handed to the consumer.
+	DirJob **child; // Ordered mode only: the jobs for listing.subdir, in the same order.
+	unsigned child_count;
+	DirJobState state;
+	bool started; // At least one chunk has been (or is being) listed.
+	DirJob *prev, *next; // Links in the queue while DIR_JOB_QUEUED.
+};
+
+struct DirEnumCore
+// Everything the worker threads share with the consumer.  Except for the members that never change after
+// construction, it's accessed only while holding the host's lock.
+{
+	DirEnumHost *host;
+	size_t entry_size;
+	bool recurse, ordered;
+	DirJob *queue_head, *queue_tail; // Directories waiting to be listed, nearest to the consumer's position first.
+	DirChunk *done_head, *done_tail; // Unordered mode only: chunks not yet handed to the consumer.
+	unsigned pending;    // The number of jobs that are queued or being listed.
+	unsigned prefetched; // The number of jobs started but not yet released by the consumer (ordered mode) or not yet complete (unordered).
+	size_t buffered;     // The number of entries listed but not yet released by the consumer.
+	unsigned skipped_count, error_count;
+	int ref_count; // The DirEnum plus each worker thread that hasn't yet exited.
+	bool has_subdirs; // At least one subdirectory has been queued.
+	bool workers_started;
+	bool stopping; // Set when the DirEnum is destroyed.  Jobs being listed at that time are freed by their lister.
+};
+
+
+
+void *DirListing::AddEntry()
+{
+	if (entry_count == entry_capacity)
+	{
+		size_t new_capacity = entry_capacity ? entry_capacity * 2 : DIR_ENUM_MIN_ENTRIES;
+		char *new_entry = (char *)realloc(entry, new_capacity * entry_size);
+		if (!new_entry)
+			return NULL;
+		entry = new_entry;
+		entry_capacity = new_capacity;
+	}
+	return entry + entry_size * entry_count++;
+}
+
+
+
+static DirJob *NewJob(DirEnumCore &aCore, const char *aPath, size_t aPathLength, const char *aName, size_t aNameLength)
+// Returns a job for the directory whose path is aPath followed by aName and (if aName is non-NULL) the
+// host's separator.  Returns NULL if out of memory.
+{
+	DirJob *job = new DirJob;
+	if (!job)
+		return NULL;
+	size_t length = aPathLength + (aName ? aNameLength + 1 : 0);
+	if (   !(job->listing.path = (char *)malloc(length + 1))   )
+	{
+		delete job;
+		return NULL;
+	}
+	memcpy(job->listing.path, aPath, aPathLength);
+	if (aName)
+	{
+		memcpy(job->listing.path + aPathLength, aName, aNameLength);
+		job->listing.path[length - 1] = aCore.host->Separator();
+	}
+	job->listing.path[length] = '\0';
+	job->listing.entry = NULL;
+	job->listing.entry_count = 0;
+	job->listing.entry_capacity = 0;
+	job->listing.entry_size = aCore.entry_size;
+	job->listing.skipped_count = 0;
+	job->listing.error_count = 0;
+	job->listing.search = NULL;
+	job->listing.complete = false;
+	job->chunk_head = job->chunk_tail = NULL;
+	job->child = NULL;
+	job->child_count = 0;
+	job->state = DIR_JOB_QUEUED;
+	job->started = false;
+	job->prev = job->next = NULL;
+	return job;
+}
+
+
+
+static void FreeChunks(DirChunk *aChunk)
+{
+	for (DirChunk *next; aChunk; aChunk = next)
+	{
+		next = aChunk->next;
+		free(aChunk->entry);
+		free(aChunk);
+	}
+}
+
+
+
+static void FreeJob(DirEnumCore &aCore, DirJob *aJob)
+{
+	if (!aJob->listing.complete)
+		aCore.host->EndListing(aJob->listing);
+	free(aJob->listing.path);
+	free(aJob->listing.entry);
+	FreeChunks(aJob->chunk_head);
+	free(aJob->child);
+	delete aJob;
+}
+
+
+
+static void Unlink(DirEnumCore &aCore, DirJob *aJob)
+// Caller holds the lock.  Removes aJob (which must be queued) from the queue.
+{
+	if (aJob->prev)
+		aJob->prev->next = aJob->next;
+	else
+		aCore.queue_head = aJob->next;
+	if (aJob->next)
+		aJob->next->prev = aJob->prev;
+	else
+		aCore.queue_tail = aJob->prev;
+	aJob->prev = aJob->next = NULL;
+}
+
+
+
+static void PushFront(DirEnumCore &aCore, DirJob *aJob)
+// Caller holds the lock.
+{
+	aJob->prev = NULL;
+	aJob->next = aCore.queue_head;
+	if (aCore.queue_head)
+		aCore.queue_head->prev = aJob;
+	else
+		aCore.queue_tail = aJob;
+	aCore.queue_head = aJob;
+}
+
+
+
+static void FreeTree(DirEnumCore &aCore, DirJob *aJob)
+// Caller holds the lock and has set aCore.stopping.  Frees aJob along with any of its descendants that
+// have been created, except those being listed, which their listers will free.
+{
+	switch (aJob->state)
+	{
+	case DIR_JOB_LISTING:
+		return;
+	case DIR_JOB_QUEUED:
+		Unlink(aCore, aJob);
+		break;
+	case DIR_JOB_DONE:
+		for (unsigned i = 0; i < aJob->child_count; ++i)
+			FreeTree(aCore, aJob->child[i]);
+		break;
+	}
+	FreeJob(aCore, aJob);
+}
+
+
+
+static void ReleaseCore(DirEnumCore *aCore)
+// Caller holds the lock.  Releases it along with one reference to aCore, freeing aCore if that was the last.
+{
+	DirEnumHost *host = aCore->host;
+	bool is_last = !--aCore->ref_count;
+	host->Unlock();
+	if (!is_last)
+		return;
+	// Since there are no other references, no lock is needed to free whatever remains.
+	DirJob *job, *next_job;
+	for (job = aCore->queue_head; job; job = next_job)
+	{
+		next_job = job->next;
+		FreeJob(*aCore, job);
+	}
+	FreeChunks(aCore->done_head);
+	delete host;
+	delete aCore;
+}
+
+
+
+static inline bool CanPrefetch(DirEnumCore &aCore)
+// Caller holds the lock.  Returns true if a worker may list the job at the front of the queue.
+{
+	return aCore.queue_head && aCore.buffered < DIR_ENUM_MAX_PREFETCH
+		&& (aCore.queue_head->started || aCore.prefetched < DIR_ENUM_MAX_PREFETCH_DIRS);
+}
+
+
+
+static DirJob *TakeFromQueue(DirEnumCore &aCore, DirJob *aJob)
+// Caller holds the lock.  Removes aJob (which must be queued) from the queue so that the caller can list
+// its next chunk.
+{
+	Unlink(aCore, aJob);
+	aJob->state = DIR_JOB_LISTING;
+	if (!aJob->started)
+	{
+		aJob->started = true;
+		++aCore.prefetched;
+	}
+	return aJob;
+}
+
+
+
+static DirChunk *ListJob(DirEnumCore &aCore, DirJob &aJob)
+// Caller does NOT hold the lock, and has taken aJob from the queue.  Lists the next chunk of the directory
+// and returns it (or NULL if it has no entries).  If that was the last chunk, creates (but does not yet
+// queue) the jobs for its subdirectories.
+{
+	DirListing &listing = aJob.listing;
+	aCore.host->ListDirectory(listing, aCore.recurse);
+	DirChunk *chunk = NULL;
+	if (listing.entry_count)
+	{
+		if (   !(chunk = (DirChunk *)malloc(sizeof(DirChunk)))   )
+		{
+			free(listing.entry); // Out of memory, so omit these entries.
+			++listing.error_count;
+		}
+		else
+		{
+			chunk->entry = listing.entry;
+			chunk->entry_count = listing.entry_count;
+			chunk->next = NULL;
+		}
+		listing.entry = NULL;
+		listing.entry_count = listing.entry_capacity = 0;
+	}
+	unsigned subdir_count = listing.subdir.Count();
+	if (!listing.complete || !subdir_count)
+		return chunk;
+	if (   !(aJob.child = (DirJob **)malloc(subdir_count * sizeof(DirJob *)))   )
+	{
+		++listing.error_count; // Out of memory, so omit the subdirectories.
+		return chunk;
+	}
+	size_t path_length = strlen(listing.path), name_length;
+	const char *name;
+	for (unsigned i = 0; i < subdir_count; ++i)
+	{
+		name = listing.subdir.Item(i, name_length);
+		if (   !(aJob.child[i] = NewJob(aCore, listing.path, path_length, name, name_length))   )
+		{
+			listing.error_count += subdir_count - i; // Out of memory, so omit the rest of the subdirectories.
+			break;
+		}
+		++aJob.child_count;
+	}
+	return chunk;
+}
+
+
+
+static void PublishJob(DirEnumCore &aCore, DirJob *aJob, DirChunk *aChunk)
+// Caller holds the lock and has just called ListJob(aJob), which returned aChunk.  Makes the chunk's
+// entries available to the consumer, then either requeues aJob to list its next chunk or queues its
+// subdirectories.
+{
+	if (aCore.stopping) // The consumer is gone, so nothing refers to this job any longer.
+	{
+		FreeChunks(aChunk);
+		for (unsigned i = 0; i < aJob->child_count; ++i)
+			FreeJob(aCore, aJob->child[i]);
+		FreeJob(aCore, aJob);
+		return;
+	}
+	aCore.skipped_count += aJob->listing.skipped_count;
+	aCore.error_count += aJob->listing.error_count;
+	aJob->listing.skipped_count = 0;
+	aJob->listing.error_count = 0;
+	if (aChunk)
+	{
+		DirChunk *&tail = aCore.ordered ? aJob->chunk_tail : aCore.done_tail;
+		if (tail)
+			tail->next = aChunk;
+		else
+			(aCore.ordered ? aJob->chunk_head : aCore.done_head) = aChunk;
+		tail = aChunk;
+		aCore.buffered += aChunk->entry_count;
+	}
+	if (!aJob->listing.complete)
+	{
+		// Put it back at the front of the queue.  Whatever else is queued comes after the rest of this
+		// directory in depth-first order, so this keeps the queue in the order the consumer needs it.
+		aJob->state = DIR_JOB_QUEUED;
+		PushFront(aCore, aJob);
+		if (aChunk)
+			aCore.host->Signal(DirEnumHost::SIGNAL_RESULT);
+		if (CanPrefetch(aCore))
+			aCore.host->Signal(DirEnumHost::SIGNAL_WORK);
+		return;
+	}
+	// Push the subdirectories onto the front of the queue in reverse order so that the first one ends up
+	// at the front.  This causes the queue to be consumed in the same depth-first order as the consumer
+	// walks the tree in ordered mode, which makes it most likely that whatever directory the consumer
+	// needs next has already been listed.
+	for (unsigned i = aJob->child_count; i--;)
+		PushFront(aCore, aJob->child[i]);
+	aCore.pending += aJob->child_count;
+	--aCore.pending;
+	bool has_children = aJob->child_count > 0;
+	if (has_children)
+		aCore.has_subdirs = true;
+	if (aCore.ordered)
+		aJob->state = DIR_JOB_DONE;
+	else
+	{
+		// The queue now owns the children and the done list owns the chunks, so the job itself isn't needed.
+		aJob->child_count = 0;
+		FreeJob(aCore, aJob);
+		--aCore.prefetched;
+	}
+	aCore.host->Signal(DirEnumHost::SIGNAL_RESULT);
+	if (CanPrefetch(aCore))
+		aCore.host->Signal(DirEnumHost::SIGNAL_WORK);
+}
+
+
+
+static void DirEnumWorker(void *aParam)
+{
+	DirEnumCore &core = *(DirEnumCore *)aParam;
+	DirEnumHost &host = *core.host;
+	DirJob *job;
+	DirChunk *chunk;
+	host.Lock();
+	for (;;)
+	{
+		while (!core.stopping && !CanPrefetch(core))
+			host.Wait(DirEnumHost::SIGNAL_WORK);
+		if (core.stopping)
+			break;
+		job = TakeFromQueue(core, core.queue_head);
+		if (CanPrefetch(core))
+			host.Signal(DirEnumHost::SIGNAL_WORK); // Pass the wake-up on to another idle worker, if any.
+		host.Unlock();
+		chunk = ListJob(core, *job);
+		host.Lock();
+		PublishJob(core, job, chunk);
+	}
+	host.Signal(DirEnumHost::SIGNAL_WORK); // Pass the stop request on to the next worker.
+	ReleaseCore(&core);
+}
+
+
+
+DirEnum::DirEnum(DirEnumHost *aHost, size_t aEntrySize, bool aRecurse, bool aOrdered)
+	: mCore(new DirEnumCore), mOrdered(aOrdered), mFrame(NULL), mFrameCount(0), mFrameCapacity(0)
+	, mCurrent(NULL), mCurrentIndex(0)
+{
+	DirEnumCore &core = *mCore;
+	core.host = aHost;
+	core.entry_size = aEntrySize;
+	core.recurse = aRecurse;
+	core.ordered = aOrdered;
+	core.queue_head = core.queue_tail = NULL;
+	core.done_head = core.done_tail = NULL;
+	core.pending = 0;
+	core.prefetched = 0;
+	core.buffered = 0;
+	core.skipped_count = 0;
+	core.error_count = 0;
+	core.ref_count = 1;
+	core.has_subdirs = false;
+	core.workers_started = false;
+	core.stopping = false;
+}
+
+
+
+DirEnum::~DirEnum()
+{
+	DirEnumCore &core = *mCore;
+	core.host->Lock();
+	core.stopping = true;
+	if (mOrdered)
+	{
+		for (int i = mFrameCount - 1; i >= 0; --i)
+		{
+			Frame &frame = mFrame[i];
+			FreeChunks(frame.chunk);
+			if (frame.job->state == DIR_JOB_DONE)
+			{
+				// Children before child_index have been released already, except the one that's the next
+				// frame up, which an earlier iteration freed.
+				for (unsigned c = frame.child_index; c < frame.job->child_count; ++c)
+					FreeTree(core, frame.job->child[c]);
+				frame.job->child_count = 0;
+			}
+			FreeTree(core, frame.job);
+		}
+	}
+	else
+	{
+		FreeChunks(mCurrent);
+		FreeChunks(core.done_head);
+		core.done_head = core.done_tail = NULL;
+		while (core.queue_head)
+			FreeTree(core, core.queue_head);
+	}
+	free(mFrame);
+	core.host->Signal(DirEnumHost::SIGNAL_WORK); // Tell the workers to exit.
+	ReleaseCore(mCore);
+}
+
+
+
+bool DirEnum::Start(const char *aPath)
+// Returns false if out of memory.  Must be called only once.
+{
+	DirJob *root = NewJob(*mCore, aPath, strlen(aPath), NULL, 0);
+	if (!root)
+		return false;
+	// No lock is needed because there are no workers yet.
+	mCore->queue_head = mCore->queue_tail = root;
+	mCore->pending = 1;
+	return mOrdered ? PushFrame(root) : true;
+}
+
+
+
+bool DirEnum::PushFrame(DirJob *aJob)
+{
+	if (mFrameCount == mFrameCapacity)
+	{
+		int new_capacity = mFrameCapacity ? mFrameCapacity * 2 : 16;
+		Frame *new_frame = (Frame *)realloc(mFrame, new_capacity * sizeof(Frame));
+		if (!new_frame)
+			return false;
+		mFrame = new_frame;
+		mFrameCapacity = new_capacity;
+	}
+	Frame &frame = mFrame[mFrameCount++];
+	frame.job = aJob;
+	frame.chunk = NULL;
+	frame.entry_index = 0;
+	frame.child_index = 0;
+	frame.listed = false;
+	return true;
+}
+
+
+
+void DirEnum::ListNow(DirJob *aJob)
+// Caller holds the lock and has ensured aJob is queued.  Lists its next chunk on this thread rather than
+// waiting for a worker to get around to it, which also means that no worker threads are needed for a
+// walk that turns out to have no subdirectories, however large the directory.
+{
+	DirEnumCore &core = *mCore;
+	TakeFromQueue(core, aJob);
+	core.host->Unlock();
+	DirChunk *chunk = ListJob(core, *aJob);
+	core.host->Lock();
+	PublishJob(core, aJob, chunk);
+	if (core.has_subdirs && !core.workers_started)
+	{
+		// Now that there's more than one directory to list, start the workers.
+		core.workers_started = true;
+		for (int i = 0; i < DIR_ENUM_WORKER_COUNT; ++i)
+		{
+			++core.ref_count;
+			if (!core.host->StartThread(DirEnumWorker, mCore))
+			{
+				--core.ref_count; // Carry on with however many were started (perhaps none).
+				break;
+			}
+		}
+	}
+}
+
+
+
+void DirEnum::Release(DirJob *aJob)
+// Frees a job whose entries have all been consumed.
+{
+	DirEnumHost &host = *mCore->host;
+	host.Lock();
+	--mCore->prefetched;
+	if (CanPrefetch(*mCore))
+		host.Signal(DirEnumHost::SIGNAL_WORK); // A worker might be waiting for the number to drop below the limit.
+	host.Unlock();
+	FreeJob(*mCore, aJob);
+}
+
+
+
+void DirEnum::Release(DirChunk *aChunk)
+// Frees a chunk whose entries have all been consumed.
+{
+	DirEnumHost &host = *mCore->host;
+	host.Lock();
+	mCore->buffered -= aChunk->entry_count;
+	if (CanPrefetch(*mCore))
+		host.Signal(DirEnumHost::SIGNAL_WORK); // A worker might be waiting for the number to drop below the limit.
+	host.Unlock();
+	FreeChunks(aChunk);
+}
+
+
+
+const void *DirEnum::Next()
+{
+	DirEnumCore &core = *mCore;
+	if (mOrdered)
+	{
+		while (mFrameCount)
+		{
+			Frame &frame = mFrame[mFrameCount - 1];
+			DirJob &job = *frame.job;
+			if (frame.chunk)
+			{
+				if (frame.entry_index < frame.chunk->entry_count)
+					return frame.chunk->entry + core.entry_size * frame.entry_index++;
+				Release(frame.chunk);
+				frame.chunk = NULL;
+			}
+			if (!frame.listed)
+			{
+				// Get the next chunk of this directory, listing it now if no worker is already doing so.
+				core.host->Lock();
+				while (!job.chunk_head && job.state != DIR_JOB_DONE)
+				{
+					if (job.state == DIR_JOB_QUEUED)
+						ListNow(&job);
+					else
+						core.host->Wait(DirEnumHost::SIGNAL_RESULT);
+				}
+				frame.chunk = job.chunk_head;
+				if (frame.chunk)
+				{
+					if (   !(job.chunk_head = frame.chunk->next)   )
+						job.chunk_tail = NULL;
+					frame.chunk->next = NULL;
+					frame.entry_index = 0;
+				}
+				else // The directory is done and all its entries have been returned.
+					frame.listed = true;
+				core.host->Unlock();
+				continue;
+			}
+			if (frame.child_index < job.child_count)
+			{
+				if (!PushFrame(job.child[frame.child_index]))
+				{
+					// Out of memory.  Nearly impossible, so just end the walk early, but make it known.
+					core.host->Lock();
+					++core.error_count;
+					core.host->Unlock();
+					return NULL;
+				}
+				++mFrame[mFrameCount - 2].child_index; // Not frame.child_index, since PushFrame() may have moved it.
+				continue;
+			}
+			--mFrameCount; // Done with this directory and all its subdirectories.
+			Release(&job);
+		}
+		return NULL;
+	}
+
+	// Otherwise, it's unordered mode.
+	for (;;)
+	{
+		if (mCurrent)
+		{
+			if (mCurrentIndex < mCurrent->entry_count)
+				return mCurrent->entry + core.entry_size * mCurrentIndex++;
+			Release(mCurrent);
+			mCurrent = NULL;
+		}
+		core.host->Lock();
+		while (!core.done_head)
+		{
+			if (core.queue_head) // Rather than sit idle, help the workers.
+				ListNow(core.queue_head);
+			else if (!core.pending) // Nothing is queued or being listed, so the walk is complete.
+			{
+				core.host->Unlock();
+				return NULL;
+			}
+			else
+				core.host->Wait(DirEnumHost::SIGNAL_RESULT);
+		}
+		mCurrent = core.done_head;
+		if (   !(core.done_head = mCurrent->next)   )
+			core.done_tail = NULL;
+		mCurrent->next = NULL;
+		mCurrentIndex = 0;
+		core.host->Unlock();
+	}
+}
+
+
+
+unsigned DirEnum::SkippedCount()
+{
+	mCore->host->Lock();
+	unsigned skipped_count = mCore->skipped_count;
+	mCore->host->Unlock();
+	return skipped_count;
+}
+
+
+
+unsigned DirEnum::ErrorCount()
+{
+	mCore->host->Lock();
+	unsigned error_count = mCore->error_count;
+	mCore->host->Unlock();
+	return error_count;
+}
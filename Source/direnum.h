@@ -0,0 +1,129 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef direnum_h
+#define direnum_h
+
+#include <stddef.h> // For size_t.
+#include "packedarray.h"
+
+// DirEnum walks a directory tree on behalf of file-loops and the file commands that accept wildcards.
+// Directories are listed by a DirEnumHost, which decides what an "entry" is, filters out unwanted entries
+// as early as possible (i.e. while listing rather than while consuming), and reports which subdirectories
+// should be recursed into.  Each directory is listed in chunks of about DIR_ENUM_CHUNK entries, so the
+// consumer can start on a huge directory before all of it has been listed.  Once a directory is found to
+// have subdirectories, up to DIR_ENUM_WORKER_COUNT worker threads list ahead of the consumer, so that the
+// latency of each listing (which dominates on network shares) overlaps both with other listings and with
+// whatever the consumer does with the entries.  The workers stop getting ahead once DIR_ENUM_MAX_PREFETCH
+// entries are waiting to be consumed (give or take a chunk per thread) or DIR_ENUM_MAX_PREFETCH_DIRS
+// directories have been started but not finished by the consumer, whichever comes first.
+//
+// In ordered mode, entries are returned in exactly the order a sequential depth-first walk would return
+// them: a directory's own entries, then each of its subdirectories' trees in listing order.  Unordered
+// mode returns each chunk as soon as any thread has listed it, which avoids waiting on one slow directory
+// while others are ready; it suits commands that merely act on every entry.
+//
+// Threads, locking and the file system are reached only through DirEnumHost, so test/direnum_test.cpp
+// can drive the engine with a readdir() based host.
+
+#define DIR_ENUM_WORKER_COUNT 4
+#define DIR_ENUM_CHUNK 256
+#define DIR_ENUM_MAX_PREFETCH 4096
+#define DIR_ENUM_MAX_PREFETCH_DIRS 64
+
+struct DirListing
+// A directory being listed.  The host fills in everything except path, and is called once per chunk.
+{
+	char *path; // The directory's path including its trailing separator, or "" for the working directory.
+	char *entry; // entry_count entries of the size given to DirEnum, packed back to back.  Taken by DirEnum after each chunk.
+	size_t entry_count, entry_capacity;
+	size_t entry_size;
+	PackedStringArray subdir; // The names (not paths) of the subdirectories to recurse into.
+	unsigned skipped_count; // Matching entries the host had to skip (e.g. because their paths are too long).
+	unsigned error_count; // Failures to list all of the directory or find all of its subdirectories, e.g. due to an I/O error.
+	void *search; // Whatever the host needs to continue listing with the next chunk.  Initially NULL.
+	bool complete; // Set by the host once there's nothing more to list.
+
+	void *AddEntry(); // Returns the memory for a new entry, or NULL if out of memory.
+};
+
+class DirEnumHost
+// Everything DirEnum needs from the platform.  Except for the constructor and destructor, all members may
+// be called from any thread, and ListDirectory() may run on several threads at once (but never for the
+// same listing).
+{
+public:
+	enum {SIGNAL_WORK, SIGNAL_RESULT, SIGNAL_COUNT};
+	virtual ~DirEnumHost() {}
+	// Lists the next chunk of aListing: about DIR_ENUM_CHUNK entries, or the rest of the directory if
+	// that's fewer.  Sets aListing.complete after the last chunk, by which time aListing.subdir must also be
+	// complete.  If the walk ends before that, EndListing() is called instead (perhaps before the first chunk).
+	virtual void ListDirectory(DirListing &aListing, bool aWantSubdirs) = 0;
+	virtual void EndListing(DirListing &aListing) = 0;
+	virtual char Separator() = 0; // Appended after a subdirectory's name to form its path.
+	virtual bool StartThread(void (*aProc)(void *), void *aParam) = 0;
+	virtual void Lock() = 0;
+	virtual void Unlock() = 0;
+	// Wait() is called with the lock held.  It must release the lock, wait until the given signal has been
+	// raised at least once since the last Wait() for that signal returned, then reacquire the lock (i.e. the
+	// semantics of an auto-reset event).  Waking only one of several waiters per Signal() is sufficient.
+	virtual void Wait(int aSignal) = 0;
+	virtual void Signal(int aSignal) = 0;
+};
+
+struct DirJob;
+struct DirChunk;
+struct DirEnumCore;
+
+class DirEnum
+{
+	DirEnumCore *mCore; // Shared with the worker threads, which may outlive this object by one listing.
+	bool mOrdered;
+
+	// For ordered mode, the path from the root to the directory whose entries are being returned:
+	struct Frame
+	{
+		DirJob *job;
+		DirChunk *chunk; // The chunk of job's entries being returned, if any.
+		size_t entry_index;
+		unsigned child_index;
+		bool listed; // All of job's entries have been returned.
+	} *mFrame;
+	int mFrameCount, mFrameCapacity;
+
+	// For unordered mode, the chunk whose entries are being returned:
+	DirChunk *mCurrent;
+	size_t mCurrentIndex;
+
+	bool PushFrame(DirJob *aJob);
+	void ListNow(DirJob *aJob);
+	void Release(DirJob *aJob);
+	void Release(DirChunk *aChunk);
+
+public:
+	// aHost must have been allocated with new; it is deleted once neither this object nor any worker thread
+	// needs it any longer.
+	DirEnum(DirEnumHost *aHost, size_t aEntrySize, bool aRecurse, bool aOrdered);
+	~DirEnum();
+	bool Start(const char *aPath);
+	const void *Next(); // Returns NULL when there are no more entries.  Each entry remains valid until the next call.
+	unsigned SkippedCount(); // The total of the skipped_count of every directory listed so far.
+	// The total of the error_count of every directory listed so far, plus any directories or entries that
+	// had to be omitted for lack of memory.  If it's nonzero, the walk didn't see the whole tree.
+	unsigned ErrorCount();
+};
+
+#endif
@@ -0,0 +1,262 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "download.h"
+
+static const char *ParseDownloadNumber(const char *aText, DownloadUInt64Type &aNumber)
+// Returns the position after the digits at aText, or NULL if there aren't any or they would overflow.
+{
+	if (*aText < '0' || *aText > '9')
+		return NULL;
+	for (aNumber = 0; *aText >= '0' && *aText <= '9'; ++aText)
+	{
+		if (aNumber > (DOWNLOAD_LENGTH_UNKNOWN - 9) / 10) // Also ensures a valid number is never DOWNLOAD_LENGTH_UNKNOWN.
+			return NULL;
+		aNumber = aNumber * 10 + (*aText - '0');
+	}
+	return aText;
+}
+
+
+
+bool DownloadParseContentRange(const char *aText, DownloadUInt64Type &aFirst, DownloadUInt64Type &aTotal)
+{
+	while (*aText == ' ' || *aText == '\t')
+		++aText;
+	static const char sUnit[] = "bytes";
+	for (int i = 0; sUnit[i]; ++i, ++aText)
+		if ((*aText | 0x20) != sUnit[i]) // Units are case-insensitive.
+			return false;
+	if (*aText != ' ' && *aText != '\t')
+		return false;
+	while (*aText == ' ' || *aText == '\t')
+		++aText;
+	DownloadUInt64Type last = 0;
+	if (*aText == '*')
+	{
+		aFirst = DOWNLOAD_LENGTH_UNKNOWN;
+		++aText;
+	}
+	else if (   !(aText = ParseDownloadNumber(aText, aFirst)) || *aText++ != '-'
+		|| !(aText = ParseDownloadNumber(aText, last)) || last < aFirst   )
+		return false;
+	if (*aText++ != '/')
+		return false;
+	if (*aText == '*')
+	{
+		aTotal = DOWNLOAD_LENGTH_UNKNOWN;
+		++aText;
+	}
+	else if (   !(aText = ParseDownloadNumber(aText, aTotal))
+		|| (aFirst != DOWNLOAD_LENGTH_UNKNOWN && last >= aTotal)   )
+		return false;
+	while (*aText == ' ' || *aText == '\t')
+		++aText;
+	return !*aText && (aFirst != DOWNLOAD_LENGTH_UNKNOWN || aTotal != DOWNLOAD_LENGTH_UNKNOWN); // "*/*" isn't valid.
+}
+
+
+
+DownloadMemorySink::~DownloadMemorySink()
+{
+	free(mData);
+}
+
+
+
+bool DownloadMemorySink::Grow(size_t aNeeded)
+// Ensures there's room for at least aNeeded bytes.  Returns false if that would exceed the maximum or if
+// memory couldn't be allocated.
+{
+	if (aNeeded <= mCapacity)
+		return true;
+	if (aNeeded > mMaxLength)
+		return false;
+	// Double the capacity so that the number of reallocations (and the total size of the data they copy) stays
+	// proportional to the final length even when the transport's length hint is absent.
+	size_t new_capacity = mCapacity < DOWNLOAD_MIN_BUFFER ? DOWNLOAD_MIN_BUFFER : mCapacity;
+	while (new_capacity < aNeeded)
+		new_capacity = new_capacity > mMaxLength / 2 ? mMaxLength : new_capacity * 2;
+	char *new_data = (char *)realloc(mData, new_capacity);
+	if (!new_data)
+		return false;
+	mData = new_data;
+	mCapacity = new_capacity;
+	return true;
+}
+
+
+
+bool DownloadMemorySink::Begin(bool aAppend, DownloadUInt64Type aLengthHint)
+{
+	if (!aAppend)
+		mLength = 0;
+	// Reserve room for the whole body if its length is known, so that typically no reallocation is needed.
+	// A hint beyond the maximum is ignored rather than treated as a failure here since it might be wrong;
+	// Write() will fail if the data really is too long.
+	if (aLengthHint != DOWNLOAD_LENGTH_UNKNOWN && aLengthHint <= mMaxLength - mLength)
+		Grow(mLength + (size_t)aLengthHint); // Failure is okay since Write() will try again as needed.
+	return true;
+}
+
+
+
+bool DownloadMemorySink::Write(const void *aData, size_t aSize)
+{
+	if (aSize > mMaxLength - mLength || !Grow(mLength + aSize))
+		return false;
+	memcpy(mData + mLength, aData, aSize);
+	mLength += aSize;
+	return true;
+}
+
+
+
+Downloader::Downloader(DownloadTransport *aTransport, DownloadSink *aSink, size_t aMaxBuffer)
+	: mTransport(aTransport), mSink(aSink), mBuf(NULL), mBufSize(0), mReadSize(0), mStatus(DOWNLOAD_FAILED)
+	, mStartTick(0), mConnectTime(0), mFirstByteTime(0), mTotalTime(0), mByteCount(0), mResumeOffset(0)
+{
+	if (aMaxBuffer < DOWNLOAD_MIN_BUFFER)
+		aMaxBuffer = DOWNLOAD_MIN_BUFFER;
+	else if (aMaxBuffer > DOWNLOAD_MAX_BUFFER)
+		aMaxBuffer = DOWNLOAD_MAX_BUFFER;
+	mMaxBuffer = aMaxBuffer;
+}
+
+
+
+Downloader::~Downloader()
+{
+	free(mBuf);
+}
+
+
+
+DownloadStatus Downloader::Finish(DownloadStatus aStatus)
+{
+	mTotalTime = mTransport->TickCount() - mStartTick;
+	free(mBuf);
+	mBuf = NULL;
+	return mStatus = aStatus;
+}
+
+
+
+bool Downloader::RangeMatches(DownloadOpenResult aResult, DownloadUInt64Type aOffset)
+// Returns true if the response to a request for the part after aOffset is something the sink's data can be
+// combined with: either a remainder that starts right at aOffset or confirmation that there's nothing after it.
+{
+	char range_text[128];
+	DownloadUInt64Type first, total;
+	if (   !mTransport->ContentRange(range_text, sizeof(range_text))
+		|| !DownloadParseContentRange(range_text, first, total)   )
+		return false;
+	if (aResult == DOWNLOAD_OPEN_REMAINDER)
+		return first == aOffset;
+	// Otherwise, it's DOWNLOAD_OPEN_COMPLETE, which is correct only if the resource is exactly as long as what
+	// the sink has.  If the resource is shorter, the sink has more than what's there, so it can't be the same version.
+	return first == DOWNLOAD_LENGTH_UNKNOWN && total == aOffset;
+}
+
+
+
+DownloadStatus Downloader::Start(const char *aURL, DownloadUInt64Type aResumeOffset, const char *aValidator)
+{
+	mStartTick = mTransport->TickCount();
+	if (   !(mBuf = (char *)malloc(DOWNLOAD_MIN_BUFFER))   )
+		return Finish(DOWNLOAD_FAILED);
+	mBufSize = mReadSize = DOWNLOAD_MIN_BUFFER;
+
+	if (!aValidator || !*aValidator)
+		aResumeOffset = 0; // There's no way to tell whether the sink's data is still part of the resource.
+	DownloadOpenResult result = mTransport->Open(aURL, aResumeOffset, aValidator);
+	if (   (result == DOWNLOAD_OPEN_REMAINDER || result == DOWNLOAD_OPEN_COMPLETE)
+		&& !RangeMatches(result, aResumeOffset)   )
+	{
+		// The response can't be combined with what the sink has, so start over with the whole resource.
+		aResumeOffset = 0;
+		result = mTransport->Open(aURL, 0, NULL);
+	}
+	mConnectTime = mTransport->TickCount() - mStartTick;
+	switch (result)
+	{
+	case DOWNLOAD_OPEN_FAILED:
+		return Finish(DOWNLOAD_FAILED);
+	case DOWNLOAD_OPEN_COMPLETE:
+		if (aResumeOffset)
+		{
+			mResumeOffset = aResumeOffset;
+			return Finish(DOWNLOAD_DONE); // The sink is left as it is.
+		}
+		// Otherwise, nothing was to be kept, so the sink must be emptied the same as for any other response.
+		// Fall through.
+	case DOWNLOAD_OPEN_REMAINDER:
+		mResumeOffset = aResumeOffset;
+		break;
+	default: // DOWNLOAD_OPEN_WHOLE
+		mResumeOffset = 0; // Anything the sink already has must be replaced.
+	}
+	if (!mSink->Begin(mResumeOffset != 0, mTransport->ContentLength()))
+		return Finish(DOWNLOAD_FAILED);
+	return mStatus = DOWNLOAD_MORE;
+}
+
+
+
+DownloadStatus Downloader::Step()
+{
+	if (mStatus != DOWNLOAD_MORE)
+		return mStatus;
+	size_t bytes_read;
+	unsigned tick_before_read = mTransport->TickCount();
+	if (!mTransport->Read(mBuf, mReadSize, bytes_read))
+		return Finish(DOWNLOAD_FAILED);
+	unsigned tick_after_read = mTransport->TickCount();
+	if (!bytes_read) // The end of the body.
+		return Finish(DOWNLOAD_DONE);
+	if (!mByteCount)
+		mFirstByteTime = tick_after_read - mStartTick;
+	mByteCount += bytes_read;
+	if (!mSink->Write(mBuf, bytes_read))
+		return Finish(DOWNLOAD_FAILED);
+	if (tick_after_read - tick_before_read > DOWNLOAD_SLOW_READ)
+	{
+		// Read less at a time so that control returns to the caller sooner.  The buffer itself is kept
+		// so that growing back to its size later won't require another allocation.
+		if (mReadSize > DOWNLOAD_MIN_BUFFER)
+			mReadSize /= 2;
+	}
+	else if (bytes_read == mReadSize && mReadSize < mMaxBuffer)
+	{
+		// A full chunk that arrived quickly means more data was probably waiting, so read more at a time.
+		size_t new_size = mReadSize > mMaxBuffer / 2 ? mMaxBuffer : mReadSize * 2;
+		if (new_size > mBufSize)
+		{
+			char *new_buf = (char *)realloc(mBuf, new_size);
+			if (new_buf) // Otherwise, just keep using the current size.
+			{
+				mBuf = new_buf;
+				mBufSize = new_size;
+			}
+		}
+		if (new_size <= mBufSize)
+			mReadSize = new_size;
+	}
+	return DOWNLOAD_MORE;
+}
@@ -0,0 +1,155 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef download_h
+#define download_h
+
+#include <stddef.h> // For size_t.
+
+// Downloader streams the body of a URL into a DownloadSink (a file, a block of memory, etc.) through a
+// DownloadTransport, which does the actual networking.  Data is read in chunks whose size adapts to the speed
+// of the transfer: the size starts at DOWNLOAD_MIN_BUFFER and doubles whenever a read fills the chunk quickly,
+// up to the maximum given by the caller.  A fast download therefore soon settles on large reads and writes, which
+// greatly reduces the per-chunk overhead of both the transport and the sink.  Conversely, the size is halved
+// whenever a read takes longer than DOWNLOAD_SLOW_READ, which keeps the caller responsive with transports whose
+// reads wait for the whole chunk rather than returning whatever data has arrived.
+//
+// A download can also be resumed: if the caller passes the number of bytes it already has along with a validator
+// identifying the version of the resource those bytes came from, the transport asks for only the rest, and only
+// if the resource hasn't changed since (i.e. by means of HTTP's Range and If-Range headers).  Without a validator
+// the whole resource is downloaded again, since appending part of a newer version to an older one would silently
+// corrupt the result.  Since not all servers honor such requests, the transport reports whether the response
+// is the remainder or the whole thing.  A remainder is used only if its Content-Range starts exactly where the
+// sink's data ends, and a "range not satisfiable" response counts as complete only if it confirms that the
+// resource is exactly as long as what the sink has; otherwise the whole resource is requested again.  The sink
+// is then told whether to append or start over.
+//
+// WinINetTransport and FileDownloadSink in script_autoit.cpp implement UrlDownloadToFile.  test/download_test.cpp
+// substitutes a transport that serves a resource from memory on a simulated clock, which lets it check the
+// resume rules above against misbehaving servers and the buffer sizing against slow and fast transfers.
+//
+// Downloader does no waiting of its own and is meant to be driven by its caller, which calls Step() until it
+// returns something other than DOWNLOAD_MORE and is free to do other things (such as checking messages) in between.
+
+#ifdef _MSC_VER
+typedef unsigned __int64 DownloadUInt64Type;
+#else
+typedef unsigned long long DownloadUInt64Type;
+#endif
+
+#define DOWNLOAD_MIN_BUFFER 1024
+#define DOWNLOAD_DEFAULT_BUFFER (64 * 1024)
+#define DOWNLOAD_MAX_BUFFER (16 * 1024 * 1024)
+#define DOWNLOAD_SLOW_READ 50 // Milliseconds.
+#define DOWNLOAD_LENGTH_UNKNOWN ((DownloadUInt64Type)-1)
+
+enum DownloadOpenResult {DOWNLOAD_OPEN_FAILED
+	, DOWNLOAD_OPEN_WHOLE     // The response is the whole resource, even if only part of it was requested.
+	, DOWNLOAD_OPEN_REMAINDER // The response is only the part after the requested offset.
+	, DOWNLOAD_OPEN_COMPLETE  // There's nothing after the requested offset (i.e. the caller already has it all).
+};
+
+enum DownloadStatus {DOWNLOAD_FAILED, DOWNLOAD_MORE, DOWNLOAD_DONE};
+
+// Parses a Content-Range header such as "bytes 100-199/200".  aFirst is set to DOWNLOAD_LENGTH_UNKNOWN if the
+// range is "*" (as in a "range not satisfiable" response) and aTotal is set to it if the length is "*".
+// Returns false if aText isn't a valid byte range.
+bool DownloadParseContentRange(const char *aText, DownloadUInt64Type &aFirst, DownloadUInt64Type &aTotal);
+
+class DownloadTransport
+{
+public:
+	virtual ~DownloadTransport() {}
+	// Sends the request and waits for the response to begin.  If aOffset is nonzero, only the part of the
+	// resource after that many bytes is requested, and only if the resource's entity tag or last-modified date
+	// still matches aValidator (see Downloader::Start()).  May be called again to replace the response with a new one.
+	virtual DownloadOpenResult Open(const char *aURL, DownloadUInt64Type aOffset, const char *aValidator) = 0;
+	// Copies the response's Content-Range (e.g. "bytes 100-199/200" or "bytes */200") into aBuf, which is
+	// terminated even if the header is truncated.  Returns false if the response has no such header.
+	virtual bool ContentRange(char *aBuf, size_t aSize) = 0;
+	// Returns the length of the response's body (i.e. of the remainder in the case of DOWNLOAD_OPEN_REMAINDER),
+	// or DOWNLOAD_LENGTH_UNKNOWN.  This is only a hint and the body may turn out to be shorter or longer.
+	virtual DownloadUInt64Type ContentLength() = 0;
+	// Reads up to aSize bytes of the body, returning as soon as any are available.  Returns false on failure.
+	// Otherwise, aBytesRead is set to the number of bytes read, which is zero only at the end of the body.
+	virtual bool Read(void *aBuf, size_t aSize, size_t &aBytesRead) = 0;
+	virtual unsigned TickCount() = 0; // Milliseconds since any fixed point.
+};
+
+class DownloadSink
+{
+public:
+	virtual ~DownloadSink() {}
+	// Called once the response has begun, before any data is written.  aAppend is true if the data that
+	// follows should be added to what the sink already has (see Downloader::Start()) rather than replace it.
+	// aLengthHint is the transport's ContentLength(), which may be used to preallocate space.
+	virtual bool Begin(bool aAppend, DownloadUInt64Type aLengthHint) = 0;
+	virtual bool Write(const void *aData, size_t aSize) = 0;
+};
+
+class DownloadMemorySink : public DownloadSink
+// Collects the data in a single block of memory, which grows as needed up to the maximum given to the constructor.
+{
+	char *mData;
+	size_t mLength, mCapacity, mMaxLength;
+
+	bool Grow(size_t aNeeded);
+
+public:
+	DownloadMemorySink(size_t aMaxLength) : mData(NULL), mLength(0), mCapacity(0), mMaxLength(aMaxLength) {}
+	~DownloadMemorySink();
+	bool Begin(bool aAppend, DownloadUInt64Type aLengthHint);
+	bool Write(const void *aData, size_t aSize);
+	char *Data() {return mData;} // NULL if nothing has been written.
+	size_t Length() {return mLength;}
+};
+
+class Downloader
+{
+	DownloadTransport *mTransport;
+	DownloadSink *mSink;
+	char *mBuf;
+	size_t mBufSize, mMaxBuffer, mReadSize;
+	DownloadStatus mStatus;
+	unsigned mStartTick, mConnectTime, mFirstByteTime, mTotalTime;
+	DownloadUInt64Type mByteCount, mResumeOffset;
+
+	DownloadStatus Finish(DownloadStatus aStatus);
+	bool RangeMatches(DownloadOpenResult aResult, DownloadUInt64Type aOffset);
+
+public:
+	// Neither aTransport nor aSink is deleted by the Downloader.  aMaxBuffer is the largest chunk to read at
+	// once, which is clamped to the range DOWNLOAD_MIN_BUFFER to DOWNLOAD_MAX_BUFFER.
+	Downloader(DownloadTransport *aTransport, DownloadSink *aSink, size_t aMaxBuffer);
+	~Downloader();
+	// Sends the request and returns DOWNLOAD_MORE if Step() should be called to transfer the data.  If aResumeOffset
+	// is nonzero, the sink is assumed to already have that many bytes of the version of the resource identified
+	// by aValidator, which is an entity tag (in quotes) or an HTTP date as sent by the server.  The download is
+	// resumed only if aValidator is given, since otherwise there's no telling whether the resource has changed.
+	DownloadStatus Start(const char *aURL, DownloadUInt64Type aResumeOffset = 0, const char *aValidator = NULL);
+	DownloadStatus Step(); // Transfers one chunk.  Once the download is over, returns the same result every time.
+
+	// Timings are in milliseconds since Start() was called.  Each is zero until the corresponding event.
+	unsigned ConnectTime() {return mConnectTime;}     // When the response began (i.e. after any headers).
+	unsigned FirstByteTime() {return mFirstByteTime;} // When the first byte of the body arrived.
+	unsigned TotalTime() {return mTotalTime;}         // When the download finished or failed.
+	DownloadUInt64Type ByteCount() {return mByteCount;} // The number of bytes transferred by this download.
+	// The number of bytes that were kept from a previous download, which is less than what was passed to
+	// Start() if the transport couldn't resume from that point.
+	DownloadUInt64Type ResumeOffset() {return mResumeOffset;}
+};
+
+#endif
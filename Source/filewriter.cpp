@@ -0,0 +1,145 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "filewriter.h"
+
+
+
+static bool PathEquals(const char *aPath1, const char *aPath2)
+// Paths are compared without regard to case, as the file system does.
+{
+	for (; *aPath1 && tolower((unsigned char)*aPath1) == tolower((unsigned char)*aPath2); ++aPath1, ++aPath2);
+	return !*aPath1 && !*aPath2;
+}
+
+
+
+bool FileWriterCache::Close(int aIndex)
+// Writes out any buffered text and closes the file, removing it from the table.
+// Returns false if the text could not be written.
+{
+	Writer &writer = mWriter[aIndex];
+	if (writer.has_pending)
+		++mFlushes;
+	bool result = !fclose(writer.fp); // fclose() flushes the buffer and returns 0 on success.
+	for (--mCount; aIndex < mCount; ++aIndex) // Keep the table in the order the files were opened.
+		mWriter[aIndex] = mWriter[aIndex + 1];
+	return result;
+}
+
+
+
+int FileWriterCache::Open(const char *aFilespec, bool aOpenAsBinary)
+// Returns the index of the writer for aFilespec, opening the file if necessary, or -1 on failure.
+{
+	char full_path[FILE_WRITER_PATH_SIZE];
+	mHost.FullPath(aFilespec, full_path, sizeof(full_path));
+
+	for (int i = 0; i < mCount; ++i)
+	{
+		if (!PathEquals(mWriter[i].path, full_path))
+			continue;
+		if (mWriter[i].is_binary == aOpenAsBinary)
+			return i;
+		// Otherwise, this append's text needs the other mode, so reopen the file below.
+		Close(i);
+		break;
+	}
+	if (mCount == FILE_WRITER_MAX) // Make room by closing the one opened longest ago.
+		Close(0);
+
+	FILE *fp = fopen(full_path, aOpenAsBinary ? "ab" : "a");
+	if (!fp)
+		return -1;
+	setvbuf(fp, NULL, _IOFBF, FILE_WRITER_BUF_SIZE);
+	Writer &writer = mWriter[mCount];
+	writer.fp = fp;
+	writer.is_binary = aOpenAsBinary;
+	writer.has_pending = false;
+	strcpy(writer.path, full_path);
+	++mOpens;
+	return mCount++;
+}
+
+
+
+bool FileWriterCache::Append(const char *aFilespec, const char *aText, bool aOpenAsBinary, unsigned aMaxAge)
+{
+	int i = Open(aFilespec, aOpenAsBinary);
+	if (i < 0)
+		return false;
+	Writer &writer = mWriter[i];
+	bool result = fputs(aText, writer.fp) >= 0; // fputs() returns a non-negative value on success.
+	++mAppends;
+	mBytes += strlen(aText);
+	unsigned tick_now = mHost.TickCount();
+	if (!writer.has_pending)
+	{
+		writer.has_pending = true;
+		writer.pending_tick = tick_now;
+	}
+	if (tick_now - writer.pending_tick >= aMaxAge)
+	{
+		if (fflush(writer.fp))
+			result = false;
+		writer.has_pending = false;
+		++mFlushes;
+	}
+	return result;
+}
+
+
+
+bool FileWriterCache::FlushAll()
+{
+	bool result = true;
+	for (int i = 0; i < mCount; ++i)
+	{
+		Writer &writer = mWriter[i];
+		if (!writer.has_pending)
+			continue;
+		if (fflush(writer.fp))
+			result = false;
+		writer.has_pending = false;
+		++mFlushes;
+	}
+	return result;
+}
+
+
+
+bool FileWriterCache::CloseAll()
+{
+	bool result = true;
+	while (mCount)
+		if (!Close(mCount - 1))
+			result = false;
+	return result;
+}
+
+
+
+bool FileWriterCache::HasPending()
+{
+	for (int i = 0; i < mCount; ++i)
+		if (mWriter[i].has_pending)
+			return true;
+	return false;
+}
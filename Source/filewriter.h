@@ -0,0 +1,86 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef filewriter_h
+#define filewriter_h
+
+#include <stdio.h>
+
+// FileWriterCache keeps the files written by FileAppend open, each with a large stdio buffer, so that
+// consecutive appends are combined into a few large writes rather than each opening and closing the file.
+// Files are identified by their full path so that a change of the working directory can't cause the wrong
+// file to be written, and one that's opened in the other mode (text or binary) is reopened.  When more than
+// FILE_WRITER_MAX files are in use, the one opened longest ago is closed.
+//
+// The cache only ever writes text out when asked to or when an append finds that the oldest text it's holding
+// for a file has reached the maximum age; it's up to the program to call FlushAll() at the other times text
+// must be written (see FileBuffer in script2.cpp, which also flushes on a timer).
+//
+// Full paths and the clock are obtained through a FileWriterHost.  The program uses one based on the Windows
+// API; test/filewriter_test.cpp and test/filewriter_bench.cpp use POSIX ones.  Keep this file free of anything
+// those programs can't compile outside Windows.
+
+#define FILE_WRITER_MAX 8
+#define FILE_WRITER_BUF_SIZE (64 * 1024)
+#define FILE_WRITER_PATH_SIZE 260 // Same as MAX_PATH.
+
+class FileWriterHost
+{
+public:
+	virtual ~FileWriterHost() {}
+	// Stores in aBuf the full path of aFilespec, or aFilespec itself if it can't be resolved.
+	virtual void FullPath(const char *aFilespec, char *aBuf, size_t aBufSize) = 0;
+	virtual unsigned TickCount() = 0; // Milliseconds, wrapping around like GetTickCount().
+};
+
+class FileWriterCache
+{
+	struct Writer
+	{
+		FILE *fp;
+		bool is_binary;
+		bool has_pending; // Whether any text has been written to fp since it was last flushed.
+		unsigned pending_tick; // When the oldest such text was written.
+		char path[FILE_WRITER_PATH_SIZE];
+	};
+	FileWriterHost &mHost;
+	Writer mWriter[FILE_WRITER_MAX]; // In the order they were opened.
+	int mCount;
+	unsigned mAppends, mOpens, mFlushes;
+	double mBytes; // A double rather than an integer so that it can't overflow over a long session.
+
+	int Open(const char *aFilespec, bool aOpenAsBinary);
+	bool Close(int aIndex);
+
+public:
+	FileWriterCache(FileWriterHost &aHost) : mHost(aHost), mCount(0), mAppends(0), mOpens(0), mFlushes(0), mBytes(0) {}
+	~FileWriterCache() {CloseAll();}
+	// Appends aText to the file, opening it if necessary, then writes out the file's buffer if the oldest
+	// text in it is at least aMaxAge milliseconds old (so zero writes it out every time).  Returns false if
+	// the file couldn't be opened or written.
+	bool Append(const char *aFilespec, const char *aText, bool aOpenAsBinary, unsigned aMaxAge);
+	// The following return false if the buffered text of any of the files could not be written.
+	bool FlushAll(); // Writes out the buffered text of every file but leaves them open.
+	bool CloseAll(); // Writes out the buffered text of every file and closes them all.
+	int Count() {return mCount;} // The number of files open.
+	bool HasPending(); // Whether any file has text that hasn't been written out.
+	unsigned Appends() {return mAppends;}
+	unsigned Opens() {return mOpens;}
+	unsigned Flushes() {return mFlushes;} // Writes of buffered text, whether by flushing or closing.
+	double Bytes() {return mBytes;} // The total length of the text appended.
+};
+
+#endif
@@ -78,6 +78,7 @@ bool g_MainTimerExists = false;
 bool g_AutoExecTimerExists = false;
 bool g_InputTimerExists = false;
 bool g_DerefTimerExists = false;
+bool g_FileWriterTimerExists = false;
 bool g_SoundWasPlayed = false;
 bool g_IsSuspended = false;  // Make this separate from g_AllowInterruption since that is frequently turned off & on.
 bool g_DeferMessagesForUnderlyingPump = false;
@@ -87,6 +88,10 @@ BOOL g_NoEnv = FALSE;                    // ExpandExpression(), but didn't seem
 BOOL g_AllowInterruption = TRUE;         //
 int g_nLayersNeedingTimer = 0;
 int g_nThreads = 0;
+int g_FileWriterCount = 0; // The number of files that FileAppend is keeping open due to "FileBuffer, On".
+UINT g_PureNumericCalls = 0;     // The number of times IsPureNumeric() was called, and the number of times
+UINT g_PureNumericCacheHits = 0; // a literal's load-time classification made it unnecessary to call it.
+RandomState g_RandomMaster; // The source from which each thread's random number stream is split off.  Seeded by RESEED_RANDOM_GENERATOR.
 int g_nPausedThreads = 0;
 int g_MaxHistoryKeys = 40;
 
@@ -370,7 +375,7 @@ Action g_act[] =
 	, {"KeyWait", 1, 2, 2, NULL} // KeyName, Options
 
 	, {"Sleep", 1, 1, 1, {1, 0}} // Sleep time in ms (numeric)
-	, {"Random", 0, 3, 3, {2, 3, 0}} // Output var, Min, Max (Note: MinParams is 1 so that param2 can be blank).
+	, {"Random", 0, 4, 4, {2, 3, 4, 0}} // Output var, Min, Max, Count (Note: MinParams is 1 so that param2 can be blank).
 
 	, {"Goto", 1, 1, 1, NULL}
 	, {"Gosub", 1, 1, 1, NULL}   // Label (or dereference that resolves to a label).
@@ -426,6 +431,7 @@ Action g_act[] =
 	, {"PixelGetColor", 3, 4, 4 H, {2, 3, 0}} // OutputVar, X-coord, Y-coord [, RGB]
 	, {"PixelSearch", 0, 9, 9 H, {3, 4, 5, 6, 7, 8, 0}} // OutputX, OutputY, left, top, right, bottom, Color, Variation [, RGB]
 	, {"ImageSearch", 0, 7, 7 H, {3, 4, 5, 6, 0}} // OutputX, OutputY, left, top, right, bottom, ImageFile
+	, {"PixelCapture", 1, 5, 5, {2, 3, 4, 5, 0}} // Pin|Unpin|MaxAge, left or milliseconds, top, right, bottom
 	// NOTE FOR THE ABOVE: 0 min args so that the output vars can be optional.
 
 	// See above for why minimum is 1 vs. 2:
@@ -445,6 +451,7 @@ Action g_act[] =
 	, {"SoundBeep", 0, 2, 2, {1, 2, 0}} // Frequency, Duration.
 	, {"SoundPlay", 1, 2, 2, NULL} // Filename [, wait]
 
+	, {"FileBuffer", 1, 2, 2, {2, 0}} // On|Off|Flush, MaxAge
 	, {"FileAppend", 0, 2, 2, NULL} // text, filename (which can be omitted in a read-file loop). Update: Text can be omitted too, to create an empty file or alter the timestamp of an existing file.
 	, {"FileRead", 2, 2, 2 H, NULL} // Output variable, filename
 	, {"FileReadLine", 3, 3, 3 H, {3, 0}} // Output variable, filename, line-number
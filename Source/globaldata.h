@@ -75,6 +75,7 @@ extern bool g_MainTimerExists;
 extern bool g_AutoExecTimerExists;
 extern bool g_InputTimerExists;
 extern bool g_DerefTimerExists;
+extern bool g_FileWriterTimerExists;
 extern bool g_SoundWasPlayed;
 extern bool g_IsSuspended;
 extern BOOL g_WriteCacheDisabledInt64;
@@ -83,6 +84,10 @@ extern BOOL g_NoEnv;
 extern BOOL g_AllowInterruption;
 extern int g_nLayersNeedingTimer;
 extern int g_nThreads;
+extern int g_FileWriterCount;
+extern UINT g_PureNumericCalls;
+extern UINT g_PureNumericCacheHits;
+extern RandomState g_RandomMaster;
 extern int g_nPausedThreads;
 extern int g_MaxHistoryKeys;
 
@@ -213,7 +218,7 @@ extern bool g_KeyHistoryToFile;
 
 enum OurTimers {TIMER_ID_MAIN = MAX_MSGBOXES + 2 // The first timers in the series are used by the MessageBoxes.  Start at +2 to give an extra margin of safety.
 	, TIMER_ID_UNINTERRUPTIBLE // Obsolete but kept as a a placeholder for backward compatibility, so that this and the other the timer-ID's stay the same, and so that obsolete IDs aren't reused for new things (in case anyone is interfacing these OnMessage() or with external applications).
-	, TIMER_ID_AUTOEXEC, TIMER_ID_INPUT, TIMER_ID_DEREF, TIMER_ID_REFRESH_INTERRUPTIBILITY};
+	, TIMER_ID_AUTOEXEC, TIMER_ID_INPUT, TIMER_ID_DEREF, TIMER_ID_REFRESH_INTERRUPTIBILITY, TIMER_ID_FILE_WRITER};
 
 // MUST MAKE main timer and uninterruptible timers associated with our main window so that
 // MainWindowProc() will be able to process them when it is called by the DispatchMessage()
@@ -280,6 +285,10 @@ if (!g_InputTimerExists)\
 #define SET_DEREF_TIMER(aTimeoutValue) g_DerefTimerExists = SetTimer(g_hWnd, TIMER_ID_DEREF, aTimeoutValue, DerefTimeout);
 #define LARGE_DEREF_BUF_SIZE (4*1024*1024)
 
+#define SET_FILE_WRITER_TIMER(aTimeoutValue) \
+if (!g_FileWriterTimerExists)\
+	g_FileWriterTimerExists = SetTimer(g_hWnd, TIMER_ID_FILE_WRITER, aTimeoutValue, FileWriterTimeout);
+
 #define KILL_MAIN_TIMER \
 if (g_MainTimerExists && KillTimer(g_hWnd, TIMER_ID_MAIN))\
 	g_MainTimerExists = false;
@@ -299,4 +308,8 @@ if (g_InputTimerExists && KillTimer(g_hWnd, TIMER_ID_INPUT))\
 if (g_DerefTimerExists && KillTimer(g_hWnd, TIMER_ID_DEREF))\
 	g_DerefTimerExists = false;
 
+#define KILL_FILE_WRITER_TIMER \
+if (g_FileWriterTimerExists && KillTimer(g_hWnd, TIMER_ID_FILE_WRITER))\
+	g_FileWriterTimerExists = false;
+
 #endif
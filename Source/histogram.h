@@ -0,0 +1,142 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef histogram_h
+#define histogram_h
+
+// This file intentionally depends on nothing but the core language (no Windows headers, no CRT) so that
+// it can be compiled and exercised on any platform independently of the rest of the program.
+
+// LatencyHistogram is a log-bucketed (HDR-style) histogram of unsigned 32-bit values, such as durations
+// in microseconds.  Values below 2*HISTOGRAM_SUB_COUNT are recorded exactly.  Above that, each power of two
+// is divided into HISTOGRAM_SUB_COUNT equal-width buckets, so the relative error of any reported value is
+// at most 1/HISTOGRAM_SUB_COUNT (12.5%) regardless of magnitude.  Recording a value is a handful of
+// shifts and an increment, with no allocation, which makes it suitable for use inside the hooks.
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKET_COUNT ((32 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT) // Enough for any 32-bit value.
+
+struct LatencyHistogram
+{
+	unsigned int mBucket[HISTOGRAM_BUCKET_COUNT];
+	unsigned int mCount;
+	unsigned int mMin, mMax;
+	double mSum; // A double rather than an integer so that it can't overflow over a long session.
+
+	void Reset()
+	{
+		for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i)
+			mBucket[i] = 0;
+		mCount = 0;
+		mMin = 0xFFFFFFFF;
+		mMax = 0;
+		mSum = 0;
+	}
+
+	LatencyHistogram() {Reset();}
+
+	static int BucketOf(unsigned int aValue)
+	{
+		if (aValue < 2 * HISTOGRAM_SUB_COUNT)
+			return (int)aValue;
+		// Find the position of the highest set bit.  A binary search is used rather than an intrinsic to
+		// keep this file portable; it costs at most five comparisons.
+		int msb = 0;
+		unsigned int v = aValue;
+		if (v & 0xFFFF0000) { v >>= 16; msb += 16; }
+		if (v & 0xFF00) { v >>= 8; msb += 8; }
+		if (v & 0xF0) { v >>= 4; msb += 4; }
+		if (v & 0xC) { v >>= 2; msb += 2; }
+		if (v & 0x2) { msb += 1; }
+		int shift = msb - HISTOGRAM_SUB_BITS; // Always >= 1 due to the check at the top.
+		return (shift + 1) * HISTOGRAM_SUB_COUNT + (int)(aValue >> shift) - HISTOGRAM_SUB_COUNT;
+	}
+
+	static unsigned int BucketLowerBound(int aBucket)
+	{
+		if (aBucket < 2 * HISTOGRAM_SUB_COUNT)
+			return (unsigned int)aBucket;
+		int shift = aBucket / HISTOGRAM_SUB_COUNT - 1;
+		return (unsigned int)(aBucket % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT) << shift;
+	}
+
+	static unsigned int BucketUpperBound(int aBucket) // Inclusive.
+	{
+		return aBucket + 1 < HISTOGRAM_BUCKET_COUNT ? BucketLowerBound(aBucket + 1) - 1 : 0xFFFFFFFF;
+	}
+
+	void Record(unsigned int aValue)
+	{
+		++mBucket[BucketOf(aValue)];
+		++mCount;
+		mSum += aValue;
+		if (aValue < mMin)
+			mMin = aValue;
+		if (aValue > mMax)
+			mMax = aValue;
+	}
+
+	double Mean() const
+	{
+		return mCount ? mSum / mCount : 0;
+	}
+
+	unsigned int ValueAtPercentile(double aPercentile) const
+	// Returns the highest value that is equivalent (i.e. in the same bucket) to the value below which
+	// aPercentile percent of the recorded values fall.  The result is clamped to the range of values
+	// actually recorded so that, for example, the 100th percentile is always exactly mMax.
+	{
+		if (!mCount)
+			return 0;
+		if (aPercentile > 100)
+			aPercentile = 100;
+		double target = aPercentile * mCount / 100;
+		if (target < 1)
+			target = 1;
+		unsigned int cumulative = 0;
+		for (int i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i)
+		{
+			if (!mBucket[i])
+				continue;
+			cumulative += mBucket[i];
+			if (cumulative >= target)
+			{
+				unsigned int result = BucketUpperBound(i);
+				if (result > mMax)
+					result = mMax;
+				return result < mMin ? mMin : result;
+			}
+		}
+		return mMax; // Should be unreachable unless the counts were modified concurrently.
+	}
+
+	unsigned int CountAtOrAbove(unsigned int aValue) const
+	// Returns the number of recorded values that are at or above aValue.  This is exact only if aValue is the
+	// lower bound of a bucket (as is every value below 2*HISTOGRAM_SUB_COUNT).  Otherwise, aValue's own bucket
+	// also holds values below aValue that can't be told apart from the rest, so that entire bucket is left out:
+	// the result is rounded down rather than ever including a value below aValue.
+	{
+		int i = BucketOf(aValue);
+		if (BucketLowerBound(i) < aValue)
+			++i;
+		unsigned int count = 0;
+		for (; i < HISTOGRAM_BUCKET_COUNT; ++i)
+			count += mBucket[i];
+		return count;
+	}
+};
+
+#endif
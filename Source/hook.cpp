@@ -129,6 +129,13 @@ enum DualNumpadKeys	{PAD_DECIMAL, PAD_NUMPAD0, PAD_NUMPAD1, PAD_NUMPAD2, PAD_NUM
 , PAD_RIGHT, PAD_HOME, PAD_UP, PAD_PRIOR, PAD_TOTAL_COUNT};
 static bool sPadState[PAD_TOTAL_COUNT];  // Initialized by ChangeHookState()
 
+// The following measure how long the hooks take to process each event, broken down by the outcome of
+// the event.  They're written only by the hook thread.  The main thread reads them without synchronization
+// when displaying them, which at worst produces a report that is momentarily off by an event or two.
+static LatencyHistogram sHookLatency[HOOK_PATH_COUNT];
+static __int64 sHookQPCFrequency = 0; // Stays zero if the system lacks a high-resolution counter, which disables the measurements.
+static HookPathType sHookPath; // Reset by each hook callback, then set by SuppressThisKeyFunc() and AllowIt() only after any recursion into the hook (via KeyEvent()) has returned.
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 /*
@@ -155,11 +162,29 @@ inline bool IsIgnored(ULONG_PTR aExtraInfo)
 
 
 
+inline void RecordHookLatency(const LARGE_INTEGER &aStartTime, HookPathType aPath)
+// QueryPerformanceCounter() has more overhead than GetTickCount(), but its cost is tiny compared to that of
+// a typical event's trip through the hook, and GetTickCount()'s 10-16ms granularity is useless here.
+{
+	if (!sHookQPCFrequency)
+		return;
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	__int64 elapsed_us = (now.QuadPart - aStartTime.QuadPart) * 1000000 / sHookQPCFrequency;
+	sHookLatency[aPath].Record(elapsed_us < 0 ? 0 : (elapsed_us > UINT_MAX ? UINT_MAX : (unsigned int)elapsed_us));
+}
+
+
+
 LRESULT CALLBACK LowLevelKeybdProc(int aCode, WPARAM wParam, LPARAM lParam)
 {
 	if (aCode != HC_ACTION)  // MSDN docs specify that both LL keybd & mouse hook should return in this case.
 		return CallNextHookEx(g_KeybdHook, aCode, wParam, lParam);
 
+	LARGE_INTEGER start_time; // For RecordHookLatency().
+	QueryPerformanceCounter(&start_time);
+	sHookPath = HOOK_PATH_PASSED_THROUGH; // So that a path which sets nothing isn't attributed to the previous event's outcome.
+
 	KBDLLHOOKSTRUCT &event = *(PKBDLLHOOKSTRUCT)lParam;  // For convenience, maintainability, and possibly performance.
 
 	// Change the event to be physical if that is indicated in its dwExtraInfo attribute.
@@ -281,7 +306,9 @@ LRESULT CALLBACK LowLevelKeybdProc(int aCode, WPARAM wParam, LPARAM lParam)
 		}
 	} // if (vk == VK_LCONTROL)
 
-	return LowLevelCommon(g_KeybdHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	LRESULT result = LowLevelCommon(g_KeybdHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	RecordHookLatency(start_time, sHookPath);
+	return result;
 }
 
 
@@ -294,6 +321,10 @@ LRESULT CALLBACK LowLevelMouseProc(int aCode, WPARAM wParam, LPARAM lParam)
 	if (aCode != HC_ACTION)
 		return CallNextHookEx(g_MouseHook, aCode, wParam, lParam);
 
+	LARGE_INTEGER start_time; // For RecordHookLatency().
+	QueryPerformanceCounter(&start_time);
+	sHookPath = HOOK_PATH_PASSED_THROUGH; // See the keyboard hook above.
+
 	MSLLHOOKSTRUCT &event = *(PMSLLHOOKSTRUCT)lParam;  // For convenience, maintainability, and possibly performance.
 
 	// Make all mouse events physical to try to simulate mouse clicks in games that normally ignore
@@ -308,12 +339,17 @@ LRESULT CALLBACK LowLevelMouseProc(int aCode, WPARAM wParam, LPARAM lParam)
 		// A final concern is that some drivers might be faulty and might not generate an accurate timestamp.
 
 	if (wParam == WM_MOUSEMOVE) // Only after updating for physical input, above, is this checked.
-		return (g_BlockMouseMove && !(event.flags & LLMHF_INJECTED)) ? 1 : CallNextHookEx(g_MouseHook, aCode, wParam, lParam);
+	{
+		bool block_it = g_BlockMouseMove && !(event.flags & LLMHF_INJECTED);
+		LRESULT result = block_it ? 1 : CallNextHookEx(g_MouseHook, aCode, wParam, lParam);
+		RecordHookLatency(start_time, block_it ? HOOK_PATH_SUPPRESSED : HOOK_PATH_PASSED_THROUGH);
+		return result;
 		// Above: In v1.0.43.11, a new mode was added to block mouse movement only since it's more flexible than
 		// BlockInput (which keybd too, and blocks all mouse buttons too).  However, this mode blocks only
 		// physical mouse movement because it seems most flexible (and simplest) to allow all artificial
 		// movement, even if that movement came from a source other than an AHK script (such as some other
 		// macro program).
+	}
 
 	// MSDN: WM_LBUTTONDOWN, WM_LBUTTONUP, WM_MOUSEMOVE, WM_MOUSEWHEEL [, WM_MOUSEHWHEEL], WM_RBUTTONDOWN, or WM_RBUTTONUP.
 	// But what about the middle button?  It's undocumented, but it is received.
@@ -359,7 +395,9 @@ LRESULT CALLBACK LowLevelMouseProc(int aCode, WPARAM wParam, LPARAM lParam)
 		case WM_XBUTTONDOWN: vk = (HIWORD(event.mouseData) == XBUTTON1) ? VK_XBUTTON1 : VK_XBUTTON2; key_up = false; break;
 	}
 
-	return LowLevelCommon(g_MouseHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	LRESULT result = LowLevelCommon(g_MouseHook, aCode, wParam, lParam, vk, sc, key_up, event.dwExtraInfo, event.flags);
+	RecordHookLatency(start_time, sHookPath);
+	return result;
 }
 
 
@@ -372,6 +410,7 @@ LRESULT LowLevelCommon(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lPara
 {
 	HotkeyIDType hotkey_id_to_post = HOTKEY_ID_INVALID; // Set default.
 	bool is_ignored = IsIgnored(aExtraInfo);
+	HotCriterionNewEvent(); // Any #IfWin results memoized for a previous event are no longer valid.
 
 	// The following is done for more than just convenience.  It solves problems that would otherwise arise
 	// due to the value of a global var such as KeyHistoryNext changing due to the reentrancy of
@@ -2198,6 +2237,8 @@ LRESULT SuppressThisKeyFunc(const HHOOK aHook, LPARAM lParam, const vk_type aVK,
 		PostMessage(g_hWnd, AHK_HOOK_HOTKEY, aHotkeyIDToPost, pKeyHistoryCurr->sc); // v1.0.43.03: sc is posted currently only to support the number of wheel turns (to store in A_EventInfo).
 	if (aHSwParamToPost != HOTSTRING_INDEX_INVALID)
 		PostMessage(g_hWnd, AHK_HOTSTRING, aHSwParamToPost, aHSlParamToPost);
+	sHookPath = (aHotkeyIDToPost != HOTKEY_ID_INVALID || pKeyHistoryCurr->event_type == 'h') ? HOOK_PATH_HOTKEY
+		: (aHSwParamToPost != HOTSTRING_INDEX_INVALID ? HOOK_PATH_HOTSTRING_CHECK : HOOK_PATH_SUPPRESSED);
 	return 1;
 }
 
@@ -2211,6 +2252,7 @@ LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, cons
 {
 	WPARAM hs_wparam_to_post = HOTSTRING_INDEX_INVALID; // Set default.
 	LPARAM hs_lparam_to_post; // Not initialized because the above is the sole indicator of whether its contents should even be examined.
+	bool input_was_collected = false; // For sHookPath.
 
 	// Prevent toggleable keys from being toggled (if the user wanted that) by suppressing it.
 	// Seems best to suppress key-up events as well as key-down, since a key-up by itself,
@@ -2278,8 +2320,16 @@ LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, cons
 		if (sVKtoIgnoreNextTimeDown && sVKtoIgnoreNextTimeDown == aVK && !aKeyUp)
 			sVKtoIgnoreNextTimeDown = 0;  // i.e. this ignore-for-the-sake-of-CollectInput() ticket has now been used.
 		else if ((Hotstring::mAtLeastOneEnabled && !is_ignored) || (g_input.status == INPUT_IN_PROGRESS && !(g_input.IgnoreAHKInput && is_ignored)))
+		{
+			input_was_collected = true;
 			if (!CollectInput(event, aVK, aSC, aKeyUp, is_ignored, hs_wparam_to_post, hs_lparam_to_post)) // Key should be invisible (suppressed).
-				return SuppressThisKeyFunc(aHook, lParam, aVK, aSC, aKeyUp, pKeyHistoryCurr, aHotkeyIDToPost, hs_wparam_to_post, hs_lparam_to_post);
+			{
+				LRESULT result_to_return = SuppressThisKeyFunc(aHook, lParam, aVK, aSC, aKeyUp, pKeyHistoryCurr, aHotkeyIDToPost, hs_wparam_to_post, hs_lparam_to_post);
+				if (sHookPath == HOOK_PATH_SUPPRESSED) // It was suppressed by CollectInput(), so attribute it to that.
+					sHookPath = HOOK_PATH_HOTSTRING_CHECK;
+				return result_to_return;
+			}
+		}
 
 		// Do these here since the above "return SuppressThisKey" will have already done it in that case.
 #ifdef ENABLE_KEY_HISTORY_FILE
@@ -2432,6 +2482,8 @@ LRESULT AllowIt(const HHOOK aHook, int aCode, WPARAM wParam, LPARAM lParam, cons
 		PostMessage(g_hWnd, AHK_HOOK_HOTKEY, aHotkeyIDToPost, pKeyHistoryCurr->sc); // v1.0.43.03: sc is posted currently only to support the number of wheel turns (to store in A_EventInfo).
 	if (hs_wparam_to_post != HOTSTRING_INDEX_INVALID)
 		PostMessage(g_hWnd, AHK_HOTSTRING, hs_wparam_to_post, hs_lparam_to_post);
+	sHookPath = (aHotkeyIDToPost != HOTKEY_ID_INVALID || pKeyHistoryCurr->event_type == 'h') ? HOOK_PATH_HOTKEY
+		: (input_was_collected ? HOOK_PATH_HOTSTRING_CHECK : HOOK_PATH_PASSED_THROUGH);
 	return result_to_return;
 }
 
@@ -4044,6 +4096,9 @@ void AddRemoveHooks(HookType aHooksToBeActive, bool aChangeIsTemporary)
 		// *highly* recommend using the DLL runtime, which lets you use CreateThread() without prejudice.
 		// Confirmation from MSDN: "Another work around is to link the *executable* to the CRT in a *DLL*
 		// instead of the static CRT."
+		// UPDATE: The program is now linked to the multi-threaded runtime because the worker threads started
+		// by WorkerSync::StartThread() allocate memory.  This thread still needs none of that, so the above
+		// still applies to it.
 		//
 		// The hooks are designed to make miminmal use of C-library calls, currently calling only things
 		// like memcpy() and strlen(), which are thread safe in the single-threaded library (according to
@@ -4277,6 +4332,10 @@ DWORD WINAPI HookThreadProc(LPVOID aUnused)
 	MSG msg;
 	bool problem_activating_hooks;
 
+	LARGE_INTEGER frequency; // For RecordHookLatency().
+	if (QueryPerformanceFrequency(&frequency))
+		sHookQPCFrequency = frequency.QuadPart;
+
 	for (;;) // Infinite loop for pumping messages in this thread. This thread will exit via any use of "return" below.
 	{
 		if (GetMessage(&msg, NULL, 0, 0) == -1) // -1 is an error, 0 means WM_QUIT.
@@ -4523,6 +4582,8 @@ void GetHookStatus(char *aBuf, int aBufSize)
 		, ModifiersLRToText(g_modifiersLR_physical, LRpText)
 		, pPrefixKey ? "yes" : "no");
 
+	GetHookLatencyStatus(aBuf, aBufSize);
+
 	if (!g_KeybdHook)
 		snprintfcat(aBuf, aBufSize, "\r\n"
 			"NOTE: Only the script's own keyboard events are shown\r\n"
@@ -4564,3 +4625,43 @@ void GetHookStatus(char *aBuf, int aBufSize)
 		}
 	}
 }
+
+
+
+void GetHookLatencyStatus(char *aBuf, int aBufSize)
+// Appends a summary of how long the hooks have taken to process events, broken down by outcome.
+// Nothing is appended if the hooks haven't processed any events.
+// aBufSize is an int so that any negative values passed in from caller are not lost.
+{
+	static const char *sPathName[HOOK_PATH_COUNT] = {"Passed through", "Suppressed", "Hotstring/Input", "Hotkey"};
+	int i;
+	for (i = 0; i < HOOK_PATH_COUNT; ++i)
+		if (sHookLatency[i].mCount)
+			break;
+	if (i == HOOK_PATH_COUNT) // No events yet (or no high-resolution counter).
+		return;
+	snprintfcat(aBuf, aBufSize, "\r\nHook latency in microseconds (events: mean, median, 99th percentile, max, "
+		"and count of %u or more):\r\n", HOOK_LATENCY_WARNING_US);
+	for (i = 0; i < HOOK_PATH_COUNT; ++i)
+	{
+		LatencyHistogram &h = sHookLatency[i];
+		if (h.mCount)
+			snprintfcat(aBuf, aBufSize, "%s: %u: %0.1f, %u, %u, %u, %u\r\n", sPathName[i], h.mCount, h.Mean()
+				, h.ValueAtPercentile(50), h.ValueAtPercentile(99), h.mMax, h.CountAtOrAbove(HOOK_LATENCY_WARNING_US));
+	}
+}
+
+
+
+#ifdef REPORT_EXIT_STATS
+void ReportHookLatency()
+// Sends the hook latency summary to the debugger (or a tool such as DebugView) so that it's available
+// even for scripts that never display KeyHistory.  Caller should ensure the hooks have been removed.
+{
+	char buf[1024];
+	*buf = '\0';
+	GetHookLatencyStatus(buf, sizeof(buf));
+	if (*buf)
+		OutputDebugString(buf);
+}
+#endif
@@ -19,6 +19,7 @@ GNU General Public License for more details.
 
 #include "stdafx.h" // pre-compiled headers
 #include "hotkey.h" // Use here and also by hook.cpp for ChangeHookState(), which reads from static Hotkey class vars.
+#include "histogram.h" // For LatencyHistogram, used to measure how long the hooks take to process each event.
 
 // WM_USER is the lowest number that can be a user-defined message.  Anything above that is also valid.
 // NOTE: Any msg about WM_USER will be kept buffered (unreplied-to) whenever the script is uninterruptible.
@@ -232,6 +233,18 @@ struct KeyHistoryItem
 
 //-------------------------------------------
 
+// The final outcome of each event processed by the hooks, used to categorize the time spent in the hook
+// (see GetHookLatencyStatus()).  When more than one applies, the one listed last takes precedence; e.g. a
+// suppressed event that also fired a hotkey is counted under HOOK_PATH_HOTKEY.
+enum HookPathType {HOOK_PATH_PASSED_THROUGH, HOOK_PATH_SUPPRESSED, HOOK_PATH_HOTSTRING_CHECK, HOOK_PATH_HOTKEY
+	, HOOK_PATH_COUNT};
+
+// Events whose processing takes this long or longer are counted separately because they are approaching
+// the system's LowLevelHooksTimeout, beyond which the OS bypasses the hook (and on Windows 7 and later,
+// silently removes it).  It's about 100 ms, but is exactly the lower bound of a LatencyHistogram bucket
+// (12 << 13) so that CountAtOrAbove() counts precisely the events at or above it.
+#define HOOK_LATENCY_WARNING_US 98304
+
 
 LRESULT CALLBACK LowLevelKeybdProc(int aCode, WPARAM wParam, LPARAM lParam);
 LRESULT CALLBACK LowLevelMouseProc(int aCode, WPARAM wParam, LPARAM lParam);
@@ -268,5 +281,9 @@ HookType GetActiveHooks();
 void FreeHookMem();
 void ResetKeyTypeState(key_type &key);
 void GetHookStatus(char *aBuf, int aBufSize);
+void GetHookLatencyStatus(char *aBuf, int aBufSize);
+#ifdef REPORT_EXIT_STATS // See defines.h.
+void ReportHookLatency();
+#endif
 
 #endif
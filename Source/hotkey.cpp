@@ -16,6 +16,7 @@ GNU General Public License for more details.
 
 #include "stdafx.h" // pre-compiled headers
 #include "hotkey.h"
+#include "hotmemo.h" // For HotCriterionMemo.
 #include "globaldata.h"  // For g_os and other global vars.
 #include "window.h" // For MsgBox()
 //#include "application.h" // For ExitApp()
@@ -30,6 +31,15 @@ HotkeyIDType Hotkey::sNextID = 0;
 const HotkeyIDType &Hotkey::sHotkeyCount = Hotkey::sNextID;
 bool Hotkey::sJoystickHasHotkeys[MAX_JOYSTICKS] = {false};
 DWORD Hotkey::sJoyHotkeyCount = 0;
+HotkeyIDType Hotkey::sPrefixUser[MAX_HOTKEYS];
+int Hotkey::sPrefixUserCount = 0;
+HotkeyIDType Hotkey::sWildcard[MAX_HOTKEYS];
+int Hotkey::sWildcardCount = 0;
+
+// The results of the window searches done by the hook for the current event (see hotmemo.h).  Only the hook
+// thread uses the memo, so it needs no synchronization; the main thread always does a fresh search because
+// far more time can elapse between its checks.
+static HotCriterionMemo sHotCriterionMemo;
 
 
 
@@ -40,25 +50,45 @@ HWND HotCriterionAllowsFiring(HotCriterionType aHotCriterion, char *aWinTitle, c
 // Returns a non-NULL HWND if firing is allowed.  However, if it's a global criterion or
 // a "not-criterion" such as #IfWinNotActive, (HWND)1 is returned rather than a genuine HWND.
 {
-	HWND found_hwnd;
+	bool is_exist;
 	switch(aHotCriterion)
 	{
 	case HOT_IF_ACTIVE:
 	case HOT_IF_NOT_ACTIVE:
-		found_hwnd = WinActive(g_default, aWinTitle, aWinText, "", "", false); // Thread-safe.
+		is_exist = false;
 		break;
 	case HOT_IF_EXIST:
 	case HOT_IF_NOT_EXIST:
-		found_hwnd = WinExist(g_default, aWinTitle, aWinText, "", "", false, false); // Thread-safe.
+		is_exist = true;
 		break;
 	default: // HOT_NO_CRITERION (listed last because most callers avoids calling here by checking this value first).
 		return (HWND)1; // Always allow hotkey to fire.
 	}
+	void *found;
+	HWND found_hwnd;
+	bool use_memo = GetCurrentThreadId() == g_HookThreadID;
+	if (use_memo && sHotCriterionMemo.Find(aWinTitle, aWinText, is_exist, found))
+		found_hwnd = (HWND)found;
+	else
+	{
+		found_hwnd = is_exist ? WinExist(g_default, aWinTitle, aWinText, "", "", false, false) // Thread-safe.
+			: WinActive(g_default, aWinTitle, aWinText, "", "", false); // Thread-safe.
+		if (use_memo)
+			sHotCriterionMemo.Store(aWinTitle, aWinText, is_exist, found_hwnd);
+	}
 	return (aHotCriterion == HOT_IF_ACTIVE || aHotCriterion == HOT_IF_EXIST) ? found_hwnd : (HWND)!found_hwnd;
 }
 
 
 
+void HotCriterionNewEvent()
+// The hook calls this at the start of each event to invalidate the results memoized by HotCriterionAllowsFiring().
+{
+	sHotCriterionMemo.NewEvent();
+}
+
+
+
 ResultType SetGlobalHotTitleText(char *aWinTitle, char *aWinText)
 // Allocate memory for aWinTitle/Text (if necessary) and update g_HotWinTitle/Text to point to it.
 // Returns FAIL if memory couldn't be allocated, or OK otherwise.
@@ -394,6 +424,9 @@ void Hotkey::ManifestAllHotkeysHotstringsHooks()
 	if (g_BlockMouseMove || (g_HSResetUponMouseClick && Hotstring::mAtLeastOneEnabled))
 		sWhichHookNeeded |= HOOK_MOUSE;
 
+	// Must be done prior to activating the hook so that the hook never sees lists that are out of date:
+	CompileDispatchLists();
+
 	// Install or deinstall either or both hooks, if necessary, based on these param values.
 	ChangeHookState(shk, sHotkeyCount, sWhichHookNeeded, sWhichHookAlways);
 
@@ -479,6 +512,31 @@ void Hotkey::AllDestructAndExit(int aExitCode)
 
 
 
+void Hotkey::CompileDispatchLists()
+// Builds the subsets of hotkeys that PrefixHasNoEnabledSuffixes() and CriterionFiringIsCertain() must
+// examine.  Only attributes that are fixed for the life of each hotkey are considered here; things that can
+// change at any time, such as whether a hotkey is suspended or disabled, are still checked by those functions.
+// In a script with thousands of hotkeys, these subsets are typically tiny, which saves a scan of every
+// hotkey each time a prefix key is pressed or a criterion hotkey is found ineligible.
+{
+	int prefix_user_count = 0, wildcard_count = 0;
+	for (int i = 0; i < sHotkeyCount; ++i)
+	{
+		Hotkey &hk = *shk[i];
+		if (hk.mModifierVK || hk.mModifierSC || hk.mModifiersLR)
+			sPrefixUser[prefix_user_count++] = hk.mID;
+		if (hk.mAllowExtraModifiers && !hk.mModifierVK && !hk.mModifierSC && !hk.mHookAction)
+			sWildcard[wildcard_count++] = hk.mID;
+	}
+	// Update the counts only after the lists are complete.  Although the hook is always removed or
+	// updated afterward by our caller, this ensures that a hook that's still active sees either the
+	// old count (whose entries are still valid IDs) or the new one, never an unfilled entry.
+	sPrefixUserCount = prefix_user_count;
+	sWildcardCount = wildcard_count;
+}
+
+
+
 bool Hotkey::PrefixHasNoEnabledSuffixes(int aVKorSC, bool aIsSC)
 // aVKorSC contains the virtual key or scan code of the specified prefix key (it's a scan code if aIsSC is true).
 // Returns true if this prefix key has no suffixes that can possibly.  Each such suffix is prevented from
@@ -493,9 +551,9 @@ bool Hotkey::PrefixHasNoEnabledSuffixes(int aVKorSC, bool aIsSC)
 	// down because it is considered a prefix key for the <^c hotkey .
 	modLR_type aAsModifier = KeyToModifiersLR(aIsSC ? 0 : aVKorSC, aIsSC ? aVKorSC : 0, NULL);
 
-	for (int i = 0; i < sHotkeyCount; ++i)
+	for (int i = 0; i < sPrefixUserCount; ++i) // Only hotkeys that have a prefix or modifierLR can use this key as a prefix.
 	{
-		Hotkey &hk = *shk[i];
+		Hotkey &hk = *shk[sPrefixUser[i]];
 		if (aVKorSC != (aIsSC ? hk.mModifierSC : hk.mModifierVK) && !(aAsModifier & hk.mModifiersLR)
 			|| hk.IsCompletelyDisabled())
 			continue; // This hotkey isn't enabled or it doesn't use the specified key as a prefix.  No further checking for it.
@@ -646,16 +704,15 @@ bool Hotkey::CriterionFiringIsCertain(HotkeyIDType &aHotkeyIDwithFlags, bool aKe
 		// makes the odds vanishingly small.  That's why the following simple, high-performance loop is used
 		// rather than more a more complex one that "locates the smallest (most specific) eclipsed wildcard
 		// hotkey", or "the uppermost variant among all eclipsed wildcards that is eligible to fire".
-		for (int i = 0; i < sHotkeyCount; ++i) // This loop is undesirable; but its performance impact probably isn't measurable in the majority of cases.
+		// sWildcard contains only those hotkeys that have a wildcard and lack mModifierVK/SC and mHookAction,
+		// which avoids a scan of every hotkey:
+		for (int i = 0; i < sWildcardCount; ++i)
 		{
-			Hotkey &hk2 = *shk[i]; // For performance and convenience.
+			Hotkey &hk2 = *shk[sWildcard[i]]; // For performance and convenience.
 			if (   hk2.mVK == hk.mVK // VK and SC (one of which is typically zero) must both match for
 				&& hk2.mSC == hk.mSC // this bug to have wrongly eclipsed a qualified variant of some other hotkey.
-				&& hk2.mAllowExtraModifiers // To be eclipsable by the original hotkey, a candidate must have a wildcard.
 				&& hk2.mKeyUp == aKeyUp // Seems necessary that up/down nature is the same in both.
-				&& !hk2.mModifierVK // Avoid accidental matching of normal hotkeys with custom-combo "&"
-				&& !hk2.mModifierSC // hotkeys that happen to have the same mVK/SC.
-				&& !hk2.mHookAction // Might be unnecessary to check this; but just in case.
+				&& !hk2.mHookAction // Rechecked because the Hotkey command can change it shortly before the lists are recompiled.
 				&& hk2.mID != hotkey_id // Don't consider the original hotkey because it's was already found ineligible.
 				&& (hk.mAllowExtraModifiers // Either the original hotkey must allow extra modifiers or the candidate must not have any modifiers present on the original (otherwise the user probably isn't holding down the right keys to trigger this hotkey).
 					|| !((hk.mModifiersConsolidatedLR ^ hk2.mModifiersConsolidatedLR) & hk2.mModifiersConsolidatedLR)) // "The modifiers that are different intersected with those present on the candidate", which are those present on the candidate that are absent from this original.
@@ -60,6 +60,7 @@ enum HotkeyTypeEnum {HK_NORMAL, HK_KEYBD_HOOK, HK_MOUSE_HOOK, HK_BOTH_HOOKS, HK_
 typedef UCHAR HotCriterionType;
 enum HotCriterionEnum {HOT_NO_CRITERION, HOT_IF_ACTIVE, HOT_IF_NOT_ACTIVE, HOT_IF_EXIST, HOT_IF_NOT_EXIST}; // HOT_NO_CRITERION must be zero.
 HWND HotCriterionAllowsFiring(HotCriterionType aHotCriterion, char *aWinTitle, char *aWinText); // Used by hotkeys and hotstrings.
+void HotCriterionNewEvent();
 ResultType SetGlobalHotTitleText(char *aWinTitle, char *aWinText);
 
 
@@ -104,6 +105,15 @@ private:
 	static DWORD sTimeNow;
 	static HotkeyIDType sNextID;
 
+	// The following are compiled by ManifestAllHotkeysHotstringsHooks() so that the hook can consider only
+	// the relevant subset of hotkeys rather than scanning all of them for each event.  They're fixed-size
+	// so that the hook thread can never see them in a half-reallocated state.
+	static HotkeyIDType sPrefixUser[MAX_HOTKEYS]; // Hotkeys that have a prefix key or left/right modifier (see PrefixHasNoEnabledSuffixes()).
+	static int sPrefixUserCount;
+	static HotkeyIDType sWildcard[MAX_HOTKEYS]; // Wildcard hotkeys that can be eclipsed by others (see CriterionFiringIsCertain()).
+	static int sWildcardCount;
+	static void CompileDispatchLists();
+
 	bool Enable(HotkeyVariant &aVariant) // Returns true if the variant needed to be disabled, in which case caller should generally call ManifestAllHotkeysHotstringsHooks().
 	{
 		if (aVariant.mEnabled) // Added for v1.0.23 to greatly improve performance when hotkey is already in the right state.
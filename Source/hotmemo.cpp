@@ -0,0 +1,57 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include "hotmemo.h"
+
+void HotCriterionMemo::Clear()
+{
+	for (int i = 0; i < HOT_CRITERION_MEMO_SIZE; ++i)
+		mEntry[i].epoch = 0;
+	mEpoch = 1;
+}
+
+
+
+void HotCriterionMemo::NewEvent()
+{
+	if (!++mEpoch) // Wrapped around after 4 billion events, so an entry from long ago might look current.
+		Clear();
+}
+
+
+
+bool HotCriterionMemo::Find(const char *aWinTitle, const char *aWinText, bool aIsExist, void *&aFound)
+{
+	Entry &entry = Slot(aWinTitle, aWinText);
+	if (entry.epoch != mEpoch || entry.win_title != aWinTitle || entry.win_text != aWinText || entry.is_exist != aIsExist)
+		return false;
+	aFound = entry.found;
+	return true;
+}
+
+
+
+void HotCriterionMemo::Store(const char *aWinTitle, const char *aWinText, bool aIsExist, void *aFound)
+{
+	Entry &entry = Slot(aWinTitle, aWinText);
+	entry.win_title = aWinTitle;
+	entry.win_text = aWinText;
+	entry.is_exist = aIsExist;
+	entry.found = aFound;
+	entry.epoch = mEpoch;
+}
@@ -0,0 +1,58 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef hotmemo_h
+#define hotmemo_h
+
+// When the hook processes a single event, it often evaluates the same #IfWin criterion many times: once per
+// eligible variant in PrefixHasNoEnabledSuffixes(), again in CriterionFiringIsCertain(), and once per matching
+// hotstring.  Since window searches are by far the most expensive part of that, HotCriterionAllowsFiring()
+// keeps their results in a HotCriterionMemo for the duration of each event.  Because SetGlobalHotTitleText()
+// ensures that identical title/text pairs share the same memory, the pair of pointers identifies each
+// criterion, so no strings are compared here.  Results are not kept across events, since a window's title can
+// change while it stays in the foreground.
+//
+// The memo is a small direct-mapped table: a criterion whose slot has been taken by another since the event
+// began is simply searched for again.  test/hotkey_bench.cpp times it with 2,000 hotkeys.
+
+#define HOT_CRITERION_MEMO_SIZE 64 // Must be a power of 2.
+
+class HotCriterionMemo
+{
+	struct Entry
+	{
+		const char *win_title, *win_text;
+		void *found; // The raw result of the window search (an HWND), before any "Not" inversion.
+		unsigned epoch; // The event for which this entry is valid.
+		bool is_exist;  // WinExist rather than WinActive.
+	} mEntry[HOT_CRITERION_MEMO_SIZE];
+	unsigned mEpoch; // Never zero, so that a cleared entry never matches.
+
+	Entry &Slot(const char *aWinTitle, const char *aWinText)
+	{
+		return mEntry[(((size_t)aWinTitle ^ (size_t)aWinText) >> 2) & (HOT_CRITERION_MEMO_SIZE - 1)];
+	}
+
+public:
+	HotCriterionMemo() {Clear();}
+	void Clear();
+	void NewEvent(); // Forgets every result stored so far.
+	// Returns true and sets aFound if the result of the specified search has been stored since NewEvent().
+	bool Find(const char *aWinTitle, const char *aWinText, bool aIsExist, void *&aFound);
+	void Store(const char *aWinTitle, const char *aWinText, bool aIsExist, void *aFound);
+};
+
+#endif
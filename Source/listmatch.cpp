@@ -0,0 +1,371 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "listmatch.h"
+
+#define LIST_MATCH_MIN_SLOTS 16
+
+
+
+static inline unsigned ListMatchSlot(unsigned aHash, unsigned aSlotCount)
+{
+	aHash *= 2654435761U; // Knuth's multiplicative constant, to spread the bits before masking.
+	return (aHash ^ (aHash >> 16)) & (aSlotCount - 1);
+}
+
+
+
+static unsigned ListMatchSlotCountFor(unsigned aCount)
+// Returns the smallest power of two that's at least twice aCount, so that probe sequences stay short.
+{
+	unsigned slot_count = LIST_MATCH_MIN_SLOTS;
+	while (slot_count < aCount * 2)
+		slot_count *= 2;
+	return slot_count;
+}
+
+
+
+ListMatcher::ListMatcher()
+	: mSource(NULL), mSourceLength(0), mSourceCapacity(0), mSourceIsCaseSensitive(false)
+	, mIsCompiled(false), mCompileFailed(false), mIsContains(false), mHasEmptyItem(false)
+	, mItemText(NULL), mItemSlot(NULL), mItemSlotCount(0)
+	, mFail(NULL), mIsFinal(NULL), mFirstEdge(NULL), mEdge(NULL), mEdgeCount(0), mEdgeSlot(NULL), mEdgeSlotCount(0)
+{
+}
+
+
+
+ListMatcher::~ListMatcher()
+{
+	FreeCompiled();
+	free(mSource);
+}
+
+
+
+void ListMatcher::FreeCompiled()
+{
+	free(mItemText);
+	free(mItemSlot);
+	free(mFail);
+	free(mIsFinal);
+	free(mFirstEdge);
+	free(mEdge);
+	free(mEdgeSlot);
+	mItemText = NULL;
+	mItemSlot = NULL;
+	mFail = NULL;
+	mIsFinal = NULL;
+	mFirstEdge = NULL;
+	mEdge = NULL;
+	mEdgeSlot = NULL;
+	mItemSlotCount = mEdgeSlotCount = 0;
+	mEdgeCount = 0;
+	mIsCompiled = false;
+}
+
+
+
+bool ListMatcher::SourceEquals(const char *aList, size_t aLength, bool aCaseSensitive) const
+{
+	return mSource && aLength == mSourceLength && aCaseSensitive == mSourceIsCaseSensitive
+		&& !memcmp(aList, mSource, aLength);
+}
+
+
+
+bool ListMatcher::SetSource(const char *aList, size_t aLength, bool aCaseSensitive)
+// Makes aList (aLength chars, not counting its terminator) the list to be compiled by the next call to
+// Compile(), discarding any compiled form of the old list.  Returns false if out of memory.
+{
+	FreeCompiled();
+	mCompileFailed = false;
+	if (!mSource || mSourceCapacity <= aLength)
+	{
+		char *new_source = (char *)malloc(aLength + 1);
+		if (!new_source)
+		{
+			free(mSource);
+			mSource = NULL;
+			mSourceLength = mSourceCapacity = 0;
+			return false;
+		}
+		free(mSource);
+		mSource = new_source;
+		mSourceCapacity = aLength + 1;
+	}
+	memcpy(mSource, aList, aLength);
+	mSource[aLength] = '\0';
+	mSourceLength = aLength;
+	mSourceIsCaseSensitive = aCaseSensitive;
+	return true;
+}
+
+
+
+bool ListMatcher::Compile(bool aContains, size_t aMaxItemLength)
+// Compiles the list given to SetSource() for "contains" (aContains==true) or "in".  Returns false if the
+// list can't be compiled, in which case CompileFailed() remains true until the next SetSource().  That
+// happens when out of memory, or when an item is longer than aMaxItemLength, which callers use to defer
+// to IsStringInList() for items too long for its buffer (which it would split into more than one item).
+{
+	FreeCompiled();
+	mCompileFailed = true; // Until proven otherwise below.
+	if (!mSource)
+		return false;
+	for (int c = 0; c < 256; ++c)
+		mFold[c] = (unsigned char)(!mSourceIsCaseSensitive && c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+
+	// Parse the list into a buffer of folded, zero-terminated items.  This must stay consistent with the
+	// parsing done by IsStringInList().  Each item needs at most one more char than it consumes from the
+	// list (its terminator) and no item is empty except the first, so the below is always big enough:
+	char *items = (char *)malloc(mSourceLength + 2);
+	if (!items)
+		return false;
+	char *out = items;
+	int item_count = 0;
+	mHasEmptyItem = false;
+	for (const char *cp = mSource; *cp;) // For each item.
+	{
+		char *item = out;
+		for (; *cp; ++cp)
+		{
+			if (*cp == ',') // Either a delimiter (,) or a literal comma (,,).
+			{
+				++cp;
+				if (*cp != ',') // The end of this item.
+					break;
+			}
+			*out++ = (char)mFold[(unsigned char)*cp];
+		}
+		size_t item_length = out - item;
+		if (!item_length) // It is possible for this to be blank only for the first item.  Example: if var in ,abc
+		{
+			mHasEmptyItem = true;
+			continue;
+		}
+		if (item_length > aMaxItemLength)
+		{
+			free(items);
+			return false;
+		}
+		*out++ = '\0';
+		++item_count;
+	}
+
+	mIsContains = aContains;
+	bool success = aContains ? CompileContains(items, out - items) : CompileIn(items, out - items, item_count);
+	if (aContains) // CompileContains() doesn't need the items after building the automaton.
+		free(items);
+	else if (success) // CompileIn() has taken ownership of the items.
+		mItemText = items;
+	else
+		free(items);
+	if (!success)
+	{
+		FreeCompiled();
+		return false;
+	}
+	mIsCompiled = true;
+	mCompileFailed = false;
+	return true;
+}
+
+
+
+static inline unsigned ListMatchHashString(const char *aStr, size_t &aLength)
+// FNV-1a.  aStr must be folded already.  Also returns its length, since the caller needs it anyway.
+{
+	unsigned hash = 2166136261U;
+	const char *cp;
+	for (cp = aStr; *cp; ++cp)
+		hash = (hash ^ (unsigned char)*cp) * 16777619U;
+	aLength = cp - aStr;
+	return hash;
+}
+
+
+
+bool ListMatcher::CompileIn(const char *aItems, size_t aItemsLength, int aItemCount)
+{
+	mItemSlotCount = ListMatchSlotCountFor((unsigned)aItemCount);
+	if (   !(mItemSlot = (unsigned *)calloc(mItemSlotCount, sizeof(unsigned)))   )
+		return false;
+	size_t item_length;
+	for (const char *item = aItems; item < aItems + aItemsLength; item += item_length + 1)
+	{
+		unsigned i = ListMatchSlot(ListMatchHashString(item, item_length), mItemSlotCount);
+		unsigned u;
+		for (; (u = mItemSlot[i]) != 0; i = (i + 1) & (mItemSlotCount - 1))
+			if (!strcmp(aItems + u - 1, item))
+				break; // A duplicate, which needs no slot of its own.
+		if (!u)
+			mItemSlot[i] = (unsigned)(item - aItems) + 1;
+	}
+	return true;
+}
+
+
+
+inline int ListMatcher::Next(int aState, unsigned char aCh) const
+// Returns the state reached from aState by aCh (which must be folded already), or 0 if aState has no such
+// transition.  Since nothing transitions into the root, 0 is never a valid result except from the root.
+{
+	if (!aState)
+		return mRootNext[aCh];
+	unsigned e;
+	for (unsigned i = ListMatchSlot(((unsigned)aState << 8) | aCh, mEdgeSlotCount); (e = mEdgeSlot[i]) != 0; i = (i + 1) & (mEdgeSlotCount - 1))
+		if (mEdge[e - 1].from == aState && mEdge[e - 1].ch == aCh)
+			return mEdge[e - 1].to;
+	return 0;
+}
+
+
+
+bool ListMatcher::CompileContains(const char *aItems, size_t aItemsLength)
+{
+	memset(mRootNext, 0, sizeof(mRootNext));
+	if (mHasEmptyItem) // Every string contains the empty string, so Match() needs no automaton.
+		return true;
+	// Every char of every item adds at most one state and one edge to the trie, which gives an upper bound
+	// that avoids any need to reallocate while building it:
+	int max_states = (int)aItemsLength + 1;
+	mFail = (int *)malloc(max_states * sizeof(int));
+	mIsFinal = (unsigned char *)malloc(max_states);
+	mFirstEdge = (int *)malloc(max_states * sizeof(int));
+	mEdge = (ListMatchEdge *)malloc(max_states * sizeof(ListMatchEdge));
+	mEdgeSlotCount = ListMatchSlotCountFor((unsigned)max_states);
+	mEdgeSlot = (unsigned *)calloc(mEdgeSlotCount, sizeof(unsigned));
+	int *queue = (int *)malloc(max_states * sizeof(int));
+	if (!mFail || !mIsFinal || !mFirstEdge || !mEdge || !mEdgeSlot || !queue)
+	{
+		free(queue);
+		return false; // Caller will free the rest.
+	}
+
+	// Build the trie of the items.
+	int state_count = 1;
+	mFail[0] = 0;
+	mIsFinal[0] = 0;
+	mFirstEdge[0] = -1;
+	for (const char *cp = aItems; cp < aItems + aItemsLength; ++cp) // For each item.
+	{
+		int state = 0;
+		for (; *cp; ++cp)
+		{
+			unsigned char ch = (unsigned char)*cp;
+			int next = Next(state, ch);
+			if (!next)
+			{
+				next = state_count++;
+				mFail[next] = 0;
+				mIsFinal[next] = 0;
+				mFirstEdge[next] = -1;
+				ListMatchEdge &edge = mEdge[mEdgeCount];
+				edge.from = state;
+				edge.to = next;
+				edge.ch = ch;
+				edge.next_sibling = mFirstEdge[state];
+				mFirstEdge[state] = mEdgeCount++;
+				if (state)
+				{
+					unsigned i;
+					for (i = ListMatchSlot(((unsigned)state << 8) | ch, mEdgeSlotCount); mEdgeSlot[i]; i = (i + 1) & (mEdgeSlotCount - 1));
+					mEdgeSlot[i] = mEdgeCount; // i.e. edge index + 1.
+				}
+				else
+					mRootNext[ch] = next;
+			}
+			state = next;
+		}
+		mIsFinal[state] = 1;
+	}
+
+	// Set the failure link of each state to the state of the longest proper suffix of its path that is also
+	// a path in the trie, visiting states in breadth-first order so that every shorter path is done first.
+	int head = 0, tail = 0, e;
+	for (e = mFirstEdge[0]; e != -1; e = mEdge[e].next_sibling)
+		queue[tail++] = mEdge[e].to; // Their failure links are the root, as set above.
+	while (head < tail)
+	{
+		int state = queue[head++];
+		for (e = mFirstEdge[state]; e != -1; e = mEdge[e].next_sibling)
+		{
+			int child = mEdge[e].to;
+			unsigned char ch = mEdge[e].ch;
+			int fail = mFail[state], next;
+			for (;;)
+			{
+				if ((next = Next(fail, ch)) || !fail)
+					break;
+				fail = mFail[fail];
+			}
+			mFail[child] = next;
+			mIsFinal[child] |= mIsFinal[next]; // An item that is a suffix of this path also ends here.
+			queue[tail++] = child;
+		}
+	}
+	free(queue);
+	return true;
+}
+
+
+
+bool ListMatcher::Match(const char *aStr) const
+// Returns true if aStr is in the list ("in") or contains any of its items ("contains").  Caller must
+// ensure the list has been compiled.
+{
+	if (mIsContains)
+	{
+		if (mHasEmptyItem)
+			return true;
+		int state = 0, next;
+		for (const unsigned char *cp = (const unsigned char *)aStr; *cp; ++cp)
+		{
+			unsigned char ch = mFold[*cp];
+			for (;;)
+			{
+				if ((next = Next(state, ch)) || !state)
+					break;
+				state = mFail[state];
+			}
+			if (mIsFinal[state = next])
+				return true;
+		}
+		return false;
+	}
+	// Otherwise, it's "in".
+	if (!*aStr)
+		return mHasEmptyItem;
+	unsigned hash = 2166136261U;
+	const unsigned char *cp;
+	for (cp = (const unsigned char *)aStr; *cp; ++cp)
+		hash = (hash ^ mFold[*cp]) * 16777619U; // Same as ListMatchHashString() but folding as it goes.
+	unsigned u;
+	for (unsigned i = ListMatchSlot(hash, mItemSlotCount); (u = mItemSlot[i]) != 0; i = (i + 1) & (mItemSlotCount - 1))
+	{
+		const unsigned char *item = (const unsigned char *)mItemText + u - 1;
+		for (cp = (const unsigned char *)aStr; *item && *item == mFold[*cp]; ++item, ++cp);
+		if (!*item && !*cp)
+			return true;
+	}
+	return false;
+}
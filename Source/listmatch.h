@@ -0,0 +1,91 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef listmatch_h
+#define listmatch_h
+
+#include <stddef.h> // For size_t.
+
+// ListMatcher is a compiled form of the comma-separated list used by "if var in/contains MatchList".
+// IsStringInList() re-parses the list and compares every item on each evaluation, which costs time in
+// proportion to the size of the list.  Once compiled, "in" is a single lookup in a hash set of the items,
+// and "contains" is a single pass over the string through an Aho-Corasick automaton of the items, so the
+// cost no longer depends on the number of items.  The list syntax and the results are the same as those
+// of IsStringInList(): ",," is a literal comma and a leading comma adds the empty string to the list.
+//
+// Only case-sensitive and ASCII case-insensitive comparison (i.e. that of strcmp/stricmp and strstr/
+// strcasestr) are supported.  The caller should keep using IsStringInList() for "StringCaseSense Locale".
+//
+// Deciding when a list that comes from variables needs to be compared again is up to the caller (see
+// Line::IsInMatchList()); test/listmatch_bench.cpp measures what that saves for a long list.
+
+struct ListMatchEdge // A transition of the "contains" automaton.
+{
+	int from, to;
+	int next_sibling; // The next edge leaving the same state, or -1.
+	unsigned char ch;
+};
+
+class ListMatcher
+{
+	// The list that was compiled, or is about to be.  It's kept so that callers whose list comes from a
+	// variable can tell whether the list has changed since it was compiled.
+	char *mSource;
+	size_t mSourceLength, mSourceCapacity;
+	bool mSourceIsCaseSensitive;
+
+	bool mIsCompiled, mCompileFailed;
+	bool mIsContains; // Whether compiled for "contains" rather than "in".
+	bool mHasEmptyItem; // The list started with a comma.
+	unsigned char mFold[256]; // Maps each byte to itself, or to lowercase when case-insensitive.
+
+	// "in": The items, folded and each zero-terminated, plus an open-addressed hash table of (offset + 1)
+	// into mItemText.  Zero means an empty slot.
+	char *mItemText;
+	unsigned *mItemSlot;
+	unsigned mItemSlotCount; // A power of two, at least twice the number of items.
+
+	// "contains": State 0 is the root, whose transitions are kept in a direct table because most bytes of
+	// most strings don't begin any item.  Other transitions are found through mEdgeSlot, an open-addressed
+	// hash table of (edge index + 1) keyed by (from, ch).
+	int mRootNext[256]; // Zero means "stay at the root".
+	int *mFail;
+	unsigned char *mIsFinal; // Whether some item ends at this state (including through its failure links).
+	int *mFirstEdge;
+	ListMatchEdge *mEdge;
+	int mEdgeCount;
+	unsigned *mEdgeSlot;
+	unsigned mEdgeSlotCount;
+
+	void FreeCompiled();
+	bool CompileIn(const char *aItems, size_t aItemsLength, int aItemCount);
+	bool CompileContains(const char *aItems, size_t aItemsLength);
+	int Next(int aState, unsigned char aCh) const;
+
+public:
+	ListMatcher();
+	~ListMatcher();
+	bool SourceEquals(const char *aList, size_t aLength, bool aCaseSensitive) const;
+	bool SetSource(const char *aList, size_t aLength, bool aCaseSensitive);
+	bool IsCaseSensitive() const {return mSourceIsCaseSensitive;}
+	bool IsCompiled() const {return mIsCompiled;}
+	bool CompileFailed() const {return mCompileFailed;}
+	bool Compile(bool aContains, size_t aMaxItemLength);
+	bool Match(const char *aStr) const;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "lvsort.h"
+
+
+static bool RadixSortIndex(int *aIndex, int aCount, SortUInt64Type *aKey)
+// Sorts aIndex by aKey (both indexed by position rather than row, and both reordered together) in ascending
+// unsigned order.  This is a least-significant-digit radix sort with 8-bit digits, which is stable.  Digits
+// that are the same for every key (such as the high-order bytes when all the numbers are small) are skipped.
+{
+	SortUInt64Type *temp_key = (SortUInt64Type *)malloc(aCount * sizeof(SortUInt64Type));
+	int *temp_index = (int *)malloc(aCount * sizeof(int));
+	if (!temp_key || !temp_index)
+	{
+		free(temp_key);
+		free(temp_index);
+		return false;
+	}
+	int *index = aIndex;
+	SortUInt64Type *key = aKey;
+	int count[256], i;
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		memset(count, 0, sizeof(count));
+		for (i = 0; i < aCount; ++i)
+			++count[(key[i] >> shift) & 0xFF];
+		if (count[(key[0] >> shift) & 0xFF] == aCount) // Every key has the same digit here, so this pass would change nothing.
+			continue;
+		int total = 0;
+		for (i = 0; i < 256; ++i) // Convert the counts into starting positions.
+		{
+			int c = count[i];
+			count[i] = total;
+			total += c;
+		}
+		for (i = 0; i < aCount; ++i)
+		{
+			int pos = count[(key[i] >> shift) & 0xFF]++;
+			temp_key[pos] = key[i];
+			temp_index[pos] = index[i];
+		}
+		// Swap the roles of the arrays rather than copying:
+		SortUInt64Type *swap_key = key;
+		key = temp_key;
+		temp_key = swap_key;
+		int *swap_index = index;
+		index = temp_index;
+		temp_index = swap_index;
+	}
+	if (index != aIndex) // An odd number of passes was done, so the result is in what was originally the temp array.
+	{
+		memcpy(aIndex, index, aCount * sizeof(int));
+		temp_index = index; // So that the right one is freed below.
+		temp_key = key;
+	}
+	free(temp_key);
+	free(temp_index);
+	return true;
+}
+
+
+
+bool SortIndexByInt64(int *aIndex, int aCount, const SortInt64Type *aKey, bool aAscending)
+{
+	if (aCount < 2)
+		return true;
+	SortUInt64Type *key = (SortUInt64Type *)malloc(aCount * sizeof(SortUInt64Type));
+	if (!key)
+		return false;
+	// Flipping the sign bit makes the unsigned order of the keys the same as the signed order of the numbers.
+	// For descending order, all bits are inverted, which reverses the order while keeping the sort stable.
+	SortUInt64Type flip = aAscending ? ((SortUInt64Type)1 << 63) : ~((SortUInt64Type)1 << 63);
+	for (int i = 0; i < aCount; ++i)
+		key[i] = (SortUInt64Type)aKey[aIndex[i]] ^ flip;
+	bool result = RadixSortIndex(aIndex, aCount, key);
+	free(key);
+	return result;
+}
+
+
+
+bool SortIndexByDouble(int *aIndex, int aCount, const double *aKey, bool aAscending)
+{
+	if (aCount < 2)
+		return true;
+	SortUInt64Type *key = (SortUInt64Type *)malloc(aCount * sizeof(SortUInt64Type));
+	if (!key)
+		return false;
+	for (int i = 0; i < aCount; ++i)
+	{
+		double d = aKey[aIndex[i]];
+		if (d == 0) // Treat -0.0 the same as 0.0, as a comparison would.
+			d = 0;
+		SortUInt64Type bits;
+		memcpy(&bits, &d, sizeof(bits));
+		// For IEEE doubles, inverting all the bits of a negative number and only the sign bit of a
+		// positive number yields integers whose unsigned order is the same as the numbers' order.
+		bits = (bits >> 63) ? ~bits : (bits | ((SortUInt64Type)1 << 63));
+		key[i] = aAscending ? bits : ~bits;
+	}
+	bool result = RadixSortIndex(aIndex, aCount, key);
+	free(key);
+	return result;
+}
+
+
+
+bool SortIndexByKey(int *aIndex, int aCount, const void **aKey, SortKeyCompareType aCompare, void *aParam
+	, bool aAscending)
+// Bottom-up merge sort.  Unlike qsort(), it's stable and lets the comparison function be given a parameter
+// without resorting to global variables.
+{
+	if (aCount < 2)
+		return true;
+	int *temp = (int *)malloc(aCount * sizeof(int));
+	if (!temp)
+		return false;
+	int *index = aIndex, *dest = temp;
+	for (int width = 1; width < aCount; width *= 2)
+	{
+		for (int left = 0; left < aCount; left += 2 * width)
+		{
+			int mid = left + width, right = left + 2 * width;
+			if (mid > aCount)
+				mid = aCount;
+			if (right > aCount)
+				right = aCount;
+			int a = left, b = mid;
+			for (int i = left; i < right; ++i)
+			{
+				if (a < mid && b < right)
+				{
+					int result = aCompare(aKey[index[a]], aKey[index[b]], aParam);
+					if (!aAscending)
+						result = -result;
+					dest[i] = (result <= 0) ? index[a++] : index[b++]; // <= keeps it stable.
+				}
+				else
+					dest[i] = (a < mid) ? index[a++] : index[b++];
+			}
+		}
+		int *swap = index;
+		index = dest;
+		dest = swap;
+	}
+	if (index != aIndex)
+		memcpy(aIndex, index, aCount * sizeof(int));
+	free(temp);
+	return true;
+}
@@ -0,0 +1,51 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef lvsort_h
+#define lvsort_h
+
+// These functions sort an array of row indices by keys that the caller has extracted from each row in
+// advance.  This is much faster than having the sort fetch and convert a row's text every time it compares
+// two rows, especially for a control such as a ListView where each fetch is a message.  Each function
+// reorders aIndex (an array of aCount row numbers, usually 0 through aCount-1) so that the rows are in order
+// of their keys, where aKey[row] is the key of that row.  All of them are stable (rows with equal keys keep
+// their relative order), even when sorting in descending order.  They return false if they can't allocate
+// their temporary memory, in which case aIndex is unchanged.
+//
+// Numeric keys are sorted by radix sort, whose time is proportional to the number of rows, without any
+// comparisons.  Text keys are sorted by merge sort via a caller-supplied comparison function, which lets the
+// caller prepare the keys in whatever form is cheapest to compare (e.g. pre-folded to lowercase).
+//
+// Nothing here knows about ListViews: the caller extracts the keys and applies the resulting order, so the
+// sorts can be checked against qsort() on plain arrays (see test/lvsort_test.cpp).
+
+#ifdef _MSC_VER
+typedef __int64 SortInt64Type;
+typedef unsigned __int64 SortUInt64Type;
+#else
+typedef long long SortInt64Type;
+typedef unsigned long long SortUInt64Type;
+#endif
+
+// Returns a negative, zero or positive value to indicate how aKey1 should be ordered relative to aKey2.
+typedef int (*SortKeyCompareType)(const void *aKey1, const void *aKey2, void *aParam);
+
+bool SortIndexByInt64(int *aIndex, int aCount, const SortInt64Type *aKey, bool aAscending);
+bool SortIndexByDouble(int *aIndex, int aCount, const double *aKey, bool aAscending);
+bool SortIndexByKey(int *aIndex, int aCount, const void **aKey, SortKeyCompareType aCompare, void *aParam
+	, bool aAscending);
+
+#endif
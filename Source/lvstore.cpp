@@ -0,0 +1,339 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lvstore.h"
+
+
+ListViewStore::ListViewStore()
+	: mColumn(NULL), mColumnCount(0), mRowCount(0), mRowCapacity(0)
+	, mView(NULL), mViewCount(0), mViewCapacity(0), mFilterColumn(0), mFilterText(NULL)
+{
+}
+
+
+
+ListViewStore::~ListViewStore()
+{
+	DeleteAll();
+	for (int c = 0; c < mColumnCount; ++c)
+		free(mColumn[c]);
+	free(mColumn);
+}
+
+
+
+bool ListViewStore::Reserve(int aRowCount)
+// Ensures there is room for aRowCount rows without further reallocation.  Returns false if out of memory.
+{
+	if (aRowCount <= mRowCapacity)
+		return true;
+	for (int c = 0; c < mColumnCount; ++c)
+	{
+		char **new_column = (char **)realloc(mColumn[c], aRowCount * sizeof(char *));
+		if (!new_column)
+			return false; // Columns already enlarged are left that way, which is harmless.
+		mColumn[c] = new_column;
+	}
+	mRowCapacity = aRowCount;
+	return true;
+}
+
+
+
+bool ListViewStore::ReserveColumns(int aCount)
+// Ensures that at least aCount columns exist, creating any that don't as blank.
+{
+	if (aCount <= mColumnCount)
+		return true;
+	char ***new_columns = (char ***)realloc(mColumn, aCount * sizeof(char **));
+	if (!new_columns)
+		return false;
+	mColumn = new_columns;
+	for (; mColumnCount < aCount; ++mColumnCount)
+		if (   !(mColumn[mColumnCount] = (char **)calloc(mRowCapacity ? mRowCapacity : 1, sizeof(char *)))   )
+			return false;
+	return true;
+}
+
+
+
+bool ListViewStore::ReserveView(int aCount)
+{
+	if (aCount <= mViewCapacity)
+		return true;
+	int new_capacity = mViewCapacity ? mViewCapacity : 64;
+	while (new_capacity < aCount)
+		new_capacity *= 2;
+	int *new_view = (int *)realloc(mView, new_capacity * sizeof(int));
+	if (!new_view)
+		return false;
+	mView = new_view;
+	mViewCapacity = new_capacity;
+	return true;
+}
+
+
+
+int ListViewStore::Insert(int aRow)
+// Inserts a blank row so that it is displayed at position aRow, or appends it if aRow is beyond the end.
+// Returns the row's display index, or -1 if out of memory.
+{
+	int display_count = Count();
+	if (aRow < 0 || aRow > display_count)
+		aRow = display_count;
+	if (mRowCount == mRowCapacity && !Reserve(mRowCapacity ? mRowCapacity * 2 : 64))
+		return -1;
+	if (mView && !ReserveView(mViewCount + 1))
+		return -1;
+
+	// The new row goes into storage just before the row currently displayed at aRow.  When a filter is in
+	// effect, it's displayed regardless of whether it passes the filter, since its text hasn't been set yet.
+	int storage_index = aRow < display_count ? StorageIndex(aRow) : mRowCount;
+	for (int c = 0; c < mColumnCount; ++c)
+	{
+		memmove(mColumn[c] + storage_index + 1, mColumn[c] + storage_index, (mRowCount - storage_index) * sizeof(char *));
+		mColumn[c][storage_index] = NULL;
+	}
+	++mRowCount;
+	if (mView)
+	{
+		for (int i = 0; i < mViewCount; ++i)
+			if (mView[i] >= storage_index)
+				++mView[i];
+		memmove(mView + aRow + 1, mView + aRow, (mViewCount - aRow) * sizeof(int));
+		mView[aRow] = storage_index;
+		++mViewCount;
+	}
+	return aRow;
+}
+
+
+
+bool ListViewStore::Delete(int aRow)
+{
+	if (aRow < 0 || aRow >= Count())
+		return false;
+	int storage_index = StorageIndex(aRow);
+	for (int c = 0; c < mColumnCount; ++c)
+	{
+		free(mColumn[c][storage_index]);
+		memmove(mColumn[c] + storage_index, mColumn[c] + storage_index + 1, (mRowCount - storage_index - 1) * sizeof(char *));
+	}
+	--mRowCount;
+	if (mView)
+	{
+		memmove(mView + aRow, mView + aRow + 1, (mViewCount - aRow - 1) * sizeof(int));
+		--mViewCount;
+		for (int i = 0; i < mViewCount; ++i)
+			if (mView[i] > storage_index)
+				--mView[i];
+	}
+	return true;
+}
+
+
+
+void ListViewStore::DeleteAll()
+// Deletes all rows (even those hidden by a filter) and removes any filter.
+{
+	for (int c = 0; c < mColumnCount; ++c)
+		for (int r = 0; r < mRowCount; ++r)
+			free(mColumn[c][r]);
+	mRowCount = 0;
+	SetFilter(0, NULL);
+}
+
+
+
+const char *ListViewStore::GetText(int aRow, int aColumn)
+// Returns the text of the specified cell, or NULL if the row doesn't exist.  A blank cell or one in a
+// column that has never been given any text yields "".
+{
+	if (aRow < 0 || aRow >= Count() || aColumn < 0)
+		return NULL;
+	if (aColumn >= mColumnCount)
+		return "";
+	char *text = mColumn[aColumn][StorageIndex(aRow)];
+	return text ? text : "";
+}
+
+
+
+bool ListViewStore::SetText(int aRow, int aColumn, const char *aText)
+{
+	if (aRow < 0 || aRow >= Count() || aColumn < 0 || !ReserveColumns(aColumn + 1))
+		return false;
+	char *&cell = mColumn[aColumn][StorageIndex(aRow)];
+	char *new_text = NULL;
+	if (*aText)
+	{
+		size_t size = strlen(aText) + 1;
+		if (   !(new_text = (char *)malloc(size))   )
+			return false; // Leave the old text in place.
+		memcpy(new_text, aText, size);
+	}
+	free(cell);
+	cell = new_text;
+	return true;
+}
+
+
+
+bool ListViewStore::InsertColumn(int aColumn)
+// Shifts the columns at and to the right of aColumn to the right, leaving aColumn blank.  This mirrors what
+// happens to a ListView's subitems when a column is inserted.
+{
+	if (aColumn < 0)
+		return false;
+	if (aColumn < mColumnCount) // Otherwise, there's nothing to shift; the column will be created if and when text is put into it.
+	{
+		if (!ReserveColumns(mColumnCount + 1)) // Creates a blank column at the end.
+			return false;
+		char **blank_column = mColumn[mColumnCount - 1];
+		memmove(mColumn + aColumn + 1, mColumn + aColumn, (mColumnCount - aColumn - 1) * sizeof(char **));
+		mColumn[aColumn] = blank_column;
+	}
+	if (mFilterText && mFilterColumn >= aColumn) // Even a column that doesn't exist yet is shifted.
+		++mFilterColumn;
+	return true;
+}
+
+
+
+void ListViewStore::DeleteColumn(int aColumn)
+{
+	if (aColumn < 0)
+		return;
+	if (aColumn < mColumnCount) // Otherwise, the column is entirely blank and doesn't exist yet.
+	{
+		for (int r = 0; r < mRowCount; ++r)
+			free(mColumn[aColumn][r]);
+		free(mColumn[aColumn]);
+		--mColumnCount;
+		memmove(mColumn + aColumn, mColumn + aColumn + 1, (mColumnCount - aColumn) * sizeof(char **));
+	}
+	if (mFilterText) // As with InsertColumn(), this is done even if the column didn't exist.
+	{
+		if (mFilterColumn == aColumn) // The rows were filtered by a column that no longer exists.
+			SetFilter(0, NULL);
+		else if (mFilterColumn > aColumn)
+			--mFilterColumn;
+	}
+}
+
+
+
+const char *ListViewStore::GetStoredText(int aStorageRow, int aColumn)
+// Same as GetText() except that aStorageRow is a row's position in storage rather than on the display.
+{
+	if (aStorageRow < 0 || aStorageRow >= mRowCount || aColumn < 0)
+		return NULL;
+	if (aColumn >= mColumnCount)
+		return "";
+	char *text = mColumn[aColumn][aStorageRow];
+	return text ? text : "";
+}
+
+
+
+bool ListViewStore::Reorder(const int *aOrder)
+// Rearranges all rows (including any hidden by a filter) so that the row formerly in storage position
+// aOrder[i] is moved to position i.  aOrder must contain each storage position exactly once.
+// Returns false if out of memory, in which case the order is unchanged.
+{
+	if (mRowCount < 2)
+	{
+		if (mView) // For consistency with the below.
+			ApplyFilter();
+		return true;
+	}
+	char **temp_column = (char **)malloc(mRowCount * sizeof(char *));
+	if (!temp_column)
+		return false;
+	for (int c = 0; c < mColumnCount; ++c)
+	{
+		char **column = mColumn[c];
+		for (int r = 0; r < mRowCount; ++r)
+			temp_column[r] = column[aOrder[r]];
+		memcpy(column, temp_column, mRowCount * sizeof(char *));
+	}
+	free(temp_column);
+	if (mView) // The displayed rows must be found anew because their storage positions have changed.
+		ApplyFilter();
+	return true;
+}
+
+
+
+static bool StrContainsNoCase(const char *aText, const char *aFind)
+{
+	for (; *aText; ++aText)
+	{
+		const char *t = aText, *f = aFind;
+		for (; *f && tolower((unsigned char)*t) == tolower((unsigned char)*f); ++t, ++f);
+		if (!*f)
+			return true;
+	}
+	return !*aFind;
+}
+
+
+
+void ListViewStore::ApplyFilter()
+// Rebuilds the list of displayed rows from the current filter.
+{
+	mViewCount = 0;
+	if (!ReserveView(mRowCount ? mRowCount : 1)) // At least 1 so that mView is non-NULL, which is what indicates a filter is in effect.
+	{
+		SetFilter(0, NULL); // Out of memory, so display all rows rather than an incomplete set.
+		return;
+	}
+	char **text = mFilterColumn < mColumnCount ? mColumn[mFilterColumn] : NULL;
+	for (int r = 0; r < mRowCount; ++r)
+		if (text && text[r] && StrContainsNoCase(text[r], mFilterText))
+			mView[mViewCount++] = r;
+}
+
+
+
+bool ListViewStore::SetFilter(int aColumn, const char *aText)
+// Causes only those rows whose aColumn contains aText (case-insensitive) to be displayed.  If aText is NULL
+// or blank, all rows are displayed.  Returns false if out of memory, in which case all rows are displayed.
+{
+	free(mFilterText);
+	mFilterText = NULL;
+	if (!aText || !*aText || aColumn < 0)
+	{
+		free(mView);
+		mView = NULL;
+		mViewCount = mViewCapacity = 0;
+		return true;
+	}
+	size_t size = strlen(aText) + 1;
+	if (   !(mFilterText = (char *)malloc(size))   )
+	{
+		SetFilter(0, NULL);
+		return false;
+	}
+	memcpy(mFilterText, aText, size);
+	mFilterColumn = aColumn;
+	ApplyFilter();
+	return mFilterText != NULL; // ApplyFilter() removes the filter if it runs out of memory.
+}
@@ -0,0 +1,70 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef lvstore_h
+#define lvstore_h
+
+// ListViewStore holds the rows of a virtual (LVS_OWNERDATA) ListView.  Such a control stores no text of its
+// own; instead, it asks its parent for the text of each cell as it paints it (LVN_GETDISPINFO), so the text
+// exists only once (here) no matter how many rows there are, and adding a row costs no more than storing
+// its text.  The rows are kept by column: each column is an array of string pointers indexed by row, which
+// makes sorting by a column a matter of permuting pointers.  Blank cells are NULL to avoid allocating
+// anything for them.
+//
+// Row indices passed to and returned by the methods are those of the rows as displayed.  They are the same
+// as the storage order unless a filter is in effect, in which case only the rows that contained the filter
+// text at the time the filter was last applied (or that have been inserted since then) are displayed.  The
+// filter is applied when it is set and again after each Reorder() (i.e. sort).
+//
+// The store knows nothing about the control it serves: the GUI code translates notifications into calls
+// of the methods below and applies the results with LVM_SETITEMCOUNT.  It uses only the C runtime, which is
+// why test/lvstore_test.cpp can check it against a simple model of the rows on any platform.
+
+class ListViewStore
+{
+	char ***mColumn; // mColumn[c][r] is the text of column c of row r (in storage order), or NULL if blank.
+	int mColumnCount;
+	int mRowCount, mRowCapacity;
+	int *mView; // The storage index of each displayed row while a filter is in effect; otherwise NULL.
+	int mViewCount, mViewCapacity;
+	int mFilterColumn;
+	char *mFilterText;
+
+	bool ReserveColumns(int aCount);
+	bool ReserveView(int aCount);
+	void ApplyFilter();
+	int StorageIndex(int aRow) {return mView ? mView[aRow] : aRow;}
+
+public:
+	ListViewStore();
+	~ListViewStore();
+	int Count() {return mView ? mViewCount : mRowCount;}
+	bool Reserve(int aRowCount);
+	int Insert(int aRow);
+	bool Delete(int aRow);
+	void DeleteAll();
+	const char *GetText(int aRow, int aColumn);
+	bool SetText(int aRow, int aColumn, const char *aText);
+	bool InsertColumn(int aColumn);
+	void DeleteColumn(int aColumn);
+	// Sorting is done by the caller (see lvsort.h), which accesses the rows in storage order via these:
+	int TotalCount() {return mRowCount;} // Includes any rows hidden by a filter.
+	const char *GetStoredText(int aStorageRow, int aColumn);
+	bool Reorder(const int *aOrder);
+	bool SetFilter(int aColumn, const char *aText);
+};
+
+#endif
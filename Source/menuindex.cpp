@@ -0,0 +1,154 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include "menuindex.h"
+
+bool MenuNameIndex::Hash(const char *aName, unsigned &aHash)
+// Returns true if aName consists only of printable ASCII characters, in which case aHash is set to a
+// case-insensitive hash of it.  See the top of menuindex.h for why other names aren't hashed.
+{
+	unsigned hash = 2166136261U; // FNV-1a.
+	for (const unsigned char *cp = (const unsigned char *)aName; *cp; ++cp)
+	{
+		if (*cp < ' ' || *cp > '~')
+			return false;
+		hash ^= (*cp >= 'A' && *cp <= 'Z') ? *cp + ('a' - 'A') : *cp;
+		hash *= 16777619U;
+	}
+	aHash = hash;
+	return true;
+}
+
+
+
+bool MenuNameIndex::Create()
+{
+	Free();
+	if (   !(mSlot = (Slot *)calloc(MENU_NAME_INDEX_MIN_ITEMS * 2, sizeof(Slot)))   )
+		return false;
+	mSlotCount = MENU_NAME_INDEX_MIN_ITEMS * 2;
+	return true;
+}
+
+
+
+void MenuNameIndex::Free()
+{
+	free(mSlot);
+	mSlot = NULL;
+	mSlotCount = mCount = mUnhashableCount = 0;
+}
+
+
+
+void MenuNameIndex::Insert(UserMenuItem *aItem, unsigned aHash)
+// Caller has ensured that there's an empty slot.
+{
+	unsigned mask = mSlotCount - 1, i;
+	for (i = aHash & mask; mSlot[i].item; i = (i + 1) & mask);
+	mSlot[i].item = aItem;
+	mSlot[i].hash = aHash;
+	++mCount;
+}
+
+
+
+bool MenuNameIndex::Grow()
+// Doubles the number of slots.  Returns false if out of memory, in which case the index is unchanged.
+{
+	Slot *old_slot = mSlot;
+	unsigned old_slot_count = mSlotCount;
+	if (   !(mSlot = (Slot *)calloc(old_slot_count * 2, sizeof(Slot)))   )
+	{
+		mSlot = old_slot;
+		return false;
+	}
+	mSlotCount = old_slot_count * 2;
+	mCount = 0;
+	for (unsigned i = 0; i < old_slot_count; ++i)
+		if (old_slot[i].item)
+			Insert(old_slot[i].item, old_slot[i].hash);
+	free(old_slot);
+	return true;
+}
+
+
+
+void MenuNameIndex::Add(UserMenuItem *aItem, const char *aName)
+{
+	if (!mSlot)
+		return;
+	unsigned hash;
+	if (!Hash(aName, hash))
+	{
+		++mUnhashableCount;
+		return;
+	}
+	if ((mCount + 1) * 2 > mSlotCount && !Grow())
+	{
+		Free();
+		return;
+	}
+	Insert(aItem, hash);
+}
+
+
+
+void MenuNameIndex::Remove(UserMenuItem *aItem, const char *aName)
+{
+	if (!mSlot)
+		return;
+	unsigned hash;
+	if (!Hash(aName, hash))
+	{
+		--mUnhashableCount;
+		return;
+	}
+	unsigned mask = mSlotCount - 1, i;
+	for (i = hash & mask; mSlot[i].item != aItem; i = (i + 1) & mask)
+		if (!mSlot[i].item) // Not found, which shouldn't happen.
+			return;
+	// Fill the hole by moving back any item further along the run that is allowed to be in it (i.e. whose
+	// own position is not between the hole and where the item is now), so that no search stops short.
+	for (unsigned j = (i + 1) & mask; mSlot[j].item; j = (j + 1) & mask)
+		if (((j - (mSlot[j].hash & mask)) & mask) >= ((j - i) & mask))
+		{
+			mSlot[i] = mSlot[j];
+			i = j;
+		}
+	mSlot[i].item = NULL;
+	--mCount;
+}
+
+
+
+bool MenuNameIndex::Find(const char *aName, MenuNameMatchType aMatch, UserMenuItem *&aItem) const
+{
+	unsigned hash;
+	if (!mSlot || mUnhashableCount || !Hash(aName, hash))
+		return false;
+	unsigned mask = mSlotCount - 1;
+	for (unsigned i = hash & mask; mSlot[i].item; i = (i + 1) & mask)
+		if (mSlot[i].hash == hash && aMatch(mSlot[i].item, aName))
+		{
+			aItem = mSlot[i].item;
+			return true;
+		}
+	aItem = NULL;
+	return true;
+}
@@ -0,0 +1,71 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef menuindex_h
+#define menuindex_h
+
+// MenuNameIndex finds a menu's item by name without comparing the name to every item's.  It's an open-addressed
+// hash table (linear probing) of item pointers keyed by a case-insensitive hash of each item's name.
+//
+// Script compares menu item names with lstrcmpi(), which depends on locale: it might ignore certain characters
+// or consider a ligature equal to the letters it stands for.  Two names of printable ASCII characters are
+// equal to it only if they differ at most in case, so only such names are hashed.  While the menu has any item
+// with some other name, Find() declines and the caller searches the menu's list as it always did.
+//
+// Items are opaque here and names are compared by a function the caller passes, which lets
+// test/menuindex_bench.cpp time the index against a search of the list with thousands of items.
+
+class UserMenuItem; // Only pointers to items are stored.
+
+typedef bool (*MenuNameMatchType)(UserMenuItem *aItem, const char *aName);
+
+#define MENU_NAME_INDEX_MIN_ITEMS 32 // Shorter menus are quicker to search than to index.
+
+class MenuNameIndex
+{
+	struct Slot
+	{
+		UserMenuItem *item; // NULL if the slot is empty.
+		unsigned hash;
+	};
+	Slot *mSlot;
+	unsigned mSlotCount; // Zero or a power of two, at least twice mCount.
+	unsigned mCount, mUnhashableCount; // The items in mSlot and the items whose names can't be hashed.
+
+	void Insert(UserMenuItem *aItem, unsigned aHash);
+	bool Grow();
+
+public:
+	MenuNameIndex() : mSlot(NULL), mSlotCount(0), mCount(0), mUnhashableCount(0) {}
+	~MenuNameIndex() {Free();}
+	static bool Hash(const char *aName, unsigned &aHash);
+	// Creates an empty index, replacing any existing one.  Until it's created, Add() and Remove() do nothing
+	// and Find() always declines, so the caller must Add() every item after creating it.  Returns false if
+	// out of memory.
+	bool Create();
+	void Free();
+	bool IsCreated() const {return mSlot != NULL;}
+	// aName must be aItem's current name, which mustn't be empty.  If the index can't grow to make room for the
+	// item, the whole index is freed (since it would no longer be complete) and can be created again later.
+	void Add(UserMenuItem *aItem, const char *aName);
+	void Remove(UserMenuItem *aItem, const char *aName); // aName must be the name aItem was added with.
+	// Returns false if the index can't answer (see above), in which case the caller must search the list.
+	// Otherwise, aItem is set to the item for which aMatch returns true, or NULL if there isn't one.
+	bool Find(const char *aName, MenuNameMatchType aMatch, UserMenuItem *&aItem) const;
+	size_t MemoryUsed() const {return mSlotCount * sizeof(Slot);}
+};
+
+#endif
@@ -0,0 +1,232 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <string.h>
+#include "numconv.h"
+
+
+// Each pair of chars is the two-digit decimal representation of its index (00 through 99), which allows
+// two digits to be produced per division rather than one.
+static const char sDigitPairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+// Powers of ten that are exactly representable as doubles.
+static const double sPowerOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11
+	, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+#define NUM_EXACT_POWER_OF_10_MAX 22
+
+
+
+static char *WriteDecimalBackward(NumUInt64Type aValue, char *aEnd)
+// Writes the digits of aValue so that the last one is at aEnd-1, and returns the position of the first.
+{
+	char *cp = aEnd;
+	// Use 32-bit math once the value is small enough, since 64-bit division is much slower on 32-bit CPUs.
+	while (aValue > 0xFFFFFFFF)
+	{
+		unsigned int pair = (unsigned int)(aValue % 100);
+		aValue /= 100;
+		*--cp = sDigitPairs[pair * 2 + 1];
+		*--cp = sDigitPairs[pair * 2];
+	}
+	unsigned int value = (unsigned int)aValue;
+	while (value >= 100)
+	{
+		unsigned int pair = value % 100;
+		value /= 100;
+		*--cp = sDigitPairs[pair * 2 + 1];
+		*--cp = sDigitPairs[pair * 2];
+	}
+	if (value >= 10)
+	{
+		*--cp = sDigitPairs[value * 2 + 1];
+		*--cp = sDigitPairs[value * 2];
+	}
+	else
+		*--cp = (char)('0' + value);
+	return cp;
+}
+
+
+
+char *UInt64ToDecimal(NumUInt64Type aValue, char *aBuf)
+{
+	char temp[24];
+	char *start = WriteDecimalBackward(aValue, temp + sizeof(temp));
+	size_t length = temp + sizeof(temp) - start;
+	memcpy(aBuf, start, length);
+	aBuf[length] = '\0';
+	return aBuf;
+}
+
+
+
+char *Int64ToDecimal(NumInt64Type aValue, char *aBuf)
+{
+	if (aValue < 0)
+	{
+		*aBuf = '-';
+		// Negate as unsigned so that the most negative value is handled correctly:
+		UInt64ToDecimal(0 - (NumUInt64Type)aValue, aBuf + 1);
+		return aBuf;
+	}
+	return UInt64ToDecimal((NumUInt64Type)aValue, aBuf);
+}
+
+
+
+char *UInt64ToHex(NumUInt64Type aValue, char *aBuf)
+{
+	char temp[16];
+	char *cp = temp + sizeof(temp);
+	do
+	{
+		*--cp = "0123456789abcdef"[(unsigned int)aValue & 0xF];
+		aValue >>= 4;
+	} while (aValue);
+	size_t length = temp + sizeof(temp) - cp;
+	memcpy(aBuf, cp, length);
+	aBuf[length] = '\0';
+	return aBuf;
+}
+
+
+
+int ParseFixedFormat(const char *aFormat)
+{
+	if (*aFormat != '%')
+		return -1;
+	const char *cp;
+	for (cp = aFormat + 1; *cp == '0'; ++cp); // A zero flag without a width has no effect.
+	if (*cp != '.')
+		return -1; // A width, some other flag, or no precision (which is also 6, but SetFormat never omits it).
+	++cp;
+	int precision = 0; // "%0.f" is the same as "%0.0f".
+	if (*cp >= '0' && *cp <= '9')
+		precision = *cp++ - '0';
+	if (*cp != 'f' || cp[1]) // Another digit (i.e. precision >= 10), some other conversion, or extra chars.
+		return -1;
+	return precision;
+}
+
+
+
+int DoubleToFixed(double aValue, int aPrecision, char *aBuf)
+// The approach is to split the value into its integer part and its fraction, both of which are exact.  Only
+// the scaling of the fraction by 10^aPrecision can introduce error, and it is far smaller than the margin
+// around the rounding point within which this function declines the value.  Limiting the output to 15
+// significant digits also ensures that the result doesn't depend on how many digits a particular C runtime
+// computes exactly (some compute only 17 and pad with zeros).
+{
+	if (aPrecision < 0 || aPrecision > NUM_FIXED_MAX_PRECISION)
+		return -1;
+	if (!(aValue > -1e15 && aValue < 1e15)) // Also handles NaN.
+		return -1;
+	bool is_negative = aValue < 0;
+	double abs_value = is_negative ? -aValue : aValue;
+	NumUInt64Type int_part = (NumUInt64Type)abs_value;
+	double fraction = abs_value - (double)(NumInt64Type)int_part; // Exact.
+	int int_digits = 1;
+	for (NumUInt64Type n = int_part; n >= 10; n /= 10)
+		++int_digits;
+	if (int_digits + aPrecision > 15)
+		return -1;
+	double scaled = fraction * sPowerOf10[aPrecision];
+	NumUInt64Type frac_part = (NumUInt64Type)scaled;
+	double remainder = scaled - (double)(NumInt64Type)frac_part;
+	if (remainder > 0.49 && remainder < 0.51)
+		return -1; // Too close to call, especially an exact tie (e.g. 0.125 to two places), whose rounding varies between C runtimes.
+	if (remainder >= 0.51 && ++frac_part == (NumUInt64Type)sPowerOf10[aPrecision])
+	{
+		frac_part = 0; // e.g. 0.9999999 to six places is 1.000000.
+		++int_part;
+	}
+	if (is_negative && !int_part && !frac_part)
+		return -1; // Whether it's shown as "-0.000000" or "0.000000" varies between C runtimes.
+	if (!aValue && 1 / aValue < 0) // Negative zero, which varies similarly.
+		return -1;
+
+	char *cp = aBuf;
+	if (is_negative)
+		*cp++ = '-';
+	char temp[24];
+	char *start = WriteDecimalBackward(int_part, temp + sizeof(temp));
+	size_t length = temp + sizeof(temp) - start;
+	memcpy(cp, start, length);
+	cp += length;
+	if (aPrecision)
+	{
+		*cp++ = '.';
+		// Write the fraction's digits backward, including any leading zeros:
+		for (int i = aPrecision; i > 0; --i)
+		{
+			cp[i - 1] = (char)('0' + (int)(frac_part % 10));
+			frac_part /= 10;
+		}
+		cp += aPrecision;
+	}
+	*cp = '\0';
+	return (int)(cp - aBuf);
+}
+
+
+
+bool DecimalToDouble(const char *aBuf, double &aResult)
+// When a number has no more than 15 significant digits, its digits form an integer that a double holds
+// exactly, and dividing that by an exact power of ten yields the correctly rounded result in one step.
+{
+	const char *cp = aBuf;
+	while (*cp == ' ' || (*cp >= '\t' && *cp <= '\r')) // Same as isspace() in the "C" locale, which atof() skips.
+		++cp;
+	bool is_negative = false;
+	if (*cp == '-' || *cp == '+')
+		is_negative = (*cp++ == '-');
+	NumUInt64Type mantissa = 0;
+	int significant_digits = 0, fraction_digits = 0;
+	bool has_digits = false, in_fraction = false;
+	for (;; ++cp)
+	{
+		if (*cp >= '0' && *cp <= '9')
+		{
+			has_digits = true;
+			if (mantissa || *cp != '0') // Leading zeros aren't significant.
+			{
+				if (++significant_digits > 15)
+					return false;
+				mantissa = mantissa * 10 + (*cp - '0');
+			}
+			if (in_fraction)
+				++fraction_digits;
+		}
+		else if (*cp == '.' && !in_fraction)
+			in_fraction = true;
+		else
+			break;
+	}
+	if (!has_digits // Let atof() decide what it is (e.g. some runtimes accept "inf").
+		|| *cp == 'e' || *cp == 'E' || *cp == 'd' || *cp == 'D' // Exponent (MSVC's atof() also accepts 'd').
+		|| *cp == 'x' || *cp == 'X' // Hex, which some runtimes' atof() accepts and others stop at (ATOF() handles it itself).
+		|| fraction_digits > NUM_EXACT_POWER_OF_10_MAX)
+		return false;
+	double result = (double)(NumInt64Type)mantissa;
+	if (fraction_digits)
+		result /= sPowerOf10[fraction_digits];
+	aResult = is_negative ? -result : result;
+	return true;
+}
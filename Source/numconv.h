@@ -0,0 +1,61 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef numconv_h
+#define numconv_h
+
+// These functions convert numbers to and from text faster than the C runtime functions that ITOA64(),
+// ATOF() and the formatting of floats via g->FormatFloat have traditionally used.  The integer formatters
+// handle every value.  The double converters handle only the common cases whose results they can guarantee
+// to be identical to those of the C runtime; for anything else they return a failure indicator so that the
+// caller can fall back to the C runtime function.
+//
+// Because the C runtime is the specification here, test/numconv_test.cpp compares every function with the
+// runtime function it stands in for (e.g. _i64toa() via printf("%lld")), and test/numconv_bench.cpp times
+// both.  Keep this file free of anything those programs can't compile outside Windows.
+
+#ifdef _MSC_VER
+typedef __int64 NumInt64Type;
+typedef unsigned __int64 NumUInt64Type;
+#else
+typedef long long NumInt64Type;
+typedef unsigned long long NumUInt64Type;
+#endif
+
+// The following store a terminated string in aBuf (which must have room for at least 21 chars) and
+// return aBuf, like _i64toa() and its relatives.  Hex digits are lowercase and have no "0x" prefix.
+char *Int64ToDecimal(NumInt64Type aValue, char *aBuf);
+char *UInt64ToDecimal(NumUInt64Type aValue, char *aBuf);
+char *UInt64ToHex(NumUInt64Type aValue, char *aBuf);
+
+#define NUM_FIXED_MAX_PRECISION 9 // The most decimal places DoubleToFixed() supports.
+
+// If aFormat is a printf() format that DoubleToFixed() can produce (i.e. "%0.6f" and other precisions, as
+// SetFormat builds it when no width is given), returns the number of decimal places.  Otherwise returns -1.
+int ParseFixedFormat(const char *aFormat);
+
+// Formats aValue as printf("%0.<aPrecision>f") would and returns the length of the result, or -1 if the
+// value is one the caller should format via printf() instead (in which case aBuf is undefined).
+// aBuf must have room for at least 32 chars.
+int DoubleToFixed(double aValue, int aPrecision, char *aBuf);
+
+// Converts a decimal number as atof() would and returns true, or returns false without changing aResult if
+// aBuf is something the caller should convert via atof() instead (such as exponent notation, more than 15
+// significant digits, or no number at all).
+bool DecimalToDouble(const char *aBuf, double &aResult);
+
+#endif
@@ -0,0 +1,414 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "packedarray.h"
+
+#define PACKED_ARRAY_MIN_COUNT 64
+#define PACKED_ARRAY_MIN_TEXT 1024
+#define PACKED_ARRAY_MAX_LAYERS 4 // Beyond this, a new layer absorbs the older ones if it can (see PackedArraySet::Set).
+
+
+
+PackedStringArray::PackedStringArray()
+	: mText(NULL), mTextLength(0), mTextCapacity(0), mOffset(NULL), mCount(0), mCapacity(0)
+{
+}
+
+
+
+PackedStringArray::~PackedStringArray()
+{
+	free(mText);
+	free(mOffset);
+}
+
+
+
+bool PackedStringArray::Reserve(unsigned aCount, size_t aTextLength)
+// Ensures there's room for a total of aCount strings and aTextLength chars (including terminators),
+// growing geometrically so that appending n strings costs O(n) overall.  Returns false if out of memory.
+{
+	if (aCount > mCapacity || !mOffset)
+	{
+		unsigned new_capacity = mCapacity ? mCapacity : PACKED_ARRAY_MIN_COUNT;
+		while (new_capacity < aCount)
+			new_capacity *= 2;
+		size_t *new_offset = (size_t *)realloc(mOffset, (new_capacity + 1) * sizeof(size_t)); // +1 for the end offset.
+		if (!new_offset)
+			return false;
+		if (!mOffset)
+			new_offset[0] = 0;
+		mOffset = new_offset;
+		mCapacity = new_capacity;
+	}
+	if (aTextLength > mTextCapacity)
+	{
+		size_t new_capacity = mTextCapacity ? mTextCapacity : PACKED_ARRAY_MIN_TEXT;
+		while (new_capacity < aTextLength)
+			new_capacity *= 2;
+		char *new_text = (char *)realloc(mText, new_capacity);
+		if (!new_text)
+			return false;
+		mText = new_text;
+		mTextCapacity = new_capacity;
+	}
+	return true;
+}
+
+
+
+bool PackedStringArray::Append(const char *aStr, size_t aLength)
+// Appends the first aLength chars of aStr (which need not be terminated).  Returns false if out of memory,
+// in which case the array is unchanged.
+{
+	if (!Reserve(mCount + 1, mTextLength + aLength + 1))
+		return false;
+	memcpy(mText + mTextLength, aStr, aLength);
+	mTextLength += aLength;
+	mText[mTextLength++] = '\0';
+	mOffset[++mCount] = mTextLength;
+	return true;
+}
+
+
+
+bool PackedStringArray::AppendFrom(const PackedStringArray &aSource, unsigned aFirst)
+// Appends strings aFirst through the last of aSource, which must not be this array.  Returns false if out
+// of memory, in which case the array is unchanged.
+{
+	if (aFirst >= aSource.mCount)
+		return true;
+	size_t text_length = aSource.mTextLength - aSource.mOffset[aFirst];
+	unsigned count = aSource.mCount - aFirst;
+	if (!Reserve(mCount + count, mTextLength + text_length))
+		return false;
+	memcpy(mText + mTextLength, aSource.mText + aSource.mOffset[aFirst], text_length);
+	size_t delta = mTextLength - aSource.mOffset[aFirst]; // Wraps around when negative, which is harmless for unsigned addition below.
+	for (unsigned i = 1; i <= count; ++i)
+		mOffset[mCount + i] = aSource.mOffset[aFirst + i] + delta;
+	mCount += count;
+	mTextLength += text_length;
+	return true;
+}
+
+
+
+void PackedStringArray::Clear()
+{
+	mCount = 0;
+	mTextLength = 0;
+}
+
+
+
+void PackedStringArray::Swap(PackedStringArray &aOther)
+{
+	char *text = mText; mText = aOther.mText; aOther.mText = text;
+	size_t *offset = mOffset; mOffset = aOther.mOffset; aOther.mOffset = offset;
+	size_t n = mTextLength; mTextLength = aOther.mTextLength; aOther.mTextLength = n;
+	n = mTextCapacity; mTextCapacity = aOther.mTextCapacity; aOther.mTextCapacity = n;
+	unsigned u = mCount; mCount = aOther.mCount; aOther.mCount = u;
+	u = mCapacity; mCapacity = aOther.mCapacity; aOther.mCapacity = u;
+}
+
+
+
+///////////////////
+// PackedArraySet //
+///////////////////
+
+static inline char FoldCase(char aChar)
+{
+	return (aChar >= 'A' && aChar <= 'Z') ? aChar + ('a' - 'A') : aChar;
+}
+
+
+
+static bool NamesEqual(const char *aName1, const char *aName2, size_t aLength)
+{
+	for (size_t i = 0; i < aLength; ++i)
+		if (FoldCase(aName1[i]) != FoldCase(aName2[i]))
+			return false;
+	return true;
+}
+
+
+
+static unsigned HashName(const char *aName, size_t aLength)
+{
+	unsigned hash = 2166136261U; // FNV-1a.
+	for (size_t i = 0; i < aLength; ++i)
+		hash = (hash ^ (unsigned char)FoldCase(aName[i])) * 16777619U;
+	return hash;
+}
+
+
+
+PackedArraySet::PackedArraySet()
+	: mEntry(NULL), mCount(0), mCapacity(0), mSlot(NULL), mSlotCount(0), mSequence(0)
+{
+}
+
+
+
+PackedArraySet::~PackedArraySet()
+{
+	for (int i = 0; i < mCount; ++i)
+	{
+		Release(mEntry[i].base_name, mEntry[i].base_length);
+		free(mEntry[i].layer);
+		free(mEntry[i].base_name);
+	}
+	free(mEntry);
+	free(mSlot);
+}
+
+
+
+int PackedArraySet::Find(const char *aBaseName, size_t aBaseLength) const
+// Returns the index of the entry whose base name is the first aBaseLength chars of aBaseName, or -1 if none.
+{
+	if (!mSlotCount)
+		return -1;
+	for (unsigned i = HashName(aBaseName, aBaseLength) & (mSlotCount - 1); mSlot[i]; i = (i + 1) & (mSlotCount - 1))
+	{
+		const Entry &entry = mEntry[mSlot[i] - 1];
+		if (entry.base_length == aBaseLength && NamesEqual(entry.base_name, aBaseName, aBaseLength))
+			return mSlot[i] - 1;
+	}
+	return -1;
+}
+
+
+
+int PackedArraySet::Add(const char *aBaseName, size_t aBaseLength)
+// Caller must have ensured the name isn't already present.  Returns the index of the new entry, or -1 if
+// out of memory.
+{
+	if (mCount == mCapacity)
+	{
+		int new_capacity = mCapacity ? mCapacity * 2 : 8;
+		Entry *new_entry = (Entry *)realloc(mEntry, new_capacity * sizeof(Entry));
+		if (!new_entry)
+			return -1;
+		mEntry = new_entry;
+		mCapacity = new_capacity;
+	}
+	if ((unsigned)(mCount + 1) * 2 > mSlotCount)
+	{
+		unsigned new_slot_count = mSlotCount ? mSlotCount * 2 : 16;
+		unsigned *new_slot = (unsigned *)calloc(new_slot_count, sizeof(unsigned));
+		if (!new_slot)
+			return -1;
+		for (int i = 0; i < mCount; ++i)
+		{
+			unsigned s = HashName(mEntry[i].base_name, mEntry[i].base_length) & (new_slot_count - 1);
+			while (new_slot[s])
+				s = (s + 1) & (new_slot_count - 1);
+			new_slot[s] = i + 1;
+		}
+		free(mSlot);
+		mSlot = new_slot;
+		mSlotCount = new_slot_count;
+	}
+	char *base_name = (char *)malloc(aBaseLength + 1);
+	if (!base_name)
+		return -1;
+	memcpy(base_name, aBaseName, aBaseLength);
+	base_name[aBaseLength] = '\0';
+	Entry &entry = mEntry[mCount];
+	entry.base_name = base_name;
+	entry.base_length = aBaseLength;
+	entry.layer = NULL;
+	entry.layer_count = entry.layer_capacity = 0;
+	unsigned s = HashName(aBaseName, aBaseLength) & (mSlotCount - 1);
+	while (mSlot[s])
+		s = (s + 1) & (mSlotCount - 1);
+	mSlot[s] = ++mCount; // i.e. the new entry's index + 1.
+	return mCount - 1;
+}
+
+
+
+bool PackedArraySet::CanMerge(int aIndex) const
+// Returns true if the layers of entry aIndex can be merged into a new layer without changing any element's
+// value.  That's so unless an overlapping array (one whose element names can also be elements of this one)
+// was stored more recently than the oldest layer, since merging would make that layer's visible elements
+// seem newer than the overlapping array's.
+{
+	const Entry &entry = mEntry[aIndex];
+	PackedSequenceType oldest = entry.layer[0].sequence;
+	for (int i = 0; i < mCount; ++i)
+	{
+		const Entry &other = mEntry[i];
+		if (i == aIndex || !other.layer_count || other.layer[other.layer_count - 1].sequence < oldest)
+			continue;
+		// The names overlap if the shorter base name followed by a number (which never starts with 0)
+		// can be the longer base name.
+		const Entry &shorter = other.base_length < entry.base_length ? other : entry;
+		const Entry &longer = other.base_length < entry.base_length ? entry : other;
+		if (shorter.base_length == longer.base_length || longer.base_name[shorter.base_length] == '0'
+			|| !NamesEqual(shorter.base_name, longer.base_name, shorter.base_length))
+			continue;
+		size_t k;
+		for (k = shorter.base_length; k < longer.base_length; ++k)
+			if (longer.base_name[k] < '0' || longer.base_name[k] > '9')
+				break;
+		if (k == longer.base_length)
+			return false;
+	}
+	return true;
+}
+
+
+
+bool PackedArraySet::Set(const char *aBaseName, PackedStringArray &aArray)
+// Stores aArray as the elements of aBaseName, leaving aArray empty.  Returns false if out of memory, in
+// which case aArray might not be empty, and elements beyond its count might have been lost.
+{
+	size_t base_length = strlen(aBaseName);
+	int index = Find(aBaseName, base_length);
+	if (index < 0 && (index = Add(aBaseName, base_length)) < 0)
+		return false;
+	unsigned count = aArray.Count();
+	if (!count) // There's nothing to store, and storing nothing hides nothing.
+		return true;
+	Entry &entry = mEntry[index];
+	// Free the layers the new one covers entirely.  Since each layer has fewer elements than the one beneath
+	// it, those are the newest.
+	while (entry.layer_count && entry.layer[entry.layer_count - 1].array->Count() <= count)
+		delete entry.layer[--entry.layer_count].array;
+	if (entry.layer_count >= PACKED_ARRAY_MAX_LAYERS && CanMerge(index))
+	{
+		// Append what's still visible of each layer, newest first, so that the new layer covers all of them.
+		// This bounds the memory of an array that's stored repeatedly with fewer elements each time to a
+		// constant multiple of its largest count, at the cost of copying each element at most once per
+		// PACKED_ARRAY_MAX_LAYERS stores.
+		for (int i = entry.layer_count - 1; i >= 0; --i)
+			if (!aArray.AppendFrom(*entry.layer[i].array, aArray.Count()))
+				return false;
+		while (entry.layer_count)
+			delete entry.layer[--entry.layer_count].array;
+	}
+	if (entry.layer_count == entry.layer_capacity)
+	{
+		int new_capacity = entry.layer_capacity ? entry.layer_capacity * 2 : PACKED_ARRAY_MAX_LAYERS + 1;
+		Layer *new_layer = (Layer *)realloc(entry.layer, new_capacity * sizeof(Layer));
+		if (!new_layer)
+			return false;
+		entry.layer = new_layer;
+		entry.layer_capacity = new_capacity;
+	}
+	PackedStringArray *array = new PackedStringArray;
+	if (!array)
+		return false;
+	array->Swap(aArray);
+	entry.layer[entry.layer_count].array = array;
+	entry.layer[entry.layer_count].sequence = ++mSequence;
+	++entry.layer_count;
+	return true;
+}
+
+
+
+bool PackedArraySet::Get(const char *aName, size_t aNameLength, const char *&aElement, size_t &aElementLength) const
+// Returns true and sets aElement and aElementLength if aName is the name of a stored element.  Since a name
+// such as Array12 can belong to more than one array (Array and Array1), each base name it could have is
+// looked up, and the element stored most recently wins.
+{
+	size_t digits = aNameLength;
+	while (digits && aName[digits - 1] >= '0' && aName[digits - 1] <= '9')
+		--digits;
+	if (digits == aNameLength)
+		return false;
+	if (!digits) // A base name can't be empty.
+		digits = 1;
+	const Layer *found = NULL;
+	unsigned found_index = 0;
+	for (size_t base_length = digits; base_length < aNameLength; ++base_length)
+	{
+		if (aName[base_length] == '0' || aNameLength - base_length > 9) // Element numbers never start with 0, and none exceed 999999999.
+			continue;
+		int i = Find(aName, base_length);
+		if (i < 0)
+			continue;
+		unsigned number = 0;
+		for (size_t k = base_length; k < aNameLength; ++k)
+			number = number * 10 + (aName[k] - '0');
+		// Since each layer has fewer elements than the one beneath it, the newest one that has element
+		// <number> is the only one that can.
+		const Entry &entry = mEntry[i];
+		for (int l = entry.layer_count - 1; l >= 0; --l)
+			if (entry.layer[l].array->Count() >= number)
+			{
+				if (!found || entry.layer[l].sequence > found->sequence)
+				{
+					found = entry.layer + l;
+					found_index = number - 1;
+				}
+				break;
+			}
+	}
+	if (!found)
+		return false;
+	aElement = found->array->Item(found_index, aElementLength);
+	return true;
+}
+
+
+
+bool PackedArraySet::Release(const char *aBaseName, size_t aBaseLength)
+// Frees all elements of the array whose base name is the first aBaseLength chars of aBaseName.  Returns
+// true if there were any.
+{
+	int i = Find(aBaseName, aBaseLength);
+	if (i < 0 || !mEntry[i].layer_count)
+		return false;
+	Entry &entry = mEntry[i];
+	while (entry.layer_count)
+		delete entry.layer[--entry.layer_count].array;
+	return true;
+}
+
+
+
+unsigned PackedArraySet::ElementCount() const
+// Returns the number of elements stored, including any that are hidden by newer layers.
+{
+	unsigned count = 0;
+	for (int i = 0; i < mCount; ++i)
+		for (int l = 0; l < mEntry[i].layer_count; ++l)
+			count += mEntry[i].layer[l].array->Count();
+	return count;
+}
+
+
+
+size_t PackedArraySet::MemoryUsed() const
+{
+	size_t size = mCapacity * sizeof(Entry) + mSlotCount * sizeof(unsigned);
+	for (int i = 0; i < mCount; ++i)
+	{
+		size += mEntry[i].base_length + 1 + mEntry[i].layer_capacity * sizeof(Layer);
+		for (int l = 0; l < mEntry[i].layer_count; ++l)
+			size += sizeof(PackedStringArray) + mEntry[i].layer[l].array->MemoryUsed();
+	}
+	return size;
+}
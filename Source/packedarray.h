@@ -0,0 +1,111 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef packedarray_h
+#define packedarray_h
+
+#include <stddef.h> // For size_t.
+
+// PackedStringArray holds a list of strings in a single block of text, each zero-terminated, plus a table of
+// where each one starts.  Compared to giving each string its own variable, as StringSplit traditionally
+// does, this needs two allocations in total rather than several per string, and all of it can be freed
+// (or handed to another PackedStringArray via Swap()) at once.  Strings can only be appended, and are
+// numbered from zero.
+//
+// Nothing here knows about variables: Script decides which arrays are packed and when an element must
+// become a variable, which lets test/packedarray_test.cpp check the naming rules below against a model.
+
+class PackedStringArray
+{
+	char *mText;
+	size_t mTextLength, mTextCapacity; // mTextLength includes the terminator of every string.
+	size_t *mOffset; // mOffset[i] is where string i starts in mText.  mOffset[mCount] is mTextLength.
+	unsigned mCount, mCapacity; // mCapacity is the number of strings mOffset has room for.
+
+	bool Reserve(unsigned aCount, size_t aTextLength);
+
+public:
+	PackedStringArray();
+	~PackedStringArray();
+	unsigned Count() const {return mCount;}
+	const char *Item(unsigned aIndex, size_t &aLength) const
+	// Caller must ensure aIndex < Count().  The string is always zero-terminated.
+	{
+		aLength = mOffset[aIndex + 1] - mOffset[aIndex] - 1;
+		return mText + mOffset[aIndex];
+	}
+	size_t MemoryUsed() const {return mTextCapacity + (mText ? (mCapacity + 1) * sizeof(size_t) : 0);}
+	bool Append(const char *aStr, size_t aLength);
+	bool AppendFrom(const PackedStringArray &aSource, unsigned aFirst);
+	void Clear(); // Removes all strings but keeps the memory.
+	void Swap(PackedStringArray &aOther);
+};
+
+
+
+// PackedArraySet holds the packed arrays of a script, each under a base name such as "Array" (whose elements
+// are named Array1, Array2, etc.).  Names are compared ASCII case-insensitively, like those of variables.
+//
+// The element of a given name is always the one most recently stored under that name, as it would be if
+// each element were a variable.  This matters because the names of different arrays can overlap (Array12
+// is both element 12 of Array and element 2 of Array1), and because an array that's stored again with
+// fewer elements keeps the old elements beyond the new count.  So rather than copying the old elements that
+// are kept, each store becomes a new layer on top of the ones it doesn't entirely cover.  Since a layer
+// that's entirely covered is freed, each layer has fewer elements than the one beneath it.  If too many
+// layers pile up, the elements that are still visible in them are copied into the newest layer.
+#ifdef _MSC_VER
+typedef unsigned __int64 PackedSequenceType;
+#else
+typedef unsigned long long PackedSequenceType;
+#endif
+
+class PackedArraySet
+{
+	struct Layer
+	{
+		PackedStringArray *array;
+		PackedSequenceType sequence; // When this layer was stored, relative to all others in the set.
+	};
+	struct Entry
+	{
+		char *base_name;
+		size_t base_length;
+		Layer *layer; // The oldest first.
+		int layer_count, layer_capacity;
+	};
+	Entry *mEntry;
+	int mCount, mCapacity;
+	unsigned *mSlot; // Open-addressed hash table of (entry index + 1) keyed by base name.  Zero means an empty slot.
+	unsigned mSlotCount; // Zero or a power of two, at least twice mCount.
+	PackedSequenceType mSequence;
+
+	int Find(const char *aBaseName, size_t aBaseLength) const;
+	int Add(const char *aBaseName, size_t aBaseLength);
+	bool CanMerge(int aIndex) const;
+
+public:
+	PackedArraySet();
+	~PackedArraySet();
+	int Count() const {return mCount;} // The number of base names that have ever been stored.
+	bool Set(const char *aBaseName, PackedStringArray &aArray);
+	bool Get(const char *aName, size_t aNameLength, const char *&aElement, size_t &aElementLength) const;
+	bool Release(const char *aBaseName, size_t aBaseLength);
+	unsigned ElementCount() const;
+	size_t MemoryUsed() const;
+};
+
+#endif
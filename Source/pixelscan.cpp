@@ -0,0 +1,595 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pixelscan.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+	#define PIXELSCAN_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+static int sHasSSE2 = -1; // -1 means "not yet determined".
+
+bool PixelScanUsesSSE2()
+// Returns true if the CPU and OS support SSE2, in which case the faster versions of the functions below
+// are used.  The result is determined only once.
+{
+	if (sHasSSE2 < 0)
+	{
+#if !defined(PIXELSCAN_SSE2)
+		sHasSSE2 = 0;
+#elif defined(_MSC_VER)
+		// IsProcessorFeaturePresent() is loaded dynamically because it doesn't exist on some older OSes.
+		// This also takes care of the fact that Windows 95 doesn't preserve the SSE registers across
+		// context switches, since the function (if present) checks for OS support too.
+		typedef BOOL (WINAPI *MyIsProcessorFeaturePresentType)(DWORD);
+		MyIsProcessorFeaturePresentType MyIsProcessorFeaturePresent = (MyIsProcessorFeaturePresentType)
+			GetProcAddress(GetModuleHandle("kernel32"), "IsProcessorFeaturePresent");
+		sHasSSE2 = MyIsProcessorFeaturePresent && MyIsProcessorFeaturePresent(10); // 10 is PF_XMMI64_INSTRUCTIONS_AVAILABLE, which older SDKs don't define.
+#else
+		sHasSSE2 = 1; // __SSE2__ means the compiler was told the target supports it.
+#endif
+	}
+	return sHasSSE2 != 0;
+}
+
+
+
+void PixelScanAllowSSE2(bool aAllow)
+// Passing false makes the functions below use their plain loops even if the CPU supports SSE2, which allows
+// the tests to compare the two.  Passing true restores the default (SSE2 if supported).
+{
+	sHasSSE2 = aAllow ? -1 : 0;
+}
+
+
+
+#ifdef PIXELSCAN_SSE2
+static inline int FirstMatchingLane(int aMoveMask)
+// aMoveMask is the result of _mm_movemask_epi8() on a vector of four 32-bit comparison results, which
+// means that each matching pixel is represented by a group of four consecutive bits.
+{
+	if (aMoveMask & 0x000F)
+		return 0;
+	if (aMoveMask & 0x00F0)
+		return 1;
+	return (aMoveMask & 0x0F00) ? 2 : 3;
+}
+
+static inline int LastMatchingLane(int aMoveMask)
+// Same as the above except that it returns the highest matching lane rather than the lowest.
+{
+	if (aMoveMask & 0xF000)
+		return 3;
+	if (aMoveMask & 0x0F00)
+		return 2;
+	return (aMoveMask & 0x00F0) ? 1 : 0;
+}
+
+static inline int RangeMoveMask(__m128i aPixel, __m128i aLow, __m128i aHigh)
+// Returns the _mm_movemask_epi8() of the lanes of aPixel that lie within the range (see PixelScanRange()).
+{
+	// A byte lies within [low, high] if and only if both of the saturating subtractions (low - byte)
+	// and (byte - high) are zero.  Forcing the high-order byte's range to [0, 255] makes that byte
+	// always qualify, so a pixel matches when its entire 32-bit lane of the combined result is zero.
+	__m128i outside = _mm_or_si128(_mm_subs_epu8(aLow, aPixel), _mm_subs_epu8(aPixel, aHigh));
+	return _mm_movemask_epi8(_mm_cmpeq_epi32(outside, _mm_setzero_si128()));
+}
+#endif
+
+
+
+static inline bool PixelInRange(ScanPixelType aPixel, ScanPixelType aLow, ScanPixelType aHigh)
+// The plain version of RangeMoveMask() for a single pixel.
+{
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		ScanPixelType c = (aPixel >> shift) & 0xFF;
+		if (c < ((aLow >> shift) & 0xFF) || c > ((aHigh >> shift) & 0xFF))
+			return false;
+	}
+	return true;
+}
+
+
+
+void PixelScanMask(ScanPixelType *aPixel, int aCount, ScanPixelType aMask)
+// Bitwise-ANDs every pixel with aMask, such as to discard the meaningless low-order bits of each color
+// component of a 16-bit screen.
+{
+	int i = 0;
+#ifdef PIXELSCAN_SSE2
+	if (PixelScanUsesSSE2())
+	{
+		__m128i mask = _mm_set1_epi32((int)aMask);
+		for (; i + 4 <= aCount; i += 4)
+			_mm_storeu_si128((__m128i *)(aPixel + i), _mm_and_si128(_mm_loadu_si128((__m128i *)(aPixel + i)), mask));
+	}
+#endif
+	for (; i < aCount; ++i) // Do any pixels left over by the above.
+		aPixel[i] &= aMask;
+}
+
+
+
+int PixelScanExact(const ScanPixelType *aPixel, int aCount, ScanPixelType aColor)
+// Returns the index of the first pixel whose low-order three bytes equal those of aColor, or -1 if none.
+// Screen pixels sometimes have a non-zero high-order byte, which is why it's excluded from the comparison.
+{
+	aColor &= 0x00FFFFFF;
+	int i = 0;
+#ifdef PIXELSCAN_SSE2
+	if (PixelScanUsesSSE2())
+	{
+		__m128i mask = _mm_set1_epi32(0x00FFFFFF);
+		__m128i color = _mm_set1_epi32((int)aColor);
+		for (; i + 4 <= aCount; i += 4)
+		{
+			__m128i pixel = _mm_and_si128(_mm_loadu_si128((const __m128i *)(aPixel + i)), mask);
+			int match = _mm_movemask_epi8(_mm_cmpeq_epi32(pixel, color));
+			if (match)
+				return i + FirstMatchingLane(match);
+		}
+	}
+#endif
+	for (; i < aCount; ++i) // Do any pixels left over by the above.
+		if ((aPixel[i] & 0x00FFFFFF) == aColor)
+			return i;
+	return -1;
+}
+
+
+
+int PixelScanRange(const ScanPixelType *aPixel, int aCount, ScanPixelType aLow, ScanPixelType aHigh)
+// Returns the index of the first pixel each of whose low-order three bytes lies within the inclusive range
+// formed by the corresponding bytes of aLow and aHigh, or -1 if none.  The high-order byte is ignored.
+{
+	int i = 0;
+#ifdef PIXELSCAN_SSE2
+	if (PixelScanUsesSSE2())
+	{
+		__m128i low = _mm_set1_epi32((int)(aLow & 0x00FFFFFF));
+		__m128i high = _mm_set1_epi32((int)(aHigh | 0xFF000000));
+		for (; i + 4 <= aCount; i += 4)
+		{
+			int match = RangeMoveMask(_mm_loadu_si128((const __m128i *)(aPixel + i)), low, high);
+			if (match)
+				return i + FirstMatchingLane(match);
+		}
+	}
+#endif
+	for (; i < aCount; ++i) // Do any pixels left over by the above.
+		if (PixelInRange(aPixel[i], aLow, aHigh))
+			return i;
+	return -1;
+}
+
+
+
+static int PixelScanExactReverse(const ScanPixelType *aPixel, int aCount, ScanPixelType aColor)
+// Same as PixelScanExact() except that it returns the index of the last match rather than the first.
+{
+	aColor &= 0x00FFFFFF;
+	int i = aCount;
+#ifdef PIXELSCAN_SSE2
+	if (PixelScanUsesSSE2())
+	{
+		__m128i mask = _mm_set1_epi32(0x00FFFFFF);
+		__m128i color = _mm_set1_epi32((int)aColor);
+		for (; i >= 4; i -= 4)
+		{
+			__m128i pixel = _mm_and_si128(_mm_loadu_si128((const __m128i *)(aPixel + i - 4)), mask);
+			int match = _mm_movemask_epi8(_mm_cmpeq_epi32(pixel, color));
+			if (match)
+				return i - 4 + LastMatchingLane(match);
+		}
+	}
+#endif
+	while (i--) // Do any pixels left over by the above, which are at the start rather than the end.
+		if ((aPixel[i] & 0x00FFFFFF) == aColor)
+			return i;
+	return -1;
+}
+
+
+
+static int PixelScanRangeReverse(const ScanPixelType *aPixel, int aCount, ScanPixelType aLow, ScanPixelType aHigh)
+// Same as PixelScanRange() except that it returns the index of the last match rather than the first.
+{
+	int i = aCount;
+#ifdef PIXELSCAN_SSE2
+	if (PixelScanUsesSSE2())
+	{
+		__m128i low = _mm_set1_epi32((int)(aLow & 0x00FFFFFF));
+		__m128i high = _mm_set1_epi32((int)(aHigh | 0xFF000000));
+		for (; i >= 4; i -= 4)
+		{
+			int match = RangeMoveMask(_mm_loadu_si128((const __m128i *)(aPixel + i - 4)), low, high);
+			if (match)
+				return i - 4 + LastMatchingLane(match);
+		}
+	}
+#endif
+	while (i--) // Do any pixels left over by the above, which are at the start rather than the end.
+		if (PixelInRange(aPixel[i], aLow, aHigh))
+			return i;
+	return -1;
+}
+
+
+
+int PixelScanFind(const ScanPixelType *aPixel, int aWidth, int aHeight, ScanPixelType aLow, ScanPixelType aHigh
+	, bool aRightToLeft, bool aBottomToTop)
+// Returns the index of the first pixel within the range formed by aLow and aHigh (see PixelScanRange()), or -1
+// if none.  aPixel is an image aWidth pixels wide, which is searched one row at a time, starting at the top row
+// (or the bottom if aBottomToTop), and within each row from left to right (or right to left if aRightToLeft).
+{
+	bool exact = !((aLow ^ aHigh) & 0x00FFFFFF); // PixelScanExact() is a little faster.
+	if (!aRightToLeft && !aBottomToTop) // The usual case, in which the entire array can be searched in one call.
+		return exact ? PixelScanExact(aPixel, aWidth * aHeight, aLow) : PixelScanRange(aPixel, aWidth * aHeight, aLow, aHigh);
+	for (int y = 0; y < aHeight; ++y)
+	{
+		int row = aBottomToTop ? aHeight - 1 - y : y;
+		const ScanPixelType *row_pixel = aPixel + row * aWidth;
+		int x = aRightToLeft
+			? (exact ? PixelScanExactReverse(row_pixel, aWidth, aLow) : PixelScanRangeReverse(row_pixel, aWidth, aLow, aHigh))
+			: (exact ? PixelScanExact(row_pixel, aWidth, aLow) : PixelScanRange(row_pixel, aWidth, aLow, aHigh));
+		if (x > -1)
+			return row * aWidth + x;
+	}
+	return -1;
+}
+
+
+
+#define IMAGE_SCAN_IS_TRANSPARENT(aImage, j) (((aImage).mask && (aImage).mask[j]) || (aImage).pixel[j] == (aImage).trans_color)
+
+void ImageScanPrepare(ScanImage &aImage)
+// Chooses the image's anchor pixel.  Instead of comparing the image's upper-left pixel to every pixel of
+// the screen as was done in the past, ImageScanFind() uses the fast functions above to find occurrences of
+// the anchor pixel and checks the rest of the image only at those positions.  This works best when the
+// anchor's color is rare on the screen, which can't be known cheaply.  But a color that is rare within the
+// image itself is a good approximation, since the most common colors in an image tend to be those of its
+// background, which are also the colors most likely to surround it on the screen.
+{
+	int pixel_count = aImage.width * aImage.height;
+	int j;
+	aImage.anchor = -1;
+	aImage.has_transparency = false;
+	for (j = 0; j < pixel_count; ++j)
+		if (IMAGE_SCAN_IS_TRANSPARENT(aImage, j))
+			aImage.has_transparency = true;
+		else if (aImage.anchor < 0)
+			aImage.anchor = j; // Use the first opaque pixel if the below fails to find a better one.
+	if (aImage.anchor < 0 || pixel_count < 3) // All transparent, or too small to benefit.
+		return;
+
+	// Count the occurrences of a sample of the image's colors in a small hash table.  Sampling keeps the
+	// cost small and constant even for large images.
+	#define ANCHOR_SAMPLE_COUNT 1024
+	#define ANCHOR_TABLE_SIZE 2048 // Must be a power of two larger than the above.
+	ScanPixelType *table_color = (ScanPixelType *)malloc(ANCHOR_TABLE_SIZE * (sizeof(ScanPixelType) + sizeof(int)));
+	if (!table_color)
+		return; // Keep the default anchor; it's only a matter of performance.
+	int *table_count = (int *)(table_color + ANCHOR_TABLE_SIZE);
+	memset(table_count, 0, ANCHOR_TABLE_SIZE * sizeof(int));
+	int stride = pixel_count / ANCHOR_SAMPLE_COUNT + 1;
+	int h;
+	for (j = 0; j < pixel_count; j += stride)
+	{
+		if (IMAGE_SCAN_IS_TRANSPARENT(aImage, j))
+			continue;
+		for (h = (aImage.pixel[j] * 2654435761U) >> 21; table_count[h] && table_color[h] != aImage.pixel[j]
+			; h = (h + 1) & (ANCHOR_TABLE_SIZE - 1)); // Linear probing; the table is never more than half full.
+		table_color[h] = aImage.pixel[j];
+		++table_count[h];
+	}
+	int fewest = INT_MAX;
+	for (j = 0; j < pixel_count; j += stride)
+	{
+		if (IMAGE_SCAN_IS_TRANSPARENT(aImage, j))
+			continue;
+		for (h = (aImage.pixel[j] * 2654435761U) >> 21; table_color[h] != aImage.pixel[j]; h = (h + 1) & (ANCHOR_TABLE_SIZE - 1));
+		if (table_count[h] < fewest) // Use "<" so that the earliest of several equally rare pixels is chosen.
+		{
+			fewest = table_count[h];
+			aImage.anchor = j;
+		}
+	}
+	free(table_color);
+}
+
+
+
+static bool ImageMatchesAt(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth)
+// Returns true if the image matches the screen pixels whose upper-left corner is aScreen.
+{
+	const ScanPixelType *image_row = aImage.pixel;
+	int x, y, j;
+	for (y = 0, j = 0; y < aImage.height; ++y, aScreen += aScreenWidth, image_row += aImage.width)
+	{
+		if (!aImage.variation)
+		{
+			// In exact mode, the caller has set the high-order byte of each screen pixel to zero too.
+			if (!aImage.has_transparency)
+			{
+				if (memcmp(aScreen, image_row, aImage.width * sizeof(ScanPixelType)))
+					return false;
+				j += aImage.width;
+				continue;
+			}
+			for (x = 0; x < aImage.width; ++x, ++j)
+				if (aScreen[x] != image_row[x] && !IMAGE_SCAN_IS_TRANSPARENT(aImage, j))
+					return false;
+			continue;
+		}
+		for (x = 0; x < aImage.width; ++x, ++j)
+		{
+			// Since each color component of the screen pixel can't be outside the range 0-255, checking
+			// that it differs from the image's by no more than the variation is the same as checking it
+			// against the image's component +/- the variation clamped to 0-255, as was done in the past.
+			ScanPixelType s = aScreen[x], i = image_row[x];
+			int diff;
+			if (   (diff = (int)(s & 0xFF) - (int)(i & 0xFF)) > aImage.variation || diff < -aImage.variation
+				|| (diff = (int)((s >> 8) & 0xFF) - (int)((i >> 8) & 0xFF)) > aImage.variation || diff < -aImage.variation
+				|| (diff = (int)((s >> 16) & 0xFF) - (int)((i >> 16) & 0xFF)) > aImage.variation || diff < -aImage.variation   )
+				if (!IMAGE_SCAN_IS_TRANSPARENT(aImage, j))
+					return false;
+		}
+	}
+	return true;
+}
+
+
+
+int ImageScanFind(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth, int aScreenHeight
+	, int aStartIndex)
+// Returns the index within aScreen of the upper-left corner of the first occurrence of the image that lies at
+// or after aStartIndex, or -1 if none.  Occurrences are found in the same order as in the past, namely from
+// left to right within each row, and from the top row to the bottom.  Only occurrences that lie entirely
+// within the screen are considered.  To find all occurrences, call this repeatedly, each time passing one
+// more than the index previously returned.
+{
+	if (aImage.width < 1 || aImage.height < 1 || aImage.width > aScreenWidth || aImage.height > aScreenHeight)
+		return -1;
+	int last_row = aScreenHeight - aImage.height; // The last row in which the image's top edge can lie.
+	int last_col = aScreenWidth - aImage.width;   // Same for its left edge.
+	int screen_pixel_count = aScreenWidth * aScreenHeight;
+	int i, col;
+	if (aStartIndex < 0)
+		aStartIndex = 0;
+
+	if (aImage.anchor < 0) // Every pixel is transparent, so the image matches anywhere it fits.
+	{
+		for (i = aStartIndex; i / aScreenWidth <= last_row; ++i)
+			if (i % aScreenWidth <= last_col)
+				return i;
+		return -1;
+	}
+
+	// The anchor's position within the image translates to a fixed offset from any candidate's upper-left
+	// corner.  Since that offset is constant, finding the anchor's occurrences in order also finds the
+	// candidates in order.
+	int anchor_col = aImage.anchor % aImage.width;
+	int anchor_offset = (aImage.anchor / aImage.width) * aScreenWidth + anchor_col;
+	ScanPixelType anchor_color = aImage.pixel[aImage.anchor], low = 0, high = 0;
+	if (aImage.variation)
+	{
+		int c, v = aImage.variation, shift;
+		for (low = high = 0, shift = 0; shift < 24; shift += 8)
+		{
+			c = (anchor_color >> shift) & 0xFF;
+			low |= (ScanPixelType)(c > v ? c - v : 0) << shift;
+			high |= (ScanPixelType)(c + v < 0xFF ? c + v : 0xFF) << shift;
+		}
+	}
+	for (int p = aStartIndex + anchor_offset; p < screen_pixel_count; ++p)
+	{
+		int found_at = aImage.variation
+			? PixelScanRange(aScreen + p, screen_pixel_count - p, low, high)
+			: PixelScanExact(aScreen + p, screen_pixel_count - p, anchor_color);
+		if (found_at < 0)
+			return -1;
+		p += found_at;
+		i = p - anchor_offset; // The candidate's upper-left corner.
+		if (i / aScreenWidth > last_row)
+			return -1; // This and all remaining candidates would extend past the bottom of the screen.
+		col = i % aScreenWidth;
+		if (col > last_col || col + anchor_col != p % aScreenWidth) // Image would extend past the right edge, or its anchor lies in a different row than it should.
+			continue;
+		if (ImageMatchesAt(aImage, aScreen + i, aScreenWidth))
+			return i;
+	}
+	return -1;
+}
+
+
+
+// ImageScanFindAll() divides the rows in which the image's top edge can lie into bands of this many rows, which
+// the threads take one at a time in order from the top.  Bands are small so that the threads finish at nearly
+// the same time, and so that little work is wasted past a band that has all the matches the caller wants.
+#define IMAGE_SCAN_BAND_ROWS 16
+// A thread is used only for each this many candidate positions, since for small searches, starting the thread
+// would take longer than the search itself.
+#define IMAGE_SCAN_PIXELS_PER_THREAD (512 * 1024)
+
+struct ImageScanBand
+{
+	int *found; // The matches in this band, in order.
+	int count, capacity;
+};
+
+struct ImageScanJob
+{
+	const ScanImage *image;
+	const ScanPixelType *screen;
+	int screen_width, row_count, max_count;
+	ImageScanHost *host; // NULL if the caller's thread is the only one.
+	ImageScanBand *band;
+	int band_count;
+	// The following are protected by the host's lock:
+	int next_band;    // The next band to be searched.
+	int last_band;    // Bands after this one needn't be searched, since it has max_count matches by itself.
+	int thread_count; // Worker threads that haven't yet finished.
+	bool out_of_memory;
+};
+
+
+
+static void ImageScanBands(ImageScanJob &aJob)
+// Searches bands until none remain.  This is called by the caller's thread and each worker thread.
+{
+	for (;;)
+	{
+		if (aJob.host)
+			aJob.host->Lock();
+		int b = (aJob.next_band <= aJob.last_band && !aJob.out_of_memory) ? aJob.next_band++ : -1;
+		if (aJob.host)
+			aJob.host->Unlock();
+		if (b < 0)
+			return;
+		ImageScanBand &band = aJob.band[b];
+		int first_row = b * IMAGE_SCAN_BAND_ROWS;
+		int end_row = first_row + IMAGE_SCAN_BAND_ROWS < aJob.row_count ? first_row + IMAGE_SCAN_BAND_ROWS : aJob.row_count;
+		// Passing a reduced screen height makes ImageScanFind() consider only the candidates whose top edge lies
+		// within this band, while still letting it examine all the screen pixels such a candidate covers.
+		int height = end_row - 1 + aJob.image->height;
+		bool out_of_memory = false;
+		for (int i = first_row * aJob.screen_width; band.count < aJob.max_count
+			&& (i = ImageScanFind(*aJob.image, aJob.screen, aJob.screen_width, height, i)) > -1; ++i)
+		{
+			if (band.count == band.capacity)
+			{
+				int *new_found = (int *)realloc(band.found, (band.capacity ? band.capacity * 2 : 16) * sizeof(int));
+				if (!new_found)
+				{
+					out_of_memory = true;
+					break;
+				}
+				band.found = new_found;
+				band.capacity = band.capacity ? band.capacity * 2 : 16;
+			}
+			band.found[band.count++] = i;
+		}
+		if (aJob.host)
+			aJob.host->Lock();
+		if (out_of_memory)
+			aJob.out_of_memory = true;
+		else if (band.count >= aJob.max_count && b < aJob.last_band)
+			aJob.last_band = b;
+		if (aJob.host)
+			aJob.host->Unlock();
+	}
+}
+
+
+
+static void ImageScanWorker(void *aParam)
+{
+	ImageScanJob &job = *(ImageScanJob *)aParam;
+	ImageScanHost &host = *job.host; // Kept separately because job ceases to exist once thread_count reaches zero.
+	ImageScanBands(job);
+	host.Lock();
+	if (!--job.thread_count)
+		host.Signal();
+	host.Unlock();
+}
+
+
+
+int ImageScanFindAll(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth, int aScreenHeight
+	, int aMaxCount, int *&aFound, ImageScanHost *aHost)
+// Finds the first aMaxCount occurrences of the image (see ImageScanFind()), in the same order as repeated calls
+// to ImageScanFind() would.  If aHost isn't NULL, the search is divided among several threads when the screen
+// is large enough to benefit.  Returns the number found, in which case aFound is set to a malloc()'d array of
+// their indices if that number isn't zero (otherwise NULL).  Returns -1 if there wasn't enough memory.
+{
+	aFound = NULL;
+	if (aImage.width < 1 || aImage.height < 1 || aImage.width > aScreenWidth || aImage.height > aScreenHeight
+		|| aMaxCount < 1)
+		return 0;
+	ImageScanJob job;
+	job.image = &aImage;
+	job.screen = aScreen;
+	job.screen_width = aScreenWidth;
+	job.row_count = aScreenHeight - aImage.height + 1; // The rows in which the image's top edge can lie.
+	job.max_count = aMaxCount;
+	job.host = NULL;
+	job.band_count = (job.row_count + IMAGE_SCAN_BAND_ROWS - 1) / IMAGE_SCAN_BAND_ROWS;
+	if (   !(job.band = (ImageScanBand *)calloc(job.band_count, sizeof(ImageScanBand)))   )
+		return -1;
+	job.next_band = 0;
+	job.last_band = job.band_count - 1;
+	job.thread_count = 0;
+	job.out_of_memory = false;
+
+	if (aHost)
+	{
+		int thread_count = aHost->ThreadCount();
+		int worthwhile = job.row_count * aScreenWidth / IMAGE_SCAN_PIXELS_PER_THREAD;
+		if (thread_count > worthwhile)
+			thread_count = worthwhile;
+		if (thread_count > job.band_count)
+			thread_count = job.band_count;
+		if (thread_count > 1)
+		{
+			job.host = aHost;
+			aHost->Lock(); // Each worker decrements thread_count, so it must not be able to do so before it's incremented.
+			for (int t = 1; t < thread_count && aHost->StartThread(ImageScanWorker, &job); ++t)
+				++job.thread_count;
+			aHost->Unlock();
+		}
+	}
+	ImageScanBands(job); // The caller's thread searches too, and is the only one if no workers could be started.
+	if (job.host)
+	{
+		job.host->Lock();
+		while (job.thread_count)
+			job.host->Wait();
+		job.host->Unlock();
+	}
+
+	// Since every band up to last_band has been searched in full, the first aMaxCount matches of the bands taken
+	// in order are the first aMaxCount matches overall.  Any matches in the bands after last_band (which were
+	// being searched when it was set) come after those, so they're discarded.
+	int count = 0, b;
+	for (b = 0; b < job.band_count; ++b)
+		count += job.band[b].count;
+	if (count > aMaxCount)
+		count = aMaxCount;
+	if (!job.out_of_memory && count && !(aFound = (int *)malloc(count * sizeof(int))))
+		job.out_of_memory = true;
+	int n = 0;
+	for (b = 0; b < job.band_count; ++b)
+	{
+		for (int j = 0; aFound && j < job.band[b].count && n < count; ++j)
+			aFound[n++] = job.band[b].found[j];
+		free(job.band[b].found);
+	}
+	free(job.band);
+	if (job.out_of_memory)
+	{
+		free(aFound);
+		aFound = NULL;
+		return -1;
+	}
+	return count;
+}
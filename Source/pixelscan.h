@@ -0,0 +1,80 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef pixelscan_h
+#define pixelscan_h
+
+// The functions in this file search arrays of 32-bit pixels such as those produced by getbits(), in which
+// each pixel is in 0x00RRGGBB format (the high-order byte is ignored).  They are kept separate from the
+// GDI code that captures the screen so that they depend on nothing but the core language (and SSE2
+// intrinsics where the compiler provides them), which allows them to be compiled and exercised on any
+// platform with synthetic buffers.
+//
+// When the CPU supports SSE2, four pixels are compared per instruction.  Otherwise, a plain loop is used
+// that yields identical results.  In either case, the pixels are searched in order from lowest to highest
+// index, so the index returned is always that of the first match (except for PixelScanFind(), which can also
+// search in the reverse order).  test/pixelscan_test.cpp checks the two against each other.
+
+typedef unsigned int ScanPixelType; // Same size and layout as COLORREF, but without depending on the Windows headers.
+
+void PixelScanMask(ScanPixelType *aPixel, int aCount, ScanPixelType aMask);
+int PixelScanExact(const ScanPixelType *aPixel, int aCount, ScanPixelType aColor);
+int PixelScanRange(const ScanPixelType *aPixel, int aCount, ScanPixelType aLow, ScanPixelType aHigh);
+int PixelScanFind(const ScanPixelType *aPixel, int aWidth, int aHeight, ScanPixelType aLow, ScanPixelType aHigh
+	, bool aRightToLeft, bool aBottomToTop);
+bool PixelScanUsesSSE2();
+void PixelScanAllowSSE2(bool aAllow);
+
+// ScanImage describes an image to be located within a larger array of pixels (such as by ImageSearch).
+// The caller fills in the first group of members, then calls ImageScanPrepare() once, after which the
+// image may be searched for any number of times via ImageScanFind().
+struct ScanImage
+{
+	const ScanPixelType *pixel; // The image's pixels, each of whose high-order byte the caller must have set to zero.
+	const ScanPixelType *mask;  // NULL, or an array in which each non-zero item marks the corresponding pixel as transparent.
+	ScanPixelType trans_color;  // Pixels of this color are transparent too.  Use one with a non-zero high-order byte for none.
+	int width, height;
+	int variation; // How many shades each color component may differ from the image's.  Zero means an exact match.
+	// The following are set by ImageScanPrepare():
+	int anchor; // Index of the opaque pixel used to locate candidate positions, or -1 if every pixel is transparent.
+	bool has_transparency;
+};
+
+void ImageScanPrepare(ScanImage &aImage);
+int ImageScanFind(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth, int aScreenHeight
+	, int aStartIndex);
+
+class ImageScanHost
+// What ImageScanFindAll() needs in order to search on several threads at once.  In the program, this is
+// ImageSearchHost in script2.cpp; test/pixelscan_test.cpp has one that uses POSIX threads.  All members except
+// ThreadCount() and StartThread() may be called from any thread.
+{
+public:
+	virtual ~ImageScanHost() {}
+	virtual int ThreadCount() = 0; // The most threads worth using at once, counting the caller's own.
+	virtual bool StartThread(void (*aProc)(void *), void *aParam) = 0;
+	virtual void Lock() = 0;
+	virtual void Unlock() = 0;
+	// Wait() is called with the lock held.  It must release the lock, wait until Signal() has been called at
+	// least once since the last Wait() returned, then reacquire the lock (i.e. an auto-reset event).
+	virtual void Wait() = 0;
+	virtual void Signal() = 0;
+};
+
+int ImageScanFindAll(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth, int aScreenHeight
+	, int aMaxCount, int *&aFound, ImageScanHost *aHost);
+
+#endif
@@ -0,0 +1,147 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "proccache.h"
+
+
+
+ProcessCache::ProcessCache(ProcessProvider &aProvider, unsigned aMaxAge)
+	: mProvider(aProvider), mMaxAge(aMaxAge), mItem(NULL), mCount(0), mCapacity(0), mBucket(NULL)
+	, mBucketCount(0), mTick(0), mIsValid(false), mEnumerateCount(0), mReuseCount(0)
+{
+}
+
+
+
+ProcessCache::~ProcessCache()
+{
+	free(mItem);
+	free(mBucket);
+}
+
+
+
+unsigned ProcessCache::HashName(const char *aName)
+// The hash is case-insensitive to agree with the comparison done by Find().
+{
+	unsigned hash = 0;
+	for (; *aName; ++aName)
+		hash = hash * 31 + (unsigned char)tolower((unsigned char)*aName);
+	return hash;
+}
+
+
+
+bool ProcessCache::Update()
+{
+	if (mIsValid && mProvider.TickCount() - mTick < mMaxAge)
+	{
+		++mReuseCount;
+		return true;
+	}
+	mIsValid = false;
+	mCount = 0;
+	++mEnumerateCount;
+	if (!mProvider.Enumerate(*this) || !BuildIndex())
+	{
+		mCount = 0;
+		return false;
+	}
+	mTick = mProvider.TickCount();
+	mIsValid = true;
+	return true;
+}
+
+
+
+bool ProcessCache::Add(unsigned aPID, const char *aName)
+{
+	if (mCount == mCapacity)
+	{
+		int new_capacity = mCapacity ? mCapacity * 2 : 128;
+		Item *new_item = (Item *)realloc(mItem, new_capacity * sizeof(Item));
+		if (!new_item)
+			return false;
+		mItem = new_item;
+		mCapacity = new_capacity;
+	}
+	Item &item = mItem[mCount++];
+	item.pid = aPID;
+	strncpy(item.name, aName, PROCESS_NAME_SIZE - 1);
+	item.name[PROCESS_NAME_SIZE - 1] = '\0';
+	return true;
+}
+
+
+
+bool ProcessCache::BuildIndex()
+{
+	// Use about as many buckets as there are processes, so that chains stay short however many there are.
+	int bucket_count;
+	for (bucket_count = 64; bucket_count < mCount; bucket_count <<= 1);
+	if (bucket_count > mBucketCount)
+	{
+		int *new_bucket = (int *)realloc(mBucket, 2 * bucket_count * sizeof(int));
+		if (!new_bucket)
+			return false;
+		mBucket = new_bucket;
+		mBucketCount = bucket_count;
+	}
+	int i, *name_bucket = mBucket, *pid_bucket = mBucket + mBucketCount;
+	for (i = 0; i < 2 * mBucketCount; ++i)
+		mBucket[i] = -1;
+	// Build the index in reverse so that each bucket's chain ends up in list order, which preserves the
+	// old behavior of reporting the first matching process.
+	for (i = mCount - 1; i > -1; --i)
+	{
+		int &name_head = name_bucket[HashName(mItem[i].name) & (mBucketCount - 1)];
+		mItem[i].next_by_name = name_head;
+		name_head = i;
+		int &pid_head = pid_bucket[HashPID(mItem[i].pid) & (mBucketCount - 1)];
+		mItem[i].next_by_pid = pid_head;
+		pid_head = i;
+	}
+	return true;
+}
+
+
+
+int ProcessCache::Find(unsigned aPID, const char *aName)
+{
+	if (!mCount)
+		return -1;
+	int pid_index = -1, name_index;
+	if (aPID)
+		for (pid_index = mBucket[mBucketCount + (HashPID(aPID) & (mBucketCount - 1))]
+			; pid_index > -1 && mItem[pid_index].pid != aPID
+			; pid_index = mItem[pid_index].next_by_pid);
+	// The comparison is the equivalent of stricmp() rather than lstrcmpi(): 1) avoids breaking existing scripts;
+	// 2) provides consistent behavior across multiple locales; 3) performance.
+	for (name_index = mBucket[HashName(aName) & (mBucketCount - 1)]; name_index > -1
+		; name_index = mItem[name_index].next_by_name)
+	{
+		const char *cp1 = mItem[name_index].name, *cp2 = aName;
+		for (; *cp1 && tolower((unsigned char)*cp1) == tolower((unsigned char)*cp2); ++cp1, ++cp2);
+		if (!*cp1 && !*cp2)
+			break;
+	}
+	// Whichever match comes first in the list is the one reported:
+	return (pid_index > -1 && (name_index < 0 || pid_index < name_index)) ? pid_index : name_index;
+}
@@ -0,0 +1,89 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef proccache_h
+#define proccache_h
+
+// ProcessCache keeps the most recent list of running processes for a short time so that callers which check
+// many windows or processes in a burst (e.g. WinGet ProcessName for each window in a list, or a timer that
+// checks on several processes by name every few hundred milliseconds) needn't enumerate every process in the
+// system for each check.  The list is indexed both by name (case-insensitively, like stricmp()) and by PID,
+// so a lookup needn't scan it.  When several processes match, the first in the order the system listed them
+// is reported, as has always been the case.  The program calls Invalidate() whenever the script itself
+// launches or closes a process so that a check made immediately afterward reflects the change.
+//
+// The processes and the clock are reached only through a ProcessProvider.  The program uses one based on the
+// Toolhelp snapshot (in script_autoit.cpp); test/proccache_test.cpp uses a fake one and one that reads /proc,
+// which test/proccache_bench.cpp also uses.  Keep this file free of anything those programs can't compile
+// outside Windows.
+
+#define PROCESS_NAME_SIZE 260 // Same as MAX_PATH.
+
+class ProcessCache;
+
+class ProcessProvider
+{
+public:
+	virtual ~ProcessProvider() {}
+	// Calls aCache.Add() for each running process in the order the system lists them, stopping early if
+	// Add() returns false.  Returns false if the processes can't be enumerated at all.
+	virtual bool Enumerate(ProcessCache &aCache) = 0;
+	virtual unsigned TickCount() = 0; // Milliseconds, wrapping around like GetTickCount().
+};
+
+class ProcessCache
+{
+	struct Item
+	{
+		unsigned pid;
+		int next_by_name, next_by_pid; // Index of the next item in the same bucket (in list order), or -1 if none.
+		char name[PROCESS_NAME_SIZE];
+	};
+	ProcessProvider &mProvider;
+	unsigned mMaxAge;
+	Item *mItem;
+	int mCount, mCapacity;
+	int *mBucket; // mBucketCount buckets for names followed by as many for PIDs.  Each holds an index or -1.
+	int mBucketCount; // A power of two.
+	unsigned mTick; // When the list was made.
+	bool mIsValid;
+	unsigned mEnumerateCount, mReuseCount;
+
+	static unsigned HashName(const char *aName);
+	static unsigned HashPID(unsigned aPID) {return aPID ^ (aPID >> 7);} // Windows PIDs are multiples of 4.
+	bool BuildIndex();
+
+public:
+	ProcessCache(ProcessProvider &aProvider, unsigned aMaxAge);
+	~ProcessCache();
+	// Makes a new list of processes unless the current one is no older than the cache's maximum age.
+	// Returns false if the processes couldn't be enumerated, in which case Count() is 0.
+	bool Update();
+	void Invalidate() {mIsValid = false;}
+	// Returns the index of the first process in the list whose PID is aPID (if non-zero) or whose name is
+	// aName, or -1 if there is none.
+	int Find(unsigned aPID, const char *aName);
+	int Count() {return mCount;}
+	unsigned PID(int aIndex) {return mItem[aIndex].pid;}
+	const char *Name(int aIndex) {return mItem[aIndex].name;}
+	// For use by ProcessProvider::Enumerate().  aName should have no path.  Returns false if there's
+	// insufficient memory, in which case the processes added so far are kept.
+	bool Add(unsigned aPID, const char *aName);
+	unsigned EnumerateCount() {return mEnumerateCount;} // Calls to ProcessProvider::Enumerate() so far.
+	unsigned ReuseCount() {return mReuseCount;} // Calls to Update() that reused the list so far.
+};
+
+#endif
@@ -18,9 +18,9 @@ GNU General Public License for more details.
 #include "script.h"
 #include "globaldata.h" // for a lot of things
 #include "util.h" // for strlcpy() etc.
-#include "mt19937ar-cok.h" // for random number generator
 #include "window.h" // for a lot of things
 #include "application.h" // for MsgSleep()
+#include "derefpool.h" // for DerefBufPool
 
 // Globals that are for only this module:
 #define MAX_COMMENT_FLAG_LENGTH 15
@@ -47,6 +47,9 @@ Script::Script()
 	, mFirstTimer(NULL), mLastTimer(NULL), mTimerEnabledCount(0), mTimerCount(0)
 	, mFirstMenu(NULL), mLastMenu(NULL), mMenuCount(0)
 	, mVar(NULL), mVarCount(0), mVarCountMax(0), mLazyVar(NULL), mLazyVarCount(0)
+#ifdef REPORT_EXIT_STATS
+	, mPackedElementsStored(0), mPackedElementsMadeVars(0)
+#endif
 	, mCurrentFuncOpenBlockCount(0), mNextLineIsFunctionBody(false)
 	, mFuncExceptionVar(NULL), mFuncExceptionVarCount(0)
 	, mCurrFileIndex(0), mCombinedLineNumber(0), mNoHotkeyLabels(true), mMenuUseErrorLevel(false)
@@ -69,6 +72,7 @@ Script::Script()
 	// that would otherwise occur.
 	*mThisMenuItemName = *mThisMenuName = '\0';
 	ZeroMemory(&mNIC, sizeof(mNIC));  // Constructor initializes this, to be safe.
+	ZeroMemory(mMenuItemByID, sizeof(mMenuItemByID)); // Its pages are allocated on first use by MenuItemIDSlot().
 	mNIC.hWnd = NULL;  // Set this as an indicator that it tray icon is not installed.
 
 	// Lastly (after the above have been initialized), anything that can fail:
@@ -119,6 +123,17 @@ Script::~Script() // Destructor.
 	// MSDN: "Before terminating, an application must call the UnhookWindowsHookEx function to free
 	// system resources associated with the hook."
 	AddRemoveHooks(0); // Remove all hooks.
+	FileWriterCloseAll(); // Write out any text that FileAppend is still holding in a buffer.
+#ifdef REPORT_EXIT_STATS // See defines.h.
+	Line::ReportDerefBufPool();
+	ReportFileWriters();
+	ReportHookLatency(); // Must be done after AddRemoveHooks() above so that the hook thread is no longer updating the figures.
+	ReportPureNumeric();
+	ReportMsgMonitors();
+	ReportPackedArrays();
+	ReportFileCopies();
+	ReportDownloads();
+#endif
 	if (mNIC.hWnd) // Tray icon is installed.
 		Shell_NotifyIcon(NIM_DELETE, &mNIC); // Remove it.
 	// Destroy any Progress/SplashImage windows that haven't already been destroyed.  This is necessary
@@ -651,6 +666,7 @@ ResultType Script::AutoExecSection()
 
 		KILL_AUTOEXEC_TIMER // See also: AutoExecSectionTimeout().
 		mAutoExecSectionIsRunning = false;
+		FileWriterFlushAll(); // As with any other thread that finishes (see ResumeUnderlyingThread()).
 	}
 	// REMEMBER: The ExecUntil() call above will never return if the AutoExec section never finishes
 	// (e.g. infinite loop) or it uses Exit/ExitApp.
@@ -5452,6 +5468,8 @@ ResultType Script::AddLine(ActionTypeType aActionType, char *aArg[], ArgCountTyp
 			case GUI_CMD_DESTROY:
 			case GUI_CMD_DEFAULT:
 			case GUI_CMD_OPTIONS:
+			case GUI_CMD_BEGINUPDATE:
+			case GUI_CMD_ENDUPDATE:
 				if (aArgc > 1)
 					return ScriptError("Parameter #2 and beyond should be omitted in this case.", new_raw_arg2);
 				break;
@@ -5682,6 +5700,18 @@ ResultType Script::AddLine(ActionTypeType aActionType, char *aArg[], ArgCountTyp
 			return ScriptError(ERR_PARAM2_INVALID, new_raw_arg2);
 		break;
 
+	case ACT_FILEBUFFER:
+		if (!line.ArgHasDeref(1) && stricmp(new_raw_arg1, "On") && stricmp(new_raw_arg1, "Off")
+			&& stricmp(new_raw_arg1, "Flush"))
+			return ScriptError(ERR_PARAM1_INVALID, new_raw_arg1);
+		break;
+
+	case ACT_PIXELCAPTURE:
+		if (!line.ArgHasDeref(1) && stricmp(new_raw_arg1, "Pin") && stricmp(new_raw_arg1, "Unpin")
+			&& stricmp(new_raw_arg1, "MaxAge"))
+			return ScriptError(ERR_PARAM1_INVALID, new_raw_arg1);
+		break;
+
 	case ACT_PIXELSEARCH:
 	case ACT_IMAGESEARCH:
 		if (!*new_raw_arg3 || !*new_raw_arg4 || !*NEW_RAW_ARG5 || !*NEW_RAW_ARG6 || !*NEW_RAW_ARG7)
@@ -7492,6 +7522,20 @@ Var *Line::ResolveVarOfArg(int aArgIndex, bool aCreateIfNecessary)
 		// by allowing this command to resolve to a local first if such a local exists:
 		if (found_var = g_script.FindVar(sVarName, var_name_length, NULL, ALWAYS_PREFER_LOCAL)) // Assign.
 			return found_var;
+		// An element of a packed array (see Script::StoreArrayElement) is given to the caller as a separate
+		// temporary variable for each arg, since the caller might need more than one at a time.  Each holds
+		// a copy of the element so that nothing this line does can invalidate it.  This avoids making the
+		// element into a permanent variable just to read it:
+		char *element;
+		size_t element_length;
+		if (g_script.mPackedArrays.Count() && g_script.GetPackedElement(sVarName, var_name_length, element, element_length))
+		{
+			static Var *sPackedElementVar[MAX_ARGS]; // Each is created upon first use.  Must use sVarName for the same reason as empty_var above.
+			Var *&element_var = sPackedElementVar[aArgIndex];
+			if (!element_var && !(element_var = new Var(sVarName, (void *)VAR_NORMAL, false)))
+				return NULL; // Above already displayed the error.
+			return element_var->Assign(element, (VarSizeType)element_length) ? element_var : NULL;
+		}
 		// At this point, this is either a non-existent variable or a reserved/built-in variable
 		// that was never statically referenced in the script (only dynamically), e.g. A_IPAddress%A_Index%
 		if (Script::GetVarType(sVarName) == (void *)VAR_NORMAL)
@@ -7531,6 +7575,24 @@ Var *Script::FindOrAddVar(char *aVarName, size_t aVarNameLength, int aAlwaysUse,
 	Var *var;
 	if (var = FindVar(aVarName, aVarNameLength, &insert_pos, aAlwaysUse, apIsException, &is_local))
 		return var;
+	// If the name is that of an element of a packed array, that element takes the place of an existing
+	// global variable, so it must become one now.  This applies wherever FindVar() would have fallen back
+	// to an existing global (see the end of FindVar()):
+	char *element;
+	size_t element_length;
+	if (mPackedArrays.Count()
+		&& (!is_local || aAlwaysUse == ALWAYS_PREFER_LOCAL || aAlwaysUse == ALWAYS_USE_DEFAULT && mIsReadyToExecute)
+		&& GetPackedElement(aVarName, aVarNameLength, element, element_length))
+	{
+		if (is_local) // Get the global insertion point instead.
+			FindVar(aVarName, aVarNameLength, &insert_pos, ALWAYS_USE_GLOBAL);
+		if (   !(var = AddVar(aVarName, aVarNameLength, insert_pos, false))   )
+			return NULL;
+#ifdef REPORT_EXIT_STATS
+		++mPackedElementsMadeVars;
+#endif
+		return var->Assign(element, (VarSizeType)element_length) ? var : NULL;
+	}
 	// Otherwise, no match found, so create a new var.  This will return NULL if there was a problem,
 	// in which case AddVar() will already have displayed the error:
 	return AddVar(aVarName, aVarNameLength, insert_pos, is_local);
@@ -7961,6 +8023,97 @@ Var *Script::AddVar(char *aVarName, size_t aVarNameLength, int aInsertPos, int a
 
 
 
+bool Script::GetPackedElement(char *aVarName, size_t aVarNameLength, char *&aElement, size_t &aElementLength)
+// If aVarName (of length aVarNameLength, or zero-terminated if that is zero) is the name of an existing
+// element of a packed array (e.g. Array12 when the array "Array" has at least 12 elements), sets aElement
+// to its zero-terminated contents and aElementLength to its length, then returns true.  Caller must ensure
+// that no variable of that name exists, since any such variable takes precedence over the element.
+// If the name belongs to more than one array (Array12 is also element 2 of "Array1"), the element that
+// was stored most recently wins, just as the variable would have held the value assigned last.
+{
+	const char *element;
+	if (!mPackedArrays.Get(aVarName, aVarNameLength ? aVarNameLength : strlen(aVarName), element, aElementLength))
+		return false;
+	aElement = (char *)element; // Caller treats it as read-only.
+	return true;
+}
+
+
+
+ResultType Script::SetPackedArray(char *aBaseName, PackedStringArray &aArray)
+// Makes aArray the contents of the packed array named aBaseName (e.g. "Array" for Array1, Array2, etc.),
+// creating that array if necessary.  aArray is left empty; its contents are taken rather than copied.  As
+// with the separate variables used traditionally, any elements beyond the new count keep their old values.
+{
+	if (!mPackedArrays.Set(aBaseName, aArray))
+		return ScriptError(ERR_OUTOFMEM);
+	return OK;
+}
+
+
+
+void Script::ReleasePackedArray(Var &aCountVar)
+// Called when the script frees aCountVar via VarSetCapacity(Var, 0).  If it's the count of a global
+// pseudo-array (e.g. Array0), the packed elements of that array are freed too, since they'd otherwise
+// stay in memory until the script exits.  Elements that are variables are unaffected.
+{
+	Var &var = *aCountVar.ResolveAlias();
+	if (var.IsLocal())
+		return;
+	size_t name_length = strlen(var.mName);
+	if (name_length > 1 && var.mName[name_length - 1] == '0')
+		mPackedArrays.Release(var.mName, name_length - 1);
+}
+
+
+
+ResultType Script::StoreArrayElement(char *aVarName, char *aVarNameSuffix, UINT aNumber, int aAlwaysUse
+	, PackedStringArray *aPacked, char *aValue, size_t aLength)
+// Stores aValue (aLength chars, need not be terminated) in element #aNumber of a pseudo-array.  aVarName is
+// a buffer containing the array's name, whose end is at aVarNameSuffix.  If aPacked is NULL, the element is
+// a variable, created if necessary.  Otherwise, the array is global and the element is appended to aPacked,
+// which the caller later passes to SetPackedArray().  In that case, a variable is still updated if one
+// already exists by that name, since it takes precedence over the packed element; this keeps variables
+// like Array1 that are referenced directly by the script working as before.  This avoids creating a
+// variable per element, which for large arrays means a lot of memory that can never be freed and a
+// variable list that must be kept sorted.
+{
+	_ultoa(aNumber, aVarNameSuffix, 10);
+	Var *element;
+	if (aPacked)
+	{
+		if (!aPacked->Append(aValue, aLength))
+			return ScriptError(ERR_OUTOFMEM);
+#ifdef REPORT_EXIT_STATS
+		++mPackedElementsStored;
+#endif
+		if (   !(element = FindVar(aVarName, 0, NULL, ALWAYS_USE_GLOBAL))   )
+			return OK;
+	}
+	else if (   !(element = FindOrAddVar(aVarName, 0, aAlwaysUse))   )
+		return FAIL;  // It will have already displayed the error.
+	return element->Assign(aValue, (VarSizeType)aLength);
+}
+
+
+
+#ifdef REPORT_EXIT_STATS
+void Script::ReportPackedArrays()
+// Sends to the debugger (or a tool such as DebugView) how many pseudo-array elements were stored packed
+// rather than as variables, how many of those later had to become variables, and the memory still in use.
+{
+	if (!mPackedElementsStored)
+		return;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "Packed arrays: %u elements stored, %u made into variables; %d arrays holding %u elements in %u bytes\n"
+		, mPackedElementsStored, mPackedElementsMadeVars, mPackedArrays.Count(), mPackedArrays.ElementCount()
+		, (UINT)mPackedArrays.MemoryUsed());
+	OutputDebugString(buf);
+}
+#endif
+
+
+
 void *Script::GetVarType(char *aVarName)
 {
 	// Convert to lowercase to help performance a little (it typically only helps loadtime performance because
@@ -8144,6 +8297,10 @@ void *Script::GetVarType(char *aVarName)
 	if (!strcmp(lower, "timesincepriorhotkey")) return BIV_TimeSincePriorHotkey;
 	if (!strcmp(lower, "endchar")) return BIV_EndChar;
 	if (!strcmp(lower, "lasterror")) return BIV_LastError;
+	if (   !strcmp(lower, "downloadbytes")
+		|| !strcmp(lower, "downloadconnecttime")
+		|| !strcmp(lower, "downloadfirstbytetime")
+		|| !strcmp(lower, "downloadtime")) return BIV_Download; // Figures of the most recent UrlDownloadToFile.
 
 	if (!strcmp(lower, "eventinfo")) return BIV_EventInfo; // It's called "EventInfo" vs. "GuiEventInfo" because it applies to non-Gui events such as OnClipboardChange.
 	if (!strcmp(lower, "guicontrol")) return BIV_GuiControl;
@@ -9839,13 +9996,16 @@ end_of_infix_to_postfix:
 		new_token = *postfix[i]; // Struct copy.  This also sets circuit_token to NULL for those circuit_tokens not overridden later below.
 		if (new_token.symbol == SYM_OPERAND)
 		{
-			if (IsPureNumeric(new_token.marker, true, false, true) != PURE_INTEGER)
-				new_token.buf = NULL; // Indicate that this SYM_OPERAND token LACKS a pre-converted binary integer.
-			else // Pre-convert to binary integer, which can increase performance of complex expressions by up to 20%.
+			// Classify the literal and pre-convert it to binary, which can increase performance of complex
+			// expressions by up to 20%.  Floats and non-numeric literals are also remembered so that they
+			// aren't reclassified every time the expression is evaluated.
+			if (   !(new_token.buf = SimpleHeap::Malloc(sizeof(OperandNumberType)))   )
+				return LineError(ERR_OUTOFMEM);
+			OperandNumberType &number = *OPERAND_NUMBER(new_token);
+			switch (number.symbol = IsPureNumeric(new_token.marker, true, false, true))
 			{
-				if (   !(new_token.buf = SimpleHeap::Malloc(sizeof(__int64)))   )
-					return LineError(ERR_OUTOFMEM);
-				*(__int64 *)new_token.buf = ATOI64(new_token.marker);
+			case PURE_INTEGER: number.value_int64 = ATOI64(new_token.marker); break;
+			case PURE_FLOAT: number.value_double = ATOF(new_token.marker); break;
 			}
 		}
 		if (new_token.circuit_token) // Adjust each circuit_token address to be relative to the new array rather than the temp/infix array.
@@ -9903,6 +10063,47 @@ void Line::FreeDerefBufIfLarge()
 
 
 
+// The deref buffers that no layer of ExpandArgs() is using (see derefpool.h).  Both limits are small compared
+// to LARGE_DEREF_BUF_SIZE, larger buffers being freed by a timer instead.
+static DerefBufPool sDerefBufPool(DEREF_BUF_EXPAND_INCREMENT, LARGE_DEREF_BUF_SIZE / 4, LARGE_DEREF_BUF_SIZE / 2);
+
+
+
+char *Line::DerefBufAlloc(size_t &aSize)
+// Returns a buffer whose size is at least aSize, or NULL if there is insufficient memory.  Upon success,
+// aSize is updated to be the actual size of the buffer, which the caller should remember so that it
+// can pass it to DerefBufRelease() when it's done with the buffer.
+{
+	return sDerefBufPool.Alloc(aSize);
+}
+
+
+
+void Line::DerefBufRelease(char *aBuf, size_t aSize)
+// aBuf must be a non-NULL buffer that was returned by DerefBufAlloc() (or otherwise malloc'd), and aSize
+// must be its size.  The caller is responsible for adjusting sLargeDerefBufs if appropriate.
+{
+	sDerefBufPool.Release(aBuf, aSize);
+}
+
+
+
+#ifdef REPORT_EXIT_STATS
+void Line::ReportDerefBufPool()
+// Sends the deref buffer pool's statistics to the debugger (or a tool such as DebugView).
+{
+	if (!(sDerefBufPool.Hits() || sDerefBufPool.Misses()))
+		return;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "Deref buffers: %u allocated, %u reused from pool, %u discarded (pool full)"
+		", %d idle (%u KB)\n", sDerefBufPool.Misses(), sDerefBufPool.Hits(), sDerefBufPool.Discards()
+		, sDerefBufPool.IdleCount(), (unsigned)(sDerefBufPool.IdleSize() / 1024));
+	OutputDebugString(buf);
+}
+#endif
+
+
+
 ResultType Line::ExecUntil(ExecUntilMode aMode, char **apReturnValue, Line **apJumpToLine)
 // Start executing at "this" line, stop when aMode indicates.
 // RECURSIVE: Handles all lines that involve flow-control.
@@ -10450,6 +10651,8 @@ ResultType Line::ExecUntil(ExecUntilMode aMode, char **apReturnValue, Line **apJ
 				break;
 			case ATTR_LOOP_READ_FILE:
 				FILE *read_file;
+				if (g_FileWriterCount) // Let it read any text that FileAppend is holding in a buffer (see FileBuffer).
+					FileWriterFlushAll();
 				if (*ARG2 && (read_file = fopen(ARG2, "r"))) // v1.0.47: Added check for "" to avoid debug-assertion failure while in debug mode (maybe it's bad to to open file "" in release mode too).
 				{
 					result = line->PerformLoopReadFile(apReturnValue, continue_main_loop, jump_to_line, read_file, ARG3);
@@ -10696,6 +10899,73 @@ ResultType Line::ExecUntil(ExecUntilMode aMode, char **apReturnValue, Line **apJ
 
 
 
+struct MatchListCache
+{
+	ListMatcher matcher;
+	Var::Stamp verified; // When the variables referenced by the list were last known to yield matcher's source.
+};
+
+
+
+bool Line::ArgDerefsChangedSince(int aArgIndex, const Var::Stamp &aStamp)
+// Returns true unless the expanded text of the arg is certain to be the same as it was at aStamp, which is
+// the case only if every reference in it is to a normal variable whose contents haven't changed since.
+// A blank variable doesn't count as unchanged unless #NoEnv is in effect because an environment variable
+// of the same name would be used in its place.
+{
+	for (DerefType *deref = mArg[aArgIndex].deref; deref && deref->marker; ++deref)
+		if (deref->is_function || deref->var->Type() != VAR_NORMAL || deref->var->ChangedSince(aStamp)
+			|| !g_NoEnv && !deref->var->HasContents())
+			return true;
+	return false;
+}
+
+
+
+bool Line::IsInMatchList(char *aStr, char *aList, bool aFindExactMatch)
+// Does the work of "if var [not] in/contains MatchList" (aList being the expanded ARG2) using a ListMatcher
+// cached in mAttribute, which is otherwise unused by these commands.  This makes the cost of each evaluation
+// independent of the number of items in the list.  Since compiling costs more than a single call to
+// IsStringInList(), a list containing variable references is compiled only once it has been seen twice in
+// a row with the same contents; a list that changes every time keeps using IsStringInList() (at the cost of
+// remembering the list).  Short lists and "StringCaseSense Locale" also keep using IsStringInList().
+// Once a list with variable references has been compared with the compiled one, it isn't compared again
+// until one of those variables changes (see Var::ChangedSince()), so a long list in a variable costs the
+// same as a literal one.
+{
+	#define MATCH_LIST_MIN_LENGTH 64 // Below this, IsStringInList() is about as fast as a compiled list.
+	if (g->StringCaseSense == SCS_INSENSITIVE_LOCALE)
+		return IsStringInList(aStr, aList, aFindExactMatch);
+	size_t list_length = ArgLength(2);
+	if (list_length < MATCH_LIST_MIN_LENGTH)
+		return IsStringInList(aStr, aList, aFindExactMatch);
+	bool case_sensitive = (g->StringCaseSense != SCS_INSENSITIVE); // Other modes use strcmp/strstr (see strcmp2).
+	MatchListCache *cache = (MatchListCache *)mAttribute;
+	if (!cache)
+	{
+		if (   !(cache = new MatchListCache)   )
+			return IsStringInList(aStr, aList, aFindExactMatch);
+		mAttribute = cache; // Never deleted, like the line itself.
+	}
+	else if (cache->matcher.IsCompiled() && cache->matcher.IsCaseSensitive() == case_sensitive
+		&& !ArgDerefsChangedSince(1, cache->verified)) // Always false for a literal list.
+		return cache->matcher.Match(aStr);
+	ListMatcher *matcher = &cache->matcher;
+	bool source_changed = !matcher->SourceEquals(aList, list_length, case_sensitive);
+	cache->verified = Var::Now();
+	if (source_changed)
+	{
+		// The list is new or has changed.  Unless the list is literal, wait to see if it stays this way.
+		if (!matcher->SetSource(aList, list_length, case_sensitive) || ArgHasDeref(2))
+			return IsStringInList(aStr, aList, aFindExactMatch);
+	}
+	if (!matcher->IsCompiled() && (matcher->CompileFailed() || !matcher->Compile(!aFindExactMatch, LINE_SIZE - 2)))
+		return IsStringInList(aStr, aList, aFindExactMatch); // LINE_SIZE - 2 is the longest item that IsStringInList() keeps whole.
+	return matcher->Match(aStr);
+}
+
+
+
 ResultType Line::EvaluateCondition() // __forceinline on this reduces benchmarks, probably because it reduces caching effectiveness by having code in the case that doesn't execute much in the benchmarks.
 // Returns CONDITION_TRUE or CONDITION_FALSE (FAIL is returned only in DEBUG mode).
 {
@@ -10881,14 +11151,14 @@ ResultType Line::EvaluateCondition() // __forceinline on this reduces benchmarks
 
 	case ACT_IFIN:
 	case ACT_IFNOTIN:
-		if_condition = IsStringInList(ARG1, ARG2, true);
+		if_condition = IsInMatchList(ARG1, ARG2, true);
 		if (mActionType == ACT_IFNOTIN)
 			if_condition = !if_condition;
 		break;
 
 	case ACT_IFCONTAINS:
 	case ACT_IFNOTCONTAINS:
-		if_condition = IsStringInList(ARG1, ARG2, false);
+		if_condition = IsInMatchList(ARG1, ARG2, false);
 		if (mActionType == ACT_IFNOTCONTAINS)
 			if_condition = !if_condition;
 		break;
@@ -11031,10 +11301,12 @@ ResultType Line::EvaluateCondition() // __forceinline on this reduces benchmarks
 		break;
 
 	case ACT_IFEXIST:
-		if_condition = DoesFilePatternExist(ARG1);
-		break;
 	case ACT_IFNOTEXIST:
-		if_condition = !DoesFilePatternExist(ARG1);
+		if (g_FileWriterCount) // Let it see the true size and time of a file that FileAppend is buffering.
+			FileWriterFlushAll();
+		if_condition = DoesFilePatternExist(ARG1);
+		if (mActionType == ACT_IFNOTEXIST)
+			if_condition = !if_condition;
 		break;
 
 	case ACT_IFMSGBOX:
@@ -11187,41 +11459,40 @@ ResultType Line::PerformLoopFilePattern(char **apReturnValue, bool &aContinueMai
 	// and we will need the path string for every loop iteration.  We also need
 	// to determine naked_filename_or_pattern:
 	char file_path[MAX_PATH], naked_filename_or_pattern[MAX_PATH]; // Giving +3 extra for "*.*" seems fairly pointless because any files that actually need that extra room would fail to be retrieved by FindFirst/Next due to their inability to support paths much over 256.
-	size_t file_path_length;
 	strlcpy(file_path, aFilePattern, sizeof(file_path));
 	char *last_backslash = strrchr(file_path, '\\');
 	if (last_backslash)
 	{
 		strcpy(naked_filename_or_pattern, last_backslash + 1); // Naked filename.  No danger of overflow due size of src vs. dest.
 		*(last_backslash + 1) = '\0';  // Convert file_path to be the file's path, but use +1 to retain the final backslash on the string.
-		file_path_length = strlen(file_path);
 	}
 	else
 	{
 		strcpy(naked_filename_or_pattern, file_path); // No danger of overflow due size of src vs. dest.
 		*file_path = '\0'; // There is no path, so make it empty to use current working directory.
-		file_path_length = 0;
 	}
 
+	// The folder tree is walked by DirEnum in ordered mode, so files are visited in the same order as
+	// a sequential depth-first search: the matches in a folder, then those in each of its subfolders
+	// (recursively, if aRecurseSubfolders is true).  Subfolders are listed ahead of time by worker threads,
+	// which overlaps the latency of each listing with the others and with the execution of the loop's body.
+	DirEnum file_enum(new FileEnumHost(file_path, naked_filename_or_pattern, aFileLoopMode)
+		, sizeof(WIN32_FIND_DATA), aRecurseSubfolders, true);
+	if (!file_enum.Start(file_path))
+		return OK; // Out of memory, which seems too rare to justify reporting.
+
 	// g->mLoopFile is the current file of the file-loop that encloses this file-loop, if any.
 	// The below is our own current_file, which will take precedence over g->mLoopFile if this
-	// loop is a file-loop:
-	BOOL file_found;
-	WIN32_FIND_DATA new_current_file;
-	HANDLE file_search = FindFirstFile(aFilePattern, &new_current_file);
-	for ( file_found = (file_search != INVALID_HANDLE_VALUE) // Convert FindFirst's return value into a boolean so that it's compatible with with FindNext's.
-		; file_found && FileIsFilteredOut(new_current_file, aFileLoopMode, file_path, file_path_length)
-		; file_found = FindNextFile(file_search, &new_current_file));
-	// file_found and new_current_file have now been set for use below.
-	// Above is responsible for having properly set file_found and file_search.
-
+	// loop is a file-loop.  It points into file_enum's memory, so remains valid until the next file is
+	// retrieved.  FileIsFilteredOut() has already excluded unwanted files and prepended the path to each name.
+	WIN32_FIND_DATA *new_current_file;
 	ResultType result;
 	Line *jump_to_line;
 	global_struct &g = *::g; // Primarily for performance in this case.
 
-	for (; file_found; ++g.mLoopIteration)
+	for (; new_current_file = (WIN32_FIND_DATA *)file_enum.Next(); ++g.mLoopIteration)
 	{
-		g.mLoopFile = &new_current_file; // inner file-loop's file takes precedence over any outer file-loop's.
+		g.mLoopFile = new_current_file; // inner file-loop's file takes precedence over any outer file-loop's.
 		// Other types of loops leave g.mLoopFile unchanged so that a file-loop can enclose some other type of
 		// inner loop, and that inner loop will still have access to the outer loop's current file.
 
@@ -11234,13 +11505,7 @@ ResultType Line::PerformLoopFilePattern(char **apReturnValue, bool &aContinueMai
 		else
 			result = mNextLine->ExecUntil(ONLY_ONE_LINE, apReturnValue, &jump_to_line);
 		if (result != OK && result != LOOP_CONTINUE) // i.e. result == LOOP_BREAK || result == EARLY_RETURN || result == EARLY_EXIT || result == FAIL)
-		{
-			FindClose(file_search);
-			// Although ExecUntil() will treat the LOOP_BREAK result identically to OK, we
-			// need to return LOOP_BREAK in case our caller is another instance of this
-			// same function (i.e. due to recursing into subfolders):
-			return result;
-		}
+			return result; // file_enum's destructor stops the worker threads.
 		if (jump_to_line) // See comments in PerformLoop() about this section.
 		{
 			if (jump_to_line == this)
@@ -11252,77 +11517,9 @@ ResultType Line::PerformLoopFilePattern(char **apReturnValue, bool &aContinueMai
 		// Otherwise, the result of executing the body of the loop, above, was either OK
 		// (the current iteration completed normally) or LOOP_CONTINUE (the current loop
 		// iteration was cut short).  In both cases, just continue on through the loop.
-		// But first do end-of-iteration steps:
-		while ((file_found = FindNextFile(file_search, &new_current_file))
-			&& FileIsFilteredOut(new_current_file, aFileLoopMode, file_path, file_path_length)); // Relies on short-circuit boolean order.
-			// Above is a self-contained loop that keeps fetching files until there's no more files, or a file
-			// is found that isn't filtered out.  It also sets file_found and new_current_file for use by the
-			// outer loop.
 	} // for()
 
-	// The script's loop is now over.
-	if (file_search != INVALID_HANDLE_VALUE)
-		FindClose(file_search);
-
-	// If aRecurseSubfolders is true, we now need to perform the loop's body for every subfolder to
-	// search for more files and folders inside that match aFilePattern.  We can't do this in the
-	// first loop, above, because it may have a restricted file-pattern such as *.txt and we want to
-	// find and recurse into ALL folders:
-	if (!aRecurseSubfolders) // No need to continue into the "recurse" section.
-		return OK;
-
-	// Since above didn't return, this is a file-loop and recursion into sub-folders has been requested.
-	// Append *.* to file_path so that we can retrieve all files and folders in the aFilePattern
-	// main folder.  We're only interested in the folders, but we have to use *.* to ensure
-	// that the search will find all folder names:
-	if (file_path_length > sizeof(file_path) - 4) // v1.0.45.03: No room to append "*.*", so for simplicity, skip this folder (don't recurse into it).
-		return OK; // This situation might be impossible except for 32000-capable paths because the OS seems to reserve room inside every directory for at least the maximum length of a short filename.
-	char *append_pos = file_path + file_path_length;
-	strcpy(append_pos, "*.*"); // Above has already verified that no overflow is possible.
-
-	file_search = FindFirstFile(file_path, &new_current_file);
-	if (file_search == INVALID_HANDLE_VALUE)
-		return OK; // Nothing more to do.
-	// Otherwise, recurse into any subdirectories found inside this parent directory.
-
-	size_t path_and_pattern_length = file_path_length + strlen(naked_filename_or_pattern); // Calculated only once for performance.
-	do
-	{
-		if (!(new_current_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) // We only want directories (except "." and "..").
-			|| new_current_file.cFileName[0] == '.' && (!new_current_file.cFileName[1]      // Relies on short-circuit boolean order.
-				|| new_current_file.cFileName[1] == '.' && !new_current_file.cFileName[2])  //
-			// v1.0.45.03: Skip over folders whose full-path-names are too long to be supported by the ANSI
-			// versions of FindFirst/FindNext.  Without this fix, the section below formerly called PerformLoop()
-			// with a truncated full-path-name, which caused the last_backslash-finding logic to find the wrong
-			// backslash, which in turn caused infinite recursion and a stack overflow (i.e. caused by the
-			// full-path-name getting truncated in the same spot every time, endlessly).
-			|| path_and_pattern_length + strlen(new_current_file.cFileName) > sizeof(file_path) - 2) // -2 to reflect: 1) the backslash to be added between cFileName and naked_filename_or_pattern; 2) the zero terminator.
-			continue;
-		// Build the new search pattern, which consists of the original file_path + the subfolder name
-		// we just discovered + the original pattern:
-		sprintf(append_pos, "%s\\%s", new_current_file.cFileName, naked_filename_or_pattern); // Indirectly set file_path to the new search pattern.  This won't overflow due to the check above.
-		// Pass NULL for the 2nd param because it will determine its own current-file when it does
-		// its first loop iteration.  This is because this directory is being recursed into, not
-		// processed itself as a file-loop item (since this was already done in the first loop,
-		// above, if its name matches the original search pattern):
-		result = PerformLoopFilePattern(apReturnValue, aContinueMainLoop, aJumpToLine, aFileLoopMode, aRecurseSubfolders, file_path);
-		// result should never be LOOP_CONTINUE because the above call to PerformLoop() should have
-		// handled that case.  However, it can be LOOP_BREAK if it encoutered the break command.
-		if (result != OK && result != LOOP_CONTINUE) // i.e. result == LOOP_BREAK || result == EARLY_RETURN || result == EARLY_EXIT || result == FAIL)
-		{
-			FindClose(file_search);
-			return result;  // Return even LOOP_BREAK, since our caller can be either ExecUntil() or ourself.
-		}
-		if (aContinueMainLoop // The call to PerformLoop() above signaled us to break & return.
-			|| aJumpToLine)
-			// Above: There's no need to check "aJumpToLine == this" because PerformLoop() would already have
-			// handled it.  But if it set aJumpToLine to be non-NULL, it means we have to return and let our caller
-			// handle the jump.
-			break;
-	} while (FindNextFile(file_search, &new_current_file));
-	FindClose(file_search);
-
-	return OK;
+	return OK; // The script's loop is now over.
 }
 
 
@@ -11764,6 +11961,90 @@ ResultType Line::PerformLoopReadFile(char **apReturnValue, bool &aContinueMainLo
 
 
 
+RandomState &ThreadRandomState()
+// Returns the current thread's random number generator.  Upon first use by a thread, the thread is given its
+// own stream by copying g_RandomMaster and then jumping the master ahead by 2^128 numbers, so no two threads'
+// streams can overlap.  As a result, the numbers a thread gets depend only on the seed and on how many threads
+// used Random before it, not on whether other threads that use Random interrupt it.
+{
+	if (!g->RandomStreamIsReady)
+	{
+		g->RandomStream = g_RandomMaster;
+		RandomJump(g_RandomMaster);
+		g->RandomStreamIsReady = true;
+	}
+	return g->RandomStream;
+}
+
+
+
+ResultType Line::RandomArray(Var &aArrayBase, int aCount, int aIntMin, unsigned int aIntRange
+	, double aFloatMin, double aFloatSpan, bool aUseFloat)
+// Implements the Count parameter of the Random command: stores aCount random numbers in the pseudo-array
+// named after aArrayBase (e.g. Array1, Array2, ...) and the count in element #0, like StringSplit.  The
+// numbers are generated in blocks rather than one at a time to keep the generator's state in registers.
+// As with StringSplit, a global array is stored packed.
+{
+	// See StringSplit() for comments about the following:
+	char var_name[MAX_VAR_NAME_LENGTH + 21];
+	strlcpy(var_name, aArrayBase.mName, MAX_VAR_NAME_LENGTH+1);
+	char *var_name_suffix = var_name + strlen(var_name);
+	var_name_suffix[0] = '0';
+	var_name_suffix[1] = '\0';
+	Var *array0;
+	if (   !(array0 = g_script.FindOrAddVar(var_name, 0, ALWAYS_PREFER_LOCAL))   )
+		return FAIL;  // It will have already displayed the error.
+	int always_use = array0->IsLocal() ? ALWAYS_USE_LOCAL : ALWAYS_USE_GLOBAL;
+
+	if (aCount < 0)
+		aCount = 0;
+	PackedStringArray packed; // See StringSplit() for comments about this.
+	PackedStringArray *packed_elements = (always_use == ALWAYS_USE_GLOBAL
+		&& var_name_suffix - var_name + 10 <= MAX_VAR_NAME_LENGTH) ? &packed : NULL;
+	RandomState &stream = ThreadRandomState();
+	#define RANDOM_ARRAY_BLOCK_SIZE 256
+	unsigned int int_buf[RANDOM_ARRAY_BLOCK_SIZE];
+	double float_buf[RANDOM_ARRAY_BLOCK_SIZE];
+	char number_buf[MAX_NUMBER_SIZE];
+	int number_length;
+	Var *element;
+	for (int i = 0; i < aCount; i += RANDOM_ARRAY_BLOCK_SIZE)
+	{
+		int block_count = (aCount - i < RANDOM_ARRAY_BLOCK_SIZE) ? aCount - i : RANDOM_ARRAY_BLOCK_SIZE;
+		if (aUseFloat)
+			RandomFillUnit(stream, float_buf, block_count);
+		else
+			RandomFillBelow(stream, int_buf, block_count, aIntRange);
+		for (int j = 0; j < block_count; ++j)
+		{
+			if (packed_elements)
+			{
+				// Format the number the same way a variable would when it's read (see Var::UpdateContents).
+				if (aUseFloat)
+					number_length = FTOA(float_buf[j] * aFloatSpan + aFloatMin, number_buf, sizeof(number_buf));
+				else
+					number_length = (int)strlen(ITOA64((int)(aIntMin + int_buf[j]), number_buf)); // Unsigned addition wraps into the proper signed result.
+				if (!g_script.StoreArrayElement(var_name, var_name_suffix, i + j + 1, always_use
+					, packed_elements, number_buf, number_length))
+					return FAIL;
+				continue;
+			}
+			_ultoa(i + j + 1, var_name_suffix, 10);
+			if (   !(element = g_script.FindOrAddVar(var_name, 0, always_use))   )
+				return FAIL;  // It will have already displayed the error.
+			if (!(aUseFloat ? element->Assign(float_buf[j] * aFloatSpan + aFloatMin)
+				: element->Assign((int)(aIntMin + int_buf[j])))) // Unsigned addition wraps into the proper signed result.
+				return FAIL;
+		}
+	}
+	*var_name_suffix = '\0';
+	if (packed_elements && !g_script.SetPackedArray(var_name, packed))
+		return FAIL;
+	return array0->Assign(aCount); // Store the count in the 0th element.
+}
+
+
+
 __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() reduces code size a little (since this function is called from only one place) and boosts performance a bit, though it's probably more due to the butterly effect and cache hits/misses.
 // Performs only this line's action.
 // Returns OK or FAIL.
@@ -11796,6 +12077,24 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 	// are taken out or added to the param list:
 	//if (nArgs < g_act[mActionType].MinParams) ...
 
+	// Let the other file commands see any text that FileAppend is holding in a buffer (see FileBuffer).  Those
+	// that might alter, move or delete a file also need the files closed, since an open file can't be moved
+	// or deleted and text appended after it was replaced would be lost:
+	if (g_FileWriterCount && (mActionType >= ACT_FILEREAD && mActionType <= ACT_INIDELETE
+		|| mActionType == ACT_URLDOWNLOADTOFILE))
+	{
+		switch (mActionType)
+		{
+		case ACT_FILEDELETE: case ACT_FILERECYCLE: case ACT_FILEINSTALL: case ACT_FILECOPY: case ACT_FILEMOVE:
+		case ACT_FILECOPYDIR: case ACT_FILEMOVEDIR: case ACT_FILEREMOVEDIR: case ACT_FILESETATTRIB: case ACT_FILESETTIME:
+		case ACT_INIWRITE: case ACT_INIDELETE: case ACT_URLDOWNLOADTOFILE:
+			FileWriterCloseAll();
+			break;
+		default:
+			FileWriterFlushAll();
+		}
+	}
+
 	switch (mActionType)
 	{
 	case ACT_ASSIGN:
@@ -12212,6 +12511,8 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 		return ImageSearch(ArgToInt(3), ArgToInt(4), ArgToInt(5), ArgToInt(6), ARG7);
 	case ACT_PIXELGETCOLOR:
 		return PixelGetColor(ArgToInt(2), ArgToInt(3), ARG4);
+	case ACT_PIXELCAPTURE:
+		return PixelCapture(ARG1, ARG2, ARG3, ARG4, ARG5);
 
 	case ACT_SEND:
 	case ACT_SENDRAW:
@@ -12610,7 +12911,9 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 	{
 		if (!output_var) // v1.0.42.03: Special mode to change the seed.
 		{
-			init_genrand(ArgToUInt(2)); // It's documented that an unsigned 32-bit number is required.
+			// It's documented that an unsigned 32-bit number is required, but the full 64 bits are used if present.
+			RandomSeed(g_RandomMaster, (RandomUInt64Type)ArgToInt64(2));
+			g->RandomStreamIsReady = false; // So that this thread's next number comes from the new seed.
 			return OK;
 		}
 		bool use_float = IsPureNumeric(ARG2, true, false, true) == PURE_FLOAT
@@ -12627,7 +12930,9 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 				rand_min = rand_max;
 				rand_max = rand_swap;
 			}
-			return output_var->Assign((genrand_real1() * (rand_max - rand_min)) + rand_min);
+			if (*ARG4) // Count is present, so output_var is the base name of a pseudo-array.
+				return RandomArray(*output_var, ArgToInt(4), 0, 0, rand_min, rand_max - rand_min, true);
+			return output_var->Assign((RandomUnit(ThreadRandomState()) * (rand_max - rand_min)) + rand_min);
 		}
 		else // Avoid using floating point, where possible, which may improve speed a lot more than expected.
 		{
@@ -12641,13 +12946,16 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 				rand_min = rand_max;
 				rand_max = rand_swap;
 			}
-			// Do NOT use genrand_real1() to generate random integers because of cases like
+			// Do NOT use RandomUnit() to generate random integers because of cases like
 			// min=0 and max=1: we want an even distribution of 1's and 0's in that case, not
 			// something skewed that might result due to rounding/truncation issues caused by
-			// the float method used above:
-			// AutoIt3: __int64 is needed here to do the proper conversion from unsigned long to signed long:
-			return output_var->Assign(   (int)(__int64(genrand_int32()
-				% ((__int64)rand_max - rand_min + 1)) + rand_min)   );
+			// the float method used above.  RandomBelow() is also free of the slight bias toward
+			// low numbers that taking a remainder would have.  A range spanning all 2^32 integers
+			// wraps to zero, which RandomBelow() treats as such.
+			unsigned int rand_range = (unsigned int)rand_max - (unsigned int)rand_min + 1;
+			if (*ARG4) // Count is present, so output_var is the base name of a pseudo-array.
+				return RandomArray(*output_var, ArgToInt(4), rand_min, rand_range, 0, 0, false);
+			return output_var->Assign((int)(rand_min + RandomBelow(ThreadRandomState(), rand_range))); // Unsigned addition wraps into the proper signed result.
 		}
 	}
 
@@ -12691,6 +12999,9 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 	case ACT_SOUNDPLAY:
 		return SoundPlay(ARG1, *ARG2 && !stricmp(ARG2, "wait") || !stricmp(ARG2, "1"));
 
+	case ACT_FILEBUFFER:
+		return FileBuffer(ARG1, ARG2);
+
 	case ACT_FILEAPPEND:
 		// Uses the read-file loop's current item filename was explicitly leave blank (i.e. not just
 		// a reference to a variable that's blank):
@@ -13018,6 +13329,7 @@ __forceinline ResultType Line::Perform() // As of 2/9/2009, __forceinline() redu
 			sprintf(g.FormatFloat, "%%%s%s%s", ARG2
 				, dot_pos ? "" : "." // Add a dot if none was specified so that "0" is the same as "0.", which seems like the most user-friendly approach; it's also easier to document in the help file.
 				, IsPureNumeric(ARG2, true, true, true) ? "f" : ""); // If it's not pure numeric, assume the user already included the desired letter (e.g. SetFormat, Float, 0.6e).
+			g.FormatFloatPrecision = ParseFixedFormat(g.FormatFloat);
 		}
 		else if (!strnicmp(ARG1, "Integer", 7)) // "nicmp" vs. "icmp" so that Integer and IntegerFast are treated the same (loadtime validation already took notice of the Fast flag).
 		{
@@ -13942,6 +14254,9 @@ ResultType Script::ActionExec(char *aAction, char *aParams, char *aWorkingDir, b
 	// Launching nothing is always a success:
 	if (!aAction || !*aAction) return OK;
 
+	if (g_FileWriterCount) // The launched program might read a file that FileAppend is holding in a buffer.
+		FileWriterCloseAll();
+
 	size_t aAction_length = strlen(aAction);
 	if (aAction_length >= LINE_SIZE) // Max length supported by CreateProcess() is 32 KB. But there hasn't been any demand to go above 16 KB, so seems little need to support it (plus it reduces risk of stack overflow).
 	{
@@ -14227,6 +14542,7 @@ ResultType Script::ActionExec(char *aAction, char *aParams, char *aWorkingDir, b
 	// Otherwise, success:
 	if (aUpdateLastError)
 		g->LastError = 0; // Force zero to indicate success, which seems more maintainable and reliable than calling GetLastError() right here.
+	ProcessCacheInvalidate(); // So that a "Process Exist" done right after this sees the new process.
 
 	// If aProcess isn't NULL, the caller wanted the process handle left open and so it must eventually call
 	// CloseHandle().  Otherwise, we should close the process if it's non-NULL (it can be NULL in the case of
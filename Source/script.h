@@ -24,6 +24,14 @@ GNU General Public License for more details.
 #include "var.h" // for a script's variables.
 #include "WinGroup.h" // for a script's Window Groups.
 #include "Util.h" // for FileTimeToYYYYMMDD(), strlcpy()
+#include "lvstore.h" // for ListViewStore
+#include "lvsort.h" // for SortIndexByKey() and related
+#include "updatequeue.h" // for UpdateQueue
+#include "menuindex.h" // for MenuNameIndex
+#include "listmatch.h" // for ListMatcher
+#include "packedarray.h" // for PackedStringArray and PackedArraySet
+#include "direnum.h" // for DirEnum
+#include "copyengine.h" // for CopyEngine
 #include "resources\resource.h"  // For tray icon.
 #ifdef AUTOHOTKEYSC
 	#include "lib\exearc_read.h"
@@ -96,7 +104,7 @@ enum VariableTypeType {VAR_TYPE_INVALID, VAR_TYPE_NUMBER, VAR_TYPE_INTEGER, VAR_
 {\
 	FILETIME ft;\
 	GetSystemTimeAsFileTime(&ft);\
-	init_genrand(ft.dwLowDateTime);\
+	RandomSeed(g_RandomMaster, ((RandomUInt64Type)ft.dwHighDateTime << 32) | ft.dwLowDateTime);\
 }
 
 #define IS_PERSISTENT (Hotkey::sHotkeyCount || Hotstring::sHotstringCount || g_KeybdHook || g_MouseHook || g_persistent)
@@ -197,6 +205,14 @@ enum CommandIDs {CONTROL_ID_FIRST = IDCANCEL + 1
 void DoIncrementalMouseMove(int aX1, int aY1, int aX2, int aY2, int aSpeed);
 DWORD ProcessExist9x2000(char *aProcess, char *aProcessName);
 DWORD ProcessExistNT4(char *aProcess, char *aProcessName);
+void ProcessCacheInvalidate();
+bool FileWriterFlushAll();
+bool FileWriterCloseAll();
+#ifdef REPORT_EXIT_STATS // See defines.h.
+void ReportFileWriters();
+void ReportFileCopies();
+void ReportDownloads();
+#endif
 
 inline DWORD ProcessExist(char *aProcess, char *aProcessName = NULL)
 {
@@ -274,6 +290,8 @@ ResultType InputBox(Var *aOutputVar, char *aTitle, char *aText, bool aHideInput
 BOOL CALLBACK InputBoxProc(HWND hWndDlg, UINT uMsg, WPARAM wParam, LPARAM lParam);
 VOID CALLBACK InputBoxTimeout(HWND hWnd, UINT uMsg, UINT idEvent, DWORD dwTime);
 VOID CALLBACK DerefTimeout(HWND hWnd, UINT uMsg, UINT idEvent, DWORD dwTime);
+VOID CALLBACK FileWriterTimeout(HWND hWnd, UINT uMsg, UINT idEvent, DWORD dwTime);
+bool GetCachedScreenPixel(int aX, int aY, COLORREF &aColorRGB);
 BOOL CALLBACK EnumChildFindSeqNum(HWND aWnd, LPARAM lParam);
 BOOL CALLBACK EnumChildFindPoint(HWND aWnd, LPARAM lParam);
 BOOL CALLBACK EnumChildGetControlList(HWND aWnd, LPARAM lParam);
@@ -455,7 +473,7 @@ enum MenuCommands {MENU_CMD_INVALID, MENU_CMD_SHOW, MENU_CMD_USEERRORLEVEL
 enum GuiCommands {GUI_CMD_INVALID, GUI_CMD_OPTIONS, GUI_CMD_ADD, GUI_CMD_MARGIN, GUI_CMD_MENU
 	, GUI_CMD_SHOW, GUI_CMD_SUBMIT, GUI_CMD_CANCEL, GUI_CMD_MINIMIZE, GUI_CMD_MAXIMIZE, GUI_CMD_RESTORE
 	, GUI_CMD_DESTROY, GUI_CMD_FONT, GUI_CMD_TAB, GUI_CMD_LISTVIEW, GUI_CMD_TREEVIEW, GUI_CMD_DEFAULT
-	, GUI_CMD_COLOR, GUI_CMD_FLASH
+	, GUI_CMD_COLOR, GUI_CMD_FLASH, GUI_CMD_BEGINUPDATE, GUI_CMD_ENDUPDATE
 };
 
 enum GuiControlCmds {GUICONTROL_CMD_INVALID, GUICONTROL_CMD_OPTIONS, GUICONTROL_CMD_CONTENTS, GUICONTROL_CMD_TEXT
@@ -510,11 +528,83 @@ enum WinSetAttributes {WINSET_INVALID, WINSET_TRANSPARENT, WINSET_TRANSCOLOR, WI
 	, WINSET_REGION};
 
 
+class WorkerSync
+// The locking and signalling required by DirEnumHost and CopyEngineHost (a critical section and two
+// auto-reset events), plus a means of starting their worker threads.
+{
+	CRITICAL_SECTION mLock;
+	HANDLE mEvent[2];
+public:
+	WorkerSync();
+	~WorkerSync();
+	bool StartThread(void (*aProc)(void *), void *aParam);
+	void Lock() {EnterCriticalSection(&mLock);}
+	void Unlock() {LeaveCriticalSection(&mLock);}
+	void Wait(int aSignal, DWORD aTimeout = INFINITE)
+	{
+		LeaveCriticalSection(&mLock);
+		WaitForSingleObject(mEvent[aSignal], aTimeout);
+		EnterCriticalSection(&mLock);
+	}
+	void Signal(int aSignal) {SetEvent(mEvent[aSignal]);}
+};
+
+
+class FileEnumHost : public DirEnumHost
+// Lists directories for DirEnum by means of FindFirstFile().  Each entry is a WIN32_FIND_DATA whose
+// cFileName has had the directory's path prepended by Line::FileIsFilteredOut().
+{
+	WorkerSync mSync;
+	char mPattern[MAX_PATH];
+	size_t mPatternLength;
+	bool mPatternMatchesAll; // The pattern is * or *.*, so subfolders can be found without listing the folder twice.
+	bool mAllowThreads;
+	FileLoopModeType mFileLoopMode;
+
+	void AddSubdir(DirListing &aListing, WIN32_FIND_DATA &aFile, size_t aPathLength);
+
+public:
+	FileEnumHost(char *aFilePath, char *aPattern, FileLoopModeType aFileLoopMode);
+	void ListDirectory(DirListing &aListing, bool aWantSubdirs);
+	void EndListing(DirListing &aListing);
+	char Separator() {return '\\';}
+	bool StartThread(void (*aProc)(void *), void *aParam) {return mAllowThreads && mSync.StartThread(aProc, aParam);}
+	void Lock() {mSync.Lock();}
+	void Unlock() {mSync.Unlock();}
+	void Wait(int aSignal) {mSync.Wait(aSignal);}
+	void Signal(int aSignal) {mSync.Signal(aSignal);}
+};
+
+
+class FileCopyHost : public CopyEngineHost
+// Copies and moves files for CopyEngine by means of CopyFile(), CopyFileEx() and MoveFile().  Error codes
+// are those of GetLastError().
+{
+	WorkerSync mSync;
+	typedef BOOL (WINAPI *CopyFileExType)(LPCSTR, LPCSTR, LPPROGRESS_ROUTINE, LPVOID, LPBOOL, DWORD);
+	CopyFileExType mCopyFileEx; // NULL unless large files are to be copied without buffering.
+
+	BOOL CopyOrOverwrite(const char *aSource, const char *aDest, BOOL aFailIfExists, CopyUInt64Type aSize);
+
+public:
+	FileCopyHost();
+	int CopyOneFile(const char *aSource, const char *aDest, int aFlags, CopyUInt64Type aSize);
+	unsigned TickCount() {return GetTickCount();}
+	bool StartThread(void (*aProc)(void *), void *aParam) {return mSync.StartThread(aProc, aParam);}
+	void Lock() {mSync.Lock();}
+	void Unlock() {mSync.Unlock();}
+	void Wait(int aSignal, unsigned aTimeout) {mSync.Wait(aSignal, aTimeout);}
+	void Signal(int aSignal) {mSync.Signal(aSignal);}
+};
+
+
 class Label; // Forward declaration so that each can use the other.
 class Line
 {
 private:
 	ResultType EvaluateCondition();
+	bool ArgDerefsChangedSince(int aArgIndex, const Var::Stamp &aStamp);
+	bool IsInMatchList(char *aStr, char *aList, bool aFindExactMatch);
 	ResultType Line::PerformLoop(char **apReturnValue, bool &aContinueMainLoop, Line *&aJumpToLine
 		, __int64 aIterationLimit, bool aIsInfinite);
 	ResultType Line::PerformLoopFilePattern(char **apReturnValue, bool &aContinueMainLoop, Line *&aJumpToLine
@@ -532,6 +622,8 @@ private:
 	ResultType PerformAssign();
 	ResultType StringReplace();
 	ResultType StringSplit(char *aArrayName, char *aInputString, char *aDelimiterList, char *aOmitList);
+	ResultType RandomArray(Var &aArrayBase, int aCount, int aIntMin, unsigned int aIntRange
+		, double aFloatMin, double aFloatSpan, bool aUseFloat);
 	ResultType SplitPath(char *aFileSpec);
 	ResultType PerformSort(char *aContents, char *aOptions);
 	ResultType GetKeyJoyState(char *aKeyName, char *aOption);
@@ -560,6 +652,7 @@ private:
 	ResultType FileRead(char *aFilespec);
 	ResultType FileReadLine(char *aFilespec, char *aLineNumber);
 	ResultType FileAppend(char *aFilespec, char *aBuf, LoopReadFileStruct *aCurrentReadFile);
+	ResultType FileBuffer(char *aCmd, char *aMaxAge);
 	ResultType WriteClipboardToFile(char *aFilespec);
 	ResultType ReadClipboardFromFile(HANDLE hfile);
 	ResultType FileDelete();
@@ -569,10 +662,10 @@ private:
 
 	ResultType FileGetAttrib(char *aFilespec);
 	int FileSetAttrib(char *aAttributes, char *aFilePattern, FileLoopModeType aOperateOnFolders
-		, bool aDoRecurse, bool aCalledRecursively = false);
+		, bool aDoRecurse);
 	ResultType FileGetTime(char *aFilespec, char aWhichTime);
 	int FileSetTime(char *aYYYYMMDD, char *aFilePattern, char aWhichTime
-		, FileLoopModeType aOperateOnFolders, bool aDoRecurse, bool aCalledRecursively = false);
+		, FileLoopModeType aOperateOnFolders, bool aDoRecurse);
 	ResultType FileGetSize(char *aFilespec, char *aGranularity);
 	ResultType FileGetVersion(char *aFilespec);
 
@@ -630,6 +723,7 @@ private:
 		, char *aExcludeTitle, char *aExcludeText);
 	ResultType GuiControl(char *aCommand, char *aControlID, char *aParam3);
 	ResultType GuiControlGet(char *aCommand, char *aControlID, char *aParam3);
+	Var *ControlIDGlobalVar(int aArgNum, char *aControlID);
 	ResultType StatusBarGetText(char *aPart, char *aTitle, char *aText
 		, char *aExcludeTitle, char *aExcludeText);
 	ResultType StatusBarWait(char *aTextToWaitFor, char *aSeconds, char *aPart, char *aTitle, char *aText
@@ -652,6 +746,7 @@ private:
 		, char *aOptions, bool aIsPixelGetColor);
 	ResultType ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char *aImageFile);
 	ResultType PixelGetColor(int aX, int aY, char *aOptions);
+	ResultType PixelCapture(char *aCmd, char *aLeft, char *aTop, char *aRight, char *aBottom);
 
 	static ResultType SetToggleState(vk_type aVK, ToggleValueType &ForceLock, char *aToggleText);
 
@@ -675,7 +770,7 @@ public:
 		{\
 			if (Line::sDerefBuf)\
 			{\
-				free(Line::sDerefBuf);\
+				Line::DerefBufRelease(Line::sDerefBuf, Line::sDerefBufSize);\
 				if (Line::sDerefBufSize > LARGE_DEREF_BUF_SIZE)\
 					--Line::sLargeDerefBufs;\
 			}\
@@ -817,6 +912,11 @@ public:
 	static int sSourceFileCount; // Number of items in the above array.
 
 	static void FreeDerefBufIfLarge();
+	static char *DerefBufAlloc(size_t &aSize);
+	static void DerefBufRelease(char *aBuf, size_t aSize);
+#ifdef REPORT_EXIT_STATS // See defines.h.
+	static void ReportDerefBufPool();
+#endif
 
 	ResultType ExecUntil(ExecUntilMode aMode, char **apReturnValue = NULL, Line **apJumpToLine = NULL);
 
@@ -891,7 +991,7 @@ public:
 	ResultType Deref(Var *aOutputVar, char *aBuf);
 
 	static bool FileIsFilteredOut(WIN32_FIND_DATA &aCurrentFile, FileLoopModeType aFileLoopMode
-		, char *aFilePath, size_t aFilePathLength);
+		, char *aFilePath, size_t aFilePathLength, unsigned *aTooLongCount = NULL);
 
 	Label *GetJumpTarget(bool aIsDereferenced);
 	Label *IsJumpValid(Label &aTargetLabel);
@@ -1358,6 +1458,8 @@ public:
 		if (!stricmp(aBuf, "Default")) return GUI_CMD_DEFAULT;
 		if (!stricmp(aBuf, "Color")) return GUI_CMD_COLOR;
 		if (!stricmp(aBuf, "Flash")) return GUI_CMD_FLASH;
+		if (!stricmp(aBuf, "BeginUpdate")) return GUI_CMD_BEGINUPDATE;
+		if (!stricmp(aBuf, "EndUpdate")) return GUI_CMD_ENDUPDATE;
 		return GUI_CMD_INVALID;
 	}
 
@@ -1784,6 +1886,7 @@ public:
 
 	// AutoIt3 functions:
 	static bool Util_CopyDir(const char *szInputSource, const char *szInputDest, bool bOverwrite);
+	static int Util_CopyDirContents(const char *szSource, const char *szDest);
 	static bool Util_MoveDir(const char *szInputSource, const char *szInputDest, int OverwriteMode);
 	static bool Util_RemoveDir(const char *szInputSource, bool bRecurse);
 	static int Util_CopyFile(const char *szInputSource, const char *szInputDest, bool bOverwrite, bool bMove);
@@ -1964,6 +2067,10 @@ struct MsgMonitorStruct
 {
 	UINT msg;
 	Func *func;
+#ifdef REPORT_EXIT_STATS
+	__int64 call_ticks; // Total QueryPerformanceCounter() ticks spent in this monitor's threads, for ReportMsgMonitors().
+	UINT call_count;    // Number of threads launched by this monitor, for ReportMsgMonitors().
+#endif
 	// Keep any members smaller than 4 bytes adjacent to save memory:
 	short instance_count;  // Distinct from func.mInstances because the script might have called the function explicitly.
 	short max_instances; // v1.0.47: Support more than one thread.
@@ -1983,6 +2090,10 @@ public:
 	bool mIncludeStandardItems;
 	int mClickCount; // How many clicks it takes to trigger the default menu item.  2 = double-click
 	UINT mMenuItemCount;  // The count of user-defined menu items (doesn't include the standard items, if present).
+	// The number of user-defined items that precede the standard items in mMenu, which is nonzero only if the
+	// standard items were added after the menu was created (see AppendStandardItems()):
+	UINT mStandardItemsPos;
+	MenuNameIndex mNameIndex; // Created only once the menu has MENU_NAME_INDEX_MIN_ITEMS items (see FindItem()).
 	UserMenu *mNextMenu;  // Next item in linked list
 	HMENU mMenu;
 	MenuTypeType mMenuType; // MENU_TYPE_POPUP (via CreatePopupMenu) vs. MENU_TYPE_BAR (via CreateMenu).
@@ -1994,12 +2105,17 @@ public:
 
 	UserMenu(char *aName) // Constructor
 		: mName(aName), mFirstMenuItem(NULL), mLastMenuItem(NULL), mDefault(NULL)
-		, mIncludeStandardItems(false), mClickCount(2), mMenuItemCount(0), mNextMenu(NULL), mMenu(NULL)
+		, mIncludeStandardItems(false), mClickCount(2), mMenuItemCount(0)
+		, mStandardItemsPos(0), mNextMenu(NULL), mMenu(NULL)
 		, mMenuType(MENU_TYPE_POPUP) // The MENU_TYPE_NONE flag is not used in this context.  Default = POPUP.
 		, mBrush(NULL), mColor(CLR_DEFAULT)
 	{
 	}
 
+	UserMenuItem *FindItem(char *aName);
+	void IndexName(UserMenuItem *aMenuItem);
+	void UnindexName(UserMenuItem *aMenuItem);
+	void BuildNameIndex();
 	ResultType AddItem(char *aName, UINT aMenuID, Label *aLabel, UserMenu *aSubmenu, char *aOptions);
 	ResultType DeleteItem(UserMenuItem *aMenuItem, UserMenuItem *aMenuItemPrev);
 	ResultType DeleteAllItems();
@@ -2088,6 +2204,7 @@ struct lv_attrib_type
 	lv_col_type col[LV_MAX_COLUMNS];
 	int col_count; // Number of columns currently in the above array.
 	int row_count_hint;
+	ListViewStore *store; // Non-NULL only for a virtual (LVS_OWNERDATA) ListView, in which case it holds the rows.
 };
 
 typedef UCHAR TabControlIndexType;
@@ -2183,6 +2300,12 @@ public:
 	GuiIndexType mControlCount;
 	GuiIndexType mControlCapacity; // How many controls can fit into the current memory size of mControl.
 	GuiControlType *mControl; // Will become an array of controls when the window is first created.
+	GuiIndexType *mVarIndex; // Open-addressed hash table of (control index + 1) keyed by each control's output_var. Zero means an empty slot.
+	GuiIndexType mVarIndexSize; // Number of slots in mVarIndex (always a power of two), or zero if it hasn't been allocated.
+	bool mVarIndexIsStale; // True when mVarIndex must be rebuilt before its next use (e.g. a control's variable was changed).
+	UpdateQueue *mPendingText; // Text queued by GuiControl between "Gui BeginUpdate" and "Gui EndUpdate".  Created upon first use.
+	int mUpdateDepth; // How many "Gui BeginUpdate" are in effect (they can be nested).
+	bool mRedrawSuspended; // Whether "Gui BeginUpdate" sent WM_SETREDRAW=FALSE to the window.
 	GuiIndexType mDefaultButtonIndex; // Index vs. pointer is needed for some things.
 	Label *mLabelForClose, *mLabelForEscape, *mLabelForSize, *mLabelForDropFiles, *mLabelForContextMenu;
 	bool mLabelForCloseIsRunning, mLabelForEscapeIsRunning, mLabelForSizeIsRunning; // DropFiles doesn't need one of these.
@@ -2224,6 +2347,8 @@ public:
 
 	GuiType(int aWindowIndex) // Constructor
 		: mHwnd(NULL), mStatusBarHwnd(NULL), mWindowIndex(aWindowIndex), mControlCount(0), mControlCapacity(0)
+		, mVarIndex(NULL), mVarIndexSize(0), mVarIndexIsStale(true)
+		, mPendingText(NULL), mUpdateDepth(0), mRedrawSuspended(false)
 		, mDefaultButtonIndex(-1), mLabelForClose(NULL), mLabelForEscape(NULL), mLabelForSize(NULL)
 		, mLabelForDropFiles(NULL), mLabelForContextMenu(NULL)
 		, mLabelForCloseIsRunning(false), mLabelForEscapeIsRunning(false), mLabelForSizeIsRunning(false)
@@ -2281,6 +2406,10 @@ public:
 	ResultType Close(); // Due to SC_CLOSE, etc.
 	ResultType Escape(); // Similar to close, except typically called when the user presses ESCAPE.
 	ResultType Submit(bool aHideIt);
+	void BeginUpdate();
+	void EndUpdate();
+	bool QueueControlText(GuiIndexType aControlIndex, GuiControlCmds aCmd, char *aText);
+	void ApplyPendingText();
 	ResultType ControlGetContents(Var &aOutputVar, GuiControlType &aControl, char *aMode = "");
 
 	static VarSizeType ControlGetName(GuiIndexType aGuiWindowIndex, GuiIndexType aControlIndex, char *aBuf);
@@ -2308,7 +2437,10 @@ public:
 	}
 
 
-	GuiIndexType FindControl(char *aControlID);
+	GuiIndexType FindControl(char *aControlID, Var *aGlobalVar = NULL);
+	GuiIndexType FindControlByVar(Var *aVar);
+	void VarIndexInsert(GuiIndexType aControlIndex);
+	void VarIndexRebuild();
 	GuiControlType *FindControl(HWND aHwnd, bool aRetrieveIndexInstead = false)
 	{
 		GuiIndexType index = GUI_HWND_TO_INDEX(aHwnd); // Retrieves a small negative on failure, which will be out of bounds when converted to unsigned.
@@ -2355,6 +2487,7 @@ public:
 		, bool aWrapAround);
 	void ControlGetPosOfFocusedItem(GuiControlType &aControl, POINT &aPoint);
 	static void LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnlyIfEnabled, char aForceDirection = '\0');
+	static void LV_RefreshVirtual(GuiControlType &aControl);
 	static DWORD ControlGetListViewMode(HWND aWnd);
 };
 
@@ -2436,6 +2569,12 @@ public:
 
 	UserMenu *mFirstMenu, *mLastMenu;
 	UINT mMenuCount;
+	// The menu item having each ID, for FindMenuItemByID().  The IDs are divided into pages, each of which is
+	// allocated when the first ID in it is used.  This keeps the table small for the typical script while still
+	// allowing any ID to be looked up without a search:
+	#define MENU_ID_PAGE_SIZE 256
+	#define MENU_ID_PAGE_COUNT ((ID_USER_LAST - ID_USER_FIRST) / MENU_ID_PAGE_SIZE + 1)
+	UserMenuItem **mMenuItemByID[MENU_ID_PAGE_COUNT];
 
 	DWORD mThisHotkeyStartTime, mPriorHotkeyStartTime;  // Tickcount timestamp of when its subroutine began.
 	char mEndChar;  // The ending character pressed to trigger the most recent non-auto-replace hotstring.
@@ -2511,6 +2650,20 @@ public:
 	Var *AddVar(char *aVarName, size_t aVarNameLength, int aInsertPos, int aIsLocal);
 	static void *GetVarType(char *aVarName);
 
+	// Global pseudo-arrays created by StringSplit and Random are stored packed rather than as one variable
+	// per element.  An element only becomes a variable when something needs it to be one, such as an
+	// assignment to it.  See StoreArrayElement() for details.
+	PackedArraySet mPackedArrays;
+#ifdef REPORT_EXIT_STATS // See defines.h.
+	UINT mPackedElementsStored, mPackedElementsMadeVars;
+	void ReportPackedArrays();
+#endif
+	bool GetPackedElement(char *aVarName, size_t aVarNameLength, char *&aElement, size_t &aElementLength);
+	ResultType SetPackedArray(char *aBaseName, PackedStringArray &aArray);
+	void ReleasePackedArray(Var &aCountVar);
+	ResultType StoreArrayElement(char *aVarName, char *aVarNameSuffix, UINT aNumber, int aAlwaysUse
+		, PackedStringArray *aPacked, char *aValue, size_t aLength);
+
 	WinGroup *FindGroup(char *aGroupName, bool aCreateIfNotFound = false);
 	ResultType AddGroup(char *aGroupName);
 	Label *FindLabel(char *aLabelName);
@@ -2530,12 +2683,21 @@ public:
 	ResultType ScriptDeleteMenu(UserMenu *aMenu);
 	UserMenuItem *FindMenuItemByID(UINT aID)
 	{
-		UserMenuItem *mi;
-		for (UserMenu *m = mFirstMenu; m; m = m->mNextMenu)
-			for (mi = m->mFirstMenuItem; mi; mi = mi->mNextMenuItem)
-				if (mi->mMenuID == aID)
-					return mi;
-		return NULL;
+		if (aID < ID_USER_FIRST || aID > ID_USER_LAST) // This also excludes separators, whose ID is 0.
+			return NULL;
+		aID -= ID_USER_FIRST;
+		UserMenuItem **page = mMenuItemByID[aID / MENU_ID_PAGE_SIZE];
+		return page ? page[aID % MENU_ID_PAGE_SIZE] : NULL;
+	}
+	UserMenuItem **MenuItemIDSlot(UINT aID);
+	void ReleaseMenuItemID(UINT aID)
+	{
+		if (aID < ID_USER_FIRST || aID > ID_USER_LAST)
+			return;
+		aID -= ID_USER_FIRST;
+		UserMenuItem **page = mMenuItemByID[aID / MENU_ID_PAGE_SIZE];
+		if (page)
+			page[aID % MENU_ID_PAGE_SIZE] = NULL;
 	}
 
 	ResultType PerformGui(char *aCommand, char *aControlType, char *aOptions, char *aParam4);
@@ -2652,6 +2814,7 @@ VarSizeType BIV_TimeIdle(char *aBuf, char *aVarName);
 VarSizeType BIV_TimeIdlePhysical(char *aBuf, char *aVarName);
 VarSizeType BIV_IPAddress(char *aBuf, char *aVarName);
 VarSizeType BIV_IsAdmin(char *aBuf, char *aVarName);
+VarSizeType BIV_Download(char *aBuf, char *aVarName);
 
 
 
@@ -2716,6 +2879,11 @@ BOOL LegacyResultToBOOL(char *aResult);
 BOOL LegacyVarToBOOL(Var &aVar);
 BOOL TokenToBOOL(ExprTokenType &aToken, SymbolType aTokenIsNumber);
 SymbolType TokenIsPureNumeric(ExprTokenType &aToken);
+#ifdef REPORT_EXIT_STATS
+void ReportPureNumeric();
+#endif
+RandomState &ThreadRandomState();
+void FormatTimeNamesInvalidate();
 __int64 TokenToInt64(ExprTokenType &aToken, BOOL aIsPureInteger = FALSE);
 double TokenToDouble(ExprTokenType &aToken, BOOL aCheckForHex = TRUE, BOOL aIsPureFloat = FALSE);
 char *TokenToString(ExprTokenType &aToken, char *aBuf = NULL);
@@ -17,8 +17,11 @@ GNU General Public License for more details.
 #include "stdafx.h" // pre-compiled headers
 #include <olectl.h> // for OleLoadPicture()
 #include <winioctl.h> // For PREVENT_MEDIA_REMOVAL and CD lock/unlock.
+#include <process.h> // for _beginthreadex()
 #include "qmath.h" // Used by Transform() [math.h incurs 2k larger code size just for ceil() & floor()]
-#include "mt19937ar-cok.h" // for sorting in random order
+#include "pixelscan.h" // for PixelSearch() and ImageSearch()
+#include "capture.h" // for PixelSearch(), ImageSearch() and PixelCapture()
+#include "filewriter.h" // for FileAppend and FileBuffer
 #include "script.h"
 #include "window.h" // for IF_USE_FOREGROUND_WINDOW
 #include "application.h" // for MsgSleep()
@@ -2869,6 +2872,7 @@ ResultType Line::ScriptProcess(char *aCmd, char *aProcess, char *aParam3)
 			{
 				result = TerminateProcess(hProcess, 0);
 				CloseHandle(hProcess);
+				ProcessCacheInvalidate();
 				return g_ErrorLevel->Assign(result ? pid : 0); // Indicate success or failure.
 			}
 		}
@@ -2921,9 +2925,25 @@ ResultType Line::ScriptProcess(char *aCmd, char *aProcess, char *aParam3)
 			wait_indefinitely = true;
 			sleep_duration = 0; // Just to catch any bugs.
 		}
+		// For WaitClose, a handle to the process found by the most recent check is kept open.  The handle
+		// becomes signaled when the process exits, so while it remains unsignaled there is no need to
+		// enumerate all processes again.  Once it's signaled, a full check is done because another process
+		// of the same name might still exist.  Keeping the handle open also prevents the PID from being
+		// reused in the meantime.
+		HANDLE process_handle = NULL;
 		for (;;)
 		{ // Always do the first iteration so that at least one check is done.
-			pid = ProcessExist(aProcess);
+			if (!process_handle || WaitForSingleObject(process_handle, 0) != WAIT_TIMEOUT)
+			{
+				if (process_handle)
+				{
+					CloseHandle(process_handle);
+					process_handle = NULL;
+				}
+				pid = ProcessExist(aProcess);
+				if (pid && process_cmd == PROCESS_CMD_WAITCLOSE)
+					process_handle = OpenProcess(SYNCHRONIZE, FALSE, pid); // Failure is okay; it just means every iteration does a full check.
+			}
 			if (process_cmd == PROCESS_CMD_WAIT)
 			{
 				if (pid)
@@ -2940,9 +2960,13 @@ ResultType Line::ScriptProcess(char *aCmd, char *aProcess, char *aParam3)
 			if (wait_indefinitely || (int)(sleep_duration - (GetTickCount() - start_time)) > SLEEP_INTERVAL_HALF)
 				MsgSleep(100);  // For performance reasons, don't check as often as the WinWait family does.
 			else // Done waiting.
+			{
+				if (process_handle)
+					CloseHandle(process_handle);
 				return g_ErrorLevel->Assign(pid);
 				// Above assigns 0 if "Process Wait" times out; or the PID of the process that still exists
 				// if "Process WaitClose" times out.
+			}
 		} // for()
 	} // case
 	} // switch()
@@ -4150,6 +4174,173 @@ end:
 }
 
 
+// The following implement a cache of the most recent screen capture, which allows scripts that search the
+// same region repeatedly (such as many times per second, or several searches in a row) to avoid the cost of
+// capturing the screen for each search.  See capture.h for the policy.
+class GdiCaptureProvider : public CaptureProvider
+{
+public:
+	ScanPixelType *Capture(int aLeft, int aTop, int aWidth, int aHeight, bool &aIs16Bit)
+	// Returns an array of the pixels currently visible in the specified region of the screen.
+	{
+		// Some explanation for the method below is contained in this quote from the newsgroups:
+		// "you shouldn't really be getting the current bitmap from the GetDC DC. This might
+		// have weird effects like returning the entire screen or not working. Create yourself
+		// a memory DC first of the correct size. Then BitBlt into it and then GetDIBits on
+		// that instead. This way, the provider of the DC (the video driver) can make sure that
+		// the correct pixels are copied across."
+		HDC hdc = GetDC(NULL);
+		if (!hdc)
+			return NULL;
+		LPCOLORREF screen_pixel = NULL;
+		HBITMAP hbitmap_screen = NULL;
+		HGDIOBJ sdc_orig_select = NULL;
+		LONG screen_width, screen_height;
+		HDC sdc = CreateCompatibleDC(hdc);
+		// Create an empty bitmap to hold all the pixels currently visible on the screen (within the search area),
+		// then copy the pixels in the search-area of the screen into the DC to be searched:
+		if (   sdc
+			&& (hbitmap_screen = CreateCompatibleBitmap(hdc, aWidth, aHeight))
+			&& (sdc_orig_select = SelectObject(sdc, hbitmap_screen))
+			&& BitBlt(sdc, 0, 0, aWidth, aHeight, hdc, aLeft, aTop, SRCCOPY)   ) // Relies on short-circuit boolean order.
+			screen_pixel = getbits(hbitmap_screen, sdc, screen_width, screen_height, aIs16Bit);
+
+		if (sdc)
+		{
+			if (sdc_orig_select) // i.e. the original call to SelectObject() didn't fail.
+				SelectObject(sdc, sdc_orig_select); // Probably necessary to prevent memory leak.
+			DeleteDC(sdc);
+		}
+		if (hbitmap_screen)
+			DeleteObject(hbitmap_screen);
+		ReleaseDC(NULL, hdc);
+		if (screen_pixel && (screen_width != aWidth || screen_height != aHeight)) // Should never happen.
+		{
+			free(screen_pixel);
+			return NULL;
+		}
+		return (ScanPixelType *)screen_pixel;
+	}
+
+	unsigned TickCount()
+	{
+		return GetTickCount();
+	}
+};
+
+static GdiCaptureProvider sCaptureProvider;
+static CaptureCache sCaptureCache(sCaptureProvider);
+
+
+
+class ImageSearchHost : public ImageScanHost
+// Lets ImageScanFindAll() divide a large search among a worker thread for each additional processor.
+{
+	WorkerSync mSync;
+public:
+	int ThreadCount()
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		return (int)si.dwNumberOfProcessors;
+	}
+	bool StartThread(void (*aProc)(void *), void *aParam) {return mSync.StartThread(aProc, aParam);}
+	void Lock() {mSync.Lock();}
+	void Unlock() {mSync.Unlock();}
+	void Wait() {mSync.Wait(0);}
+	void Signal() {mSync.Signal(0);}
+};
+
+static ImageSearchHost sImageSearchHost; // Static rather than on the stack so that it outlives each worker's final Unlock().
+
+
+
+static LPCOLORREF GetScreenPixels(int aLeft, int aTop, int aWidth, int aHeight
+	, LONG &aScreenWidth, LONG &aScreenHeight, bool &aIs16Bit)
+// Returns the pixels in the specified region of the screen, either by capturing them now or from the cached
+// frame.  Either way, the caller receives its own copy, which it may alter and must free().
+{
+	aScreenWidth = aWidth;
+	aScreenHeight = aHeight;
+	return (LPCOLORREF)sCaptureCache.Get(aLeft, aTop, aWidth, aHeight, g->PixelCaptureMaxAge, aIs16Bit);
+}
+
+
+
+bool GetCachedScreenPixel(int aX, int aY, COLORREF &aColorRGB)
+// Used by PixelGetColor, which never captures a frame itself since GetPixel() is faster for a single pixel.
+// Returns true and sets aColorRGB (in RGB vs. BGR format) if the cached frame is usable for the specified pixel.
+{
+	ScanPixelType color;
+	if (!sCaptureCache.GetPixel(aX, aY, g->PixelCaptureMaxAge, color))
+		return false;
+	aColorRGB = color & 0x00FFFFFF;
+	return true;
+}
+
+
+
+ResultType Line::PixelCapture(char *aCmd, char *aLeft, char *aTop, char *aRight, char *aBottom)
+// PixelCapture, Pin [, Left, Top, Right, Bottom]: Captures the specified region (or the entire virtual screen
+//     if omitted) and causes all subsequent searches that lie within it to use that capture until Unpin.
+// PixelCapture, Unpin: Discards the pinned or cached frame so that subsequent searches capture the screen anew.
+// PixelCapture, MaxAge, N: Allows the current thread's searches to reuse the most recent capture for up to N
+//     milliseconds, provided it covers the region being searched.  Zero (the default) disables it.
+{
+	if (!stricmp(aCmd, "MaxAge"))
+	{
+		int max_age = ATOI(aLeft);
+		g->PixelCaptureMaxAge = max_age > 0 ? max_age : 0;
+		return OK;
+	}
+	if (!stricmp(aCmd, "Unpin"))
+	{
+		sCaptureCache.Unpin();
+		return OK;
+	}
+	if (stricmp(aCmd, "Pin"))
+		return LineError(ERR_PARAM1_INVALID, FAIL, aCmd);
+
+	g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default.
+	int left, top, right, bottom;
+	if (*aLeft || *aTop || *aRight || *aBottom)
+	{
+		left = ATOI(aLeft);
+		top = ATOI(aTop);
+		right = ATOI(aRight);
+		bottom = ATOI(aBottom);
+		if (!(g->CoordMode & COORD_MODE_PIXEL)) // Using relative vs. screen coordinates.
+		{
+			RECT rect;
+			if (!GetWindowRect(GetForegroundWindow(), &rect))
+				return OK;  // Let ErrorLevel tell the story.
+			left   += rect.left;
+			top    += rect.top;
+			right  += rect.left;
+			bottom += rect.top;
+		}
+	}
+	else // Use the entire virtual screen (which spans all monitors).
+	{
+		left = GetSystemMetrics(SM_XVIRTUALSCREEN);
+		top = GetSystemMetrics(SM_YVIRTUALSCREEN);
+		int width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+		int height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+		if (!width || !height) // Win95/NT4 don't support the above.
+		{
+			width = GetSystemMetrics(SM_CXSCREEN);
+			height = GetSystemMetrics(SM_CYSCREEN);
+		}
+		right = left + width - 1;
+		bottom = top + height - 1;
+	}
+
+	if (!sCaptureCache.Pin(left, top, right - left + 1, bottom - top + 1))
+		return OK;  // Let ErrorLevel tell the story.
+	return g_ErrorLevel->Assign(ERRORLEVEL_NONE); // Indicate success.
+}
+
+
 
 ResultType Line::PixelSearch(int aLeft, int aTop, int aRight, int aBottom, COLORREF aColorBGR
 	, int aVariation, char *aOptions, bool aIsPixelGetColor)
@@ -4219,49 +4410,35 @@ ResultType Line::PixelSearch(int aLeft, int aTop, int aRight, int aBottom, COLOR
 
 	bool found = false; // Must init here for use by "goto fast_end" and for use by both fast and slow modes.
 
+	// If the caller gives us inverted X or Y coordinates, conduct the search in reverse order.
+	// This feature was requested; it was put into effect for v1.0.25.06.
+	bool right_to_left = aLeft > aRight;
+	bool bottom_to_top = aTop > aBottom;
+
 	if (fast_mode)
 	{
-		// From this point on, "goto fast_end" will assume hdc is non-NULL but that the below might still be NULL.
-		// Therefore, all of the following must be initialized so that the "fast_end" label can detect them:
-		HDC sdc = NULL;
-		HBITMAP hbitmap_screen = NULL;
-		LPCOLORREF screen_pixel = NULL;
-		HGDIOBJ sdc_orig_select = NULL;
-
-		// Some explanation for the method below is contained in this quote from the newsgroups:
-		// "you shouldn't really be getting the current bitmap from the GetDC DC. This might
-		// have weird effects like returning the entire screen or not working. Create yourself
-		// a memory DC first of the correct size. Then BitBlt into it and then GetDIBits on
-		// that instead. This way, the provider of the DC (the video driver) can make sure that
-		// the correct pixels are copied across."
-
-		// Create an empty bitmap to hold all the pixels currently visible on the screen (within the search area):
-		int search_width = aRight - aLeft + 1;
-		int search_height = aBottom - aTop + 1;
-		if (   !(sdc = CreateCompatibleDC(hdc)) || !(hbitmap_screen = CreateCompatibleBitmap(hdc, search_width, search_height))   )
-			goto fast_end;
-
-		if (   !(sdc_orig_select = SelectObject(sdc, hbitmap_screen))   )
-			goto fast_end;
-
-		// Copy the pixels in the search-area of the screen into the DC to be searched:
-		if (   !(BitBlt(sdc, 0, 0, search_width, search_height, hdc, aLeft, aTop, SRCCOPY))   )
-			goto fast_end;
-
+		// Get the pixels in the search-area of the screen (either by capturing them now or from the frame
+		// cached by PixelCapture).  Fast mode searches row by row rather than column by column, but
+		// inverted coordinates reverse the order of the rows and/or the order within each row:
+		int search_left = right_to_left ? aRight : aLeft;
+		int search_top = bottom_to_top ? aBottom : aTop;
 		LONG screen_width, screen_height;
 		bool screen_is_16bit;
-		if (   !(screen_pixel = getbits(hbitmap_screen, sdc, screen_width, screen_height, screen_is_16bit))   )
+		LPCOLORREF screen_pixel = GetScreenPixels(search_left, search_top, abs(aRight - aLeft) + 1, abs(aBottom - aTop) + 1
+			, screen_width, screen_height, screen_is_16bit);
+		if (!screen_pixel)
 			goto fast_end;
 
 		// Concerning 0xF8F8F8F8: "On 16bit and 15 bit color the first 5 bits in each byte are valid
 		// (in 16bit there is an extra bit but i forgot for which color). And this will explain the
 		// second problem [in the test script], since GetPixel even in 16bit will return some "valid"
 		// data in the last 3bits of each byte."
+		// The searching itself is done by the functions in pixelscan.cpp, which compare several pixels
+		// at once when the CPU supports it.
 		register int i;
 		LONG screen_pixel_count = screen_width * screen_height;
 		if (screen_is_16bit)
-			for (i = 0; i < screen_pixel_count; ++i)
-				screen_pixel[i] &= 0xF8F8F8F8;
+			PixelScanMask((ScanPixelType *)screen_pixel, screen_pixel_count, 0xF8F8F8F8);
 
 		if (aIsPixelGetColor)
 		{
@@ -4275,17 +4452,11 @@ ResultType Line::PixelSearch(int aLeft, int aTop, int aRight, int aBottom, COLOR
 		{
 			if (screen_is_16bit)
 				aColorRGB &= 0xF8F8F8F8;
-			for (i = 0; i < screen_pixel_count; ++i)
-			{
-				// Note that screen pixels sometimes have a non-zero high-order byte.  That's why
-				// bit-and with 0x00FFFFFF is done.  Otherwise, Redish/orangish colors are not properly
-				// found:
-				if ((screen_pixel[i] & 0x00FFFFFF) == aColorRGB)
-				{
-					found = true;
-					break;
-				}
-			}
+			// Note that screen pixels sometimes have a non-zero high-order byte, which is why
+			// PixelScanExact() ignores that byte.  Otherwise, Redish/orangish colors are not properly
+			// found:
+			found = (i = PixelScanFind((ScanPixelType *)screen_pixel, screen_width, screen_height, aColorRGB, aColorRGB
+				, right_to_left, bottom_to_top)) > -1;
 		}
 		else
 		{
@@ -4310,22 +4481,12 @@ ResultType Line::PixelSearch(int aLeft, int aTop, int aRight, int aBottom, COLOR
 			
 			SET_COLOR_RANGE
 
-			for (i = 0; i < screen_pixel_count; ++i)
-			{
-				// Note that screen pixels sometimes have a non-zero high-order byte.  But it doesn't
-				// matter with the below approach, since that byte is not checked in the comparison.
-				pixel = screen_pixel[i];
-				red = GetBValue(pixel);   // Because pixel is in RGB vs. BGR format, red is retrieved with
-				green = GetGValue(pixel); // GetBValue() and blue is retrieved with GetRValue().
-				blue = GetRValue(pixel);
-				if (red >= red_low && red <= red_high
-					&& green >= green_low && green <= green_high
-					&& blue >= blue_low && blue <= blue_high)
-				{
-					found = true;
-					break;
-				}
-			}
+			// Note that screen pixels sometimes have a non-zero high-order byte.  But it doesn't
+			// matter with the below approach, since that byte is not checked in the comparison.
+			// Because the pixels are in RGB vs. BGR format, the ranges are passed via RGB() with
+			// blue and red swapped:
+			found = (i = PixelScanFind((ScanPixelType *)screen_pixel, screen_width, screen_height
+				, RGB(blue_low, green_low, red_low), RGB(blue_high, green_high, red_high), right_to_left, bottom_to_top)) > -1;
 		}
 		if (!found) // Must override ErrorLevel to its new value prior to the label below.
 			g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // "1" indicates search completed okay, but didn't find it.
@@ -4334,14 +4495,6 @@ fast_end:
 		// If found==false when execution reaches here, ErrorLevel is already set to the right value, so just
 		// clean up then return.
 		ReleaseDC(NULL, hdc);
-		if (sdc)
-		{
-			if (sdc_orig_select) // i.e. the original call to SelectObject() didn't fail.
-				SelectObject(sdc, sdc_orig_select); // Probably necessary to prevent memory leak.
-			DeleteDC(sdc);
-		}
-		if (hbitmap_screen)
-			DeleteObject(hbitmap_screen);
 		if (screen_pixel)
 			free(screen_pixel);
 
@@ -4353,9 +4506,9 @@ fast_end:
 		// zeroes if this doesn't need to be done):
 		if (!aIsPixelGetColor)
 		{
-			if (output_var_x && !output_var_x->Assign((aLeft + i%screen_width) - rect.left))
+			if (output_var_x && !output_var_x->Assign((search_left + i%screen_width) - rect.left))
 				return FAIL;
-			if (output_var_y && !output_var_y->Assign((aTop + i/screen_width) - rect.top))
+			if (output_var_y && !output_var_y->Assign((search_top + i/screen_width) - rect.top))
 				return FAIL;
 		}
 
@@ -4369,10 +4522,6 @@ fast_end:
 	// In addition, there is doubt that the fast mode works in all the screen color depths, games,
 	// and other circumstances that the slow mode is known to work in.
 
-	// If the caller gives us inverted X or Y coordinates, conduct the search in reverse order.
-	// This feature was requested; it was put into effect for v1.0.25.06.
-	bool right_to_left = aLeft > aRight;
-	bool bottom_to_top = aTop > aBottom;
 	register int xpos, ypos;
 
 	if (aVariation > 0)
@@ -4461,7 +4610,8 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 
 	// Options are done as asterisk+option to permit future expansion.
 	// Set defaults to be possibly overridden by any specified options:
-	int aVariation = 0;  // This is named aVariation vs. variation for use with the SET_COLOR_RANGE macro.
+	int aVariation = 0;
+	bool find_all = false;
 	COLORREF trans_color = CLR_NONE; // The default must be a value that can't occur naturally in an image.
 	int icon_number = 0; // Zero means "load icon or bitmap (doesn't matter)".
 	int width = 0, height = 0;
@@ -4510,6 +4660,8 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 					trans_color = bgr_to_rgb(trans_color); // v1.0.44.10: See fix/comment above.
 
 			}
+			else if (!strnicmp(cp, "All", 3))
+				find_all = true;
 			else // Assume it's a number since that's the only other asterisk-option.
 			{
 				aVariation = ATOI(cp); // Seems okay to support hex via ATOI because the space after the number is documented as being mandatory.
@@ -4566,11 +4718,9 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	// From this point on, "goto end" will assume hdc and hbitmap_image are non-NULL, but that the below
 	// might still be NULL.  Therefore, all of the following must be initialized so that the "end"
 	// label can detect them:
-	HDC sdc = NULL;
-	HBITMAP hbitmap_screen = NULL;
 	LPCOLORREF image_pixel = NULL, screen_pixel = NULL, image_mask = NULL;
-	HGDIOBJ sdc_orig_select = NULL;
 	bool found = false; // Must init here for use by "goto end".
+	int *match = NULL, match_count = 0;
     
 	bool image_is_16bit;
 	LONG image_width, image_height;
@@ -4602,37 +4752,25 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	if (   !(image_pixel = getbits(hbitmap_image, hdc, image_width, image_height, image_is_16bit))   )
 		goto end;
 
-	// Create an empty bitmap to hold all the pixels currently visible on the screen that lie within the search area:
-	int search_width = aRight - aLeft + 1;
-	int search_height = aBottom - aTop + 1;
-	if (   !(sdc = CreateCompatibleDC(hdc)) || !(hbitmap_screen = CreateCompatibleBitmap(hdc, search_width, search_height))   )
-		goto end;
-
-	if (   !(sdc_orig_select = SelectObject(sdc, hbitmap_screen))   )
-		goto end;
-
-	// Copy the pixels in the search-area of the screen into the DC to be searched:
-	if (   !(BitBlt(sdc, 0, 0, search_width, search_height, hdc, aLeft, aTop, SRCCOPY))   )
-		goto end;
-
+	// Get all the pixels currently visible on the screen that lie within the search area (either by capturing
+	// them now or from the frame cached by PixelCapture):
 	LONG screen_width, screen_height;
 	bool screen_is_16bit;
-	if (   !(screen_pixel = getbits(hbitmap_screen, sdc, screen_width, screen_height, screen_is_16bit))   )
+	if (   !(screen_pixel = GetScreenPixels(aLeft, aTop, aRight - aLeft + 1, aBottom - aTop + 1
+		, screen_width, screen_height, screen_is_16bit))   )
 		goto end;
 
 	LONG image_pixel_count = image_width * image_height;
 	LONG screen_pixel_count = screen_width * screen_height;
-	int i, j, k, x, y; // Declaring as "register" makes no performance difference with current compiler, so let the compiler choose which should be registers.
+	int i;
 
 	// If either is 16-bit, convert *both* to the 16-bit-compatible 32-bit format:
 	if (image_is_16bit || screen_is_16bit)
 	{
 		if (trans_color != CLR_NONE)
 			trans_color &= 0x00F8F8F8; // Convert indicated trans-color to be compatible with the conversion below.
-		for (i = 0; i < screen_pixel_count; ++i)
-			screen_pixel[i] &= 0x00F8F8F8; // Highest order byte must be masked to zero for consistency with use of 0x00FFFFFF below.
-		for (i = 0; i < image_pixel_count; ++i)
-			image_pixel[i] &= 0x00F8F8F8;  // Same.
+		PixelScanMask((ScanPixelType *)screen_pixel, screen_pixel_count, 0x00F8F8F8); // Highest order byte must be masked to zero for consistency with use of 0x00FFFFFF below.
+		PixelScanMask((ScanPixelType *)image_pixel, image_pixel_count, 0x00F8F8F8);  // Same.
 	}
 
 	// v1.0.44.03: The below is now done even for variation>0 mode so its results are consistent with those of
@@ -4641,145 +4779,43 @@ ResultType Line::ImageSearch(int aLeft, int aTop, int aRight, int aBottom, char
 	//     || image_pixel[j] == trans_color
 	// Without this change, there are cases where variation=0 would find a match but a higher variation
 	// (for the same search) wouldn't. 
-	for (i = 0; i < image_pixel_count; ++i)
-		image_pixel[i] &= 0x00FFFFFF;
+	PixelScanMask((ScanPixelType *)image_pixel, image_pixel_count, 0x00FFFFFF);
 
-	// Search the specified region for the first occurrence of the image:
+	// Search the specified region for the first occurrence of the image (or every occurrence if *All was
+	// specified).  This is done by ImageScanFind(), which locates candidates by searching for one of the
+	// image's rarer pixels and then checks the rest of the image only at those positions.  It finds matches
+	// in the same order as the old pixel-by-pixel loops did, so the same match is reported as before.
+	// ImageScanFindAll() calls it for bands of rows on several threads at once when the region is large.
 	if (aVariation < 1) // Caller wants an exact match.
-	{
 		// Concerning the following use of 0x00FFFFFF, the use of 0x00F8F8F8 above is related (both have high order byte 00).
 		// The following needs to be done only when shades-of-variation mode isn't in effect because
-		// shades-of-variation mode ignores the high-order byte due to its use of macros such as GetRValue().
-		// This transformation incurs about a 15% performance decrease (percentage is fairly constant since
-		// it is proportional to the search-region size, which tends to be much larger than the search-image and
-		// is therefore the primary determination of how long the loops take). But it definitely helps find images
+		// shades-of-variation mode ignores the high-order byte.
+		// This transformation incurs a small performance decrease (proportional to the search-region size,
+		// which tends to be much larger than the search-image). But it definitely helps find images
 		// more successfully in some cases.  For example, if a PNG file is displayed in a GUI window, this
 		// transformation allows certain bitmap search-images to be found via variation==0 when they otherwise
 		// would require variation==1 (possibly the variation==1 success is just a side-effect of it
 		// ignoring the high-order byte -- maybe a much higher variation would be needed if the high
 		// order byte were also subject to the same shades-of-variation analysis as the other three bytes [RGB]).
-		for (i = 0; i < screen_pixel_count; ++i)
-			screen_pixel[i] &= 0x00FFFFFF;
-
-		for (i = 0; i < screen_pixel_count; ++i)
-		{
-			// Unlike the variation-loop, the following one uses a first-pixel optimization to boost performance
-			// by about 10% because it's only 3 extra comparisons and exact-match mode is probably used more often.
-			// Before even checking whether the other adjacent pixels in the region match the image, ensure
-			// the image does not extend past the right or bottom edges of the current part of the search region.
-			// This is done for performance but more importantly to prevent partial matches at the edges of the
-			// search region from being considered complete matches.
-			// The following check is ordered for short-circuit performance.  In addition, image_mask, if
-			// non-NULL, is used to determine which pixels are transparent within the image and thus should
-			// match any color on the screen.
-			if ((screen_pixel[i] == image_pixel[0] // A screen pixel has been found that matches the image's first pixel.
-				|| image_mask && image_mask[0]     // Or: It's an icon's transparent pixel, which matches any color.
-				|| image_pixel[0] == trans_color)  // This should be okay even if trans_color==CLR_NONE, since CLR_NONE should never occur naturally in the image.
-				&& image_height <= screen_height - i/screen_width // Image is short enough to fit in the remaining rows of the search region.
-				&& image_width <= screen_width - i%screen_width)  // Image is narrow enough not to exceed the right-side boundary of the search region.
-			{
-				// Check if this candidate region -- which is a subset of the search region whose height and width
-				// matches that of the image -- is a pixel-for-pixel match of the image.
-				for (found = true, x = 0, y = 0, j = 0, k = i; j < image_pixel_count; ++j)
-				{
-					if (!(found = (screen_pixel[k] == image_pixel[j] // At least one pixel doesn't match, so this candidate is discarded.
-						|| image_mask && image_mask[j]      // Or: It's an icon's transparent pixel, which matches any color.
-						|| image_pixel[j] == trans_color))) // This should be okay even if trans_color==CLR_NONE, since CLR none should never occur naturally in the image.
-						break;
-					if (++x < image_width) // We're still within the same row of the image, so just move on to the next screen pixel.
-						++k;
-					else // We're starting a new row of the image.
-					{
-						x = 0; // Return to the leftmost column of the image.
-						++y;   // Move one row downward in the image.
-						// Move to the next row within the current-candiate region (not the entire search region).
-						// This is done by moving vertically downward from "i" (which is the upper-left pixel of the
-						// current-candidate region) by "y" rows.
-						k = i + y*screen_width; // Verified correct.
-					}
-				}
-				if (found) // Complete match found.
-					break;
-			}
-		}
-	}
-	else // Allow colors to vary by aVariation shades; i.e. approximate match is okay.
-	{
-		// The following section is part of the first-pixel-check optimization that improves performance by
-		// 15% or more depending on where and whether a match is found.  This section and one the follows
-		// later is commented out to reduce code size.
-		// Set high/low range for the first pixel of the image since it is the pixel most often checked
-		// (i.e. for performance).
-		//BYTE search_red1 = GetBValue(image_pixel[0]);  // Because it's RGB vs. BGR, the B value is fetched, not R (though it doesn't matter as long as everything is internally consistent here).
-		//BYTE search_green1 = GetGValue(image_pixel[0]);
-		//BYTE search_blue1 = GetRValue(image_pixel[0]); // Same comment as above.
-		//BYTE red_low1 = (aVariation > search_red1) ? 0 : search_red1 - aVariation;
-		//BYTE green_low1 = (aVariation > search_green1) ? 0 : search_green1 - aVariation;
-		//BYTE blue_low1 = (aVariation > search_blue1) ? 0 : search_blue1 - aVariation;
-		//BYTE red_high1 = (aVariation > 0xFF - search_red1) ? 0xFF : search_red1 + aVariation;
-		//BYTE green_high1 = (aVariation > 0xFF - search_green1) ? 0xFF : search_green1 + aVariation;
-		//BYTE blue_high1 = (aVariation > 0xFF - search_blue1) ? 0xFF : search_blue1 + aVariation;
-		// Above relies on the fact that the 16-bit conversion higher above was already done because like
-		// in PixelSearch, it seems more appropriate to do the 16-bit conversion prior to setting the range
-		// of high and low colors (vs. than applying 0xF8 to each of the high/low values individually).
-
-		BYTE red, green, blue;
-		BYTE search_red, search_green, search_blue;
-		BYTE red_low, green_low, blue_low, red_high, green_high, blue_high;
-
-		// The following loop is very similar to its counterpart above that finds an exact match, so maintain
-		// them together and see above for more detailed comments about it.
-		for (i = 0; i < screen_pixel_count; ++i)
-		{
-			// The following is commented out to trade code size reduction for performance (see comment above).
-			//red = GetBValue(screen_pixel[i]);   // Because it's RGB vs. BGR, the B value is fetched, not R (though it doesn't matter as long as everything is internally consistent here).
-			//green = GetGValue(screen_pixel[i]);
-			//blue = GetRValue(screen_pixel[i]);
-			//if ((red >= red_low1 && red <= red_high1
-			//	&& green >= green_low1 && green <= green_high1
-			//	&& blue >= blue_low1 && blue <= blue_high1 // All three color components are a match, so this screen pixel matches the image's first pixel.
-			//		|| image_mask && image_mask[0]         // Or: It's an icon's transparent pixel, which matches any color.
-			//		|| image_pixel[0] == trans_color)      // This should be okay even if trans_color==CLR_NONE, since CLR none should never occur naturally in the image.
-			//	&& image_height <= screen_height - i/screen_width // Image is short enough to fit in the remaining rows of the search region.
-			//	&& image_width <= screen_width - i%screen_width)  // Image is narrow enough not to exceed the right-side boundary of the search region.
-			
-			// Instead of the above, only this abbreviated check is done:
-			if (image_height <= screen_height - i/screen_width    // Image is short enough to fit in the remaining rows of the search region.
-				&& image_width <= screen_width - i%screen_width)  // Image is narrow enough not to exceed the right-side boundary of the search region.
-			{
-				// Since the first pixel is a match, check the other pixels.
-				for (found = true, x = 0, y = 0, j = 0, k = i; j < image_pixel_count; ++j)
-				{
-   					search_red = GetBValue(image_pixel[j]);
-	   				search_green = GetGValue(image_pixel[j]);
-		   			search_blue = GetRValue(image_pixel[j]);
-					SET_COLOR_RANGE
-   					red = GetBValue(screen_pixel[k]);
-	   				green = GetGValue(screen_pixel[k]);
-		   			blue = GetRValue(screen_pixel[k]);
-
-					if (!(found = red >= red_low && red <= red_high
-						&& green >= green_low && green <= green_high
-                        && blue >= blue_low && blue <= blue_high
-							|| image_mask && image_mask[j]     // Or: It's an icon's transparent pixel, which matches any color.
-							|| image_pixel[j] == trans_color)) // This should be okay even if trans_color==CLR_NONE, since CLR_NONE should never occur naturally in the image.
-						break; // At least one pixel doesn't match, so this candidate is discarded.
-					if (++x < image_width) // We're still within the same row of the image, so just move on to the next screen pixel.
-						++k;
-					else // We're starting a new row of the image.
-					{
-						x = 0; // Return to the leftmost column of the image.
-						++y;   // Move one row downward in the image.
-						k = i + y*screen_width; // Verified correct.
-					}
-				}
-				if (found) // Complete match found.
-					break;
-			}
-		}
-	}
-
-	if (!found) // Must override ErrorLevel to its new value prior to the label below.
+		PixelScanMask((ScanPixelType *)screen_pixel, screen_pixel_count, 0x00FFFFFF);
+
+	ScanImage image;
+	image.pixel = (ScanPixelType *)image_pixel;
+	image.mask = (ScanPixelType *)image_mask; // In addition to trans_color, image_mask (if non-NULL) is used to determine which pixels are transparent within the image and thus should match any color on the screen.
+	image.trans_color = trans_color; // This should be okay even if trans_color==CLR_NONE, since CLR_NONE should never occur naturally in the image.
+	image.width = image_width;
+	image.height = image_height;
+	image.variation = aVariation;
+	ImageScanPrepare(image);
+
+	match_count = ImageScanFindAll(image, (ScanPixelType *)screen_pixel, screen_width, screen_height
+		, find_all ? INT_MAX : 1, match, &sImageSearchHost);
+	if (match_count < 0) // Out of memory.  Leave ErrorLevel set to 2 and report the error below.
+		goto end;
+	found = match_count > 0;
+	if (found)
+		i = match[0];
+	else // Must override ErrorLevel to its new value prior to the label below.
 		g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // "1" indicates search completed okay, but didn't find it.
 
 end:
@@ -4787,14 +4823,6 @@ end:
 	// clean up then return.
 	ReleaseDC(NULL, hdc);
 	DeleteObject(hbitmap_image);
-	if (sdc)
-	{
-		if (sdc_orig_select) // i.e. the original call to SelectObject() didn't fail.
-			SelectObject(sdc, sdc_orig_select); // Probably necessary to prevent memory leak.
-		DeleteDC(sdc);
-	}
-	if (hbitmap_screen)
-		DeleteObject(hbitmap_screen);
 	if (image_pixel)
 		free(image_pixel);
 	if (image_mask)
@@ -4803,8 +4831,47 @@ end:
 		free(screen_pixel);
 
 	if (!found) // Let ErrorLevel, which is either "1" or "2" as set earlier, tell the story.
-		return OK;
+	{
+		if (match)
+			free(match);
+		return match_count < 0 ? LineError(ERR_OUTOFMEM) : OK;
+	}
+
+	if (find_all)
+	{
+		// Each output variable receives a linefeed-delimited list of coordinates, one for each match in the
+		// order they were found.  The lists are parallel, so item #n of each describes the same match.
+		if (output_var_x || output_var_y)
+		{
+			char *list = (char *)malloc(match_count * (MAX_INTEGER_LENGTH + 1) + 1); // +1 for each delimiter, and the final +1 for the terminator.
+			if (!list)
+			{
+				free(match);
+				return LineError(ERR_OUTOFMEM);
+			}
+			Var *output_var[] = {output_var_x, output_var_y};
+			for (int n = 0; n < 2; ++n)
+			{
+				if (!output_var[n])
+					continue;
+				for (cp = list, i = 0; i < match_count; ++i)
+					cp += sprintf(cp, i ? "\n%d" : "%d", n
+						? (aTop + match[i]/screen_width) - rect.top
+						: (aLeft + match[i]%screen_width) - rect.left);
+				if (!output_var[n]->Assign(list, (VarSizeType)(cp - list)))
+				{
+					free(list);
+					free(match);
+					return FAIL;
+				}
+			}
+			free(list);
+		}
+		free(match);
+		return g_ErrorLevel->Assign(ERRORLEVEL_NONE); // Indicate success.
+	}
 
+	free(match);
 	// Otherwise, success.  Calculate xpos and ypos of where the match was found and adjust
 	// coords to make them relative to the position of the target window (rect will contain
 	// zeroes if this doesn't need to be done):
@@ -5278,6 +5345,10 @@ LRESULT CALLBACK MainWindowProc(HWND hWnd, UINT iMsg, WPARAM wParam, LPARAM lPar
 		g_MenuIsVisible = MENU_TYPE_NONE; // See comments in similar code in GuiWindowProc().
 		break;
 
+	case WM_SETTINGCHANGE: // The user might have changed the names or format of dates and times.
+		FormatTimeNamesInvalidate();
+		break; // Let DefWindowProc() handle it too.
+
 	default:
 		// The following iMsg can't be in the switch() since it's not constant:
 		if (iMsg == WM_TASKBARCREATED && !g_NoTrayIcon) // !g_NoTrayIcon --> the tray icon should be always visible.
@@ -6139,6 +6210,105 @@ BOOL CALLBACK EnumChildFindPoint(HWND aWnd, LPARAM lParam)
 // Related to other commands //
 ///////////////////////////////
 
+// FormatTime produces most format pictures itself via FormatCalendarPicture() rather than GetDateFormat()
+// and GetTimeFormat(), which are slow enough to dominate scripts that format many timestamps (such as
+// those that process logs).  The names of the months and days are retrieved from the OS once per locale
+// and verified against the OS's own formatting, so any locale whose output can't be reproduced exactly
+// (such as one that uses a non-Gregorian calendar) continues to be formatted by the OS.
+static CalendarNames sFormatTimeNames;
+static LCID sFormatTimeNamesLCID;
+static int sFormatTimeNamesState = 0; // 0 = not yet retrieved, 1 = usable, -1 = the OS must do the formatting for this locale.
+
+void FormatTimeNamesInvalidate()
+// Called when the user's locale settings might have changed.
+{
+	sFormatTimeNamesState = 0;
+}
+
+
+
+static CalendarNames *FormatTimeNames(LCID aLCID)
+// Returns the names to use for aLCID, or NULL if the OS must do the formatting for this locale.
+{
+	if (sFormatTimeNamesState && sFormatTimeNamesLCID == aLCID)
+		return sFormatTimeNamesState > 0 ? &sFormatTimeNames : NULL;
+	sFormatTimeNamesLCID = aLCID;
+	sFormatTimeNamesState = -1; // Set default in case of early return.
+	CalendarNames &names = sFormatTimeNames;
+	char expected[CALENDAR_NAME_SIZE * 2 + 16], actual[CALENDAR_NAME_SIZE * 2 + 16];
+	if (!GetLocaleInfo(aLCID, LOCALE_ICALENDARTYPE, expected, sizeof(expected)) || ATOI(expected) != CAL_GREGORIAN)
+		return NULL;
+	int i, j;
+	for (i = 0; i < 12; ++i)
+		if (   !GetLocaleInfo(aLCID, LOCALE_SMONTHNAME1 + i, names.month[i], CALENDAR_NAME_SIZE)
+			|| !GetLocaleInfo(aLCID, LOCALE_SABBREVMONTHNAME1 + i, names.month_abbrev[i], CALENDAR_NAME_SIZE)   )
+			return NULL;
+	for (i = 0; i < 7; ++i) // The OS's list of days starts with Monday, but CalendarNames starts with Sunday.
+		if (   !GetLocaleInfo(aLCID, LOCALE_SDAYNAME1 + (i + 6) % 7, names.day[i], CALENDAR_NAME_SIZE)
+			|| !GetLocaleInfo(aLCID, LOCALE_SABBREVDAYNAME1 + (i + 6) % 7, names.day_abbrev[i], CALENDAR_NAME_SIZE)   )
+			return NULL;
+	if (   !GetLocaleInfo(aLCID, LOCALE_S1159, names.am, CALENDAR_NAME_SIZE)
+		|| !GetLocaleInfo(aLCID, LOCALE_S2359, names.pm, CALENDAR_NAME_SIZE)   )
+		return NULL;
+	names.month_genitive_differs = false; // Must be false during the check below.
+
+	// Have the OS format each name to confirm that the output will be identical.  A month name that differs
+	// only when next to a day number is the genitive form that some languages use (e.g. in Russian);
+	// such combinations are left to the OS.
+	static char *sMonthPicture[] = {"MMMM", "MMM", "d MMMM", "d MMM"};
+	static char *sDayPicture[] = {"dddd", "ddd"};
+	static char *sTimePicture[] = {"tt", "t"};
+	SYSTEMTIME st = {0};
+	CalendarTime ct = {2001, 1, 1, 0, 0, 0};
+	st.wYear = 2001;
+	st.wMonth = 1;
+	for (i = 0; i < 12; ++i)
+	{
+		st.wMonth = ct.month = i + 1;
+		st.wDay = ct.day = 1;
+		for (j = 0; j < 4; ++j)
+		{
+			if (   !GetDateFormat(aLCID, 0, &st, sMonthPicture[j], expected, sizeof(expected))
+				|| FormatCalendarPicture(sMonthPicture[j], false, ct, names, actual, sizeof(actual)) < 0   )
+				return NULL;
+			if (strcmp(expected, actual))
+			{
+				if (j < 2) // The standalone form differs, which isn't expected.
+					return NULL;
+				names.month_genitive_differs = true;
+			}
+		}
+	}
+	st.wMonth = ct.month = 1;
+	for (i = 0; i < 7; ++i)
+	{
+		st.wDay = ct.day = 7 + i; // 2001-01-07 was a Sunday.
+		for (j = 0; j < 2; ++j)
+			if (   !GetDateFormat(aLCID, 0, &st, sDayPicture[j], expected, sizeof(expected))
+				|| FormatCalendarPicture(sDayPicture[j], false, ct, names, actual, sizeof(actual)) < 0
+				|| strcmp(expected, actual)   )
+				return NULL;
+	}
+	for (i = 0; i < 2; ++i)
+	{
+		st.wHour = ct.hour = i * 12; // Midnight and noon.
+		for (j = 0; j < 2; ++j)
+		{
+			if (!GetTimeFormat(aLCID, 0, &st, sTimePicture[j], expected, sizeof(expected)))
+				return NULL;
+			int length = FormatCalendarPicture(sTimePicture[j], true, ct, names, actual, sizeof(actual));
+			if (length < 0 && j == 1) // "t" is declined for a multibyte designator, so leave it to the OS.
+				continue;
+			if (length < 0 || strcmp(expected, actual))
+				return NULL;
+		}
+	}
+	sFormatTimeNamesState = 1;
+	return &names;
+}
+
+
+
 ResultType Line::FormatTime(char *aYYYYMMDD, char *aFormat)
 // The compressed code size of this function is about 1 KB (2 KB uncompressed), which compares
 // favorably to using setlocale()+strftime(), which together are about 8 KB of compressed code
@@ -6399,6 +6569,27 @@ ResultType Line::FormatTime(char *aYYYYMMDD, char *aFormat)
 	if (!format_type1)
 		format_type1 = FT_FORMAT_DATE;
 
+	// When there's a format picture (as opposed to a default format or one that's affected by flags), try
+	// producing it without the OS.  This is done only for valid dates within the range the OS supports
+	// because the OS produces nothing for anything else.
+	CalendarNames *names;
+	if (aFormat && !date_flags && !time_flags
+		&& st.wYear >= CALENDAR_MIN_YEAR && st.wYear <= 9999 && st.wMonth >= 1 && st.wMonth <= 12
+		&& st.wDay >= 1 && st.wDay <= DaysInMonth(st.wYear, st.wMonth)
+		&& st.wHour < 24 && st.wMinute < 60 && st.wSecond < 60
+		&& (names = FormatTimeNames(lcid)))
+	{
+		CalendarTime ct = {st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond};
+		int length1 = FormatCalendarPicture(aFormat, format_type1 == FT_FORMAT_TIME, ct, *names, output_buf, FT_MAX_OUTPUT_CHARS + 1);
+		int length2 = 0;
+		if (length1 > -1 && format2_marker) // DATE came first, so the second is TIME (or vice versa).
+			length2 = FormatCalendarPicture(format2_marker, format_type1 == FT_FORMAT_DATE, ct, *names
+				, output_buf + length1, FT_MAX_OUTPUT_CHARS + 1 - length1);
+		if (length1 > -1 && length2 > -1)
+			return output_var.Assign(output_buf, length1 + length2);
+		//else something in the picture isn't supported, so fall back to the OS below.
+	}
+
 	// MSDN: Time: "The function checks each of the time values to determine that it is within the
 	// appropriate range of values. If any of the time values are outside the correct range, the
 	// function fails, and sets the last-error to ERROR_INVALID_PARAMETER. 
@@ -6760,8 +6951,22 @@ ResultType Line::StringSplit(char *aArrayName, char *aInputString, char *aDelimi
 	if (!*aInputString) // The input variable is blank, thus there will be zero elements.
 		return array0->Assign("0");  // Store the count in the 0th element.
 
+	// Global arrays are stored packed (see Script::StoreArrayElement).  Local arrays aren't because their
+	// variables are freed when the function returns anyway, and because a packed array would have to be
+	// backed up and restored for recursion.  The length check ensures that every element's name is short
+	// enough to be a valid variable name, which FindOrAddVar() would otherwise have reported.
+	PackedStringArray packed; // Emptied by SetPackedArray(), or freed upon return if it fails.
+	PackedStringArray *packed_elements = (always_use == ALWAYS_USE_GLOBAL
+		&& var_name_suffix - var_name + 10 <= MAX_VAR_NAME_LENGTH) ? &packed : NULL; // 10 is the number of digits in UINT_MAX.
+	#define STRINGSPLIT_FINISH(count) \
+	{\
+		*var_name_suffix = '\0';\
+		if (packed_elements && !g_script.SetPackedArray(var_name, packed))\
+			return FAIL;\
+		return array0->Assign(count);\
+	}
+
 	DWORD next_element_number;
-	Var *next_element;
 
 	if (*aDelimiterList) // The user provided a list of delimiters, so process the input variable normally.
 	{
@@ -6769,14 +6974,6 @@ ResultType Line::StringSplit(char *aArrayName, char *aInputString, char *aDelimi
 		size_t element_length;
 		for (contents_of_next_element = aInputString, next_element_number = 1; ; ++next_element_number)
 		{
-			_ultoa(next_element_number, var_name_suffix, 10);
-			// To help performance (in case the linked list of variables is huge), tell it where
-			// to start the search.  Use element #0 rather than the preceding element because,
-			// for example, Array19 is alphabetially less than Array2, so we can't rely on the
-			// numerical ordering:
-			if (   !(next_element = g_script.FindOrAddVar(var_name, 0, always_use))   )
-				return FAIL;  // It will have already displayed the error.
-
 			if (delimiter = StrChrAny(contents_of_next_element, aDelimiterList)) // A delimiter was found.
 			{
 				element_length = delimiter - contents_of_next_element;
@@ -6789,7 +6986,8 @@ ResultType Line::StringSplit(char *aArrayName, char *aInputString, char *aDelimi
 				}
 				// If there are no chars to the left of the delim, or if they were all in the list of omitted
 				// chars, the variable will be assigned the empty string:
-				if (!next_element->Assign(contents_of_next_element, (VarSizeType)element_length))
+				if (!g_script.StoreArrayElement(var_name, var_name_suffix, next_element_number, always_use
+					, packed_elements, contents_of_next_element, element_length))
 					return FAIL;
 				contents_of_next_element = delimiter + 1;  // Omit the delimiter since it's never included in contents.
 			}
@@ -6809,10 +7007,11 @@ ResultType Line::StringSplit(char *aArrayName, char *aInputString, char *aDelimi
 				}
 				// If there are no chars to the left of the delim, or if they were all in the list of omitted
 				// chars, the variable will be assigned the empty string:
-				if (!next_element->Assign(contents_of_next_element, (VarSizeType)element_length))
+				if (!g_script.StoreArrayElement(var_name, var_name_suffix, next_element_number, always_use
+					, packed_elements, contents_of_next_element, element_length))
 					return FAIL;
 				// This is the only way out of the loop other than critical errors:
-				return array0->Assign(next_element_number); // Store the count of how many items were stored in the array.
+				STRINGSPLIT_FINISH(next_element_number) // Store the count of how many items were stored in the array.
 			}
 		}
 	}
@@ -6826,14 +7025,12 @@ ResultType Line::StringSplit(char *aArrayName, char *aInputString, char *aDelimi
 				break;
 		if (*dp) // Omitted.
 			continue;
-		_ultoa(next_element_number, var_name_suffix, 10);
-		if (   !(next_element = g_script.FindOrAddVar(var_name, 0, always_use))   )
-			return FAIL;  // It will have already displayed the error.
-		if (!next_element->Assign(cp, 1))
+		if (!g_script.StoreArrayElement(var_name, var_name_suffix, next_element_number, always_use
+			, packed_elements, cp, 1))
 			return FAIL;
 		++next_element_number; // Only increment this if above didn't "continue".
 	}
-	return array0->Assign(next_element_number - 1); // Store the count of how many items were stored in the array.
+	STRINGSPLIT_FINISH(next_element_number - 1) // Store the count of how many items were stored in the array.
 }
 
 
@@ -7330,6 +7527,7 @@ ResultType Line::PerformSort(char *aContents, char *aOptions)
 	// Use item_count + 1 to allow space for the last (blank) item in case
 	// trailing_delimiter_indicates_trailing_blank_item is false:
 	int unit_size = sort_random ? 2 : 1;
+	RandomState *random_stream = sort_random ? &ThreadRandomState() : NULL;
 	size_t item_size = unit_size * sizeof(char *);
 	char **item = (char **)malloc((item_count + 1) * item_size);
 	if (!item)
@@ -7359,8 +7557,10 @@ ResultType Line::PerformSort(char *aContents, char *aOptions)
 			*cp = '\0';  // Terminate the item that appears before this delimiter.
 			++item_count;
 			if (sort_random)
-				*(item_curr + 1) = (char *)(size_t)genrand_int31(); // i.e. the randoms are in the odd fields, the pointers in the even.
+				*(item_curr + 1) = (char *)(size_t)(RandomNext(*random_stream) >> 33); // i.e. the randoms are in the odd fields, the pointers in the even.
 				// For the above:
+				// A 31-bit number is used because SortRandom() subtracts two of them, which must not overflow.
+				// Historical note from when the Mersenne Twister was used:
 				// I don't know the exact reasons, but using genrand_int31() is much more random than
 				// using genrand_int32() in this case.  Perhaps it is some kind of statistical/cyclical
 				// anomaly in the random number generator.  Or perhaps it's something to do with integer
@@ -7389,7 +7589,7 @@ ResultType Line::PerformSort(char *aContents, char *aOptions)
 	{
 		++item_count;
 		if (sort_random) // Provide a random number for the last item.
-			*(item_curr + 1) = (char *)(size_t)genrand_int31(); // i.e. the randoms are in the odd fields, the pointers in the even.
+			*(item_curr + 1) = (char *)(size_t)(RandomNext(*random_stream) >> 33); // i.e. the randoms are in the odd fields, the pointers in the even.
 	}
 	else // Since the final item is not included in the count, point item_curr to the one before the last, for use below.
 		item_curr -= unit_size;
@@ -8834,6 +9034,113 @@ ResultType Line::FileReadLine(char *aFilespec, char *aLineNumber)
 
 
 
+// FileAppend normally opens and closes the file every time it's called, which dominates the cost of a loop
+// that logs one line at a time.  After "FileBuffer, On", FileAppend instead keeps each file it writes to open
+// with a large buffer (see filewriter.h) so that consecutive appends are combined into a few large writes.
+// Since neither other programs nor the script's own file commands would see text that's still in a buffer,
+// the buffers are written out whenever the current thread finishes and before anything else in the script
+// that might look at a file (IfExist, FileExist(), Loop-Read, IniRead, FileSelectFile, FileRead and the other
+// file commands).  The files themselves stay open until a command that might alter, move or delete one of them
+// (such as FileCopy, FileMove, FileDelete or IniWrite), Run/RunWait, "FileBuffer, Flush" or "Off", or exit
+// closes them.  In addition, a timer writes out the buffers once the oldest unwritten text reaches MaxAge, and
+// so does any FileAppend made after that.  Since the timer can fire only while messages are being checked,
+// text can remain unwritten somewhat longer than MaxAge while the script is busy or uninterruptible.
+#define FILE_WRITER_DEFAULT_MAX_AGE 1000 // Milliseconds.
+
+class Win32FileWriterHost : public FileWriterHost
+{
+public:
+	void FullPath(const char *aFilespec, char *aBuf, size_t aBufSize)
+	{
+		char *filename_marker;
+		DWORD length = GetFullPathName(aFilespec, (DWORD)aBufSize, aBuf, &filename_marker);
+		if (!length || length >= aBufSize) // Let fopen() decide what to make of it.
+			strlcpy(aBuf, aFilespec, aBufSize);
+	}
+
+	unsigned TickCount() {return GetTickCount();}
+};
+
+static Win32FileWriterHost sFileWriterHost;
+static FileWriterCache sFileWriters(sFileWriterHost);
+static bool sFileBufferIsOn = false;
+static DWORD sFileBufferMaxAge = FILE_WRITER_DEFAULT_MAX_AGE;
+// g_FileWriterCount (the number of files sFileWriters has open) is global so that callers can cheaply check it.
+
+
+
+bool FileWriterFlushAll()
+// Writes out the buffered text of every file but leaves them open.
+// Returns false if the buffered text of any of the files could not be written.
+{
+	KILL_FILE_WRITER_TIMER // Nothing is left for it to write.
+	return sFileWriters.FlushAll();
+}
+
+
+
+bool FileWriterCloseAll()
+// Returns false if the buffered text of any of the files could not be written.
+{
+	KILL_FILE_WRITER_TIMER
+	bool result = sFileWriters.CloseAll();
+	g_FileWriterCount = 0;
+	return result;
+}
+
+
+
+VOID CALLBACK FileWriterTimeout(HWND hWnd, UINT uMsg, UINT idEvent, DWORD dwTime)
+// Writes out the text that FileAppend has been holding in a buffer for MaxAge (see FileBuffer).
+{
+	FileWriterFlushAll(); // It also kills the timer.
+}
+
+
+
+#ifdef REPORT_EXIT_STATS
+void ReportFileWriters()
+// Sends the statistics of buffered FileAppend to the debugger (or a tool such as DebugView).
+{
+	if (!sFileWriters.Appends())
+		return;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "FileAppend buffering: %u appends (%u KB), %u opens, %u flushes\n"
+		, sFileWriters.Appends(), (unsigned)(sFileWriters.Bytes() / 1024), sFileWriters.Opens(), sFileWriters.Flushes());
+	OutputDebugString(buf);
+}
+#endif
+
+
+
+ResultType Line::FileBuffer(char *aCmd, char *aMaxAge)
+// FileBuffer, On [, MaxAge]: Causes FileAppend to keep files open and buffered as described above.  MaxAge is
+//     the number of milliseconds after which buffered text is written out by the timer or the next FileAppend
+//     (zero writes it out after every FileAppend, which still avoids opening and closing the file each time).
+//     If omitted, the previous value is kept.
+// FileBuffer, Off: Writes out and closes all buffered files, then returns FileAppend to its normal behavior.
+// FileBuffer, Flush: Writes out and closes all buffered files.
+// For Off and Flush, ErrorLevel is set to 1 if any of the buffered text could not be written.
+{
+	if (!stricmp(aCmd, "On"))
+	{
+		if (*aMaxAge)
+		{
+			int max_age = ATOI(aMaxAge);
+			sFileBufferMaxAge = max_age > 0 ? max_age : 0;
+		}
+		sFileBufferIsOn = true;
+		return OK;
+	}
+	if (!stricmp(aCmd, "Off"))
+		sFileBufferIsOn = false;
+	else if (stricmp(aCmd, "Flush"))
+		return LineError(ERR_PARAM1_INVALID, FAIL, aCmd);
+	return g_ErrorLevel->Assign(FileWriterCloseAll() ? ERRORLEVEL_NONE : ERRORLEVEL_ERROR);
+}
+
+
+
 ResultType Line::FileAppend(char *aFilespec, char *aBuf, LoopReadFileStruct *aCurrentReadFile)
 {
 	// The below is avoided because want to allow "nothing" to be written to a file in case the
@@ -8902,6 +9209,15 @@ ResultType Line::FileAppend(char *aFilespec, char *aBuf, LoopReadFileStruct *aCu
 		// That is useful to write Unix style text files whose lines end in solitary linefeeds.
 	}
 
+	if (sFileBufferIsOn && !aCurrentReadFile) // See "FileBuffer" above.
+	{
+		bool result = sFileWriters.Append(aFilespec, aBuf, open_as_binary, sFileBufferMaxAge);
+		g_FileWriterCount = sFileWriters.Count();
+		if (sFileBufferMaxAge && sFileWriters.HasPending())
+			SET_FILE_WRITER_TIMER(sFileBufferMaxAge)
+		return g_ErrorLevel->Assign(result ? ERRORLEVEL_NONE : ERRORLEVEL_ERROR);
+	}
+
 	// Check if the file needes to be opened.  As of 1.0.25, this is done here rather than
 	// at the time the loop first begins so that:
 	// 1) Binary mode can be auto-detected if the first block of text appended to the file
@@ -9112,61 +9428,52 @@ ResultType Line::FileDelete()
 	if (ArgLength(1) >= MAX_PATH) // Checked early to simplify things later below.
 		return OK; // Return OK because this is non-critical.  Due to rarity (and backward compatibility), it seems best leave ErrorLevel at 1 to indicate the problem
 
-	LONG_OPERATION_INIT
-	int failure_count = 0; // Set default.
-
-	WIN32_FIND_DATA current_file;
-	HANDLE file_search = FindFirstFile(aFilePattern, &current_file);
-	if (file_search == INVALID_HANDLE_VALUE) // No matching files found.
-		return g_ErrorLevel->Assign(0); // Deleting a wildcard pattern that matches zero files is a success.
-
-	// Otherwise:
-	char file_path[MAX_PATH];
+	char file_path[MAX_PATH], file_pattern[MAX_PATH];
 	strcpy(file_path, aFilePattern); // Above has already confirmed this won't overflow.
 
-	// Remove the filename and/or wildcard part.   But leave the trailing backslash on it for
-	// consistency with below:
-	size_t file_path_length;
+	// Separate the path from the filename and/or wildcard part.  But leave the trailing backslash on the
+	// path, as required by FileEnumHost:
 	char *last_backslash = strrchr(file_path, '\\');
 	if (last_backslash)
 	{
+		strcpy(file_pattern, last_backslash + 1); // No danger of overflow due size of src vs. dest.
 		*(last_backslash + 1) = '\0'; // i.e. retain the trailing backslash.
-		file_path_length = strlen(file_path);
 	}
 	else // Use current working directory, e.g. if user specified only *.*
 	{
+		strcpy(file_pattern, file_path);
 		*file_path = '\0';
-		file_path_length = 0;
 	}
 
-	char *append_pos = file_path + file_path_length; // For performance, copy in the unchanging part only once.  This is where the changing part gets appended.
-	size_t space_remaining = sizeof(file_path) - file_path_length - 1; // Space left in file_path for the changing part.
+	// Since this is a single folder, DirEnum lists it on this thread (no worker threads are needed), a chunk
+	// at a time.  As with the FindNextFile() loop used formerly, files are deleted from the folder while the
+	// rest of it is still being searched, which is supported by the OS.
+	// FILE_LOOP_FILES_ONLY causes any matching directories to be skipped.
+	DirEnum file_enum(new FileEnumHost(file_path, file_pattern, FILE_LOOP_FILES_ONLY)
+		, sizeof(WIN32_FIND_DATA), false, false);
+	if (!file_enum.Start(file_path))
+		return OK; // Out of memory, so leave ErrorLevel at 1 to indicate the problem.
 
-	do
+	LONG_OPERATION_INIT
+	int failure_count = 0; // Set default.
+	WIN32_FIND_DATA *current_file;
+
+	while (current_file = (WIN32_FIND_DATA *)file_enum.Next()) // Each cFileName includes the file's path.
 	{
 		// Since other script threads can interrupt during LONG_OPERATION_UPDATE, it's important that
 		// this command not refer to sArgDeref[] and sArgVar[] anytime after an interruption becomes
 		// possible. This is because an interrupting thread usually changes the values to something
 		// inappropriate for this thread.
 		LONG_OPERATION_UPDATE
-		if (current_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) // skip any matching directories.
-			continue;
-		if (strlen(current_file.cFileName) > space_remaining)
-		{
-			// v1.0.45.03: Don't even try to operate upon truncated filenames in case they accidentally
-			// match the name of a real/existing file.
+		if (!DeleteFile(current_file->cFileName))
 			++failure_count;
-		}
-		else
-		{
-			strcpy(append_pos, current_file.cFileName); // Above has ensured this won't overflow.
-			if (!DeleteFile(file_path))
-				++failure_count;
-		}
-	} while (FindNextFile(file_search, &current_file));
-	FindClose(file_search);
+	}
 
-	return g_ErrorLevel->Assign(failure_count); // i.e. indicate success if there were no failures.
+	// v1.0.45.03: Files whose full paths are too long were skipped rather than operated upon in case their
+	// truncated names accidentally match the name of a real/existing file.  They count as failures.
+	// If no files matched, failure_count is 0 because deleting a wildcard pattern that matches zero files
+	// is a success.
+	return g_ErrorLevel->Assign(failure_count + (int)file_enum.SkippedCount()); // i.e. indicate success if there were no failures.
 }
 
 
@@ -9197,7 +9504,7 @@ ResultType Line::FileInstall(char *aSource, char *aDest, char *aFlag)
 	// v1.0.46.15: The following is a fix for the fact that a compiled script (but not an uncompiled one)
 	// that executes FileInstall somehow causes the Random command to generate the same series of random
 	// numbers every time the script launches. Perhaps the answer lies somewhere in oRead's code --
-	// something that somehow resets the static data used by init_genrand().
+	// something that somehow resets the static data used by init_genrand() (the Mersenne Twister used at the time).
 	RESEED_RANDOM_GENERATOR;
 
 	if (result != HS_EXEARC_E_OK)
@@ -9244,17 +9551,14 @@ ResultType Line::FileGetAttrib(char *aFilespec)
 
 
 int Line::FileSetAttrib(char *aAttributes, char *aFilePattern, FileLoopModeType aOperateOnFolders
-	, bool aDoRecurse, bool aCalledRecursively)
+	, bool aDoRecurse)
 // Returns the number of files and folders that could not be changed due to an error.
 {
-	if (!aCalledRecursively)  // i.e. Only need to do this if we're not called by ourself:
-	{
-		g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default
-		if (!*aFilePattern)
-			return 0;  // Let ErrorLevel indicate an error, since this is probably not what the user intended.
-		if (aOperateOnFolders == FILE_LOOP_INVALID) // In case runtime dereference of a var was an invalid value.
-			aOperateOnFolders = FILE_LOOP_FILES_ONLY;  // Set default.
-	}
+	g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default
+	if (!*aFilePattern)
+		return 0;  // Let ErrorLevel indicate an error, since this is probably not what the user intended.
+	if (aOperateOnFolders == FILE_LOOP_INVALID) // In case runtime dereference of a var was an invalid value.
+		aOperateOnFolders = FILE_LOOP_FILES_ONLY;  // Set default.
 
 	if (strlen(aFilePattern) >= MAX_PATH) // Checked early to simplify other things below.
 		return 0; // Let the above ErrorLevel indicate the problem.
@@ -9271,194 +9575,125 @@ int Line::FileSetAttrib(char *aAttributes, char *aFilePattern, FileLoopModeType
 	// Therefore, as of v1.0.25, there is also a hard limit of MAX_PATH on all these variables.
 	// MSDN confirms this in a vague way: "In the ANSI version of FindFirstFile(), [plpFileName] is
 	// limited to MAX_PATH characters."
-	char file_pattern[MAX_PATH], file_path[MAX_PATH]; // Giving +3 extra for "*.*" seems fairly pointless because any files that actually need that extra room would fail to be retrieved by FindFirst/Next due to their inability to support paths much over 256.
-	strcpy(file_pattern, aFilePattern); // Make a copy in case of overwrite of deref buf during LONG_OPERATION/MsgSleep.
-	strcpy(file_path, aFilePattern);    // An earlier check has ensured these won't overflow.
+	char file_path[MAX_PATH], file_pattern[MAX_PATH];
+	strcpy(file_path, aFilePattern); // An earlier check has ensured this won't overflow.
 
-	size_t file_path_length; // The length of just the path portion of the filespec.
+	// Separate the path from the naked filename or pattern, which is also used to search each subfolder
+	// when aDoRecurse is true.  But leave the trailing backslash on the path, as required by FileEnumHost:
 	char *last_backslash = strrchr(file_path, '\\');
 	if (last_backslash)
 	{
-		// Remove the filename and/or wildcard part.   But leave the trailing backslash on it for
-		// consistency with below:
+		strcpy(file_pattern, last_backslash + 1); // No danger of overflow due size of src vs. dest.
 		*(last_backslash + 1) = '\0';
-		file_path_length = strlen(file_path);
 	}
 	else // Use current working directory, e.g. if user specified only *.*
 	{
+		strcpy(file_pattern, file_path);
 		*file_path = '\0';
-		file_path_length = 0;
 	}
-	char *append_pos = file_path + file_path_length; // For performance, copy in the unchanging part only once.  This is where the changing part gets appended.
-	size_t space_remaining = sizeof(file_path) - file_path_length - 1; // Space left in file_path for the changing part.
-
-	// For use with aDoRecurse, get just the naked file name/pattern:
-	char *naked_filename_or_pattern = strrchr(file_pattern, '\\');
-	if (naked_filename_or_pattern)
-		++naked_filename_or_pattern;
-	else
-		naked_filename_or_pattern = file_pattern;
 
-	if (!StrChrAny(naked_filename_or_pattern, "?*"))
+	if (!StrChrAny(file_pattern, "?*"))
 		// Since no wildcards, always operate on this single item even if it's a folder.
 		aOperateOnFolders = FILE_LOOP_FILES_AND_FOLDERS;
 
+	// The order in which files are changed doesn't matter, so DirEnum's unordered mode is used.  This lets
+	// each folder be processed as soon as any thread has listed it rather than in depth-first order.
+	DirEnum file_enum(new FileEnumHost(file_path, file_pattern, aOperateOnFolders)
+		, sizeof(WIN32_FIND_DATA), aDoRecurse, false);
+	if (!file_enum.Start(file_path))
+		return 0; // Out of memory, so let ErrorLevel indicate the problem.
+
 	char *cp;
 	enum attrib_modes {ATTRIB_MODE_NONE, ATTRIB_MODE_ADD, ATTRIB_MODE_REMOVE, ATTRIB_MODE_TOGGLE};
 	attrib_modes mode = ATTRIB_MODE_NONE;
 
 	LONG_OPERATION_INIT
 	int failure_count = 0;
-	WIN32_FIND_DATA current_file;
-	HANDLE file_search = FindFirstFile(file_pattern, &current_file);
+	WIN32_FIND_DATA *current_file;
 
-	if (file_search != INVALID_HANDLE_VALUE)
+	while (current_file = (WIN32_FIND_DATA *)file_enum.Next()) // Each cFileName includes the file's path.
 	{
-		do
-		{
-			// Since other script threads can interrupt during LONG_OPERATION_UPDATE, it's important that
-			// this command not refer to sArgDeref[] and sArgVar[] anytime after an interruption becomes
-			// possible. This is because an interrupting thread usually changes the values to something
-			// inappropriate for this thread.
-			LONG_OPERATION_UPDATE
-
-			if (current_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-			{
-				if (current_file.cFileName[0] == '.' && (!current_file.cFileName[1]    // Relies on short-circuit boolean order.
-					|| current_file.cFileName[1] == '.' && !current_file.cFileName[2]) //
-					// Regardless of whether this folder will be recursed into, this folder's own attributes
-					// will not be affected when the mode is files-only:
-					|| aOperateOnFolders == FILE_LOOP_FILES_ONLY)
-					continue; // Never operate upon or recurse into these.
-			}
-			else // It's a file, not a folder.
-				if (aOperateOnFolders == FILE_LOOP_FOLDERS_ONLY)
-					continue;
-
-			if (strlen(current_file.cFileName) > space_remaining)
-			{
-				// v1.0.45.03: Don't even try to operate upon truncated filenames in case they accidentally
-				// match the name of a real/existing file.
-				++failure_count;
-				continue;
-			}
-			// Otherwise, make file_path be the filespec of the file to operate upon:
-			strcpy(append_pos, current_file.cFileName); // Above has ensured this won't overflow.
+		// Since other script threads can interrupt during LONG_OPERATION_UPDATE, it's important that
+		// this command not refer to sArgDeref[] and sArgVar[] anytime after an interruption becomes
+		// possible. This is because an interrupting thread usually changes the values to something
+		// inappropriate for this thread.
+		LONG_OPERATION_UPDATE
 
-			for (cp = attributes; *cp; ++cp)
+		for (cp = attributes; *cp; ++cp)
+		{
+			switch (toupper(*cp))
 			{
-				switch (toupper(*cp))
-				{
-				case '+': mode = ATTRIB_MODE_ADD; break;
-				case '-': mode = ATTRIB_MODE_REMOVE; break;
-				case '^': mode = ATTRIB_MODE_TOGGLE; break;
-				// Note that D (directory) and C (compressed) are currently not supported:
-				case 'R':
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_READONLY;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_READONLY;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_READONLY;
-					break;
-				case 'A':
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_ARCHIVE;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_ARCHIVE;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_ARCHIVE;
-					break;
-				case 'S':
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_SYSTEM;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_SYSTEM;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_SYSTEM;
-					break;
-				case 'H':
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_HIDDEN;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_HIDDEN;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_HIDDEN;
-					break;
-				case 'N':  // Docs say it's valid only when used alone.  But let the API handle it if this is not so.
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_NORMAL;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_NORMAL;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_NORMAL;
-					break;
-				case 'O':
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_OFFLINE;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_OFFLINE;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_OFFLINE;
-					break;
-				case 'T':
-					if (mode == ATTRIB_MODE_ADD)
-						current_file.dwFileAttributes |= FILE_ATTRIBUTE_TEMPORARY;
-					else if (mode == ATTRIB_MODE_REMOVE)
-						current_file.dwFileAttributes &= ~FILE_ATTRIBUTE_TEMPORARY;
-					else if (mode == ATTRIB_MODE_TOGGLE)
-						current_file.dwFileAttributes ^= FILE_ATTRIBUTE_TEMPORARY;
-					break;
-				}
+			case '+': mode = ATTRIB_MODE_ADD; break;
+			case '-': mode = ATTRIB_MODE_REMOVE; break;
+			case '^': mode = ATTRIB_MODE_TOGGLE; break;
+			// Note that D (directory) and C (compressed) are currently not supported:
+			case 'R':
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_READONLY;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_READONLY;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_READONLY;
+				break;
+			case 'A':
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_ARCHIVE;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_ARCHIVE;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_ARCHIVE;
+				break;
+			case 'S':
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_SYSTEM;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_SYSTEM;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_SYSTEM;
+				break;
+			case 'H':
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_HIDDEN;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_HIDDEN;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_HIDDEN;
+				break;
+			case 'N':  // Docs say it's valid only when used alone.  But let the API handle it if this is not so.
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_NORMAL;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_NORMAL;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_NORMAL;
+				break;
+			case 'O':
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_OFFLINE;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_OFFLINE;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_OFFLINE;
+				break;
+			case 'T':
+				if (mode == ATTRIB_MODE_ADD)
+					current_file->dwFileAttributes |= FILE_ATTRIBUTE_TEMPORARY;
+				else if (mode == ATTRIB_MODE_REMOVE)
+					current_file->dwFileAttributes &= ~FILE_ATTRIBUTE_TEMPORARY;
+				else if (mode == ATTRIB_MODE_TOGGLE)
+					current_file->dwFileAttributes ^= FILE_ATTRIBUTE_TEMPORARY;
+				break;
 			}
+		}
 
-			if (!SetFileAttributes(file_path, current_file.dwFileAttributes))
-				++failure_count;
-		} while (FindNextFile(file_search, &current_file));
+		if (!SetFileAttributes(current_file->cFileName, current_file->dwFileAttributes))
+			++failure_count;
+	}
 
-		FindClose(file_search);
-	} // if (file_search != INVALID_HANDLE_VALUE)
-
-	if (aDoRecurse && space_remaining > 2) // The space_remaining check ensures there's enough room to append "*.*" (if not, just avoid recursing into it due to rarity).
-	{
-		// Testing shows that the ANSI version of FindFirstFile() will not accept a path+pattern longer
-		// than 256 or so, even if the pattern would match files whose names are short enough to be legal.
-		// Therefore, as of v1.0.25, there is also a hard limit of MAX_PATH on all these variables.
-		// MSDN confirms this in a vague way: "In the ANSI version of FindFirstFile(), [plpFileName] is
-		// limited to MAX_PATH characters."
-		strcpy(append_pos, "*.*"); // Above has ensured this won't overflow.
-		file_search = FindFirstFile(file_path, &current_file);
-
-		if (file_search != INVALID_HANDLE_VALUE)
-		{
-			size_t pattern_length = strlen(naked_filename_or_pattern);
-			do
-			{
-				LONG_OPERATION_UPDATE
-				if (!(current_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-					|| current_file.cFileName[0] == '.' && (!current_file.cFileName[1]     // Relies on short-circuit boolean order.
-						|| current_file.cFileName[1] == '.' && !current_file.cFileName[2]) //
-					// v1.0.45.03: Skip over folders whose full-path-names are too long to be supported by the ANSI
-					// versions of FindFirst/FindNext.  Without this fix, it might be possible for infinite recursion
-					// to occur (see PerformLoop() for more comments).
-					|| pattern_length + strlen(current_file.cFileName) >= space_remaining) // >= vs. > to reserve 1 for the backslash to be added between cFileName and naked_filename_or_pattern.
-					continue; // Never recurse into these.
-				// This will build the string CurrentDir+SubDir+FilePatternOrName.
-				// If FilePatternOrName doesn't contain a wildcard, the recursion
-				// process will attempt to operate on the originally-specified
-				// single filename or folder name if it occurs anywhere else in the
-				// tree, e.g. recursing C:\Temp\temp.txt would affect all occurences
-				// of temp.txt both in C:\Temp and any subdirectories it might contain:
-				sprintf(append_pos, "%s\\%s" // Above has ensured this won't overflow.
-					, current_file.cFileName, naked_filename_or_pattern);
-				failure_count += FileSetAttrib(attributes, file_path, aOperateOnFolders, aDoRecurse, true);
-			} while (FindNextFile(file_search, &current_file));
-			FindClose(file_search);
-		} // if (file_search != INVALID_HANDLE_VALUE)
-	} // if (aDoRecurse)
-
-	if (!aCalledRecursively) // i.e. Only need to do this if we're returning to top-level caller:
-		g_ErrorLevel->Assign(failure_count); // i.e. indicate success if there were no failures.
+	// v1.0.45.03: Files whose full paths are too long were skipped rather than operated upon in case their
+	// truncated names accidentally match the name of a real/existing file.  They count as failures.
+	failure_count += (int)file_enum.SkippedCount();
+	g_ErrorLevel->Assign(failure_count); // i.e. indicate success if there were no failures.
 	return failure_count;
 }
 
@@ -9501,37 +9736,23 @@ ResultType Line::FileGetTime(char *aFilespec, char aWhichTime)
 
 
 int Line::FileSetTime(char *aYYYYMMDD, char *aFilePattern, char aWhichTime
-	, FileLoopModeType aOperateOnFolders, bool aDoRecurse, bool aCalledRecursively)
+	, FileLoopModeType aOperateOnFolders, bool aDoRecurse)
 // Returns the number of files and folders that could not be changed due to an error.
-// Current limitation: It will not recurse into subfolders unless their names also match
-// aFilePattern.
 {
-	if (!aCalledRecursively)  // i.e. Only need to do this if we're not called by ourself:
-	{
-		g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default
-		if (!*aFilePattern)
-			return 0;  // Let ErrorLevel indicate an error, since this is probably not what the user intended.
-		if (aOperateOnFolders == FILE_LOOP_INVALID) // In case runtime dereference of a var was an invalid value.
-			aOperateOnFolders = FILE_LOOP_FILES_ONLY;  // Set default.
-	}
+	g_ErrorLevel->Assign(ERRORLEVEL_ERROR); // Set default
+	if (!*aFilePattern)
+		return 0;  // Let ErrorLevel indicate an error, since this is probably not what the user intended.
+	if (aOperateOnFolders == FILE_LOOP_INVALID) // In case runtime dereference of a var was an invalid value.
+		aOperateOnFolders = FILE_LOOP_FILES_ONLY;  // Set default.
 
 	if (strlen(aFilePattern) >= MAX_PATH) // Checked early to simplify other things below.
 		return 0; // Let the above ErrorLevel indicate the problem.
 
-	// Related to the comment at the top: Since the script subroutine that resulted in the call to
-	// this function can be interrupted during our MsgSleep(), make a copy of any params that might
-	// currently point directly to the deref buffer.  This is done because their contents might
-	// be overwritten by the interrupting subroutine:
-	char yyyymmdd[64]; // Even do this one since its value is passed recursively in calls to self.
-	strlcpy(yyyymmdd, aYYYYMMDD, sizeof(yyyymmdd));
-	char file_pattern[MAX_PATH];
-	strcpy(file_pattern, aFilePattern); // An earlier check has ensured this won't overflow.
-
 	FILETIME ft, ftUTC;
-	if (*yyyymmdd)
+	if (*aYYYYMMDD)
 	{
 		// Convert the arg into the time struct as local (non-UTC) time:
-		if (!YYYYMMDDToFileTime(yyyymmdd, ft))
+		if (!YYYYMMDDToFileTime(aYYYYMMDD, ft))
 			return 0;  // Let ErrorLevel tell the story.
 		// Convert from local to UTC:
 		if (!LocalFileTimeToFileTime(&ft, &ftUTC))
@@ -9540,150 +9761,85 @@ int Line::FileSetTime(char *aYYYYMMDD, char *aFilePattern, char aWhichTime
 	else // User wants to use the current time (i.e. now) as the new timestamp.
 		GetSystemTimeAsFileTime(&ftUTC);
 
-	// This following section is very similar to that in FileSetAttrib and FileDelete:
-	char file_path[MAX_PATH]; // Giving +3 extra for "*.*" seems fairly pointless because any files that actually need that extra room would fail to be retrieved by FindFirst/Next due to their inability to support paths much over 256.
+	// This following section is very similar to that in FileSetAttrib and FileDelete.
+	// Related to the comment at the top: Since the script subroutine that resulted in the call to
+	// this function can be interrupted during our MsgSleep(), the path and pattern are copied out of
+	// aFilePattern (which might point directly to the deref buffer) before that becomes possible.
+	char file_path[MAX_PATH], file_pattern[MAX_PATH];
 	strcpy(file_path, aFilePattern); // An earlier check has ensured this won't overflow.
-
-	size_t file_path_length; // The length of just the path portion of the filespec.
 	char *last_backslash = strrchr(file_path, '\\');
 	if (last_backslash)
 	{
-		// Remove the filename and/or wildcard part.   But leave the trailing backslash on it for
-		// consistency with below:
-		*(last_backslash + 1) = '\0';
-		file_path_length = strlen(file_path);
+		strcpy(file_pattern, last_backslash + 1); // No danger of overflow due size of src vs. dest.
+		*(last_backslash + 1) = '\0'; // Retain the trailing backslash, as required by FileEnumHost.
 	}
 	else // Use current working directory, e.g. if user specified only *.*
 	{
+		strcpy(file_pattern, file_path);
 		*file_path = '\0';
-		file_path_length = 0;
 	}
-	char *append_pos = file_path + file_path_length; // For performance, copy in the unchanging part only once.  This is where the changing part gets appended.
-	size_t space_remaining = sizeof(file_path) - file_path_length - 1; // Space left in file_path for the changing part.
-
-	// For use with aDoRecurse, get just the naked file name/pattern:
-	char *naked_filename_or_pattern = strrchr(file_pattern, '\\');
-	if (naked_filename_or_pattern)
-		++naked_filename_or_pattern;
-	else
-		naked_filename_or_pattern = file_pattern;
 
-	if (!StrChrAny(naked_filename_or_pattern, "?*"))
+	if (!StrChrAny(file_pattern, "?*"))
 		// Since no wildcards, always operate on this single item even if it's a folder.
 		aOperateOnFolders = FILE_LOOP_FILES_AND_FOLDERS;
 
+	// See FileSetAttrib() for why unordered mode is used.
+	DirEnum file_enum(new FileEnumHost(file_path, file_pattern, aOperateOnFolders)
+		, sizeof(WIN32_FIND_DATA), aDoRecurse, false);
+	if (!file_enum.Start(file_path))
+		return 0; // Out of memory, so let ErrorLevel indicate the problem.
+
 	HANDLE hFile;
 	LONG_OPERATION_INIT
 	int failure_count = 0;
-	WIN32_FIND_DATA current_file;
-	HANDLE file_search = FindFirstFile(file_pattern, &current_file);
+	WIN32_FIND_DATA *current_file;
 
-	if (file_search != INVALID_HANDLE_VALUE)
+	while (current_file = (WIN32_FIND_DATA *)file_enum.Next()) // Each cFileName includes the file's path.
 	{
-		do
-		{
-			// Since other script threads can interrupt during LONG_OPERATION_UPDATE, it's important that
-			// this command not refer to sArgDeref[] and sArgVar[] anytime after an interruption becomes
-			// possible. This is because an interrupting thread usually changes the values to something
-			// inappropriate for this thread.
-			LONG_OPERATION_UPDATE
+		// Since other script threads can interrupt during LONG_OPERATION_UPDATE, it's important that
+		// this command not refer to sArgDeref[] and sArgVar[] anytime after an interruption becomes
+		// possible. This is because an interrupting thread usually changes the values to something
+		// inappropriate for this thread.
+		LONG_OPERATION_UPDATE
 
-			if (current_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-			{
-				if (current_file.cFileName[0] == '.' && (!current_file.cFileName[1]    // Relies on short-circuit boolean order.
-					|| current_file.cFileName[1] == '.' && !current_file.cFileName[2]) //
-					// Regardless of whether this folder will be recursed into, this folder's own timestamp
-					// will not be affected when the mode is files-only:
-					|| aOperateOnFolders == FILE_LOOP_FILES_ONLY)
-					continue; // Never operate upon or recurse into these.
-			}
-			else // It's a file, not a folder.
-				if (aOperateOnFolders == FILE_LOOP_FOLDERS_ONLY)
-					continue;
+		// Open existing file.  Uses CreateFile() rather than OpenFile for an expectation
+		// of greater compatibility for all files, and folder support too.
+		// FILE_FLAG_NO_BUFFERING might improve performance because all we're doing is
+		// changing one of the file's attributes.  FILE_FLAG_BACKUP_SEMANTICS must be
+		// used, otherwise changing the time of a directory under NT and beyond will
+		// not succeed.  Win95 (not sure about Win98/Me) does not support this, but it
+		// should be harmless to specify it even if the OS is Win95:
+		hFile = CreateFile(current_file->cFileName, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE
+			, (LPSECURITY_ATTRIBUTES)NULL, OPEN_EXISTING
+			, FILE_FLAG_NO_BUFFERING | FILE_FLAG_BACKUP_SEMANTICS, NULL);
+		if (hFile == INVALID_HANDLE_VALUE)
+		{
+			++failure_count;
+			continue;
+		}
 
-			if (strlen(current_file.cFileName) > space_remaining)
-			{
-				// v1.0.45.03: Don't even try to operate upon truncated filenames in case they accidentally
-				// match the name of a real/existing file.
+		switch (toupper(aWhichTime))
+		{
+		case 'C': // File's creation time.
+			if (!SetFileTime(hFile, &ftUTC, NULL, NULL))
 				++failure_count;
-				continue;
-			}
-			// Otherwise, make file_path be the filespec of the file to operate upon:
-			strcpy(append_pos, current_file.cFileName); // Above has ensured this won't overflow.
-
-			// Open existing file.  Uses CreateFile() rather than OpenFile for an expectation
-			// of greater compatibility for all files, and folder support too.
-			// FILE_FLAG_NO_BUFFERING might improve performance because all we're doing is
-			// changing one of the file's attributes.  FILE_FLAG_BACKUP_SEMANTICS must be
-			// used, otherwise changing the time of a directory under NT and beyond will
-			// not succeed.  Win95 (not sure about Win98/Me) does not support this, but it
-			// should be harmless to specify it even if the OS is Win95:
-			hFile = CreateFile(file_path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE
-				, (LPSECURITY_ATTRIBUTES)NULL, OPEN_EXISTING
-				, FILE_FLAG_NO_BUFFERING | FILE_FLAG_BACKUP_SEMANTICS, NULL);
-			if (hFile == INVALID_HANDLE_VALUE)
-			{
+			break;
+		case 'A': // File's last access time.
+			if (!SetFileTime(hFile, NULL, &ftUTC, NULL))
 				++failure_count;
-				continue;
-			}
-
-			switch (toupper(aWhichTime))
-			{
-			case 'C': // File's creation time.
-				if (!SetFileTime(hFile, &ftUTC, NULL, NULL))
-					++failure_count;
-				break;
-			case 'A': // File's last access time.
-				if (!SetFileTime(hFile, NULL, &ftUTC, NULL))
-					++failure_count;
-				break;
-			default:  // 'M', unspecified, or some other value.  Use the file's modification time.
-				if (!SetFileTime(hFile, NULL, NULL, &ftUTC))
-					++failure_count;
-			}
+			break;
+		default:  // 'M', unspecified, or some other value.  Use the file's modification time.
+			if (!SetFileTime(hFile, NULL, NULL, &ftUTC))
+				++failure_count;
+		}
 
-			CloseHandle(hFile);
-		} while (FindNextFile(file_search, &current_file));
+		CloseHandle(hFile);
+	}
 
-		FindClose(file_search);
-	} // if (file_search != INVALID_HANDLE_VALUE)
-
-	// This section is identical to that in FileSetAttrib() except for the recursive function
-	// call itself, so see comments there for details:
-	if (aDoRecurse && space_remaining > 2) // The space_remaining check ensures there's enough room to append "*.*" (if not, just avoid recursing into it due to rarity).
-	{
-		// Testing shows that the ANSI version of FindFirstFile() will not accept a path+pattern longer
-		// than 256 or so, even if the pattern would match files whose names are short enough to be legal.
-		// Therefore, as of v1.0.25, there is also a hard limit of MAX_PATH on all these variables.
-		// MSDN confirms this in a vague way: "In the ANSI version of FindFirstFile(), [plpFileName] is
-		// limited to MAX_PATH characters."
-		strcpy(append_pos, "*.*"); // Above has ensured this won't overflow.
-		file_search = FindFirstFile(file_path, &current_file);
-
-		if (file_search != INVALID_HANDLE_VALUE)
-		{
-			size_t pattern_length = strlen(naked_filename_or_pattern);
-			do
-			{
-				LONG_OPERATION_UPDATE
-				if (!(current_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-					|| current_file.cFileName[0] == '.' && (!current_file.cFileName[1]     // Relies on short-circuit boolean order.
-						|| current_file.cFileName[1] == '.' && !current_file.cFileName[2]) //
-					// v1.0.45.03: Skip over folders whose full-path-names are too long to be supported by the ANSI
-					// versions of FindFirst/FindNext.  Without this fix, it might be possible for infinite recursion
-					// to occur (see PerformLoop() for more comments).
-					|| pattern_length + strlen(current_file.cFileName) >= space_remaining) // >= vs. > to reserve 1 for the backslash to be added between cFileName and naked_filename_or_pattern.
-					continue;
-				sprintf(append_pos, "%s\\%s" // Above has ensured this won't overflow.
-					, current_file.cFileName, naked_filename_or_pattern);
-				failure_count += FileSetTime(yyyymmdd, file_path, aWhichTime, aOperateOnFolders, aDoRecurse, true);
-			} while (FindNextFile(file_search, &current_file));
-			FindClose(file_search);
-		} // if (file_search != INVALID_HANDLE_VALUE)
-	} // if (aDoRecurse)
-
-	if (!aCalledRecursively) // i.e. Only need to do this if we're returning to top-level caller:
-		g_ErrorLevel->Assign(failure_count); // i.e. indicate success if there were no failures.
+	// v1.0.45.03: Files whose full paths are too long were skipped rather than operated upon in case their
+	// truncated names accidentally match the name of a real/existing file.  They count as failures.
+	failure_count += (int)file_enum.SkippedCount();
+	g_ErrorLevel->Assign(failure_count); // i.e. indicate success if there were no failures.
 	return failure_count;
 }
 
@@ -9912,8 +10068,10 @@ size_t Line::ConvertEscapeCharGetLine(char *aBuf, int aMaxCharsToRead, FILE *fp)
 
 
 bool Line::FileIsFilteredOut(WIN32_FIND_DATA &aCurrentFile, FileLoopModeType aFileLoopMode
-	, char *aFilePath, size_t aFilePathLength)
+	, char *aFilePath, size_t aFilePathLength, unsigned *aTooLongCount)
 // Caller has ensured that aFilePath (if non-blank) has a trailing backslash.
+// If aTooLongCount is non-NULL, it's incremented for each file that passes the other filters but is
+// excluded because its full path would be too long (the file commands count these as failures).
 {
 	if (aCurrentFile.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) // It's a folder.
 	{
@@ -9938,7 +10096,11 @@ bool Line::FileIsFilteredOut(WIN32_FIND_DATA &aCurrentFile, FileLoopModeType aFi
 			// seeing the truncated names.  Furthermore, a truncated name might accidentally match the name
 			// of a legitimate non-trucated filename, which could cause such a name to get retrieved twice by
 			// the loop (or other undesirable side-effects).
+		{
+			if (aTooLongCount)
+				++*aTooLongCount;
 			return true;
+		}
 		//else no overflow is possible, so below can move things around inside the buffer without concern.
 		memmove(aCurrentFile.cFileName + aFilePathLength, aCurrentFile.cFileName, name_length + 1); // memmove() because source & dest might overlap.  +1 to include the terminator.
 		memcpy(aCurrentFile.cFileName, aFilePath, aFilePathLength); // Prepend in the area liberated by the above. Don't include the terminator since this is a concat operation.
@@ -9948,6 +10110,200 @@ bool Line::FileIsFilteredOut(WIN32_FIND_DATA &aCurrentFile, FileLoopModeType aFi
 
 
 
+WorkerSync::WorkerSync()
+{
+	InitializeCriticalSection(&mLock);
+	for (int i = 0; i < 2; ++i)
+		mEvent[i] = CreateEvent(NULL, FALSE, FALSE, NULL); // Auto-reset, as required by DirEnumHost::Wait() and CopyEngineHost::Wait().
+}
+
+
+
+WorkerSync::~WorkerSync()
+{
+	for (int i = 0; i < 2; ++i)
+		if (mEvent[i])
+			CloseHandle(mEvent[i]);
+	DeleteCriticalSection(&mLock);
+}
+
+
+
+struct WorkerThreadStart
+{
+	void (*proc)(void *);
+	void *param;
+};
+
+static unsigned __stdcall WorkerThreadProc(void *aParam)
+{
+	WorkerThreadStart start = *(WorkerThreadStart *)aParam;
+	free(aParam);
+	start.proc(start.param);
+	return 0;
+}
+
+bool WorkerSync::StartThread(void (*aProc)(void *), void *aParam)
+{
+	if (!mEvent[0] || !mEvent[1]) // Without both events, only the caller's own thread can be used.
+		return false;
+	WorkerThreadStart *start = (WorkerThreadStart *)malloc(sizeof(WorkerThreadStart));
+	if (!start)
+		return false;
+	start->proc = aProc;
+	start->param = aParam;
+	// Unlike the hook thread, workers call malloc(), new and the like, so the program must be linked to the
+	// multi-threaded runtime, and _beginthreadex() must be used so that the runtime is set up for the thread.
+	unsigned thread_id; // Win9x: The last parameter of the underlying CreateThread() cannot be NULL.
+	HANDLE thread = (HANDLE)_beginthreadex(NULL, 64*1024, WorkerThreadProc, start, 0, &thread_id);
+	if (!thread)
+	{
+		free(start);
+		return false;
+	}
+	CloseHandle(thread); // The thread exits on its own once it's no longer needed.
+	return true;
+}
+
+
+
+FileEnumHost::FileEnumHost(char *aFilePath, char *aPattern, FileLoopModeType aFileLoopMode)
+	: mFileLoopMode(aFileLoopMode)
+// aFilePath is the folder at the root of the walk, either empty or ending in a backslash.  aPattern is
+// what to look for in it and (if recursing) in each of its subfolders.
+{
+	strlcpy(mPattern, aPattern, sizeof(mPattern));
+	mPatternLength = strlen(mPattern);
+	mPatternMatchesAll = !strcmp(mPattern, "*") || !strcmp(mPattern, "*.*");
+	// Worker threads are allowed only when the walk starts at an absolute path.  Otherwise, a folder listed
+	// by a worker would be resolved against whatever the current directory happens to be at that moment,
+	// which can differ from the script's working directory (e.g. temporarily during FileInstall).  Such
+	// walks are still batched and filtered early, but are listed entirely by the thread that consumes them.
+	mAllowThreads = *aFilePath == '\\' && aFilePath[1] == '\\' // UNC path.
+		|| *aFilePath && aFilePath[1] == ':' && aFilePath[2] == '\\'; // Drive letter.
+}
+
+
+
+void FileEnumHost::AddSubdir(DirListing &aListing, WIN32_FIND_DATA &aFile, size_t aPathLength)
+// Adds aFile to the list of subfolders to recurse into if it's an eligible folder.
+{
+	if (!(aFile.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) // We only want directories (except "." and "..").
+		|| aFile.cFileName[0] == '.' && (!aFile.cFileName[1]      // Relies on short-circuit boolean order.
+			|| aFile.cFileName[1] == '.' && !aFile.cFileName[2])) //
+		return;
+	// v1.0.45.03: Skip over folders whose full-path-names are too long to be supported by the ANSI
+	// versions of FindFirst/FindNext.  Without this check, the folder's pattern would get truncated.
+	// -2 to reflect: 1) the backslash to be added between cFileName and mPattern; 2) the zero terminator.
+	// Such a folder counts as an error since its contents are missing from the walk.
+	size_t name_length = strlen(aFile.cFileName);
+	if (aPathLength + mPatternLength + name_length > MAX_PATH - 2
+		|| !aListing.subdir.Append(aFile.cFileName, name_length)) // Out of memory.
+		++aListing.error_count;
+}
+
+
+
+static inline bool IsNoMoreFilesError(DWORD aError)
+// Returns true if aError, from a FindFirstFile() that failed, means only that nothing matched.
+{
+	return aError == ERROR_FILE_NOT_FOUND || aError == ERROR_NO_MORE_FILES;
+}
+
+
+
+void FileEnumHost::ListDirectory(DirListing &aListing, bool aWantSubdirs)
+// This is called by worker threads as well as the main thread, so it must not refer to any script state.
+// Between chunks, aListing.search holds the handle of the search, positioned on the last file returned.
+{
+	char path_and_pattern[MAX_PATH];
+	size_t path_length = strlen(aListing.path);
+	WIN32_FIND_DATA current_file;
+	WIN32_FIND_DATA *entry;
+	HANDLE file_search;
+	BOOL found;
+	if (aListing.search) // Continue where the previous chunk left off.
+	{
+		file_search = (HANDLE)aListing.search;
+		aListing.search = NULL;
+		found = FindNextFile(file_search, &current_file);
+	}
+	else
+	{
+		if (path_length + mPatternLength >= MAX_PATH) // Checked by AddSubdir() for subfolders; this covers the root.
+		{
+			++aListing.error_count;
+			aListing.complete = true;
+			return;
+		}
+		memcpy(path_and_pattern, aListing.path, path_length);
+		strcpy(path_and_pattern + path_length, mPattern);
+		file_search = FindFirstFile(path_and_pattern, &current_file);
+		found = file_search != INVALID_HANDLE_VALUE;
+		if (!found && !IsNoMoreFilesError(GetLastError()))
+			++aListing.error_count;
+	}
+	for (; found; found = FindNextFile(file_search, &current_file))
+	{
+		if (aWantSubdirs && mPatternMatchesAll) // The subfolders are among the matches, so pick them out now.
+			AddSubdir(aListing, current_file, path_length); // Must be done prior to the below, which prepends the path to cFileName.
+		if (FileIsFilteredOut(current_file, mFileLoopMode, aListing.path, path_length, &aListing.skipped_count))
+			continue;
+		if (   !(entry = (WIN32_FIND_DATA *)aListing.AddEntry())   )
+		{
+			++aListing.error_count; // Out of memory, so omit the rest of this folder.
+			break;
+		}
+		memcpy(entry, &current_file, sizeof(WIN32_FIND_DATA));
+		if (aListing.entry_count >= DIR_ENUM_CHUNK)
+		{
+			aListing.search = file_search;
+			return;
+		}
+	}
+	if (file_search != INVALID_HANDLE_VALUE)
+	{
+		if (!found && GetLastError() != ERROR_NO_MORE_FILES) // FindNextFile() failed rather than ran out of files.
+			++aListing.error_count;
+		FindClose(file_search);
+	}
+	aListing.complete = true;
+
+	// If the pattern is restricted (e.g. *.txt), find ALL subfolders with a second search.  This also
+	// preserves the OS's own rules for wildcard matching (e.g. short names and "*.*" matching names
+	// without dots), which is why no attempt is made to match the pattern here rather than in the OS.
+	if (!aWantSubdirs || mPatternMatchesAll
+		|| path_length > MAX_PATH - 4) // v1.0.45.03: No room to append "*.*", so for simplicity, don't recurse into this folder.
+		return;
+	memcpy(path_and_pattern, aListing.path, path_length);
+	strcpy(path_and_pattern + path_length, "*.*"); // Above has already verified that no overflow is possible.
+	if (   (file_search = FindFirstFile(path_and_pattern, &current_file)) == INVALID_HANDLE_VALUE   )
+	{
+		if (!IsNoMoreFilesError(GetLastError()))
+			++aListing.error_count;
+		return;
+	}
+	do
+		AddSubdir(aListing, current_file, path_length);
+	while (FindNextFile(file_search, &current_file));
+	if (GetLastError() != ERROR_NO_MORE_FILES)
+		++aListing.error_count;
+	FindClose(file_search);
+}
+
+
+
+void FileEnumHost::EndListing(DirListing &aListing)
+{
+	if (aListing.search)
+	{
+		FindClose((HANDLE)aListing.search);
+		aListing.search = NULL;
+	}
+}
+
+
+
 Label *Line::GetJumpTarget(bool aIsDereferenced)
 {
 	char *target_label = aIsDereferenced ? ARG1 : RAW_ARG1;
@@ -13713,7 +14069,11 @@ void BIF_VarSetCapacity(ExprTokenType &aResultToken, ExprTokenType *aParam[], in
 					var.Length() = 0;
 			}
 			else // ALLOC_SIMPLE, due to its nature, will not actually be freed, which is documented.
+			{
 				var.Free();
+				if (g_script.mPackedArrays.Count()) // Freeing Array0 also frees the packed elements of Array.
+					g_script.ReleasePackedArray(var);
+			}
 		} // if (aParamCount > 1)
 		//else the var is not altered; instead, the current capacity is reported, which seems more intuitive/useful than having it do a Free().
 		if (aResultToken.value_int64 = var.Capacity()) // Don't subtract 1 here in lieu doing it below (avoids underflow).
@@ -13729,6 +14089,8 @@ void BIF_FileExist(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aPa
 	char *filename = TokenToString(*aParam[0], filename_buf);
 	aResultToken.marker = aResultToken.buf; // If necessary, it will be moved to a persistent memory location by our caller.
 	aResultToken.symbol = SYM_STRING;
+	if (g_FileWriterCount) // Same as IfExist.
+		FileWriterFlushAll();
 	DWORD attr;
 	if (DoesFilePatternExist(filename, &attr))
 	{
@@ -14100,10 +14462,9 @@ void BIF_OnMessage(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aPa
 		return; // Yield the default return value set earlier.
 
 	// Check if this message already exists in the array:
-	int msg_index;
-	for (msg_index = 0; msg_index < g_MsgMonitorCount; ++msg_index)
-		if (g_MsgMonitor[msg_index].msg == specified_msg)
-			break;
+	int msg_index = MsgMonitorFind(specified_msg);
+	if (msg_index < 0)
+		msg_index = g_MsgMonitorCount;
 	bool item_already_exists = (msg_index < g_MsgMonitorCount);
 	MsgMonitorStruct &monitor = g_MsgMonitor[msg_index == MAX_MSG_MONITORS ? 0 : msg_index]; // The 0th item is just a placeholder.
 
@@ -14127,6 +14488,7 @@ void BIF_OnMessage(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aPa
 			--g_MsgMonitorCount;  // Must be done prior to the below.
 			if (msg_index < g_MsgMonitorCount) // An element other than the last is being removed. Shift the array to cover/delete it.
 				MoveMemory(g_MsgMonitor+msg_index, g_MsgMonitor+msg_index+1, sizeof(MsgMonitorStruct)*(g_MsgMonitorCount-msg_index));
+			MsgMonitorIndexRebuild();
 			return;
 		}
 		if (aParamCount < 2) // Single-parameter mode: Report existing item's function name.
@@ -14147,6 +14509,10 @@ void BIF_OnMessage(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aPa
 		strcpy(buf, func->mName); // Yield the NEW name as an indicator of success. Caller has ensured that buf large enough to support max function name.
 		aResultToken.marker = buf;
 		monitor.instance_count = 0; // Reset instance_count only for new items since existing items might currently be running.
+#ifdef REPORT_EXIT_STATS
+		monitor.call_count = 0;
+		monitor.call_ticks = 0;
+#endif
 		// Continue on to the update-or-create logic below.
 	}
 
@@ -14155,6 +14521,8 @@ void BIF_OnMessage(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aPa
 	// Update those struct attributes that get the same treatment regardless of whether this is an update or creation.
 	monitor.msg = specified_msg;
 	monitor.func = func;
+	if (!item_already_exists)
+		MsgMonitorIndexRebuild(); // Must be done only after monitor.msg is set above.
 	if (aParamCount > 2)
 		monitor.max_instances = (short)TokenToInt64(*aParam[2]); // No validation because it seems harmless if it's negative or some huge number.
 	else // Unspecified, so if this item is being newly created fall back to the default.
@@ -14625,6 +14993,12 @@ void BIF_LV_GetText(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aP
 		else // On failure, it seems best to also clear the output var for better consistency and in case the script doesn't check the return value.
 			output_var.Assign();
 	}
+	else if (gui.mCurrentListView->union_lv_attrib->store) // Virtual ListView, so the text is in the store rather than the control.
+	{
+		const char *text = gui.mCurrentListView->union_lv_attrib->store->GetText(row_index, col_index);
+		aResultToken.value_int64 = (text != NULL);
+		output_var.Assign(text ? (char *)text : ""); // As above, clear the output var on failure.
+	}
 	else // Get row's indicated item or subitem text.
 	{
 		LVITEM lvi;
@@ -14812,13 +15186,65 @@ void BIF_LV_AddInsertModify(ExprTokenType &aResultToken, ExprTokenType *aParam[]
 		*option_end = orig_char; // Undo the temporary termination because the caller needs aOptions to be unaltered.
 	}
 
+	int i, j, rows_to_change;
+
+	ListViewStore *store = control.union_lv_attrib->store;
+	if (store) // Virtual ListView: the text goes into the store, from which the control fetches what it displays.
+	{
+		// Icons and checkmarks aren't supported because a virtual ListView has no storage for them.
+		int row_count = store->Count();
+		if (mode == 'I')
+		{
+			if (   (index = store->Insert(index)) < 0   ) // INT_MAX (Add) is beyond the end, so it appends.
+				return;
+			rows_to_change = 1;
+			aResultToken.value_int64 = index + 1; // +1 to convert to one-based.
+		}
+		else if (index == -1) // Modify all rows.
+		{
+			index = 0;
+			rows_to_change = row_count;
+			ensure_visible = false; // Not applicable when operating on all rows.
+			aResultToken.value_int64 = 1;
+		}
+		else
+		{
+			if (index >= row_count)
+				return;
+			rows_to_change = 1;
+			aResultToken.value_int64 = 1;
+		}
+		for (j = index; j < index + rows_to_change; ++j)
+		{
+			// The parameters are assigned to columns the same way as in the non-virtual section further below.
+			if (aParamCount > 1 && col_start_index == 0)
+				store->SetText(j, 0, TokenToString(*aParam[1], buf));
+			int col_index = (col_start_index > 1) ? col_start_index : 1;
+			for (i = 2 - (col_start_index > 0); i < aParamCount; ++i, ++col_index)
+				if (!store->SetText(j, col_index, TokenToString(*aParam[i], buf)) && mode != 'I') // Out of memory.
+					aResultToken.value_int64 = 0; // Indicate partial failure.
+		}
+		if (mode == 'I')
+			// When the row was appended, the rows above it haven't changed so they needn't be redrawn:
+			SendMessage(control.hwnd, LVM_SETITEMCOUNT, store->Count()
+				, (index == store->Count() - 1 ? LVSICF_NOINVALIDATEALL : 0) | LVSICF_NOSCROLL);
+		else if (rows_to_change == 1)
+			ListView_RedrawItems(control.hwnd, index, index);
+		else
+			InvalidateRect(control.hwnd, NULL, FALSE);
+		if (lvi.stateMask &= (LVIS_SELECTED | LVIS_FOCUSED)) // A virtual ListView does keep track of these itself.
+			ListView_SetItemState(control.hwnd, rows_to_change == 1 ? index : -1, lvi.state, lvi.stateMask);
+		if (ensure_visible && mode == 'M')
+			SendMessage(control.hwnd, LVM_ENSUREVISIBLE, index, FALSE);
+		return;
+	}
+
 	// More maintainable and performs better to have a separate struct for subitems vs. items.
 	LVITEM lvi_sub;
 	// Ensure mask is pure to avoid giving it any excuse to fail due to the fact that
 	// "You cannot set the state or lParam members for subitems."
 	lvi_sub.mask = LVIF_TEXT;
 
-	int i, j, rows_to_change;
 	if (index == -1) // Modify all rows (above has ensured that this is only happens in modify-mode).
 	{
 		rows_to_change = ListView_GetItemCount(control.hwnd);
@@ -14924,16 +15350,21 @@ void BIF_LV_Delete(ExprTokenType &aResultToken, ExprTokenType *aParam[], int aPa
 	if (!gui.mCurrentListView)
 		return;
 	HWND control_hwnd = gui.mCurrentListView->hwnd;
+	ListViewStore *store = gui.mCurrentListView->union_lv_attrib->store; // Non-NULL for a virtual ListView.
 
 	if (aParamCount < 1)
 	{
+		if (store)
+			store->DeleteAll(); // This also removes any filter.
 		aResultToken.value_int64 = SendMessage(control_hwnd, LVM_DELETEALLITEMS, 0, 0); // Returns TRUE/FALSE.
 		return;
 	}
 
 	// Since above didn't return, there is a first paramter present.
 	int index = (int)TokenToInt64(*aParam[0]) - 1; // -1 to convert to zero-based.
-	if (index > -1)
+	if (index > -1 && (!store || store->Delete(index)))
+		// For a virtual ListView, this message reduces the control's row count and adjusts the selection
+		// and focus of the rows beneath the deleted one to match.
 		aResultToken.value_int64 = SendMessage(control_hwnd, LVM_DELETEITEM, index, 0); // Returns TRUE/FALSE.
 	//else even if index==0, for safety, it seems not to do a delete-all.
 }
@@ -15002,6 +15433,11 @@ void BIF_LV_InsertModifyDeleteCol(ExprTokenType &aResultToken, ExprTokenType *aP
 				--lv_attrib.col_count; // Must be done prior to the below.
 			if (index < lv_attrib.col_count) // When a column other than the last was removed, adjust the array so that it stays in sync with actual columns.
 				MoveMemory(lv_attrib.col+index, lv_attrib.col+index+1, sizeof(lv_col_type)*(lv_attrib.col_count-index));
+			if (lv_attrib.store) // Remove the column's text so that the store's columns stay in sync with the control's.
+			{
+				lv_attrib.store->DeleteColumn(index);
+				GuiType::LV_RefreshVirtual(control); // In case the rows were filtered by this column.
+			}
 		}
 		return;
 	}
@@ -15047,6 +15483,7 @@ void BIF_LV_InsertModifyDeleteCol(ExprTokenType &aResultToken, ExprTokenType *aP
 
 	// Init defaults prior to parsing options:
 	bool sort_now = false;
+	int filter_now = 0; // 1 to filter the rows of a virtual ListView by this column, -1 to remove the filter.
 	int do_auto_size = (mode == 'I') ? LVSCW_AUTOSIZE_USEHEADER : 0;  // Default to auto-size for new columns.
 	char sort_now_direction = 'A'; // Ascending.
 	int new_justify = lvc.fmt & LVCFMT_JUSTIFYMASK; // Simplifies the handling of the justification bitfield.
@@ -15143,6 +15580,8 @@ void BIF_LV_InsertModifyDeleteCol(ExprTokenType &aResultToken, ExprTokenType *aP
 		}
 		else if (!stricmp(next_option, "NoSort")) // Called "NoSort" so that there's a way to enable and disable the setting via +/-.
 			col.sort_disabled = adding;
+		else if (!stricmp(next_option, "Filter")) // Virtual ListView only: Parameter #3 is the text to filter by rather than the column's new title.
+			filter_now = adding ? 1 : -1;
 
 		else if (!strnicmp(next_option, "Auto", 4)) // No separate failure result is reported for this item.
 			// In case the mode is "insert", defer auto-width of column until col exists.
@@ -15191,7 +15630,7 @@ void BIF_LV_InsertModifyDeleteCol(ExprTokenType &aResultToken, ExprTokenType *aP
 	// Apply any changed justification/alignment to the fmt bit field:
 	lvc.fmt = (lvc.fmt & ~LVCFMT_JUSTIFYMASK) | new_justify;
 
-	if (aParamCount > 2) // Parameter #3 (text) is present.
+	if (aParamCount > 2 && !filter_now) // Parameter #3 (text) is present.
 	{
 		lvc.pszText = TokenToString(*aParam[2], buf);
 		lvc.mask |= LVCF_TEXT;
@@ -15235,6 +15674,17 @@ void BIF_LV_InsertModifyDeleteCol(ExprTokenType &aResultToken, ExprTokenType *aP
 		// column: The new first column inherit's the old column's values (fields), so it seems best to also have it
 		// inherit the old column's attributs.
 		++lv_attrib.col_count; // New column successfully added.  Must be done only after the MoveMemory() above.
+		if (lv_attrib.store) // Shift the text of this and subsequent columns to the right, as the control does for subitems.
+			lv_attrib.store->InsertColumn(index);
+	}
+
+	if (filter_now && lv_attrib.store)
+	{
+		// Display only those rows whose text in this column contains the given text (case-insensitive).
+		// A blank filter or "-Filter" displays all rows.  Rows added later are displayed regardless
+		// of their text until the filter is applied again (or the rows are sorted).
+		lv_attrib.store->SetFilter(index, (filter_now > 0 && aParamCount > 2) ? TokenToString(*aParam[2], buf) : NULL);
+		GuiType::LV_RefreshVirtual(control);
 	}
 
 	// Auto-size is done only at this late a stage, in case column was just created above.
@@ -15942,8 +16392,15 @@ SymbolType TokenIsPureNumeric(ExprTokenType &aToken)
 	switch(aToken.symbol)
 	{
 	case SYM_VAR:     return aToken.var->IsNonBlankIntegerOrFloat(); // Supports VAR_NORMAL and VAR_CLIPBOARD.
-	case SYM_OPERAND: return aToken.buf ? PURE_INTEGER // The "buf" of a SYM_OPERAND is non-NULL if it's a pure integer.
-			: IsPureNumeric(TokenToString(aToken), true, false, true);
+	case SYM_OPERAND:
+		if (aToken.buf) // A literal that was classified at load-time.
+		{
+#ifdef REPORT_EXIT_STATS
+			++g_PureNumericCacheHits;
+#endif
+			return OPERAND_NUMBER(aToken)->symbol;
+		}
+		return IsPureNumeric(TokenToString(aToken), true, false, true);
 	case SYM_STRING:  return PURE_NOT_NUMERIC; // Explicitly-marked strings are not numeric, which allows numeric strings to be compared as strings rather than as numbers.
 	default: return aToken.symbol; // SYM_INTEGER or SYM_FLOAT
 	}
@@ -15951,6 +16408,22 @@ SymbolType TokenIsPureNumeric(ExprTokenType &aToken)
 
 
 
+#ifdef REPORT_EXIT_STATS
+void ReportPureNumeric()
+// Sends to the debugger (or a tool such as DebugView) how many times the numeric status of a string had to
+// be determined, and how many times that was avoided for literals by their load-time classification.
+{
+	if (!g_PureNumericCalls && !g_PureNumericCacheHits)
+		return;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "IsPureNumeric: %u calls, %u avoided by classifying literals at load-time\n"
+		, g_PureNumericCalls, g_PureNumericCacheHits);
+	OutputDebugString(buf);
+}
+#endif
+
+
+
 __int64 TokenToInt64(ExprTokenType &aToken, BOOL aIsPureInteger)
 // Caller has ensured that any SYM_VAR's Type() is VAR_NORMAL or VAR_CLIPBOARD.
 // Converts the contents of aToken to a 64-bit int.
@@ -15965,14 +16438,15 @@ __int64 TokenToInt64(ExprTokenType &aToken, BOOL aIsPureInteger)
 	{
 		case SYM_INTEGER: return aToken.value_int64; // Fixed in v1.0.45 not to cast to int.
 		case SYM_OPERAND: // Listed near the top for performance.
-			if (aToken.buf) // The "buf" of a SYM_OPERAND is non-NULL if points to a pure integer.
-				return *(__int64 *)aToken.buf;
+			if (OPERAND_IS_INTEGER(aToken)) // A literal integer that was pre-converted at load-time.
+				return OPERAND_NUMBER(aToken)->value_int64;
 			//else don't return; continue on to the bottom.
 			break;
 		case SYM_FLOAT: return (__int64)aToken.value_double; // 1.0.48: fixed to cast to __int64 vs. int.
 		case SYM_VAR: return aToken.var->ToInt64(aIsPureInteger);
 	}
 	// Since above didn't return, it's SYM_STRING, or a SYM_OPERAND that lacks a binary-integer counterpart.
+	// A pre-converted float isn't used because ATOI64() gives a different result for some, such as 1.0e5.
 	return ATOI64(aToken.marker); // Fixed in v1.0.45 to use ATOI64 vs. ATOI().
 }
 
@@ -15992,8 +16466,14 @@ double TokenToDouble(ExprTokenType &aToken, BOOL aCheckForHex, BOOL aIsPureFloat
 		case SYM_FLOAT: return aToken.value_double;
 		case SYM_VAR: return aToken.var->ToDouble(aIsPureFloat);
 		case SYM_OPERAND:
-			if (aToken.buf) // The "buf" of a SYM_OPERAND is non-NULL if it's a pure integer.
-				return (double)*(__int64 *)aToken.buf;
+			if (aToken.buf) // A literal that was classified and converted at load-time.
+			{
+				switch (OPERAND_NUMBER(aToken)->symbol)
+				{
+				case PURE_INTEGER: return (double)OPERAND_NUMBER(aToken)->value_int64;
+				case PURE_FLOAT: return OPERAND_NUMBER(aToken)->value_double; // Never hex, so aCheckForHex doesn't matter.
+				}
+			}
 			//else continue on to the bottom.
 			break;
 	}
@@ -16025,7 +16505,7 @@ char *TokenToString(ExprTokenType &aToken, char *aBuf)
 	case SYM_FLOAT:
 		if (aBuf)
 		{
-			snprintf(aBuf, MAX_NUMBER_SIZE, g->FormatFloat, aToken.value_double);
+			FTOA(aToken.value_double, aBuf, MAX_NUMBER_SIZE);
 			return aBuf;
 		}
 		//else continue on to return the default at the bottom.
@@ -16053,11 +16533,21 @@ ResultType TokenToDoubleOrInt64(ExprTokenType &aToken)
 			str = aToken.marker;
 			break;
 		case SYM_OPERAND:
-			if (aToken.buf) // The "buf" of a SYM_OPERAND is non-NULL if it's a pure integer.
+			if (aToken.buf) // A literal that was classified and converted at load-time.
 			{
-				aToken.symbol = SYM_INTEGER;
-				aToken.value_int64 = *(__int64 *)aToken.buf;
-				return OK;
+				OperandNumberType &number = *OPERAND_NUMBER(aToken);
+				switch (number.symbol)
+				{
+				case PURE_INTEGER:
+					aToken.symbol = SYM_INTEGER;
+					aToken.value_int64 = number.value_int64;
+					return OK;
+				case PURE_FLOAT:
+					aToken.symbol = SYM_FLOAT;
+					aToken.value_double = number.value_double;
+					return OK;
+				}
+				// Otherwise, it's not numeric, so let the section below handle it.
 			}
 			// Otherwise:
 			str = aToken.marker;
@@ -19,6 +19,8 @@
 #include <winsock.h>  // for WSADATA.  This also requires wsock32.lib to be linked in.
 #include <tlhelp32.h> // For the ProcessExist routines.
 #include <wininet.h> // For URLDownloadToFile().
+#include "download.h" // For URLDownloadToFile().
+#include "proccache.h" // For the ProcessExist routines.
 #include "script.h"
 #include "globaldata.h" // for g_ErrorLevel and probably other globals.
 #include "window.h" // For ControlExist().
@@ -189,20 +191,26 @@ ResultType Line::PixelGetColor(int aX, int aY, char *aOptions)
 	}
 
 	bool use_alt_mode = strcasestr(aOptions, "Alt") != NULL; // New mode for v1.0.43.10: Two users reported that CreateDC works better in certain windows such as SciTE, at least one some systems.
-	HDC hdc = use_alt_mode ? CreateDC("DISPLAY", NULL, NULL, NULL) : GetDC(NULL);
-	if (!hdc)
-		return OK;  // Let ErrorLevel tell the story.
-
-	// Assign the value as an 32-bit int to match Window Spy reports color values.
-	// Update for v1.0.21: Assigning in hex format seems much better, since it's easy to
-	// look at a hex BGR value to get some idea of the hue.  In addition, the result
-	// is zero padded to make it easier to convert to RGB and more consistent in
-	// appearance:
-	COLORREF color = GetPixel(hdc, aX, aY);
-	if (use_alt_mode)
-		DeleteDC(hdc);
+	COLORREF color;
+	if (!use_alt_mode && GetCachedScreenPixel(aX, aY, color)) // See PixelCapture().  Alt mode is excluded since its purpose is to read the screen a different way.
+		color = rgb_to_bgr(color);
 	else
-		ReleaseDC(NULL, hdc);
+	{
+		HDC hdc = use_alt_mode ? CreateDC("DISPLAY", NULL, NULL, NULL) : GetDC(NULL);
+		if (!hdc)
+			return OK;  // Let ErrorLevel tell the story.
+
+		// Assign the value as an 32-bit int to match Window Spy reports color values.
+		// Update for v1.0.21: Assigning in hex format seems much better, since it's easy to
+		// look at a hex BGR value to get some idea of the hue.  In addition, the result
+		// is zero padded to make it easier to convert to RGB and more consistent in
+		// appearance:
+		color = GetPixel(hdc, aX, aY);
+		if (use_alt_mode)
+			DeleteDC(hdc);
+		else
+			ReleaseDC(NULL, hdc);
+	}
 
 	char buf[32];
 	sprintf(buf, "0x%06X", strcasestr(aOptions, "RGB") ? bgr_to_rgb(color) : color);
@@ -967,132 +975,402 @@ ResultType Line::ControlGet(char *aCmd, char *aValue, char *aControl, char *aTit
 
 
 
-ResultType Line::URLDownloadToFile(char *aURL, char *aFilespec)
+class WinINetTransport : public DownloadTransport
+// Downloads by means of WinINet.  Its functions are looked up dynamically in case the system lacks MSIE v3.0+,
+// in which case the app would probably refuse to launch at all if they were linked statically.
 {
-	// Check that we have IE3 and access to wininet.dll
-	HINSTANCE hinstLib = LoadLibrary("wininet");
-	if (!hinstLib)
-		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
-
 	typedef HINTERNET (WINAPI *MyInternetOpen)(LPCTSTR, DWORD, LPCTSTR, LPCTSTR, DWORD dwFlags);
 	typedef HINTERNET (WINAPI *MyInternetOpenUrl)(HINTERNET hInternet, LPCTSTR, LPCTSTR, DWORD, DWORD, LPDWORD);
 	typedef BOOL (WINAPI *MyInternetCloseHandle)(HINTERNET);
 	typedef BOOL (WINAPI *MyInternetReadFileEx)(HINTERNET, LPINTERNET_BUFFERS, DWORD, DWORD);
 	typedef BOOL (WINAPI *MyInternetReadFile)(HINTERNET, LPVOID, DWORD, LPDWORD);
+	typedef BOOL (WINAPI *MyHttpQueryInfo)(HINTERNET, DWORD, LPVOID, LPDWORD, LPDWORD);
+
+	HINSTANCE mLib;
+	MyInternetOpen mInternetOpen;
+	MyInternetOpenUrl mInternetOpenUrl;
+	MyInternetCloseHandle mInternetCloseHandle;
+	MyInternetReadFileEx mInternetReadFileEx;
+	MyInternetReadFile mInternetReadFile;
+	MyHttpQueryInfo mHttpQueryInfo;
+	HINTERNET mInet, mFile;
+	DWORD mFlags;
+	bool mIsHTTP;
+
+public:
+	WinINetTransport(DWORD aFlags) : mLib(NULL), mInet(NULL), mFile(NULL), mFlags(aFlags), mIsHTTP(false) {}
+	~WinINetTransport();
+	bool Load();
+	DownloadOpenResult Open(const char *aURL, DownloadUInt64Type aOffset, const char *aValidator);
+	bool ContentRange(char *aBuf, size_t aSize);
+	DownloadUInt64Type ContentLength();
+	bool LastModified(FILETIME &aTime);
+	bool Read(void *aBuf, size_t aSize, size_t &aBytesRead);
+	unsigned TickCount() {return GetTickCount();}
+};
+
+
+
+WinINetTransport::~WinINetTransport()
+{
+	if (mFile)
+		mInternetCloseHandle(mFile);
+	if (mInet)
+		mInternetCloseHandle(mInet);
+	if (mLib)
+		FreeLibrary(mLib); // Only after the above.
+}
 
+
+
+bool WinINetTransport::Load()
+// Returns false if WinINet or any of the functions we require isn't available.
+{
+	if (   !(mLib = LoadLibrary("wininet"))   )
+		return false;
+	mInternetOpen = (MyInternetOpen)GetProcAddress(mLib, "InternetOpenA");
+	mInternetOpenUrl = (MyInternetOpenUrl)GetProcAddress(mLib, "InternetOpenUrlA");
+	mInternetCloseHandle = (MyInternetCloseHandle)GetProcAddress(mLib, "InternetCloseHandle");
+	mInternetReadFileEx = (MyInternetReadFileEx)GetProcAddress(mLib, "InternetReadFileExA");
+	mInternetReadFile = (MyInternetReadFile)GetProcAddress(mLib, "InternetReadFile"); // Called unconditionally to reduce code size and because the time required is likely insignificant compared to network latency.
+	mHttpQueryInfo = (MyHttpQueryInfo)GetProcAddress(mLib, "HttpQueryInfoA");
+	return mInternetOpen && mInternetOpenUrl && mInternetCloseHandle && mInternetReadFileEx && mInternetReadFile
+		&& mHttpQueryInfo;
+}
+
+
+
+DownloadOpenResult WinINetTransport::Open(const char *aURL, DownloadUInt64Type aOffset, const char *aValidator)
+{
 	#ifndef INTERNET_OPEN_TYPE_PRECONFIG_WITH_NO_AUTOPROXY
 		#define INTERNET_OPEN_TYPE_PRECONFIG_WITH_NO_AUTOPROXY 4
 	#endif
 
-	// Get the address of all the functions we require.  It's done this way in case the system
-	// lacks MSIE v3.0+, in which case the app would probably refuse to launch at all:
- 	MyInternetOpen lpfnInternetOpen = (MyInternetOpen)GetProcAddress(hinstLib, "InternetOpenA");
-	MyInternetOpenUrl lpfnInternetOpenUrl = (MyInternetOpenUrl)GetProcAddress(hinstLib, "InternetOpenUrlA");
-	MyInternetCloseHandle lpfnInternetCloseHandle = (MyInternetCloseHandle)GetProcAddress(hinstLib, "InternetCloseHandle");
-	MyInternetReadFileEx lpfnInternetReadFileEx = (MyInternetReadFileEx)GetProcAddress(hinstLib, "InternetReadFileExA");
-	MyInternetReadFile lpfnInternetReadFile = (MyInternetReadFile)GetProcAddress(hinstLib, "InternetReadFile"); // Called unconditionally to reduce code size and because the time required is likely insignificant compared to network latency.
-	if (!(lpfnInternetOpen && lpfnInternetOpenUrl && lpfnInternetCloseHandle && lpfnInternetReadFileEx && lpfnInternetReadFile))
-		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
-
-	// v1.0.44.07: Set default to INTERNET_FLAG_RELOAD vs. 0 because the vast majority of usages would want
-	// the file to be retrieved directly rather than from the cache.
-	// v1.0.46.04: Added more no-cache flags because otherwise, it definitely falls back to the cache if
-	// the remote server doesn't repond (and perhaps other errors), which defeats the ability to use
-	// UrlDownloadToFile for uptime/server monitoring.  Also, in spite of what MSDN says, it seems nearly
-	// certain based on other sources that more than one flag is supported.  Someone also mentioned that
-	// INTERNET_FLAG_CACHE_IF_NET_FAIL is related to this, but there's no way to specify it in these
-	// particular calls, and it's the opposite of the desired behavior anyway; so it seems impossible to
-	// turn it off explicitly.
-	DWORD flags_for_open_url = INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_NO_CACHE_WRITE;
-	aURL = omit_leading_whitespace(aURL);
-	if (*aURL == '*') // v1.0.44.07: Provide an option to override flags_for_open_url.
-	{
-		flags_for_open_url = ATOU(++aURL);
-		char *cp;
-		if (cp = StrChrAny(aURL, " \t")) // Find first space or tab.
-			aURL = omit_leading_whitespace(cp);
-	}
-
 	// Open the internet session. v1.0.45.03: Provide a non-NULL user-agent because  some servers reject
 	// requests that lack a user-agent.  Furthermore, it's more professional to have one, in which case it
 	// should probably be kept as simple and unchanging as possible.  Using something like the script's name
 	// as the user agent (even if documented) seems like a bad idea because it might contain personal/sensitive info.
-	HINTERNET hInet = lpfnInternetOpen("AutoHotkey", INTERNET_OPEN_TYPE_PRECONFIG_WITH_NO_AUTOPROXY, NULL, NULL, 0);
-	if (!hInet)
+	// The session is kept if Downloader asks for the resource a second time, but the first response is discarded.
+	if (mFile)
 	{
-		FreeLibrary(hinstLib);
-		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
+		mInternetCloseHandle(mFile);
+		mFile = NULL;
 	}
+	if (!mInet && !(mInet = mInternetOpen("AutoHotkey", INTERNET_OPEN_TYPE_PRECONFIG_WITH_NO_AUTOPROXY, NULL, NULL, 0)))
+		return DOWNLOAD_OPEN_FAILED;
+
+	// Only HTTP (and HTTPS) can resume partway through, by means of a Range header.  For other protocols,
+	// such as FTP, the whole file is downloaded again.  If-Range makes the server send the whole file
+	// instead of the remainder if the file has changed since the part we have was downloaded.
+	mIsHTTP = (*aURL == 'h' || *aURL == 'H');
+	char range_header[256];
+	if (aOffset && mIsHTTP)
+		snprintf(range_header, sizeof(range_header), "Range: bytes=%I64u-\r\nIf-Range: %s\r\n", aOffset, aValidator);
+	else
+		*range_header = '\0';
 
 	// Open the required URL
-	HINTERNET hFile = lpfnInternetOpenUrl(hInet, aURL, NULL, 0, flags_for_open_url, 0);
-	if (!hFile)
+	if (   !(mFile = mInternetOpenUrl(mInet, aURL, *range_header ? range_header : NULL, (DWORD)-1L, mFlags, 0))   )
+		return DOWNLOAD_OPEN_FAILED;
+	if (!*range_header)
+		return DOWNLOAD_OPEN_WHOLE;
+
+	// Servers that don't support ranges ignore the header and send the whole file with status 200 (OK).
+	// Anything other than the two statuses below is treated the same way, so that an error page (for
+	// example) replaces the partial file just as it would have replaced any file without resuming.
+	// Downloader checks the Content-Range of the other two before relying on them.
+	DWORD status, status_size = sizeof(status);
+	if (!mHttpQueryInfo(mFile, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &status, &status_size, NULL))
+		return DOWNLOAD_OPEN_WHOLE;
+	if (status == 206) // Partial Content.
+		return DOWNLOAD_OPEN_REMAINDER;
+	if (status == 416) // Range Not Satisfiable: the file is no longer than what was already downloaded.
+		return DOWNLOAD_OPEN_COMPLETE;
+	return DOWNLOAD_OPEN_WHOLE;
+}
+
+
+
+bool WinINetTransport::ContentRange(char *aBuf, size_t aSize)
+{
+	DWORD buf_size = (DWORD)aSize;
+	if (!mIsHTTP || !mHttpQueryInfo(mFile, HTTP_QUERY_CONTENT_RANGE, aBuf, &buf_size, NULL))
+		return false; // This includes a header too long for aBuf, which can't be a valid range anyway.
+	aBuf[aSize - 1] = '\0'; // Should already be terminated, but just in case.
+	return true;
+}
+
+
+
+DownloadUInt64Type WinINetTransport::ContentLength()
+{
+	// The length is retrieved as text rather than HTTP_QUERY_FLAG_NUMBER, which is limited to 32 bits.
+	char length_text[32];
+	DWORD length_text_size = sizeof(length_text);
+	if (!mIsHTTP || !mHttpQueryInfo(mFile, HTTP_QUERY_CONTENT_LENGTH, length_text, &length_text_size, NULL)
+		|| !IsPureNumeric(length_text, false, false))
+		return DOWNLOAD_LENGTH_UNKNOWN;
+	return (DownloadUInt64Type)ATOI64(length_text);
+}
+
+
+
+bool WinINetTransport::LastModified(FILETIME &aTime)
+// Retrieves the response's Last-Modified date, which UrlDownloadToFile *R stamps on the file so that it can
+// be sent back as the If-Range validator when the download is resumed.
+{
+	SYSTEMTIME st;
+	DWORD st_size = sizeof(st);
+	return mIsHTTP && mHttpQueryInfo(mFile, HTTP_QUERY_LAST_MODIFIED | HTTP_QUERY_FLAG_SYSTEMTIME, &st, &st_size, NULL)
+		&& SystemTimeToFileTime(&st, &aTime);
+}
+
+
+
+bool WinINetTransport::Read(void *aBuf, size_t aSize, size_t &aBytesRead)
+{
+	// I don't think synchronous transfers typically generate the pseudo-error ERROR_IO_PENDING, so that is not
+	// checked here.  That's probably just for async transfers.  IRF_NO_WAIT is used to avoid requiring the call
+	// to block until the buffer is full.  By having it return the moment there is any data in the buffer, the
+	// program is made more responsive, especially when the download is very slow and/or one of the hooks is installed:
+	if (mIsHTTP)
 	{
-		lpfnInternetCloseHandle(hInet);
-		FreeLibrary(hinstLib);
-		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
+		INTERNET_BUFFERS buffers = {0};
+		buffers.dwStructSize = sizeof(INTERNET_BUFFERS);
+		buffers.lpvBuffer = aBuf;
+		buffers.dwBufferLength = (DWORD)aSize;
+		if (!mInternetReadFileEx(mFile, &buffers, IRF_NO_WAIT, NULL))
+			return false;
+		aBytesRead = buffers.dwBufferLength;
+		return true;
 	}
+	// v1.0.48.04: This section adds support for FTP and perhaps Gopher by using InternetReadFile() instead of
+	// InternetReadFileEx().  It waits for the buffer to fill, which Downloader compensates for by reading less
+	// at a time when reads are slow.
+	DWORD bytes_read;
+	if (!mInternetReadFile(mFile, aBuf, (DWORD)aSize, &bytes_read))
+		return false;
+	aBytesRead = bytes_read;
+	return true;
+}
+
+
 
-	// Open our output file
-	FILE *fptr = fopen(aFilespec, "wb");	// Open in binary write/destroy mode
-	if (!fptr)
+class FileDownloadSink : public DownloadSink
+{
+	char *mPath;
+	HANDLE mFile;
+
+public:
+	FileDownloadSink(char *aPath) : mPath(aPath), mFile(INVALID_HANDLE_VALUE) {}
+	bool Begin(bool aAppend, DownloadUInt64Type aLengthHint);
+	bool Write(const void *aData, size_t aSize);
+	void Close(bool aDelete, const FILETIME *aModified);
+};
+
+
+
+bool FileDownloadSink::Begin(bool aAppend, DownloadUInt64Type aLengthHint)
+// The file isn't created until now so that nothing happens to an existing file if the URL can't be opened.
+{
+	mFile = CreateFile(mPath, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL
+		, aAppend ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+	if (aAppend && SetFilePointer(mFile, 0, NULL, FILE_END) == 0xFFFFFFFF && GetLastError() != NO_ERROR)
+		return false;
+	return true;
+}
+
+
+
+bool FileDownloadSink::Write(const void *aData, size_t aSize)
+{
+	DWORD bytes_written;
+	return WriteFile(mFile, aData, (DWORD)aSize, &bytes_written, NULL) && bytes_written == aSize;
+}
+
+
+
+void FileDownloadSink::Close(bool aDelete, const FILETIME *aModified)
+// If aModified isn't NULL, it becomes the file's modification time (unless the file is deleted).
+{
+	if (mFile == INVALID_HANDLE_VALUE) // Begin() was never called or it failed, so the file wasn't touched.
+		return;
+	if (aModified && !aDelete)
+		SetFileTime(mFile, NULL, NULL, aModified);
+	CloseHandle(mFile);
+	mFile = INVALID_HANDLE_VALUE;
+	if (aDelete)
+		DeleteFile(mPath);
+}
+
+
+
+static void FileTimeToHTTPDate(const FILETIME &aTime, char *aBuf, size_t aBufSize)
+// Formats aTime (which is UTC) the way HTTP headers such as If-Range require, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+// This is done here rather than by InternetTimeFromSystemTime() because that function requires MSIE v3.0+.
+{
+	static const char *sDay[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+	static const char *sMonth[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+	SYSTEMTIME st;
+	if (!FileTimeToSystemTime(&aTime, &st))
 	{
-		lpfnInternetCloseHandle(hFile);
-		lpfnInternetCloseHandle(hInet);
-		FreeLibrary(hinstLib);
-		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
+		*aBuf = '\0';
+		return;
 	}
+	snprintf(aBuf, aBufSize, "%s, %02u %s %04u %02u:%02u:%02u GMT", sDay[st.wDayOfWeek % 7], st.wDay
+		, sMonth[(st.wMonth - 1) % 12], st.wYear, st.wHour, st.wMinute, st.wSecond);
+}
 
-	BYTE bufData[1024 * 1]; // v1.0.44.11: Reduced from 8 KB to alleviate GUI window lag during UrlDownloadtoFile.  Testing shows this reduction doesn't affect performance on high-speed downloads (in fact, downloads are slightly faster; I tested two sites, one at 184 KB/s and the other at 380 KB/s).  It might affect slow downloads, but that seems less likely so wasn't tested.
-	INTERNET_BUFFERS buffers = {0};
-	buffers.dwStructSize = sizeof(INTERNET_BUFFERS);
-	buffers.lpvBuffer = bufData;
-	buffers.dwBufferLength = sizeof(bufData);
 
-	LONG_OPERATION_INIT
 
-	// Read the file.  I don't think synchronous transfers typically generate the pseudo-error
-	// ERROR_IO_PENDING, so that is not checked here.  That's probably just for async transfers.
-	// IRF_NO_WAIT is used to avoid requiring the call to block until the buffer is full.  By
-	// having it return the moment there is any data in the buffer, the program is made more
-	// responsive, especially when the download is very slow and/or one of the hooks is installed:
-	BOOL result;
-	if (*aURL == 'h' || *aURL == 'H')
+// The figures of the most recent UrlDownloadToFile, for A_DownloadBytes, A_DownloadConnectTime, etc.
+static DownloadUInt64Type sLastDownloadBytes = 0;
+static unsigned sLastDownloadConnectTime = 0, sLastDownloadFirstByteTime = 0, sLastDownloadTime = 0;
+
+VarSizeType BIV_Download(char *aBuf, char *aVarName)
+{
+	char buf[MAX_INTEGER_SIZE];
+	char *target_buf = aBuf ? aBuf : buf;
+	switch (toupper(aVarName[10]))
+	{
+	case 'B': ITOA64((__int64)sLastDownloadBytes, target_buf); break; // A_Download[B]ytes
+	case 'C': _itoa(sLastDownloadConnectTime, target_buf, 10); break; // A_Download[C]onnectTime
+	case 'F': _itoa(sLastDownloadFirstByteTime, target_buf, 10); break; // A_Download[F]irstByteTime
+	default: _itoa(sLastDownloadTime, target_buf, 10); // A_Download[T]ime
+	}
+	return (VarSizeType)strlen(target_buf);
+}
+
+
+
+#ifdef REPORT_EXIT_STATS // See defines.h.
+static unsigned sDownloadCount = 0, sDownloadFailures = 0, sDownloadTime = 0;
+static DownloadUInt64Type sDownloadBytes = 0;
+
+void ReportDownloads()
+// Sends the totals of UrlDownloadToFile to the debugger (or a tool such as DebugView).
+{
+	if (!sDownloadCount)
+		return;
+	double megabytes = (double)(__int64)sDownloadBytes / (1024 * 1024);
+	double seconds = sDownloadTime / 1000.0;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "UrlDownloadToFile: %u downloads (%u failed), %.1f MB in %.1f s (%.1f MB/s)\n"
+		, sDownloadCount, sDownloadFailures, megabytes, seconds, seconds > 0 ? megabytes / seconds : 0.0);
+	OutputDebugString(buf);
+}
+#endif
+
+
+
+ResultType Line::URLDownloadToFile(char *aURL, char *aFilespec)
+// aURL may be preceded by any of the following options, each followed by a space or tab:
+// *N (where N is a number): Use N as the flags for InternetOpenUrl() (v1.0.44.07).
+// *BN: Read up to N KB at a time instead of DOWNLOAD_DEFAULT_BUFFER.
+// *R: If aFilespec already exists, assume it's the first part of the file and download only the rest, provided
+//     the file on the server hasn't changed since.  The file's modification time is set to the server's
+//     Last-Modified date so that this can be checked (by means of If-Range) when the download is resumed.
+// If aFilespec is an asterisk followed by a variable name, the file is stored in that variable instead.
+{
+	// v1.0.44.07: Set default to INTERNET_FLAG_RELOAD vs. 0 because the vast majority of usages would want
+	// the file to be retrieved directly rather than from the cache.
+	// v1.0.46.04: Added more no-cache flags because otherwise, it definitely falls back to the cache if
+	// the remote server doesn't repond (and perhaps other errors), which defeats the ability to use
+	// UrlDownloadToFile for uptime/server monitoring.  Also, in spite of what MSDN says, it seems nearly
+	// certain based on other sources that more than one flag is supported.  Someone also mentioned that
+	// INTERNET_FLAG_CACHE_IF_NET_FAIL is related to this, but there's no way to specify it in these
+	// particular calls, and it's the opposite of the desired behavior anyway; so it seems impossible to
+	// turn it off explicitly.
+	DWORD flags_for_open_url = INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_NO_CACHE_WRITE;
+	size_t max_buffer = DOWNLOAD_DEFAULT_BUFFER;
+	bool resume = false;
+	char *cp;
+	for (aURL = omit_leading_whitespace(aURL); *aURL == '*'; aURL = omit_leading_whitespace(cp))
 	{
-		while (result = lpfnInternetReadFileEx(hFile, &buffers, IRF_NO_WAIT, NULL)) // Assign
+		switch (toupper(*++aURL))
 		{
-			if (!buffers.dwBufferLength) // Transfer is complete.
-				break;
-			LONG_OPERATION_UPDATE  // Done in between the net-read and the file-write to improve avg. responsiveness.
-			fwrite(bufData, buffers.dwBufferLength, 1, fptr);
-			buffers.dwBufferLength = sizeof(bufData);  // Reset buffer capacity for next iteration.
+		case 'B': max_buffer = ATOU(aURL + 1) * 1024; break; // Downloader clamps it to a sensible range.
+		case 'R': resume = true; break;
+		default: flags_for_open_url = ATOU(aURL); // v1.0.44.07: Provide an option to override flags_for_open_url.
 		}
+		if (   !(cp = StrChrAny(aURL, " \t"))   ) // Find first space or tab.
+			break;
 	}
-	else // v1.0.48.04: This section adds support for FTP and perhaps Gopher by using InternetReadFile() instead of InternetReadFileEx().
+
+	// Since other script threads can interrupt while the file is being downloaded, resolve the output variable
+	// and copy the filename now, while aFilespec (which is in the deref buffer) is still valid.
+	Var *output_var = NULL;
+	char file_path[MAX_PATH];
+	if (*aFilespec == '*')
 	{
-		DWORD number_of_bytes_read;
-		while (result = lpfnInternetReadFile(hFile, bufData, sizeof(bufData), &number_of_bytes_read))
+		char *var_name = omit_leading_whitespace(aFilespec + 1);
+		if (   !(output_var = g_script.FindOrAddVar(var_name, 0, ALWAYS_PREFER_LOCAL))   )
+			return FAIL;  // It already displayed the error.
+		if (VAR_IS_READONLY(*output_var))
+			return LineError(ERR_VAR_IS_READONLY, FAIL, var_name);
+		resume = false; // Not supported for variables.
+	}
+	else
+		strlcpy(file_path, aFilespec, sizeof(file_path));
+
+	// If resuming, the download continues after whatever is already in the file.  FindFirstFile() is used
+	// rather than GetFileAttributesEx() for compatibility with Win95.  The file's modification time serves as
+	// the validator: it's the server's Last-Modified date if the file came from an earlier *R download, and
+	// otherwise it won't match, in which case the server sends the whole file.
+	DownloadUInt64Type resume_offset = 0;
+	char validator[64] = "";
+	if (resume)
+	{
+		WIN32_FIND_DATA found_file;
+		HANDLE file_search = FindFirstFile(file_path, &found_file);
+		if (file_search != INVALID_HANDLE_VALUE)
 		{
-			if (!number_of_bytes_read)
-				break;
-			LONG_OPERATION_UPDATE
-			fwrite(bufData, number_of_bytes_read, 1, fptr);
+			FindClose(file_search);
+			if (!(found_file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				resume_offset = ((DownloadUInt64Type)found_file.nFileSizeHigh << 32) | found_file.nFileSizeLow;
+				FileTimeToHTTPDate(found_file.ftLastWriteTime, validator, sizeof(validator));
+			}
 		}
 	}
-	// Close internet session:
-	lpfnInternetCloseHandle(hFile);
-	lpfnInternetCloseHandle(hInet);
-	FreeLibrary(hinstLib); // Only after the above.
-	// Close output file:
-	fclose(fptr);
-
-	if (result)
-		return g_ErrorLevel->Assign(ERRORLEVEL_NONE);  // Indicate success.
-	else // An error occurred during the transfer.
-	{
-		DeleteFile(aFilespec);  // delete damaged/incomplete file
+
+	WinINetTransport transport(flags_for_open_url);
+	if (!transport.Load()) // Check that we have IE3 and access to wininet.dll
 		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
-	}
+	FileDownloadSink file_sink(file_path);
+	DownloadMemorySink memory_sink(g_MaxVarCapacity);
+	Downloader downloader(&transport, output_var ? (DownloadSink *)&memory_sink : &file_sink, max_buffer);
+
+	LONG_OPERATION_INIT
+	DownloadStatus status;
+	for (status = downloader.Start(aURL, resume_offset, validator); status == DOWNLOAD_MORE; status = downloader.Step())
+		LONG_OPERATION_UPDATE
+
+	// Delete the damaged/incomplete file unless it can be resumed later, in which case it's stamped with the
+	// server's date (if there is one) to serve as the validator next time.
+	FILETIME last_modified;
+	file_sink.Close(status == DOWNLOAD_FAILED && !resume
+		, resume && transport.LastModified(last_modified) ? &last_modified : NULL);
+
+	sLastDownloadBytes = downloader.ByteCount();
+	sLastDownloadConnectTime = downloader.ConnectTime();
+	sLastDownloadFirstByteTime = downloader.FirstByteTime();
+	sLastDownloadTime = downloader.TotalTime();
+#ifdef REPORT_EXIT_STATS
+	++sDownloadCount;
+	sDownloadBytes += downloader.ByteCount();
+	sDownloadTime += downloader.TotalTime();
+	if (status != DOWNLOAD_DONE)
+		++sDownloadFailures;
+#endif
+	if (status != DOWNLOAD_DONE)
+		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
+	if (output_var && !output_var->Assign(memory_sink.Data() // NULL if nothing was received, which requires VARSIZE_MAX.
+		, memory_sink.Data() ? (VarSizeType)memory_sink.Length() : VARSIZE_MAX))
+		return FAIL;  // It already displayed the error.
+	return g_ErrorLevel->Assign(ERRORLEVEL_NONE);  // Indicate success.
 }
 
 
@@ -1466,6 +1744,144 @@ ResultType Line::FileGetVersion(char *aFilespec)
 
 
 
+#define FILE_COPY_WAIT_INTERVAL 10 // Milliseconds to wait for a copy to finish between checks of the message queue.
+
+FileCopyHost::FileCopyHost()
+{
+	// For large files on Vista and later, CopyFileEx()'s COPY_FILE_NO_BUFFERING makes the OS copy them with
+	// large, aligned, unbuffered transfers.  This is faster for big files and avoids evicting everything
+	// else from the system cache.  The function is resolved at runtime because Win95 lacks it, and the flag
+	// is used only on Vista or later because older OSes don't support it.
+	mCopyFileEx = g_os.IsWinVistaOrLater()
+		? (CopyFileExType)GetProcAddress(GetModuleHandle("kernel32"), "CopyFileExA") : NULL;
+}
+
+
+
+#define FILE_COPY_NO_BUFFERING 0x00001000 // COPY_FILE_NO_BUFFERING, which older SDKs lack.
+
+BOOL FileCopyHost::CopyOrOverwrite(const char *aSource, const char *aDest, BOOL aFailIfExists, CopyUInt64Type aSize)
+{
+	if (mCopyFileEx && aSize >= COPY_ENGINE_LARGE_FILE)
+		return mCopyFileEx(aSource, aDest, NULL, NULL, NULL
+			, (aFailIfExists ? COPY_FILE_FAIL_IF_EXISTS : 0) | FILE_COPY_NO_BUFFERING);
+	return CopyFile(aSource, aDest, aFailIfExists);
+}
+
+
+
+int FileCopyHost::CopyOneFile(const char *aSource, const char *aDest, int aFlags, CopyUInt64Type aSize)
+// This is called by worker threads as well as the main thread, so it must not refer to any script state.
+// Returns 0 on success or the error code from GetLastError() on failure.
+{
+	bool overwrite = (aFlags & COPY_OVERWRITE) != 0;
+	DWORD error, attr;
+
+	// Fixed for v1.0.36.01: This section has been revised to avoid unnecessary calls; but more
+	// importantly, it now avoids the deletion and complete loss of a file when it is copied or
+	// moved onto itself.  That used to happen because any existing destination file used to be
+	// deleted prior to attempting the move/copy.
+	if (aFlags & COPY_MOVE)  // Move vs. copy mode.
+	{
+		// Note that MoveFile() is capable of moving a file to a different volume, regardless of
+		// operating system version.  That's enough for what we need because this function never
+		// moves directories, only files.
+
+		// The following call will report success if source and dest are the same file, even if
+		// source is something like "..\Folder\Filename.txt" and dest is something like
+		// "C:\Folder\Filename.txt" (or if source is an 8.3 filename and dest is the long name
+		// of the same file).  This is good because it avoids the need to devise code
+		// to determine whether two different path names refer to the same physical file
+		// (note that GetFullPathName() has shown itself to be inadequate for this purpose due
+		// to problems with short vs. long names, UNC vs. mapped drive, and possibly NTFS hard
+		// links (aliases) that might all cause two different filenames to point to the same
+		// physical file on disk (hopefully MoveFile handles all of these correctly by indicating
+		// success [below] when a file is moved onto itself, though it has only been tested for
+		// basic cases of relative vs. absolute path).
+		if (MoveFile(aSource, aDest))
+			return 0;
+		// If overwrite mode was not specified by the caller, or it was but the existing
+		// destination file cannot be deleted (perhaps because it is a folder rather than
+		// a file), or it can be deleted but the source cannot be moved, indicate a failure.
+		// But by design, continue the operation.  The following relies heavily on
+		// short-circuit boolean evaluation order:
+		if (overwrite && DeleteFile(aDest) && MoveFile(aSource, aDest))
+			return 0;
+		error = GetLastError(); // At this stage, any of the above 3 being false is cause for failure.
+		return error ? error : ERROR_GEN_FAILURE;
+	}
+
+	// Otherwise, the mode is "Copy" vs. "Move".
+	if (CopyOrOverwrite(aSource, aDest, !overwrite, aSize)) // Force it to fail if overwrite==false.
+		return 0;
+	error = GetLastError();
+	// COPY_FORCE (used by FileCopyDir, whose former use of SHFileOperation() overwrote such files): CopyFile()
+	// refuses to overwrite a read-only file, or a hidden or system file unless the source has the same
+	// attributes, so remove those attributes and try again.
+	if ((aFlags & COPY_FORCE) && overwrite
+		&& (attr = GetFileAttributes(aDest)) != 0xFFFFFFFF && !(attr & FILE_ATTRIBUTE_DIRECTORY)
+		&& (attr & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)))
+	{
+		if (SetFileAttributes(aDest, attr & ~(FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM))
+			&& CopyOrOverwrite(aSource, aDest, FALSE, aSize))
+			return 0;
+		error = GetLastError();
+	}
+	return error ? error : ERROR_GEN_FAILURE;
+}
+
+
+
+#ifdef REPORT_EXIT_STATS // See defines.h.
+static unsigned sFileCopyCommands = 0, sFileCopyFiles = 0, sFileCopyFailures = 0, sFileCopyTime = 0;
+static CopyUInt64Type sFileCopyBytes = 0;
+
+static void FileCopyReport(CopyEngine &aEngine, char *aCommandName)
+// Adds the statistics of a finished copy or move to those reported by ReportFileCopies(), and sends the
+// details of any failures to the debugger (or a tool such as DebugView).
+{
+	++sFileCopyCommands;
+	sFileCopyFiles += aEngine.FileCount();
+	sFileCopyFailures += aEngine.FailureCount();
+	sFileCopyBytes += aEngine.ByteCount();
+	sFileCopyTime += aEngine.ElapsedTime();
+	if (!aEngine.FailureCount())
+		return;
+	char buf[MAX_PATH * 2 + 64];
+	snprintf(buf, sizeof(buf), "%s: %u of %u files failed\n", aCommandName, aEngine.FailureCount(), aEngine.FileCount());
+	OutputDebugString(buf);
+	for (int i = 0; i < aEngine.FailureDetailCount(); ++i)
+	{
+		const CopyFailure &failure = aEngine.FailureDetail(i);
+		snprintf(buf, sizeof(buf), "  error %d: %s -> %s\n", failure.error, failure.source, failure.dest);
+		OutputDebugString(buf);
+	}
+	if (aEngine.FailureCount() > (unsigned)aEngine.FailureDetailCount())
+	{
+		snprintf(buf, sizeof(buf), "  (%u more)\n", aEngine.FailureCount() - aEngine.FailureDetailCount());
+		OutputDebugString(buf);
+	}
+}
+
+
+
+void ReportFileCopies()
+// Sends the totals of FileCopy, FileMove and FileCopyDir to the debugger (or a tool such as DebugView).
+{
+	if (!sFileCopyCommands)
+		return;
+	double megabytes = (double)(__int64)sFileCopyBytes / (1024 * 1024);
+	double seconds = sFileCopyTime / 1000.0;
+	char buf[256];
+	snprintf(buf, sizeof(buf), "File copying: %u commands, %u files (%u failed), %.1f MB in %.1f s (%.1f MB/s)\n"
+		, sFileCopyCommands, sFileCopyFiles, sFileCopyFailures, megabytes, seconds
+		, seconds > 0 ? megabytes / seconds : 0.0);
+	OutputDebugString(buf);
+}
+#endif
+
+
+
 bool Line::Util_CopyDir(const char *szInputSource, const char *szInputDest, bool bOverwrite)
 {
 	// Get the fullpathnames and strip trailing \s
@@ -1491,37 +1907,83 @@ bool Line::Util_CopyDir(const char *szInputSource, const char *szInputDest, bool
 			return false;
 	}
 
-	// To work under old versions AND new version of shell32.dll the source must be specifed
-	// as "dir\*.*" and the destination directory must already exist... Godamn Microsoft and their APIs...
-	strcat(szSource, "\\*.*");
+	// Formerly SHFileOperation() was used for the rest.  Now the source tree is walked by DirEnum while
+	// CopyEngine copies its files, so that listing folders, creating folders and copying files all overlap,
+	// and several small files are copied at once.  As before, existing files are overwritten (even if
+	// read-only), hidden and system files are included, and folders keep their attributes.
+	return !Util_CopyDirContents(szSource, szDest);
+}
 
-	// We must also make source\dest double nulled strings for the SHFileOp API
-	szSource[strlen(szSource)+1] = '\0';	
-	szDest[strlen(szDest)+1] = '\0';	
 
-	// Setup the struct
-	SHFILEOPSTRUCT FileOp = {0};
-	FileOp.pFrom = szSource;
-	FileOp.pTo = szDest;
-	FileOp.wFunc = FO_COPY;
-	FileOp.fFlags = FOF_SILENT | FOF_NOCONFIRMMKDIR | FOF_NOCONFIRMATION | FOF_NOERRORUI; // FOF_NO_UI ("perform the operation with no user input") is not present for in case it would break compatibility somehow, and because the other flags already present seem to make its behavior implicit.  Also, unlike FileMoveDir, FOF_MULTIDESTFILES never seems to be needed.
-	// All of the below left set to NULL/FALSE by the struct initializer higher above:
-	//FileOp.hNameMappings			= NULL;
-	//FileOp.lpszProgressTitle		= NULL;
-	//FileOp.fAnyOperationsAborted	= FALSE;
-	//FileOp.hwnd					= NULL;
 
-	// If the source directory contains any saved webpages consisting of a SiteName.htm file and a
-	// corresponding directory named SiteName_files, the following may indicate an error even when the
-	// copy is successful. Under Windows XP at least, the return value is 7 under these conditions,
-	// which according to WinError.h is "ERROR_ARENA_TRASHED: The storage control blocks were destroyed."
-	// However, since this error might occur under a variety of circumstances, it probably wouldn't be
-	// proper to consider it a non-error.
-	// I also checked GetLastError() after calling SHFileOperation(), but it does not appear to be
-	// valid/useful in this case (MSDN mentions this fact but isn't clear about it).
-	// The issue appears to affect only FileCopyDir, not FileMoveDir or FileRemoveDir.  It also seems
-	// unlikely to affect FileCopy/FileMove because they never copy directories.
-	return !SHFileOperation(&FileOp);
+int Line::Util_CopyDirContents(const char *szSource, const char *szDest)
+// Copies everything inside the existing folder szSource into the existing folder szDest, overwriting any
+// files already there.  Both must be full paths without trailing backslashes.  Returns the number of
+// files and folders that could not be copied.
+{
+	char source_path[MAX_PATH], dest_path[MAX_PATH];
+	size_t source_length = strlen(szSource), dest_length = strlen(szDest);
+	if (source_length + 2 > MAX_PATH || dest_length + 2 > MAX_PATH) // +2 for the backslash and terminator.
+		return 1;
+	sprintf(source_path, "%s\\", szSource); // Above has ensured this won't overflow.
+	sprintf(dest_path, "%s\\", szDest);     //
+	++source_length;
+	++dest_length;
+
+	// Ordered mode ensures each folder is seen (and therefore created below) before any of its contents.
+	DirEnum dir_enum(new FileEnumHost(source_path, "*", FILE_LOOP_FILES_AND_FOLDERS)
+		, sizeof(WIN32_FIND_DATA), true, true);
+	if (!dir_enum.Start(source_path))
+		return 1;
+	CopyEngine copy_engine(new FileCopyHost);
+
+	int failure_count = 0;
+	WIN32_FIND_DATA *file;
+	char *relative_path;
+	LONG_OPERATION_INIT
+
+	while (file = (WIN32_FIND_DATA *)dir_enum.Next()) // Each cFileName includes the file's path.
+	{
+		// Since other script threads can interrupt during LONG_OPERATION_UPDATE, it's important that
+		// this function and those that call it not refer to sArgDeref[] and sArgVar[] anytime after an
+		// interruption becomes possible. This is because an interrupting thread usually changes the
+		// values to something inappropriate for this thread.
+		LONG_OPERATION_UPDATE
+
+		relative_path = file->cFileName + source_length;
+		if (dest_length + strlen(relative_path) >= MAX_PATH)
+		{
+			++failure_count;
+			continue;
+		}
+		strcpy(dest_path + dest_length, relative_path); // Above has ensured this won't overflow.
+
+		if (file->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (!CreateDirectory(dest_path, NULL) && !Util_IsDir(dest_path)) // It's okay if it already exists.
+				++failure_count; // Its contents will fail too (and be counted), but continue with the rest.
+			else
+				SetFileAttributes(dest_path, file->dwFileAttributes & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN
+					| FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_NOT_CONTENT_INDEXED));
+			continue;
+		}
+
+		while (!copy_engine.Add(file->cFileName, dest_path, COPY_OVERWRITE | COPY_FORCE
+			, ((CopyUInt64Type)file->nFileSizeHigh << 32) | file->nFileSizeLow))
+		{
+			copy_engine.Step(FILE_COPY_WAIT_INTERVAL);
+			LONG_OPERATION_UPDATE
+		}
+	}
+
+	while (copy_engine.Step(FILE_COPY_WAIT_INTERVAL))
+		LONG_OPERATION_UPDATE
+#ifdef REPORT_EXIT_STATS
+	FileCopyReport(copy_engine, "FileCopyDir");
+#endif
+	// ErrorCount() covers folders (or parts of them) that couldn't be listed, whose files weren't copied.
+	// Counting them is essential to Util_MoveDir(), which removes the source only if nothing failed.
+	return failure_count + (int)dir_enum.SkippedCount() + (int)dir_enum.ErrorCount() + (int)copy_engine.FailureCount();
 }
 
 
@@ -1555,6 +2017,8 @@ bool Line::Util_MoveDir(const char *szInputSource, const char *szInputDest, int
 	{
 		// If the source and dest are on different volumes then we must copy rather than move
 		// as move in this case only works on some OSes.  Copy and delete (poor man's move).
+		// Util_CopyDir() fails if anything at all wasn't copied, including any part of the source tree
+		// that couldn't be listed, so the source is never removed unless the copy is complete.
 		if (!Util_CopyDir(szSource, szDest, true))
 			return false;
 		return Util_RemoveDir(szSource, true);
@@ -1665,6 +2129,8 @@ int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool
 	size_t space_remaining = sizeof(szTempPath) - szTempPath_length - 1;
 
 	int failure_count = 0;
+	CopyEngine copy_engine(new FileCopyHost);
+	int flags = (bOverwrite ? COPY_OVERWRITE : 0) | (bMove ? COPY_MOVE : 0);
 	LONG_OPERATION_INIT
 
 	do
@@ -1690,47 +2156,24 @@ int Line::Util_CopyFile(const char *szInputSource, const char *szInputDest, bool
 		// Expand the destination based on this found file
 		Util_ExpandFilenameWildcard(findData.cFileName, szDest, szExpandedDest);
 
-		// Fixed for v1.0.36.01: This section has been revised to avoid unnecessary calls; but more
-		// importantly, it now avoids the deletion and complete loss of a file when it is copied or
-		// moved onto itself.  That used to happen because any existing destination file used to be
-		// deleted prior to attempting the move/copy.
-		if (bMove)  // Move vs. copy mode.
+		// The copy or move itself is done by copy_engine, on a worker thread if there's more than one file.
+		// See FileCopyHost::CopyOneFile() for details.
+		while (!copy_engine.Add(szTempPath, szExpandedDest, flags
+			, ((CopyUInt64Type)findData.nFileSizeHigh << 32) | findData.nFileSizeLow))
 		{
-			// Note that MoveFile() is capable of moving a file to a different volume, regardless of
-			// operating system version.  That's enough for what we need because this function never
-			// moves directories, only files.
-
-			// The following call will report success if source and dest are the same file, even if
-			// source is something like "..\Folder\Filename.txt" and dest is something like
-			// "C:\Folder\Filename.txt" (or if source is an 8.3 filename and dest is the long name
-			// of the same file).  This is good because it avoids the need to devise code
-			// to determine whether two different path names refer to the same physical file
-			// (note that GetFullPathName() has shown itself to be inadequate for this purpose due
-			// to problems with short vs. long names, UNC vs. mapped drive, and possibly NTFS hard
-			// links (aliases) that might all cause two different filenames to point to the same
-			// physical file on disk (hopefully MoveFile handles all of these correctly by indicating
-			// success [below] when a file is moved onto itself, though it has only been tested for
-			// basic cases of relative vs. absolute path).
-			if (!MoveFile(szTempPath, szExpandedDest))
-			{
-				// If overwrite mode was not specified by the caller, or it was but the existing
-				// destination file cannot be deleted (perhaps because it is a folder rather than
-				// a file), or it can be deleted but the source cannot be moved, indicate a failure.
-				// But by design, continue the operation.  The following relies heavily on
-				// short-circuit boolean evaluation order:
-				if (   !(bOverwrite && DeleteFile(szExpandedDest) && MoveFile(szTempPath, szExpandedDest))   )
-					++failure_count; // At this stage, any of the above 3 being false is cause for failure.
-				//else everything succeeded, so nothing extra needs to be done.  In either case,
-				// continue on to the next file.
-			}
+			copy_engine.Step(FILE_COPY_WAIT_INTERVAL);
+			LONG_OPERATION_UPDATE
 		}
-		else // The mode is "Copy" vs. "Move"
-			if (!CopyFile(szTempPath, szExpandedDest, !bOverwrite)) // Force it to fail if bOverwrite==false.
-				++failure_count;
 	} while (FindNextFile(hSearch, &findData));
 
 	FindClose(hSearch);
-	return failure_count;
+
+	while (copy_engine.Step(FILE_COPY_WAIT_INTERVAL))
+		LONG_OPERATION_UPDATE
+#ifdef REPORT_EXIT_STATS
+	FileCopyReport(copy_engine, bMove ? "FileMove" : "FileCopy");
+#endif
+	return failure_count + (int)copy_engine.FailureCount();
 }
 
 
@@ -2118,62 +2561,81 @@ void DoIncrementalMouseMove(int aX1, int aY1, int aX2, int aY2, int aSpeed)
 // PROCESS ROUTINES
 ////////////////////
 
+// The 9x/2000+ method takes a snapshot of every process in the system, which is costly relative to the
+// checks callers typically want to make.  So the most recent list of processes is kept for a short time
+// by the ProcessCache below (see proccache.h).
+#define PROCESS_CACHE_MAX_AGE 50 // Milliseconds.  Kept below Process Wait's polling interval.
+
+class ToolhelpProcessProvider : public ProcessProvider
+{
+public:
+	bool Enumerate(ProcessCache &aCache)
+	{
+		// We must dynamically load the function or program will probably not launch at all on NT4.
+		typedef BOOL (WINAPI *PROCESSWALK)(HANDLE hSnapshot, LPPROCESSENTRY32 lppe);
+		typedef HANDLE (WINAPI *CREATESNAPSHOT)(DWORD dwFlags, DWORD th32ProcessID);
+
+		static CREATESNAPSHOT lpfnCreateToolhelp32Snapshot = (CREATESNAPSHOT)GetProcAddress(GetModuleHandle("kernel32"), "CreateToolhelp32Snapshot");
+		static PROCESSWALK lpfnProcess32First = (PROCESSWALK)GetProcAddress(GetModuleHandle("kernel32"), "Process32First");
+		static PROCESSWALK lpfnProcess32Next = (PROCESSWALK)GetProcAddress(GetModuleHandle("kernel32"), "Process32Next");
+
+		if (!lpfnCreateToolhelp32Snapshot || !lpfnProcess32First || !lpfnProcess32Next)
+			return false;
+
+		PROCESSENTRY32 proc;
+		proc.dwSize = sizeof(proc);
+		HANDLE snapshot = lpfnCreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+		if (snapshot == INVALID_HANDLE_VALUE)
+			return false;
+		lpfnProcess32First(snapshot, &proc); // The first entry is the idle process, which has never been reported.
+
+		char szDrive[_MAX_PATH+1], szDir[_MAX_PATH+1], szFile[_MAX_PATH+1], szExt[_MAX_PATH+1];
+		while (lpfnProcess32Next(snapshot, &proc))
+		{
+			// It seems that proc.szExeFile never contains a path, just the executable name.
+			// But in case it ever does, ensure consistency by removing the path:
+			_splitpath(proc.szExeFile, szDrive, szDir, szFile, szExt);
+			strcat(szFile, szExt);
+			if (!aCache.Add(proc.th32ProcessID, szFile))
+				break; // Use what was gathered so far rather than failing outright.
+		}
+		CloseHandle(snapshot);
+		return true;
+	}
+
+	unsigned TickCount() {return GetTickCount();}
+};
+
+static ToolhelpProcessProvider sToolhelpProcessProvider;
+static ProcessCache sProcessCache(sToolhelpProcessProvider, PROCESS_CACHE_MAX_AGE);
+
+
+
+void ProcessCacheInvalidate()
+{
+	sProcessCache.Invalidate();
+}
+
+
+
 DWORD ProcessExist9x2000(char *aProcess, char *aProcessName)
 {
 	if (aProcessName) // Init this output variable in case of early return.
 		*aProcessName = '\0';
 
-	// We must dynamically load the function or program will probably not launch at all on NT4.
-	typedef BOOL (WINAPI *PROCESSWALK)(HANDLE hSnapshot, LPPROCESSENTRY32 lppe);
-	typedef HANDLE (WINAPI *CREATESNAPSHOT)(DWORD dwFlags, DWORD th32ProcessID);
-
-	static CREATESNAPSHOT lpfnCreateToolhelp32Snapshot = (CREATESNAPSHOT)GetProcAddress(GetModuleHandle("kernel32"), "CreateToolhelp32Snapshot");
-    static PROCESSWALK lpfnProcess32First = (PROCESSWALK)GetProcAddress(GetModuleHandle("kernel32"), "Process32First");
-    static PROCESSWALK lpfnProcess32Next = (PROCESSWALK)GetProcAddress(GetModuleHandle("kernel32"), "Process32Next");
-
-	if (!lpfnCreateToolhelp32Snapshot || !lpfnProcess32First || !lpfnProcess32Next)
+	if (!sProcessCache.Update())
 		return 0;
 
-	PROCESSENTRY32 proc;
-    proc.dwSize = sizeof(proc);
-	HANDLE snapshot = lpfnCreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-	lpfnProcess32First(snapshot, &proc);
-
 	// Determine the PID if aProcess is a pure, non-negative integer (any negative number
 	// is more likely to be the name of a process [with a leading dash], rather than the PID).
-	DWORD specified_pid = IsPureNumeric(aProcess) ? ATOU(aProcess) : 0;
-	char szDrive[_MAX_PATH+1], szDir[_MAX_PATH+1], szFile[_MAX_PATH+1], szExt[_MAX_PATH+1];
-
-	while (lpfnProcess32Next(snapshot, &proc))
-	{
-		if (specified_pid && specified_pid == proc.th32ProcessID)
-		{
-			if (aProcessName) // Caller wanted process name also.
-			{
-				// For consistency in results, use _splitpath() both here and below rather than
-				// something that just checks for a rightmost backslash.
-				_splitpath(proc.szExeFile, szDrive, szDir, aProcessName, szExt);
-				strcat(aProcessName, szExt);
-			}
-			CloseHandle(snapshot);
-			return specified_pid;
-		}
-		// Otherwise, check for matching name even if aProcess is purely numeric (i.e. a number might
-		// also be a valid name?):
-		// It seems that proc.szExeFile never contains a path, just the executable name.
-		// But in case it ever does, ensure consistency by removing the path:
-		_splitpath(proc.szExeFile, szDrive, szDir, szFile, szExt);
-		strcat(szFile, szExt);
-		if (!stricmp(szFile, aProcess)) // lstrcmpi() is not used: 1) avoids breaking exisitng scripts; 2) provides consistent behavior across multiple locales; 3) performance.
-		{
-			if (aProcessName) // Caller wanted process name also.
-				strcpy(aProcessName, szFile);
-			CloseHandle(snapshot);
-			return proc.th32ProcessID;
-		}
-	}
-	CloseHandle(snapshot);
-	return 0;  // Not found.
+	// A matching name is also checked for even if aProcess is purely numeric (i.e. a number
+	// might also be a valid name?), and whichever match comes first in the snapshot is reported.
+	int found_index = sProcessCache.Find(IsPureNumeric(aProcess) ? ATOU(aProcess) : 0, aProcess);
+	if (found_index < 0)
+		return 0;  // Not found.
+	if (aProcessName) // Caller wanted process name also.
+		strcpy(aProcessName, sProcessCache.Name(found_index));
+	return sProcessCache.PID(found_index);
 }
 
 
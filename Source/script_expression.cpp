@@ -42,6 +42,49 @@ GNU General Public License for more details.
 #include "globaldata.h" // for a lot of things
 #include "qmath.h" // For ExpandExpression()
 
+
+
+static bool PostfixMayNeedVar(ExprTokenType *aPostfix)
+// Returns true if the expression might need a double-deref such as Array%i% to yield an actual variable
+// rather than just a value: as the target of an assignment or increment/decrement, as the operand of the
+// address operator, or as a parameter of a function that takes it ByRef or otherwise requires a variable.
+{
+	for (ExprTokenType *token = aPostfix; token->symbol != SYM_INVALID; ++token)
+	{
+		switch (token->symbol)
+		{
+		case SYM_POST_INCREMENT:
+		case SYM_POST_DECREMENT:
+		case SYM_PRE_INCREMENT:
+		case SYM_PRE_DECREMENT:
+		case SYM_ADDRESS:
+			return true;
+		case SYM_FUNC:
+		{
+			Func *func = token->deref->func;
+			if (!token->deref->marker || !func) // A dynamic function call, whose function isn't known yet.
+				return true;
+			if (func->mIsBuiltIn)
+			{
+				if (func->mBIF == BIF_DllCall || func->mBIF == BIF_RegEx || func->mBIF == BIF_NumGet
+					|| func->mBIF == BIF_NumPut || func->mBIF == BIF_VarSetCapacity
+					|| func->mBIF == BIF_LV_GetText || func->mBIF == BIF_TV_Get)
+					return true;
+			}
+			else
+				for (int i = 0; i < func->mParamCount; ++i)
+					if (func->mParam[i].is_byref)
+						return true;
+			break;
+		}
+		default:
+			if (IS_ASSIGNMENT_EXCEPT_POST_AND_PRE(token->symbol))
+				return true;
+		}
+	}
+	return false;
+}
+
 // __forceinline: Decided against it for this function because alhough it's only called by one caller,
 // testing shows that it wastes stack space (room for its automatic variables would be unconditionally 
 // reserved in the stack of its caller).  Also, the performance benefit of inlining this is too slight.
@@ -102,6 +145,9 @@ char *Line::ExpandExpression(int aArgIndex, ResultType &aResult, char *&aTarget,
 	Var *sym_assign_var, *temp_var;
 	VarBkp *var_backup = NULL;  // If needed, it will hold an array of VarBkp objects. v1.0.40.07: Initialized to NULL to facilitate an approach that's more maintainable.
 	int var_backup_count; // The number of items in the above array (when it's non-NULL).
+	int postfix_may_need_var = -1; // -1 means "not yet determined".  See PostfixMayNeedVar().
+	char *packed_element;
+	size_t packed_element_length;
 
 	// v1.0.44.06: EXPR_SMALL_MEM_LIMIT is the means by which _alloca() is used to boost performance a
 	// little by avoiding the overhead of malloc+free for small strings.  The limit should be something
@@ -330,6 +376,43 @@ char *Line::ExpandExpression(int aArgIndex, ResultType &aResult, char *&aTarget,
 					// since it seems relatively harmless to create a blank variable in something like var := Array%i%
 					// (though it will produce a runtime error if the double resolves to an illegal variable name such
 					// as one containing spaces).
+					// If there's no variable by this name but it's an element of a packed array (see
+					// Script::StoreArrayElement), use a copy of its value rather than making it into a variable,
+					// unless this expression might need a variable.  The copy is made the same way as for
+					// environment variables above, so that it stays valid even if a function called by this
+					// expression replaces the array:
+					if (g_script.mPackedArrays.Count()
+						&& !g_script.FindVar(left_buf, var_name_length, NULL, ALWAYS_PREFER_LOCAL)
+						&& g_script.GetPackedElement(left_buf, var_name_length, packed_element, packed_element_length)
+						&& !(postfix_may_need_var < 0 ? (postfix_may_need_var = PostfixMayNeedVar(postfix)) : postfix_may_need_var))
+					{
+						result_size = packed_element_length + 1;
+						if (result_size <= (int)(aDerefBufSize - (target - aDerefBuf))) // There is room at the end of our deref buf, so use it.
+						{
+							result = target;
+							target += result_size;
+						}
+						else if (result_size < EXPR_SMALL_MEM_LIMIT && alloca_usage < EXPR_ALLOCA_LIMIT)
+						{
+							result = (char *)_alloca(result_size);
+							alloca_usage += result_size;
+						}
+						else
+						{
+							if (mem_count == MAX_EXPR_MEM_ITEMS // No more slots left (should be nearly impossible).
+								|| !(mem[mem_count] = (char *)malloc(result_size)))
+							{
+								LineError(ERR_OUTOFMEM ERR_ABORT, FAIL, left_buf);
+								goto abort;
+							}
+							result = mem[mem_count];
+							++mem_count; // Must be done last.
+						}
+						this_token.marker = (char *)memcpy(result, packed_element, result_size); // Includes the terminator.
+						this_token.buf = NULL; // Indicate that this SYM_OPERAND token LACKS a pre-converted binary integer.
+						this_token.symbol = SYM_OPERAND; // Generic operand so that it can later be interpreted as a number (if it's numeric).
+						goto push_this_token;
+					}
 					// The use of ALWAYS_PREFER_LOCAL below improves flexibility of assume-global functions
 					// by allowing this command to resolve to a local first if such a local exists:
 					if (   !(temp_var = g_script.FindOrAddVar(left_buf, var_name_length, ALWAYS_PREFER_LOCAL))   )
@@ -1197,9 +1280,9 @@ char *Line::ExpandExpression(int aArgIndex, ResultType &aResult, char *&aTarget,
 					// simplify the code).
 					right_length = (right.symbol == SYM_VAR) ? right.var->LengthIgnoreBinaryClip() : strlen(right_string);
 					if (sym_assign_var // Since "right" is being appended onto a variable ("left"), an optimization is possible.
-						&& sym_assign_var->AppendIfRoom(right_string, (VarSizeType)right_length)) // But only if the target variable has enough remaining capacity.
+						&& sym_assign_var->Append(right_string, (VarSizeType)right_length)) // But only if the target variable can be expanded in place (if necessary).
 					{
-						// AppendIfRoom() always fails for VAR_CLIPBOARD, so below won't execute for it (which is
+						// Append() always fails for VAR_CLIPBOARD, so below won't execute for it (which is
 						// good because don't want clipboard to stay as SYM_VAR after the assignment. This is
 						// because it simplifies the code not to have to worry about VAR_CLIPBOARD in BIFs, etc.)
 						this_token.var = sym_assign_var; // Make the result a variable rather than a normal operand so that its
@@ -1235,7 +1318,7 @@ char *Line::ExpandExpression(int aArgIndex, ResultType &aResult, char *&aTarget,
 							// MUST DO THE ABOVE CHECK because the next section further below might free the
 							// destination memory before doing the operation. Thus, if the destination is the
 							// same as one of the sources, freeing it beforehand would obviously be a problem.
-							if (temp_var->AppendIfRoom(right_string, (VarSizeType)right_length))
+							if (temp_var->Append(right_string, (VarSizeType)right_length))
 							{
 								if (done_and_have_an_output_var) // Fix for v1.0.48: Checking "temp_var == output_var" would not be enough for cases like v := (v := v . "a") . "b"
 									goto normal_end_skip_output_var; // Nothing more to do because it has even taken care of output_var already.
@@ -1247,8 +1330,8 @@ char *Line::ExpandExpression(int aArgIndex, ResultType &aResult, char *&aTarget,
 									goto push_this_token;
 								}
 							}
-							//else no optimizations are possible because: 1) No room; 2) The overlap between the
-							// source and dest requires temporary memory.  So fall through to the slower method.
+							//else no optimizations are possible because the variable couldn't be expanded (e.g. out of
+							// memory or #MaxMem), so fall through to the slower method, which will report the error.
 						}
 						else if (result != right_string) // No overlap between the two sources and dest.
 						{
@@ -1597,9 +1680,9 @@ non_null_circuit_token:
 		case SYM_INTEGER: result_is_true = (result_token.value_int64 != 0); break;
 		case SYM_FLOAT:   result_is_true = (result_token.value_double != 0.0); break;
 		case SYM_OPERAND:
-			if (result_token.buf)
+			if (OPERAND_IS_INTEGER(result_token))
 			{
-				result_is_true = (*(__int64 *)result_token.buf != 0); // Use the stored binary integer for performance.
+				result_is_true = (OPERAND_NUMBER(result_token)->value_int64 != 0); // Use the stored binary integer for performance.
 				break;
 			}
 			//else DON'T BREAK; FALL THROUGH TO NEXT CASE:
@@ -1628,7 +1711,7 @@ non_null_circuit_token:
 	case SYM_FLOAT:
 		// In case of float formats that are too long to be supported, use snprint() to restrict the length.
 		 // %f probably defaults to %0.6f.  %f can handle doubles in MSVC++.
-		aTarget += snprintf(aTarget, MAX_NUMBER_SIZE, g->FormatFloat, result_token.value_double) + 1; // +1 because that's what callers want; i.e. the position after the terminator.
+		aTarget += FTOA(result_token.value_double, aTarget, MAX_NUMBER_SIZE) + 1; // +1 because that's what callers want; i.e. the position after the terminator.
 		goto normal_end_skip_output_var; // output_var was already checked higher above, so no need to consider it again.
 	case SYM_STRING:
 	case SYM_OPERAND:
@@ -1681,12 +1764,13 @@ non_null_circuit_token:
 			// happens only in extreme cases.
 			size_t new_buf_size = aDerefBufSize + (result_size - capacity_of_our_buf_portion);
 
-			// malloc() and free() are used instead of realloc() because in many cases, the overhead of
-			// realloc()'s internal memcpy(entire contents) can be avoided because only part or
+			// A new buffer and DerefBufRelease() are used instead of realloc() because in many cases, the
+			// overhead of realloc()'s internal memcpy(entire contents) can be avoided because only part or
 			// none of the contents needs to be copied (realloc's ability to do an in-place resize might
-			// be unlikely for anything other than small blocks; see compiler's realloc.c):
+			// be unlikely for anything other than small blocks; see compiler's realloc.c).  The following
+			// may round new_buf_size up, which is fine since the caller adopts it below:
 			char *new_buf;
-			if (   !(new_buf = (char *)malloc(new_buf_size))   )
+			if (   !(new_buf = DerefBufAlloc(new_buf_size))   )
 			{
 				LineError(ERR_OUTOFMEM ERR_ABORT);
 				goto abort;
@@ -1708,7 +1792,7 @@ non_null_circuit_token:
 			// done prior to free(), but memcpy() vs. memmove() is safe in any case:
 			memcpy(aTarget, result, result_size); // Copy from old location to the newly allocated one.
 
-			free(aDerefBuf); // Free our original buffer since it's contents are no longer needed.
+			DerefBufRelease(aDerefBuf, aDerefBufSize); // Release our original buffer since it's contents are no longer needed.
 			if (aDerefBufSize > LARGE_DEREF_BUF_SIZE)
 				--sLargeDerefBufs;
 
@@ -1824,20 +1908,20 @@ ResultType Line::ExpandArgs(VarSizeType aSpaceNeeded, Var *aArgVar[])
 		// then the old size should be passed to FreeAndRestoreFunctionVars() so that it can restore it.
 		// However, given the rarity of deep recursion, this doesn't seem worth the extra code size and loss of
 		// performance.
-		size_t increments_needed = space_needed / DEREF_BUF_EXPAND_INCREMENT;
-		if (space_needed % DEREF_BUF_EXPAND_INCREMENT)  // Need one more if above division truncated it.
-			++increments_needed;
-		size_t new_buf_size = increments_needed * DEREF_BUF_EXPAND_INCREMENT;
+		// The pool used by DerefBufAlloc() greatly reduces the cost of the above for UDFs that are called
+		// repeatedly rather than recursively, since each call's buffer is recycled for the next.
+		size_t new_buf_size = space_needed; // DerefBufAlloc() will round this up to a suitable size.
 		if (sDerefBuf)
 		{
-			// Do a free() and malloc(), which should be far more efficient than realloc(), especially if
-			// there is a large amount of memory involved here (realloc's ability to do an in-place resize
-			// might be unlikely for anything other than small blocks; see compiler's realloc.c):
-			free(sDerefBuf);
+			// Release the old buffer and get a new one, which should be far more efficient than realloc(),
+			// especially if there is a large amount of memory involved here (realloc's ability to do an
+			// in-place resize might be unlikely for anything other than small blocks; see compiler's
+			// realloc.c).  Releasing it first allows it to be recycled if a larger one isn't available:
+			DerefBufRelease(sDerefBuf, sDerefBufSize);
 			if (sDerefBufSize > LARGE_DEREF_BUF_SIZE)
 				--sLargeDerefBufs;
 		}
-		if (   !(sDerefBuf = (char *)malloc(new_buf_size))   )
+		if (   !(sDerefBuf = DerefBufAlloc(new_buf_size))   )
 		{
 			// Error msg was formerly: "Ran out of memory while attempting to dereference this line's parameters."
 			sDerefBufSize = 0;  // Reset so that it can make another attempt, possibly smaller, next time.
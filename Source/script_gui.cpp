@@ -70,6 +70,8 @@ ResultType Script::PerformGui(char *aCommand, char *aParam2, char *aParam3, char
 		case GUI_CMD_MINIMIZE:
 		case GUI_CMD_MAXIMIZE:
 		case GUI_CMD_RESTORE:
+		case GUI_CMD_BEGINUPDATE: // Controls added to a window that doesn't exist yet don't need batching since it isn't visible.
+		case GUI_CMD_ENDUPDATE:
 			goto return_the_result; // Nothing needs to be done since the window object doesn't exist.
 
 		// v1.0.43.09:
@@ -338,6 +340,14 @@ ResultType Script::PerformGui(char *aCommand, char *aParam2, char *aParam3, char
 		FlashWindow(gui.mHwnd, stricmp(aParam2, "Off") ? TRUE : FALSE);
 		goto return_the_result;
 
+	case GUI_CMD_BEGINUPDATE:
+		gui.BeginUpdate();
+		goto return_the_result;
+
+	case GUI_CMD_ENDUPDATE:
+		gui.EndUpdate();
+		goto return_the_result;
+
 	} // switch()
 
 	result = FAIL;  // Should never be reached, but avoids compiler warning and improves bug detection.
@@ -349,6 +359,23 @@ return_the_result:
 
 
 
+Var *Line::ControlIDGlobalVar(int aArgNum, char *aControlID)
+// Returns the global variable named by aControlID (the value of arg #aArgNum) for use with GuiType::FindControl(),
+// or NULL to have FindControl() look it up.  When the arg contains no derefs, its value can never change, so
+// the variable is resolved only the first time the line is executed and cached in mAttribute (which is otherwise
+// unused by GuiControl and GuiControlGet).  This is safe because global variables are never deleted.  The
+// lookup can't be done at load-time because a control's global variable is often not created until the
+// "Gui Add" that uses it is executed.
+{
+	if (mAttribute)
+		return (Var *)mAttribute;
+	if (!*aControlID || aArgNum > mArgc || !*mArg[aArgNum - 1].text || ArgHasDeref(aArgNum))
+		return NULL;
+	return (Var *)(mAttribute = g_script.FindVar(aControlID, 0, NULL, ALWAYS_USE_GLOBAL)); // Stays NULL if not found, so it will be retried next time.
+}
+
+
+
 ResultType Line::GuiControl(char *aCommand, char *aControlID, char *aParam3)
 {
 	char *options; // This will contain something that is meaningful only when gui_command == GUICONTROL_CMD_OPTIONS.
@@ -366,7 +393,7 @@ ResultType Line::GuiControl(char *aCommand, char *aControlID, char *aParam3)
 		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 
 	GuiType &gui = *g_gui[window_index];  // For performance and convenience.
-	GuiIndexType control_index = gui.FindControl(aControlID);
+	GuiIndexType control_index = gui.FindControl(aControlID, ControlIDGlobalVar(2, aControlID));
 	if (control_index >= gui.mControlCount) // Not found.
 		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 	GuiControlType &control = gui.mControl[control_index];   // For performance and convenience.
@@ -397,6 +424,16 @@ ResultType Line::GuiControl(char *aCommand, char *aControlID, char *aParam3)
 	bool do_redraw_if_in_tab = false;
 	bool do_redraw_unconditionally = false;
 
+	if (gui.mUpdateDepth) // Between "Gui BeginUpdate" and "Gui EndUpdate".
+	{
+		if (gui.QueueControlText(control_index, guicontrol_cmd, aParam3))
+			goto return_the_result; // It will be applied by "Gui EndUpdate".
+		// Otherwise, this command can't be queued, so it's done now.  But if any text is queued for this
+		// control, apply it first so that the control sees its updates in the order the script made them:
+		if (gui.mPendingText && gui.mPendingText->Find(control_index) != -1)
+			gui.ApplyPendingText();
+	}
+
 	switch (guicontrol_cmd)
 	{
 
@@ -1197,6 +1234,8 @@ ResultType Line::GuiControlGet(char *aCommand, char *aControlID, char *aParam3)
 		return g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
 
 	GuiType &gui = *g_gui[window_index];  // For performance and convenience.
+	if (gui.mPendingText && gui.mPendingText->Count()) // Ensure text queued by GuiControl is what gets retrieved.
+		gui.ApplyPendingText();
 	if (!*aControlID) // In this case, default to the name of the output variable, as documented.
 		aControlID = output_var.mName;
 
@@ -1246,7 +1285,7 @@ ResultType Line::GuiControlGet(char *aCommand, char *aControlID, char *aParam3)
 		goto return_the_result;
 	}
 
-	GuiIndexType control_index = gui.FindControl(aControlID);
+	GuiIndexType control_index = gui.FindControl(aControlID, ControlIDGlobalVar(3, aControlID));
 	if (control_index >= gui.mControlCount) // Not found.
 	{
 		g_ErrorLevel->Assign(ERRORLEVEL_ERROR);
@@ -1440,13 +1479,18 @@ ResultType GuiType::Destroy(GuiIndexType aWindowIndex)
 			//else do nothing, since it isn't the right type to have a valid union_hbitmap member.
 		}
 		else if (control.type == GUI_CONTROL_LISTVIEW) // It was ensured at an earlier stage that union_lv_attrib != NULL.
+		{
+			delete control.union_lv_attrib->store; // Might be NULL, which is okay.
 			free(control.union_lv_attrib);
+		}
 	}
 	// Not necessary since the object itself is about to be destroyed:
 	//gui.mHwnd = NULL;
 	//gui.mControlCount = 0; // All child windows (controls) are automatically destroyed with parent.
 	HICON icon_eligible_for_destruction = gui.mIconEligibleForDestruction;
 	free(gui.mControl); // Free the control array, which was previously malloc'd.
+	free(gui.mVarIndex); // Might be NULL, which is okay.
+	delete gui.mPendingText; // Any text still queued is discarded along with the controls.  Might be NULL, which is okay.
 	delete g_gui[aWindowIndex]; // After this, the var "gui" is invalid so should not be referenced, i.e. the next line.
 	g_gui[aWindowIndex] = NULL;
 	--sGuiCount; // This count is maintained to help performance in the main event loop and other places.
@@ -2877,6 +2921,8 @@ ResultType GuiType::AddControl(GuiControls aControlType, char *aOptions, char *a
 			ZeroMemory(control.union_lv_attrib, sizeof(lv_attrib_type));
 			control.union_lv_attrib->sorted_by_col = -1; // Indicate that there is currently no sort order.
 			control.union_lv_attrib->no_auto_sort = opt.listview_no_auto_sort;
+			if (style & LVS_OWNERDATA) // The "Virtual" option: the rows are kept in a ListViewStore rather than by the control.
+				control.union_lv_attrib->store = new ListViewStore;
 
 			// v1.0.36.06: If this ListView is owned by a tab control, flag that tab control as needing
 			// to stay after all of its controls in the z-order.  This solves ListView-inside-Tab redrawing
@@ -3442,6 +3488,16 @@ ResultType GuiType::AddControl(GuiControls aControlType, char *aOptions, char *a
 	// Otherwise the above control creation succeeded.
 	++mControlCount;
 	mControlWidthWasSetByContents = control_width_was_set_by_contents; // Set for use by next control, if any.
+	if (control.output_var)
+	{
+		// Keep the index up-to-date incrementally so that a script that adds hundreds of controls
+		// doesn't cause a rebuild for each one.  If the table is too full, it's rebuilt larger upon
+		// next use.
+		if (!mVarIndexIsStale && mControlCount * 2 <= mVarIndexSize)
+			VarIndexInsert(mControlCount - 1);
+		else
+			mVarIndexIsStale = true;
+	}
 	if (opt.hwnd_output_var) // v1.0.46.01.
 		opt.hwnd_output_var->AssignHWND(control.hwnd);
 
@@ -4312,6 +4368,11 @@ ResultType GuiType::ControlParseOptions(char *aOptions, GuiControlOptionsType &a
 		}
 		else if (aControl.type == GUI_CONTROL_LISTVIEW && !stricmp(next_option, "Hdr"))
 			if (adding) aOpt.style_remove |= LVS_NOCOLUMNHEADER; else aOpt.style_add |= LVS_NOCOLUMNHEADER;
+		else if (aControl.type == GUI_CONTROL_LISTVIEW && !stricmp(next_option, "Virtual"))
+		{
+			if (!aControl.hwnd) // LVS_OWNERDATA can't be changed after the control is created.
+				if (adding) aOpt.style_add |= LVS_OWNERDATA; else aOpt.style_remove |= LVS_OWNERDATA;
+		}
 		else if (aControl.type == GUI_CONTROL_LISTVIEW && !strnicmp(next_option, "NoSort", 6))
 		{
 			if (!stricmp(next_option + 6, "Hdr")) // Prevents the header from being clickable like a set of buttons.
@@ -4982,6 +5043,8 @@ ResultType GuiType::ControlParseOptions(char *aOptions, GuiControlOptionsType &a
 					break;
 				case 'V':
 					aControl.output_var = NULL;
+					if (aControl.hwnd) // An existing control (not one being created) has lost its variable.
+						mVarIndexIsStale = true;
 					break;
 				}
 				*option_end = orig_char; // Undo the temporary termination because the caller needs aOptions to be unaltered.
@@ -5074,13 +5137,13 @@ ResultType GuiType::ControlParseOptions(char *aOptions, GuiControlOptionsType &a
 				// changes to it, etc.)  Note that if this is the first control being added, mControlCount
 				// is now zero because this control has not yet actually been added.  That is why
 				// "u < mControlCount" is used:
-				GuiIndexType u;
-				for (u = 0; u < mControlCount; ++u)
-					if (mControl[u].output_var == candidate_var)
-						return aControl.hwnd ? g_ErrorLevel->Assign(ERRORLEVEL_ERROR)
-							: g_script.ScriptError("The same variable cannot be used for more than one control." // It used to say "one control per window" but that seems more confusing than it's worth.
-								ERR_ABORT, next_option - 1);
+				if (FindControlByVar(candidate_var) != -1) // Must compare directly to -1 due to unsigned.
+					return aControl.hwnd ? g_ErrorLevel->Assign(ERRORLEVEL_ERROR)
+						: g_script.ScriptError("The same variable cannot be used for more than one control." // It used to say "one control per window" but that seems more confusing than it's worth.
+							ERR_ABORT, next_option - 1);
 				aControl.output_var = candidate_var;
+				if (aControl.hwnd) // An existing control's variable has changed.  A new control is added to the index by AddControl().
+					mVarIndexIsStale = true;
 				break;
 
 			case 'E':  // Extended style
@@ -6297,6 +6360,9 @@ ResultType GuiType::Submit(bool aHideIt)
 	if (!mHwnd) // Operating on a non-existent GUI has no effect.
 		return OK;
 
+	if (mPendingText && mPendingText->Count()) // Ensure text queued by GuiControl is what gets submitted.
+		ApplyPendingText();
+
 	// Handle all non-radio controls:
 	GuiIndexType u;
 	for (u = 0; u < mControlCount; ++u)
@@ -6380,6 +6446,116 @@ ResultType GuiType::Submit(bool aHideIt)
 
 
 
+void GuiType::BeginUpdate()
+// Starts (or nests) a batch of updates to this window's controls.  Until the matching EndUpdate(), the
+// window isn't redrawn and GuiControl queues the new text of text-only controls rather than applying it,
+// so a control updated many times in the batch is set only once.  Redraw is suspended only if the window
+// is visible because WM_SETREDRAW=TRUE would otherwise make a hidden window visible.  Note that while
+// redraw is suspended, the OS considers the window hidden (e.g. for DetectHiddenWindows).
+{
+	if (mUpdateDepth++)
+		return; // Nested, so the outermost BeginUpdate already did the rest.
+	if (!mPendingText)
+		mPendingText = new UpdateQueue; // If this fails, GuiControl will simply apply everything immediately.
+	if (IsWindowVisible(mHwnd))
+	{
+		SendMessage(mHwnd, WM_SETREDRAW, FALSE, 0);
+		mRedrawSuspended = true;
+	}
+}
+
+
+
+void GuiType::EndUpdate()
+// Ends a batch started by BeginUpdate().  Unmatched calls are ignored.
+{
+	if (!mUpdateDepth || --mUpdateDepth)
+		return; // Not in a batch, or the batch is nested so the outermost EndUpdate will do the rest.
+	ApplyPendingText();
+	if (mRedrawSuspended)
+	{
+		mRedrawSuspended = false;
+		SendMessage(mHwnd, WM_SETREDRAW, TRUE, 0);
+		RedrawWindow(mHwnd, NULL, NULL, RDW_ERASE|RDW_FRAME|RDW_INVALIDATE|RDW_ALLCHILDREN);
+	}
+}
+
+
+
+bool GuiType::QueueControlText(GuiIndexType aControlIndex, GuiControlCmds aCmd, char *aText)
+// Queues aText as the new text of the control if it's a type whose text GuiControl would merely set via
+// SetWindowText().  Returns true if it was queued, or false if caller should apply the command itself.
+{
+	if (!mPendingText || (aCmd != GUICONTROL_CMD_CONTENTS && aCmd != GUICONTROL_CMD_TEXT))
+		return false;
+	switch (mControl[aControlIndex].type)
+	{
+	case GUI_CONTROL_TEXT:
+	case GUI_CONTROL_GROUPBOX:
+	case GUI_CONTROL_BUTTON:
+	case GUI_CONTROL_EDIT:
+	case GUI_CONTROL_STATUSBAR:
+		break;
+	case GUI_CONTROL_CHECKBOX:
+	case GUI_CONTROL_RADIO:
+		if (aCmd == GUICONTROL_CMD_TEXT) // For GUICONTROL_CMD_CONTENTS, the text might be a new checked-state instead.
+			break;
+		// Otherwise:
+		return false;
+	default:
+		return false;
+	}
+	return mPendingText->Put(aControlIndex, aText, strlen(aText));
+}
+
+
+
+void GuiType::ApplyPendingText()
+// Applies the text queued by QueueControlText() in the same way GuiControl would have.
+{
+	UpdateQueue *queue = mPendingText;
+	if (!queue || !queue->Count())
+		return;
+	// Detach the queue while it's being applied because SetWindowText() can launch an OnMessage function.
+	// Any GuiControl done by that function is then applied immediately rather than being added to (and
+	// possibly reallocating) the queue that's being iterated below.
+	mPendingText = NULL;
+	char *malloc_buf;
+	RECT rect;
+	for (UINT i = 0; i < queue->Count(); ++i)
+	{
+		PendingUpdate &item = queue->Item(i);
+		GuiControlType &control = mControl[item.key];
+		if (control.type == GUI_CONTROL_EDIT)
+		{
+			// See GuiControl() for comments about this:
+			malloc_buf = (*item.text && (GetWindowLong(control.hwnd, GWL_STYLE) & ES_MULTILINE))
+				? TranslateLFtoCRLF(item.text) : item.text; // Automatic translation, as documented.
+			SetWindowText(control.hwnd, malloc_buf ? malloc_buf : item.text);
+			if (malloc_buf && malloc_buf != item.text)
+				free(malloc_buf);
+			continue;
+		}
+		SetWindowText(control.hwnd, item.text);
+		if (   (control.type == GUI_CONTROL_TEXT || control.type == GUI_CONTROL_GROUPBOX)
+			&& (control.attrib & GUI_CONTROL_ATTRIB_BACKGROUND_TRANS)
+			&& !mRedrawSuspended   ) // Otherwise, EndUpdate() will redraw the whole window anyway.
+		{
+			// See GuiControl() for why this is necessary:
+			GetWindowRect(control.hwnd, &rect);
+			MapWindowPoints(NULL, mHwnd, (LPPOINT)&rect, 2);
+			InvalidateRect(mHwnd, &rect, TRUE);
+		}
+	}
+	queue->Clear();
+	if (mPendingText) // An OnMessage function did "Gui BeginUpdate", which created a new queue.
+		delete queue;
+	else
+		mPendingText = queue;
+}
+
+
+
 VarSizeType GuiType::ControlGetName(GuiIndexType aGuiWindowIndex, GuiIndexType aControlIndex, char *aBuf)
 // Caller has ensured that aGuiWindowIndex is less than MAX_GUI_WINDOWS.
 // We're returning the length of the var's contents, not the size.
@@ -6742,12 +6918,14 @@ ResultType GuiType::ControlGetContents(Var &aOutputVar, GuiControlType &aControl
 
 
 
-GuiIndexType GuiType::FindControl(char *aControlID)
+GuiIndexType GuiType::FindControl(char *aControlID, Var *aGlobalVar)
 // Find the index of the control that matches the string, which can be either:
 // 1) The name of a control's associated output variable.
 // 2) Class+NN
 // 3) Control's title/caption.
 // Returns -1 if not found.
+// If the caller has already resolved aControlID to a global variable, it may pass it as aGlobalVar
+// to avoid the name lookup.  Otherwise aGlobalVar should be NULL.
 {
 	// v1.0.44.08: Added the following check.  Without it, ControlExist() (further below) would retrieve the
 	// topmost child, which isn't very useful or intuitive.  This currently affects only the following commands:
@@ -6764,14 +6942,15 @@ GuiIndexType GuiType::FindControl(char *aControlID)
 	// pointer first, rather than comparing the variable names for a match.  It's further
 	// improved by skipping the first loop entirely when aControlID doesn't exist as a global
 	// variable (GUI controls always have global variables, not locals).
+	// UPDATE: The linear search of the controls for a matching variable has been replaced by a lookup in
+	// mVarIndex, which matters for windows that have hundreds of controls.
 	Var *var;
-	if (var = g_script.FindVar(aControlID, 0, NULL, ALWAYS_USE_GLOBAL)) // First search globals only because for backward compatibility, a GUI control whose Var* is identical to that of a global should be given precedence over a static that matches some other control.  Furthermore, since most GUI variables are global, doing this check before the static check improves avg-case performance.
+	if (var = aGlobalVar ? aGlobalVar : g_script.FindVar(aControlID, 0, NULL, ALWAYS_USE_GLOBAL)) // First search globals only because for backward compatibility, a GUI control whose Var* is identical to that of a global should be given precedence over a static that matches some other control.  Furthermore, since most GUI variables are global, doing this check before the static check improves avg-case performance.
 	{
 		// No need to do "var = var->ResolveAlias()" because the line above never finds locals, only globals.
 		// Similarly, there's no need to do confirm that var->IsLocal()==false.
-		for (u = 0; u < mControlCount; ++u)
-			if (mControl[u].output_var == var)
-				return u;  // Match found.
+		if ((u = FindControlByVar(var)) != -1) // Must compare directly to -1 due to unsigned.
+			return u;  // Match found.
 	}
 	if (g->CurrentFunc // v1.0.46.15: Since above failed to match: if we're in a function (which is checked for performance reasons), search for a static or ByRef-that-points-to-a-global-or-static because both should be supported.
 		&& (var = g_script.FindVar(aControlID, 0, NULL, ALWAYS_USE_LOCAL)))
@@ -6779,24 +6958,98 @@ GuiIndexType GuiType::FindControl(char *aControlID)
 		// No need to do "var = var->ResolveAlias()" because the line above never finds locals, only globals.
 		// Similarly, there's no need to do confirm that var->IsLocal()==false.
 		var = var->ResolveAlias(); // Update it to its target if it's an alias because that's how control-var's are stored (i.e. pre-resolved, never aliases).
-		if (!var->IsNonStaticLocal()) // To be a valid control-var, it must be global, static, or a ByRef that points to a global or static.
-			for (u = 0; u < mControlCount; ++u)
-				if (mControl[u].output_var == var)
-					return u;  // Match found.
+		if (!var->IsNonStaticLocal() // To be a valid control-var, it must be global, static, or a ByRef that points to a global or static.
+			&& (u = FindControlByVar(var)) != -1)
+			return u;  // Match found.
 	}
 	// Otherwise: No match found, so fall back to standard control class and/or text finding method.
 	HWND control_hwnd = ControlExist(mHwnd, aControlID);
 	if (!control_hwnd)
 		return -1; // No match found.
-	for (u = 0; u < mControlCount; ++u)
-		if (mControl[u].hwnd == control_hwnd)
-			return u;  // Match found.
-	// Otherwise: No match found.  At this stage, should be impossible if design is correct.
+	// Since each control's ID is derived from its index, there's no need to search for the HWND.  The check
+	// of hwnd below excludes sub-windows of controls (e.g. a ListView's header), which have their own IDs.
+	u = GUI_HWND_TO_INDEX(control_hwnd); // Retrieves a small negative on failure, which will be out of bounds when converted to unsigned.
+	if (u < mControlCount && mControl[u].hwnd == control_hwnd)
+		return u;  // Match found.
+	// Otherwise: No match found, such as when ControlExist() found a sub-window of a control.
 	return -1;
 }
 
 
 
+#define GUI_VAR_INDEX_MIN_SIZE 64 // Must be a power of two.
+
+static inline GuiIndexType GuiVarHash(Var *aVar)
+{
+	// Vars are allocated from SimpleHeap at small, regular intervals, so discard the alignment bits and
+	// spread the rest so that consecutive vars don't pile up in consecutive slots.
+	UINT hash = (UINT)((size_t)aVar >> 3) * 2654435761U; // Knuth's multiplicative constant.
+	return hash ^ (hash >> 16);
+}
+
+
+
+GuiIndexType GuiType::FindControlByVar(Var *aVar)
+// Returns the index of the control whose output_var is aVar, or -1 if none.  Caller must have resolved
+// any alias, since that's how control-vars are stored.
+{
+	if (mVarIndexIsStale)
+		VarIndexRebuild();
+	GuiIndexType u;
+	if (!mVarIndex) // Out of memory, so fall back to a linear search.
+	{
+		for (u = 0; u < mControlCount; ++u)
+			if (mControl[u].output_var == aVar)
+				return u;  // Match found.
+		return -1;
+	}
+	GuiIndexType mask = mVarIndexSize - 1;
+	for (GuiIndexType i = GuiVarHash(aVar) & mask; u = mVarIndex[i]; i = (i + 1) & mask)
+		if (mControl[u - 1].output_var == aVar)
+			return u - 1;  // Match found.
+	return -1;
+}
+
+
+
+void GuiType::VarIndexInsert(GuiIndexType aControlIndex)
+// Caller must have ensured that the index is not stale and has room for another entry.
+// Since the same variable cannot be used by more than one control of a window, there's no
+// need to check for a duplicate.
+{
+	GuiIndexType mask = mVarIndexSize - 1;
+	GuiIndexType i;
+	for (i = GuiVarHash(mControl[aControlIndex].output_var) & mask; mVarIndex[i]; i = (i + 1) & mask);
+	mVarIndex[i] = aControlIndex + 1;
+}
+
+
+
+void GuiType::VarIndexRebuild()
+// Rebuilds mVarIndex from scratch, enlarging it so that it's never more than half full.  Controls
+// can't be removed individually and their variables change rarely, so rebuilding is infrequent.
+{
+	GuiIndexType size;
+	for (size = GUI_VAR_INDEX_MIN_SIZE; size < mControlCount * 2; size <<= 1);
+	if (size != mVarIndexSize)
+	{
+		free(mVarIndex);
+		if (   !(mVarIndex = (GuiIndexType *)malloc(size * sizeof(GuiIndexType)))   )
+		{
+			mVarIndexSize = 0;
+			return; // Leave it stale so that it's retried next time; callers fall back to a linear search.
+		}
+		mVarIndexSize = size;
+	}
+	ZeroMemory(mVarIndex, size * sizeof(GuiIndexType));
+	for (GuiIndexType u = 0; u < mControlCount; ++u)
+		if (mControl[u].output_var)
+			VarIndexInsert(u);
+	mVarIndexIsStale = false;
+}
+
+
+
 int GuiType::FindGroup(GuiIndexType aControlIndex, GuiIndexType &aGroupStart, GuiIndexType &aGroupEnd)
 // Caller must provide a valid aControlIndex for an existing control.
 // Returns the number of radio buttons inside the group. In addition, it provides start and end
@@ -7261,8 +7514,67 @@ LRESULT CALLBACK GuiWindowProc(HWND hWnd, UINT iMsg, WPARAM wParam, LPARAM lPara
 			case LVN_DELETEITEM: // Might be received for each individual (non-DeleteAll) deletion).
 			case LVN_GETINFOTIPW: // v1.0.44: Received even without LVS_EX_INFOTIP?. In any case, there's currently no point
 			case LVN_GETINFOTIPA: // in notifying the script because it would have no means of changing the tip (by altering the struct), except perhaps OnMessage.
+			case LVN_ODCACHEHINT: // Virtual ListView: Nothing needs to be prepared in advance since all rows are in memory.
 				return 0; // Return immediately to avoid calling Event() and DefDlgProc(). A return value of 0 is suitable for all of the above.
 
+			// A virtual ListView asks for the text of each cell it's about to display.  As with LVM_GETITEMW,
+			// the W version might be received even though this is an ANSI window.  Testing of the
+			// LVITEM vs. LVITEMW issue is the same as described in LV_GeneralSort().
+			case LVN_GETDISPINFOA:
+			case LVN_GETDISPINFOW:
+			{
+				LVITEM &item = ((NMLVDISPINFO *)lParam)->item;
+				if (control.union_lv_attrib->store && (item.mask & LVIF_TEXT) && item.cchTextMax > 0)
+				{
+					const char *text = control.union_lv_attrib->store->GetText(item.iItem, item.iSubItem);
+					if (!text) // Row doesn't exist, which can happen briefly while rows are being deleted.
+						text = "";
+					if (nmhdr.code == LVN_GETDISPINFOW)
+					{
+						if (!ToWideChar(text, (LPWSTR)item.pszText, item.cchTextMax)) // Text too long, so show as much as fits.
+							((LPWSTR)item.pszText)[item.cchTextMax - 1] = 0;
+					}
+					else
+						strlcpy(item.pszText, text, item.cchTextMax);
+				}
+				return 0;
+			}
+
+			// Virtual ListView: The user typed the first few letters of a row's first field.  As with
+			// LVN_GETDISPINFO, the W version might be received even though this is an ANSI window.
+			case LVN_ODFINDITEMA:
+			case LVN_ODFINDITEMW:
+			{
+				ListViewStore *store = control.union_lv_attrib->store;
+				NMLVFINDITEM &nmfi = *(NMLVFINDITEM *)lParam; // NMLVFINDITEMW differs only in the type of lvfi.psz.
+				if (!store || !(nmfi.lvfi.flags & (LVFI_STRING | LVFI_PARTIAL)) || !nmfi.lvfi.psz)
+					return -1; // Not found.
+				char find_buf[LV_TEXT_BUF_SIZE];
+				LPCSTR find_text = nmfi.lvfi.psz;
+				if (nmhdr.code == LVN_ODFINDITEMW)
+				{
+					if (!WideCharToMultiByte(CP_ACP, 0, (LPCWSTR)nmfi.lvfi.psz, -1, find_buf, sizeof(find_buf), NULL, NULL))
+						find_buf[sizeof(find_buf) - 1] = '\0'; // Text too long, so search for as much as fits.
+					find_text = find_buf;
+				}
+				size_t find_length = strlen(find_text);
+				int row_count = store->Count();
+				int row = (nmfi.iStart > 0 && nmfi.iStart < row_count) ? nmfi.iStart : 0;
+				for (int i = 0; i < row_count; ++i, ++row)
+				{
+					if (row >= row_count)
+					{
+						if (!(nmfi.lvfi.flags & LVFI_WRAP))
+							break;
+						row = 0;
+					}
+					if (!((nmfi.lvfi.flags & LVFI_PARTIAL) ? strnicmp(store->GetText(row, 0), find_text, find_length)
+						: stricmp(store->GetText(row, 0), find_text)))
+						return row;
+				}
+				return -1;
+			}
+
 			case 0xFFFFFF4F: // Couldn't find these in commctrl.h anywhere. They seem to occur when control is first created and once for each row in the first set of added rows.
 			case 0xFFFFFF5F:
 			case 0xFFFFFF5D: // Probably something to do with incremental search since it seems to happen only when items are present and the user types a visible-character key.
@@ -8674,7 +8986,9 @@ void GuiType::ControlSetListViewOptions(GuiControlType &aControl, GuiControlOpti
 {
 	if (aOpt.limit)
 	{
-		if (ListView_GetItemCount(aControl.hwnd) > 0)
+		if (aControl.union_lv_attrib->store) // LVM_SETITEMCOUNT would set the actual number of rows of a virtual ListView.
+			aControl.union_lv_attrib->store->Reserve(aOpt.limit);
+		else if (ListView_GetItemCount(aControl.hwnd) > 0)
 			SendMessage(aControl.hwnd, LVM_SETITEMCOUNT, aOpt.limit, 0); // Last parameter should be 0 for LVS_OWNERDATA (verified if you look at the definition of ListView_SetItemCount macro).
 		else
 			// When the control has no rows, work around the fact that LVM_SETITEMCOUNT delivers less than 20%
@@ -9355,6 +9669,172 @@ int CALLBACK LV_Int32Sort(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
 
 
 
+static int LV_CompareKeyStr(const void *aKey1, const void *aKey2, void *aParam)
+{
+	return strcmp((const char *)aKey1, (const char *)aKey2);
+}
+
+static int LV_CompareKeyStrLocale(const void *aKey1, const void *aKey2, void *aParam)
+{
+	return lstrcmpi((LPCSTR)aKey1, (LPCSTR)aKey2);
+}
+
+static int LV_CompareKeyStrLogical(const void *aKey1, const void *aKey2, void *aParam)
+{
+	return g_StrCmpLogicalW((LPCWSTR)aKey1, (LPCWSTR)aKey2);
+}
+
+
+
+static bool LV_SortByKeys(GuiControlType &aControl, int aColumnIndex, lv_col_type &aCol, int aRowCount, bool aAscending)
+// Sorts the rows of aControl by the specified column.  Rather than having the sort fetch and convert each row's
+// text every time it compares two rows, each row's key (its text converted to a number, or a copy of its text in
+// the form that's quickest to compare) is extracted exactly once.  An array of row numbers is then sorted by
+// those keys (see lvsort.h), and finally the new order is applied to the control all at once.
+// For a virtual ListView, aRowCount is the number of rows in storage (including any hidden by a filter).
+// Caller has ensured that g_StrCmpLogicalW isn't NULL if the column uses SCS_INSENSITIVE_LOGICAL.
+// Returns false if there isn't enough memory, in which case the rows are left as they were.
+{
+	ListViewStore *store = aControl.union_lv_attrib->store;
+	bool is_text = aCol.type == LV_COL_TEXT;
+	bool is_logical = is_text && aCol.case_sensitive == SCS_INSENSITIVE_LOGICAL;
+	int *index = (int *)malloc(aRowCount * sizeof(int));
+	// Integer and float keys are both 8 bytes.  Text keys are pointers into text_buf:
+	void *key = malloc(aRowCount * (is_text ? sizeof(void *) : 8));
+	size_t text_buf_size = is_text ? aRowCount * 16 : 0; // Initial estimate; it's expanded as needed.
+	char *text_buf = is_text ? (char *)malloc(text_buf_size) : NULL;
+	if (!index || !key || is_text && !text_buf)
+	{
+		free(index);
+		free(key);
+		free(text_buf);
+		return false;
+	}
+
+	// Extract the keys.  As in LV_GeneralSort(), the logical method uses LVM_GETITEMW to have the control
+	// convert its ANSI text to Unicode.
+	char buf[LV_TEXT_BUF_SIZE];
+	WCHAR wbuf[LV_TEXT_BUF_SIZE];
+	LVITEM lvi;
+	lvi.mask = LVIF_TEXT;
+	lvi.iSubItem = aColumnIndex;
+	lvi.cchTextMax = LV_TEXT_BUF_SIZE - 1; // buf and wbuf hold the same number of characters.  See LV_Sort() for why 1 is subtracted.
+	UINT msg_lvm_getitem = is_logical ? LVM_GETITEMW : LVM_GETITEM;
+	size_t text_buf_length = 0, key_size;
+	const char *text;
+	int row;
+	for (row = 0; row < aRowCount; ++row)
+	{
+		index[row] = row;
+		if (store)
+		{
+			text = store->GetStoredText(row, aColumnIndex); // Never NULL since row is in range.
+			if (is_logical && !ToWideChar(text, wbuf, LV_TEXT_BUF_SIZE)) // Text too long, so use as much as fits.
+				wbuf[LV_TEXT_BUF_SIZE - 1] = 0;
+		}
+		else
+		{
+			lvi.iItem = row;
+			lvi.pszText = is_logical ? (LPSTR)wbuf : buf;
+			if (!SendMessage(aControl.hwnd, msg_lvm_getitem, 0, (LPARAM)&lvi))
+			{
+				*buf = '\0';
+				*wbuf = 0;
+				lvi.pszText = is_logical ? (LPSTR)wbuf : buf;
+			}
+			// Must use lvi.pszText vs. buf because the control might have changed it to point to its own copy
+			// of the text (see LV_GeneralSort()).
+			text = lvi.pszText;
+		}
+		if (!is_text)
+		{
+			// Unlike LV_Int32Sort(), the full 64-bit range is supported.  See LV_GeneralSort() for why atof()
+			// is used vs. ATOF().
+			if (aCol.type == LV_COL_INTEGER)
+				((SortInt64Type *)key)[row] = ATOI64(text);
+			else
+				((double *)key)[row] = atof(text);
+			continue;
+		}
+		key_size = is_logical ? (wcslen(store ? wbuf : (LPCWSTR)text) + 1) * sizeof(WCHAR) : strlen(text) + 1;
+		if (text_buf_length + key_size > text_buf_size)
+		{
+			size_t new_size = text_buf_size * 2 + key_size;
+			char *new_buf = (char *)realloc(text_buf, new_size);
+			if (!new_buf)
+			{
+				free(index);
+				free(key);
+				free(text_buf);
+				return false;
+			}
+			text_buf = new_buf;
+			text_buf_size = new_size;
+		}
+		char *dest = text_buf + text_buf_length;
+		if (is_logical)
+			memcpy(dest, store ? (char *)wbuf : text, key_size);
+		else if (aCol.case_sensitive == SCS_INSENSITIVE)
+		{
+			// Fold to lowercase in advance so that strcmp() can be used to compare them.  Only A-Z are folded
+			// to produce the same order as stricmp(), which is what this mode uses elsewhere.
+			for (const char *cp = text; ; ++cp, ++dest)
+			{
+				*dest = (*cp >= 'A' && *cp <= 'Z') ? *cp + ('a' - 'A') : *cp;
+				if (!*cp)
+					break;
+			}
+		}
+		else
+			memcpy(dest, text, key_size);
+		((size_t *)key)[row] = text_buf_length; // An offset for now, since text_buf might be moved by realloc().
+		text_buf_length += (key_size + 1) & ~(size_t)1; // Keep each key aligned for WCHAR.
+	}
+	if (is_text) // Convert the offsets into pointers now that text_buf is in its final location.
+		for (row = 0; row < aRowCount; ++row)
+			((const void **)key)[row] = text_buf + ((size_t *)key)[row];
+
+	bool result;
+	if (aCol.type == LV_COL_INTEGER)
+		result = SortIndexByInt64(index, aRowCount, (SortInt64Type *)key, aAscending);
+	else if (aCol.type == LV_COL_FLOAT)
+		result = SortIndexByDouble(index, aRowCount, (double *)key, aAscending);
+	else
+		result = SortIndexByKey(index, aRowCount, (const void **)key
+			, is_logical ? LV_CompareKeyStrLogical
+			: (aCol.case_sensitive == SCS_INSENSITIVE_LOCALE ? LV_CompareKeyStrLocale : LV_CompareKeyStr)
+			, NULL, aAscending);
+	free(key);
+	free(text_buf);
+
+	if (result)
+	{
+		// Apply the new order.  For a non-virtual ListView, each row's lParam is set to its new position,
+		// then the control is told to sort by lParam, which requires no further fetching of text.
+		if (store)
+		{
+			if (result = store->Reorder(index))
+				GuiType::LV_RefreshVirtual(aControl);
+		}
+		else
+		{
+			lvi.mask = LVIF_PARAM;
+			lvi.iSubItem = 0; // Indicate that an item vs. subitem is being operated on (subitems can't have an lParam).
+			for (row = 0; row < aRowCount; ++row)
+			{
+				lvi.iItem = index[row];
+				lvi.lParam = row;
+				ListView_SetItem(aControl.hwnd, &lvi);
+			}
+			SendMessage(aControl.hwnd, LVM_SORTITEMS, TRUE, (LPARAM)LV_Int32Sort); // TRUE = ascending order of lParam.
+		}
+	}
+	free(index);
+	return result;
+}
+
+
+
 void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnlyIfEnabled, char aForceDirection)
 // aForceDirection should be 'A' to force ascending, 'D' to force ascending, or '\0' to use the column's
 // current default direction.
@@ -9364,7 +9844,8 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 	lv_attrib_type &lv_attrib = *aControl.union_lv_attrib;
 	lv_col_type &col = lv_attrib.col[aColumnIndex];
 
-	int item_count = ListView_GetItemCount(aControl.hwnd);
+	// For a virtual ListView, count the rows in storage because those hidden by a filter get sorted too:
+	int item_count = lv_attrib.store ? lv_attrib.store->TotalCount() : ListView_GetItemCount(aControl.hwnd);
 	if ((col.sort_disabled && aSortOnlyIfEnabled) || item_count < 2) // This column cannot be sorted or doesn't need to be.
 		return; // Below relies on having returned here when control is empty or contains 1 item.
 
@@ -9383,7 +9864,28 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 	lvs.lvi.pszText = lvs.buf1;
 	lvs.lvi.cchTextMax = LV_TEXT_BUF_SIZE - 1; // Set default. Subtracts 1 because of that nagging doubt about size vs. length. Some MSDN examples subtract one, such as TabCtrl_GetItem()'s cchTextMax.
 
-	if (col.type == LV_COL_INTEGER)
+	if (col.type == LV_COL_TEXT && col.case_sensitive == SCS_INSENSITIVE_LOGICAL) // SCS_INSENSITIVE_LOGICAL can be in effect even when type isn't LV_COL_TEXT because it allows a column to be later changed to TEXT and retain its "logical-sort" setting.
+	{
+		// v1.0.44.12: Support logical sorting, which treats numeric strings as true numbers like Windows XP
+		// Explorer's sorting.  This is done here rather than in LV_ModifyCol() because it seems more
+		// maintainable/robust (plus LV_SortByKeys() and LV_GeneralSort() rely on us to do this check).
+		if (!g_StrCmpLogicalW)
+		{
+			HINSTANCE hinstLib;
+			if (hinstLib = LoadLibrary("shlwapi")) // For code simplicity and performance-upon-reuse, once loaded it is never freed.
+				g_StrCmpLogicalW = (StrCmpLogicalW_type)GetProcAddress(hinstLib, "StrCmpLogicalW");
+		}
+		if (!g_StrCmpLogicalW) // Generally, this happens only if OS is older than XP. But OS version isn't checked in case it's possible for older OSes/emultators to ever have StrCmpLogicalW().
+			col.case_sensitive = SCS_INSENSITIVE_LOCALE; // The sorting functions rely on this fallback.  Also, it falls back to the LOCALE method because it is the closest match to LOGICAL (since testing shows that StrCmpLogicalW seems to use the user's locale).
+	}
+
+	// The methods further below are used only when there isn't enough memory to hold the keys.  They're
+	// much slower because they fetch the text of two rows every time the sort compares them.
+	if (LV_SortByKeys(aControl, aColumnIndex, col, item_count, lvs.sort_ascending))
+		; // Nothing more to do.
+	else if (lv_attrib.store) // A virtual ListView can't be sorted by the methods below.
+		return;
+	else if (col.type == LV_COL_INTEGER)
 	{
 		// Testing indicates that the following approach is 25 times faster than the general-sort method.
 		// Assign the 32-bit integer as the items lParam at this early stage rather than getting the text
@@ -9404,22 +9906,8 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 	}
 	else // It's LV_COL_TEXT or LV_COL_FLOAT.
 	{
-		if (col.type == LV_COL_TEXT && col.case_sensitive == SCS_INSENSITIVE_LOGICAL) // SCS_INSENSITIVE_LOGICAL can be in effect even when type isn't LV_COL_TEXT because it allows a column to be later changed to TEXT and retain its "logical-sort" setting.
-		{
-			// v1.0.44.12: Support logical sorting, which treats numeric strings as true numbers like Windows XP
-			// Explorer's sorting.  This is done here rather than in LV_ModifyCol() because it seems more
-			// maintainable/robust (plus LV_GeneralSort() relies on us to do this check).
-			if (!g_StrCmpLogicalW)
-			{
-				HINSTANCE hinstLib;
-				if (hinstLib = LoadLibrary("shlwapi")) // For code simplicity and performance-upon-reuse, once loaded it is never freed.
-					g_StrCmpLogicalW = (StrCmpLogicalW_type)GetProcAddress(hinstLib, "StrCmpLogicalW");
-			}
-			if (g_StrCmpLogicalW) // Generally, this happens only if OS is older than XP. But OS version isn't checked in case it's possible for older OSes/emultators to ever have StrCmpLogicalW().
-				lvs.lvi.cchTextMax = lvs.lvi.cchTextMax/2 - 1; // Buffer can hold only half as many Unicode characters as non-Unicode (subtract 1 for the extra-wide NULL terminator).
-			else
-				col.case_sensitive = SCS_INSENSITIVE_LOCALE; // LV_GeneralSort() relies on this fallback.  Also, it falls back to the LOCALE method because it is the closest match to LOGICAL (since testing shows that StrCmpLogicalW seems to use the user's locale).
-		}
+		if (col.type == LV_COL_TEXT && col.case_sensitive == SCS_INSENSITIVE_LOGICAL) // Above has ensured that g_StrCmpLogicalW isn't NULL in this case.
+			lvs.lvi.cchTextMax = lvs.lvi.cchTextMax/2 - 1; // Buffer can hold only half as many Unicode characters as non-Unicode (subtract 1 for the extra-wide NULL terminator).
 		// Since LVM_SORTITEMSEX requires comctl32.dll version 5.80+, the non-Ex version is used
 		// whenever the EX version fails to work.  One reason to strongly prefer the Ex version
 		// is that MSDN says the non-Ex version shouldn't query the control during the sort,
@@ -9464,6 +9952,18 @@ void GuiType::LV_Sort(GuiControlType &aControl, int aColumnIndex, bool aSortOnly
 
 
 
+void GuiType::LV_RefreshVirtual(GuiControlType &aControl)
+// Caller has ensured that aControl is a virtual ListView.  Updates the control after its rows have been
+// reordered or filtered.  Since the rows no longer correspond to their former positions, any selection is
+// removed rather than leaving it on rows that merely happen to occupy the same positions.
+{
+	SendMessage(aControl.hwnd, LVM_SETITEMCOUNT, aControl.union_lv_attrib->store->Count(), 0);
+	ListView_SetItemState(aControl.hwnd, -1, 0, LVIS_SELECTED);
+	InvalidateRect(aControl.hwnd, NULL, FALSE);
+}
+
+
+
 DWORD GuiType::ControlGetListViewMode(HWND aWnd)
 // Caller has ensured that aWnd is non-NULL and a valid ListView control.
 // Returns one of the following:
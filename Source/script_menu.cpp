@@ -279,13 +279,7 @@ ResultType Script::PerformMenu(char *aMenu, char *aCommand, char *aParam3, char
 	if (!*aParam3)
 		RETURN_MENU_ERROR("Parameter #3 must not be blank in this case.", "");
 
-	// Find the menu item name AND its previous item (needed for the DELETE command) in the linked list:
-	UserMenuItem *mi, *menu_item = NULL, *menu_item_prev = NULL; // Set defaults.
-	for (menu_item = menu->mFirstMenuItem
-		; menu_item
-		; menu_item_prev = menu_item, menu_item = menu_item->mNextMenuItem)
-		if (!lstrcmpi(menu_item->mName, aParam3)) // Match found (case insensitive).
-			break;
+	UserMenuItem *menu_item = menu->FindItem(aParam3);
 
 	// Whether an existing menu item's options should be updated without updating its submenu or label:
 	bool update_exiting_item_options = (menu_command == MENU_CMD_ADD && menu_item && !*aParam4 && *aOptions);
@@ -347,33 +341,20 @@ ResultType Script::PerformMenu(char *aMenu, char *aCommand, char *aParam3, char
 		// delete code, however, and it would reduce the overall maintainability.  So it definitely
 		// doesn't seem worth it, especially since Windows XP seems to have trouble even displaying
 		// menus larger than around 15000-25000 items.
+		// Update: Whether an ID is in use is now a lookup in mMenuItemByID rather than a search of every
+		// menu, so the cost of each ID checked no longer depends on the number of menu items.
 		static UINT sLastFreeID = ID_USER_FIRST - 1;
 		// Increment by one for each new search, both due to the above line and because the
 		// last-found free ID has a high likelyhood of still being in use:
 		++sLastFreeID;
 		bool id_in_use;
-		UserMenu *m;
 		// Note that the i variable is used to force the loop to complete exactly one full
 		// circuit through all available IDs, regardless of where the starting/cached value:
 		for (int i = 0; i < (ID_USER_LAST - ID_USER_FIRST + 1); ++i, ++sLastFreeID) // FOR EACH ID
 		{
 			if (sLastFreeID > ID_USER_LAST)
 				sLastFreeID = ID_USER_FIRST;  // Wrap around to the beginning so that one complete circuit is made.
-			id_in_use = false;  // Reset the default each iteration (overridden if the below finds a match).
-			for (m = mFirstMenu; m; m = m->mNextMenu) // FOR EACH MENU
-			{
-				for (mi = m->mFirstMenuItem; mi; mi = mi->mNextMenuItem) // FOR EACH MENU ITEM
-				{
-					if (mi->mMenuID == sLastFreeID)
-					{
-						id_in_use = true;
-						break;
-					}
-				}
-				if (id_in_use) // No point in searching the other menus, since it's now known to be in use.
-					break;
-			}
-			if (!id_in_use) // Break before the loop increments sLastFreeID.
+			if (   !(id_in_use = (FindMenuItemByID(sLastFreeID) != NULL))   ) // Break before the loop increments sLastFreeID.
 				break;
 		}
 		if (id_in_use) // All ~64000 IDs are in use!
@@ -414,6 +395,14 @@ ResultType Script::PerformMenu(char *aMenu, char *aCommand, char *aParam3, char
 	case MENU_CMD_DEFAULT:
 		return menu->SetDefault(menu_item);
 	case MENU_CMD_DELETE:
+		// Find the item's predecessor, which DeleteItem() needs to unlink it.  This search is no worse
+		// than the one RemoveMenu() does to find the item in the OS menu:
+		UserMenuItem *menu_item_prev;
+		if (menu_item == menu->mFirstMenuItem)
+			menu_item_prev = NULL;
+		else
+			for (menu_item_prev = menu->mFirstMenuItem; menu_item_prev->mNextMenuItem != menu_item
+				; menu_item_prev = menu_item_prev->mNextMenuItem);
 		return menu->DeleteItem(menu_item, menu_item_prev);
 	} // switch()
 	return FAIL;  // Should never be reached, but avoids compiler warning and improves bug detection.
@@ -500,7 +489,13 @@ ResultType Script::ScriptDeleteMenu(UserMenu *aMenu)
 		mFirstMenu = aMenu->mNextMenu; // Can be NULL if the list will now be empty.
 	// Do this last when its contents are no longer needed.  Its destructor will delete all
 	// the items in the menu and destroy the OS menu itself:
-	aMenu->DeleteAllItems(); // This also calls Destroy() to free the menu's resources.
+	if (!aMenu->DeleteAllItems()) // This also calls Destroy() to free the menu's resources.
+	{
+		// The items are abandoned along with the menu, so make their IDs available for reuse
+		// as they were before IDs were indexed:
+		for (mi = aMenu->mFirstMenuItem; mi; mi = mi->mNextMenuItem)
+			ReleaseMenuItemID(mi->mMenuID);
+	}
 	if (aMenu->mBrush) // Free the brush used for the menu's background color.
 		DeleteObject(aMenu->mBrush);
 	delete aMenu->mName; // Since it was separately allocated.
@@ -511,6 +506,77 @@ ResultType Script::ScriptDeleteMenu(UserMenu *aMenu)
 
 
 
+UserMenuItem **Script::MenuItemIDSlot(UINT aID)
+// Returns the address of aID's entry in mMenuItemByID, allocating its page if necessary.  Returns NULL if
+// aID is out of range or if out of memory.
+{
+	if (aID < ID_USER_FIRST || aID > ID_USER_LAST)
+		return NULL;
+	aID -= ID_USER_FIRST;
+	UserMenuItem **&page = mMenuItemByID[aID / MENU_ID_PAGE_SIZE];
+	if (!page)
+	{
+		if (   !(page = new UserMenuItem *[MENU_ID_PAGE_SIZE])   )
+			return NULL;
+		ZeroMemory(page, MENU_ID_PAGE_SIZE * sizeof(UserMenuItem *));
+	}
+	return page + aID % MENU_ID_PAGE_SIZE;
+}
+
+
+
+static bool MenuItemNameMatches(UserMenuItem *aMenuItem, const char *aName)
+{
+	return !lstrcmpi(aMenuItem->mName, aName); // Case insensitive.
+}
+
+
+
+UserMenuItem *UserMenu::FindItem(char *aName)
+// Returns the item whose name matches aName (case insensitive), or NULL if none.
+{
+	UserMenuItem *mi;
+	if (mNameIndex.Find(aName, MenuItemNameMatches, mi))
+		return mi;
+	// Otherwise, the menu is short, or aName or one of the items' names can't be indexed, so search the list:
+	for (mi = mFirstMenuItem; mi; mi = mi->mNextMenuItem)
+		if (!lstrcmpi(mi->mName, aName)) // Match found (case insensitive).
+			return mi;
+	return NULL;
+}
+
+
+
+void UserMenu::IndexName(UserMenuItem *aMenuItem)
+// Adds aMenuItem to the name index under its current name.  Separators aren't indexed.
+{
+	if (*aMenuItem->mName)
+		mNameIndex.Add(aMenuItem, aMenuItem->mName);
+}
+
+
+
+void UserMenu::UnindexName(UserMenuItem *aMenuItem)
+// Reverses IndexName().  Caller must call it before changing the item's name.
+{
+	if (*aMenuItem->mName)
+		mNameIndex.Remove(aMenuItem, aMenuItem->mName);
+}
+
+
+
+void UserMenu::BuildNameIndex()
+// Creates the name index and adds every item to it.  If there isn't enough memory, the list will continue
+// to be searched instead, and AddItem() will try again the next time an item is added.
+{
+	if (!mNameIndex.Create())
+		return;
+	for (UserMenuItem *mi = mFirstMenuItem; mi; mi = mi->mNextMenuItem)
+		IndexName(mi);
+}
+
+
+
 // Macros for use with the below methods:
 #define aMenuItem_ID (aMenuItem->mSubmenu ? GetSubmenuPos(aMenuItem->mSubmenu->mMenu) : aMenuItem->mMenuID)
 #define aMenuItem_MF_BY (aMenuItem->mSubmenu ? MF_BYPOSITION : MF_BYCOMMAND)
@@ -556,6 +622,9 @@ ResultType UserMenu::AddItem(char *aName, UINT aMenuID, Label *aLabel, UserMenu
 	size_t length = strlen(aName);
 	if (length > MAX_MENU_NAME_LENGTH)
 		return FAIL;  // Caller should show error if desired.
+	UserMenuItem **id_slot = NULL;
+	if (aMenuID && !(id_slot = g_script.MenuItemIDSlot(aMenuID))) // Done first so that there's nothing to undo if it fails.
+		return FAIL;  // Caller should show error if desired.
 	// After mem is allocated, the object takes charge of its later deletion:
 	char *name_dynamic;
 	if (length)
@@ -582,6 +651,12 @@ ResultType UserMenu::AddItem(char *aName, UINT aMenuID, Label *aLabel, UserMenu
 		mLastMenuItem = menu_item;
 	}
 	++mMenuItemCount;  // Only after memory has been successfully allocated.
+	if (id_slot)
+		*id_slot = menu_item;
+	if (mNameIndex.IsCreated())
+		IndexName(menu_item); // The index grows as needed.
+	else if (mMenuItemCount >= MENU_NAME_INDEX_MIN_ITEMS)
+		BuildNameIndex(); // This includes menu_item.
 	if (*aOptions)
 		UpdateOptions(menu_item, aOptions);
 	return OK;
@@ -617,8 +692,23 @@ ResultType UserMenu::DeleteItem(UserMenuItem *aMenuItem, UserMenuItem *aMenuItem
 	else // aMenuItem was the first one in the list.
 		mFirstMenuItem = aMenuItem->mNextMenuItem; // Can be NULL if the list will now be empty.
 	CHANGE_DEFAULT_IF_NEEDED  // Should do this before freeing aMenuItem's memory.
+	if (mStandardItemsPos) // Keep track of how many user-defined items precede the standard items.
+	{
+		// Since aMenuItem is no longer in the list, find its position by counting up to aMenuItemPrev:
+		UINT pos = 0;
+		for (UserMenuItem *mi = aMenuItemPrev ? mFirstMenuItem : NULL; mi && pos < mStandardItemsPos; mi = mi->mNextMenuItem)
+		{
+			++pos;
+			if (mi == aMenuItemPrev)
+				break;
+		}
+		if (pos < mStandardItemsPos)
+			--mStandardItemsPos;
+	}
 	if (mMenu) // Delete the item from the menu.
 		RemoveMenu(mMenu, aMenuItem_ID, aMenuItem_MF_BY); // v1.0.48: Lexikos: DeleteMenu() destroys any sub-menu handle associated with the item, so use RemoveMenu. Otherwise the submenu handle stored somewhere else in memory would suddenly become invalid.
+	UnindexName(aMenuItem);
+	g_script.ReleaseMenuItemID(aMenuItem->mMenuID);
 	if (aMenuItem->mName != Var::sEmptyString)
 		delete aMenuItem->mName; // Since it was separately allocated.
 	delete aMenuItem; // Do this last when its contents are no longer needed.
@@ -653,12 +743,15 @@ ResultType UserMenu::DeleteAllItems()
 	{
 		menu_item_to_delete = mi;
 		mi = mi->mNextMenuItem;
+		g_script.ReleaseMenuItemID(menu_item_to_delete->mMenuID);
 		if (menu_item_to_delete->mName != Var::sEmptyString)
 			delete menu_item_to_delete->mName; // Since it was separately allocated.
 		delete menu_item_to_delete;
 	}
 	mFirstMenuItem = mLastMenuItem = NULL;
 	mMenuItemCount = 0;
+	mStandardItemsPos = 0;
+	mNameIndex.Free();
 	mDefault = NULL;  // i.e. there can't be a *user-defined* default item anymore, even if this is the tray.
 	return OK;
 }
@@ -756,9 +849,8 @@ ResultType UserMenu::RenameItem(UserMenuItem *aMenuItem, char *aNewName)
 	if (*aNewName)
 	{
 		// Names must be unique only within each menu:
-		for (UserMenuItem *mi = mFirstMenuItem; mi; mi = mi->mNextMenuItem)
-			if (!lstrcmpi(mi->mName, aNewName)) // Match found (case insensitive).
-				return FAIL; // Caller should display an error message.
+		if (FindItem(aNewName))
+			return FAIL; // Caller should display an error message.
 		mii.fType = MFT_STRING;
 	}
 	else // converting into a separator
@@ -785,6 +877,7 @@ ResultType UserMenu::RenameItem(UserMenuItem *aMenuItem, char *aNewName)
 ResultType UserMenu::UpdateName(UserMenuItem *aMenuItem, char *aNewName)
 // Caller should already have ensured that aMenuItem is not too long.
 {
+	UnindexName(aMenuItem); // Must be done while mName still has its old value.
 	size_t new_length = strlen(aNewName);
 	if (new_length)
 	{
@@ -794,7 +887,10 @@ ResultType UserMenu::UpdateName(UserMenuItem *aMenuItem, char *aNewName)
 			// This also retains the original menu name if the allocation fails:
 			char *temp = new char[new_length + 1];  // +1 for terminator.
 			if (!temp)
+			{
+				IndexName(aMenuItem);
 				return FAIL;
+			}
 			// Otherwise:
 			if (aMenuItem->mName != Var::sEmptyString) // Since it was previously new'd, delete it.
 				delete aMenuItem->mName;
@@ -806,8 +902,10 @@ ResultType UserMenu::UpdateName(UserMenuItem *aMenuItem, char *aNewName)
 	else // It will become a separator.
 	{
 		*aMenuItem->mName = '\0'; // Safe because even if it's capacity is 1 byte, it's a writable byte.
+		g_script.ReleaseMenuItemID(aMenuItem->mMenuID);
 		aMenuItem->mMenuID = 0; // Free up an ID since separators currently can't be converted back into items.
 	}
+	IndexName(aMenuItem);
 	return OK;
 }
 
@@ -966,6 +1064,7 @@ ResultType UserMenu::Create(MenuTypeType aMenuType)
 		return FAIL;
 
 	mMenuType = aMenuType;  // We have to track its type since I don't think there's any way to find out via API.
+	mStandardItemsPos = 0;
 
 	// It seems best not to have a mandatory EXIT item added to the bottom of the tray menu
 	// for these reasons:
@@ -1068,6 +1167,10 @@ ResultType UserMenu::AppendStandardItems()
 	mIncludeStandardItems = true; // even if the menu doesn't exist.
 	if (!mMenu)
 		return OK;
+	// Since the standard items aren't there yet, any items already in the menu are user-defined.  There are
+	// none if the menu is being created, but otherwise the standard items go after them (see GetItemPos()):
+	int menu_item_count = GetMenuItemCount(mMenu);
+	mStandardItemsPos = menu_item_count > 0 ? menu_item_count : 0;
 #ifdef AUTOHOTKEYSC
 	if (g_AllowMainWindow)
 	{
@@ -1352,6 +1455,22 @@ UINT UserMenu::GetItemPos(char *aMenuItemName)
 		return UINT_MAX;
 	int menu_item_count = GetMenuItemCount(mMenu);
 	char buf[MAX_MENU_NAME_LENGTH + 2];  // +2 due to uncertainty over whether GetMenuString()'s nMaxCount includes room for terminator.
+	// The user-defined items are in the OS menu in the same order as they are in the list, with the standard
+	// items (if any) inserted after the first mStandardItemsPos of them.  So the position can usually be found
+	// without retrieving the text of each item in the OS menu.  The item at that position is checked in case
+	// the OS menu doesn't match the list (e.g. because an item couldn't be added to or removed from it):
+	UserMenuItem *menu_item = FindItem(aMenuItemName);
+	if (menu_item && menu_item_count >= (int)mMenuItemCount)
+	{
+		UINT pos = 0;
+		for (UserMenuItem *mi = mFirstMenuItem; mi != menu_item; mi = mi->mNextMenuItem)
+			++pos;
+		if (pos >= mStandardItemsPos)
+			pos += menu_item_count - mMenuItemCount; // The number of standard items.
+		if (GetMenuString(mMenu, pos, buf, sizeof(buf) - 1, MF_BYPOSITION) && !lstrcmpi(buf, aMenuItemName))
+			return pos;
+	}
+	// Otherwise, search the OS menu as a fallback (e.g. for a standard item):
 	for (int i = 0; i < menu_item_count; ++i)
 		if (GetMenuString(mMenu, i, buf, sizeof(buf) - 1, MF_BYPOSITION))
 			if (!lstrcmpi(buf, aMenuItemName))  // A case insensitive match was found.
@@ -0,0 +1,265 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks calendar.h against independent references: a day-by-day walk through the calendar for the date
+// arithmetic, the C runtime's timegm() and gmtime() for conversions anywhere in the supported range, and
+// the strings that GetDateFormat() and GetTimeFormat() produce in the English (United States) locale for
+// the format pictures.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "calendar.h"
+#include "test.h"
+
+#define SECONDS_FROM_1601_TO_1970 11644473600LL // The same constant that converts a FILETIME to a time_t.
+
+static unsigned long long sState = 0x9E3779B97F4A7C15ULL;
+static unsigned long long Rand64()
+{
+	sState ^= sState << 13;
+	sState ^= sState >> 7;
+	sState ^= sState << 17;
+	return sState;
+}
+
+
+
+static CalendarTime Time(int aYear, int aMonth, int aDay, int aHour, int aMinute, int aSecond)
+{
+	CalendarTime t = {aYear, aMonth, aDay, aHour, aMinute, aSecond};
+	return t;
+}
+
+
+
+static void TestDayWalk()
+// Steps through every day of the supported range one at a time, which is slow enough to be obviously correct.
+{
+	int year = CALENDAR_MIN_YEAR, month = 1, day = 1, wday = 1; // 1601-01-01 was a Monday.
+	NumInt64Type days = 0;
+	int failures_before = sTestFailures;
+	for (;;)
+	{
+		int y, m, d;
+		CHECK(DaysFromCivil(year, month, day) == days);
+		CivilFromDays(days, y, m, d);
+		CHECK(y == year && m == month && d == day);
+		CHECK(DayOfWeekFromDays(days) == wday);
+		if (sTestFailures != failures_before)
+		{
+			fprintf(stderr, "  at %04d-%02d-%02d (day %lld)\n", year, month, day, (long long)days);
+			return;
+		}
+		if (year == CALENDAR_MAX_YEAR && month == 12 && day == 31)
+			break;
+		++days;
+		wday = (wday + 1) % 7;
+		bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+		static const int sMonthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+		int month_days = month == 2 && leap ? 29 : sMonthDays[month - 1];
+		CHECK(DaysInMonth(year, month) == month_days);
+		if (++day > month_days)
+		{
+			day = 1;
+			if (++month > 12)
+			{
+				month = 1;
+				++year;
+			}
+		}
+	}
+	// Day 0 of a month is the last day of the prior month, as DaysFromCivil() documents.
+	CHECK(DaysFromCivil(2000, 3, 0) == DaysFromCivil(2000, 2, 29));
+	CHECK(DaysFromCivil(2001, 1, 0) == DaysFromCivil(2000, 12, 31));
+}
+
+
+
+static void TestAgainstRuntime()
+// Compares the conversions with the C runtime's, which uses a different algorithm.
+{
+	CalendarTime ct;
+	struct tm tm;
+	NumInt64Type max_seconds = CalendarTimeToSeconds(Time(CALENDAR_MAX_YEAR, 12, 31, 23, 59, 59));
+	for (int i = 0; i < 1000000; ++i)
+	{
+		NumInt64Type seconds;
+		switch (i % 4)
+		{
+		case 0: seconds = (NumInt64Type)(Rand64() % (unsigned long long)(max_seconds + 1)); break;
+		case 1: seconds = max_seconds - (NumInt64Type)(Rand64() % 100000000); break;
+		case 2: seconds = (NumInt64Type)(Rand64() % 100000000); break;
+		default: seconds = SECONDS_FROM_1601_TO_1970 + (NumInt64Type)(Rand64() % 10000000000ULL) - 5000000000LL; break;
+		}
+		time_t t = (time_t)(seconds - SECONDS_FROM_1601_TO_1970);
+		if (!gmtime_r(&t, &tm))
+		{
+			CHECK(!"gmtime_r failed");
+			return;
+		}
+		SecondsToCalendarTime(seconds, ct);
+		if (!(ct.year == tm.tm_year + 1900 && ct.month == tm.tm_mon + 1 && ct.day == tm.tm_mday
+			&& ct.hour == tm.tm_hour && ct.minute == tm.tm_min && ct.second == tm.tm_sec))
+		{
+			CHECK(!"SecondsToCalendarTime differs from gmtime_r");
+			fprintf(stderr, "  seconds=%lld\n", (long long)seconds);
+			return;
+		}
+		CHECK(CalendarTimeIsValid(ct));
+		CHECK(CalendarTimeToSeconds(ct) == seconds);
+		CHECK(DayOfWeekFromDays(DaysFromCivil(ct.year, ct.month, ct.day)) == tm.tm_wday);
+		CHECK(timegm(&tm) == t);
+	}
+	// Times before 1601 round toward negative infinity rather than toward zero.
+	SecondsToCalendarTime(-1, ct);
+	CHECK(ct.year == 1600 && ct.month == 12 && ct.day == 31 && ct.hour == 23 && ct.minute == 59 && ct.second == 59);
+}
+
+
+
+static void TestValidity()
+{
+	CHECK(CalendarTimeIsValid(Time(1601, 1, 1, 0, 0, 0)));
+	CHECK(CalendarTimeIsValid(Time(30827, 12, 31, 23, 59, 59)));
+	CHECK(CalendarTimeIsValid(Time(2000, 2, 29, 12, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(1600, 12, 31, 23, 59, 59)));
+	CHECK(!CalendarTimeIsValid(Time(30828, 1, 1, 0, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(1900, 2, 29, 0, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 4, 31, 0, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 13, 1, 0, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 0, 1, 0, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 1, 0, 0, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 1, 1, 24, 0, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 1, 1, 0, 60, 0)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 1, 1, 0, 0, 60)));
+	CHECK(!CalendarTimeIsValid(Time(2004, 1, 1, -1, 0, 0)));
+}
+
+
+
+static void TestYYYYMMDD()
+{
+	char buf[16];
+	CHECK(!strcmp(CalendarTimeToYYYYMMDD(Time(1601, 1, 1, 0, 0, 0), buf), "16010101000000"));
+	CHECK(!strcmp(CalendarTimeToYYYYMMDD(Time(2009, 7, 4, 13, 5, 9), buf), "20090704130509"));
+	CHECK(!strcmp(CalendarTimeToYYYYMMDD(Time(9999, 12, 31, 23, 59, 59), buf), "99991231235959"));
+	CHECK(!strcmp(CalendarTimeToYYYYMMDD(Time(10000, 1, 1, 0, 0, 0), buf), "100000101000000"));
+	CHECK(!strcmp(CalendarTimeToYYYYMMDD(Time(30827, 12, 31, 23, 59, 59), buf), "308271231235959"));
+}
+
+
+
+static void SetEnglishNames(CalendarNames &aNames)
+// The names that GetLocaleInfo() returns for LOCALE_USER_DEFAULT on an English (United States) system.
+{
+	static const char *sMonth[] = {"January", "February", "March", "April", "May", "June", "July", "August"
+		, "September", "October", "November", "December"};
+	static const char *sDay[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+	memset(&aNames, 0, sizeof(aNames));
+	for (int i = 0; i < 12; ++i)
+	{
+		strcpy(aNames.month[i], sMonth[i]);
+		memcpy(aNames.month_abbrev[i], sMonth[i], 3);
+	}
+	for (int i = 0; i < 7; ++i)
+	{
+		strcpy(aNames.day[i], sDay[i]);
+		memcpy(aNames.day_abbrev[i], sDay[i], 3);
+	}
+	strcpy(aNames.am, "AM");
+	strcpy(aNames.pm, "PM");
+}
+
+
+
+static bool Formats(const char *aPicture, bool aIsTime, const CalendarTime &aTime, const CalendarNames &aNames
+	, const char *aExpected)
+{
+	char buf[256];
+	int length = FormatCalendarPicture(aPicture, aIsTime, aTime, aNames, buf, sizeof(buf));
+	if (!aExpected)
+		return length == -1;
+	if (length == (int)strlen(aExpected) && !strcmp(buf, aExpected))
+		return true;
+	fprintf(stderr, "  \"%s\" gave \"%s\" (%d) rather than \"%s\"\n", aPicture, length < 0 ? "" : buf, length, aExpected);
+	return false;
+}
+
+
+
+static void TestPictures()
+// The expected strings are what GetDateFormat() and GetTimeFormat() produce for the same pictures.
+{
+	CalendarNames names;
+	SetEnglishNames(names);
+	CalendarTime morning = {2009, 3, 7, 9, 5, 3};    // A Saturday.
+	CalendarTime evening = {1999, 12, 31, 23, 59, 58}; // A Friday.
+	CalendarTime midnight = {2024, 2, 29, 0, 0, 0};  // A Thursday.
+	CalendarTime noon = {30827, 1, 2, 12, 30, 0};
+
+	CHECK(Formats("M/d/yyyy", false, morning, names, "3/7/2009"));
+	CHECK(Formats("MM/dd/yy", false, morning, names, "03/07/09"));
+	CHECK(Formats("dddd, MMMM dd, yyyy", false, morning, names, "Saturday, March 07, 2009"));
+	CHECK(Formats("ddd MMM d yy", false, evening, names, "Fri Dec 31 99"));
+	CHECK(Formats("ddd, MMM d", false, midnight, names, "Thu, Feb 29"));
+	CHECK(Formats("yyyy-MM-dd", false, noon, names, "30827-01-02"));
+	CHECK(Formats("y", false, morning, names, "9"));
+	CHECK(Formats("'Day' d 'of' MMMM", false, morning, names, "Day 7 of March"));
+	CHECK(Formats("", false, morning, names, ""));
+
+	CHECK(Formats("h:mm:ss tt", true, morning, names, "9:05:03 AM"));
+	CHECK(Formats("hh:mm:ss tt", true, evening, names, "11:59:58 PM"));
+	CHECK(Formats("HH:mm", true, midnight, names, "00:00"));
+	CHECK(Formats("h t", true, midnight, names, "12 A"));
+	CHECK(Formats("h:m:s t", true, noon, names, "12:30:0 P"));
+	CHECK(Formats("H 'o''clock'", true, evening, names, NULL)); // Adjacent quotes are declined.
+
+	// Declined: specifiers of the other kind, eras, unknown letters, over-long runs and unterminated quotes.
+	CHECK(Formats("h:mm", false, morning, names, NULL));
+	CHECK(Formats("yyyy", true, morning, names, NULL));
+	CHECK(Formats("gg yyyy", false, morning, names, NULL));
+	CHECK(Formats("yyy", false, morning, names, NULL));
+	CHECK(Formats("ddddd", false, morning, names, NULL));
+	CHECK(Formats("hhh", true, morning, names, NULL));
+	CHECK(Formats("d 'of", false, morning, names, NULL));
+	CHECK(Formats("x", true, morning, names, NULL));
+
+	// A locale whose month names change next to a day number is declined only when both appear.
+	names.month_genitive_differs = true;
+	CHECK(Formats("d MMMM", false, morning, names, NULL));
+	CHECK(Formats("MMMM yyyy", false, morning, names, "March 2009"));
+	CHECK(Formats("dddd MMMM", false, morning, names, "Saturday March"));
+
+	// A buffer that's too small is declined rather than truncated.
+	char buf[8];
+	CHECK(FormatCalendarPicture("dddd", false, morning, names, buf, sizeof(buf)) == -1);
+	CHECK(FormatCalendarPicture("ddd", false, morning, names, buf, 4) == 3 && !strcmp(buf, "Sat"));
+	CHECK(FormatCalendarPicture("ddd", false, morning, names, buf, 3) == -1);
+}
+
+
+
+int main()
+{
+	TestDayWalk();
+	TestAgainstRuntime();
+	TestValidity();
+	TestYYYYMMDD();
+	TestPictures();
+	return TEST_RESULT();
+}
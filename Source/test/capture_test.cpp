@@ -0,0 +1,159 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Tests CaptureCache's reuse policy with a fake provider whose "screen" is a pure function of the
+// coordinates and a frame number, so that a stale or misaligned copy is always detectable.
+
+#include <stdlib.h>
+#include "capture.h"
+#include "test.h"
+
+class FakeCaptureProvider : public CaptureProvider
+{
+public:
+	unsigned tick;
+	unsigned frame; // Bumped by the test to simulate the screen changing.
+	unsigned capture_count;
+	bool fail;
+
+	FakeCaptureProvider() : tick(1000), frame(0), capture_count(0), fail(false) {}
+
+	static ScanPixelType PixelAt(int aX, int aY, unsigned aFrame)
+	{
+		return ((aX & 0xFFF) << 12 | (aY & 0xFFF)) ^ (aFrame << 24);
+	}
+
+	ScanPixelType *Capture(int aLeft, int aTop, int aWidth, int aHeight, bool &aIs16Bit)
+	{
+		++capture_count;
+		if (fail)
+			return NULL;
+		ScanPixelType *pixel = (ScanPixelType *)malloc(aWidth * aHeight * sizeof(ScanPixelType));
+		for (int y = 0; y < aHeight; ++y)
+			for (int x = 0; x < aWidth; ++x)
+				pixel[y * aWidth + x] = PixelAt(aLeft + x, aTop + y, frame);
+		aIs16Bit = false;
+		return pixel;
+	}
+
+	unsigned TickCount() { return tick; }
+};
+
+
+
+static bool RegionIs(const ScanPixelType *aPixel, int aLeft, int aTop, int aWidth, int aHeight, unsigned aFrame)
+{
+	if (!aPixel)
+		return false;
+	for (int y = 0; y < aHeight; ++y)
+		for (int x = 0; x < aWidth; ++x)
+			if (aPixel[y * aWidth + x] != FakeCaptureProvider::PixelAt(aLeft + x, aTop + y, aFrame))
+				return false;
+	return true;
+}
+
+
+
+static bool GetIs(CaptureCache &aCache, int aLeft, int aTop, int aWidth, int aHeight, unsigned aMaxAge, unsigned aFrame)
+{
+	bool is_16bit;
+	ScanPixelType *pixel = aCache.Get(aLeft, aTop, aWidth, aHeight, aMaxAge, is_16bit);
+	bool result = RegionIs(pixel, aLeft, aTop, aWidth, aHeight, aFrame);
+	free(pixel);
+	return result;
+}
+
+
+
+static void TestNoMaxAge()
+{
+	FakeCaptureProvider provider;
+	CaptureCache cache(provider);
+	CHECK(GetIs(cache, 10, 20, 30, 40, 0, 0));
+	provider.frame = 1;
+	CHECK(GetIs(cache, 10, 20, 30, 40, 0, 1)); // A max age of zero must always capture anew.
+	CHECK(provider.capture_count == 2);
+	ScanPixelType color;
+	CHECK(!cache.GetPixel(15, 25, 0, color));
+	CHECK(cache.ReuseCount() == 0);
+}
+
+
+
+static void TestMaxAge()
+{
+	FakeCaptureProvider provider;
+	CaptureCache cache(provider);
+	CHECK(GetIs(cache, 100, 100, 50, 50, 200, 0));
+	provider.frame = 1;
+	provider.tick += 150;
+	CHECK(GetIs(cache, 110, 120, 10, 5, 200, 0)); // Inside the frame and young enough: reused (stale by design).
+	CHECK(GetIs(cache, 100, 100, 50, 50, 200, 0));
+	CHECK(provider.capture_count == 1);
+	ScanPixelType color;
+	CHECK(cache.GetPixel(149, 149, 200, color) && color == FakeCaptureProvider::PixelAt(149, 149, 0));
+	CHECK(!cache.GetPixel(150, 149, 200, color)); // Just outside the frame.
+	CHECK(GetIs(cache, 99, 100, 10, 10, 200, 1)); // Not covered: captured anew, which replaces the frame.
+	CHECK(provider.capture_count == 2);
+	provider.tick += 201;
+	provider.frame = 2;
+	CHECK(GetIs(cache, 100, 100, 5, 5, 200, 2)); // Too old.
+	CHECK(GetIs(cache, 100, 100, 5, 5, 50, 2)); // The thread's own max age applies, not the capturer's.
+	CHECK(provider.capture_count == 3);
+	provider.tick = 0xFFFFFFF0; // GetTickCount() wraps around.
+	CHECK(GetIs(cache, 0, 0, 4, 4, 100, 2));
+	provider.tick = 0x10;
+	CHECK(GetIs(cache, 1, 1, 2, 2, 100, 2));
+	CHECK(provider.capture_count == 4);
+}
+
+
+
+static void TestPin()
+{
+	FakeCaptureProvider provider;
+	CaptureCache cache(provider);
+	CHECK(cache.Pin(0, 0, 640, 480) && cache.IsPinned());
+	provider.frame = 1;
+	provider.tick += 1000000;
+	CHECK(GetIs(cache, 600, 400, 40, 80, 0, 0)); // Pinned frames are reused regardless of age.
+	CHECK(GetIs(cache, 600, 400, 41, 80, 0, 1)); // ...but only inside the pinned region.
+	CHECK(GetIs(cache, 700, 0, 10, 10, 500, 1)); // A capture made while pinned must not replace the pin.
+	CHECK(GetIs(cache, 0, 0, 10, 10, 500, 0));
+	ScanPixelType color;
+	CHECK(cache.GetPixel(0, 0, 0, color) && color == FakeCaptureProvider::PixelAt(0, 0, 0));
+	provider.fail = true;
+	CHECK(!cache.Pin(0, 0, 10, 10));
+	CHECK(cache.IsPinned() && GetIs(cache, 5, 5, 5, 5, 0, 0)); // A failed pin leaves the old one in place.
+	provider.fail = false;
+	cache.Unpin();
+	CHECK(!cache.IsPinned() && !cache.GetPixel(0, 0, 1000, color));
+	CHECK(GetIs(cache, 0, 0, 10, 10, 0, 1));
+	CHECK(!cache.Pin(0, 0, 0, 10));
+	bool is_16bit;
+	CHECK(!cache.Get(0, 0, 10, -1, 0, is_16bit));
+}
+
+
+
+int main()
+{
+	TestNoMaxAge();
+	TestMaxAge();
+	TestPin();
+	return TEST_RESULT();
+}
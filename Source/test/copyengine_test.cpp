@@ -0,0 +1,474 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Drives CopyEngine with a POSIX host that copies with copy_file_range() (falling back to read() and write()
+// where that isn't available) and moves with rename(), and checks that:
+//  - A single file is copied on the caller's thread; more start the workers and overlap.
+//  - Every file arrives intact, and the byte, file and failure counts add up.
+//  - Jobs naming the same file never run at the same time, and run in the order they were added.
+//  - At most one large file is copied at a time.
+//  - Failures (a missing source, or an existing destination without COPY_OVERWRITE) are counted and
+//    detailed with the host's error code.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <set>
+#include "copyengine.h"
+#include "test.h"
+
+
+
+static pthread_mutex_t sStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static int sThreadsStarted, sActive, sMaxActive, sLargeActive, sMaxLargeActive, sConflicts;
+static std::multiset<std::string> sBusy; // The sources and destinations of the copies in progress.
+
+static void ResetStats()
+{
+	sThreadsStarted = sActive = sMaxActive = sLargeActive = sMaxLargeActive = sConflicts = 0;
+	sBusy.clear();
+}
+
+
+
+static int CopyContents(int aIn, int aOut)
+// Returns 0 or an errno value.
+{
+#ifdef __linux__
+	for (;;)
+	{
+		ssize_t n = copy_file_range(aIn, NULL, aOut, NULL, 1 << 30, 0);
+		if (n > 0)
+			continue;
+		if (!n)
+			return 0;
+		if (errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP)
+			return errno;
+		break; // Not supported for these files, so fall back to copying through a buffer.
+	}
+#endif
+	char buf[64 * 1024];
+	ssize_t n;
+	while (   (n = read(aIn, buf, sizeof(buf))) > 0   )
+		for (ssize_t done = 0, w; done < n; done += w)
+			if (   (w = write(aOut, buf + done, n - done)) < 0   )
+				return errno;
+	return n < 0 ? errno : 0;
+}
+
+
+
+class PosixCopyHost : public CopyEngineHost
+{
+	pthread_mutex_t mLock;
+	pthread_cond_t mCond[SIGNAL_COUNT];
+	bool mRaised[SIGNAL_COUNT];
+
+	static int Copy(const char *aSource, const char *aDest, bool aOverwrite)
+	{
+		int in = open(aSource, O_RDONLY);
+		if (in < 0)
+			return errno;
+		int out = open(aDest, O_WRONLY | O_CREAT | O_TRUNC | (aOverwrite ? 0 : O_EXCL), 0644);
+		if (out < 0)
+		{
+			int error = errno;
+			close(in);
+			return error;
+		}
+		int error = CopyContents(in, out);
+		close(in);
+		if (close(out) && !error)
+			error = errno;
+		return error;
+	}
+
+public:
+	PosixCopyHost()
+	{
+		pthread_mutex_init(&mLock, NULL);
+		for (int i = 0; i < SIGNAL_COUNT; ++i)
+		{
+			pthread_cond_init(&mCond[i], NULL);
+			mRaised[i] = false;
+		}
+	}
+
+	~PosixCopyHost()
+	{
+		for (int i = 0; i < SIGNAL_COUNT; ++i)
+			pthread_cond_destroy(&mCond[i]);
+		pthread_mutex_destroy(&mLock);
+	}
+
+	int CopyOneFile(const char *aSource, const char *aDest, int aFlags, CopyUInt64Type aSize)
+	{
+		bool large = aSize >= COPY_ENGINE_LARGE_FILE;
+		pthread_mutex_lock(&sStatsLock);
+		if (sBusy.count(aSource) || sBusy.count(aDest))
+			++sConflicts;
+		sBusy.insert(aSource);
+		sBusy.insert(aDest);
+		if (++sActive > sMaxActive)
+			sMaxActive = sActive;
+		if (large && ++sLargeActive > sMaxLargeActive)
+			sMaxLargeActive = sLargeActive;
+		pthread_mutex_unlock(&sStatsLock);
+
+		usleep(300); // Stands in for the per-file latency that the workers exist to overlap.
+		bool overwrite = (aFlags & COPY_OVERWRITE) != 0;
+		int error;
+		if (aFlags & COPY_MOVE)
+		{
+			if (!overwrite && !access(aDest, F_OK))
+				error = EEXIST;
+			else if (!rename(aSource, aDest))
+				error = 0;
+			else if (errno != EXDEV)
+				error = errno;
+			else if (   !(error = Copy(aSource, aDest, overwrite))   ) // A different file system.
+				error = unlink(aSource) ? errno : 0;
+		}
+		else
+			error = Copy(aSource, aDest, overwrite);
+
+		pthread_mutex_lock(&sStatsLock);
+		sBusy.erase(sBusy.find(aSource));
+		sBusy.erase(sBusy.find(aDest));
+		--sActive;
+		if (large)
+			--sLargeActive;
+		pthread_mutex_unlock(&sStatsLock);
+		return error;
+	}
+
+	unsigned TickCount()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+	}
+
+	bool StartThread(void (*aProc)(void *), void *aParam)
+	{
+		struct Start {void (*proc)(void *); void *param;};
+		struct Trampoline {static void *Proc(void *aStart)
+		{
+			Start start = *(Start *)aStart;
+			delete (Start *)aStart;
+			start.proc(start.param);
+			return NULL;
+		}};
+		Start *start = new Start;
+		start->proc = aProc;
+		start->param = aParam;
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, Trampoline::Proc, start))
+		{
+			delete start;
+			return false;
+		}
+		pthread_detach(thread);
+		pthread_mutex_lock(&sStatsLock);
+		++sThreadsStarted;
+		pthread_mutex_unlock(&sStatsLock);
+		return true;
+	}
+
+	void Lock() {pthread_mutex_lock(&mLock);}
+	void Unlock() {pthread_mutex_unlock(&mLock);}
+
+	void Wait(int aSignal, unsigned aTimeout)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += aTimeout / 1000;
+		deadline.tv_nsec += (aTimeout % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L)
+		{
+			++deadline.tv_sec;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		while (!mRaised[aSignal])
+			if (aTimeout == COPY_ENGINE_WAIT_FOREVER)
+				pthread_cond_wait(&mCond[aSignal], &mLock);
+			else if (pthread_cond_timedwait(&mCond[aSignal], &mLock, &deadline) == ETIMEDOUT)
+				return;
+		mRaised[aSignal] = false;
+	}
+
+	void Signal(int aSignal) // CopyEngine calls this only while holding the lock.
+	{
+		mRaised[aSignal] = true;
+		pthread_cond_signal(&mCond[aSignal]);
+	}
+};
+
+
+
+static std::string sRoot;
+
+static std::string Path(const char *aFormat, int aNumber)
+{
+	char name[64];
+	snprintf(name, sizeof(name), aFormat, aNumber);
+	return sRoot + name;
+}
+
+
+
+static std::string MakeContents(int aSeed, size_t aLength)
+{
+	std::string s(aLength, '\0');
+	unsigned x = aSeed * 2654435761U + 1;
+	for (size_t i = 0; i < aLength; ++i)
+	{
+		x = x * 1103515245U + 12345U;
+		s[i] = (char)(x >> 16);
+	}
+	return s;
+}
+
+
+
+static void WriteFile(const std::string &aPath, const std::string &aContents)
+{
+	FILE *fp = fopen(aPath.c_str(), "wb");
+	if (fp)
+	{
+		fwrite(aContents.data(), 1, aContents.size(), fp);
+		fclose(fp);
+	}
+}
+
+
+
+static bool ReadFile(const std::string &aPath, std::string &aContents)
+{
+	FILE *fp = fopen(aPath.c_str(), "rb");
+	if (!fp)
+		return false;
+	aContents.clear();
+	char buf[64 * 1024];
+	size_t n;
+	while (   (n = fread(buf, 1, sizeof(buf), fp)) > 0   )
+		aContents.append(buf, n);
+	fclose(fp);
+	return true;
+}
+
+
+
+static void Add(CopyEngine &aEngine, const std::string &aSource, const std::string &aDest, int aFlags)
+// Adds a job the way the commands do: when the engine is full, let it make progress and try again.
+{
+	struct stat st;
+	CopyUInt64Type size = stat(aSource.c_str(), &st) ? 0 : st.st_size;
+	while (!aEngine.Add(aSource.c_str(), aDest.c_str(), aFlags, size))
+		aEngine.Step(10);
+}
+
+
+
+static void Finish(CopyEngine &aEngine)
+{
+	while (aEngine.Step(10));
+}
+
+
+
+static void TestSingleFile()
+{
+	ResetStats();
+	std::string contents = MakeContents(1, 100000), copied;
+	WriteFile(Path("single%d", 0), contents);
+	CopyEngine engine(new PosixCopyHost);
+	Add(engine, Path("single%d", 0), Path("single%d", 1), 0);
+	Finish(engine);
+	CHECK(engine.FileCount() == 1 && engine.FailureCount() == 0);
+	CHECK(engine.ByteCount() == contents.size());
+	CHECK(ReadFile(Path("single%d", 1), copied) && copied == contents);
+	CHECK(sThreadsStarted == 0);
+}
+
+
+
+static void TestManyFiles()
+{
+	ResetStats();
+	const int count = 300;
+	CopyUInt64Type total = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		std::string contents = MakeContents(i, i * 97 % 20000);
+		WriteFile(Path("many%d", i), contents);
+		total += contents.size();
+	}
+	CopyEngine engine(new PosixCopyHost);
+	for (int i = 0; i < count; ++i)
+		Add(engine, Path("many%d", i), Path("many%d.copy", i), 0);
+	Finish(engine);
+	CHECK(engine.FileCount() == (unsigned)count && engine.FailureCount() == 0);
+	CHECK(engine.ByteCount() == total);
+	CHECK(sThreadsStarted == COPY_ENGINE_WORKER_COUNT);
+	CHECK(sMaxActive > 1 && sMaxActive <= COPY_ENGINE_WORKER_COUNT + 1);
+	CHECK(sConflicts == 0);
+	std::string copied;
+	for (int i = 0; i < count; ++i)
+		CHECK(ReadFile(Path("many%d.copy", i), copied) && copied == MakeContents(i, i * 97 % 20000));
+}
+
+
+
+static void TestOrdering()
+{
+	// Every other job overwrites the same destination, and each of those is followed by a job that moves
+	// the destination elsewhere.  Only if the jobs naming the same file run one at a time and in order
+	// does each moved file have the contents of the source copied just before it.
+	ResetStats();
+	const int count = 40;
+	for (int i = 0; i < count; ++i)
+		WriteFile(Path("order%d", i), MakeContents(1000 + i, 5000 + i));
+	CopyEngine engine(new PosixCopyHost);
+	for (int i = 0; i < count; ++i)
+	{
+		Add(engine, Path("order%d", i), sRoot + "order.dest", COPY_OVERWRITE);
+		Add(engine, sRoot + "order.dest", Path("order%d.moved", i), COPY_MOVE);
+		Add(engine, Path("order%d", i), Path("order%d.unrelated", i), 0); // Free to run at any time.
+	}
+	Finish(engine);
+	CHECK(engine.FileCount() == 3 * count && engine.FailureCount() == 0);
+	CHECK(sConflicts == 0);
+	std::string moved;
+	for (int i = 0; i < count; ++i)
+		CHECK(ReadFile(Path("order%d.moved", i), moved) && moved == MakeContents(1000 + i, 5000 + i));
+	CHECK(access((sRoot + "order.dest").c_str(), F_OK) != 0);
+}
+
+
+
+static void TestLargeFiles()
+{
+	ResetStats();
+	const int count = 3;
+	for (int i = 0; i < count; ++i)
+	{
+		std::string contents = MakeContents(2000 + i, 1 << 16);
+		contents.resize(COPY_ENGINE_LARGE_FILE + i, (char)i); // Mostly a fill byte, to keep this quick.
+		WriteFile(Path("large%d", i), contents);
+	}
+	for (int i = 0; i < 20; ++i)
+		WriteFile(Path("small%d", i), MakeContents(3000 + i, 1000));
+	CopyEngine engine(new PosixCopyHost);
+	for (int i = 0; i < count; ++i)
+	{
+		Add(engine, Path("large%d", i), Path("large%d.copy", i), 0);
+		for (int k = 0; k < 20 / count; ++k)
+			Add(engine, Path("small%d", i * (20 / count) + k), Path("small%d.copy", i * (20 / count) + k), 0);
+	}
+	Finish(engine);
+	CHECK(engine.FailureCount() == 0);
+	CHECK(sMaxLargeActive == 1);
+	std::string original, copied;
+	for (int i = 0; i < count; ++i)
+		CHECK(ReadFile(Path("large%d", i), original) && ReadFile(Path("large%d.copy", i), copied) && copied == original);
+}
+
+
+
+static void TestFailures()
+{
+	ResetStats();
+	WriteFile(sRoot + "exists.src", "new");
+	WriteFile(sRoot + "exists.dest", "old");
+	std::string contents;
+	{
+		CopyEngine engine(new PosixCopyHost);
+		Add(engine, sRoot + "exists.src", sRoot + "exists.dest", 0); // No COPY_OVERWRITE.
+		Finish(engine);
+		CHECK(engine.FileCount() == 1 && engine.FailureCount() == 1 && engine.ByteCount() == 0);
+		CHECK(engine.FailureDetailCount() == 1);
+		const CopyFailure &failure = engine.FailureDetail(0);
+		CHECK(failure.error == EEXIST && sRoot + "exists.src" == failure.source && sRoot + "exists.dest" == failure.dest);
+		CHECK(ReadFile(sRoot + "exists.dest", contents) && contents == "old");
+	}
+
+	// More failures than there is room to detail, among successes.
+	const int missing = COPY_ENGINE_MAX_FAILURE_DETAILS + 5;
+	WriteFile(sRoot + "fine.src", "fine");
+	CopyEngine engine(new PosixCopyHost);
+	for (int i = 0; i < missing; ++i)
+	{
+		Add(engine, Path("missing%d", i), Path("missing%d.copy", i), 0);
+		Add(engine, sRoot + "fine.src", Path("fine%d.dest", i), 0);
+	}
+	Finish(engine);
+	CHECK(engine.FileCount() == 2U * missing);
+	CHECK(engine.FailureCount() == (unsigned)missing);
+	CHECK(engine.ByteCount() == 4U * missing);
+	CHECK(engine.FailureDetailCount() == COPY_ENGINE_MAX_FAILURE_DETAILS);
+	for (int i = 0; i < engine.FailureDetailCount(); ++i)
+	{
+		const CopyFailure &failure = engine.FailureDetail(i);
+		CHECK(failure.error == ENOENT && !strncmp(failure.source, (sRoot + "missing").c_str(), sRoot.size() + 7));
+	}
+}
+
+
+
+static void RemoveTree(const std::string &aPath)
+{
+	DIR *dir = opendir(aPath.c_str());
+	if (!dir)
+		return;
+	struct dirent *file;
+	while (   (file = readdir(dir)) != NULL   )
+		if (strcmp(file->d_name, ".") && strcmp(file->d_name, ".."))
+			unlink((aPath + "/" + file->d_name).c_str());
+	closedir(dir);
+	rmdir(aPath.c_str());
+}
+
+
+
+int main()
+{
+	char root[] = "/tmp/copyengine_test.XXXXXX";
+	if (!mkdtemp(root))
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	sRoot = root;
+	sRoot += '/';
+	TestSingleFile();
+	TestManyFiles();
+	TestOrdering();
+	TestLargeFiles();
+	TestFailures();
+	RemoveTree(root);
+	return TEST_RESULT();
+}
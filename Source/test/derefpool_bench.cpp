@@ -0,0 +1,105 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Times the deref buffers used by nested UDF calls that pass a large string, such as
+//   Outer(s) { return Middle(s . "x") }
+// where each call's line privatizes the caller's deref buffer and needs one of its own that's large enough to
+// hold the string.  Each layer gets its buffer, copies the string into it, calls the next layer, and then
+// gives the buffer back, either through a DerefBufPool (as ExpandArgs() does now) or through malloc() and
+// free() (as it did before).  The pool's limits are the program's.
+//
+// The C runtime's heap differs by platform, so these figures show the order of the gain rather than its
+// exact size.  The largest string needs buffers of 1 MB, only two of which fit in the pool, so it shows
+// the pool's limits at work.  glibc, for one, gives blocks of 128 KB or more straight from the OS (at first), which makes
+// each such malloc() and free() far more costly than the copy.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "derefpool.h"
+
+#define DEREF_BUF_EXPAND_INCREMENT (16 * 1024) // Same as var.h.
+#define LARGE_DEREF_BUF_SIZE (4 * 1024 * 1024) // Same as globaldata.h.
+#define DEPTH 5
+#define CALLS 20000
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+static DerefBufPool sPool(DEREF_BUF_EXPAND_INCREMENT, LARGE_DEREF_BUF_SIZE / 4, LARGE_DEREF_BUF_SIZE / 2);
+static char *sString;
+
+
+
+static int Call(int aDepth, size_t aLength, bool aUsePool)
+{
+	size_t size = aLength + 1;
+	char *buf;
+	if (aUsePool)
+		buf = sPool.Alloc(size);
+	else
+	{
+		size = (size + DEREF_BUF_EXPAND_INCREMENT - 1) / DEREF_BUF_EXPAND_INCREMENT * DEREF_BUF_EXPAND_INCREMENT;
+		buf = (char *)malloc(size);
+	}
+	if (!buf)
+		exit(1);
+	memcpy(buf, sString, aLength + 1); // The arg's dereferenced value.
+	int result = buf[aLength / 2] + (aDepth > 1 ? Call(aDepth - 1, aLength, aUsePool) : 0);
+	if (aUsePool)
+		sPool.Release(buf, size);
+	else
+		free(buf);
+	return result;
+}
+
+
+
+int main()
+{
+	static const size_t sLength[] = {1000, 100 * 1024, 600 * 1024};
+	sString = (char *)malloc(sLength[2] + 1);
+	memset(sString, 'x', sLength[2]);
+	for (int i = 0; i < 3; ++i)
+	{
+		size_t length = sLength[i];
+		int calls = (int)(CALLS * 1000 / (length + 10000)) + 100; // Fewer for the larger strings.
+		sString[length] = '\0';
+		double time[2];
+		for (int use_pool = 0; use_pool < 2; ++use_pool)
+		{
+			int result = 0;
+			double start = Seconds();
+			for (int c = 0; c < calls; ++c)
+				result += Call(DEPTH, length, use_pool != 0);
+			time[use_pool] = Seconds() - start;
+			sSink = result;
+		}
+		sString[length] = 'x';
+		printf("%6u-char string, %d nested calls: malloc/free %7.1f us, pool %7.1f us (%.1fx faster)\n"
+			, (unsigned)length, DEPTH, time[0] * 1e6 / calls, time[1] * 1e6 / calls, time[0] / time[1]);
+	}
+	printf("pool: %u allocated, %u reused, %u discarded (pool full)\n", sPool.Misses(), sPool.Hits(), sPool.Discards());
+	free(sString);
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Checks DerefBufPool with random sequences of nested allocations and releases, as the layers of ExpandArgs()
+// make them: every buffer must be at least as large as requested and writable to its full size (which
+// AddressSanitizer verifies), no buffer may be handed out twice, the most recently released suitable buffer
+// must be reused first, and the pool must stay within its limits.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "derefpool.h"
+#include "test.h"
+
+#define INCREMENT (16 * 1024)
+#define MAX_BUF_SIZE (1024 * 1024)
+#define MAX_TOTAL_SIZE (2 * 1024 * 1024)
+
+static unsigned sSeed = 1;
+
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+
+static void TestSizes()
+{
+	DerefBufPool pool(INCREMENT, MAX_BUF_SIZE, MAX_TOTAL_SIZE);
+	size_t size = 1;
+	char *buf = pool.Alloc(size);
+	CHECK(buf && size == INCREMENT);
+	pool.Release(buf, size);
+	size = INCREMENT + 1;
+	char *buf2 = pool.Alloc(size); // Too large for the idle buffer, which stays in the pool.
+	CHECK(buf2 && buf2 != buf && size == 2 * INCREMENT);
+	CHECK(pool.Hits() == 0 && pool.Misses() == 2 && pool.IdleCount() == 1);
+	pool.Release(buf2, size);
+	size = 100;
+	CHECK(pool.Alloc(size) == buf2 && size == 2 * INCREMENT); // The most recently released suitable buffer.
+	CHECK(pool.Hits() == 1 && pool.IdleCount() == 1 && pool.IdleSize() == INCREMENT);
+	pool.Release(buf2, size);
+	size = MAX_BUF_SIZE + 1; // Too large to pool, so rounded up to the next increment.
+	buf = pool.Alloc(size);
+	CHECK(buf && size == MAX_BUF_SIZE + INCREMENT);
+	pool.Release(buf, size);
+	CHECK(pool.IdleCount() == 2 && pool.Discards() == 0); // The large one was freed, not discarded.
+}
+
+
+
+static void TestNesting()
+{
+	DerefBufPool pool(INCREMENT, MAX_BUF_SIZE, MAX_TOTAL_SIZE);
+	struct Layer {char *buf; size_t size; unsigned char fill;} layer[50];
+	int depth = 0;
+	for (int i = 0; i < 200000; ++i)
+	{
+		if (depth < 50 && (depth == 0 || Random() % 2))
+		{
+			Layer &l = layer[depth];
+			size_t requested = Random() % 4 ? 1 + Random() % (64 * 1024) : 1 + Random() % (2 * MAX_BUF_SIZE);
+			int idle_count = pool.IdleCount();
+			l.size = requested;
+			if (   !(l.buf = pool.Alloc(l.size))   )
+			{
+				CHECK(false);
+				break;
+			}
+			CHECK(l.size >= requested);
+			CHECK(pool.IdleCount() <= idle_count);
+			l.fill = (unsigned char)i;
+			l.buf[0] = l.buf[l.size - 1] = l.fill;
+			for (int j = 0; j < depth; ++j)
+				CHECK(layer[j].buf != l.buf);
+			++depth;
+		}
+		else
+		{
+			Layer &l = layer[--depth];
+			CHECK(l.buf[0] == (char)l.fill && l.buf[l.size - 1] == (char)l.fill); // No other layer wrote to it.
+			int idle_count = pool.IdleCount();
+			pool.Release(l.buf, l.size);
+			if (pool.IdleCount() > idle_count) // It was kept, so it must be on top of the stack now.
+			{
+				size_t size = l.size;
+				char *buf = pool.Alloc(size);
+				CHECK(buf == l.buf && size == l.size);
+				pool.Release(buf, size);
+			}
+		}
+		CHECK(pool.IdleCount() <= DEREF_BUF_POOL_CAPACITY && pool.IdleSize() <= MAX_TOTAL_SIZE);
+	}
+	while (depth--)
+		pool.Release(layer[depth].buf, layer[depth].size);
+	CHECK(pool.Hits() > pool.Misses());
+}
+
+
+
+int main()
+{
+	TestSizes();
+	TestNesting();
+	TEST_RESULT();
+}
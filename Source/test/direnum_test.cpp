@@ -0,0 +1,419 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Drives DirEnum with a host built on readdir() and pthreads over a temporary tree, and checks that:
+//  - Ordered mode returns exactly what a sequential depth-first walk with the same host returns.
+//  - Unordered mode returns the same entries in some order.
+//  - A walk without subdirectories starts no threads, however large the directory.
+//  - A large directory is listed in chunks, and the workers never get more than DIR_ENUM_MAX_PREFETCH
+//    entries (plus a chunk per thread) ahead of a slow consumer.
+//  - Ending a walk early closes every directory handle and frees everything (the latter when built
+//    with -fsanitize=address).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "direnum.h"
+#include "test.h"
+
+
+
+struct TestEntry
+{
+	char path[512];
+};
+
+static pthread_mutex_t sStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static long sListed, sConsumed, sMaxAhead, sListCalls;
+static int sOpenDirs, sThreadsStarted;
+static bool sHostDeleted;
+static unsigned sErrorCount;
+static std::string sUnreadable; // A folder that ReaddirHost reports it failed to list, as if due to an I/O error.
+
+static void ResetStats()
+{
+	pthread_mutex_lock(&sStatsLock);
+	sListed = sConsumed = sMaxAhead = sListCalls = 0;
+	sOpenDirs = sThreadsStarted = 0;
+	sHostDeleted = false;
+	pthread_mutex_unlock(&sStatsLock);
+}
+
+
+
+class ReaddirHost : public DirEnumHost
+{
+	pthread_mutex_t mLock;
+	pthread_cond_t mCond[SIGNAL_COUNT];
+	bool mRaised[SIGNAL_COUNT];
+
+public:
+	ReaddirHost()
+	{
+		pthread_mutex_init(&mLock, NULL);
+		for (int i = 0; i < SIGNAL_COUNT; ++i)
+		{
+			pthread_cond_init(&mCond[i], NULL);
+			mRaised[i] = false;
+		}
+	}
+
+	~ReaddirHost()
+	{
+		for (int i = 0; i < SIGNAL_COUNT; ++i)
+			pthread_cond_destroy(&mCond[i]);
+		pthread_mutex_destroy(&mLock);
+		pthread_mutex_lock(&sStatsLock);
+		sHostDeleted = true;
+		pthread_mutex_unlock(&sStatsLock);
+	}
+
+	void ListDirectory(DirListing &aListing, bool aWantSubdirs)
+	{
+		DIR *dir = (DIR *)aListing.search;
+		aListing.search = NULL;
+		if (!dir)
+		{
+			if (sUnreadable == aListing.path)
+			{
+				++aListing.error_count;
+				aListing.complete = true;
+				return;
+			}
+			if (   !(dir = opendir(*aListing.path ? aListing.path : "."))   )
+			{
+				aListing.complete = true;
+				return;
+			}
+			pthread_mutex_lock(&sStatsLock);
+			++sOpenDirs;
+			pthread_mutex_unlock(&sStatsLock);
+		}
+		struct dirent *file;
+		struct stat st;
+		TestEntry *entry;
+		while (   (file = readdir(dir)) != NULL   )
+		{
+			if (!strcmp(file->d_name, ".") || !strcmp(file->d_name, ".."))
+				continue;
+			if (   !(entry = (TestEntry *)aListing.AddEntry())   )
+				break;
+			snprintf(entry->path, sizeof(entry->path), "%s%s", aListing.path, file->d_name);
+			if (aWantSubdirs && !lstat(entry->path, &st) && S_ISDIR(st.st_mode))
+				aListing.subdir.Append(file->d_name, strlen(file->d_name));
+			if (aListing.entry_count >= DIR_ENUM_CHUNK)
+			{
+				aListing.search = dir;
+				break;
+			}
+		}
+		pthread_mutex_lock(&sStatsLock);
+		++sListCalls;
+		sListed += aListing.entry_count;
+		if (sListed - sConsumed > sMaxAhead)
+			sMaxAhead = sListed - sConsumed;
+		if (!aListing.search)
+			--sOpenDirs;
+		pthread_mutex_unlock(&sStatsLock);
+		if (!aListing.search)
+		{
+			closedir(dir);
+			aListing.complete = true;
+		}
+	}
+
+	void EndListing(DirListing &aListing)
+	{
+		if (!aListing.search)
+			return;
+		closedir((DIR *)aListing.search);
+		aListing.search = NULL;
+		pthread_mutex_lock(&sStatsLock);
+		--sOpenDirs;
+		pthread_mutex_unlock(&sStatsLock);
+	}
+
+	char Separator() {return '/';}
+
+	bool StartThread(void (*aProc)(void *), void *aParam)
+	{
+		struct Start {void (*proc)(void *); void *param;};
+		struct Trampoline {static void *Proc(void *aStart)
+		{
+			Start start = *(Start *)aStart;
+			delete (Start *)aStart;
+			start.proc(start.param);
+			return NULL;
+		}};
+		Start *start = new Start;
+		start->proc = aProc;
+		start->param = aParam;
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, Trampoline::Proc, start))
+		{
+			delete start;
+			return false;
+		}
+		pthread_detach(thread);
+		pthread_mutex_lock(&sStatsLock);
+		++sThreadsStarted;
+		pthread_mutex_unlock(&sStatsLock);
+		return true;
+	}
+
+	void Lock() {pthread_mutex_lock(&mLock);}
+	void Unlock() {pthread_mutex_unlock(&mLock);}
+
+	void Wait(int aSignal)
+	{
+		while (!mRaised[aSignal])
+			pthread_cond_wait(&mCond[aSignal], &mLock);
+		mRaised[aSignal] = false;
+	}
+
+	void Signal(int aSignal) // DirEnum calls this only while holding the lock.
+	{
+		mRaised[aSignal] = true;
+		pthread_cond_signal(&mCond[aSignal]);
+	}
+};
+
+
+
+static std::string sRoot;
+
+static void MakeFiles(const std::string &aDir, int aCount)
+{
+	mkdir(aDir.c_str(), 0700);
+	for (int i = 0; i < aCount; ++i)
+	{
+		char name[32];
+		sprintf(name, "/f%d", i);
+		FILE *fp = fopen((aDir + name).c_str(), "w");
+		if (fp)
+			fclose(fp);
+	}
+}
+
+
+
+static void MakeTree()
+{
+	char root[] = "/tmp/direnum_test.XXXXXX";
+	if (!mkdtemp(root))
+	{
+		perror("mkdtemp");
+		exit(1);
+	}
+	sRoot = root;
+	sRoot += '/';
+	MakeFiles(sRoot + "top", 7);
+	MakeFiles(sRoot + "top/big", 5000);
+	MakeFiles(sRoot + "top/a", 30);
+	MakeFiles(sRoot + "top/a/x", 10);
+	MakeFiles(sRoot + "top/a/y", 10);
+	MakeFiles(sRoot + "top/b", 0);
+	std::string deep = sRoot + "top/c";
+	for (int i = 0; i < 10; ++i, deep += "/d")
+		MakeFiles(deep, 3);
+	MakeFiles(sRoot + "top/wide", 0);
+	for (int i = 0; i < 8; ++i)
+	{
+		char name[32];
+		sprintf(name, "top/wide/w%d", i);
+		MakeFiles(sRoot + name, 2000);
+	}
+}
+
+
+
+static void RemoveTree(const std::string &aPath)
+{
+	DIR *dir = opendir(aPath.c_str());
+	if (dir)
+	{
+		struct dirent *file;
+		while (   (file = readdir(dir)) != NULL   )
+			if (strcmp(file->d_name, ".") && strcmp(file->d_name, ".."))
+				RemoveTree(aPath + "/" + file->d_name);
+		closedir(dir);
+		rmdir(aPath.c_str());
+	}
+	else
+		unlink(aPath.c_str());
+}
+
+
+
+static void ReferenceWalk(const std::string &aPath, bool aRecurse, std::vector<std::string> &aOut)
+// The same listing rules as ReaddirHost, but sequential and without DirEnum.
+{
+	DIR *dir = opendir(aPath.c_str());
+	if (!dir)
+		return;
+	std::vector<std::string> subdirs;
+	struct dirent *file;
+	struct stat st;
+	while (   (file = readdir(dir)) != NULL   )
+	{
+		if (!strcmp(file->d_name, ".") || !strcmp(file->d_name, ".."))
+			continue;
+		std::string path = aPath + file->d_name;
+		aOut.push_back(path);
+		if (aRecurse && !lstat(path.c_str(), &st) && S_ISDIR(st.st_mode))
+			subdirs.push_back(path + "/");
+	}
+	closedir(dir);
+	for (size_t i = 0; i < subdirs.size(); ++i)
+		ReferenceWalk(subdirs[i], aRecurse, aOut);
+}
+
+
+
+static void WaitForHostDeleted()
+{
+	for (int i = 0; i < 5000; ++i)
+	{
+		pthread_mutex_lock(&sStatsLock);
+		bool deleted = sHostDeleted;
+		pthread_mutex_unlock(&sStatsLock);
+		if (deleted)
+			return;
+		usleep(1000);
+	}
+	CHECK(!"the host was never deleted");
+}
+
+
+
+static void Walk(const std::string &aPath, bool aRecurse, bool aOrdered, std::vector<std::string> &aOut
+	, long aStopAfter = -1, bool aSlow = false)
+{
+	ResetStats();
+	{
+		DirEnum dir_enum(new ReaddirHost, sizeof(TestEntry), aRecurse, aOrdered);
+		CHECK(dir_enum.Start(aPath.c_str()));
+		const TestEntry *entry;
+		while (aStopAfter && (entry = (const TestEntry *)dir_enum.Next()) != NULL)
+		{
+			aOut.push_back(entry->path);
+			pthread_mutex_lock(&sStatsLock);
+			++sConsumed;
+			pthread_mutex_unlock(&sStatsLock);
+			if (aStopAfter > 0)
+				--aStopAfter;
+			if (aSlow && !(aOut.size() % 64))
+				usleep(200);
+		}
+		CHECK(dir_enum.SkippedCount() == 0);
+		sErrorCount = dir_enum.ErrorCount();
+	}
+	WaitForHostDeleted();
+	CHECK(sOpenDirs == 0);
+}
+
+
+
+int main()
+{
+	MakeTree();
+	std::string top = sRoot + "top/";
+	std::vector<std::string> expected, actual;
+
+	ReferenceWalk(top, true, expected);
+	CHECK(expected.size() == 12 + 5000 + 32 + 20 + 39 + 8 + 16000); // top, big, a, a/x and a/y, c's chain, wide, wide's folders.
+	Walk(top, true, true, actual);
+	CHECK(actual == expected);
+	CHECK(sThreadsStarted == DIR_ENUM_WORKER_COUNT);
+	CHECK(sErrorCount == 0);
+
+	actual.clear();
+	Walk(top, true, false, actual);
+	std::sort(expected.begin(), expected.end());
+	std::sort(actual.begin(), actual.end());
+	CHECK(actual == expected);
+
+	// A single folder, however large, is listed by the consumer's own thread, a chunk at a time.
+	expected.clear();
+	actual.clear();
+	ReferenceWalk(top + "big/", false, expected);
+	Walk(top + "big/", false, true, actual);
+	CHECK(actual == expected);
+	CHECK(sThreadsStarted == 0);
+	CHECK(sListCalls >= (5000 + DIR_ENUM_CHUNK - 1) / DIR_ENUM_CHUNK);
+	CHECK(sMaxAhead <= DIR_ENUM_CHUNK);
+
+	// Non-recursive walks of a folder with subfolders don't recurse or start threads either.
+	expected.clear();
+	actual.clear();
+	ReferenceWalk(top, false, expected);
+	Walk(top, false, true, actual);
+	CHECK(actual == expected);
+	CHECK(sThreadsStarted == 0);
+
+	// With a slow consumer, the workers get ahead but not unboundedly so.
+	expected.clear();
+	actual.clear();
+	ReferenceWalk(top + "wide/", true, expected);
+	Walk(top + "wide/", true, true, actual, -1, true);
+	CHECK(actual == expected);
+	CHECK(sMaxAhead > DIR_ENUM_CHUNK); // Confirms the workers did list ahead.
+	CHECK(sMaxAhead <= DIR_ENUM_MAX_PREFETCH + (DIR_ENUM_WORKER_COUNT + 1) * DIR_ENUM_CHUNK);
+
+	// A folder that can't be listed is left out but counted, so that callers such as MoveDir can tell that
+	// the walk was incomplete.
+	sUnreadable = top + "a/x/";
+	expected.clear();
+	ReferenceWalk(top, true, expected);
+	std::vector<std::string> partial;
+	for (size_t i = 0; i < expected.size(); ++i)
+		if (expected[i].compare(0, sUnreadable.size(), sUnreadable))
+			partial.push_back(expected[i]);
+	CHECK(partial.size() == expected.size() - 10);
+	for (int ordered = 1; ordered >= 0; --ordered)
+	{
+		actual.clear();
+		Walk(top, true, ordered != 0, actual);
+		if (!ordered)
+		{
+			std::sort(partial.begin(), partial.end());
+			std::sort(actual.begin(), actual.end());
+		}
+		CHECK(actual == partial);
+		CHECK(sErrorCount == 1);
+	}
+	sUnreadable.clear();
+
+	// Ending a walk early, in either mode, with partly listed folders in flight.
+	for (int ordered = 0; ordered < 2; ++ordered)
+		for (long stop_after = 1; stop_after < 20000; stop_after *= 7)
+		{
+			actual.clear();
+			Walk(top, true, ordered != 0, actual, stop_after);
+			CHECK(actual.size() == (size_t)stop_after);
+		}
+
+	RemoveTree(sRoot.substr(0, sRoot.size() - 1));
+	return TEST_RESULT();
+}
@@ -0,0 +1,344 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks Downloader against a stand-in for an HTTP server that serves one resource from memory and answers
+// Range/If-Range requests the way a real server would (or, when told to, the way a misbehaving one does).
+// Time is simulated, so the checks of the adaptive buffer size don't depend on the speed of the machine.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "download.h"
+#include "test.h"
+
+
+
+class StandInTransport : public DownloadTransport
+{
+	std::string mContentRange;
+	size_t mPos, mEnd;
+	unsigned mClock;
+
+public:
+	// The resource and how the server behaves.
+	std::string body, last_modified;
+	bool supports_ranges, honors_if_range, send_content_range, fail_open;
+	long range_skew; // Added to the first byte of every 206 response, as a broken server or proxy might.
+	unsigned read_delay; // Simulated milliseconds per Read().
+	// What the Downloader asked for.
+	int open_count, read_count;
+	DownloadUInt64Type last_offset;
+	std::string last_validator;
+	size_t max_read_size;
+
+	StandInTransport(const std::string &aBody) : mPos(0), mEnd(0), mClock(1000), body(aBody)
+		, last_modified("Sun, 06 Nov 1994 08:49:37 GMT"), supports_ranges(true), honors_if_range(true)
+		, send_content_range(true), fail_open(false), range_skew(0), read_delay(1)
+		, open_count(0), read_count(0), last_offset(0), max_read_size(0) {}
+
+	DownloadOpenResult Open(const char *aURL, DownloadUInt64Type aOffset, const char *aValidator)
+	{
+		++open_count;
+		mClock += 20;
+		last_offset = aOffset;
+		last_validator = aValidator ? aValidator : "";
+		mContentRange.clear();
+		if (fail_open)
+			return DOWNLOAD_OPEN_FAILED;
+		char range[128];
+		mPos = 0;
+		mEnd = body.size();
+		if (!aOffset || !supports_ranges || (honors_if_range && last_validator != last_modified))
+			return DOWNLOAD_OPEN_WHOLE; // 200 OK.
+		if (aOffset >= body.size())
+		{
+			sprintf(range, "bytes */%lu", (unsigned long)body.size());
+			if (send_content_range)
+				mContentRange = range;
+			mEnd = 0;
+			return DOWNLOAD_OPEN_COMPLETE; // 416 Range Not Satisfiable.
+		}
+		mPos = (size_t)aOffset + range_skew;
+		sprintf(range, "bytes %lu-%lu/%lu", (unsigned long)mPos, (unsigned long)body.size() - 1, (unsigned long)body.size());
+		if (send_content_range)
+			mContentRange = range;
+		return DOWNLOAD_OPEN_REMAINDER; // 206 Partial Content.
+	}
+
+	bool ContentRange(char *aBuf, size_t aSize)
+	{
+		if (mContentRange.empty())
+			return false;
+		snprintf(aBuf, aSize, "%s", mContentRange.c_str());
+		return true;
+	}
+
+	DownloadUInt64Type ContentLength() {return mEnd - mPos;}
+
+	bool Read(void *aBuf, size_t aSize, size_t &aBytesRead)
+	{
+		++read_count;
+		if (aSize > max_read_size)
+			max_read_size = aSize;
+		mClock += read_delay;
+		aBytesRead = mEnd - mPos < aSize ? mEnd - mPos : aSize;
+		memcpy(aBuf, body.data() + mPos, aBytesRead);
+		mPos += aBytesRead;
+		return true;
+	}
+
+	unsigned TickCount() {return mClock;}
+};
+
+
+
+static std::string MakeBody(size_t aLength, int aSeed)
+{
+	std::string body(aLength, '\0');
+	unsigned x = aSeed;
+	for (size_t i = 0; i < aLength; ++i)
+	{
+		x = x * 1103515245 + 12345;
+		body[i] = (char)(x >> 16);
+	}
+	return body;
+}
+
+
+
+static DownloadStatus Run(StandInTransport &aTransport, DownloadMemorySink &aSink, DownloadUInt64Type aResumeOffset
+	, const char *aValidator, size_t aMaxBuffer = DOWNLOAD_DEFAULT_BUFFER)
+{
+	Downloader downloader(&aTransport, &aSink, aMaxBuffer);
+	DownloadStatus status;
+	for (status = downloader.Start("http://example.com/file", aResumeOffset, aValidator); status == DOWNLOAD_MORE
+		; status = downloader.Step());
+	CHECK(downloader.Step() == status); // The result is sticky.
+	CHECK(downloader.TotalTime() >= downloader.ConnectTime());
+	return status;
+}
+
+
+
+static bool SinkHas(DownloadMemorySink &aSink, const std::string &aData)
+{
+	return aSink.Length() == aData.size() && (aData.empty() || !memcmp(aSink.Data(), aData.data(), aData.size()));
+}
+
+
+
+static void Prefill(DownloadMemorySink &aSink, const std::string &aData)
+{
+	aSink.Begin(false, DOWNLOAD_LENGTH_UNKNOWN);
+	aSink.Write(aData.data(), aData.size());
+}
+
+
+
+static void TestParseContentRange()
+{
+	DownloadUInt64Type first, total;
+	CHECK(DownloadParseContentRange("bytes 100-199/200", first, total) && first == 100 && total == 200);
+	CHECK(DownloadParseContentRange(" Bytes  0-0/1 ", first, total) && first == 0 && total == 1);
+	CHECK(DownloadParseContentRange("bytes 5-9/*", first, total) && first == 5 && total == DOWNLOAD_LENGTH_UNKNOWN);
+	CHECK(DownloadParseContentRange("bytes */4096", first, total) && first == DOWNLOAD_LENGTH_UNKNOWN && total == 4096);
+	CHECK(DownloadParseContentRange("bytes 4294967296-8589934591/8589934592", first, total)
+		&& first == 4294967296ULL && total == 8589934592ULL);
+	CHECK(!DownloadParseContentRange("bytes */*", first, total));
+	CHECK(!DownloadParseContentRange("bytes 200-100/300", first, total)); // Last before first.
+	CHECK(!DownloadParseContentRange("bytes 100-199/199", first, total)); // Past the end.
+	CHECK(!DownloadParseContentRange("bytes 100-/200", first, total));
+	CHECK(!DownloadParseContentRange("bytes=100-199/200", first, total));
+	CHECK(!DownloadParseContentRange("items 1-2/3", first, total));
+	CHECK(!DownloadParseContentRange("bytes 1-2/3x", first, total));
+	CHECK(!DownloadParseContentRange("bytes 1-99999999999999999999999/3", first, total)); // Overflow.
+	CHECK(!DownloadParseContentRange("", first, total));
+}
+
+
+
+static void TestWhole()
+{
+	std::string body = MakeBody(3 * 1024 * 1024 + 17, 1);
+	StandInTransport transport(body);
+	DownloadMemorySink sink(body.size());
+	Downloader downloader(&transport, &sink, DOWNLOAD_DEFAULT_BUFFER);
+	DownloadStatus status;
+	for (status = downloader.Start("http://example.com/file"); status == DOWNLOAD_MORE; status = downloader.Step());
+	CHECK(status == DOWNLOAD_DONE);
+	CHECK(SinkHas(sink, body));
+	CHECK(downloader.ByteCount() == body.size() && downloader.ResumeOffset() == 0);
+	CHECK(downloader.ConnectTime() == 20);
+	CHECK(downloader.FirstByteTime() == 21);
+	CHECK(downloader.TotalTime() == 20 + (unsigned)transport.read_count);
+	// Fast reads grow the chunk to the maximum, so most of the body is read DOWNLOAD_DEFAULT_BUFFER at a time.
+	CHECK(transport.max_read_size == DOWNLOAD_DEFAULT_BUFFER);
+	CHECK(transport.read_count < (int)(body.size() / DOWNLOAD_DEFAULT_BUFFER) + 10);
+
+	// Slow reads keep the chunk small.
+	StandInTransport slow(body.substr(0, 100000));
+	slow.read_delay = DOWNLOAD_SLOW_READ + 1;
+	DownloadMemorySink slow_sink(body.size());
+	CHECK(Run(slow, slow_sink, 0, NULL) == DOWNLOAD_DONE);
+	CHECK(SinkHas(slow_sink, slow.body));
+	CHECK(slow.max_read_size == DOWNLOAD_MIN_BUFFER);
+
+	// An empty body.
+	StandInTransport empty("");
+	DownloadMemorySink empty_sink(100);
+	CHECK(Run(empty, empty_sink, 0, NULL) == DOWNLOAD_DONE);
+	CHECK(empty_sink.Length() == 0);
+
+	// A body larger than the sink allows, and a failure to connect.
+	DownloadMemorySink small_sink(body.size() - 1);
+	StandInTransport too_big(body);
+	CHECK(Run(too_big, small_sink, 0, NULL) == DOWNLOAD_FAILED);
+	StandInTransport offline(body);
+	offline.fail_open = true;
+	DownloadMemorySink offline_sink(100);
+	CHECK(Run(offline, offline_sink, 0, NULL) == DOWNLOAD_FAILED);
+}
+
+
+
+static void TestResume()
+{
+	std::string body = MakeBody(500000, 2);
+	const DownloadUInt64Type have = 123457;
+	std::string prefix = body.substr(0, (size_t)have);
+
+	// The usual case: the server sends only the rest.
+	{
+		StandInTransport transport(body);
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, prefix);
+		Downloader downloader(&transport, &sink, DOWNLOAD_DEFAULT_BUFFER);
+		DownloadStatus status;
+		for (status = downloader.Start("http://example.com/file", have, transport.last_modified.c_str())
+			; status == DOWNLOAD_MORE; status = downloader.Step());
+		CHECK(status == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+		CHECK(transport.open_count == 1 && transport.last_offset == have);
+		CHECK(transport.last_validator == transport.last_modified);
+		CHECK(downloader.ResumeOffset() == have && downloader.ByteCount() == body.size() - have);
+	}
+
+	// Without a validator, the rest isn't even asked for since there's no telling whether it still fits.
+	{
+		StandInTransport transport(body);
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, MakeBody((size_t)have, 3));
+		CHECK(Run(transport, sink, have, NULL) == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+		CHECK(transport.open_count == 1 && transport.last_offset == 0);
+		StandInTransport transport2(body);
+		CHECK(Run(transport2, sink, have, "") == DOWNLOAD_DONE);
+		CHECK(transport2.last_offset == 0);
+	}
+
+	// The resource changed since the part we have was downloaded, so the server sends all of the new one.
+	{
+		std::string new_body = MakeBody(400000, 4);
+		StandInTransport transport(new_body);
+		transport.last_modified = "Mon, 07 Nov 1994 08:49:37 GMT";
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, prefix);
+		CHECK(Run(transport, sink, have, "Sun, 06 Nov 1994 08:49:37 GMT") == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, new_body));
+		CHECK(transport.open_count == 1);
+	}
+
+	// A server without range support sends the whole thing.
+	{
+		StandInTransport transport(body);
+		transport.supports_ranges = false;
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, prefix);
+		CHECK(Run(transport, sink, have, transport.last_modified.c_str()) == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+	}
+
+	// A 206 that starts somewhere other than where the sink's data ends, or that lacks a Content-Range, must not
+	// be appended.  The Downloader asks again for the whole resource instead.
+	for (int variant = 0; variant < 3; ++variant)
+	{
+		StandInTransport transport(body);
+		if (variant == 0)
+			transport.range_skew = -1;
+		else if (variant == 1)
+			transport.range_skew = 7;
+		else
+			transport.send_content_range = false;
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, prefix);
+		CHECK(Run(transport, sink, have, transport.last_modified.c_str()) == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+		CHECK(transport.open_count == 2 && transport.last_offset == 0);
+	}
+}
+
+
+
+static void TestRangeNotSatisfiable()
+{
+	std::string body = MakeBody(70000, 5);
+
+	// The sink already has all of it: nothing more is transferred and the sink is left alone.
+	{
+		StandInTransport transport(body);
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, body);
+		Downloader downloader(&transport, &sink, DOWNLOAD_DEFAULT_BUFFER);
+		CHECK(downloader.Start("http://example.com/file", body.size(), transport.last_modified.c_str()) == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+		CHECK(transport.open_count == 1 && transport.read_count == 0);
+		CHECK(downloader.ResumeOffset() == body.size() && downloader.ByteCount() == 0);
+	}
+
+	// The sink has more than the resource, so it can't be the same version: start over rather than call it done.
+	{
+		StandInTransport transport(body);
+		DownloadMemorySink sink(body.size() + 100);
+		Prefill(sink, body + "trailing junk");
+		CHECK(Run(transport, sink, body.size() + 13, transport.last_modified.c_str()) == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+		CHECK(transport.open_count == 2 && transport.last_offset == 0);
+	}
+
+	// A 416 without the resource's length proves nothing either.
+	{
+		StandInTransport transport(body);
+		transport.send_content_range = false;
+		DownloadMemorySink sink(body.size());
+		Prefill(sink, body);
+		CHECK(Run(transport, sink, body.size(), transport.last_modified.c_str()) == DOWNLOAD_DONE);
+		CHECK(SinkHas(sink, body));
+		CHECK(transport.open_count == 2);
+	}
+}
+
+
+
+int main()
+{
+	TestParseContentRange();
+	TestWhole();
+	TestResume();
+	TestRangeNotSatisfiable();
+	return TEST_RESULT();
+}
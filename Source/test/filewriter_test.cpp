@@ -0,0 +1,162 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Checks FileWriterCache in a temporary directory with a host whose clock is under the test's control: text
+// stays in the buffer until it reaches the maximum age or is flushed, the same file reached by another path
+// is written through the same writer, a change of mode reopens the file, the file opened longest ago is the
+// one closed to make room, and a failed write (to /dev/full) is reported when the text is written out.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "filewriter.h"
+#include "test.h"
+
+class PosixFileWriterHost : public FileWriterHost
+{
+public:
+	unsigned mTick;
+	PosixFileWriterHost() : mTick(0) {}
+
+	void FullPath(const char *aFilespec, char *aBuf, size_t aBufSize)
+	{
+		char *full_path = realpath(aFilespec, NULL);
+		if (!full_path) // It doesn't exist yet, so resolve only its directory.
+		{
+			char dir[FILE_WRITER_PATH_SIZE];
+			const char *name = strrchr(aFilespec, '/');
+			snprintf(dir, sizeof(dir), "%.*s", name ? (int)(name - aFilespec) : 1, name ? aFilespec : ".");
+			if (   !(full_path = realpath(dir, NULL))   )
+			{
+				snprintf(aBuf, aBufSize, "%s", aFilespec);
+				return;
+			}
+			snprintf(aBuf, aBufSize, "%s/%s", full_path, name ? name + 1 : aFilespec);
+		}
+		else
+			snprintf(aBuf, aBufSize, "%s", full_path);
+		free(full_path);
+	}
+
+	unsigned TickCount() {return mTick;}
+};
+
+static char sDir[64];
+
+
+
+static long FileSize(const char *aName)
+{
+	char path[256];
+	struct stat st;
+	snprintf(path, sizeof(path), "%s/%s", sDir, aName);
+	return stat(path, &st) ? -1 : (long)st.st_size;
+}
+
+
+
+static void TestBuffering()
+{
+	PosixFileWriterHost host;
+	FileWriterCache cache(host);
+	char path[128], other_path[128];
+	snprintf(path, sizeof(path), "%s/a.txt", sDir);
+	snprintf(other_path, sizeof(other_path), "%s/./a.txt", sDir);
+	CHECK(cache.Append(path, "one\n", false, 1000));
+	CHECK(cache.Count() == 1 && cache.HasPending() && FileSize("a.txt") == 0); // Opened but still in the buffer.
+	host.mTick += 999;
+	CHECK(cache.Append(other_path, "two\n", false, 1000)); // The same file by another path.
+	CHECK(cache.Count() == 1 && FileSize("a.txt") == 0);
+	host.mTick += 1;
+	CHECK(cache.Append(path, "three\n", false, 1000)); // The oldest text has reached the maximum age.
+	CHECK(!cache.HasPending() && FileSize("a.txt") == 14 && cache.Flushes() == 1);
+	CHECK(cache.Append(path, "four\n", false, 0)); // Written out every time.
+	CHECK(!cache.HasPending() && FileSize("a.txt") == 19);
+	CHECK(cache.Append(path, "five\n", false, 1000));
+	CHECK(cache.FlushAll() && !cache.HasPending() && FileSize("a.txt") == 24 && cache.Count() == 1);
+	CHECK(cache.FlushAll() && cache.Flushes() == 3); // Nothing to write the second time.
+	CHECK(cache.Append(path, "six\r\n", true, 1000)); // Binary mode, so the file is reopened.
+	CHECK(cache.Count() == 1 && cache.Opens() == 2 && FileSize("a.txt") == 24);
+	CHECK(cache.CloseAll() && cache.Count() == 0 && FileSize("a.txt") == 29);
+	CHECK(cache.Appends() == 6 && cache.Bytes() == 29);
+}
+
+
+
+static void TestEviction()
+{
+	PosixFileWriterHost host;
+	FileWriterCache cache(host);
+	char path[128];
+	int i;
+	for (i = 0; i <= FILE_WRITER_MAX; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/file%d.txt", sDir, i);
+		CHECK(cache.Append(path, "text\n", false, 1000));
+	}
+	CHECK(cache.Count() == FILE_WRITER_MAX && cache.Opens() == FILE_WRITER_MAX + 1);
+	CHECK(FileSize("file0.txt") == 5 && FileSize("file1.txt") == 0); // The first was closed to make room.
+	snprintf(path, sizeof(path), "%s/file1.txt", sDir);
+	CHECK(cache.Append(path, "text\n", false, 1000) && cache.Opens() == FILE_WRITER_MAX + 1); // Still open.
+	CHECK(cache.CloseAll());
+	for (i = 0; i <= FILE_WRITER_MAX; ++i)
+	{
+		snprintf(path, sizeof(path), "file%d.txt", i);
+		CHECK(FileSize(path) == (i == 1 ? 10 : 5));
+	}
+	CHECK(!cache.Append("/nonexistent/dir/x.txt", "text\n", false, 1000) && cache.Count() == 0);
+}
+
+
+
+static void TestWriteFailure()
+{
+	PosixFileWriterHost host;
+	FileWriterCache cache(host);
+	if (access("/dev/full", W_OK))
+	{
+		printf("/dev/full not available; skipped\n");
+		return;
+	}
+	CHECK(cache.Append("/dev/full", "text\n", false, 1000)); // Only buffered so far.
+	CHECK(!cache.FlushAll());
+	CHECK(!cache.Append("/dev/full", "text\n", false, 0));
+	CHECK(cache.CloseAll()); // Nothing was left to write.
+	CHECK(cache.Append("/dev/full", "text\n", false, 1000));
+	CHECK(!cache.CloseAll() && cache.Count() == 0);
+}
+
+
+
+int main()
+{
+	strcpy(sDir, "/tmp/filewriter_testXXXXXX");
+	if (!mkdtemp(sDir))
+	{
+		perror("mkdtemp");
+		return 1;
+	}
+	TestBuffering();
+	TestEviction();
+	TestWriteFailure();
+	char command[128];
+	snprintf(command, sizeof(command), "rm -rf %s", sDir);
+	if (system(command)) // Clean up.
+		perror("rm");
+	TEST_RESULT();
+}
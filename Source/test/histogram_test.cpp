@@ -0,0 +1,139 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+
+// Checks that LatencyHistogram's buckets tile the whole 32-bit range without gaps or overlaps, that every
+// value maps to a bucket whose bounds contain it and whose width is within the promised relative error, that
+// percentiles are clamped to the recorded range and to [0, 100], and that CountAtOrAbove() is exact at bucket
+// boundaries and never counts a value below its argument elsewhere.
+
+#include "histogram.h"
+#include "test.h"
+
+static unsigned sSeed = 1;
+
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return (sSeed >> 16) | (sSeed << 16); // The low-order bits of this generator are poor, so swap them out of the way.
+}
+
+
+
+static void TestBuckets()
+{
+	typedef LatencyHistogram H;
+	CHECK(H::BucketLowerBound(0) == 0);
+	CHECK(H::BucketOf(0xFFFFFFFF) == HISTOGRAM_BUCKET_COUNT - 1);
+	CHECK(H::BucketUpperBound(HISTOGRAM_BUCKET_COUNT - 1) == 0xFFFFFFFF);
+	for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; ++b)
+	{
+		unsigned low = H::BucketLowerBound(b), high = H::BucketUpperBound(b);
+		CHECK(low <= high);
+		CHECK(H::BucketOf(low) == b);
+		CHECK(H::BucketOf(high) == b);
+		if (b + 1 < HISTOGRAM_BUCKET_COUNT)
+			CHECK(high + 1 == H::BucketLowerBound(b + 1)); // No gap or overlap with the next bucket.
+		if (b < 2 * HISTOGRAM_SUB_COUNT)
+			CHECK(low == (unsigned)b && high == low); // Small values are exact.
+		else
+			CHECK((double)(high - low + 1) / low <= 1.0 / HISTOGRAM_SUB_COUNT);
+	}
+	for (int i = 0; i < 1000000; ++i)
+	{
+		unsigned value = Random() >> (i % 32); // Every magnitude.
+		int b = H::BucketOf(value);
+		CHECK(b >= 0 && b < HISTOGRAM_BUCKET_COUNT);
+		CHECK(H::BucketLowerBound(b) <= value && value <= H::BucketUpperBound(b));
+	}
+}
+
+
+
+static void TestPercentiles()
+{
+	LatencyHistogram h;
+	CHECK(h.ValueAtPercentile(50) == 0); // Empty.
+	CHECK(h.CountAtOrAbove(0) == 0);
+
+	h.Record(1000);
+	CHECK(h.ValueAtPercentile(0) == 1000); // A single value is every percentile, not its bucket's bounds.
+	CHECK(h.ValueAtPercentile(50) == 1000);
+	CHECK(h.ValueAtPercentile(100) == 1000);
+	CHECK(h.ValueAtPercentile(-5) == 1000);
+	CHECK(h.ValueAtPercentile(250) == 1000);
+
+	h.Reset();
+	for (unsigned v = 1; v <= 100; ++v)
+		h.Record(v * 10);
+	CHECK(h.mCount == 100 && h.mMin == 10 && h.mMax == 1000);
+	CHECK(h.Mean() == 505);
+	CHECK(h.ValueAtPercentile(0) == 10); // Clamped to the minimum rather than its bucket's upper bound.
+	CHECK(h.ValueAtPercentile(100) == 1000);
+	CHECK(h.ValueAtPercentile(1000) == 1000);
+	for (int p = 1; p <= 100; ++p)
+	{
+		// The true value at the p-th percentile is p*10.  The result is the upper bound of its bucket (or mMax),
+		// so it's never less and exceeds it by no more than the bucket's width.
+		unsigned result = h.ValueAtPercentile(p), exact = p * 10;
+		CHECK(result >= exact && result <= LatencyHistogram::BucketUpperBound(LatencyHistogram::BucketOf(exact)));
+		CHECK(p == 1 || result >= h.ValueAtPercentile(p - 1));
+	}
+}
+
+
+
+static void TestCountAtOrAbove()
+{
+	typedef LatencyHistogram H;
+	for (int b = 1; b < HISTOGRAM_BUCKET_COUNT; ++b)
+	{
+		unsigned low = H::BucketLowerBound(b), high = H::BucketUpperBound(b);
+		H h;
+		h.Record(low - 1); // The previous bucket's last value.
+		h.Record(low);
+		h.Record(high);
+		if (b + 1 < HISTOGRAM_BUCKET_COUNT)
+			h.Record(high + 1); // The next bucket's first value.
+		unsigned above = b + 1 < HISTOGRAM_BUCKET_COUNT;
+		CHECK(h.CountAtOrAbove(0) == h.mCount);
+		CHECK(h.CountAtOrAbove(H::BucketLowerBound(b - 1)) == 3 + above); // Exact: each of these is a bucket's lower bound.
+		CHECK(h.CountAtOrAbove(low) == 2 + above);
+		CHECK(h.CountAtOrAbove(low - 1) == (H::BucketLowerBound(b - 1) == low - 1 ? 3 : 2) + above);
+		if (above)
+			CHECK(h.CountAtOrAbove(high + 1) == 1);
+		if (high > low)
+		{
+			// Between the bounds, the bucket holding low and high is left out entirely: low is below the
+			// argument and can't be told apart from high, which isn't.
+			CHECK(h.CountAtOrAbove(low + 1) == above);
+			CHECK(h.CountAtOrAbove(high) == above);
+		}
+	}
+	// The hook's threshold (HOOK_LATENCY_WARNING_US in hook.h) is chosen to be a lower bound.
+	CHECK(H::BucketLowerBound(H::BucketOf(98304)) == 98304);
+}
+
+
+
+int main()
+{
+	TestBuckets();
+	TestPercentiles();
+	TestCountAtOrAbove();
+	return TEST_RESULT();
+}
@@ -0,0 +1,251 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Times the work the keyboard hook does for a key event in a script with 2,000 hotkeys, many of them
+// context-sensitive (#IfWin), in two situations that don't depend on the hook's (vk/sc, modifier) tables:
+// a prefix key is pressed, so PrefixHasNoEnabledSuffixes() must find whether any of its suffixes can fire
+// (which it must search for to the end when the key is used only in an #IfWin section that doesn't apply);
+// and a hotkey whose criteria aren't met is pressed, so CriterionFiringIsCertain() must check its variants and
+// then look for an eclipsed wildcard hotkey.  The old way scans every hotkey and does a window search for each
+// criterion it meets; the new way scans the lists built by Hotkey::CompileDispatchLists() and searches for
+// each criterion at most once per event via HotCriterionMemo.
+//
+// Window searches are modeled by a strstr() over 150 titles.  A real WinExist() or WinActive() must also
+// fetch titles from other processes, so it costs far more, and the gain measured here is a lower bound.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hotmemo.h"
+
+#define HOTKEY_COUNT 2000
+#define CRITERION_COUNT 40
+#define WINDOW_COUNT 150
+#define EVENTS 20000
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+static unsigned sSeed = 1;
+
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+// Simplified versions of the program's structures, with just the members these searches use.
+struct Criterion {char title[32]; char text[1]; bool is_exist, is_not;};
+struct HotkeyVariant {Criterion *criterion; bool enabled; HotkeyVariant *next;};
+struct Hotkey
+{
+	int id, vk, modifier_vk, modifiers, modifiers_lr; // modifiers_lr is set only by hotkeys such as <^c.
+	bool allow_extra_modifiers, key_up;
+	HotkeyVariant *first_variant;
+};
+
+static Criterion sCriterion[CRITERION_COUNT]; // Shared by variants, as SetGlobalHotTitleText() arranges.
+static Hotkey sHotkey[HOTKEY_COUNT];
+static int sPrefixUser[HOTKEY_COUNT], sPrefixUserCount;
+static int sWildcard[HOTKEY_COUNT], sWildcardCount;
+static char sWindow[WINDOW_COUNT][48];
+static HotCriterionMemo sMemo;
+static int sSearches; // Window searches done, for the report.
+
+
+
+static void *WinSearch(const Criterion &aCriterion)
+// Models WinExist(); WinActive() checks only the first window, which stands for the foreground window.
+{
+	++sSearches;
+	for (int i = 0; i < (aCriterion.is_exist ? WINDOW_COUNT : 1); ++i)
+		if (strstr(sWindow[i], aCriterion.title))
+			return sWindow[i];
+	return NULL;
+}
+
+
+
+static bool CriterionAllows(const Criterion &aCriterion, bool aUseMemo)
+{
+	void *found;
+	if (!aUseMemo || !sMemo.Find(aCriterion.title, aCriterion.text, aCriterion.is_exist, found))
+	{
+		found = WinSearch(aCriterion);
+		if (aUseMemo)
+			sMemo.Store(aCriterion.title, aCriterion.text, aCriterion.is_exist, found);
+	}
+	return aCriterion.is_not ? !found : found != NULL;
+}
+
+
+
+static HotkeyVariant *CriterionAllowsFiring(Hotkey &aHotkey, bool aUseMemo)
+// Same as Hotkey::CriterionAllowsFiring(): the first criterion variant allowed to fire wins, else the global one.
+{
+	HotkeyVariant *vp_to_fire = NULL;
+	for (HotkeyVariant *vp = aHotkey.first_variant; vp; vp = vp->next)
+		if (vp->enabled && (!vp->criterion || CriterionAllows(*vp->criterion, aUseMemo)))
+		{
+			if (vp->criterion)
+				return vp;
+			vp_to_fire = vp;
+		}
+	return vp_to_fire;
+}
+
+
+
+static bool PrefixHasNoEnabledSuffixes(int aVK, bool aCompiled)
+{
+	int count = aCompiled ? sPrefixUserCount : HOTKEY_COUNT;
+	for (int i = 0; i < count; ++i)
+	{
+		Hotkey &hk = sHotkey[aCompiled ? sPrefixUser[i] : i];
+		if (aVK != hk.modifier_vk)
+			continue;
+		for (HotkeyVariant *vp = hk.first_variant; vp; vp = vp->next)
+			if (vp->enabled && (!vp->criterion || CriterionAllows(*vp->criterion, aCompiled)))
+				return false;
+	}
+	return true;
+}
+
+
+
+static bool CriterionFiringIsCertain(Hotkey &aHotkey, bool aCompiled)
+{
+	if (CriterionAllowsFiring(aHotkey, aCompiled))
+		return true;
+	if (aHotkey.modifier_vk)
+		return false;
+	int count = aCompiled ? sWildcardCount : HOTKEY_COUNT;
+	for (int i = 0; i < count; ++i)
+	{
+		Hotkey &hk2 = sHotkey[aCompiled ? sWildcard[i] : i];
+		if (   hk2.allow_extra_modifiers && !hk2.modifier_vk // Always true of the compiled list.
+			&& hk2.vk == aHotkey.vk && hk2.key_up == aHotkey.key_up && hk2.id != aHotkey.id
+			&& (aHotkey.allow_extra_modifiers || !((aHotkey.modifiers ^ hk2.modifiers) & hk2.modifiers))
+			&& CriterionAllowsFiring(hk2, aCompiled)   )
+			return true;
+	}
+	return false;
+}
+
+
+
+static void Build()
+// As in a script, the hotkeys come in #IfWin sections of 50, so a criterion is usually shared by many hotkeys.
+// Half the hotkeys have a variant for their section's criterion, and a third of those have one or two more
+// variants from other sections.  Only a few of the criteria match.  5% of the hotkeys use a prefix key (one
+// of 8), 2% a left/right modifier, and 5% are wildcards.
+{
+	int i;
+	for (i = 0; i < WINDOW_COUNT; ++i)
+		sprintf(sWindow[i], "Window %d - Application %d", i, i % 17);
+	for (i = 0; i < CRITERION_COUNT; ++i)
+	{
+		Criterion &c = sCriterion[i];
+		sprintf(c.title, (i % 10) ? "Program %d" : "Application %d", i); // Titles of the first kind never match.
+		c.is_exist = i % 3 == 0;
+		c.is_not = false;
+	}
+	for (i = 0; i < HOTKEY_COUNT; ++i)
+	{
+		Hotkey &hk = sHotkey[i];
+		hk.id = i;
+		hk.vk = 1 + Random() % 254;
+		hk.modifiers = Random() % 16;
+		bool has_criterion = Random() % 2;
+		hk.modifiers_lr = Random() % 50 == 0 ? 1 << Random() % 8 : 0;
+		hk.modifier_vk = Random() % 20 == 0 ? 0x60 + Random() % 8 : 0;
+		if (i >= 50 && i < 80) // A prefix key used only in a section whose criterion never matches.
+			hk.modifier_vk = 0x70, has_criterion = true;
+		hk.allow_extra_modifiers = !hk.modifier_vk && Random() % 20 == 0;
+		hk.key_up = false;
+		hk.first_variant = NULL;
+		int variant_count = has_criterion && hk.modifier_vk != 0x70 && Random() % 3 == 0 ? 2 + Random() % 2 : 1;
+		for (int v = 0; v < variant_count; ++v)
+		{
+			HotkeyVariant *vp = new HotkeyVariant;
+			vp->criterion = !has_criterion ? NULL
+				: &sCriterion[v ? Random() % CRITERION_COUNT : i / 50];
+			vp->enabled = true;
+			vp->next = hk.first_variant;
+			hk.first_variant = vp;
+		}
+	}
+	// Same as Hotkey::CompileDispatchLists():
+	for (i = 0; i < HOTKEY_COUNT; ++i)
+	{
+		if (sHotkey[i].modifier_vk || sHotkey[i].modifiers_lr)
+			sPrefixUser[sPrefixUserCount++] = i;
+		if (sHotkey[i].allow_extra_modifiers && !sHotkey[i].modifier_vk)
+			sWildcard[sWildcardCount++] = i;
+	}
+}
+
+
+
+int main()
+{
+	Build();
+	int criterion_hotkey[HOTKEY_COUNT], criterion_hotkey_count = 0, i;
+	for (i = 0; i < HOTKEY_COUNT; ++i)
+		if (sHotkey[i].first_variant->criterion && !CriterionAllowsFiring(sHotkey[i], false))
+			criterion_hotkey[criterion_hotkey_count++] = i;
+	printf("%d hotkeys (%d prefix/modifier users, %d wildcards, %d whose criteria aren't met), %d windows\n"
+		, HOTKEY_COUNT, sPrefixUserCount, sWildcardCount, criterion_hotkey_count, WINDOW_COUNT);
+
+	static const char *sKindName[] = {"prefix key:", "inactive prefix:", "criterion not met:"};
+	for (int kind = 0; kind < 3; ++kind)
+	{
+		double time[2];
+		int searches[2];
+		for (int compiled = 0; compiled < 2; ++compiled)
+		{
+			int result = 0;
+			sSeed = 2;
+			sSearches = 0;
+			double start = Seconds();
+			for (i = 0; i < EVENTS; ++i)
+			{
+				sMemo.NewEvent(); // As the hook does at the start of each event.
+				if (kind == 0)
+					result += PrefixHasNoEnabledSuffixes(0x60 + Random() % 8, compiled != 0);
+				else if (kind == 1)
+					result += PrefixHasNoEnabledSuffixes(0x70, compiled != 0);
+				else
+					result += CriterionFiringIsCertain(sHotkey[criterion_hotkey[Random() % criterion_hotkey_count]], compiled != 0);
+			}
+			time[compiled] = Seconds() - start;
+			searches[compiled] = sSearches;
+			sSink = result;
+		}
+		printf("%-18s old %8.1f ns (%5.1f searches), compiled+memo %7.1f ns (%4.1f searches) (%.1fx faster)\n"
+			, sKindName[kind]
+			, time[0] * 1e9 / EVENTS, (double)searches[0] / EVENTS
+			, time[1] * 1e9 / EVENTS, (double)searches[1] / EVENTS, time[0] / time[1]);
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Checks HotCriterionMemo against a record of what was stored during the current event: every pair found
+// must have been stored with that result since the last NewEvent(), and nothing stored before it may be
+// found.  A pool of titles larger than the table forces collisions.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hotmemo.h"
+#include "test.h"
+
+#define TITLE_COUNT 200
+
+static unsigned sSeed = 1;
+
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+static char sTitle[TITLE_COUNT][16]; // Each criterion is identified by its address, as in the program.
+static const char *sText[2] = {"", "Some text"};
+
+struct Stored {bool valid; void *found;};
+static Stored sStored[TITLE_COUNT][2][2]; // What was stored during this event, by title, text and is_exist.
+
+
+
+static void NewEvent(HotCriterionMemo &aMemo)
+{
+	aMemo.NewEvent();
+	memset(sStored, 0, sizeof(sStored));
+}
+
+
+
+static void Exercise(HotCriterionMemo &aMemo, int aEvents)
+{
+	for (int event = 0; event < aEvents; ++event)
+	{
+		NewEvent(aMemo);
+		for (int n = Random() % 100; n > 0; --n)
+		{
+			int t = Random() % TITLE_COUNT, x = Random() & 1;
+			bool is_exist = Random() & 1;
+			Stored &stored = sStored[t][x][is_exist];
+			void *found = (void *)&found; // Something other than the expected result.
+			if (aMemo.Find(sTitle[t], sText[x], is_exist, found))
+				CHECK(stored.valid && found == stored.found);
+			else
+			{
+				CHECK(found == (void *)&found); // Left unchanged.
+				found = (Random() & 1) ? (void *)(size_t)(Random() | 1) : NULL; // NULL is a valid result.
+				aMemo.Store(sTitle[t], sText[x], is_exist, found);
+				stored.valid = true;
+				stored.found = found;
+				CHECK(aMemo.Find(sTitle[t], sText[x], is_exist, found) && found == stored.found);
+			}
+		}
+	}
+}
+
+
+
+static void TestClear()
+{
+	HotCriterionMemo memo;
+	void *found;
+	memo.Store(sTitle[0], sText[0], false, NULL);
+	CHECK(memo.Find(sTitle[0], sText[0], false, found) && found == NULL);
+	CHECK(!memo.Find(sTitle[0], sText[0], true, found)); // WinExist and WinActive results are kept apart.
+	CHECK(!memo.Find(sTitle[0], sText[1], false, found));
+	memo.Clear();
+	CHECK(!memo.Find(sTitle[0], sText[0], false, found));
+}
+
+
+
+int main()
+{
+	for (int i = 0; i < TITLE_COUNT; ++i)
+		sprintf(sTitle[i], "Title %d", i);
+	HotCriterionMemo memo;
+	void *found;
+	CHECK(!memo.Find(sTitle[0], sText[0], false, found)); // Nothing matches before the first Store().
+	Exercise(memo, 20000);
+	TestClear();
+	TEST_RESULT();
+}
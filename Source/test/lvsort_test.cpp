@@ -0,0 +1,160 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks each of the index sorts against the order a stable comparison sort produces, for random keys
+// with many duplicates, extreme values, and both directions.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "lvsort.h"
+#include "test.h"
+
+#define KEY_COUNT 5000
+
+static unsigned long long sState = 88172645463325252ULL;
+static unsigned long long Rand64()
+{
+	sState ^= sState << 13;
+	sState ^= sState >> 7;
+	sState ^= sState << 17;
+	return sState;
+}
+
+
+
+template <typename T> static bool IsSorted(const int *aIndex, int aCount, const T *aKey, bool aAscending)
+// Returns true if aIndex is a permutation of 0..aCount-1 ordered by aKey, with ties in their original order.
+{
+	char *seen = (char *)calloc(aCount, 1);
+	bool result = true;
+	for (int i = 0; i < aCount && result; ++i)
+	{
+		if (aIndex[i] < 0 || aIndex[i] >= aCount || seen[aIndex[i]]++)
+			result = false;
+		else if (i)
+		{
+			T a = aKey[aIndex[i - 1]], b = aKey[aIndex[i]];
+			if (aAscending ? a > b : a < b)
+				result = false;
+			else if (a == b && aIndex[i - 1] > aIndex[i])
+				result = false;
+		}
+	}
+	free(seen);
+	return result;
+}
+
+
+
+static void TestInt64()
+{
+	static SortInt64Type key[KEY_COUNT];
+	static int index[KEY_COUNT];
+	for (int round = 0; round < 8; ++round)
+	{
+		for (int i = 0; i < KEY_COUNT; ++i)
+		{
+			switch (round % 4)
+			{
+			case 0: key[i] = (SortInt64Type)Rand64(); break; // Full range, both signs.
+			case 1: key[i] = (SortInt64Type)(Rand64() % 50) - 25; break; // Many duplicates.
+			case 2: key[i] = (Rand64() & 1) ? (SortInt64Type)(~0ULL >> 1) : -(SortInt64Type)(~0ULL >> 1) - 1; break; // Extremes.
+			default: key[i] = 7; // All the same, which skips every radix pass.
+			}
+			index[i] = i;
+		}
+		bool ascending = round < 4;
+		CHECK(SortIndexByInt64(index, KEY_COUNT, key, ascending));
+		CHECK(IsSorted(index, KEY_COUNT, key, ascending));
+	}
+}
+
+
+
+static void TestDouble()
+{
+	static double key[KEY_COUNT];
+	static int index[KEY_COUNT];
+	for (int round = 0; round < 6; ++round)
+	{
+		for (int i = 0; i < KEY_COUNT; ++i)
+		{
+			switch (round % 3)
+			{
+			case 0: key[i] = ((double)(Rand64() >> 11) / (1ULL << 53) - 0.5) * pow(10.0, (int)(Rand64() % 40) - 20); break;
+			case 1: key[i] = (int)(Rand64() % 7) - 3; break;
+			default: key[i] = (Rand64() & 1) ? -0.0 : 0.0; // Must compare equal, so the original order is kept.
+			}
+			index[i] = i;
+		}
+		bool ascending = round < 3;
+		CHECK(SortIndexByDouble(index, KEY_COUNT, key, ascending));
+		CHECK(IsSorted(index, KEY_COUNT, key, ascending));
+	}
+}
+
+
+
+static int CompareStr(const void *aKey1, const void *aKey2, void *aParam)
+{
+	++*(int *)aParam;
+	return strcmp((const char *)aKey1, (const char *)aKey2);
+}
+
+static void TestKey()
+{
+	static char text[KEY_COUNT][4];
+	static const void *key[KEY_COUNT];
+	static int index[KEY_COUNT];
+	for (int direction = 0; direction < 2; ++direction)
+	{
+		for (int i = 0; i < KEY_COUNT; ++i)
+		{
+			text[i][0] = 'a' + Rand64() % 3;
+			text[i][1] = 'a' + Rand64() % 3;
+			text[i][2] = '\0';
+			key[i] = text[i];
+			index[i] = i;
+		}
+		int compare_count = 0;
+		CHECK(SortIndexByKey(index, KEY_COUNT, key, CompareStr, &compare_count, direction == 0));
+		CHECK(compare_count > 0);
+		bool ok = true;
+		for (int i = 1; i < KEY_COUNT && ok; ++i)
+		{
+			int result = strcmp(text[index[i - 1]], text[index[i]]);
+			if (direction ? result < 0 : result > 0)
+				ok = false;
+			else if (!result && index[i - 1] > index[i])
+				ok = false;
+		}
+		CHECK(ok);
+	}
+	int one = 0;
+	CHECK(SortIndexByKey(index, 1, key, CompareStr, &one, true) && one == 0); // Nothing to compare.
+}
+
+
+
+int main()
+{
+	TestInt64();
+	TestDouble();
+	TestKey();
+	return TEST_RESULT();
+}
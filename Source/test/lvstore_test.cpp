@@ -0,0 +1,260 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks ListViewStore against a plain model (an array of rows of strings) through a long series of
+// pseudo-random inserts, deletes, edits, column changes, filters and sorts.  The sorts are done the way
+// LV_Sort() does them for a virtual ListView: by sorting storage positions with SortIndexByKey() and then
+// calling Reorder().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "lvstore.h"
+#include "lvsort.h"
+#include "test.h"
+
+#define MODEL_MAX_ROWS 300
+#define MODEL_MAX_COLS 6
+#define MODEL_TEXT_SIZE 8
+
+static char sModel[MODEL_MAX_ROWS][MODEL_MAX_COLS][MODEL_TEXT_SIZE]; // All rows, in storage order.
+static int sModelRows = 0;
+static int sFilterColumn = -1; // -1 means no filter.
+static char sFilterText[MODEL_TEXT_SIZE];
+static bool sVisible[MODEL_MAX_ROWS]; // Which rows the filter lets through.
+
+static unsigned sSeed = 12345;
+static unsigned Rand(unsigned aLimit)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return (sSeed >> 16) % aLimit;
+}
+
+static void RandomText(char *aBuf)
+{
+	int length = Rand(4); // Zero length makes a blank cell.
+	for (int i = 0; i < length; ++i)
+		aBuf[i] = "abcABC12"[Rand(8)];
+	aBuf[length] = '\0';
+}
+
+static bool ContainsNoCase(const char *aText, const char *aFind)
+{
+	for (; ; ++aText)
+	{
+		const char *t = aText, *f = aFind;
+		for (; *f && tolower((unsigned char)*t) == tolower((unsigned char)*f); ++t, ++f);
+		if (!*f)
+			return true;
+		if (!*aText)
+			return false;
+	}
+}
+
+static int ModelDisplayed(int *aStorage) // Fills aStorage with the storage index of each displayed row.
+{
+	int count = 0;
+	for (int r = 0; r < sModelRows; ++r)
+		if (sFilterColumn < 0 || sVisible[r])
+			aStorage[count++] = r;
+	return count;
+}
+
+static void ModelApplyFilter()
+{
+	for (int r = 0; r < sModelRows; ++r)
+		sVisible[r] = *sModel[r][sFilterColumn] && ContainsNoCase(sModel[r][sFilterColumn], sFilterText);
+}
+
+
+
+static bool Matches(ListViewStore &aStore)
+{
+	int storage[MODEL_MAX_ROWS];
+	int count = ModelDisplayed(storage);
+	if (aStore.Count() != count || aStore.TotalCount() != sModelRows)
+		return false;
+	for (int i = 0; i < count; ++i)
+		for (int c = 0; c < MODEL_MAX_COLS; ++c)
+			if (strcmp(aStore.GetText(i, c), sModel[storage[i]][c]))
+				return false;
+	for (int r = 0; r < sModelRows; ++r)
+		for (int c = 0; c < MODEL_MAX_COLS; ++c)
+			if (strcmp(aStore.GetStoredText(r, c), sModel[r][c]))
+				return false;
+	return aStore.GetText(count, 0) == NULL && aStore.GetStoredText(sModelRows, 0) == NULL;
+}
+
+
+
+static int CompareText(const void *aKey1, const void *aKey2, void *aParam)
+{
+	return strcmp((const char *)aKey1, (const char *)aKey2);
+}
+
+
+
+static void TestAgainstModel()
+{
+	ListViewStore store;
+	int storage[MODEL_MAX_ROWS], displayed, row, c, r;
+	char text[MODEL_TEXT_SIZE];
+	for (int step = 0; step < 20000; ++step)
+	{
+		displayed = ModelDisplayed(storage);
+		switch (Rand(10))
+		{
+		case 0: case 1: case 2: // Insert.
+			if (sModelRows == MODEL_MAX_ROWS)
+				break;
+			row = Rand(displayed + 2); // Sometimes beyond the end, which appends.
+			if (row > displayed)
+				row = displayed;
+			{
+				int storage_index = row < displayed ? storage[row] : sModelRows;
+				memmove(sModel[storage_index + 1], sModel[storage_index], (sModelRows - storage_index) * sizeof(sModel[0]));
+				memmove(sVisible + storage_index + 1, sVisible + storage_index, (sModelRows - storage_index) * sizeof(bool));
+				memset(sModel[storage_index], 0, sizeof(sModel[0]));
+				sVisible[storage_index] = true; // New rows are displayed until the filter is next applied.
+				++sModelRows;
+			}
+			CHECK(store.Insert(row) == row);
+			break;
+		case 3: // Delete.
+			if (!displayed)
+			{
+				CHECK(!store.Delete(0));
+				break;
+			}
+			row = Rand(displayed);
+			r = storage[row];
+			memmove(sModel[r], sModel[r + 1], (sModelRows - r - 1) * sizeof(sModel[0]));
+			memmove(sVisible + r, sVisible + r + 1, (sModelRows - r - 1) * sizeof(bool));
+			--sModelRows;
+			CHECK(store.Delete(row));
+			break;
+		case 4: case 5: case 6: // Set text.
+			if (!displayed)
+				break;
+			row = Rand(displayed);
+			c = Rand(MODEL_MAX_COLS - 1); // The last column is left for InsertColumn() to shift into.
+			RandomText(text);
+			strcpy(sModel[storage[row]][c], text);
+			CHECK(store.SetText(row, c, text));
+			break;
+		case 7: // Insert or delete a column, which shifts the ones to its right.
+			c = Rand(MODEL_MAX_COLS - 1);
+			if (Rand(2))
+			{
+				for (r = 0; r < sModelRows; ++r)
+				{
+					memmove(sModel[r][c + 1], sModel[r][c], (MODEL_MAX_COLS - 1 - c) * MODEL_TEXT_SIZE);
+					*sModel[r][c] = '\0';
+					*sModel[r][MODEL_MAX_COLS - 1] = '\0'; // Keep the last column blank, as documented above.
+				}
+				if (sFilterColumn >= c)
+					++sFilterColumn;
+				CHECK(store.InsertColumn(c));
+				store.DeleteColumn(MODEL_MAX_COLS - 1); // Mirrors the blanking of the last column above.
+				if (sFilterColumn == MODEL_MAX_COLS - 1)
+					sFilterColumn = -1;
+			}
+			else
+			{
+				for (r = 0; r < sModelRows; ++r)
+				{
+					memmove(sModel[r][c], sModel[r][c + 1], (MODEL_MAX_COLS - 1 - c) * MODEL_TEXT_SIZE);
+					*sModel[r][MODEL_MAX_COLS - 1] = '\0';
+				}
+				if (sFilterColumn == c)
+					sFilterColumn = -1;
+				else if (sFilterColumn > c)
+					--sFilterColumn;
+				store.DeleteColumn(c);
+			}
+			break;
+		case 8: // Filter.
+			if (Rand(3))
+			{
+				c = Rand(MODEL_MAX_COLS - 1);
+				text[0] = "abc12"[Rand(5)];
+				text[1] = '\0';
+				sFilterColumn = c;
+				strcpy(sFilterText, text);
+				ModelApplyFilter();
+				CHECK(store.SetFilter(c, text));
+			}
+			else
+			{
+				sFilterColumn = -1;
+				CHECK(store.SetFilter(0, ""));
+			}
+			break;
+		case 9: // Sort by a column, as LV_Sort() does it.
+		{
+			c = Rand(MODEL_MAX_COLS);
+			bool ascending = Rand(2);
+			int count = store.TotalCount();
+			int *index = (int *)malloc((count + 1) * sizeof(int));
+			const void **key = (const void **)malloc((count + 1) * sizeof(void *));
+			for (r = 0; r < count; ++r)
+			{
+				index[r] = r;
+				key[r] = store.GetStoredText(r, c);
+			}
+			CHECK(SortIndexByKey(index, count, key, CompareText, NULL, ascending));
+			// Verify stability and order, then apply the same order to the model:
+			for (r = 1; r < count; ++r)
+			{
+				int result = strcmp((const char *)key[index[r - 1]], (const char *)key[index[r]]);
+				CHECK(ascending ? result <= 0 : result >= 0);
+				if (!result)
+					CHECK(index[r - 1] < index[r]);
+			}
+			static char sorted[MODEL_MAX_ROWS][MODEL_MAX_COLS][MODEL_TEXT_SIZE];
+			for (r = 0; r < count; ++r)
+				memcpy(sorted[r], sModel[index[r]], sizeof(sModel[0]));
+			memcpy(sModel, sorted, count * sizeof(sModel[0]));
+			if (sFilterColumn >= 0)
+				ModelApplyFilter();
+			CHECK(store.Reorder(index));
+			free(index);
+			free(key);
+			break;
+		}
+		}
+		if (!Matches(store))
+		{
+			fprintf(stderr, "Store differs from the model after step %d.\n", step);
+			++sTestFailures;
+			return;
+		}
+	}
+	store.DeleteAll();
+	sModelRows = 0;
+	sFilterColumn = -1;
+	CHECK(Matches(store));
+}
+
+
+
+int main()
+{
+	TestAgainstModel();
+	return TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Times finding menu items by name in menus of various sizes, as the Menu command and A_ThisMenuItemPos do:
+// by searching the list of items (which is what UserMenu::FindItem() did for every lookup before menus were
+// indexed, and still does for short menus), and by MenuNameIndex.  Also times building a menu item by item,
+// which includes the index's growth.  strcasecmp() stands in for lstrcmpi(), which is slower, so the figures
+// understate the cost of searching.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "menuindex.h"
+
+#define LOOKUPS 200000
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+class UserMenuItem
+{
+public:
+	char mName[32];
+	UserMenuItem *mNextMenuItem;
+};
+
+static bool NameMatches(UserMenuItem *aItem, const char *aName)
+{
+	return !strcasecmp(aItem->mName, aName);
+}
+
+
+
+int main()
+{
+	static const int sMenuSize[] = {MENU_NAME_INDEX_MIN_ITEMS, 100, 1000, 10000};
+	static char probe[64][32];
+	for (int s = 0; s < (int)(sizeof(sMenuSize) / sizeof(sMenuSize[0])); ++s)
+	{
+		int item_count = sMenuSize[s];
+		UserMenuItem *item = new UserMenuItem[item_count];
+		for (int i = 0; i < item_count; ++i)
+		{
+			sprintf(item[i].mName, "Recent File %d", i + 1);
+			item[i].mNextMenuItem = i + 1 < item_count ? item + i + 1 : NULL;
+		}
+		for (int i = 0; i < 64; ++i) // Mostly names that are present, in a different case; some aren't.
+			sprintf(probe[i], i % 8 ? "recent FILE %d" : "Missing %d", (i * 7919) % item_count + 1);
+		int found = 0, i, lookups = LOOKUPS / (item_count / 100 + 1); // Fewer for longer menus, since searching is so slow.
+		double start, build, search, find;
+
+		start = Seconds();
+		MenuNameIndex index;
+		for (int repeat = 0; repeat < 10; ++repeat)
+		{
+			index.Create();
+			for (i = 0; i < item_count; ++i)
+				index.Add(item + i, item[i].mName);
+		}
+		build = (Seconds() - start) / 10;
+
+		start = Seconds();
+		for (i = 0; i < lookups; ++i)
+		{
+			UserMenuItem *mi;
+			for (mi = item; mi && !NameMatches(mi, probe[i & 63]); mi = mi->mNextMenuItem);
+			found += mi != NULL;
+		}
+		search = Seconds() - start;
+
+		start = Seconds();
+		for (i = 0; i < lookups; ++i)
+		{
+			UserMenuItem *mi;
+			index.Find(probe[i & 63], NameMatches, mi);
+			found += mi != NULL;
+		}
+		find = Seconds() - start;
+		sSink = found;
+
+		printf("%5d items: build index %8.1f us (%6u bytes), search list %8.1f ns, index %5.1f ns (%.0fx faster)\n"
+			, item_count, build * 1e6, (unsigned)index.MemoryUsed(), search * 1e9 / lookups, find * 1e9 / lookups
+			, search / find);
+		delete [] item;
+	}
+	return 0;
+}
@@ -0,0 +1,215 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks MenuNameIndex against a search of the list of items, as UserMenu::FindItem() would otherwise do,
+// while items are added, removed and renamed at random.  Enough items are added to make the table grow
+// several times, and removals from the middle of runs of colliding slots check that no search stops short.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <vector>
+#include "menuindex.h"
+#include "test.h"
+
+
+
+class UserMenuItem
+{
+public:
+	char mName[32];
+};
+
+static std::vector<UserMenuItem *> sItems; // The menu's list, in no particular order.
+static int sAnswered;
+
+
+
+static bool NameMatches(UserMenuItem *aItem, const char *aName)
+{
+	return !strcasecmp(aItem->mName, aName);
+}
+
+
+
+static UserMenuItem *SearchList(const char *aName)
+{
+	for (size_t i = 0; i < sItems.size(); ++i)
+		if (NameMatches(sItems[i], aName))
+			return sItems[i];
+	return NULL;
+}
+
+
+
+static bool HasUnhashableName()
+{
+	unsigned hash;
+	for (size_t i = 0; i < sItems.size(); ++i)
+		if (!MenuNameIndex::Hash(sItems[i]->mName, hash))
+			return true;
+	return false;
+}
+
+
+
+static void RandomName(char *aBuf, bool aUnhashable)
+{
+	// A small alphabet and mixed case make collisions between names (and duplicate names) likely.
+	int length = 1 + rand() % 5;
+	for (int i = 0; i < length; ++i)
+		aBuf[i] = "aBcD&- "[rand() % 7];
+	aBuf[length] = '\0';
+	if (aUnhashable)
+		aBuf[rand() % length] = (char)0xE9; // e with an acute accent in Windows-1252.
+}
+
+
+
+static void CheckFind(MenuNameIndex &aIndex, const char *aName)
+{
+	UserMenuItem *found;
+	unsigned hash;
+	bool answered = aIndex.Find(aName, NameMatches, found);
+	CHECK(answered == (aIndex.IsCreated() && !HasUnhashableName() && MenuNameIndex::Hash(aName, hash)));
+	if (answered)
+	{
+		CHECK(found == SearchList(aName));
+		++sAnswered;
+	}
+}
+
+
+
+static void TestHash()
+{
+	unsigned a, b;
+	CHECK(MenuNameIndex::Hash("Open Folder", a) && MenuNameIndex::Hash("oPEN fOLDER", b) && a == b);
+	CHECK(MenuNameIndex::Hash("Open Folder2", b) && a != b);
+	CHECK(MenuNameIndex::Hash("", a));
+	CHECK(!MenuNameIndex::Hash("Caf\xe9", a));
+	CHECK(!MenuNameIndex::Hash("Tab\there", a));
+	CHECK(MenuNameIndex::Hash("~!@#$%^&*()_+ {}", a));
+}
+
+
+
+static void TestAgainstList()
+{
+	MenuNameIndex index;
+	char name[32];
+	CheckFind(index, "x"); // Not created yet, so it declines.
+	srand(4321);
+	for (int op = 0; op < 60000; ++op)
+	{
+		int what = rand() % 100;
+		if (what < 50 || sItems.empty())
+		{
+			// Add an item, unless one by that name exists (names are unique within a menu).
+			RandomName(name, false);
+			if (SearchList(name))
+				continue;
+			UserMenuItem *item = new UserMenuItem;
+			strcpy(item->mName, name);
+			sItems.push_back(item);
+			index.Add(item, item->mName);
+		}
+		else if (what < 72)
+		{
+			// Remove an item, then either delete it or rename it the way UserMenu::UpdateName() does.
+			size_t i = rand() % sItems.size();
+			UserMenuItem *item = sItems[i];
+			index.Remove(item, item->mName);
+			RandomName(name, false);
+			if (what < 64 || SearchList(name))
+			{
+				sItems[i] = sItems.back();
+				sItems.pop_back();
+				delete item;
+			}
+			else
+			{
+				strcpy(item->mName, name);
+				index.Add(item, item->mName);
+			}
+		}
+		else if (what == 75 && rand() % 20 == 0)
+		{
+			// Recreate it, as UserMenu::BuildNameIndex() does.
+			CHECK(index.Create());
+			for (size_t i = 0; i < sItems.size(); ++i)
+				index.Add(sItems[i], sItems[i]->mName);
+		}
+		else
+		{
+			RandomName(name, rand() % 50 == 0); // Looking up a name that can't be hashed.
+			CheckFind(index, name);
+			if (!sItems.empty())
+				CheckFind(index, sItems[rand() % sItems.size()]->mName);
+		}
+		if (op == 1000)
+		{
+			CHECK(index.Create());
+			for (size_t i = 0; i < sItems.size(); ++i)
+				index.Add(sItems[i], sItems[i]->mName);
+		}
+	}
+	CHECK(sItems.size() > 1000); // Confirms that the table had to grow.
+	CHECK(sAnswered > 10000);
+	for (size_t i = 0; i < sItems.size(); ++i)
+		CheckFind(index, sItems[i]->mName);
+
+	// While any item's name can't be hashed, the index declines, but it resumes answering once that item is gone.
+	UserMenuItem *unhashable = new UserMenuItem;
+	strcpy(unhashable->mName, "Caf\xe9");
+	sItems.push_back(unhashable);
+	index.Add(unhashable, unhashable->mName);
+	sAnswered = 0;
+	CheckFind(index, sItems[0]->mName);
+	CHECK(sAnswered == 0);
+	strcpy(name, sItems[0]->mName);
+	index.Remove(sItems[0], sItems[0]->mName); // Renaming a hashable item to an unhashable name.
+	sItems[0]->mName[0] = (char)0xE9;
+	index.Add(sItems[0], sItems[0]->mName);
+	index.Remove(unhashable, unhashable->mName);
+	sItems.pop_back();
+	delete unhashable;
+	CheckFind(index, sItems[1]->mName);
+	CHECK(sAnswered == 0);
+	index.Remove(sItems[0], sItems[0]->mName);
+	strcpy(sItems[0]->mName, name);
+	index.Add(sItems[0], sItems[0]->mName);
+	for (size_t i = 0; i < sItems.size(); ++i)
+		CheckFind(index, sItems[i]->mName);
+	CHECK(sAnswered == (int)sItems.size());
+
+	for (size_t i = 0; i < sItems.size(); ++i)
+		delete sItems[i];
+	sItems.clear();
+	index.Free();
+	CheckFind(index, "x");
+}
+
+
+
+int main()
+{
+	TestHash();
+	TestAgainstList();
+	return TEST_RESULT();
+}
@@ -0,0 +1,106 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Times each numconv.h function against the C runtime function it replaces, on the kinds of values scripts
+// typically produce.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "numconv.h"
+
+#define ITERATIONS 2000000
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile unsigned sSink; // Keeps the compiler from discarding the work.
+
+static void Report(const char *aWhat, double aFast, double aRuntime)
+{
+	printf("%-28s %7.1f ns vs. %7.1f ns for the C runtime (%.1fx)\n", aWhat
+		, aFast * 1e9 / ITERATIONS, aRuntime * 1e9 / ITERATIONS, aRuntime / aFast);
+}
+
+
+
+int main()
+{
+	static NumInt64Type int_value[1024];
+	static double double_value[1024];
+	static char decimal_text[1024][32];
+	unsigned seed = 1;
+	for (int i = 0; i < 1024; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		int_value[i] = (NumInt64Type)(seed >> 4) - 100000000;
+		double_value[i] = (double)(NumInt64Type)(seed % 10000000) / 1000.0;
+		snprintf(decimal_text[i], sizeof(decimal_text[i]), "%0.3f", double_value[i]);
+	}
+	char buf[64];
+	double start, fast;
+	int i;
+
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+		sSink += Int64ToDecimal(int_value[i & 1023], buf)[1];
+	fast = Seconds() - start;
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+	{
+		snprintf(buf, sizeof(buf), "%lld", (long long)int_value[i & 1023]);
+		sSink += buf[1];
+	}
+	Report("Int64ToDecimal", fast, Seconds() - start);
+
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+		sSink += UInt64ToHex((NumUInt64Type)int_value[i & 1023], buf)[1];
+	fast = Seconds() - start;
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+	{
+		snprintf(buf, sizeof(buf), "%llx", (unsigned long long)int_value[i & 1023]);
+		sSink += buf[1];
+	}
+	Report("UInt64ToHex", fast, Seconds() - start);
+
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+		sSink += DoubleToFixed(double_value[i & 1023], 6, buf);
+	fast = Seconds() - start;
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+		sSink += snprintf(buf, sizeof(buf), "%0.6f", double_value[i & 1023]);
+	Report("DoubleToFixed (%0.6f)", fast, Seconds() - start);
+
+	double d;
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+		sSink += DecimalToDouble(decimal_text[i & 1023], d);
+	fast = Seconds() - start;
+	start = Seconds();
+	for (i = 0; i < ITERATIONS; ++i)
+		sSink += (unsigned)atof(decimal_text[i & 1023]);
+	Report("DecimalToDouble", fast, Seconds() - start);
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Uses the C runtime as an oracle for numconv.h: every result the fast functions produce must be identical
+// to what printf() or atof() produces for the same input, and the fast functions may decline (return -1 or
+// false) but never disagree.  Inputs include random values, boundaries and the cases near rounding ties that
+// DoubleToFixed() is designed to decline.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "numconv.h"
+#include "test.h"
+
+static unsigned long long sState = 0x9E3779B97F4A7C15ULL;
+static unsigned long long Rand64()
+{
+	sState ^= sState << 13;
+	sState ^= sState >> 7;
+	sState ^= sState << 17;
+	return sState;
+}
+
+
+
+static void CheckInt64(NumInt64Type aValue)
+{
+	char buf[32], expected[32];
+	snprintf(expected, sizeof(expected), "%lld", (long long)aValue);
+	CHECK(Int64ToDecimal(aValue, buf) == buf && !strcmp(buf, expected));
+	snprintf(expected, sizeof(expected), "%llu", (unsigned long long)aValue);
+	CHECK(UInt64ToDecimal((NumUInt64Type)aValue, buf) == buf && !strcmp(buf, expected));
+	snprintf(expected, sizeof(expected), "%llx", (unsigned long long)aValue);
+	CHECK(UInt64ToHex((NumUInt64Type)aValue, buf) == buf && !strcmp(buf, expected));
+}
+
+static void TestIntegers()
+{
+	static const NumInt64Type sEdge[] = {0, 1, -1, 9, 10, 99, 100, LLONG_MAX, LLONG_MIN, LLONG_MIN + 1
+		, 4294967295LL, 4294967296LL, -4294967296LL, 999999999999999999LL, 1000000000000000000LL};
+	for (size_t i = 0; i < sizeof(sEdge) / sizeof(sEdge[0]); ++i)
+		CheckInt64(sEdge[i]);
+	for (NumUInt64Type p = 1; p && p < ~0ULL / 10; p *= 10) // Every power of ten and its neighbors.
+	{
+		CheckInt64((NumInt64Type)p - 1);
+		CheckInt64((NumInt64Type)p);
+		CheckInt64(-(NumInt64Type)p);
+	}
+	for (int i = 0; i < 200000; ++i)
+		CheckInt64((NumInt64Type)(Rand64() >> (Rand64() % 64))); // Values of every length.
+}
+
+
+
+static int sFixedDeclined = 0, sFixedChecked = 0;
+
+static bool CheckFixed(double aValue, int aPrecision)
+// Returns false if DoubleToFixed() declined the value.
+{
+	char buf[64], expected[400];
+	int length = DoubleToFixed(aValue, aPrecision, buf);
+	if (length < 0)
+	{
+		++sFixedDeclined;
+		return false;
+	}
+	++sFixedChecked;
+	snprintf(expected, sizeof(expected), "%0.*f", aPrecision, aValue);
+	if (strcmp(buf, expected) || length != (int)strlen(buf))
+	{
+		fprintf(stderr, "DoubleToFixed(%.17g, %d) gave \"%s\" but printf gives \"%s\"\n", aValue, aPrecision, buf, expected);
+		++sTestFailures;
+	}
+	return true;
+}
+
+static void TestFixed()
+{
+	CHECK(ParseFixedFormat("%0.6f") == 6);
+	CHECK(ParseFixedFormat("%.2f") == 2);
+	CHECK(ParseFixedFormat("%0.f") == 0);
+	CHECK(ParseFixedFormat("%000.9f") == 9);
+	CHECK(ParseFixedFormat("%0.10f") == -1);
+	CHECK(ParseFixedFormat("%10.2f") == -1);
+	CHECK(ParseFixedFormat("%0.6e") == -1);
+	CHECK(ParseFixedFormat("%0.6fx") == -1);
+	CHECK(ParseFixedFormat("0.6f") == -1);
+
+	char buf[64];
+	CHECK(DoubleToFixed(1.0, NUM_FIXED_MAX_PRECISION + 1, buf) == -1);
+	CHECK(DoubleToFixed(1e15, 0, buf) == -1);
+	CHECK(DoubleToFixed(NAN, 2, buf) == -1);
+	CHECK(DoubleToFixed(-0.0, 2, buf) == -1);
+	CHECK(DoubleToFixed(-0.0001, 2, buf) == -1); // Rounds to a negative zero.
+	CHECK(DoubleToFixed(0.125, 2, buf) == -1); // An exact tie.
+
+	static const double sEdge[] = {0, 1, -1, 0.5, 1.5, 2.5, 0.1, 0.7, 1.005, 123.456, 999999.9999999
+		, 0.9999999, 99999999999999.0, 0.000001, 1e-10, 3.14159265358979};
+	for (size_t i = 0; i < sizeof(sEdge) / sizeof(sEdge[0]); ++i)
+		for (int p = 0; p <= NUM_FIXED_MAX_PRECISION; ++p)
+		{
+			CheckFixed(sEdge[i], p);
+			CheckFixed(-sEdge[i], p);
+		}
+	int typical_count = 0, typical_declined = 0;
+	for (int i = 0; i < 300000; ++i)
+	{
+		int precision = (int)(Rand64() % (NUM_FIXED_MAX_PRECISION + 1));
+		double value;
+		switch (i % 3)
+		{
+		case 0: // Random magnitude.
+			value = (double)(Rand64() >> 11) / (1ULL << 53) * pow(10.0, (int)(Rand64() % 30) - 12);
+			break;
+		case 1: // Short decimals, as scripts typically have.
+			value = (double)(NumInt64Type)(Rand64() % 20000000) / 1000.0;
+			break;
+		default: // Near a rounding tie at this precision.
+			value = ((double)(NumInt64Type)(Rand64() % 1000000) + 0.5) / pow(10.0, precision)
+				+ ((Rand64() & 1) ? 1e-9 : -1e-9);
+		}
+		if (Rand64() & 1)
+			value = -value;
+		if (!CheckFixed(value, precision) && i % 3 == 1)
+			++typical_declined;
+		typical_count += i % 3 == 1;
+	}
+	// Nearly all typical values should take the fast path.  Those declined are mostly ties such as 1.235 to two
+	// places, which affect about 1 in 10 values at that precision:
+	CHECK(typical_declined * 20 < typical_count);
+}
+
+
+
+static int sDecimalDeclined = 0, sDecimalChecked = 0;
+
+static void CheckDecimal(const char *aText)
+{
+	double result = 12345.0;
+	if (!DecimalToDouble(aText, result))
+	{
+		CHECK(result == 12345.0); // Must be left unchanged.
+		++sDecimalDeclined;
+		return;
+	}
+	++sDecimalChecked;
+	double expected = atof(aText);
+	if (memcmp(&result, &expected, sizeof(double))) // Bitwise, so that -0.0 and 0.0 are told apart.
+	{
+		fprintf(stderr, "DecimalToDouble(\"%s\") gave %.17g but atof() gives %.17g\n", aText, result, expected);
+		++sTestFailures;
+	}
+}
+
+static void TestDecimal()
+{
+	static const char *sText[] = {"0", "-0", "+0", "1", "-1", "0.1", ".5", "5.", "-.5", "  \t42", "42abc"
+		, "1.7976931348623157", "123456789012345", "1234567890123456", "0.000000000000001"
+		, "0.0000000000000000001", "1e5", "1E5", "1d5", "", "-", ".", "abc", "inf", "nan", "0x1A"
+		, "00000000000000000000123", "1.5.5", "999999999999999", "0.30000000000000004"};
+	for (size_t i = 0; i < sizeof(sText) / sizeof(sText[0]); ++i)
+		CheckDecimal(sText[i]);
+	char buf[64];
+	for (int i = 0; i < 300000; ++i)
+	{
+		NumUInt64Type mantissa = Rand64() % 1000000000000000ULL; // Up to 15 digits.
+		int fraction_digits = (int)(Rand64() % 19);
+		char digits[32];
+		int length = snprintf(digits, sizeof(digits), "%llu", (unsigned long long)mantissa);
+		char *cp = buf;
+		if (Rand64() & 1)
+			*cp++ = '-';
+		if (fraction_digits >= length)
+		{
+			*cp++ = '0';
+			*cp++ = '.';
+			for (int z = length; z < fraction_digits; ++z)
+				*cp++ = '0';
+			strcpy(cp, digits);
+		}
+		else
+		{
+			memcpy(cp, digits, length - fraction_digits);
+			cp += length - fraction_digits;
+			*cp++ = '.';
+			strcpy(cp, digits + length - fraction_digits);
+		}
+		CheckDecimal(buf);
+	}
+	CHECK(sDecimalChecked > sDecimalDeclined);
+}
+
+
+
+int main()
+{
+	TestIntegers();
+	TestFixed();
+	TestDecimal();
+	printf("DoubleToFixed: %d checked, %d declined; DecimalToDouble: %d checked, %d declined\n"
+		, sFixedChecked, sFixedDeclined, sDecimalChecked, sDecimalDeclined);
+	return TEST_RESULT();
+}
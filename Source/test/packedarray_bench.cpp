@@ -0,0 +1,237 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Times StringSplit of a million lines into a global array, and measures the memory the array takes: one
+// variable per element, as StringSplit did before (and still does for local arrays), against a packed array.
+// The old way is modelled on what FindOrAddVar(), AddVar() and Var::Assign() do for each element: search the
+// sorted list of variables and its lazy list, allocate the name on SimpleHeap and the Var with new, insert
+// it into the lazy list (merging that into the main list every MAX_LAZY_VARS), and put the contents on
+// SimpleHeap in the size classes Assign() uses.  Both ways count the memory they request, including their
+// tables, but not the bookkeeping of malloc() itself, which would only add to the old way's total.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "packedarray.h"
+
+#define ELEMENTS 1000000
+#define BLOCK_SIZE (32 * 1024) // As in SimpleHeap.h.
+#define MAX_ALLOC_SIMPLE 64 // As in var.h.
+#define MAX_LAZY_VARS 2000 // As in Script::AddVar().
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+struct VarModel
+// The members of Var (var.h) that take up space.
+{
+	union
+	{
+		long long mContentsInt64;
+		double mContentsDouble;
+	};
+	char *mContents;
+	unsigned mLength, mCapacity, mChangeStamp;
+	unsigned char mHowAllocated, mAttrib;
+	bool mIsLocal;
+	unsigned char mType;
+	char *mName;
+};
+
+static char *sBlock;
+static size_t sSpaceAvailable, sHeapBytes;
+static char **sBlocks;
+static int sBlockCount, sBlockCapacity;
+
+static char *HeapMalloc(size_t aSize)
+// Like SimpleHeap::Malloc(): carves 4-byte-aligned chunks out of 32 KB blocks that are never freed.
+{
+	size_t size_consumed = (aSize + 3) & ~(size_t)3;
+	if (size_consumed > sSpaceAvailable)
+	{
+		if (sBlockCount == sBlockCapacity)
+		{
+			sBlockCapacity = sBlockCapacity ? sBlockCapacity * 2 : 256;
+			sBlocks = (char **)realloc(sBlocks, sBlockCapacity * sizeof(char *));
+		}
+		sBlocks[sBlockCount++] = sBlock = (char *)malloc(BLOCK_SIZE);
+		sSpaceAvailable = BLOCK_SIZE;
+		sHeapBytes += BLOCK_SIZE;
+	}
+	char *result = sBlock;
+	sBlock += size_consumed;
+	sSpaceAvailable -= size_consumed;
+	return result;
+}
+
+static VarModel **sVar, *sLazyVar[MAX_LAZY_VARS];
+static int sVarCount, sVarCountMax, sLazyVarCount;
+
+static int SearchList(VarModel **aList, int aCount, const char *aName, bool &aFound)
+// Returns the position of aName in aList or where it would be inserted, by binary search like FindVar().
+{
+	int left = 0, right = aCount - 1;
+	while (left <= right)
+	{
+		int mid = (left + right) / 2;
+		int result = strcasecmp(aName, aList[mid]->mName);
+		if (result > 0)
+			left = mid + 1;
+		else if (result < 0)
+			right = mid - 1;
+		else
+		{
+			aFound = true;
+			return mid;
+		}
+	}
+	aFound = false;
+	return left;
+}
+
+static VarModel *FindOrAddVar(const char *aName, size_t aNameLength)
+{
+	bool found;
+	int pos = SearchList(sVar, sVarCount, aName, found);
+	if (found)
+		return sVar[pos];
+	pos = SearchList(sLazyVar, sLazyVarCount, aName, found);
+	if (found)
+		return sLazyVar[pos];
+	VarModel *var = new VarModel;
+	memset(var, 0, sizeof(VarModel));
+	var->mName = (char *)memcpy(HeapMalloc(aNameLength + 1), aName, aNameLength + 1);
+	memmove(sLazyVar + pos + 1, sLazyVar + pos, (sLazyVarCount - pos) * sizeof(VarModel *));
+	sLazyVar[pos] = var;
+	if (++sLazyVarCount < MAX_LAZY_VARS)
+		return var;
+	if (sVarCount + MAX_LAZY_VARS > sVarCountMax) // Grow as AddVar() does at this size.
+	{
+		sVarCountMax = sVarCountMax < 1000000 ? 1000000 : sVarCountMax + 1000000;
+		sVar = (VarModel **)realloc(sVar, sVarCountMax * sizeof(VarModel *));
+	}
+	// Merge the lazy list into the main list from the end, so that each item is moved only once.
+	int i = sVarCount - 1, j = sLazyVarCount - 1, k = sVarCount + sLazyVarCount - 1;
+	while (j >= 0)
+		sVar[k--] = (i >= 0 && strcasecmp(sVar[i]->mName, sLazyVar[j]->mName) > 0) ? sVar[i--] : sLazyVar[j--];
+	sVarCount += sLazyVarCount;
+	sLazyVarCount = 0;
+	return var;
+}
+
+static void Assign(VarModel &aVar, const char *aText, size_t aLength)
+// The part of Var::Assign() that applies to a new variable.
+{
+	size_t space_needed = aLength + 1, new_size;
+	if (space_needed <= MAX_ALLOC_SIMPLE)
+	{
+		new_size = space_needed < 5 ? 4 : space_needed < 9 ? 8 : MAX_ALLOC_SIMPLE;
+		aVar.mContents = HeapMalloc(new_size);
+	}
+	else
+	{
+		new_size = space_needed;
+		aVar.mContents = (char *)malloc(new_size);
+		sHeapBytes += new_size;
+	}
+	aVar.mCapacity = (unsigned)new_size;
+	aVar.mLength = (unsigned)aLength;
+	memcpy(aVar.mContents, aText, aLength);
+	aVar.mContents[aLength] = '\0';
+}
+
+
+
+int main()
+{
+	// The input: a million lines of a typical CSV export.
+	size_t input_size = (size_t)ELEMENTS * 40;
+	char *input = (char *)malloc(input_size), *cp = input;
+	int i;
+	for (i = 0; i < ELEMENTS; ++i)
+		cp += sprintf(cp, "%07d,2026-10-18 12:%02d:%02d,OK\n", i, i / 60 % 60, i % 60);
+	cp[-1] = '\0'; // Omit the last newline so that there are exactly ELEMENTS lines.
+
+	char name[32];
+	const char *element, *delimiter;
+	size_t element_length;
+
+	double start = Seconds();
+	for (element = input, i = 1; ; element = delimiter + 1, ++i)
+	{
+		delimiter = strchr(element, '\n');
+		element_length = delimiter ? delimiter - element : strlen(element);
+		size_t name_length = sprintf(name, "Array%d", i);
+		Assign(*FindOrAddVar(name, name_length), element, element_length);
+		if (!delimiter)
+			break;
+	}
+	double old_time = Seconds() - start;
+	size_t old_bytes = sHeapBytes + (size_t)(sVarCount + sLazyVarCount) * sizeof(VarModel)
+		+ sVarCountMax * sizeof(VarModel *) + sizeof(sLazyVar);
+	sSink = sVarCount + sLazyVarCount;
+	if (sVarCount + sLazyVarCount != ELEMENTS)
+	{
+		printf("%d variables made instead of %d\n", sVarCount + sLazyVarCount, ELEMENTS);
+		return 1;
+	}
+
+	PackedArraySet arrays;
+	start = Seconds();
+	PackedStringArray packed;
+	for (element = input; ; element = delimiter + 1)
+	{
+		delimiter = strchr(element, '\n');
+		element_length = delimiter ? delimiter - element : strlen(element);
+		if (!packed.Append(element, element_length))
+			return 1;
+		if (!delimiter)
+			break;
+	}
+	if (!arrays.Set("Array", packed))
+		return 1;
+	double new_time = Seconds() - start;
+	size_t new_bytes = arrays.MemoryUsed();
+
+	const char *last;
+	if (!arrays.Get("array1000000", 12, last, element_length) || strcmp(last, strrchr(input, '\n') + 1))
+	{
+		printf("Array%d is wrong\n", ELEMENTS);
+		return 1;
+	}
+	printf("StringSplit of %d lines: a variable each %7.1f ms %6.1f MB, packed %5.1f ms %5.1f MB (%.0fx faster, %.1fx smaller)\n"
+		, ELEMENTS, old_time * 1e3, old_bytes / 1048576.0, new_time * 1e3, new_bytes / 1048576.0
+		, old_time / new_time, (double)old_bytes / new_bytes);
+
+	for (i = 0; i < sVarCount; ++i)
+		delete sVar[i];
+	for (i = 0; i < sLazyVarCount; ++i)
+		delete sLazyVar[i];
+	for (i = 0; i < sBlockCount; ++i)
+		free(sBlocks[i]);
+	free(sBlocks);
+	free(sVar);
+	free(input);
+	return 0;
+}
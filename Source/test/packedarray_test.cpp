@@ -0,0 +1,228 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks PackedStringArray, then checks PackedArraySet against a model of what the script would see if each
+// element were a variable: the value of a name is whatever the most recent store that included that name
+// put there.  The stores use base names whose element names overlap (A12 is element 12 of A and element 2
+// of A1), differ only in case, and shrink often enough that layers are merged and freed.  Also checks that
+// an array stored repeatedly with fewer elements each time doesn't use memory without bound.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "packedarray.h"
+#include "test.h"
+
+
+
+static void TestStringArray()
+{
+	PackedStringArray a, b;
+	char buf[32];
+	for (unsigned i = 0; i < 1000; ++i)
+	{
+		int length = sprintf(buf, "item%u", i);
+		CHECK(a.Append(buf, length));
+	}
+	CHECK(a.Append("", 0));
+	CHECK(a.Count() == 1001);
+	size_t length;
+	CHECK(!strcmp(a.Item(0, length), "item0") && length == 5);
+	CHECK(!strcmp(a.Item(999, length), "item999") && length == 7);
+	CHECK(!*a.Item(1000, length) && length == 0);
+
+	CHECK(b.Append("x", 1));
+	CHECK(b.AppendFrom(a, 998));
+	CHECK(b.AppendFrom(a, 5000)); // Nothing to append.
+	CHECK(b.Count() == 4);
+	CHECK(!strcmp(b.Item(1, length), "item998") && length == 7);
+	CHECK(!strcmp(b.Item(2, length), "item999"));
+
+	a.Swap(b);
+	CHECK(a.Count() == 4 && b.Count() == 1001);
+	b.Clear();
+	CHECK(b.Count() == 0);
+	CHECK(b.Append("y", 1) && !strcmp(b.Item(0, length), "y"));
+}
+
+
+
+struct ModelStore
+{
+	std::string base; // Lowercase.
+	std::vector<std::string> value;
+	bool released;
+};
+
+static std::vector<ModelStore> sModel;
+
+
+
+static std::string Lower(const char *aStr)
+{
+	std::string s(aStr);
+	for (size_t i = 0; i < s.size(); ++i)
+		if (s[i] >= 'A' && s[i] <= 'Z')
+			s[i] += 'a' - 'A';
+	return s;
+}
+
+
+
+static bool ModelGet(const char *aName, std::string &aValue)
+{
+	std::string name = Lower(aName);
+	for (size_t i = sModel.size(); i-- > 0;)
+	{
+		const ModelStore &store = sModel[i];
+		if (store.released || name.size() <= store.base.size() || name.compare(0, store.base.size(), store.base))
+			continue;
+		const char *number = name.c_str() + store.base.size();
+		if (*number < '1' || *number > '9' || strspn(number, "0123456789") != strlen(number))
+			continue;
+		unsigned long n = strtoul(number, NULL, 10);
+		if (n <= store.value.size())
+		{
+			aValue = store.value[n - 1];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+static void CheckAllNames(PackedArraySet &aSet, const char *const aBase[], int aBaseCount, unsigned aMaxNumber)
+{
+	char name[64];
+	for (int b = 0; b < aBaseCount; ++b)
+		for (unsigned n = 0; n <= aMaxNumber + 2; ++n)
+		{
+			sprintf(name, "%s%u", aBase[b], n);
+			std::string expected;
+			const char *element;
+			size_t length;
+			bool found = aSet.Get(name, strlen(name), element, length);
+			bool expected_found = ModelGet(name, expected);
+			CHECK(found == expected_found);
+			if (found && expected_found)
+				CHECK(length == expected.size() && !strcmp(element, expected.c_str()));
+		}
+	const char *element;
+	size_t length;
+	CHECK(!aSet.Get("A", 1, element, length)); // No digits.
+	CHECK(!aSet.Get("12", 2, element, length)); // No base name stored is "1".
+}
+
+
+
+static void TestSetAgainstModel()
+{
+	static const char *const sBase[] = {"A", "a1", "A12", "B", "A2", "A0", "Arr", "ARR1", "arr"};
+	const int base_count = sizeof(sBase) / sizeof(sBase[0]);
+	const unsigned max_count = 40;
+	PackedArraySet set;
+	srand(12345);
+	char buf[64];
+	for (int op = 0; op < 3000; ++op)
+	{
+		const char *base = sBase[rand() % base_count];
+		if (rand() % 10 == 0)
+		{
+			set.Release(base, strlen(base));
+			for (size_t i = 0; i < sModel.size(); ++i)
+				if (sModel[i].base == Lower(base))
+					sModel[i].released = true;
+		}
+		else
+		{
+			// Favor shrinking so that layers pile up and get merged.
+			unsigned count = rand() % 4 ? 1 + rand() % max_count : 0;
+			ModelStore store;
+			store.base = Lower(base);
+			store.released = false;
+			PackedStringArray array;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				int length = sprintf(buf, "%d:%s%u", op, base, i + 1);
+				CHECK(array.Append(buf, length));
+				store.value.push_back(buf);
+			}
+			CHECK(set.Set(base, array));
+			CHECK(array.Count() == 0);
+			sModel.push_back(store);
+		}
+		if (op % 50 == 0)
+			CheckAllNames(set, sBase, base_count, max_count);
+	}
+	CheckAllNames(set, sBase, base_count, max_count);
+	CHECK(set.Count() == base_count - 1); // "Arr" and "arr" are the same array.
+	sModel.clear();
+}
+
+
+
+static void TestShrinkingIsBounded()
+{
+	// An array stored again and again with one fewer element each time keeps all of its old elements
+	// visible, but must not keep a separate copy of each store.
+	const unsigned start = 1000;
+	PackedArraySet set;
+	char buf[32];
+	for (unsigned count = start; count > 0; --count)
+	{
+		PackedStringArray array;
+		for (unsigned i = 0; i < count; ++i)
+			array.Append(buf, sprintf(buf, "%u", count));
+		set.Set("Shrink", array);
+		CHECK(set.ElementCount() <= 5 * start);
+	}
+	const char *element;
+	size_t length;
+	CHECK(set.Get("Shrink1", 7, element, length) && !strcmp(element, "1"));
+	CHECK(set.Get("shrink1000", 10, element, length) && !strcmp(element, "1000"));
+	CHECK(set.Get("SHRINK500", 9, element, length) && !strcmp(element, "500"));
+	CHECK(!set.Get("Shrink1001", 10, element, length));
+
+	// Storing the same count again replaces rather than accumulates.
+	PackedArraySet same;
+	for (int i = 0; i < 100; ++i)
+	{
+		PackedStringArray array;
+		for (unsigned k = 0; k < start; ++k)
+			array.Append("x", 1);
+		same.Set("Same", array);
+	}
+	CHECK(same.ElementCount() == start);
+
+	CHECK(set.Release("Shrink", 6));
+	CHECK(!set.Release("Shrink", 6));
+	CHECK(!set.Get("Shrink1", 7, element, length));
+	CHECK(set.ElementCount() == 0);
+}
+
+
+
+int main()
+{
+	TestStringArray();
+	TestSetAgainstModel();
+	TestShrinkingIsBounded();
+	return TEST_RESULT();
+}
@@ -0,0 +1,78 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+
+// Times PixelScanFind() over a 3840x2160 (4K) buffer in which the sought color doesn't occur, so every pixel is
+// examined as in a PixelSearch that fails.  Each combination of exact vs. range (variation) and forward vs.
+// reverse (inverted coordinates) is timed with the SSE2 kernels and with their plain loops.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pixelscan.h"
+
+#define WIDTH 3840
+#define HEIGHT 2160
+#define ITERATIONS 20
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+static double Time(const ScanPixelType *aPixel, ScanPixelType aLow, ScanPixelType aHigh, bool aReverse)
+{
+	double start = Seconds();
+	for (int i = 0; i < ITERATIONS; ++i)
+		sSink = PixelScanFind(aPixel, WIDTH, HEIGHT, aLow, aHigh, aReverse, aReverse);
+	return (Seconds() - start) / ITERATIONS;
+}
+
+
+
+int main()
+{
+	ScanPixelType *pixel = (ScanPixelType *)malloc(WIDTH * HEIGHT * sizeof(ScanPixelType));
+	if (!pixel)
+		return 1;
+	unsigned seed = 1;
+	for (int i = 0; i < WIDTH * HEIGHT; ++i) // Random colors whose components are all below 0x80, plus noise in the high-order byte.
+	{
+		seed = seed * 1103515245 + 12345;
+		pixel[i] = (seed >> 1) & 0xFF7F7F7F;
+	}
+	printf("%dx%d pixels, SSE2 %s\n", WIDTH, HEIGHT, PixelScanUsesSSE2() ? "available" : "not available");
+
+	static const char *sName[] = {"exact", "range"};
+	static const ScanPixelType sLow[] = {0x808080, 0x10FF10}, sHigh[] = {0x808080, 0x30FF30};
+	for (int range = 0; range < 2; ++range)
+		for (int reverse = 0; reverse < 2; ++reverse)
+		{
+			PixelScanAllowSSE2(false);
+			double plain = Time(pixel, sLow[range], sHigh[range], reverse != 0);
+			PixelScanAllowSSE2(true);
+			double sse2 = Time(pixel, sLow[range], sHigh[range], reverse != 0);
+			printf("%s %-7s plain %6.2f ms, SSE2 %6.2f ms (%.1fx faster)\n", sName[range]
+				, reverse ? "reverse" : "forward", plain * 1e3, sse2 * 1e3, plain / sse2);
+		}
+	free(pixel);
+	return 0;
+}
@@ -0,0 +1,420 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+
+// Checks the pixel kernels of pixelscan.cpp against plain reference loops, once with SSE2 (if the CPU has it)
+// and once with the kernels' own plain loops.  The buffers use a small palette so that matches are common and
+// fall at every position relative to the four-pixel vectors, have random noise in the ignored high-order byte,
+// and have every length up to several vectors so that each kind of leftover tail is covered.  PixelScanFind()
+// is checked in all four search directions and in both its exact and range modes.
+//
+// ImageScanFind() and ImageScanFindAll() are checked against a brute-force matcher that compares the whole
+// image at every position: with and without variation, with transparency by mask and by color, for the first
+// match and for all of them, and with matches planted against the right and bottom edges of screens whose
+// widths leave vector tails.  ImageScanFindAll() is also run on a screen large enough to be divided among
+// several POSIX threads, which must find exactly what one thread finds.
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "pixelscan.h"
+#include "test.h"
+
+static unsigned sSeed = 1;
+
+static unsigned Random(unsigned aRange)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return (sSeed >> 8) % aRange;
+}
+
+static ScanPixelType RandomColor()
+// Components are drawn from values next to the range bounds used below, or at the limits of a byte.
+{
+	static const ScanPixelType sComponent[] = {0x00, 0x0F, 0x10, 0x30, 0x31, 0xFF};
+	return sComponent[Random(6)] | sComponent[Random(6)] << 8 | sComponent[Random(6)] << 16;
+}
+
+static ScanPixelType RandomPixel()
+{
+	return RandomColor() | Random(256) << 24; // The high-order byte is noise that every function must ignore.
+}
+
+static bool InRange(ScanPixelType aPixel, ScanPixelType aLow, ScanPixelType aHigh)
+{
+	for (int shift = 0; shift < 24; shift += 8)
+	{
+		unsigned c = (aPixel >> shift) & 0xFF;
+		if (c < ((aLow >> shift) & 0xFF) || c > ((aHigh >> shift) & 0xFF))
+			return false;
+	}
+	return true;
+}
+
+static int ReferenceFind(const ScanPixelType *aPixel, int aWidth, int aHeight, ScanPixelType aLow, ScanPixelType aHigh
+	, bool aRightToLeft, bool aBottomToTop)
+{
+	for (int y = 0; y < aHeight; ++y)
+	{
+		int row = aBottomToTop ? aHeight - 1 - y : y;
+		for (int x = 0; x < aWidth; ++x)
+		{
+			int col = aRightToLeft ? aWidth - 1 - x : x;
+			if (InRange(aPixel[row * aWidth + col], aLow, aHigh))
+				return row * aWidth + col;
+		}
+	}
+	return -1;
+}
+
+
+
+static void TestKernels()
+{
+	ScanPixelType pixel[64], masked[64];
+	for (int count = 0; count <= 40; ++count)
+	{
+		for (int trial = 0; trial < 200; ++trial)
+		{
+			int i, expected;
+			for (i = 0; i < count; ++i)
+				pixel[i] = RandomPixel();
+			// Sometimes make the sought color occur only once, at a position that's likely to be in the tail.
+			ScanPixelType color = RandomColor();
+			if (trial % 4 == 0)
+			{
+				for (i = 0; i < count; ++i)
+					if ((pixel[i] & 0x00FFFFFF) == color)
+						pixel[i] ^= 0x000001;
+				if (count)
+					pixel[count - 1 - Random(count < 3 ? count : 3)] = color | Random(256) << 24;
+			}
+			for (expected = 0; expected < count && (pixel[expected] & 0x00FFFFFF) != color; ++expected);
+			if (expected == count)
+				expected = -1;
+			CHECK(PixelScanExact(pixel, count, color | Random(256) << 24) == expected);
+
+			ScanPixelType low = 0x101010, high = 0x303030;
+			if (trial & 1)
+				low = 0x000010, high = 0x30FF0F; // One component whose range is empty.
+			if (trial & 2)
+				low = 0x0F0F0F, high = 0xFFFFFF;
+			for (expected = 0; expected < count && !InRange(pixel[expected], low, high); ++expected);
+			if (expected == count)
+				expected = -1;
+			CHECK(PixelScanRange(pixel, count, low | Random(256) << 24, high & ~(Random(256) << 24)) == expected);
+
+			memcpy(masked, pixel, count * sizeof(ScanPixelType));
+			ScanPixelType mask = trial & 1 ? 0xF8F8F8F8 : 0x00FFFFFF;
+			PixelScanMask(masked, count, mask);
+			for (i = 0; i < count && masked[i] == (pixel[i] & mask); ++i);
+			CHECK(i == count);
+		}
+	}
+}
+
+
+
+static void TestFind()
+{
+	static const ScanPixelType sLow[] = {0x303030, 0x101010, 0x0F0000};
+	static const ScanPixelType sHigh[] = {0x303030, 0x303030, 0x30FF10}; // The first pair is an exact match.
+	ScanPixelType pixel[13 * 7];
+	for (int width = 1; width <= 13; ++width)
+		for (int height = 1; height <= 7; ++height)
+			for (int trial = 0; trial < 20; ++trial)
+			{
+				for (int i = 0; i < width * height; ++i)
+					pixel[i] = trial & 1 ? RandomPixel() : Random(256) << 24; // Half are black, so the few matches below are the only ones.
+				if (!(trial & 1))
+					for (int n = Random(3); n > 0; --n)
+						pixel[Random(width * height)] = 0x303030 | Random(256) << 24;
+				for (int range = 0; range < 3; ++range)
+					for (int direction = 0; direction < 4; ++direction)
+					{
+						bool right_to_left = direction & 1, bottom_to_top = direction & 2;
+						CHECK(PixelScanFind(pixel, width, height, sLow[range], sHigh[range], right_to_left, bottom_to_top)
+							== ReferenceFind(pixel, width, height, sLow[range], sHigh[range], right_to_left, bottom_to_top));
+					}
+			}
+}
+
+
+
+static bool ImageIsAt(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth, int aX, int aY)
+{
+	for (int y = 0; y < aImage.height; ++y)
+		for (int x = 0; x < aImage.width; ++x)
+		{
+			int j = y * aImage.width + x;
+			if ((aImage.mask && aImage.mask[j]) || aImage.pixel[j] == aImage.trans_color)
+				continue;
+			ScanPixelType s = aScreen[(aY + y) * aScreenWidth + aX + x], i = aImage.pixel[j];
+			if (!aImage.variation)
+			{
+				if (s != i)
+					return false;
+				continue;
+			}
+			for (int shift = 0; shift < 24; shift += 8)
+			{
+				int diff = (int)((s >> shift) & 0xFF) - (int)((i >> shift) & 0xFF);
+				if (diff > aImage.variation || diff < -aImage.variation)
+					return false;
+			}
+		}
+	return true;
+}
+
+static int BruteForceFindAll(const ScanImage &aImage, const ScanPixelType *aScreen, int aScreenWidth, int aScreenHeight
+	, int *aFound, int aMaxCount)
+{
+	int count = 0;
+	for (int y = 0; y + aImage.height <= aScreenHeight; ++y)
+		for (int x = 0; x + aImage.width <= aScreenWidth; ++x)
+			if (count < aMaxCount && ImageIsAt(aImage, aScreen, aScreenWidth, x, y))
+				aFound[count++] = y * aScreenWidth + x;
+	return count;
+}
+
+static void Plant(const ScanImage &aImage, ScanPixelType *aScreen, int aScreenWidth, int aX, int aY)
+// Copies the image to the screen, with its transparent pixels left as they were and its other pixels altered
+// by no more than the variation.
+{
+	for (int y = 0; y < aImage.height; ++y)
+		for (int x = 0; x < aImage.width; ++x)
+		{
+			int j = y * aImage.width + x;
+			if ((aImage.mask && aImage.mask[j]) || aImage.pixel[j] == aImage.trans_color)
+				continue;
+			ScanPixelType pixel = aImage.pixel[j];
+			if (aImage.variation)
+			{
+				int c = (pixel & 0xFF) + (int)Random(2 * aImage.variation + 1) - aImage.variation;
+				pixel = (pixel & ~0xFF) | (c < 0 ? 0 : c > 0xFF ? 0xFF : c);
+			}
+			aScreen[(aY + y) * aScreenWidth + aX + x] = pixel;
+		}
+}
+
+
+
+static void TestImageScan()
+{
+	ScanPixelType screen[23 * 11], image_pixel[5 * 4], mask[5 * 4];
+	int expected[23 * 11], found[23 * 11];
+	for (int trial = 0; trial < 3000; ++trial)
+	{
+		int screen_width = 1 + Random(23), screen_height = 1 + Random(11);
+		ScanImage image;
+		image.width = 1 + Random(5);
+		image.height = 1 + Random(4);
+		image.variation = trial & 1 ? 0 : Random(40);
+		image.pixel = image_pixel;
+		image.mask = trial & 2 ? mask : NULL;
+		image.trans_color = 0xFF000000; // None.
+		int i, count = image.width * image.height;
+		for (i = 0; i < count; ++i)
+		{
+			// Few colors, so that partial matches are common.  A transparent pixel sometimes takes the place of
+			// the image's only opaque pixel, or all of them.
+			image_pixel[i] = RandomColor() & 0x3030;
+			mask[i] = Random(4) == 0 || trial % 50 == 2;
+		}
+		if (trial & 4)
+			image.trans_color = image_pixel[Random(count)];
+		for (i = 0; i < screen_width * screen_height; ++i)
+			screen[i] = (RandomColor() & 0x3030) | (image.variation ? Random(256) << 24 : 0); // In exact mode, the caller has zeroed the high-order byte.
+		if (image.width <= screen_width && image.height <= screen_height)
+		{
+			// Plant copies, often against the right and bottom edges, where the last candidates lie.
+			for (int n = Random(4); n > 0; --n)
+				Plant(image, screen, screen_width
+					, Random(2) ? screen_width - image.width : Random(screen_width - image.width + 1)
+					, Random(2) ? screen_height - image.height : Random(screen_height - image.height + 1));
+		}
+		ImageScanPrepare(image);
+
+		int max_count = trial & 8 ? 1 : 23 * 11; // The first match only, or *All.
+		int expected_count = BruteForceFindAll(image, screen, screen_width, screen_height, expected, max_count);
+		int n = 0;
+		for (i = 0; n < max_count && (i = ImageScanFind(image, screen, screen_width, screen_height, i)) > -1; ++i)
+			found[n++] = i;
+		CHECK(n == expected_count && !memcmp(found, expected, n * sizeof(int)));
+
+		int *all;
+		n = ImageScanFindAll(image, screen, screen_width, screen_height, max_count, all, NULL);
+		CHECK(n == expected_count && (n ? all && !memcmp(all, expected, n * sizeof(int)) : !all));
+		free(all);
+	}
+}
+
+
+
+static __thread bool sPassedBarrier; // Per thread.
+
+class PosixScanHost : public ImageScanHost
+// Like ImageSearchHost in the program, this must outlive each search's worker threads, which still use it
+// after the search has returned, so only one static instance is used.
+{
+	pthread_mutex_t mLock, mBarrierLock;
+	pthread_cond_t mCond, mBarrierCond;
+	bool mRaised;
+	int mArrived;
+
+public:
+	int thread_count;
+	int threads_started;
+	PosixScanHost(int aThreadCount) : mRaised(false), mArrived(0), thread_count(aThreadCount), threads_started(0)
+	{
+		pthread_mutex_init(&mLock, NULL);
+		pthread_mutex_init(&mBarrierLock, NULL);
+		pthread_cond_init(&mCond, NULL);
+		pthread_cond_init(&mBarrierCond, NULL);
+	}
+
+	void Reset()
+	// Prepares for a search in which every thread (the caller's included) waits at its first Unlock() after the
+	// workers have been started until all have arrived there.  By then, each worker has taken a band, so all the
+	// threads are sure to be searching at once even on a single processor, and the bands after the first are
+	// searched even when the first has all the matches needed.
+	{
+		threads_started = 0;
+		mArrived = 0;
+		sPassedBarrier = false;
+	}
+
+	~PosixScanHost()
+	{
+		pthread_cond_destroy(&mBarrierCond);
+		pthread_cond_destroy(&mCond);
+		pthread_mutex_destroy(&mBarrierLock);
+		pthread_mutex_destroy(&mLock);
+	}
+
+	int ThreadCount() {return thread_count;}
+
+	bool StartThread(void (*aProc)(void *), void *aParam)
+	{
+		struct Start {void (*proc)(void *); void *param;};
+		struct Trampoline {static void *Proc(void *aStart)
+		{
+			Start start = *(Start *)aStart;
+			delete (Start *)aStart;
+			start.proc(start.param);
+			return NULL;
+		}};
+		Start *start = new Start;
+		start->proc = aProc;
+		start->param = aParam;
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, Trampoline::Proc, start))
+		{
+			delete start;
+			return false;
+		}
+		pthread_detach(thread);
+		++threads_started; // Only the caller's thread starts threads.
+		return true;
+	}
+
+	void Lock() {pthread_mutex_lock(&mLock);}
+
+	void Unlock()
+	{
+		bool wait = threads_started && !sPassedBarrier; // Read while the lock is still held.
+		pthread_mutex_unlock(&mLock);
+		if (!wait)
+			return;
+		sPassedBarrier = true;
+		pthread_mutex_lock(&mBarrierLock);
+		if (++mArrived == thread_count)
+			pthread_cond_broadcast(&mBarrierCond);
+		while (mArrived < thread_count)
+			pthread_cond_wait(&mBarrierCond, &mBarrierLock);
+		pthread_mutex_unlock(&mBarrierLock);
+	}
+
+	void Wait()
+	{
+		while (!mRaised)
+			pthread_cond_wait(&mCond, &mLock);
+		mRaised = false;
+	}
+
+	void Signal()
+	{
+		mRaised = true;
+		pthread_cond_signal(&mCond);
+	}
+};
+
+
+
+static PosixScanHost sHost(4);
+
+static void TestImageScanThreads()
+{
+	const int screen_width = 1283, screen_height = 1700; // Over 2 million candidate positions, so four threads are worthwhile.
+	ScanPixelType *screen = (ScanPixelType *)malloc(screen_width * screen_height * sizeof(ScanPixelType));
+	int *expected = (int *)malloc(1000 * sizeof(int));
+	ScanPixelType image_pixel[3 * 3] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+	ScanImage image;
+	image.pixel = image_pixel;
+	image.mask = NULL;
+	image.trans_color = 0xFF000000;
+	image.width = image.height = 3;
+	image.variation = 0;
+	ImageScanPrepare(image);
+	for (int trial = 0; trial < 4; ++trial)
+	{
+		int i;
+		for (i = 0; i < screen_width * screen_height; ++i)
+			screen[i] = Random(4); // Partial matches are common, but complete ones are rare.
+		int planted = trial == 0 ? 0 : trial == 1 ? 1 : 300;
+		for (int n = 0; n < planted; ++n)
+			Plant(image, screen, screen_width, Random(screen_width - 2), trial == 1 ? screen_height - 3 : Random(screen_height - 2));
+		for (int max_count = 1; max_count <= 1000; max_count += 999)
+		{
+			int expected_count = BruteForceFindAll(image, screen, screen_width, screen_height, expected, max_count);
+			sHost.Reset();
+			int *found;
+			int n = ImageScanFindAll(image, screen, screen_width, screen_height, max_count, found, &sHost);
+			CHECK(sHost.threads_started == 3);
+			CHECK(n == expected_count && (!n || !memcmp(found, expected, n * sizeof(int))));
+			free(found);
+		}
+	}
+	free(expected);
+	free(screen);
+}
+
+
+
+int main()
+{
+	printf("SSE2 %s\n", PixelScanUsesSSE2() ? "available" : "not available; only the plain loops are tested");
+	for (int allow = 1; allow >= 0; --allow)
+	{
+		PixelScanAllowSSE2(allow != 0);
+		TestKernels();
+		TestFind();
+		TestImageScan();
+	}
+	TestImageScanThreads();
+	return TEST_RESULT();
+}
@@ -0,0 +1,179 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Times the lookups done by Process Exist and WinGet ProcessName in a burst, such as a loop that gets the
+// process name of each of 200 windows: listing every process for each lookup and scanning the list (as
+// ProcessExist9x2000() did before it had a cache) against ProcessCache.  The processes are those of this
+// system as listed in /proc, which like a Toolhelp snapshot costs far more than any search of the list.
+// A second test times the search alone, by PID and by name, in a synthetic list of 5,000 processes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <dirent.h>
+#include <vector>
+#include "proccache.h"
+
+#define LOOKUPS 200
+#define LIST_SIZE 5000
+#define SEARCHES 200000
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+class ProcProcessProvider : public ProcessProvider
+// Lists the processes in /proc by the name in each one's "comm" file (the same as in proccache_test.cpp).
+{
+public:
+	bool Enumerate(ProcessCache &aCache)
+	{
+		DIR *dir = opendir("/proc");
+		if (!dir)
+			return false;
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL)
+		{
+			unsigned pid = (unsigned)atoi(entry->d_name);
+			if (!pid)
+				continue;
+			char path[64], name[PROCESS_NAME_SIZE];
+			snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+			FILE *fp = fopen(path, "r");
+			if (!fp)
+				continue; // It has probably exited.
+			if (!fgets(name, sizeof(name), fp))
+				*name = '\0';
+			fclose(fp);
+			name[strcspn(name, "\n")] = '\0';
+			if (!aCache.Add(pid, name))
+				break;
+		}
+		closedir(dir);
+		return true;
+	}
+
+	unsigned TickCount()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+	}
+};
+
+class ListProvider : public ProcessProvider
+{
+public:
+	std::vector<unsigned> mPID;
+	std::vector<const char *> mName;
+	bool Enumerate(ProcessCache &aCache)
+	{
+		for (size_t i = 0; i < mPID.size(); ++i)
+			aCache.Add(mPID[i], mName[i]);
+		return true;
+	}
+	unsigned TickCount() {return 0;}
+};
+
+
+
+int main()
+{
+	ProcProcessProvider proc;
+	ProcessCache cache(proc, 50);
+	if (!cache.Update())
+	{
+		printf("/proc not available\n");
+		return 0;
+	}
+	int count = cache.Count(), found = 0, i;
+	std::vector<unsigned> window_pid(LOOKUPS);
+	for (i = 0; i < LOOKUPS; ++i)
+		window_pid[i] = cache.PID(i % count);
+
+	double start = Seconds();
+	for (i = 0; i < LOOKUPS; ++i)
+	{
+		ProcessCache each_time(proc, 0); // A new list for every lookup.
+		each_time.Update();
+		for (int j = 0; j < each_time.Count(); ++j) // The old linear scan.
+			if (each_time.PID(j) == window_pid[i])
+			{
+				++found;
+				break;
+			}
+	}
+	double old_time = Seconds() - start;
+	cache.Invalidate();
+	start = Seconds();
+	for (i = 0; i < LOOKUPS; ++i)
+		found += cache.Update() && cache.Find(window_pid[i], "") > -1;
+	double new_time = Seconds() - start;
+	sSink = found;
+	printf("%d processes, %d lookups by PID: list each time %7.2f ms, cache %5.2f ms, %u list(s) made (%.0fx faster)\n"
+		, count, LOOKUPS, old_time * 1e3, new_time * 1e3, cache.EnumerateCount() - 1, old_time / new_time);
+
+	// The search alone:
+	ListProvider list;
+	char (*name)[16] = new char[LIST_SIZE][16], (*pid_text)[16] = new char[LIST_SIZE][16];
+	for (i = 0; i < LIST_SIZE; ++i)
+	{
+		sprintf(name[i], "proc%d.exe", i);
+		sprintf(pid_text[i], "%d", 4 * (i + 1));
+		list.mPID.push_back(4 * (i + 1));
+		list.mName.push_back(name[i]);
+	}
+	ProcessCache big(list, 1000);
+	big.Update();
+	for (int by_name = 0; by_name < 2; ++by_name)
+	{
+		found = 0;
+		start = Seconds();
+		for (i = 0; i < SEARCHES; ++i)
+		{
+			int k = (i * 7919) % LIST_SIZE;
+			unsigned pid = by_name ? 0 : 4 * (k + 1);
+			const char *query = by_name ? name[k] : pid_text[k]; // A PID is also checked as a name.
+			for (int j = 0; j < LIST_SIZE; ++j)
+				if ((pid && list.mPID[j] == pid) || !strcasecmp(list.mName[j], query))
+				{
+					found += j;
+					break;
+				}
+		}
+		double scan_time = Seconds() - start;
+		start = Seconds();
+		for (i = 0; i < SEARCHES; ++i)
+		{
+			int k = (i * 7919) % LIST_SIZE;
+			found += big.Find(by_name ? 0 : 4 * (k + 1), by_name ? name[k] : pid_text[k]);
+		}
+		double index_time = Seconds() - start;
+		sSink = found;
+		printf("%d processes, search by %-4s: scan %8.1f ns, index %5.1f ns (%.0fx faster)\n", LIST_SIZE
+			, by_name ? "name" : "PID", scan_time * 1e9 / SEARCHES, index_time * 1e9 / SEARCHES, scan_time / index_time);
+	}
+	delete [] name;
+	delete [] pid_text;
+	return 0;
+}
@@ -0,0 +1,227 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Checks ProcessCache with a fake ProcessProvider whose processes and clock are under the test's control:
+// the list is reused only while it's young enough (including across the wraparound of the tick count) and
+// until Invalidate(), and every lookup agrees with a scan of the list for the first process whose PID or
+// name (ignoring case) matches, even with many duplicate names.  Finally, a provider that reads /proc
+// checks that this process can be found by PID and by name on a real system.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <vector>
+#include "proccache.h"
+#include "test.h"
+
+static unsigned sSeed = 1;
+
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+struct FakeProcess {unsigned pid; char name[32];};
+
+class FakeProcessProvider : public ProcessProvider
+{
+public:
+	std::vector<FakeProcess> mProcess;
+	unsigned mTick;
+	bool mFail;
+	FakeProcessProvider() : mTick(0), mFail(false) {}
+
+	bool Enumerate(ProcessCache &aCache)
+	{
+		if (mFail)
+			return false;
+		for (size_t i = 0; i < mProcess.size(); ++i)
+			if (!aCache.Add(mProcess[i].pid, mProcess[i].name))
+				break;
+		return true;
+	}
+
+	unsigned TickCount() {return mTick;}
+};
+
+class ProcProcessProvider : public ProcessProvider
+// Lists the processes in /proc by the name in each one's "comm" file.
+{
+public:
+	bool Enumerate(ProcessCache &aCache)
+	{
+		DIR *dir = opendir("/proc");
+		if (!dir)
+			return false;
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL)
+		{
+			unsigned pid = (unsigned)atoi(entry->d_name);
+			if (!pid)
+				continue;
+			char path[64], name[PROCESS_NAME_SIZE];
+			snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+			FILE *fp = fopen(path, "r");
+			if (!fp)
+				continue; // It has probably exited.
+			if (!fgets(name, sizeof(name), fp))
+				*name = '\0';
+			fclose(fp);
+			name[strcspn(name, "\n")] = '\0';
+			if (!aCache.Add(pid, name))
+				break;
+		}
+		closedir(dir);
+		return true;
+	}
+
+	unsigned TickCount()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (unsigned)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+	}
+};
+
+
+
+static void TestAge()
+{
+	FakeProcessProvider provider;
+	FakeProcess process = {4, "a.exe"};
+	provider.mProcess.push_back(process);
+	provider.mTick = 0xFFFFFFF0; // So that the age wraps around below.
+	ProcessCache cache(provider, 50);
+	CHECK(cache.Find(4, "a.exe") == -1); // Nothing before the first Update().
+	CHECK(cache.Update() && cache.EnumerateCount() == 1);
+	CHECK(cache.Find(4, "") == 0);
+	provider.mProcess[0].pid = 8; // The cache doesn't see this until it's refreshed.
+	provider.mTick += 49;
+	CHECK(cache.Update() && cache.EnumerateCount() == 1 && cache.ReuseCount() == 1);
+	CHECK(cache.Find(4, "") == 0 && cache.Find(8, "") == -1);
+	provider.mTick += 1;
+	CHECK(cache.Update() && cache.EnumerateCount() == 2);
+	CHECK(cache.Find(4, "") == -1 && cache.Find(8, "") == 0);
+	provider.mProcess[0].pid = 12;
+	cache.Invalidate();
+	CHECK(cache.Update() && cache.EnumerateCount() == 3);
+	CHECK(cache.Find(12, "") == 0);
+	provider.mFail = true;
+	cache.Invalidate();
+	CHECK(!cache.Update() && cache.Count() == 0 && cache.Find(12, "a.exe") == -1);
+	provider.mFail = false;
+	CHECK(cache.Update() && cache.Count() == 1);
+}
+
+
+
+static int ScanList(FakeProcessProvider &aProvider, unsigned aPID, const char *aName)
+// The way ProcessExist9x2000() searched before there was a cache.
+{
+	for (size_t i = 0; i < aProvider.mProcess.size(); ++i)
+		if ((aPID && aProvider.mProcess[i].pid == aPID) || !strcasecmp(aProvider.mProcess[i].name, aName))
+			return (int)i;
+	return -1;
+}
+
+
+
+static void TestFind()
+{
+	static const char *sName[] = {"svchost.exe", "SVCHOST.EXE", "explorer.exe", "notepad.exe", "a", "", "123"};
+	FakeProcessProvider provider;
+	ProcessCache cache(provider, 50);
+	for (int round = 0; round < 40; ++round)
+	{
+		provider.mProcess.clear();
+		int count = round < 20 ? Random() % 100 : Random() % 3000; // Enough for the index to grow.
+		for (int i = 0; i < count; ++i)
+		{
+			FakeProcess process;
+			process.pid = (Random() % 50000) * 4; // Sometimes duplicated, which the system wouldn't do.
+			if (Random() % 4)
+				sprintf(process.name, "proc%u.exe", Random() % (count + 1));
+			else
+				strcpy(process.name, sName[Random() % 7]);
+			provider.mProcess.push_back(process);
+		}
+		cache.Invalidate();
+		CHECK(cache.Update() && cache.Count() == count);
+		for (int i = 0; i < 2000; ++i)
+		{
+			char name[32];
+			unsigned pid = Random() % 3 ? 0 : (Random() % 50000) * 4;
+			if (count && Random() % 2) // Pick an existing one, maybe in a different case.
+			{
+				const FakeProcess &process = provider.mProcess[Random() % count];
+				strcpy(name, process.name);
+				if (Random() % 2)
+					for (char *cp = name; *cp; ++cp)
+						*cp = (char)toupper((unsigned char)*cp);
+				if (Random() % 2)
+					pid = process.pid;
+			}
+			else if (Random() % 2)
+				strcpy(name, sName[Random() % 7]);
+			else
+				sprintf(name, "other%u.exe", Random() % 100);
+			int index = cache.Find(pid, name);
+			CHECK(index == ScanList(provider, pid, name));
+			if (index > -1)
+				CHECK(cache.PID(index) == provider.mProcess[index].pid && !strcmp(cache.Name(index), provider.mProcess[index].name));
+		}
+	}
+}
+
+
+
+static void TestProc()
+{
+	ProcProcessProvider provider;
+	ProcessCache cache(provider, 50);
+	char name[PROCESS_NAME_SIZE] = "";
+	FILE *fp = fopen("/proc/self/comm", "r");
+	if (!fp)
+	{
+		printf("/proc not available; skipped\n");
+		return;
+	}
+	if (!fgets(name, sizeof(name), fp))
+		*name = '\0';
+	fclose(fp);
+	name[strcspn(name, "\n")] = '\0';
+	CHECK(cache.Update() && cache.Count() > 0);
+	int index = cache.Find((unsigned)getpid(), "");
+	CHECK(index > -1 && !strcmp(cache.Name(index), name));
+	index = cache.Find(0, name);
+	CHECK(index > -1 && !strcmp(cache.Name(index), name));
+}
+
+
+
+int main()
+{
+	TestAge();
+	TestFind();
+	TestProc();
+	TEST_RESULT();
+}
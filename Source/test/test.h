@@ -0,0 +1,34 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+#ifndef test_h
+#define test_h
+
+#include <stdio.h>
+
+// The programs in this directory test and benchmark the modules in the parent directory that depend on
+// nothing but the core language and C runtime.  Each test program includes this file, calls CHECK() for
+// every condition it verifies, and returns TEST_RESULT() from main().
+
+static int sTestFailures = 0;
+
+#define CHECK(cond) \
+	do { if (!(cond)) { ++sTestFailures; fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while (0)
+
+#define TEST_RESULT() (sTestFailures ? (fprintf(stderr, "%d check(s) failed\n", sTestFailures), 1) : 0)
+
+#endif
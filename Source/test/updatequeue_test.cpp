@@ -0,0 +1,238 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Drives UpdateQueue the way GuiType drives it, but against a fake set of controls that logs every
+// SetWindowText() rather than against real windows.  The fake window mirrors GuiControl, BeginUpdate(),
+// EndUpdate() and ApplyPendingText(), including the detaching of the queue while it's applied so that an
+// OnMessage function that updates a control during the apply is handled immediately.  Each batch is checked
+// against a plain model: each control that was updated is set exactly once, with the text of its last
+// update, in the order of its first update.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "updatequeue.h"
+#include "test.h"
+
+#define FAKE_CONTROL_COUNT 64
+#define FAKE_TEXT_SIZE 300 // Big enough to force some text blocks to be reallocated.
+
+#define FAKE_LOG_SIZE 1000
+
+struct FakeControl
+{
+	char text[FAKE_TEXT_SIZE];
+	int reentrant_key; // If >= 0, setting this control's text updates that control too (like an OnMessage function).
+};
+
+static FakeControl sControl[FAKE_CONTROL_COUNT];
+static unsigned sLog[FAKE_LOG_SIZE]; // The key of each SetWindowText() since the log was last reset.
+static int sLogCount = 0;
+
+static unsigned sSeed = 12345;
+static unsigned Rand(unsigned aLimit)
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return (sSeed >> 16) % aLimit;
+}
+
+
+
+class FakeWindow
+{
+	UpdateQueue *mPendingText;
+	int mUpdateDepth;
+public:
+	FakeWindow() : mPendingText(NULL), mUpdateDepth(0) {}
+	~FakeWindow() {delete mPendingText;}
+
+	void SetWindowText(unsigned aKey, const char *aText)
+	{
+		FakeControl &control = sControl[aKey];
+		strcpy(control.text, aText);
+		if (sLogCount < FAKE_LOG_SIZE)
+			sLog[sLogCount++] = aKey;
+		if (control.reentrant_key >= 0)
+			GuiControl((unsigned)control.reentrant_key, "reentrant");
+	}
+
+	void GuiControl(unsigned aKey, const char *aText)
+	{
+		if (!mUpdateDepth || !mPendingText || !mPendingText->Put(aKey, aText, strlen(aText)))
+			SetWindowText(aKey, aText);
+	}
+
+	void BeginUpdate()
+	{
+		if (mUpdateDepth++)
+			return;
+		if (!mPendingText)
+			mPendingText = new UpdateQueue;
+	}
+
+	void EndUpdate()
+	{
+		if (!mUpdateDepth || --mUpdateDepth)
+			return;
+		ApplyPendingText();
+	}
+
+	void ApplyPendingText()
+	{
+		UpdateQueue *queue = mPendingText;
+		if (!queue || !queue->Count())
+			return;
+		mPendingText = NULL;
+		for (unsigned i = 0; i < queue->Count(); ++i)
+		{
+			PendingUpdate &item = queue->Item(i);
+			CHECK(item.length == strlen(item.text));
+			SetWindowText(item.key, item.text);
+		}
+		queue->Clear();
+		if (mPendingText)
+			delete queue;
+		else
+			mPendingText = queue;
+	}
+};
+
+
+
+static void RandomText(char *aBuf)
+{
+	int length = Rand(4) ? (int)Rand(20) : (int)Rand(FAKE_TEXT_SIZE - 10); // Mostly short, sometimes long.
+	for (int i = 0; i < length; ++i)
+		aBuf[i] = (char)('a' + Rand(26));
+	aBuf[length] = '\0';
+}
+
+
+
+static void TestBatches(bool aReentrant)
+{
+	FakeWindow window;
+	static char model[FAKE_CONTROL_COUNT][FAKE_TEXT_SIZE]; // The text of each control's last update in this batch.
+	unsigned order[FAKE_CONTROL_COUNT]; // The keys in the order of their first update in this batch.
+	bool updated[FAKE_CONTROL_COUNT];
+	unsigned expected_log[FAKE_LOG_SIZE];
+	static char expected_text[FAKE_CONTROL_COUNT][FAKE_TEXT_SIZE]; // What each control should show after each batch.
+	char text[FAKE_TEXT_SIZE];
+	memset(sControl, 0, sizeof(sControl));
+	memset(expected_text, 0, sizeof(expected_text));
+	for (int k = 0; k < FAKE_CONTROL_COUNT; ++k)
+		sControl[k].reentrant_key = aReentrant && k % 8 == 0 ? (k + 3) % FAKE_CONTROL_COUNT : -1;
+
+	for (int batch = 0; batch < 2000; ++batch)
+	{
+		int order_count = 0;
+		memset(updated, 0, sizeof(updated));
+		sLogCount = 0;
+		window.BeginUpdate();
+		bool nested = Rand(4) == 0;
+		if (nested)
+			window.BeginUpdate();
+		int updates = (int)Rand(batch % 10 == 0 ? 2000 : 100); // Some batches update every control many times.
+		unsigned range = 1 + Rand(FAKE_CONTROL_COUNT);
+		for (int u = 0; u < updates; ++u)
+		{
+			unsigned k = Rand(range);
+			RandomText(text);
+			window.GuiControl(k, text);
+			strcpy(model[k], text);
+			if (!updated[k])
+			{
+				updated[k] = true;
+				order[order_count++] = k;
+			}
+		}
+		if (nested)
+		{
+			window.EndUpdate();
+			CHECK(sLogCount == 0); // Nothing is applied until the outermost EndUpdate().
+		}
+		CHECK(sLogCount == 0);
+		window.EndUpdate();
+
+		// Each reentrant update happens right after the control that triggers it is set, so it might be
+		// overwritten by a queued update that's applied later.
+		int expected_count = 0;
+		for (int i = 0; i < order_count; ++i)
+		{
+			unsigned k = order[i];
+			expected_log[expected_count++] = k;
+			strcpy(expected_text[k], model[k]);
+			if (sControl[k].reentrant_key >= 0)
+			{
+				expected_log[expected_count++] = (unsigned)sControl[k].reentrant_key;
+				strcpy(expected_text[sControl[k].reentrant_key], "reentrant");
+			}
+		}
+		CHECK(sLogCount == expected_count && !memcmp(sLog, expected_log, expected_count * sizeof(unsigned)));
+		for (int k = 0; k < FAKE_CONTROL_COUNT; ++k)
+			CHECK(!strcmp(sControl[k].text, expected_text[k]));
+		if (sTestFailures)
+		{
+			fprintf(stderr, "  in batch %d (reentrant=%d)\n", batch, (int)aReentrant);
+			return;
+		}
+	}
+
+	// Outside a batch, or after an unmatched EndUpdate(), updates are applied immediately.
+	window.EndUpdate();
+	sLogCount = 0;
+	window.GuiControl(5, "now");
+	CHECK(sLogCount == 1 && sLog[0] == 5 && !strcmp(sControl[5].text, "now"));
+}
+
+
+
+static void TestQueue()
+// The queue's own operations, independently of any window.
+{
+	UpdateQueue queue;
+	CHECK(queue.Count() == 0 && queue.Find(7) == -1);
+	CHECK(queue.Put(7, "seven", 5));
+	CHECK(queue.Put(3, "threeXXX", 5)); // Need not be terminated.
+	CHECK(queue.Put(7, "SEVEN!", 6));
+	CHECK(queue.Count() == 2);
+	CHECK(queue.Find(7) == 0 && queue.Find(3) == 1 && queue.Find(4) == -1);
+	CHECK(!strcmp(queue.Item(0).text, "SEVEN!") && queue.Item(0).length == 6);
+	CHECK(!strcmp(queue.Item(1).text, "three") && queue.Item(1).length == 5);
+	char *block = queue.Item(0).text;
+	queue.Clear();
+	CHECK(queue.Count() == 0 && queue.Find(7) == -1);
+	CHECK(queue.Put(9, "nine", 4));
+	CHECK(queue.Item(0).text == block); // The text block of the first item is reused after Clear().
+
+	// Many keys, including ones whose hashes collide, survive growth of the table.
+	for (unsigned k = 0; k < 10000; ++k)
+		CHECK(queue.Put(k * 65536, "x", 1));
+	CHECK(queue.Count() == 10001);
+	for (unsigned k = 0; k < 10000; ++k)
+		CHECK(queue.Find(k * 65536) >= 0 && queue.Item(queue.Find(k * 65536)).key == k * 65536);
+}
+
+
+
+int main()
+{
+	TestQueue();
+	TestBatches(false);
+	TestBatches(true);
+	return TEST_RESULT();
+}
@@ -0,0 +1,131 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Times the building of a 500 MB report by appending 100-character lines to a variable (x .= line), both
+// the way Var::Append() does it now and the way ExpandExpression() used to do it whenever the variable was
+// full: concatenate into temporary memory, then Assign() the result, which frees the old block, allocates one
+// with VarAssignCapacity()'s margin, and copies the result again.  Since the old way is quadratic, it is timed
+// only up to 8 MB, and the new way is timed to that size too for comparison.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "vargrow.h"
+
+#define LINE_LENGTH 100
+#define OLD_LENGTH (8 * 1024 * 1024)
+#define REPORT_LENGTH (500 * 1024 * 1024)
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sSink; // Keeps the compiler from discarding the work.
+
+struct Var {char *contents; size_t length, capacity; int growths;};
+
+
+
+static bool AppendOld(Var &aVar, const char *aStr, size_t aLength)
+{
+	size_t new_length = aVar.length + aLength;
+	if (new_length >= aVar.capacity)
+	{
+		char *temp = (char *)malloc(new_length + 1); // ExpandExpression()'s result buffer.
+		if (!temp)
+			return false;
+		memcpy(temp, aVar.contents, aVar.length);
+		memcpy(temp + aVar.length, aStr, aLength);
+		free(aVar.contents); // Assign() frees the old block before allocating the new one.
+		aVar.capacity = VarAssignCapacity(new_length + 1);
+		if (   !(aVar.contents = (char *)malloc(aVar.capacity))   )
+			return false;
+		memcpy(aVar.contents, temp, new_length);
+		free(temp);
+		++aVar.growths;
+	}
+	else
+		memcpy(aVar.contents + aVar.length, aStr, aLength);
+	aVar.contents[aVar.length = new_length] = '\0';
+	return true;
+}
+
+
+
+static bool AppendNew(Var &aVar, const char *aStr, size_t aLength)
+// Same as Var::Append() for a malloc'd variable.
+{
+	size_t new_length = aVar.length + aLength;
+	if (new_length >= aVar.capacity)
+	{
+		size_t new_size = VarAppendCapacity(aVar.capacity, new_length + 1, (size_t)1 << 30);
+		char *new_mem;
+		if (!new_size || !(new_mem = (char *)realloc(aVar.contents, new_size)))
+			return false;
+		aVar.contents = new_mem;
+		aVar.capacity = new_size;
+		++aVar.growths;
+	}
+	memcpy(aVar.contents + aVar.length, aStr, aLength);
+	aVar.contents[aVar.length = new_length] = '\0';
+	return true;
+}
+
+
+
+static double Build(bool (*aAppend)(Var &, const char *, size_t), size_t aLength, Var &aVar)
+{
+	char line[LINE_LENGTH + 1];
+	memset(line, 'x', LINE_LENGTH - 1);
+	line[LINE_LENGTH - 1] = '\n';
+	aVar.contents = NULL;
+	aVar.length = aVar.capacity = 0;
+	aVar.growths = 0;
+	double start = Seconds();
+	for (size_t i = 0; aVar.length < aLength; ++i)
+	{
+		line[i % (LINE_LENGTH - 1)] = 'a' + i % 26; // So that no two lines are quite the same.
+		if (!aAppend(aVar, line, LINE_LENGTH))
+		{
+			printf("out of memory at %u MB\n", (unsigned)(aVar.length >> 20));
+			exit(1);
+		}
+	}
+	double elapsed = Seconds() - start;
+	sSink = aVar.contents[aVar.length / 2];
+	free(aVar.contents);
+	return elapsed;
+}
+
+
+
+int main()
+{
+	Var var;
+	double old_time = Build(AppendOld, OLD_LENGTH, var);
+	int old_growths = var.growths;
+	double new_time = Build(AppendNew, OLD_LENGTH, var);
+	printf("%3u MB: old %8.1f ms (%4d reallocations), new %6.1f ms (%2d reallocations) (%.0fx faster)\n"
+		, OLD_LENGTH >> 20, old_time * 1e3, old_growths, new_time * 1e3, var.growths, old_time / new_time);
+	new_time = Build(AppendNew, REPORT_LENGTH, var);
+	printf("%3u MB: new %6.1f ms (%2d reallocations, %u MB capacity), %.0f MB/s\n", REPORT_LENGTH >> 20
+		, new_time * 1e3, var.growths, (unsigned)(var.capacity >> 20), (REPORT_LENGTH >> 20) / new_time);
+	return 0;
+}
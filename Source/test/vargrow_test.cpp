@@ -0,0 +1,106 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+// Checks the capacities chosen by VarAssignCapacity() against the margins Var::Assign() has always used, and
+// that VarAppendCapacity() always leaves enough room, obeys the limits, and grows geometrically enough that
+// building a large string one piece at a time copies each byte only a few times in all.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "vargrow.h"
+#include "test.h"
+
+static unsigned sSeed = 1;
+
+static unsigned Random()
+{
+	sSeed = sSeed * 1103515245 + 12345;
+	return sSeed >> 8;
+}
+
+
+
+static void TestAssign()
+{
+	CHECK(VarAssignCapacity(1) == 16);
+	CHECK(VarAssignCapacity(16) == 260);
+	CHECK(VarAssignCapacity(259) == 260);
+	CHECK(VarAssignCapacity(1000) == 1100);
+	CHECK(VarAssignCapacity(200 * 1024) == 200 * 1024 + 16 * 1024);
+	CHECK(VarAssignCapacity(2000 * 1024) == (size_t)(2000 * 1024 * 1.01));
+	CHECK(VarAssignCapacity(100 * 1024 * 1024) == 100 * 1024 * 1024 + 64 * 1024);
+	for (int i = 0; i < 100000; ++i)
+	{
+		size_t space_needed = 1 + Random() % (16 * 1024 * 1024);
+		size_t capacity = VarAssignCapacity(space_needed);
+		CHECK(capacity >= space_needed && capacity <= space_needed + 64 * 1024);
+	}
+}
+
+
+
+static void TestAppend()
+{
+	for (int i = 0; i < 100000; ++i)
+	{
+		size_t capacity = Random() % (64 * 1024 * 1024);
+		size_t space_needed = capacity + 1 + Random() % (Random() & 1 ? 100 : 64 * 1024 * 1024);
+		size_t max_capacity = space_needed + Random() % (64 * 1024 * 1024);
+		size_t new_capacity = VarAppendCapacity(capacity, space_needed, max_capacity);
+		CHECK(new_capacity >= space_needed && new_capacity <= max_capacity);
+		CHECK(new_capacity >= capacity + capacity / 2 || new_capacity == max_capacity);
+	}
+	CHECK(VarAppendCapacity(1000, 1001, 1001) == 1001); // Limited to #MaxMem even though that's less than 50%.
+	if (sizeof(size_t) > 4)
+	{
+		size_t two_gb = (size_t)2147483647 + 1;
+		CHECK(VarAppendCapacity(two_gb / 2, two_gb, two_gb * 2) == 0);
+		CHECK(VarAppendCapacity(two_gb / 2, two_gb - 1, two_gb * 2) == two_gb - 1);
+	}
+}
+
+
+
+static void TestAmortized()
+// Appends pieces of up to 200 bytes until the string reaches 1 GB, counting the bytes a realloc() that
+// can't grow in place would copy.
+{
+	size_t length = 0, capacity = 0, copied = 0, growths = 0, max_capacity = (size_t)1 << 30;
+	while (length < max_capacity - 200)
+	{
+		size_t new_length = length + 1 + Random() % 200;
+		if (new_length + 1 > capacity)
+		{
+			capacity = VarAppendCapacity(capacity, new_length + 1, max_capacity);
+			copied += length;
+			++growths;
+		}
+		CHECK(new_length + 1 <= capacity);
+		length = new_length;
+	}
+	CHECK(copied <= 3 * length);
+	CHECK(growths < 60);
+}
+
+
+
+int main()
+{
+	TestAssign();
+	TestAppend();
+	TestAmortized();
+	TEST_RESULT();
+}
@@ -0,0 +1,134 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Times xoshiro.h against the Mersenne Twister it replaced (std::mt19937 stands in for the removed
+// mt19937ar-cok module, since both implement the same MT19937), one number at a time and in the blocks that
+// Random's Count parameter uses.
+
+#include <stdio.h>
+#include <time.h>
+#include <random>
+#include "xoshiro.h"
+
+#define ITERATIONS 20000000
+#define BLOCK_COUNT 1024
+
+static double Seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile unsigned sSink; // Keeps the compiler from discarding the work.
+static volatile double sDoubleSink;
+
+static void Report(const char *aWhat, double aFast, double aOld)
+{
+	printf("%-28s %6.2f ns vs. %6.2f ns for MT19937 (%.1fx)\n", aWhat
+		, aFast * 1e9 / ITERATIONS, aOld * 1e9 / ITERATIONS, aOld / aFast);
+}
+
+
+
+int main()
+{
+	RandomState state;
+	RandomSeed(state, 1);
+	std::mt19937 mt(1);
+	static unsigned int_buf[BLOCK_COUNT];
+	static double double_buf[BLOCK_COUNT];
+	unsigned sum;
+	double dsum, start, fast;
+	int i, j;
+
+	start = Seconds();
+	for (sum = 0, i = 0; i < ITERATIONS; ++i)
+		sum += (unsigned)RandomNext(state);
+	fast = Seconds() - start;
+	sSink = sum;
+	start = Seconds();
+	for (sum = 0, i = 0; i < ITERATIONS; ++i)
+		sum += mt();
+	sSink = sum;
+	Report("RandomNext", fast, Seconds() - start);
+
+	start = Seconds();
+	for (sum = 0, i = 0; i < ITERATIONS; ++i)
+		sum += RandomBelow(state, 1000);
+	fast = Seconds() - start;
+	sSink = sum;
+	start = Seconds();
+	for (sum = 0, i = 0; i < ITERATIONS; ++i)
+		sum += mt() % 1000; // The biased method that was replaced.
+	sSink = sum;
+	Report("RandomBelow(1000)", fast, Seconds() - start);
+
+	start = Seconds();
+	for (dsum = 0, i = 0; i < ITERATIONS; ++i)
+		dsum += RandomUnit(state);
+	fast = Seconds() - start;
+	sDoubleSink = dsum;
+	start = Seconds();
+	for (dsum = 0, i = 0; i < ITERATIONS; ++i)
+		dsum += mt() * (1.0 / 4294967295.0); // As genrand_real1() did.
+	sDoubleSink = dsum;
+	Report("RandomUnit", fast, Seconds() - start);
+
+	start = Seconds();
+	for (sum = 0, i = 0; i < ITERATIONS; i += BLOCK_COUNT)
+	{
+		RandomFillBelow(state, int_buf, BLOCK_COUNT, 1000);
+		sum += int_buf[i & (BLOCK_COUNT - 1)];
+	}
+	fast = Seconds() - start;
+	sSink = sum;
+	start = Seconds();
+	for (sum = 0, i = 0; i < ITERATIONS; i += BLOCK_COUNT)
+	{
+		for (j = 0; j < BLOCK_COUNT; ++j)
+			int_buf[j] = mt() % 1000;
+		sum += int_buf[i & (BLOCK_COUNT - 1)];
+	}
+	sSink = sum;
+	Report("RandomFillBelow(1000)", fast, Seconds() - start);
+
+	start = Seconds();
+	for (dsum = 0, i = 0; i < ITERATIONS; i += BLOCK_COUNT)
+	{
+		RandomFillUnit(state, double_buf, BLOCK_COUNT);
+		dsum += double_buf[i & (BLOCK_COUNT - 1)];
+	}
+	fast = Seconds() - start;
+	sDoubleSink = dsum;
+	start = Seconds();
+	for (dsum = 0, i = 0; i < ITERATIONS; i += BLOCK_COUNT)
+	{
+		for (j = 0; j < BLOCK_COUNT; ++j)
+			double_buf[j] = mt() * (1.0 / 4294967295.0);
+		dsum += double_buf[i & (BLOCK_COUNT - 1)];
+	}
+	sDoubleSink = dsum;
+	Report("RandomFillUnit", fast, Seconds() - start);
+
+	start = Seconds();
+	for (i = 0; i < 100000; ++i)
+		RandomJump(state);
+	printf("%-28s %6.0f ns\n", "RandomJump", (Seconds() - start) * 1e9 / 100000);
+	sSink = (unsigned)state.s[0];
+	return 0;
+}
@@ -0,0 +1,193 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+
+// Checks xoshiro.h against the output of the reference implementations of xoshiro256** and SplitMix64, checks
+// that RandomJump() commutes with RandomNext() as a jump ahead must, and runs statistical smoke tests on
+// RandomBelow() and RandomUnit(): chi-squared for uniformity (including a range chosen to expose the bias of
+// taking a remainder), the mean and variance of RandomUnit(), and the frequency of each bit.  The smoke tests
+// use fixed seeds and generous thresholds, so they catch gross mistakes without ever failing by chance.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "xoshiro.h"
+#include "test.h"
+
+
+
+static void TestReferenceVectors()
+{
+	// The first values produced by the reference xoshiro256** from the state {1, 2, 3, 4}.
+	static const RandomUInt64Type sExpected[] = {11520ULL, 0ULL, 1509978240ULL, 1215971899390074240ULL
+		, 0x10E0B61CE1009D80ULL};
+	RandomState state = {{1, 2, 3, 4}};
+	for (int i = 0; i < 5; ++i)
+		CHECK(RandomNext(state) == sExpected[i]);
+
+	// SplitMix64 from a seed of 0, whose first output is the widely published 0xE220A8397B1DCDAF.
+	RandomSeed(state, 0);
+	CHECK(state.s[0] == 0xE220A8397B1DCDAFULL && state.s[1] == 0x6E789E6AA1B965F4ULL
+		&& state.s[2] == 0x06C45D188009454FULL && state.s[3] == 0xF88BB8A8724C81ECULL);
+	CHECK(RandomNext(state) == 0x99EC5F36CB75F2B4ULL);
+	CHECK(RandomNext(state) == 0xBF6E1F784956452AULL);
+
+	// The reference jump() applied to {1, 2, 3, 4}.
+	RandomState jumped = {{1, 2, 3, 4}};
+	RandomJump(jumped);
+	CHECK(jumped.s[0] == 0x8C7A153956B5F3D1ULL && jumped.s[1] == 0x701F1A713401D85EULL
+		&& jumped.s[2] == 0x6527F66A65469085ULL && jumped.s[3] == 0x8386B786C4408050ULL);
+}
+
+
+
+static void TestJump()
+// Jumping 2^128 values ahead and then taking N steps must reach the same state as taking N steps and then
+// jumping, and the jumped stream must not start with the same values as the original.
+{
+	RandomState a, b;
+	RandomSeed(a, 12345);
+	b = a;
+	RandomJump(a);
+	for (int i = 0; i < 1000; ++i)
+		RandomNext(a);
+	for (int i = 0; i < 1000; ++i)
+		RandomNext(b);
+	RandomJump(b);
+	CHECK(!memcmp(&a, &b, sizeof(a)));
+
+	RandomSeed(a, 12345);
+	b = a;
+	RandomJump(b);
+	int same = 0;
+	for (int i = 0; i < 1000; ++i)
+		same += RandomNext(a) == RandomNext(b);
+	CHECK(same == 0);
+}
+
+
+
+static double ChiSquared(const unsigned *aCount, unsigned aBins, unsigned aSamples)
+{
+	double expected = (double)aSamples / aBins, chi2 = 0;
+	for (unsigned i = 0; i < aBins; ++i)
+		chi2 += (aCount[i] - expected) * (aCount[i] - expected) / expected;
+	return chi2;
+}
+
+
+
+static void TestBelow()
+{
+	RandomState state;
+	RandomSeed(state, 42);
+	static unsigned count[1000];
+	static unsigned buf[100000];
+
+	// For each range, chi-squared must be well within what uniform numbers produce: its mean is bins - 1 and
+	// its standard deviation is sqrt(2 * (bins - 1)), so 6 deviations above the mean is never reached by chance.
+	static const unsigned sRange[] = {1, 2, 3, 7, 10, 100, 1000};
+	for (int r = 0; r < (int)(sizeof(sRange) / sizeof(sRange[0])); ++r)
+	{
+		unsigned range = sRange[r], samples = range * 1000;
+		memset(count, 0, sizeof(count));
+		for (unsigned i = 0; i < samples; ++i)
+		{
+			unsigned n = RandomBelow(state, range);
+			CHECK(n < range);
+			++count[n < range ? n : 0];
+		}
+		if (range > 1)
+			CHECK(ChiSquared(count, range, samples) < range - 1 + 6 * sqrt(2.0 * (range - 1)));
+		// RandomFillBelow() must produce exactly what calling RandomBelow() would have.
+		RandomState a = state, b = state;
+		RandomFillBelow(a, buf, 1000, range);
+		for (int i = 0; i < 1000; ++i)
+			CHECK(buf[i] == RandomBelow(b, range));
+		CHECK(!memcmp(&a, &b, sizeof(a)));
+	}
+
+	// With a range of 3 * 2^30, the remainder method would return numbers below 2^30 twice as often as the
+	// others (one half versus one third of the time).  Lemire's method must not.
+	unsigned range = 3U << 30, low = 0, samples = 1000000;
+	for (unsigned i = 0; i < samples; ++i)
+		low += RandomBelow(state, range) < (1U << 30);
+	CHECK(fabs((double)low / samples - 1.0 / 3) < 0.005); // About 10 standard deviations.
+
+	// A range of 0 means all 2^32 values, so both halves must occur.
+	unsigned high = 0;
+	for (unsigned i = 0; i < 1000; ++i)
+		high += RandomBelow(state, 0) >= 0x80000000U;
+	CHECK(high > 400 && high < 600);
+}
+
+
+
+static void TestUnit()
+{
+	RandomState state;
+	RandomSeed(state, 7);
+	static double buf[1000000];
+	const int samples = (int)(sizeof(buf) / sizeof(buf[0]));
+	RandomState copy = state;
+	RandomFillUnit(state, buf, samples);
+	double sum = 0, sum_sq = 0;
+	unsigned count[100] = {0};
+	for (int i = 0; i < samples; ++i)
+	{
+		double x = buf[i];
+		CHECK(x >= 0 && x <= 1);
+		if (i < 1000)
+			CHECK(x == RandomUnit(copy)); // RandomFillUnit() must match RandomUnit().
+		sum += x;
+		sum_sq += x * x;
+		++count[x < 1 ? (int)(x * 100) : 99];
+	}
+	double mean = sum / samples, variance = sum_sq / samples - mean * mean;
+	CHECK(fabs(mean - 0.5) < 0.002);            // The standard error is about 0.0003.
+	CHECK(fabs(variance - 1.0 / 12) < 0.001);
+	CHECK(ChiSquared(count, 100, samples) < 99 + 6 * sqrt(2.0 * 99));
+}
+
+
+
+static void TestBits()
+// Every bit of RandomNext() must be set about half the time.
+{
+	RandomState state;
+	RandomSeed(state, 99);
+	unsigned count[64] = {0}, samples = 100000;
+	for (unsigned i = 0; i < samples; ++i)
+	{
+		RandomUInt64Type x = RandomNext(state);
+		for (int b = 0; b < 64; ++b)
+			count[b] += (unsigned)(x >> b) & 1;
+	}
+	for (int b = 0; b < 64; ++b)
+		CHECK(count[b] > samples / 2 - 1000 && count[b] < samples / 2 + 1000); // About 6 standard deviations.
+}
+
+
+
+int main()
+{
+	TestReferenceVectors();
+	TestJump();
+	TestBelow();
+	TestUnit();
+	TestBits();
+	return TEST_RESULT();
+}
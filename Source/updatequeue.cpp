@@ -0,0 +1,139 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include <string.h>
+#include "updatequeue.h"
+
+#define UPDATE_QUEUE_MIN_CAPACITY 16
+
+
+
+static inline unsigned UpdateQueueHash(unsigned aKey, unsigned aSlotCount)
+{
+	unsigned hash = aKey * 2654435761U; // Knuth's multiplicative constant.
+	return (hash ^ (hash >> 16)) & (aSlotCount - 1);
+}
+
+
+
+UpdateQueue::UpdateQueue()
+	: mItem(NULL), mCount(0), mCapacity(0), mSlot(NULL), mSlotCount(0)
+{
+}
+
+
+
+UpdateQueue::~UpdateQueue()
+{
+	Clear();
+	for (unsigned i = 0; i < mCapacity; ++i) // Clear() keeps the text blocks for reuse, so free them here.
+		free(mItem[i].text);
+	free(mItem);
+	free(mSlot);
+}
+
+
+
+int UpdateQueue::Find(unsigned aKey)
+// Returns the index of aKey's item, or -1 if it isn't in the queue.
+{
+	if (!mCount)
+		return -1;
+	unsigned u;
+	for (unsigned i = UpdateQueueHash(aKey, mSlotCount); (u = mSlot[i]) != 0; i = (i + 1) & (mSlotCount - 1))
+		if (mItem[u - 1].key == aKey)
+			return (int)(u - 1);
+	return -1;
+}
+
+
+
+bool UpdateQueue::Grow()
+{
+	unsigned new_capacity = mCapacity ? mCapacity * 2 : UPDATE_QUEUE_MIN_CAPACITY;
+	PendingUpdate *new_item = (PendingUpdate *)realloc(mItem, new_capacity * sizeof(PendingUpdate));
+	if (!new_item)
+		return false;
+	mItem = new_item;
+	memset(mItem + mCapacity, 0, (new_capacity - mCapacity) * sizeof(PendingUpdate)); // So that text blocks are NULL until first used.
+	mCapacity = new_capacity;
+	unsigned new_slot_count = new_capacity * 2;
+	unsigned *new_slot = (unsigned *)calloc(new_slot_count, sizeof(unsigned));
+	if (!new_slot)
+		return false; // mCapacity has grown but mSlot is still valid for the old capacity, and Put() checks against mSlotCount.
+	free(mSlot);
+	mSlot = new_slot;
+	mSlotCount = new_slot_count;
+	for (unsigned u = 0; u < mCount; ++u)
+	{
+		unsigned i;
+		for (i = UpdateQueueHash(mItem[u].key, mSlotCount); mSlot[i]; i = (i + 1) & (mSlotCount - 1));
+		mSlot[i] = u + 1;
+	}
+	return true;
+}
+
+
+
+bool UpdateQueue::Put(unsigned aKey, const char *aText, size_t aLength)
+// Queues aText (which need not be terminated) as the new text for aKey, replacing any text already queued
+// for it.  Returns false if out of memory, in which case the queue is unchanged.
+{
+	int index = Find(aKey);
+	bool is_new = (index == -1);
+	if (is_new)
+	{
+		if ((mCount + 1) * 2 > mSlotCount && !Grow())
+			return false;
+		index = (int)mCount;
+	}
+	PendingUpdate &item = mItem[index];
+	if (!item.text || item.capacity <= aLength)
+	{
+		size_t new_capacity = aLength < 64 ? 64 : aLength + 1;
+		char *new_text = (char *)malloc(new_capacity);
+		if (!new_text)
+			return false;
+		free(item.text);
+		item.text = new_text;
+		item.capacity = new_capacity;
+	}
+	memcpy(item.text, aText, aLength);
+	item.text[aLength] = '\0';
+	item.length = aLength;
+	if (is_new)
+	{
+		item.key = aKey;
+		unsigned i;
+		for (i = UpdateQueueHash(aKey, mSlotCount); mSlot[i]; i = (i + 1) & (mSlotCount - 1));
+		mSlot[i] = ++mCount;
+	}
+	return true;
+}
+
+
+
+void UpdateQueue::Clear()
+// Empties the queue but keeps its memory (including each item's text block) for reuse, since a queue
+// tends to be refilled with a similar number of updates each time.
+{
+	if (!mCount)
+		return;
+	memset(mSlot, 0, mSlotCount * sizeof(unsigned));
+	mCount = 0;
+}
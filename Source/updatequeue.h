@@ -0,0 +1,58 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef updatequeue_h
+#define updatequeue_h
+
+#include <stddef.h> // For size_t.
+
+// UpdateQueue holds the pending new text of a set of objects (such as the controls of a GUI window) so that
+// the text can be applied all at once later.  Each object is identified by a small unsigned key.  Putting
+// text for a key that is already in the queue replaces that text but keeps the key's original position, so
+// no matter how many times an object is updated, it's applied only once, and objects are applied in the
+// order in which they were first updated.
+//
+// The queue knows nothing about windows: GuiType applies the text itself, and test/updatequeue_test.cpp
+// applies it to a fake set of controls instead.
+
+struct PendingUpdate
+{
+	unsigned key;
+	char *text;
+	size_t length;
+	size_t capacity; // Size of the block allocated for text, which is reused by later updates of the same key.
+};
+
+class UpdateQueue
+{
+	PendingUpdate *mItem;
+	unsigned mCount, mCapacity;
+	unsigned *mSlot; // Open-addressed hash table of (item index + 1) keyed by PendingUpdate::key.  Zero means an empty slot.
+	unsigned mSlotCount; // Zero or a power of two, kept at least twice mCount so that probe sequences stay short.
+
+	bool Grow();
+
+public:
+	UpdateQueue();
+	~UpdateQueue();
+	unsigned Count() {return mCount;}
+	PendingUpdate &Item(unsigned aIndex) {return mItem[aIndex];}
+	int Find(unsigned aKey);
+	bool Put(unsigned aKey, const char *aText, size_t aLength);
+	void Clear();
+};
+
+#endif
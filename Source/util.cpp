@@ -78,6 +78,18 @@ int GetISOWeekNumber(char *aBuf, int aYear, int aYDay, int aWDay)
 
 
 
+static inline void SystemTimeToCalendarTime(SYSTEMTIME &aSystemTime, CalendarTime &aTime)
+{
+	aTime.year = aSystemTime.wYear;
+	aTime.month = aSystemTime.wMonth;
+	aTime.day = aSystemTime.wDay;
+	aTime.hour = aSystemTime.wHour;
+	aTime.minute = aSystemTime.wMinute;
+	aTime.second = aSystemTime.wSecond;
+}
+
+
+
 ResultType YYYYMMDDToFileTime(char *aYYYYMMDD, FILETIME &aFileTime)
 {
 	SYSTEMTIME st;
@@ -86,7 +98,17 @@ ResultType YYYYMMDDToFileTime(char *aYYYYMMDD, FILETIME &aFileTime)
 	// explicit zero for the day of the month.  It also reports failure if st.wYear is
 	// less than 1601, which for simplicity is enforced globally throughout the program
 	// since none of the Windows API calls seem to support earlier years.
-	return SystemTimeToFileTime(&st, &aFileTime) ? OK : FAIL; // The st.wDayOfWeek member is ignored.
+	// The conversion is done arithmetically rather than via SystemTimeToFileTime(), which performs the
+	// same validation but is much slower, and matters to scripts that do date math in a loop.
+	CalendarTime ct;
+	SystemTimeToCalendarTime(st, ct);
+	if (!CalendarTimeIsValid(ct))
+		return FAIL;
+	ULARGE_INTEGER ul;
+	ul.QuadPart = (ULONGLONG)CalendarTimeToSeconds(ct) * 10000000; // Convert to tenths-of-microsecond.
+	aFileTime.dwLowDateTime = ul.LowPart;
+	aFileTime.dwHighDateTime = ul.HighPart;
+	return OK;
 }
 
 
@@ -126,6 +148,22 @@ DWORD YYYYMMDDToSystemTime2(char *aYYYYMMDD, SYSTEMTIME *aSystemTime)
 
 
 
+static int YYYYMMDDField(char *aField, int aWidth)
+// Returns what atoi() would return for the first aWidth chars of aField (or fewer if aField is shorter).
+{
+	char *end = aField + aWidth;
+	for (; aField < end && (*aField == ' ' || (*aField >= '\t' && *aField <= '\r')); ++aField); // Same as isspace() in the "C" locale.
+	bool is_negative = false;
+	if (aField < end && (*aField == '-' || *aField == '+'))
+		is_negative = (*aField++ == '-');
+	int value = 0;
+	for (; aField < end && *aField >= '0' && *aField <= '9'; ++aField) // This also stops at the terminator.
+		value = value * 10 + (*aField - '0');
+	return is_negative ? -value : value;
+}
+
+
+
 ResultType YYYYMMDDToSystemTime(char *aYYYYMMDD, SYSTEMTIME &aSystemTime, bool aDoValidate)
 // Although aYYYYMMDD need not be terminated at the end of the YYYYMMDDHH24MISS string (as long as
 // the string's capacity is at least 14), it should be terminated if only the leading part
@@ -136,16 +174,16 @@ ResultType YYYYMMDDToSystemTime(char *aYYYYMMDD, SYSTEMTIME &aSystemTime, bool a
 // (Windows generally does not support earlier years).
 {
 	// sscanf() is avoided because it adds 2 KB to the compressed EXE size.
-	char temp[16];
 	size_t length = strlen(aYYYYMMDD); // Use this rather than incrementing the pointer in case there are ever partial fields such as 20051 vs. 200501.
 
-	strlcpy(temp, aYYYYMMDD, 5);
-	aSystemTime.wYear = atoi(temp);
+	// Each field is interpreted as atoi() would interpret a copy of it that's been terminated at the
+	// field's width.  This is done without actually making a copy, for performance.
+	#define YYYYMMDD_FIELD(field, width) YYYYMMDDField(aYYYYMMDD + field, width)
+	aSystemTime.wYear = YYYYMMDD_FIELD(0, 4);
 
 	if (length > 4) // It has a month component.
 	{
-		strlcpy(temp, aYYYYMMDD + 4, 3);
-		aSystemTime.wMonth = atoi(temp);  // Unlike "struct tm", SYSTEMTIME uses 1 for January, not 0.
+		aSystemTime.wMonth = YYYYMMDD_FIELD(4, 2);  // Unlike "struct tm", SYSTEMTIME uses 1 for January, not 0.
 		// v1.0.48: Changed not to provide a default when month number is out-of-range.
 		// This allows callers like "if var is time" to properly detect badly-formatted dates.
 	}
@@ -153,34 +191,22 @@ ResultType YYYYMMDDToSystemTime(char *aYYYYMMDD, SYSTEMTIME &aSystemTime, bool a
 		aSystemTime.wMonth = 1;
 
 	if (length > 6) // It has a day-of-month component.
-	{
-		strlcpy(temp, aYYYYMMDD + 6, 3);
-		aSystemTime.wDay = atoi(temp);
-	}
+		aSystemTime.wDay = YYYYMMDD_FIELD(6, 2);
 	else
 		aSystemTime.wDay = 1;
 
 	if (length > 8) // It has an hour component.
-	{
-		strlcpy(temp, aYYYYMMDD + 8, 3);
-		aSystemTime.wHour = atoi(temp);
-	}
+		aSystemTime.wHour = YYYYMMDD_FIELD(8, 2);
 	else
 		aSystemTime.wHour = 0;   // Midnight.
 
 	if (length > 10) // It has a minutes component.
-	{
-		strlcpy(temp, aYYYYMMDD + 10, 3);
-		aSystemTime.wMinute = atoi(temp);
-	}
+		aSystemTime.wMinute = YYYYMMDD_FIELD(10, 2);
 	else
 		aSystemTime.wMinute = 0;
 
 	if (length > 12) // It has a seconds component.
-	{
-		strlcpy(temp, aYYYYMMDD + 12, 3);
-		aSystemTime.wSecond = atoi(temp);
-	}
+		aSystemTime.wSecond = YYYYMMDD_FIELD(12, 2);
 	else
 		aSystemTime.wSecond = 0;
 
@@ -206,12 +232,14 @@ ResultType YYYYMMDDToSystemTime(char *aYYYYMMDD, SYSTEMTIME &aSystemTime, bool a
 
 	if (aDoValidate)
 	{
-		FILETIME ft;
 		// This will return failure if aYYYYMMDD contained any invalid elements, such as an
 		// explicit zero for the day of the month.  It also reports failure if st.wYear is
 		// less than 1601, which for simplicity is enforced globally throughout the program
-		// since none of the Windows API calls seem to support earlier years.
-		return SystemTimeToFileTime(&aSystemTime, &ft) ? OK : FAIL;
+		// since none of the Windows API calls seem to support earlier years.  This is the same
+		// validation that SystemTimeToFileTime() does, but without the call.
+		CalendarTime ct;
+		SystemTimeToCalendarTime(aSystemTime, ct);
+		return CalendarTimeIsValid(ct) ? OK : FAIL;
 		// Above: The st.wDayOfWeek member is ignored by the above (but might be used by our caller), but
 		// that's okay because it shouldn't need validation.
 	}
@@ -228,11 +256,18 @@ char *FileTimeToYYYYMMDD(char *aBuf, FILETIME &aTime, bool aConvertToLocalTime)
 		FileTimeToLocalFileTime(&aTime, &ft); // MSDN says that target cannot be the same var as source.
 	else
 		memcpy(&ft, &aTime, sizeof(FILETIME));  // memcpy() might be less code size that a struct assignment, ft = aTime.
-	SYSTEMTIME st;
-	if (FileTimeToSystemTime(&ft, &st))
-		return SystemTimeToYYYYMMDD(aBuf, st);
-	*aBuf = '\0';
-	return aBuf;
+	ULARGE_INTEGER ul;
+	ul.LowPart = ft.dwLowDateTime;
+	ul.HighPart = ft.dwHighDateTime;
+	if (ul.QuadPart & 0x8000000000000000) // Out of range, which FileTimeToSystemTime() would also reject.
+	{
+		*aBuf = '\0';
+		return aBuf;
+	}
+	// Convert arithmetically rather than via FileTimeToSystemTime(), which is much slower:
+	CalendarTime ct;
+	SecondsToCalendarTime((__int64)(ul.QuadPart / 10000000), ct);
+	return CalendarTimeToYYYYMMDD(ct, aBuf);
 }
 
 
@@ -243,10 +278,16 @@ char *SystemTimeToYYYYMMDD(char *aBuf, SYSTEMTIME &aTime)
 // on Win9x apparently results in an invalid time because the function is implemented only as a stub on
 // those OSes.
 {
-	sprintf(aBuf, "%04d%02d%02d" "%02d%02d%02d"
-		, aTime.wYear, aTime.wMonth, aTime.wDay
-		, aTime.wHour, aTime.wMinute, aTime.wSecond);
-	return aBuf;
+	if (aTime.wMonth > 99 || aTime.wDay > 99 || aTime.wHour > 99 || aTime.wMinute > 99 || aTime.wSecond > 99) // Too wide for the faster method below.
+	{
+		sprintf(aBuf, "%04d%02d%02d" "%02d%02d%02d"
+			, aTime.wYear, aTime.wMonth, aTime.wDay
+			, aTime.wHour, aTime.wMinute, aTime.wSecond);
+		return aBuf;
+	}
+	CalendarTime ct;
+	SystemTimeToCalendarTime(aTime, ct);
+	return CalendarTimeToYYYYMMDD(ct, aBuf);
 }
 
 
@@ -319,6 +360,9 @@ SymbolType IsPureNumeric(char *aBuf, BOOL aAllowNegative, BOOL aAllowAllWhitespa
 // Obsolete comment: Making this non-inline reduces the size of the compressed EXE by only 2K.  Since this
 // function is called so often, it seems preferable to keep it inline for performance.
 {
+#ifdef REPORT_EXIT_STATS
+	++g_PureNumericCalls; // Reported upon exit by ReportPureNumeric().
+#endif
 	aBuf = omit_leading_whitespace(aBuf); // i.e. caller doesn't have to have ltrimmed, only rtrimmed.
 	if (!*aBuf) // The string is empty or consists entirely of whitespace.
 		return aAllowAllWhitespace ? PURE_INTEGER : PURE_NOT_NUMERIC;
@@ -397,7 +441,15 @@ SymbolType IsPureNumeric(char *aBuf, BOOL aAllowNegative, BOOL aAllowAllWhitespa
 				}
 			}
 			else // This character is a valid digit or hex-digit.
+			{
 				has_at_least_one_digit = true;
+				// Skip any further decimal digits four at a time, which greatly speeds up long strings of
+				// digits such as those built by concatenation.  Only aligned DWORDs are read, so this can't
+				// read beyond the memory page that contains the string's terminator.
+				#define IS_FOUR_DIGITS(dw) (((dw) & 0xF0F0F0F0) == 0x30303030 && (((dw) + 0x06060606) & 0xF0F0F0F0) == 0x30303030)
+				if (!is_hex)
+					for (; !((size_t)(aBuf + 1) & 3) && IS_FOUR_DIGITS(*(UINT *)(aBuf + 1)); aBuf += 4);
+			}
 		}
 	} // for()
 
@@ -19,6 +19,8 @@ GNU General Public License for more details.
 
 #include "stdafx.h" // pre-compiled headers
 #include "defines.h"
+#include "numconv.h" // For ITOA(), ATOF() and related functions.
+#include "calendar.h" // For CalendarTime.
 EXTERN_G;  // For ITOA() and related functions' use of g->FormatIntAsHex
 
 #define IS_SPACE_OR_TAB(c) (c == ' ' || c == '\t')
@@ -370,7 +372,21 @@ inline double ATOF(char *buf)
 // such as "0xFF" automatically.  So this macro must check for hex because some callers rely on that.
 // Also, it uses _strtoi64() vs. strtol() so that more of a double's capacity can be utilized:
 {
-	return IsHex(buf) ? (double)_strtoi64(buf, NULL, 16) : atof(buf);
+	if (IsHex(buf))
+		return (double)_strtoi64(buf, NULL, 16);
+	double result;
+	return DecimalToDouble(buf, result) ? result : atof(buf); // The former handles the common cases several times faster.
+}
+
+inline int FTOA(double value, char *buf, int buf_size)
+// Formats value according to SetFormat (g->FormatFloat) and returns the length, like snprintf().
+// The common "%0.Nf" formats are produced without snprintf() whenever the result is certain to be
+// the same as snprintf()'s.
+{
+	int length;
+	if (g->FormatFloatPrecision < 0 || (length = DoubleToFixed(value, g->FormatFloatPrecision, buf)) < 0)
+		length = snprintf(buf, buf_size, g->FormatFloat, value);
+	return length;
 }
 
 inline char *ITOA(int value, char *buf)
@@ -385,12 +401,12 @@ inline char *ITOA(int value, char *buf)
 			*our_buf_temp++ = '-';
 		*our_buf_temp++ = '0';
 		*our_buf_temp++ = 'x';
-		_itoa(value < 0 ? -(int)value : value, our_buf_temp, 16);
+		UInt64ToHex(value < 0 ? 0U - (unsigned int)value : (unsigned int)value, our_buf_temp);
 		// Must not return the result of the above because it's our_buf_temp and we want buf.
 		return buf;
 	}
 	else
-		return _itoa(value, buf, 10);
+		return Int64ToDecimal(value, buf);
 }
 
 inline char *ITOA64(__int64 value, char *buf)
@@ -402,12 +418,12 @@ inline char *ITOA64(__int64 value, char *buf)
 			*our_buf_temp++ = '-';
 		*our_buf_temp++ = '0';
 		*our_buf_temp++ = 'x';
-		_i64toa(value < 0 ? -(__int64)value : value, our_buf_temp, 16);
+		UInt64ToHex(value < 0 ? 0 - (unsigned __int64)value : value, our_buf_temp); // Negated as unsigned so that the most negative value is handled correctly.
 		// Must not return the result of the above because it's our_buf_temp and we want buf.
 		return buf;
 	}
 	else
-		return _i64toa(value, buf, 10);
+		return Int64ToDecimal(value, buf);
 }
 
 inline char *UTOA(unsigned long value, char *buf)
@@ -416,12 +432,12 @@ inline char *UTOA(unsigned long value, char *buf)
 	{
 		*buf = '0';
 		*(buf + 1) = 'x';
-		_ultoa(value, buf + 2, 16);
+		UInt64ToHex(value, buf + 2);
 		// Must not return the result of the above because it's buf + 2 and we want buf.
 		return buf;
 	}
 	else
-		return _ultoa(value, buf, 10);
+		return UInt64ToDecimal(value, buf);
 }
 
 // Not currently used:
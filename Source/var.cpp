@@ -17,10 +17,13 @@ GNU General Public License for more details.
 #include "stdafx.h" // pre-compiled headers
 #include "var.h"
 #include "globaldata.h" // for g_script
+#include "vargrow.h" // For VarAssignCapacity() and VarAppendCapacity().
 
 
 // Init static vars:
 char Var::sEmptyString[] = ""; // For explanation, see its declaration in .h file.
+VarStampType Var::sChangeStamp = 0;
+VarStampType Var::sChangeEpoch = 0;
 
 
 ResultType Var::AssignHWND(HWND aWnd)
@@ -151,10 +154,10 @@ ResultType Var::Assign(ExprTokenType &aToken)
 	{
 	case SYM_INTEGER: return Assign(aToken.value_int64); // Listed first for performance because it's Likely the most common from our callers.
 	case SYM_OPERAND: // Listed near the top for performance.
-		if (aToken.buf) // The "buf" of a SYM_OPERAND is non-NULL if it's a pure integer.
+		if (OPERAND_IS_INTEGER(aToken)) // A literal integer that was pre-converted at load-time.
 		{
 			if (*aToken.marker != '0') // It's not an unusual format like 00123 (leading zeroes) or 0xFF (hex).
-				return Assign(*(__int64 *)aToken.buf);
+				return Assign(OPERAND_NUMBER(aToken)->value_int64);
 			// Otherwise, it's something like 0xFF or 00123. For backward compatibility, preserve that formatting
 			// in case the contents of this variable will go on to be displayed or used in a string operation.
 			// The following "double assign" is similar to that in Var::Assign(Var &aVar):
@@ -162,7 +165,7 @@ ResultType Var::Assign(ExprTokenType &aToken)
 				return FAIL;
 			// Below must be done AFTER the above because above's Assign() invalidates the cache, but the
 			// cache should be left valid.
-			UpdateBinaryInt64(*(__int64 *)aToken.buf); // Except when passing VAR_ATTRIB_CONTENTS_OUT_OF_DATE, all callers of UpdateBinaryInt64() must ensure that mContents is a pure number (e.g. NOT 123abc).
+			UpdateBinaryInt64(OPERAND_NUMBER(aToken)->value_int64); // Except when passing VAR_ATTRIB_CONTENTS_OUT_OF_DATE, all callers of UpdateBinaryInt64() must ensure that mContents is a pure number (e.g. NOT 123abc).
 		}
 		//else there is no binary integer; so don't return, continue on to the bottom.
 		break;
@@ -187,6 +190,7 @@ ResultType Var::AssignClipboardAll()
 		return mAliasFor->AssignClipboardAll();
 	if (mType == VAR_CLIPBOARD) // Seems pointless to do Clipboard:=ClipboardAll, and the below isn't equipped
 		return OK;              // to handle it, so make this have no effect.
+	Changed();
 	if (!g_clip.Open())
 		return g_script.ScriptError(CANT_OPEN_CLIPBOARD_READ);
 
@@ -363,6 +367,7 @@ ResultType Var::AssignBinaryClip(Var &aSourceVar)
 		// if your forget at use the implicit "this" by accident.  So instead, just call self.
 		return mAliasFor->AssignBinaryClip(aSourceVar);
 
+	Changed();
 	// Resolve early for maintainability.
 	// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()).
 	Var &source_var = (aSourceVar.mType == VAR_ALIAS) ? *aSourceVar.mAliasFor : aSourceVar;
@@ -456,6 +461,7 @@ ResultType Var::Assign(char *aBuf, VarSizeType aLength, bool aExactSize, bool aO
 		// if your forget at use the implicit "this" by accident.  So instead, just call self.
 		return mAliasFor->Assign(aBuf, aLength, aExactSize);
 
+	Changed();
 	bool do_assign = true;        // Set defaults.
 	bool free_it_if_large = true; //
 	if (!aBuf)
@@ -562,20 +568,7 @@ ResultType Var::Assign(char *aBuf, VarSizeType aLength, bool aExactSize, bool aO
 			new_size = space_needed; // Below relies on this being initialized unconditionally.
 			if (!aExactSize)
 			{
-				// Allow a little room for future expansion to cut down on the number of
-				// free's and malloc's we expect to have to do in the future for this var:
-				if (new_size < 16) // v1.0.45.03: Added this new size to prevent all local variables in a recursive
-					new_size = 16; // function from having a minimum size of MAX_PATH.  16 seems like a good size because it holds nearly any number.  It seems counterproductive to go too small because each malloc, no matter how small, could have around 40 bytes of overhead.
-				else if (new_size < MAX_PATH)
-					new_size = MAX_PATH;  // An amount that will fit all standard filenames seems good.
-				else if (new_size < (160 * 1024)) // MAX_PATH to 160 KB or less -> 10% extra.
-					new_size = (size_t)(new_size * 1.1);
-				else if (new_size < (1600 * 1024))  // 160 to 1600 KB -> 16 KB extra
-					new_size += (16 * 1024);
-				else if (new_size < (6400 * 1024)) // 1600 to 6400 KB -> 1% extra
-					new_size = (size_t)(new_size * 1.01);
-				else  // 6400 KB or more: Cap the extra margin at some reasonable compromise of speed vs. mem usage: 64 KB
-					new_size += (64 * 1024);
+				new_size = VarAssignCapacity(space_needed); // Allow a little room for future expansion (see vargrow.h).
 				if (new_size > g_MaxVarCapacity && aObeyMaxMem) // v1.0.43.03: aObeyMaxMem was added since some callers aren't supposed to obey it.
 					new_size = g_MaxVarCapacity;  // which has already been verified to be enough.
 			}
@@ -828,6 +821,7 @@ void Var::Free(int aWhenToFree, bool aExcludeAliases)
 	if (aWhenToFree == VAR_ALWAYS_FREE_BUT_EXCLUDE_STATIC && (mAttrib & VAR_ATTRIB_STATIC))
 		return; // This is the only case in which the variable ISN'T made blank.
 
+	Changed();
 	mLength = 0; // Writing to union is safe because above already ensured that "this" isn't an alias.
 	mAttrib &= ~VAR_ATTRIB_OFTEN_REMOVED; // Even if it isn't free'd, variable will be made blank. So it seems proper to always remove the binary_clip attribute (since it can't be used that way after it's been made blank).
 
@@ -905,11 +899,12 @@ void Var::Free(int aWhenToFree, bool aExcludeAliases)
 
 
 
-ResultType Var::AppendIfRoom(char *aStr, VarSizeType aLength)
-// Returns OK if there's room enough to append aStr and it succeeds.
-// Returns FAIL otherwise (also returns FAIL for VAR_CLIPBOARD).
+ResultType Var::Append(char *aStr, VarSizeType aLength)
+// Returns OK if aStr was appended, expanding the variable's capacity if necessary.
+// Returns FAIL otherwise (also returns FAIL for VAR_CLIPBOARD), in which case the variable is unchanged so that
+// the caller can fall back to a slower method (which will also report any out-of-memory or #MaxMem error).
 // Environment variables aren't supported here; instead, aStr is appended directly onto the actual/internal
-// contents of the "this" variable.
+// contents of the "this" variable.  aStr may point into this variable's own contents (e.g. x .= x).
 {
 	// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()):
 	Var &var = *(mType == VAR_ALIAS ? mAliasFor : this);
@@ -917,10 +912,47 @@ ResultType Var::AppendIfRoom(char *aStr, VarSizeType aLength)
 		return FAIL; // CHECK THIS FIRST, BEFORE BELOW, BECAUSE CALLERS ALWAYS WANT IT TO BE A FAILURE.
 	if (!aLength) // Consider the appending of nothing (even onto unsupported things like clipboard) to be a success.
 		return OK;
+	var.Changed();
 	VarSizeType var_length = var.LengthIgnoreBinaryClip(); // Get the apparent length because one caller is a concat that wants consistent behavior of the .= operator regardless of whether this shortcut succeeds or not.
 	VarSizeType new_length = var_length + aLength;
-	if (new_length >= var.mCapacity) // Not enough room.
-		return FAIL;
+	if (new_length >= var.mCapacity) // Not enough room, so try to expand.
+	{
+		// Building a large string one piece at a time (e.g. x .= A_LoopReadLine) used to be quadratic: each time
+		// the capacity ran out, the concatenation was first done in temporary memory and then copied again by
+		// Assign(), whose margin for future expansion is at most 64 KB.  To make such loops linear (amortized),
+		// expand geometrically instead, and use realloc() so that the old contents are copied at most once (or
+		// not at all if the heap can grow the block in place).  This is done only here rather than in Assign()
+		// because the extra capacity is worthwhile only when the script is known to be appending.
+		size_t space_needed = (size_t)new_length + 1;
+		if (new_length < var_length // Overflow.
+			|| space_needed > g_MaxVarCapacity
+			|| var.mHowAllocated != ALLOC_MALLOC && space_needed <= MAX_ALLOC_SIMPLE) // Let Assign() handle small strings, which it puts on SimpleHeap.
+			return FAIL;
+		size_t new_size = VarAppendCapacity(var.mCapacity, space_needed, g_MaxVarCapacity); // Expand by 50%.
+		if (!new_size)
+			return FAIL;
+		// Since realloc() may move the block, any part of aStr that lies inside it must be relocated:
+		bool source_is_self = aStr >= var.mContents && aStr < var.mContents + var.mCapacity;
+		size_t source_offset = aStr - var.mContents;
+		char *new_mem;
+		if (var.mHowAllocated == ALLOC_MALLOC && var.mCapacity) // mCapacity==0 means mContents is the constant empty string.
+		{
+			if (   !(new_mem = (char *)realloc(var.mContents, new_size))   )
+				return FAIL; // The old block is still intact, so the variable is unchanged.
+		}
+		else // It's empty or on SimpleHeap, which can't be realloc'd or freed (see Assign() for why that's okay).
+		{
+			if (   !(new_mem = (char *)malloc(new_size))   )
+				return FAIL;
+			memcpy(new_mem, var.mContents, var_length + 1); // +1 to include the zero terminator.
+			var.mHowAllocated = ALLOC_MALLOC;
+		}
+		if (source_is_self)
+			aStr = new_mem + source_offset;
+		var.mContents = new_mem;
+		var.mCapacity = (VarSizeType)new_size;
+		var.mAttrib &= ~VAR_ATTRIB_CACHE_DISABLED; // See Assign() for comments.
+	}
 	memmove(var.mContents + var_length, aStr, aLength);  // mContents was updated via LengthIgnoreBinaryClip() above. Use memmove() vs. memcpy() in case there's any overlap between source and dest.
 	var.mContents[new_length] = '\0'; // Terminate it as a separate step in case caller passed a length shorter than the apparent length of aStr.
 	var.mLength = new_length;
@@ -990,6 +1022,7 @@ void Var::SetLengthFromContents()
 {
 	// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()).
 	Var &var = *(mType == VAR_ALIAS ? mAliasFor : this);
+	var.Changed(); // The caller might have written directly into the contents.
 	VarSizeType capacity = var.Capacity();
 	var.UpdateContents(); // Ensure mContents and mLength are up-to-date.
 	if (capacity > 0)
@@ -1069,6 +1102,7 @@ void Var::Backup(VarBkp &aVarBkp)
 	if (mType != VAR_ALIAS) // Fix for v1.0.42.07: Don't reset mLength if the other member of the union is in effect.
 		mLength = 0;        // Otherwise, functions that recursively pass ByRef parameters can crash because mType stays as VAR_ALIAS.
 	mHowAllocated = ALLOC_MALLOC; // Never NONE because that would permit SIMPLE. See comments higher above.
+	Changed(); // For an alias, this is the alias itself, which is correct because only what it points to has changed.
 	mAttrib &= ~(VAR_ATTRIB_OFTEN_REMOVED | VAR_ATTRIB_CACHE_DISABLED); // But the VAR_ATTRIB_STATIC flag isn't altered.
 	// Above: Removing VAR_ATTRIB_CACHE_DISABLED doesn't cost anything in performance and might help cases where
 	// a recursively-called function does numeric, cache-only operations on a variable that has zero capacity
@@ -1101,6 +1135,7 @@ void Var::FreeAndRestoreFunctionVars(Func &aFunc, VarBkp *&aVarBackup, int &aVar
 			var.mHowAllocated = bkp.mHowAllocated; // This might be ALLOC_SIMPLE or ALLOC_NONE if backed-up variable was at the lowest layer of the call stack.
 			var.mAttrib = bkp.mAttrib;
 			var.mType = bkp.mType;
+			var.Changed();
 		}
 		free(aVarBackup);
 		aVarBackup = NULL; // Some callers want this reset; it's an indicator of whether the next function call in this expression (if any) will have a backup.
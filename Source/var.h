@@ -51,6 +51,7 @@ typedef UCHAR VarTypeType;     // UCHAR vs. VarTypes to save memory.
 typedef UCHAR AllocMethodType; // UCHAR vs. AllocMethod to save memory.
 typedef UCHAR VarAttribType;   // Same.
 typedef DWORD VarSizeType;     // Up to 4 gig if sizeof(UINT) is 4.  See next line.
+typedef UINT VarStampType;
 #define VARSIZE_MAX MAXDWORD
 #define VARSIZE_ERROR VARSIZE_MAX
 
@@ -76,6 +77,7 @@ struct VarBkp // This should be kept in sync with any changes to the Var class.
 	// Not needed in the backup:
 	//bool mIsLocal;
 	//char *mName;
+	//VarStampType mChangeStamp; // Backup() and the restore both mark the variable as changed instead.
 };
 
 
@@ -123,6 +125,7 @@ private:
 		VarSizeType mCapacity; // In bytes.  Includes the space for the zero terminator.
 		BuiltInVarType mBIV;
 	};
+	VarStampType mChangeStamp; // The value of sChangeStamp when this variable's contents (or, for an alias, its target) last changed.  See ChangedSince().
 	AllocMethodType mHowAllocated; // Keep adjacent/contiguous with the below to save memory.
 	#define VAR_ATTRIB_BINARY_CLIP  0x01
 	#define VAR_ATTRIB_PARAM        0x02 // Currently unused.
@@ -144,6 +147,18 @@ private:
 
 	friend class Line; // For access to mBIV.
 
+	static VarStampType sChangeStamp;  // Incremented by every change to any variable.
+	static VarStampType sChangeEpoch;  // Incremented whenever sChangeStamp wraps around to zero.
+
+	void Changed()
+	// Caller must call this for the variable whose contents changed (never an alias of it), and for an alias
+	// whenever it's made to point elsewhere.
+	{
+		if (!++sChangeStamp)
+			++sChangeEpoch;
+		mChangeStamp = sChangeStamp;
+	}
+
 	void UpdateBinaryInt64(__int64 aInt64, VarAttribType aAttrib = VAR_ATTRIB_HAS_VALID_INT64)
 	// When caller doesn't include VAR_ATTRIB_CONTENTS_OUT_OF_DATE in aAttrib, CALLER MUST ENSURE THAT
 	// mContents CONTAINS A PURE NUMBER; i.e. it mustn't contain something non-numeric at the end such as
@@ -152,6 +167,7 @@ private:
 	{
 		// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()).
 		Var &var = *(mType == VAR_ALIAS ? mAliasFor : this);
+		var.Changed(); // Even when merely caching the number of unchanged contents, which is harmless.
 		var.mContentsInt64 = aInt64;
 		var.mAttrib &= ~VAR_ATTRIB_CACHE; // But not VAR_ATTRIB_CONTENTS_OUT_OF_DATE because the caller specifies whether or not that gets added.
 		var.mAttrib |= aAttrib; // Must be done prior to below. Indicate the type of binary number and whether VAR_ATTRIB_CONTENTS_OUT_OF_DATE is present.
@@ -209,7 +225,7 @@ private:
 			else if (var.mAttrib & VAR_ATTRIB_HAS_VALID_DOUBLE)
 			{
 				// "%0.6f"; %f can handle doubles in MSVC++:
-				var.Assign(value_string, snprintf(value_string, sizeof(value_string), g->FormatFloat, var.mContentsDouble));
+				var.Assign(value_string, FTOA(var.mContentsDouble, value_string, sizeof(value_string)));
 				// In this case, read-caching should be disabled for scripts that use "SetFormat Float" because
 				// they might rely on SetFormat having rounded floats off to FAR fewer decimal places (or
 				// even to integers via "SetFormat, Float, 0").  Such scripts can use read-caching only when
@@ -240,6 +256,24 @@ public:
 	// string to it.  There is now some code there that tries to detect when that happens.
 	static char sEmptyString[1]; // See above.
 
+	// A caller that has derived something from a variable's contents (such as a compiled match list) can
+	// record Now() and later call ChangedSince() to find out whether it must look at the contents again.
+	// Every method that changes a variable's contents updates its stamp, and so do Close() and
+	// SetLengthFromContents(), which callers that write directly into Contents() must call afterward.
+	// A variable whose address the script has taken can change at any time, so it's always reported as
+	// changed.
+	struct Stamp {VarStampType epoch, stamp;};
+	static Stamp Now() {Stamp now = {sChangeEpoch, sChangeStamp}; return now;}
+	bool ChangedSince(const Stamp &aStamp)
+	{
+		// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()).
+		Var &var = *(mType == VAR_ALIAS ? mAliasFor : this);
+		return aStamp.epoch != sChangeEpoch
+			|| mChangeStamp > aStamp.stamp     // This alias was made to point elsewhere (or, for a non-alias, the same as below).
+			|| var.mChangeStamp > aStamp.stamp // The contents changed.
+			|| (var.mAttrib & VAR_ATTRIB_CACHE_DISABLED); // See SYM_ADDRESS.
+	}
+
 	VarSizeType Get(char *aBuf = NULL);
 	ResultType AssignHWND(HWND aWnd);
 	ResultType Assign(Var &aVar);
@@ -388,7 +422,7 @@ public:
 	#define VAR_NEVER_FREE                     3
 	#define VAR_FREE_IF_LARGE                  4
 	void Free(int aWhenToFree = VAR_ALWAYS_FREE, bool aExcludeAliases = false);
-	ResultType AppendIfRoom(char *aStr, VarSizeType aLength);
+	ResultType Append(char *aStr, VarSizeType aLength);
 	void AcceptNewMem(char *aNewMem, VarSizeType aLength);
 	void SetLengthFromContents();
 
@@ -565,6 +599,7 @@ public:
 	{
 		mAliasFor = NULL; // This also sets its counterpart in the union (mLength) to zero, which is appropriate because mContents should have been set to blank by a previous call to Free().
 		mType = VAR_NORMAL; // It might already be this type, so this is just in case it's VAR_ALIAS.
+		Changed();
 	}
 
 	__forceinline Var *ResolveAlias()
@@ -600,12 +635,14 @@ public:
 
 		mAliasFor = aTargetVar; // Should always be non-NULL due to various checks elsewhere.
 		mType = VAR_ALIAS; // It might already be this type, so this is just in case it's VAR_NORMAL.
+		Changed();
 	}
 
 	ResultType Close(bool aIsBinaryClip = false)
 	{
 		// Relies on the fact that aliases can't point to other aliases (enforced by UpdateAlias()).
 		Var &var = *(mType == VAR_ALIAS ? mAliasFor : this);
+		var.Changed();
 		if (var.mType == VAR_CLIPBOARD && g_clip.IsReadyForWrite())
 			return g_clip.Commit(); // Writes the new clipboard contents to the clipboard and closes it.
 
@@ -628,6 +665,7 @@ public:
 		: mContents(sEmptyString) // Invariant: Anyone setting mCapacity to 0 must also set mContents to the empty string.
 		// Doesn't need initialization: , mContentsInt64(NULL)
 		, mLength(0) // This also initializes mAliasFor within the same union.
+		, mChangeStamp(0)
 		, mHowAllocated(ALLOC_NONE)
 		, mAttrib(0) // Seems best not to init empty vars to VAR_ATTRIB_NOT_NUMERIC because it would reduce maintainability, plus finding out whether an empty var is numeric via IsPureNumeric() is a very fast operation.
 		, mIsLocal(aIsLocal)
@@ -0,0 +1,55 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include <stdlib.h>
+#include "vargrow.h"
+
+#ifndef MAX_PATH
+#define MAX_PATH 260 // Same as the Windows headers, for building outside Windows.
+#endif
+
+
+
+size_t VarAssignCapacity(size_t aSpaceNeeded)
+{
+	// Allow a little room for future expansion to cut down on the number of
+	// free's and malloc's we expect to have to do in the future for this var:
+	if (aSpaceNeeded < 16) // v1.0.45.03: Added this new size to prevent all local variables in a recursive
+		return 16; // function from having a minimum size of MAX_PATH.  16 seems like a good size because it holds nearly any number.  It seems counterproductive to go too small because each malloc, no matter how small, could have around 40 bytes of overhead.
+	if (aSpaceNeeded < MAX_PATH)
+		return MAX_PATH;  // An amount that will fit all standard filenames seems good.
+	if (aSpaceNeeded < (160 * 1024)) // MAX_PATH to 160 KB or less -> 10% extra.
+		return (size_t)(aSpaceNeeded * 1.1);
+	if (aSpaceNeeded < (1600 * 1024))  // 160 to 1600 KB -> 16 KB extra
+		return aSpaceNeeded + (16 * 1024);
+	if (aSpaceNeeded < (6400 * 1024)) // 1600 to 6400 KB -> 1% extra
+		return (size_t)(aSpaceNeeded * 1.01);
+	// 6400 KB or more: Cap the extra margin at some reasonable compromise of speed vs. mem usage: 64 KB
+	return aSpaceNeeded + (64 * 1024);
+}
+
+
+
+size_t VarAppendCapacity(size_t aCapacity, size_t aSpaceNeeded, size_t aMaxCapacity)
+{
+	size_t new_size = aCapacity + aCapacity / 2; // Expand by 50%, which wastes less memory than doubling for very large strings.
+	if (new_size < aSpaceNeeded)
+		new_size = aSpaceNeeded;
+	if (new_size > aMaxCapacity)
+		new_size = aMaxCapacity; // Which caller has verified to be enough.
+	return new_size > 2147483647 ? 0 : new_size; // Same sanity limit as Assign().
+}
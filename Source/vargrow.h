@@ -0,0 +1,37 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef vargrow_h
+#define vargrow_h
+
+// The policies by which a variable's capacity grows.  Var::Assign() leaves a margin for future expansion that
+// shrinks as the variable grows (down to 64 KB beyond 6.4 MB), which conserves memory for the vast majority
+// of variables, which are assigned once or rarely.  Var::Append() grows by 50% instead, so that building a
+// string one piece at a time (x .= A_LoopReadLine) takes amortized linear rather than quadratic time.
+//
+// test/vargrow_test.cpp checks both and test/vargrow_bench.cpp times the building of a 500 MB string with
+// each.  Keep this file free of anything those programs can't compile outside Windows.
+
+// Returns the capacity Assign() gives a malloc'd variable that must hold aSpaceNeeded bytes (including the
+// zero terminator).  Caller must still limit the result to #MaxMem.
+size_t VarAssignCapacity(size_t aSpaceNeeded);
+
+// Returns the capacity Append() gives a malloc'd variable whose current capacity is aCapacity and which must
+// now hold aSpaceNeeded bytes, which caller has ensured is no greater than aMaxCapacity.  Returns 0 if the
+// result would exceed the 2 GB sanity limit that Assign() also uses.
+size_t VarAppendCapacity(size_t aCapacity, size_t aSpaceNeeded, size_t aMaxCapacity);
+
+#endif
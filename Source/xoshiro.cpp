@@ -0,0 +1,104 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "stdafx.h" // pre-compiled headers
+#include "xoshiro.h"
+
+
+
+void RandomSeed(RandomState &aState, RandomUInt64Type aSeed)
+// Expands aSeed into a full state with SplitMix64, as recommended by the authors.  Since SplitMix64 is a
+// bijection applied to distinct counter values, the resulting state can't be all zero.
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		RandomUInt64Type z = (aSeed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		aState.s[i] = z ^ (z >> 31);
+	}
+}
+
+
+
+void RandomJump(RandomState &aState)
+// Advances aState as though RandomNext() had been called 2^128 times.  The caller can use this to split
+// off a stream: copy the state, then jump the original.
+{
+	static const RandomUInt64Type sJump[4] = {0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL
+		, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL};
+	RandomUInt64Type s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (int i = 0; i < 4; ++i)
+		for (int b = 0; b < 64; ++b)
+		{
+			if (sJump[i] & ((RandomUInt64Type)1 << b))
+			{
+				s0 ^= aState.s[0];
+				s1 ^= aState.s[1];
+				s2 ^= aState.s[2];
+				s3 ^= aState.s[3];
+			}
+			RandomNext(aState);
+		}
+	aState.s[0] = s0;
+	aState.s[1] = s1;
+	aState.s[2] = s2;
+	aState.s[3] = s3;
+}
+
+
+
+unsigned int RandomBelow(RandomState &aState, unsigned int aRange)
+// Returns a uniformly distributed number in the range 0 to aRange-1, or any 32-bit number if aRange is 0
+// (so that a range spanning all 2^32 values can be expressed).  Unlike taking the remainder of a random
+// number, this has no bias toward low numbers.  It uses Lemire's multiply-and-reject method, which rarely
+// needs more than one random number and avoids a division in the common case.
+{
+	unsigned int r = (unsigned int)(RandomNext(aState) >> 32); // The high bits are the best ones.
+	if (!aRange)
+		return r;
+	RandomUInt64Type m = (RandomUInt64Type)r * aRange;
+	if ((unsigned int)m < aRange) // Possibly in the biased region, so check precisely.
+	{
+		unsigned int threshold = (0U - aRange) % aRange; // i.e. 2^32 mod aRange.
+		while ((unsigned int)m < threshold)
+			m = (RandomUInt64Type)(unsigned int)(RandomNext(aState) >> 32) * aRange;
+	}
+	return (unsigned int)(m >> 32);
+}
+
+
+
+void RandomFillBelow(RandomState &aState, unsigned int *aBuf, size_t aCount, unsigned int aRange)
+// Fills aBuf with aCount numbers as though by calling RandomBelow() for each.  Operating on a copy of the
+// state keeps it in registers for the duration of the loop.
+{
+	RandomState state = aState;
+	for (size_t i = 0; i < aCount; ++i)
+		aBuf[i] = RandomBelow(state, aRange);
+	aState = state;
+}
+
+
+
+void RandomFillUnit(RandomState &aState, double *aBuf, size_t aCount)
+// Fills aBuf with aCount numbers as though by calling RandomUnit() for each.
+{
+	RandomState state = aState;
+	for (size_t i = 0; i < aCount; ++i)
+		aBuf[i] = RandomUnit(state);
+	aState = state;
+}
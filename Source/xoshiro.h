@@ -0,0 +1,72 @@
+/*
+AutoHotkey
+
+Copyright 2003-2009 Chris Mallett (support@autohotkey.com)
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef xoshiro_h
+#define xoshiro_h
+
+#include <stddef.h> // For size_t.
+
+// This is the xoshiro256** generator by David Blackman and Sebastiano Vigna (placed by them in the public
+// domain; see http://prng.di.unimi.it/).  Compared to the Mersenne Twister it replaces, its state is only
+// 32 bytes, which makes it practical for each quasi-thread to have its own, and RandomJump() advances a state
+// by 2^128 values in constant time, which allows any number of streams that are guaranteed not to overlap
+// to be split off from a single seed.
+//
+// The generator is pure arithmetic on 64-bit integers, so test/xoshiro_test.cpp can compare its output with
+// the reference implementation's on any compiler; the per-thread streams themselves live in script.cpp.
+
+#ifdef _MSC_VER
+typedef unsigned __int64 RandomUInt64Type;
+#else
+typedef unsigned long long RandomUInt64Type;
+#endif
+
+struct RandomState
+{
+	RandomUInt64Type s[4]; // Must never be all zero, which RandomSeed() ensures.
+};
+
+void RandomSeed(RandomState &aState, RandomUInt64Type aSeed);
+void RandomJump(RandomState &aState);
+
+inline RandomUInt64Type RandomNext(RandomState &aState)
+// Returns the next 64 random bits.
+{
+	RandomUInt64Type *s = aState.s;
+	RandomUInt64Type x = s[1] * 5;
+	RandomUInt64Type result = ((x << 7) | (x >> 57)) * 9;
+	RandomUInt64Type t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = (s[3] << 45) | (s[3] >> 19);
+	return result;
+}
+
+unsigned int RandomBelow(RandomState &aState, unsigned int aRange);
+void RandomFillBelow(RandomState &aState, unsigned int *aBuf, size_t aCount, unsigned int aRange);
+
+inline double RandomUnit(RandomState &aState)
+// Returns a number in the closed interval [0,1] with 53 bits of resolution.
+{
+	return (double)(RandomNext(aState) >> 11) * (1.0 / 9007199254740991.0); // 2^53 - 1
+}
+
+void RandomFillUnit(RandomState &aState, double *aBuf, size_t aCount);
+
+#endif